@@ -0,0 +1,38 @@
+# ============================================================
+# SwanOS — Kernel symbol table generator
+# Turns `nm -n -S --defined-only` output into ksyms_gen.c: text
+# symbols sorted by address, plus a sentinel at the end of the
+# last one (see src/ksyms.h).
+# ============================================================
+
+function hex(s,    i, v) {
+    v = 0
+    s = tolower(s)
+    for (i = 1; i <= length(s); i++) v = v * 16 + index("0123456789abcdef", substr(s, i, 1)) - 1
+    return v
+}
+
+BEGIN {
+    print "/* Generated by make from the first link pass; do not edit */"
+    print "#include \"ksyms.h\""
+    print ""
+    print "const ksym_t ksym_table[] = {"
+    n = 0; end = 0; last = -1
+}
+
+NF >= 3 && ($(NF - 1) == "t" || $(NF - 1) == "T") {
+    addr = hex($1)
+    size = NF == 4 ? hex($2) : 0
+    if (addr + size > end) end = addr + size
+    if (addr == last) next          # aliases: keep the first name
+    last = addr
+    printf "    { 0x%08x, \"%s\" },\n", addr, $NF
+    n++
+}
+
+END {
+    printf "    { 0x%08x, \"\" },\n", end
+    print "};"
+    print ""
+    printf "const uint32_t ksym_table_len = %d;\n", n + 1
+}
@@ -1,48 +1,216 @@
 #!/usr/bin/env python3
 """
 SwanOS - Groq API Serial Bridge
-Reads commands from the QEMU/VirtualBox serial pipe and forwards them to the Groq API.
+Reads commands from the QEMU/VirtualBox serial pipe, or from a TCP connection
+made by the OS's network stack, and forwards them to the Groq API.
 Supports conversation history, model switching, and system prompts.
 
 Setup:
     pip install groq
     
 Usage:
-    ./llm_bridge.py <serial_in_pipe> <serial_out_pipe> [--log <logfile>]
+    ./llm_bridge.py <serial_in_pipe> <serial_out_pipe> [--tcp PORT] [--log <logfile>]
+    ./llm_bridge.py --tcp 5555          (network only; QEMU -netdev user)
     
-Protocol:
-    \x01K<api_key>\x04       - Sets the Groq API key
-    \x01Q<query>\x04         - Sends a query to the LLM (responds with text + \x04)
-    \x01M<model_name>\x04    - Sets the LLM model to use
-    \x01S<system_prompt>\x04 - Sets the system prompt
-    \x01C\x04                - Clears the conversation history
-    \x01T<temperature>\x04   - Sets the temperature (0.0 to 2.0)
-    \x01O<max_tokens>\x04    - Sets the max tokens for response
-    \x01P<top_p>\x04         - Sets the top-p sampling value (0.0 to 1.0)
-    \x01I\x04                - Returns current bridge info/status
+Protocol (framed, multiplexed - see LLM_BRIDGE.md):
+    SYNC(02 A5) | chan | op | req_id u16 LE | len u16 LE | payload | sum8
+    chan bit 7 set = more fragments follow; sum8 = sum(chan..payload) & 0xFF
+
+    CTRL  (0): K<api_key>  M<model>  S<system_prompt>  C (clear history)
+               T<temperature>  O<max_tokens>  P<top_p>  I (info -> R)
+               H (heartbeat -> P)
+    LLM   (1): Q<query> -> R<text> / E<error>, same req_id; the reply is
+               streamed as MORE fragments while tokens arrive
+    STORE (2): V<name>|<content>   L<name> -> R<content> / E
+    AUDIT (3): A<event>  B<event>\n<event>\n... (batched by the kernel)
+    TELEM (4): B<binary batch> (see decode_telemetry_batch)  T<key=val,...>
+    TRACE (5): X<binary event batch> (see decode_trace_batch), appended
+               to host_data/trace.json for chrome://tracing / Perfetto
+
+    The bridge runs on one asyncio event loop. Each query is a task
+    streaming its completion back token by token, so a slow completion
+    never holds up storage, audit or heartbeat traffic; replies carry the
+    request id and may arrive in any order. Bytes outside frames (console mirror) are ignored.
+
+    With --tcp the same frames are also accepted over TCP; every reply goes
+    back on the stream its request came in on.
 """
 
 import sys
 import os
+import asyncio
 import time
+import json
+import struct
 import argparse
 import logging
-import typing
-from groq import Groq  # type: ignore
+import socket
+from concurrent.futures import ThreadPoolExecutor
+from groq import AsyncGroq  # type: ignore
 
 # Default configurations
 DEFAULT_MODEL = "llama-3.3-70b-versatile"
 DEFAULT_SYSTEM_PROMPT = "You are SwanOS AI, an intelligent assistant built directly into the core of a bare-metal operating system. Keep your answers concise, helpful, and under 50 words when possible as the OS terminal is small."
 DEFAULT_TEMPERATURE = 0.7
 MAX_HISTORY = 10  # Maximum number of messages to keep in history to avoid token limits
+QUERY_CONCURRENCY = 8  # LLM completions in flight at once
+STREAM_FLUSH_BYTES = 48    # After the first token, coalesce up to this many bytes...
+STREAM_FLUSH_SECS = 0.05   # ...or this long, whichever comes first
+
+# Framing (must match src/bridge.h)
+SYNC = b"\x02\xA5"
+HDR_LEN = 6
+MORE = 0x80
+MAX_PAYLOAD = 1024
+CH_CTRL, CH_LLM, CH_STORE, CH_AUDIT, CH_TELEM, CH_TRACE = range(6)
+
+# Binary telemetry record layout (must match src/telemetry.h)
+TELEM_VERSION = 1
+TELEM_MAX_PROCS = 8
+TELEM_FIELDS = (["tick", "heap_kb", "pmm_pages", "procs", "ctx_switches", "frame_ms", "frames"]
+                + [f"irq{i}" for i in range(16)]
+                + [f"{k}{i}" for i in range(TELEM_MAX_PROCS) for k in ("pid", "cpu")])
+
+# Trace event batches (must match src/trace.h)
+TRACE_VERSION = 1
+TRACE_HDR = struct.Struct('<BBHI')          # version, cpu, count, tsc_per_us
+TRACE_EVENT = struct.Struct('<IIHBBII')     # tsc_lo, tsc_hi, type, cpu, pad, a, b
+TRACE_TYPES = {1: "switch", 2: "irq_enter", 3: "irq_exit", 4: "syscall",
+               5: "page_fault", 6: "pmm_alloc", 7: "bridge_tx", 8: "bridge_rx"}
+
+
+def decode_telemetry_batch(data: bytes) -> list[list[int]]:
+    """Undo the mask + zigzag varint delta encoding of one 'B' batch."""
+    if len(data) < 3 or data[0] != TELEM_VERSION:
+        raise ValueError("unsupported telemetry batch")
+    nfields, count = data[1], data[2]
+    mask_len = (nfields + 7) // 8
+    pos = 3
+    prev = [0] * nfields
+    records = []
+    for _ in range(count):
+        mask = data[pos:pos + mask_len]
+        pos += mask_len
+        rec = list(prev)
+        for i in range(nfields):
+            if not mask[i >> 3] & (1 << (i & 7)):
+                continue
+            v = shift = 0
+            while True:
+                b = data[pos]
+                pos += 1
+                v |= (b & 0x7F) << shift
+                shift += 7
+                if not b & 0x80:
+                    break
+            delta = (v >> 1) ^ -(v & 1)
+            rec[i] = (prev[i] + delta) & 0xFFFFFFFF
+        records.append(rec)
+        prev = rec
+    return records
+
+
+def decode_trace_batch(data: bytes) -> list[dict]:
+    """Turn one 'X' batch into Chrome trace-event records (ts in us)."""
+    if len(data) < TRACE_HDR.size or data[0] != TRACE_VERSION:
+        raise ValueError("unsupported trace batch")
+    _, cpu, count, per_us = TRACE_HDR.unpack_from(data)
+    per_us = per_us or 1
+    events = []
+    for i in range(count):
+        lo, hi, typ, ev_cpu, _, a, b = TRACE_EVENT.unpack_from(data, TRACE_HDR.size + i * TRACE_EVENT.size)
+        ev = {"pid": 1, "tid": ev_cpu, "ts": ((hi << 32) | lo) / per_us}
+        name = TRACE_TYPES.get(typ, f"type{typ}")
+        if typ in (2, 3):       # IRQ handlers become slices on the CPU's track
+            ev.update(name=f"irq{a}", ph="B" if typ == 2 else "E")
+        elif typ == 1:
+            ev.update(name=f"pid {a} -> {b}", ph="i", s="t", cat=name)
+        elif typ in (7, 8):
+            ev.update(name=name, ph="i", s="t", args={"chan": a >> 8, "op": chr(a & 0xFF), "len": b})
+        else:
+            ev.update(name=name, ph="i", s="t", args={"a": hex(a), "b": b})
+        events.append(ev)
+    return events
+
+
+class FrameReader:
+    """Incremental frame parser; yields (chan, more, op, req, payload)."""
+
+    def __init__(self):
+        self.buf = bytearray()
+        self.bad = 0
+
+    def feed(self, data: bytes):
+        self.buf += data
+        while True:
+            start = self.buf.find(SYNC)
+            if start < 0:
+                # Keep a trailing SYNC0 that may pair with the next chunk
+                del self.buf[:max(0, len(self.buf) - 1)]
+                return
+            del self.buf[:start]
+            if len(self.buf) < 2 + HDR_LEN:
+                return
+            hdr = self.buf[2:2 + HDR_LEN]
+            length = hdr[4] | (hdr[5] << 8)
+            if length > MAX_PAYLOAD:
+                self.bad += 1
+                del self.buf[:2]
+                continue
+            total = 2 + HDR_LEN + length + 1
+            if len(self.buf) < total:
+                return
+            body = bytes(self.buf[2 + HDR_LEN:total - 1])
+            if (sum(hdr) + sum(body)) & 0xFF != self.buf[total - 1]:
+                self.bad += 1
+                del self.buf[:2]   # resync on the next SYNC
+                continue
+            del self.buf[:total]
+            yield hdr[0] & ~MORE, bool(hdr[0] & MORE), chr(hdr[1]), hdr[2] | (hdr[3] << 8), body
+
+
+class FrameWriter:
+    """Frame writer for one stream; fragments long payloads.
+
+    Every send happens on the event loop thread, so one message's
+    fragments are written together without a lock."""
+
+    def __init__(self, write, drain=None):
+        self.write = write      # write(bytes), must not block for long
+        self._drain = drain     # optional coroutine: wait for the stream to catch up
+
+    def send(self, chan: int, op: str, req: int, data: bytes = b"", more: bool = False):
+        """Send one message; more=True leaves it open for further chunks."""
+        frames = []
+        pos = 0
+        while True:
+            chunk = data[pos:pos + MAX_PAYLOAD]
+            pos += len(chunk)
+            c = chan | (MORE if more or pos < len(data) else 0)
+            hdr = bytes([c, ord(op), req & 0xFF, req >> 8, len(chunk) & 0xFF, len(chunk) >> 8])
+            frames.append(SYNC + hdr + chunk + bytes([(sum(hdr) + sum(chunk)) & 0xFF]))
+            if pos >= len(data):
+                break
+        self.write(b"".join(frames))
+
+    async def drain(self):
+        if self._drain:
+            await self._drain()
+
 
 def main():
     parser = argparse.ArgumentParser(description="SwanOS Groq API Serial Bridge")
-    parser.add_argument("pipe_in", help="Path to the serial input pipe (from emulator)")
-    parser.add_argument("pipe_out", help="Path to the serial output pipe (to emulator)")
+    parser.add_argument("pipe_in", nargs="?", help="Path to the serial input pipe (from emulator)")
+    parser.add_argument("pipe_out", nargs="?", help="Path to the serial output pipe (to emulator)")
+    parser.add_argument("--tcp", type=int, metavar="PORT", default=None,
+                        help="Also accept the OS on this TCP port (SwanOS dials 5555)")
     parser.add_argument("--log", help="Optional log file path", default=None)
     
     args = parser.parse_args()
+    if (args.pipe_in is None) != (args.pipe_out is None):
+        parser.error("give both serial pipes, or neither")
+    if args.pipe_in is None and args.tcp is None:
+        parser.error("nothing to serve: give the serial pipes and/or --tcp PORT")
     
     # Configure logging
     log_handlers: list[logging.Handler] = [logging.StreamHandler(sys.stdout)]
@@ -56,7 +224,16 @@ def main():
     )
     
     logger = logging.getLogger("SwanOS-Bridge")
-    
+    logger.info("Starting SwanOS Groq Bridge")
+    try:
+        asyncio.run(run_bridge(args, logger))
+    except KeyboardInterrupt:
+        logger.info("\nBridge shutting down.")
+    except Exception as e:
+        logger.error(f"Fatal bridge error: {e}")
+
+
+async def run_bridge(args, logger: logging.Logger):
     pipe_in_path = args.pipe_in
     pipe_out_path = args.pipe_out
     
@@ -64,205 +241,366 @@ def main():
     HOST_DATA_DIR = "host_data"
     os.makedirs(HOST_DATA_DIR, exist_ok=True)
     
-    logger.info("Starting SwanOS Groq Bridge")
-    logger.info(f"Listening on {pipe_in_path} (IN) / {pipe_out_path} (OUT)")
-    
-    # Wait for pipes to exist (created by QEMU/VBox)
-    while not os.path.exists(pipe_in_path) or not os.path.exists(pipe_out_path):
-        logger.info("Waiting for pipes to be created by emulator...")
-        time.sleep(2)
-        
-    api_key = None
-    client = None
-    
-    # State
-    current_model = DEFAULT_MODEL
-    current_system_prompt = DEFAULT_SYSTEM_PROMPT
-    current_temperature = DEFAULT_TEMPERATURE
-    current_max_tokens = 256
-    current_top_p = 1.0
+    loop = asyncio.get_running_loop()
+
+    # State; everything below runs on the event loop, so no locks
+    state = {
+        "client": None,
+        "model": DEFAULT_MODEL,
+        "system_prompt": DEFAULT_SYSTEM_PROMPT,
+        "temperature": DEFAULT_TEMPERATURE,
+        "max_tokens": 256,
+        "top_p": 1.0,
+        "telemetry": "",
+    }
     conversation_history: list[dict[str, str]] = []
-    
-    try:
-        with open(pipe_in_path, 'rb', buffering=0) as pipe_in, \
-             open(pipe_out_path, 'wb', buffering=0) as pipe_out:
-                 
-            logger.info("Bridge connected. Waiting for commands from SwanOS...")
-            
-            buffer: bytes = b""
+
+    # Completions run as tasks, at most QUERY_CONCURRENCY at a time;
+    # storage ops keep their order on a single worker thread so a save
+    # is visible to the load that follows it, and no file I/O ever
+    # waits behind a completion.
+    query_slots = asyncio.Semaphore(QUERY_CONCURRENCY)
+    store_pool = ThreadPoolExecutor(max_workers=1)
+    tasks: set[asyncio.Task] = set()
+
+    def spawn(coro):
+        task = asyncio.create_task(coro)
+        tasks.add(task)
+        task.add_done_callback(tasks.discard)
+
+    async def stream_completion(out: FrameWriter, req: int, stream) -> tuple[str, bool]:
+        """Forward tokens as R fragments (MORE set) as they arrive: the first
+        at once, then coalesced up to STREAM_FLUSH_BYTES or STREAM_FLUSH_SECS,
+        flushing on time even while the next token is slow. The caller sends
+        the closing frame. Returns the text and whether anything went out."""
+        parts: list[str] = []
+        pending = ""
+        last_flush = time.monotonic()
+        sent_any = False
+
+        def flush():
+            nonlocal pending, last_flush, sent_any
+            if pending:
+                out.send(CH_LLM, 'R', req, pending.encode('utf-8'), more=True)
+                sent_any = True
+                pending = ""
+            last_flush = time.monotonic()
+
+        chunks = stream.__aiter__()
+        nxt = asyncio.ensure_future(chunks.__anext__())
+        try:
             while True:
-                chunk = pipe_in.read(1024)
-                if not chunk:
-                    time.sleep(0.01)
+                timeout = None
+                if pending:
+                    timeout = max(0.0, STREAM_FLUSH_SECS - (time.monotonic() - last_flush))
+                done, _ = await asyncio.wait({nxt}, timeout=timeout)
+                if not done:            # token is slow: ship what we have
+                    flush()
+                    await out.drain()
                     continue
-                    
-                buffer += chunk
-                
-                # Process all complete messages in the buffer (\x04)
-                while b'\x04' in buffer:
-                    parts = buffer.split(b'\x04', 1)
-                    raw_msg = parts[0]
-                    buffer = parts[1]
-                    
-                    # Ensure it has the start of heading (\x01)
-                    if b'\x01' not in raw_msg:
-                        continue
-                        
-                    # Extract message from the last \x01
-                    msg_content = raw_msg[raw_msg.rfind(b'\x01') + 1:]
-                    
-                    if len(msg_content) < 1:
-                        continue
-                        
-                    cmd_type = chr(typing.cast(int, msg_content[0]))
-                    payload = typing.cast(bytes, msg_content[1:]).decode('utf-8', errors='ignore').strip()
-                    
-                    if cmd_type == 'K': # Set API Key
-                        logger.info("Received new API key configuration from OS")
-                        api_key = payload
-                        client = Groq(api_key=api_key)
-                        
-                    elif cmd_type == 'M': # Set Model
-                        logger.info(f"Changing model to: {payload}")
-                        current_model = payload
-                        
-                    elif cmd_type == 'S': # Set System Prompt
-                        logger.info(f"Changing system prompt to: {payload}")
-                        current_system_prompt = payload
-                        conversation_history = [] # Reset history when system prompt changes
-                        
-                    elif cmd_type == 'C': # Clear History
-                        logger.info("Clearing conversation history")
-                        conversation_history = []
-                        
-                    elif cmd_type == 'T': # Set Temperature
-                        try:
-                            temp_val = float(payload)
-                            current_temperature = max(0.0, min(2.0, temp_val))
-                            logger.info(f"Temperature set to {current_temperature}")
-                        except ValueError:
-                            logger.error(f"Invalid temperature received: {payload}")
-                            
-                    elif cmd_type == 'O': # Set Max Tokens
-                        try:
-                            tokens = int(payload)
-                            current_max_tokens = max(1, tokens)
-                            logger.info(f"Max tokens set to {current_max_tokens}")
-                        except ValueError:
-                            logger.error(f"Invalid max tokens received: {payload}")
-                            
-                    elif cmd_type == 'P': # Set Top P
-                        try:
-                            p_val = float(payload)
-                            current_top_p = max(0.0, min(1.0, p_val))
-                            logger.info(f"Top-P set to {current_top_p}")
-                        except ValueError:
-                            logger.error(f"Invalid Top-P received: {payload}")
-                            
-                    elif cmd_type == 'I': # Get Bridge Info
-                        logger.info("Responding to info/ping request")
-                        status_str = f"Bridge Active | Model: {current_model} | Temp: {current_temperature} | Top-P: {current_top_p} | MaxTokens: {current_max_tokens}"
-                        pipe_out.write(status_str.encode('utf-8') + b'\x04')
-                        pipe_out.flush()
-                        continue
-                        
-                    elif cmd_type == 'V':  # Host Save (V for "Volume Save")
-                        # Format: Vfilename|content
-                        parts = payload.split('|', 1)
-                        if len(parts) == 2:
-                            filename, content = parts
-                            # Prevent directory traversal
-                            safe_name = os.path.basename(filename)
-                            file_path = os.path.join(HOST_DATA_DIR, safe_name)
-                            try:
-                                with open(file_path, 'w', encoding='utf-8') as f:
-                                    f.write(content)
-                                logger.info(f"Host Save: {safe_name}")
-                            except Exception as e:
-                                logger.error(f"Host Save Error: {e}")
-                                
-                    elif cmd_type == 'L':  # Host Load (L for "Load")
-                        # Format: Lfilename (responds with content + \x04)
-                        safe_name = os.path.basename(payload)
-                        file_path = os.path.join(HOST_DATA_DIR, safe_name)
-                        try:
-                            if os.path.exists(file_path):
-                                with open(file_path, 'r', encoding='utf-8') as f:
-                                    content = f.read()
-                                pipe_out.write(content.encode('utf-8') + b'\x04')
-                            else:
-                                pipe_out.write(b'\x04')  # Empty response for not found
-                            logger.info(f"Host Load: {safe_name}")
-                        except Exception as e:
-                            logger.error(f"Host Load Error: {e}")
-                            pipe_out.write(b'\x04')
-                        pipe_out.flush()
-                        continue
-
-                    elif cmd_type == 'A':  # Host Audit (A for "Audit Append")
-                        # Format: Acontent
-                        audit_path = os.path.join(HOST_DATA_DIR, "audit.log")
-                        try:
-                            with open(audit_path, 'a', encoding='utf-8') as f:
-                                timestamp = time.strftime("[%Y-%m-%d %H:%M:%S]")
-                                f.write(f"{timestamp} {payload}\n")
-                            logger.info(f"Host Audit: {payload}")
-                        except Exception as e:
-                            logger.error(f"Host Audit Error: {e}")
-                            
-                    elif cmd_type == 'Q': # LLM Query
-                        logger.info(f"Query: {payload}")
-                        
-                        if not client:
-                            response = "Error: Groq API key not set or invalid."
-                            logger.warning(response)
-                            pipe_out.write(response.encode('utf-8') + b'\x04')
-                            pipe_out.flush()
-                            continue
-                            
-                        # Build messages array
-                        messages = [{"role": "system", "content": current_system_prompt}]
-                        messages.extend(conversation_history)
-                        messages.append({"role": "user", "content": payload})
-                        
-                        # Query Groq with Retry Logic
-                        max_retries = 3
-                        for attempt in range(max_retries):
-                            try:
-                                completion = client.chat.completions.create(  # type: ignore
-                                    model=current_model,
-                                    messages=messages,
-                                    temperature=current_temperature,
-                                    max_completion_tokens=current_max_tokens,
-                                    top_p=current_top_p,
-                                )
-                                response = completion.choices[0].message.content.strip()
-                                logger.info(f"Response (len {len(response)})")
-                                
-                                # Update conversation history
-                                conversation_history.append({"role": "user", "content": payload})  # pyre-ignore
-                                conversation_history.append({"role": "assistant", "content": response})  # pyre-ignore
-                                
-                                # Prune history to avoid context limits
-                                if len(conversation_history) > MAX_HISTORY * 2:
-                                    conversation_history = conversation_history[-(MAX_HISTORY * 2):]  # pyre-ignore
-                                break # Successful query, exit retry loop
-                                    
-                            except Exception as e:
-                                logger.error(f"Error querying Groq (Attempt {attempt + 1}/{max_retries}): {e}")
-                                if attempt < max_retries - 1:
-                                    time.sleep(2 ** attempt) # Exponential backoff
-                                else:
-                                    response = f"API Error: {str(e)}"
-                            
-                        # Send back to OS
-                        pipe_out.write(response.encode('utf-8') + b'\x04')
-                        pipe_out.flush()
-                        
-    except KeyboardInterrupt:
-        logger.info("\nBridge shutting down.")
-    except Exception as e:
-        logger.error(f"Fatal bridge error: {e}")
+                try:
+                    chunk = nxt.result()
+                except StopAsyncIteration:
+                    break
+                nxt = asyncio.ensure_future(chunks.__anext__())
+                delta = chunk.choices[0].delta.content or ""
+                if not parts:
+                    delta = delta.lstrip()
+                if not delta:
+                    continue
+                parts.append(delta)
+                pending += delta
+                if (len(parts) == 1 or len(pending) >= STREAM_FLUSH_BYTES
+                        or time.monotonic() - last_flush >= STREAM_FLUSH_SECS):
+                    flush()
+                    await out.drain()
+        finally:
+            nxt.cancel()
+        out.send(CH_LLM, 'R', req, pending.rstrip().encode('utf-8'))
+        return "".join(parts).strip(), sent_any
+
+    async def run_query(out: FrameWriter, req: int, payload: str):
+        nonlocal conversation_history
+        async with query_slots:
+            logger.info(f"Query #{req}: {payload}")
+            client = state["client"]
+            messages = [{"role": "system", "content": state["system_prompt"]}]
+            messages.extend(conversation_history)
+            messages.append({"role": "user", "content": payload})
+
+            if not client:
+                response = "Error: Groq API key not set or invalid."
+                logger.warning(response)
+                out.send(CH_LLM, 'E', req, response.encode('utf-8'))
+                return
+
+            # Query Groq with Retry Logic; a retry is only possible while
+            # nothing has been streamed yet.
+            max_retries = 3
+            for attempt in range(max_retries):
+                sent_any = False
+                try:
+                    stream = await client.chat.completions.create(  # type: ignore
+                        model=state["model"],
+                        messages=messages,
+                        temperature=state["temperature"],
+                        max_completion_tokens=state["max_tokens"],
+                        top_p=state["top_p"],
+                        stream=True,
+                    )
+                    response, sent_any = await stream_completion(out, req, stream)
+                    logger.info(f"Response #{req} (len {len(response)})")
+
+                    # Update conversation history, pruned to avoid context limits
+                    conversation_history.append({"role": "user", "content": payload})
+                    conversation_history.append({"role": "assistant", "content": response})
+                    if len(conversation_history) > MAX_HISTORY * 2:
+                        conversation_history = conversation_history[-(MAX_HISTORY * 2):]
+                    return
+
+                except Exception as e:
+                    logger.error(f"Error querying Groq (Attempt {attempt + 1}/{max_retries}): {e}")
+                    if attempt < max_retries - 1 and not sent_any:
+                        await asyncio.sleep(2 ** attempt)  # Exponential backoff
+                    else:
+                        msg = f" [API Error: {e}]" if sent_any else f"API Error: {e}"
+                        out.send(CH_LLM, 'E', req, msg.encode('utf-8'))
+                        return
+
+    def handle_ctrl(out: FrameWriter, op: str, req: int, payload: str):
+        nonlocal conversation_history
+        if op == 'K':  # Set API Key
+            logger.info("Received new API key configuration from OS")
+            state["client"] = AsyncGroq(api_key=payload)
+
+        elif op == 'M':  # Set Model
+            logger.info(f"Changing model to: {payload}")
+            state["model"] = payload
+
+        elif op == 'S':  # Set System Prompt
+            logger.info(f"Changing system prompt to: {payload}")
+            state["system_prompt"] = payload
+            conversation_history = []  # Reset history when system prompt changes
+
+        elif op == 'C':  # Clear History
+            logger.info("Clearing conversation history")
+            conversation_history = []
+
+        elif op == 'T':  # Set Temperature
+            try:
+                state["temperature"] = max(0.0, min(2.0, float(payload)))
+                logger.info(f"Temperature set to {state['temperature']}")
+            except ValueError:
+                logger.error(f"Invalid temperature received: {payload}")
+
+        elif op == 'O':  # Set Max Tokens
+            try:
+                state["max_tokens"] = max(1, int(payload))
+                logger.info(f"Max tokens set to {state['max_tokens']}")
+            except ValueError:
+                logger.error(f"Invalid max tokens received: {payload}")
+
+        elif op == 'P':  # Set Top P
+            try:
+                state["top_p"] = max(0.0, min(1.0, float(payload)))
+                logger.info(f"Top-P set to {state['top_p']}")
+            except ValueError:
+                logger.error(f"Invalid Top-P received: {payload}")
+
+        elif op == 'I':  # Get Bridge Info
+            logger.info("Responding to info request")
+            status_str = (f"Bridge Active | Model: {state['model']} | Temp: {state['temperature']} | "
+                          f"Top-P: {state['top_p']} | MaxTokens: {state['max_tokens']} | "
+                          f"Telemetry: {state['telemetry'] or 'none'}")
+            out.send(CH_CTRL, 'R', req, status_str.encode('utf-8'))
+
+        elif op == 'H':  # Heartbeat
+            out.send(CH_CTRL, 'P', req, b"OK")
+
+    def do_store(op: str, payload: str):
+        """Runs on the store worker; returns the reply (op, data) or None."""
+        if op == 'V':  # Host Save (V for "Volume Save"): filename|content
+            parts = payload.split('|', 1)
+            if len(parts) == 2:
+                filename, content = parts
+                # Prevent directory traversal
+                safe_name = os.path.basename(filename)
+                file_path = os.path.join(HOST_DATA_DIR, safe_name)
+                try:
+                    with open(file_path, 'w', encoding='utf-8') as f:
+                        f.write(content)
+                    logger.info(f"Host Save: {safe_name}")
+                except Exception as e:
+                    logger.error(f"Host Save Error: {e}")
+            return None
+
+        if op == 'L':  # Host Load: filename (responds with content)
+            safe_name = os.path.basename(payload)
+            file_path = os.path.join(HOST_DATA_DIR, safe_name)
+            try:
+                logger.info(f"Host Load: {safe_name}")
+                if not os.path.exists(file_path):
+                    return ('E', b"")  # Not found
+                with open(file_path, 'r', encoding='utf-8') as f:
+                    return ('R', f.read().encode('utf-8'))
+            except Exception as e:
+                logger.error(f"Host Load Error: {e}")
+                return ('E', b"")
+        return None
+
+    async def handle_store(out: FrameWriter, op: str, req: int, payload: str):
+        reply = await loop.run_in_executor(store_pool, do_store, op, payload)
+        if reply:
+            out.send(CH_STORE, reply[0], req, reply[1])
+
+    def handle_audit(lines: list[str]):
+        audit_path = os.path.join(HOST_DATA_DIR, "audit.log")
+        try:
+            with open(audit_path, 'a', encoding='utf-8') as f:
+                timestamp = time.strftime("[%Y-%m-%d %H:%M:%S]")
+                for line in lines:
+                    f.write(f"{timestamp} {line}\n")
+                    logger.info(f"Host Audit: {line}")
+        except Exception as e:
+            logger.error(f"Host Audit Error: {e}")
+
+    telem_path = os.path.join(HOST_DATA_DIR, "telemetry.csv")
+
+    def handle_telemetry(op: str, body: bytes):
+        if op == 'T':  # Legacy text snapshot
+            state["telemetry"] = body.decode('utf-8', errors='ignore')
+            return
+        if op != 'B':
+            return
+        try:
+            records = decode_telemetry_batch(body)
+        except (ValueError, IndexError) as e:
+            logger.error(f"Bad telemetry batch: {e}")
+            return
+        # Export every sample as a CSV row; keep the latest for 'I'
+        new_file = not os.path.exists(telem_path)
+        with open(telem_path, 'a', encoding='utf-8') as f:
+            if new_file:
+                f.write(",".join(TELEM_FIELDS) + "\n")
+            for rec in records:
+                f.write(",".join(str(v) for v in rec) + "\n")
+        if records:
+            last = dict(zip(TELEM_FIELDS, records[-1]))
+            state["telemetry"] = (f"heap={last['heap_kb']}KB pages={last['pmm_pages']} "
+                                  f"procs={last['procs']} frame={last['frame_ms']}ms")
+        logger.debug(f"Telemetry: {len(records)} samples ({len(body)} bytes)")
+
+    trace_path = os.path.join(HOST_DATA_DIR, "trace.json")
+
+    def handle_trace(op: str, body: bytes):
+        if op != 'X':
+            return
+        try:
+            events = decode_trace_batch(body)
+        except (ValueError, struct.error) as e:
+            logger.error(f"Bad trace batch: {e}")
+            return
+        # JSON array format; the viewers accept a missing closing ']',
+        # so batches are simply appended as they arrive.
+        new_file = not os.path.exists(trace_path)
+        with open(trace_path, 'a', encoding='utf-8') as f:
+            if new_file:
+                f.write("[\n")
+            for ev in events:
+                f.write(json.dumps(ev) + ",\n")
+        logger.debug(f"Trace: {len(events)} events ({len(body)} bytes)")
+
+    def dispatch(out: FrameWriter, chan: int, op: str, req: int, body: bytes):
+        payload = body.decode('utf-8', errors='ignore').strip()
+        if chan == CH_CTRL:
+            handle_ctrl(out, op, req, payload)
+        elif chan == CH_LLM and op == 'Q':
+            spawn(run_query(out, req, payload))
+        elif chan == CH_STORE:
+            spawn(handle_store(out, op, req, payload))
+        elif chan == CH_AUDIT and op == 'A':
+            handle_audit([payload])
+        elif chan == CH_AUDIT and op == 'B':
+            handle_audit([l for l in payload.split('\n') if l])
+        elif chan == CH_TELEM:
+            handle_telemetry(op, body)
+        elif chan == CH_TRACE:
+            handle_trace(op, body)
+        else:
+            logger.warning(f"Unknown frame chan={chan} op={op!r} req={req}")
+
+    async def serve(read, out: FrameWriter):
+        """Frame loop for one byte stream; read() returns b"" when idle, None at EOF.
+        Replies are written to `out`, i.e. back on the stream the request came on."""
+        reader = FrameReader()
+        partial: dict[tuple[int, int, str], bytes] = {}
+        while True:
+            chunk = await read()
+            if chunk is None:
+                return
+            if not chunk:
+                await asyncio.sleep(0.01)
+                continue
+            for chan, more, op, req, body in reader.feed(chunk):
+                # Reassemble fragmented messages per (channel, request)
+                key = (chan, req, op)
+                if more:
+                    partial[key] = partial.get(key, b"") + body
+                    continue
+                dispatch(out, chan, op, req, partial.pop(key, b"") + body)
+
+    async def serve_conn(sreader: asyncio.StreamReader, swriter: asyncio.StreamWriter):
+        addr = swriter.get_extra_info('peername') or ("?", 0)
+        peer = f"{addr[0]}:{addr[1]}"
+        sock = swriter.get_extra_info('socket')
+        if sock is not None:
+            sock.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        logger.info(f"TCP link from {peer}")
+
+        async def read():
+            return await sreader.read(4096) or None
+
+        try:
+            await serve(read, FrameWriter(swriter.write, swriter.drain))
+        except OSError as e:
+            logger.warning(f"TCP link {peer}: {e}")
+        finally:
+            swriter.close()
+        logger.info(f"TCP link from {peer} closed")
+
+    async def serve_serial():
+        logger.info(f"Listening on {pipe_in_path} (IN) / {pipe_out_path} (OUT)")
+        # Wait for pipes to exist (created by QEMU/VBox)
+        while not os.path.exists(pipe_in_path) or not os.path.exists(pipe_out_path):
+            logger.info("Waiting for pipes to be created by emulator...")
+            await asyncio.sleep(2)
+
+        # Pipe reads block, so they run on a thread of their own
+        read_pool = ThreadPoolExecutor(max_workers=1)
+        with open(pipe_in_path, 'rb', buffering=0) as pipe_in, \
+             open(pipe_out_path, 'wb', buffering=0) as pipe_out:
+            logger.info("Bridge connected. Waiting for frames from SwanOS...")
+
+            async def read():
+                return await loop.run_in_executor(read_pool, pipe_in.read, 1024)
+
+            def write(data: bytes):
+                pipe_out.write(data)
+                pipe_out.flush()
+
+            await serve(read, FrameWriter(write))
+
+    try:
+        jobs = []
+        if args.tcp is not None:
+            server = await asyncio.start_server(serve_conn, port=args.tcp)
+            logger.info(f"Listening for SwanOS on TCP port {args.tcp}")
+            jobs.append(server.serve_forever())
+        if pipe_in_path:
+            jobs.append(serve_serial())
+        await asyncio.gather(*jobs)
+    finally:
+        store_pool.shutdown(wait=False)
 
 if __name__ == "__main__":
     main()
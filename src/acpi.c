@@ -0,0 +1,139 @@
+/* ============================================================
+ * SwanOS — ACPI Table Discovery
+ * Locates the RSDP in the EBDA / BIOS ROM area, walks the RSDT
+ * and extracts processors, the I/O APIC and ISA interrupt
+ * overrides from the MADT ("APIC" table).
+ * ============================================================ */
+
+#include "acpi.h"
+#include "string.h"
+
+/* ── Table layouts ────────────────────────────────────────── */
+typedef struct {
+    char     sig[8];              /* "RSD PTR " */
+    uint8_t  checksum;
+    char     oem[6];
+    uint8_t  revision;
+    uint32_t rsdt;
+} __attribute__((packed)) rsdp_t;
+
+typedef struct {
+    char     sig[4];
+    uint32_t length;
+    uint8_t  revision;
+    uint8_t  checksum;
+    char     oem[6];
+    char     oem_table[8];
+    uint32_t oem_revision;
+    uint32_t creator_id;
+    uint32_t creator_revision;
+} __attribute__((packed)) sdt_header_t;
+
+typedef struct {
+    sdt_header_t hdr;
+    uint32_t lapic_addr;
+    uint32_t flags;               /* bit 0: PC-AT compatible 8259s */
+} __attribute__((packed)) madt_t;
+
+/* MADT entry types */
+#define MADT_LAPIC          0
+#define MADT_IOAPIC         1
+#define MADT_ISO            2
+#define MADT_LAPIC_OVERRIDE 5
+
+static acpi_madt_t madt_info;
+static int madt_ok = 0;
+
+static uint8_t checksum(const void *p, uint32_t len) {
+    const uint8_t *b = (const uint8_t *)p;
+    uint8_t sum = 0;
+    for (uint32_t i = 0; i < len; i++) sum += b[i];
+    return sum;
+}
+
+/* RSDP search: first KB of the EBDA, then the BIOS ROM, on 16-byte
+ * boundaries */
+static const rsdp_t *scan_rsdp(uint32_t start, uint32_t end) {
+    for (uint32_t a = start & ~15u; a + sizeof(rsdp_t) <= end; a += 16) {
+        const rsdp_t *r = (const rsdp_t *)a;
+        if (strncmp(r->sig, "RSD PTR ", 8) == 0 && checksum(r, sizeof(rsdp_t)) == 0) return r;
+    }
+    return 0;
+}
+
+static const rsdp_t *find_rsdp(void) {
+    uint32_t seg;   /* BDA word 0x40E: EBDA segment (asm: -Warray-bounds on page 0) */
+    __asm__ volatile("movzwl 0x40E, %0" : "=r"(seg));
+    uint32_t ebda = seg << 4;
+    const rsdp_t *r = 0;
+    if (ebda >= 0x80000 && ebda < 0xA0000) r = scan_rsdp(ebda, ebda + 1024);
+    if (!r) r = scan_rsdp(0xE0000, 0x100000);
+    return r;
+}
+
+static const sdt_header_t *find_table(const rsdp_t *rsdp, const char *sig) {
+    const sdt_header_t *rsdt = (const sdt_header_t *)rsdp->rsdt;
+    if (!rsdt || strncmp(rsdt->sig, "RSDT", 4) != 0 || checksum(rsdt, rsdt->length)) return 0;
+
+    uint32_t n = (rsdt->length - sizeof(sdt_header_t)) / 4;
+    const uint32_t *ptrs = (const uint32_t *)(rsdt + 1);
+    for (uint32_t i = 0; i < n; i++) {
+        const sdt_header_t *t = (const sdt_header_t *)ptrs[i];
+        if (t && strncmp(t->sig, sig, 4) == 0 && checksum(t, t->length) == 0) return t;
+    }
+    return 0;
+}
+
+static void parse_madt(const madt_t *m) {
+    acpi_madt_t *info = &madt_info;
+    info->lapic_addr = m->lapic_addr;
+    info->pcat_compat = m->flags & 1;
+
+    const uint8_t *p = (const uint8_t *)(m + 1);
+    const uint8_t *end = (const uint8_t *)m + m->hdr.length;
+    while (p + 2 <= end && p[1] >= 2 && p + p[1] <= end) {
+        switch (p[0]) {
+        case MADT_LAPIC:                        /* acpi id, apic id, flags */
+            if ((*(const uint32_t *)(p + 4) & 1) && info->ncpus < ACPI_MAX_CPUS)
+                info->cpu_apic_id[info->ncpus++] = p[3];
+            break;
+        case MADT_IOAPIC:                       /* id, -, address, gsi base */
+            if (!info->ioapic_addr) {
+                info->ioapic_id = p[2];
+                info->ioapic_addr = *(const uint32_t *)(p + 4);
+                info->ioapic_gsi_base = *(const uint32_t *)(p + 8);
+            }
+            break;
+        case MADT_ISO:                          /* bus, irq, gsi, flags */
+            if (p[3] < 16) {
+                info->irq_gsi[p[3]] = *(const uint32_t *)(p + 4);
+                info->irq_flags[p[3]] = *(const uint16_t *)(p + 8);
+            }
+            break;
+        case MADT_LAPIC_OVERRIDE:               /* -, 64-bit address */
+            if (!*(const uint32_t *)(p + 8))
+                info->lapic_addr = *(const uint32_t *)(p + 4);
+            break;
+        }
+        p += p[1];
+    }
+}
+
+int acpi_init(void) {
+    memset(&madt_info, 0, sizeof(madt_info));
+    for (int i = 0; i < 16; i++) madt_info.irq_gsi[i] = i;
+    madt_ok = 0;
+
+    const rsdp_t *rsdp = find_rsdp();
+    if (!rsdp) return -1;
+    const madt_t *m = (const madt_t *)find_table(rsdp, "APIC");
+    if (!m) return -1;
+
+    parse_madt(m);
+    madt_ok = madt_info.ncpus > 0 && madt_info.lapic_addr != 0;
+    return madt_ok ? 0 : -1;
+}
+
+const acpi_madt_t *acpi_madt(void) {
+    return madt_ok ? &madt_info : 0;
+}
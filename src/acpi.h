@@ -0,0 +1,33 @@
+#ifndef ACPI_H
+#define ACPI_H
+
+#include <stdint.h>
+
+/* ── MADT summary ─────────────────────────────────────────────
+ * What SMP and APIC setup need from the ACPI Multiple APIC
+ * Description Table, copied out once at boot.                 */
+#define ACPI_MAX_CPUS  16
+
+/* MPS INTI flags on an interrupt source override */
+#define ACPI_IRQ_ACTIVE_LOW  0x0002
+#define ACPI_IRQ_LEVEL       0x0008
+
+typedef struct {
+    uint32_t lapic_addr;
+    int      ncpus;                       /* enabled processors */
+    uint8_t  cpu_apic_id[ACPI_MAX_CPUS];
+    uint32_t ioapic_addr;                 /* first I/O APIC; 0 = none */
+    uint8_t  ioapic_id;
+    uint32_t ioapic_gsi_base;
+    uint32_t irq_gsi[16];                 /* ISA IRQ -> GSI (identity unless overridden) */
+    uint16_t irq_flags[16];               /* ACPI_IRQ_* */
+    uint8_t  pcat_compat;                 /* 8259 pair present */
+} acpi_madt_t;
+
+/* Find the RSDP in the BIOS areas and parse the MADT. Run before
+ * paging_init: tables are read through physical addresses.
+ * Returns 0, or -1 when there is no usable MADT. */
+int acpi_init(void);
+const acpi_madt_t *acpi_madt(void);   /* 0 if acpi_init failed */
+
+#endif
@@ -0,0 +1,190 @@
+/* ============================================================
+ * SwanOS — Local APIC and I/O APIC
+ * Register access for the per-CPU local APIC (EOI, IPIs, timer) and
+ * the I/O APIC redirection table. Addresses come from the ACPI MADT.
+ * ============================================================ */
+
+#include "apic.h"
+#include "acpi.h"
+#include "paging.h"
+#include "cpu.h"
+#include "timer.h"
+
+#define MSR_APIC_BASE      0x01B
+#define APIC_BASE_ENABLE   (1u << 11)
+
+/* Local APIC registers (byte offsets) */
+#define LAPIC_ID        0x020
+#define LAPIC_TPR       0x080
+#define LAPIC_EOI       0x0B0
+#define LAPIC_SVR       0x0F0
+#define LAPIC_ESR       0x280
+#define LAPIC_ICR_LO    0x300
+#define LAPIC_ICR_HI    0x310
+#define LAPIC_LVT_TIMER 0x320
+#define LAPIC_LVT_LINT0 0x350
+#define LAPIC_LVT_ERROR 0x370
+#define LAPIC_TIMER_INIT 0x380
+#define LAPIC_TIMER_CUR 0x390
+#define LAPIC_TIMER_DIV 0x3E0
+#define LVT_MASKED      (1u << 16)
+#define LVT_PERIODIC    (1u << 17)
+#define TIMER_DIV_16    0x3
+#define TIMER_CAL_TICKS 4          /* PIT ticks counted against */
+#define SVR_ENABLE      (1u << 8)
+
+/* I/O APIC: index/data window */
+#define IOAPIC_REGSEL   0x00
+#define IOAPIC_WIN      0x10
+#define IOAPIC_VER      0x01
+#define IOAPIC_REDTBL   0x10       /* entry n: 0x10 + 2n (low), +1 (high) */
+
+static volatile uint32_t *lapic = 0;
+static volatile uint32_t *ioapic = 0;
+static int ioapic_npins = 0;
+static uint32_t timer_count = 0;   /* LAPIC timer counts per PIT tick */
+
+/* ── Register access ──────────────────────────────────────── */
+
+static inline uint32_t lapic_read(uint32_t reg) {
+    return lapic[reg / 4];
+}
+
+static inline void lapic_write(uint32_t reg, uint32_t val) {
+    lapic[reg / 4] = val;
+    (void)lapic[LAPIC_ID / 4];    /* posted write: read back */
+}
+
+static uint32_t ioapic_read(uint32_t reg) {
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    return ioapic[IOAPIC_WIN / 4];
+}
+
+static void ioapic_write(uint32_t reg, uint32_t val) {
+    ioapic[IOAPIC_REGSEL / 4] = reg;
+    ioapic[IOAPIC_WIN / 4] = val;
+}
+
+/* ── Local APIC ───────────────────────────────────────────── */
+
+static void lapic_enable(void) {
+    uint64_t base = rdmsr(MSR_APIC_BASE);
+    if (!(base & APIC_BASE_ENABLE)) wrmsr(MSR_APIC_BASE, base | APIC_BASE_ENABLE);
+
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_ESR, 0);
+    lapic_write(LAPIC_LVT_ERROR, LVT_MASKED);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+    lapic_write(LAPIC_TPR, 0);
+    lapic_write(LAPIC_SVR, SVR_ENABLE | LAPIC_SPURIOUS_VECTOR);
+}
+
+void lapic_init(void) {
+    if (!lapic) return;
+    lapic_enable();
+    /* Only the BSP takes the 8259's ExtINT through LINT0 */
+    lapic_write(LAPIC_LVT_LINT0, LVT_MASKED);
+}
+
+uint8_t lapic_id(void) {
+    return lapic ? (uint8_t)(lapic_read(LAPIC_ID) >> 24) : 0;
+}
+
+void lapic_eoi(void) {
+    if (lapic) lapic_write(LAPIC_EOI, 0);
+}
+
+void lapic_send_ipi(uint8_t apic_id, uint32_t icr) {
+    if (!lapic) return;
+    uint32_t flags = irq_save();
+    while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING) __asm__ volatile("pause");
+    lapic_write(LAPIC_ICR_HI, (uint32_t)apic_id << 24);
+    lapic_write(LAPIC_ICR_LO, icr);      /* this write sends it */
+    while (lapic_read(LAPIC_ICR_LO) & ICR_PENDING) __asm__ volatile("pause");
+    irq_restore(flags);
+}
+
+/* Every local APIC runs off the same bus clock, so the BSP measures it
+ * once against the PIT and each AP programs the same period */
+void lapic_timer_calibrate(void) {
+    if (!lapic) return;
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_MASKED);
+    uint32_t t = timer_get_ticks();
+    while (timer_get_ticks() == t) __asm__ volatile("pause");   /* start on a tick */
+    lapic_write(LAPIC_TIMER_INIT, 0xFFFFFFFF);
+    t = timer_get_ticks();
+    while (timer_get_ticks() - t < TIMER_CAL_TICKS) __asm__ volatile("pause");
+    uint32_t used = 0xFFFFFFFF - lapic_read(LAPIC_TIMER_CUR);
+    lapic_write(LAPIC_TIMER_INIT, 0);
+    timer_count = used / TIMER_CAL_TICKS;
+}
+
+void lapic_timer_start(uint8_t vector) {
+    if (!lapic || !timer_count) return;
+    lapic_write(LAPIC_TIMER_DIV, TIMER_DIV_16);
+    lapic_write(LAPIC_LVT_TIMER, LVT_PERIODIC | vector);
+    lapic_write(LAPIC_TIMER_INIT, timer_count);
+}
+
+/* ── I/O APIC ─────────────────────────────────────────────── */
+
+int ioapic_pins(void) {
+    return ioapic_npins;
+}
+
+static int irq_pin(const acpi_madt_t *m, uint8_t irq) {
+    if (!ioapic || irq >= 16) return -1;
+    int pin = (int)(m->irq_gsi[irq] - m->ioapic_gsi_base);
+    return (pin >= 0 && pin < ioapic_npins) ? pin : -1;
+}
+
+int ioapic_route_irq(uint8_t irq, uint8_t vector, uint8_t apic_id) {
+    const acpi_madt_t *m = acpi_madt();
+    int pin = m ? irq_pin(m, irq) : -1;
+    if (pin < 0) return -1;
+
+    /* ISA lines are edge / active high unless the MADT says otherwise */
+    uint32_t lo = vector;
+    if (m->irq_flags[irq] & ACPI_IRQ_ACTIVE_LOW) lo |= 1u << 13;
+    if (m->irq_flags[irq] & ACPI_IRQ_LEVEL)      lo |= 1u << 15;
+
+    uint32_t flags = irq_save();
+    ioapic_write(IOAPIC_REDTBL + 2 * pin + 1, (uint32_t)apic_id << 24);
+    ioapic_write(IOAPIC_REDTBL + 2 * pin, lo);
+    irq_restore(flags);
+    return 0;
+}
+
+void ioapic_mask_irq(uint8_t irq) {
+    const acpi_madt_t *m = acpi_madt();
+    int pin = m ? irq_pin(m, irq) : -1;
+    if (pin < 0) return;
+    uint32_t flags = irq_save();
+    ioapic_write(IOAPIC_REDTBL + 2 * pin, LVT_MASKED);
+    irq_restore(flags);
+}
+
+/* ── Setup ────────────────────────────────────────────────── */
+
+int apic_present(void) {
+    return lapic != 0;
+}
+
+int apic_init(void) {
+    const acpi_madt_t *m = acpi_madt();
+    if (!m || !(cpuid_edx(1) & CPUID_EDX_APIC)) return -1;
+
+    paging_map_mmio(m->lapic_addr, 4096);
+    lapic = (volatile uint32_t *)m->lapic_addr;
+    lapic_enable();
+
+    if (m->ioapic_addr) {
+        paging_map_mmio(m->ioapic_addr, 4096);
+        ioapic = (volatile uint32_t *)m->ioapic_addr;
+        ioapic_npins = (int)((ioapic_read(IOAPIC_VER) >> 16) & 0xFF) + 1;
+        for (int i = 0; i < ioapic_npins; i++)
+            ioapic_write(IOAPIC_REDTBL + 2 * i, LVT_MASKED);
+    }
+    return 0;
+}
@@ -0,0 +1,40 @@
+#ifndef APIC_H
+#define APIC_H
+
+#include <stdint.h>
+
+#define LAPIC_SPURIOUS_VECTOR 0xFF
+
+/* ICR delivery modes and flags (low dword) */
+#define ICR_FIXED         0x00000
+#define ICR_INIT          0x00500
+#define ICR_STARTUP       0x00600
+#define ICR_PENDING       0x01000   /* delivery status */
+#define ICR_ASSERT        0x04000
+#define ICR_LEVEL         0x08000
+
+/* Map the local and I/O APIC registers (uncached), enable the BSP's
+ * local APIC and mask every I/O APIC pin. Legacy IRQs stay on the
+ * 8259 in virtual-wire mode. Returns 0, or -1 without an APIC. */
+int     apic_init(void);
+int     apic_present(void);
+
+/* ── Local APIC (per CPU) ─────────────────────────────────── */
+void    lapic_init(void);              /* each AP, once, on itself */
+uint8_t lapic_id(void);
+void    lapic_eoi(void);
+/* Send an IPI: icr = vector | ICR_* mode bits */
+void    lapic_send_ipi(uint8_t apic_id, uint32_t icr);
+/* Periodic timer at the PIT's tick rate: calibrate once on the BSP
+ * (timer running, IRQs on), then start it on each CPU that wants it */
+void    lapic_timer_calibrate(void);
+void    lapic_timer_start(uint8_t vector);
+
+/* ── I/O APIC ─────────────────────────────────────────────── */
+int     ioapic_pins(void);             /* redirection entries (0 = none) */
+/* Deliver ISA `irq` (through any MADT override) as `vector` on the
+ * CPU with `apic_id`; the line is unmasked. Returns -1 if no pin. */
+int     ioapic_route_irq(uint8_t irq, uint8_t vector, uint8_t apic_id);
+void    ioapic_mask_irq(uint8_t irq);
+
+#endif
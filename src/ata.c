@@ -0,0 +1,134 @@
+/* ============================================================
+ * SwanOS — ATA PIO Disk Driver
+ * Primary master only, LBA28, polled. Enough to back the
+ * persistent filesystem on QEMU/VirtualBox IDE disks; the fs
+ * sync worker is the only caller once the scheduler runs.
+ * ============================================================ */
+
+#include "ata.h"
+#include "ports.h"
+
+#define ATA_BASE      0x1F0
+#define ATA_DATA      (ATA_BASE + 0)
+#define ATA_ERROR     (ATA_BASE + 1)
+#define ATA_COUNT     (ATA_BASE + 2)
+#define ATA_LBA0      (ATA_BASE + 3)
+#define ATA_LBA1      (ATA_BASE + 4)
+#define ATA_LBA2      (ATA_BASE + 5)
+#define ATA_DRIVE     (ATA_BASE + 6)
+#define ATA_STATUS    (ATA_BASE + 7)   /* read */
+#define ATA_CMD       (ATA_BASE + 7)   /* write */
+#define ATA_CTRL      0x3F6
+
+#define ST_ERR   0x01
+#define ST_DRQ   0x08
+#define ST_DF    0x20
+#define ST_BSY   0x80
+
+#define CMD_READ      0x20
+#define CMD_WRITE     0x30
+#define CMD_FLUSH     0xE7
+#define CMD_IDENTIFY  0xEC
+
+#define SPIN_LIMIT    1000000
+
+static int      present = 0;
+static uint32_t sectors = 0;
+
+/* 400 ns settle: four reads of the alternate status port */
+static void ata_delay(void) {
+    for (int i = 0; i < 4; i++) inb(ATA_CTRL);
+}
+
+static int wait_not_busy(void) {
+    for (int i = 0; i < SPIN_LIMIT; i++)
+        if (!(inb(ATA_STATUS) & ST_BSY)) return 0;
+    return -1;
+}
+
+/* Wait for the next sector's data window */
+static int wait_drq(void) {
+    for (int i = 0; i < SPIN_LIMIT; i++) {
+        uint8_t st = inb(ATA_STATUS);
+        if (st & ST_BSY) continue;
+        if (st & (ST_ERR | ST_DF)) return -1;
+        if (st & ST_DRQ) return 0;
+    }
+    return -1;
+}
+
+int ata_init(void) {
+    present = 0;
+    sectors = 0;
+
+    outb(ATA_CTRL, 0x02);                 /* nIEN: we poll */
+    if (inb(ATA_STATUS) == 0xFF) return 0; /* floating bus, no controller */
+
+    outb(ATA_DRIVE, 0xA0);
+    ata_delay();
+    outb(ATA_COUNT, 0);
+    outb(ATA_LBA0, 0);
+    outb(ATA_LBA1, 0);
+    outb(ATA_LBA2, 0);
+    outb(ATA_CMD, CMD_IDENTIFY);
+    if (inb(ATA_STATUS) == 0) return 0;   /* no drive */
+    if (wait_not_busy() < 0) return 0;
+    if (inb(ATA_LBA1) || inb(ATA_LBA2)) return 0;   /* ATAPI/SATA signature */
+    if (wait_drq() < 0) return 0;
+
+    uint16_t id[256];
+    for (int i = 0; i < 256; i++) id[i] = inw(ATA_DATA);
+    sectors = id[60] | ((uint32_t)id[61] << 16);   /* LBA28 capacity */
+    present = sectors != 0;
+    return present;
+}
+
+int ata_present(void) {
+    return present;
+}
+
+uint32_t ata_sectors(void) {
+    return sectors;
+}
+
+static int issue(uint8_t cmd, uint32_t lba, uint32_t count) {
+    if (!present || count == 0 || count > 256 || lba + count > sectors) return -1;
+    if (wait_not_busy() < 0) return -1;
+    outb(ATA_DRIVE, 0xE0 | ((lba >> 24) & 0x0F));
+    ata_delay();
+    outb(ATA_COUNT, (uint8_t)count);      /* 256 is encoded as 0 */
+    outb(ATA_LBA0, (uint8_t)lba);
+    outb(ATA_LBA1, (uint8_t)(lba >> 8));
+    outb(ATA_LBA2, (uint8_t)(lba >> 16));
+    outb(ATA_CMD, cmd);
+    return 0;
+}
+
+int ata_read(uint32_t lba, uint32_t count, void *buf) {
+    if (issue(CMD_READ, lba, count) < 0) return -1;
+    uint16_t *p = (uint16_t *)buf;
+    for (uint32_t s = 0; s < count; s++) {
+        if (wait_drq() < 0) return -1;
+        for (int i = 0; i < ATA_SECTOR / 2; i++) *p++ = inw(ATA_DATA);
+    }
+    return 0;
+}
+
+int ata_write(uint32_t lba, uint32_t count, const void *buf) {
+    if (issue(CMD_WRITE, lba, count) < 0) return -1;
+    const uint16_t *p = (const uint16_t *)buf;
+    for (uint32_t s = 0; s < count; s++) {
+        if (wait_drq() < 0) return -1;
+        for (int i = 0; i < ATA_SECTOR / 2; i++) outw(ATA_DATA, *p++);
+    }
+    return wait_not_busy();
+}
+
+int ata_flush(void) {
+    if (!present || wait_not_busy() < 0) return -1;
+    outb(ATA_DRIVE, 0xE0);
+    outb(ATA_CMD, CMD_FLUSH);
+    ata_delay();
+    if (wait_not_busy() < 0) return -1;
+    return (inb(ATA_STATUS) & (ST_ERR | ST_DF)) ? -1 : 0;
+}
@@ -0,0 +1,21 @@
+#ifndef ATA_H
+#define ATA_H
+
+#include <stdint.h>
+
+/* ── ATA PIO (primary channel, master drive, LBA28) ──────────
+ * Polled transfers with the drive's interrupt masked (nIEN), so
+ * callers must run in task context. On QEMU the boot ISO sits on
+ * the secondary channel; the disk image is `-drive ... if=ide`. */
+#define ATA_SECTOR 512
+
+int      ata_init(void);                 /* 1 if a disk answered IDENTIFY */
+int      ata_present(void);
+uint32_t ata_sectors(void);              /* capacity in sectors */
+
+/* Transfer count sectors (1..256). Return 0, or -1 on error/timeout. */
+int  ata_read(uint32_t lba, uint32_t count, void *buf);
+int  ata_write(uint32_t lba, uint32_t count, const void *buf);
+int  ata_flush(void);                    /* drain the drive's write cache */
+
+#endif
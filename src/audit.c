@@ -1,26 +1,60 @@
 /* ============================================================
  * SwanOS — Audit System
  * Structured event logging with ring buffer and host persistence.
- * Tracks logins, file ops, app launches, commands, etc.
+ * Tracks logins, file ops, app launches, commands, etc. Entries are
+ * stamped from the monotonic clock and persisted by a deferred,
+ * batched flush so callers never wait on the serial line.
  * ============================================================ */
 
 #include "audit.h"
 #include "string.h"
 #include "user.h"
 #include "rtc.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "timer.h"
 #include "llm.h"
+#include "serial.h"
+#include "bridge.h"
+#include "process.h"
+#include "wait.h"
 
+/* Guards the ring; irqsave so any context may log */
+static spinlock_t audit_lock = SPINLOCK_INIT;
 static audit_entry_t entries[AUDIT_MAX_ENTRIES];
 static int entry_head = 0;   /* next write position */
 static int entry_count = 0;  /* total entries written (can exceed buffer) */
+static int entry_sent = 0;   /* entries shipped to the host */
+static uint32_t dropped = 0;
+
+/* Formatting a batch and pushing it down the bridge takes a while,
+ * so it runs in a task, never from the timer IRQ */
+static wait_queue_t flush_wait;
+
+static void flush_main(void) {
+    while (1) {
+        audit_flush();
+        uint32_t flags = irq_save();
+        sleep_on_timeout(&flush_wait, AUDIT_FLUSH_TICKS);
+        irq_restore(flags);
+    }
+}
 
 void audit_init(void) {
     memset(entries, 0, sizeof(entries));
     entry_head = 0;
-    entry_count = 0;
+    entry_count = entry_sent = 0;
+    dropped = 0;
+    process_create_named(flush_main, 0, "audit", PRIORITY_LOW);
 }
 
+/* ── Logging ──────────────────────────────────────────────── */
+
 void audit_log(int type, const char *detail) {
+    uint32_t ms = timer_get_ms();
+    rtc_time_t t;
+    time_now(&t);
+    uint32_t flags = spin_lock_irqsave(&audit_lock);
     audit_entry_t *e = &entries[entry_head];
 
     e->type = (uint8_t)type;
@@ -39,28 +73,78 @@ void audit_log(int type, const char *detail) {
         e->detail[0] = '\0';
     }
 
-    /* Timestamp from RTC */
-    rtc_time_t t;
-    rtc_read(&t);
+    e->ms = ms;
     e->hour   = t.hour;
     e->minute = t.minute;
     e->second = t.second;
     e->day    = t.day;
     e->month  = t.month;
 
-    /* Advance ring buffer */
+    /* Advance ring buffer; the flush picks the entry up later */
     entry_head = (entry_head + 1) % AUDIT_MAX_ENTRIES;
     entry_count++;
+    if (entry_count - entry_sent > AUDIT_MAX_ENTRIES) {
+        dropped += (uint32_t)(entry_count - entry_sent - AUDIT_MAX_ENTRIES);
+        entry_sent = entry_count - AUDIT_MAX_ENTRIES;
+    }
+    spin_unlock_irqrestore(&audit_lock, flags);
+}
+
+/* ── Host persistence ─────────────────────────────────────── */
+
+#define AUDIT_BATCH_MAX 2048    /* bytes of "[TYPE] user: detail\n" lines */
+#define AUDIT_TX_MAX    4096    /* leave the bridge link to others above this */
+
+static char batch[AUDIT_BATCH_MAX];
+static volatile int flushing = 0;
+
+int audit_flush(void) {
+    uint32_t flags = irq_save();
+    if (flushing) { irq_restore(flags); return 0; }
+    flushing = 1;
+    irq_restore(flags);
+
+    int shipped = 0;
+    while (bridge_tx_pending() <= AUDIT_TX_MAX) {
+        int len = 0, n = 0;
+        flags = spin_lock_irqsave(&audit_lock);
+        while (entry_sent + n < entry_count) {
+            const audit_entry_t *e = &entries[(entry_sent + n) % AUDIT_MAX_ENTRIES];
+            const char *type = audit_type_name(e->type);
+            int need = strlen(type) + strlen(e->user) + strlen(e->detail) + 6;
+            if (len + need > AUDIT_BATCH_MAX) break;
+            batch[len++] = '[';
+            strcpy(batch + len, type);      len += strlen(type);
+            batch[len++] = ']';
+            batch[len++] = ' ';
+            strcpy(batch + len, e->user);   len += strlen(e->user);
+            batch[len++] = ':';
+            batch[len++] = ' ';
+            strcpy(batch + len, e->detail); len += strlen(e->detail);
+            batch[len++] = '\n';
+            n++;
+        }
+        entry_sent += n;
+        spin_unlock_irqrestore(&audit_lock, flags);
 
-    /* Persist to host bridge */
-    char audit_msg[128];
-    strcpy(audit_msg, "[");
-    strcat(audit_msg, audit_type_name(type));
-    strcat(audit_msg, "] ");
-    strcat(audit_msg, e->user);
-    strcat(audit_msg, ": ");
-    if (detail) strcat(audit_msg, detail);
-    llm_host_audit(audit_msg);
+        if (!n) break;
+        llm_host_audit_batch(batch, len);
+        shipped += n;
+    }
+    flushing = 0;
+    return shipped;
+}
+
+void audit_drain(void) {
+    do serial_flush(); while (audit_flush() > 0);
+}
+
+int audit_pending(void) {
+    return entry_count - entry_sent;
+}
+
+uint32_t audit_dropped(void) {
+    return dropped;
 }
 
 int audit_get_count(void) {
@@ -100,65 +184,38 @@ const char *audit_type_name(int type) {
 
 int audit_format_recent(char *buf, int buf_len, int count) {
     buf[0] = '\0';
+    uint32_t flags = spin_lock_irqsave(&audit_lock);
     int total = entry_count;
     if (total > AUDIT_MAX_ENTRIES) total = AUDIT_MAX_ENTRIES;
     if (count > total) count = total;
     if (count <= 0) {
+        spin_unlock_irqrestore(&audit_lock, flags);
         strcpy(buf, "  No audit events recorded.\n");
         return 0;
     }
 
     int start_idx = total - count;
     int written = 0;
+    sbuf_t sb;
+    sbuf_init(&sb, buf, buf_len);
 
-    for (int i = start_idx; i < total && (int)strlen(buf) < buf_len - 100; i++) {
+    for (int i = start_idx; i < total && sb.len < buf_len - 100; i++) {
         const audit_entry_t *e = audit_get_entry(i);
         if (!e || !e->used) continue;
 
-        /* Format: [HH:MM:SS] TYPE user: detail */
+        /* Format: [HH:MM:SS] TYPE user: detail (detail cut to 30) */
         char line[128];
-        char tmp[8];
-
-        strcpy(line, "  [");
-        itoa(e->hour, tmp, 10);
-        if (e->hour < 10) strcat(line, "0");
-        strcat(line, tmp);
-        strcat(line, ":");
-        itoa(e->minute, tmp, 10);
-        if (e->minute < 10) strcat(line, "0");
-        strcat(line, tmp);
-        strcat(line, ":");
-        itoa(e->second, tmp, 10);
-        if (e->second < 10) strcat(line, "0");
-        strcat(line, tmp);
-        strcat(line, "] ");
-
-        strcat(line, audit_type_name(e->type));
-        strcat(line, " ");
-        strcat(line, e->user);
-        if (e->detail[0]) {
-            strcat(line, ": ");
-            /* Truncate detail for display */
-            int dlen = strlen(e->detail);
-            if (dlen > 30) {
-                char trunc[34];
-                strncpy(trunc, e->detail, 30);
-                trunc[30] = '.';
-                trunc[31] = '.';
-                trunc[32] = '.';
-                trunc[33] = '\0';
-                strcat(line, trunc);
-            } else {
-                strcat(line, e->detail);
-            }
-        }
-        strcat(line, "\n");
-
-        if ((int)(strlen(buf) + strlen(line)) < buf_len - 1) {
-            strcat(buf, line);
+        int dlen = strlen(e->detail);
+        int n = ksnprintf(line, sizeof(line), "  [%02d:%02d:%02d] %s %s%s%.30s%s\n",
+                          e->hour, e->minute, e->second,
+                          audit_type_name(e->type), e->user,
+                          dlen ? ": " : "", e->detail, dlen > 30 ? "..." : "");
+        if (n <= sbuf_room(&sb)) {
+            sbuf_append_n(&sb, line, n);
             written++;
         }
     }
+    spin_unlock_irqrestore(&audit_lock, flags);
 
     return written;
 }
@@ -14,12 +14,15 @@
 #define AUDIT_FILE_WRITE   7
 #define AUDIT_SYSTEM       8
 
-#define AUDIT_MAX_ENTRIES  64
+#define AUDIT_MAX_ENTRIES  256
 #define AUDIT_DETAIL_LEN   48
 #define AUDIT_USER_LEN     16
 
 /* ── Audit Entry ─────────────────────────────────────────── */
+/* Stamped from the cached wall clock (time_now), so logging never
+ * touches CMOS. */
 typedef struct {
+    uint32_t ms;                /* timer_get_ms() when logged */
     uint8_t  type;
     char     user[AUDIT_USER_LEN];
     char     detail[AUDIT_DETAIL_LEN];
@@ -32,8 +35,18 @@ typedef struct {
 } audit_entry_t;
 
 /* ── API ─────────────────────────────────────────────────── */
+/* Entries reach the host in batches: the "audit" worker ships
+ * whatever was logged since the last flush every AUDIT_FLUSH_TICKS,
+ * backing off while the serial ring is busy. audit_log itself does
+ * no I/O. */
+#define AUDIT_FLUSH_TICKS  50
+
 void audit_init(void);
 void audit_log(int type, const char *detail);
+int  audit_flush(void);         /* ship pending entries now; returns count */
+void audit_drain(void);         /* before power-off: ship all, wait for the UART */
+int  audit_pending(void);       /* logged but not yet sent */
+uint32_t audit_dropped(void);   /* overwritten before they were sent */
 int  audit_get_count(void);
 const audit_entry_t *audit_get_entry(int index);
 int  audit_format_recent(char *buf, int buf_len, int count);
@@ -0,0 +1,186 @@
+/* ============================================================
+ * SwanOS — Boot Microbenchmarks
+ * TSC-timed loops over the hot paths (allocators, filesystem
+ * lookup, context switch, framebuffer and UI drawing), printed
+ * over serial for `make bench` to collect.
+ * ============================================================ */
+
+#include "bench.h"
+#include "cpu.h"
+#include "ports.h"
+#include "serial.h"
+#include "string.h"
+#include "timer.h"
+#include "memory.h"
+#include "fs.h"
+#include "process.h"
+#include "wait.h"
+#include "syscall.h"
+#include "vga_gfx.h"
+#include "ui_theme.h"
+
+/* ── Reporting ────────────────────────────────────────────── */
+
+/* Cycles of one batch of `ops` operations; clamped to 32 bits so no
+ * 64-bit division is needed (a batch stays far below 2^32 cycles) */
+static uint32_t batch_cycles(uint64_t t0) {
+    uint64_t d = rdtsc() - t0;
+    return d > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)d;
+}
+
+static void report(const char *name, uint32_t ops, uint32_t *per_op) {
+    /* Insertion sort of BENCH_REPS samples */
+    for (int i = 1; i < BENCH_REPS; i++) {
+        uint32_t v = per_op[i];
+        int j = i;
+        for (; j > 0 && per_op[j - 1] > v; j--) per_op[j] = per_op[j - 1];
+        per_op[j] = v;
+    }
+    uint32_t med = per_op[BENCH_REPS / 2];
+    uint32_t per_us = timer_cycles_per_us();
+    if (!per_us) per_us = 1;
+
+    char line[160];
+    ksnprintf(line, sizeof(line), "BENCH name=%s ops=%u reps=%d min=%u med=%u ns=%u\n",
+              name, ops, BENCH_REPS, per_op[0], med,
+              med / per_us * 1000 + med % per_us * 1000 / per_us);
+    serial_puts(line);
+}
+
+/* ── Benchmarks ───────────────────────────────────────────── */
+/* Each fills per_op[BENCH_REPS] with cycles per operation;
+   setup and teardown stay outside the timed region. */
+
+#define PMM_OPS 256
+static void *pages[PMM_OPS];
+
+static void bench_pmm(uint32_t *per_op) {
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < PMM_OPS; i++) pages[i] = pmm_alloc_page();
+        per_op[r] = batch_cycles(t0) / PMM_OPS;
+        for (int i = 0; i < PMM_OPS; i++) if (pages[i]) pmm_free_page(pages[i]);
+    }
+}
+
+#define KMALLOC_OPS 256
+static void *blocks[KMALLOC_OPS];
+
+static void bench_kmalloc(uint32_t *per_op) {
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < KMALLOC_OPS; i++) blocks[i] = kmalloc(64);
+        per_op[r] = batch_cycles(t0) / KMALLOC_OPS;
+        for (int i = 0; i < KMALLOC_OPS; i++) kfree(blocks[i]);
+    }
+}
+
+/* find_node is internal to fs.c; fs_exists is a bare lookup */
+#define FS_OPS 1024
+#define FS_PATH "/bench/a/b/c/leaf.txt"
+
+static void bench_find_node(uint32_t *per_op) {
+    fs_mkdir("/bench");
+    fs_mkdir("/bench/a");
+    fs_mkdir("/bench/a/b");
+    fs_mkdir("/bench/a/b/c");
+    fs_write(FS_PATH, "x");
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < FS_OPS; i++) fs_exists(FS_PATH);
+        per_op[r] = batch_cycles(t0) / FS_OPS;
+    }
+    fs_delete(FS_PATH);
+}
+
+/* A partner task yields straight back, so each sys_yield here is
+   two trips through switch_context */
+#define SWITCH_OPS 512
+static volatile int partner_run;
+
+static void yield_partner(void) {
+    while (partner_run) sys_yield();
+    for (;;) process_sleep_ms(1000);
+}
+
+static void bench_switch(uint32_t *per_op) {
+    partner_run = 1;
+    process_create_named(yield_partner, 0, "bench-yield", PRIORITY_NORMAL);
+    sys_yield();                    /* let it start */
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < SWITCH_OPS; i++) sys_yield();
+        per_op[r] = batch_cycles(t0) / (SWITCH_OPS * 2);
+    }
+    partner_run = 0;
+}
+
+#define FLIP_OPS 8
+static void bench_flip(uint32_t *per_op) {
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < FLIP_OPS; i++) vga_flip();
+        per_op[r] = batch_cycles(t0) / FLIP_OPS;
+    }
+}
+
+#define ALPHA_OPS 64
+static void bench_fill_alpha(uint32_t *per_op) {
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < ALPHA_OPS; i++) vga_bb_fill_rect_alpha(64, 64, 256, 256, 0x80336699);
+        per_op[r] = batch_cycles(t0) / ALPHA_OPS;
+    }
+}
+
+/* One 64-character line through the backbuffer font path */
+#define TEXT_OPS 64
+static void bench_text(uint32_t *per_op) {
+    static const char line[] = "The quick brown swan jumps over the lazy kernel 0123456789 !?#%";
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < TEXT_OPS; i++) vga_bb_draw_string(16, 16 + (i & 31) * 16, line, 0xFFFFFFFF, 0);
+        per_op[r] = batch_cycles(t0) / TEXT_OPS;
+    }
+}
+
+#define WALL_OPS 2
+static void bench_wallpaper(uint32_t *per_op) {
+    for (int r = 0; r < BENCH_REPS; r++) {
+        uint64_t t0 = rdtsc();
+        for (int i = 0; i < WALL_OPS; i++) ui_render_aurora_wallpaper(vga_backbuffer(), GFX_W, GFX_H);
+        per_op[r] = batch_cycles(t0) / WALL_OPS;
+    }
+}
+
+static const struct {
+    const char *name;
+    uint32_t    ops;
+    void      (*fn)(uint32_t *per_op);
+} benches[] = {
+    { "pmm_alloc_page",             PMM_OPS,     bench_pmm },
+    { "kmalloc",                    KMALLOC_OPS, bench_kmalloc },
+    { "find_node",                  FS_OPS,      bench_find_node },
+    { "switch_context",             SWITCH_OPS,  bench_switch },
+    { "vga_flip",                   FLIP_OPS,    bench_flip },
+    { "vga_bb_fill_rect_alpha",     ALPHA_OPS,   bench_fill_alpha },
+    { "vga_bb_draw_string",         TEXT_OPS,    bench_text },
+    { "ui_render_aurora_wallpaper", WALL_OPS,    bench_wallpaper },
+};
+
+void bench_run(void) {
+    uint32_t per_op[BENCH_REPS];
+    char line[32];
+    ksnprintf(line, sizeof(line), "\nBENCH-BEGIN mhz=%u\n", timer_cycles_per_us());
+    serial_puts(line);
+    for (int i = 0; i < (int)(sizeof(benches) / sizeof(benches[0])); i++) {
+        benches[i].fn(per_op);
+        report(benches[i].name, benches[i].ops, per_op);
+    }
+    serial_puts("BENCH-END\n");
+    serial_flush();
+
+    /* QEMU exits with status (value << 1) | 1 */
+    outl(BENCH_EXIT_PORT, 0);
+    for (;;) __asm__ volatile ("cli; hlt");
+}
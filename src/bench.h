@@ -0,0 +1,20 @@
+#ifndef BENCH_H
+#define BENCH_H
+
+/* ── Boot microbenchmarks ─────────────────────────────────────
+ * Built in by `make bench` (SWAN_BENCH), which boots the kernel
+ * under QEMU, runs every benchmark once the subsystems are up and
+ * powers off through isa-debug-exit. Each benchmark times
+ * BENCH_REPS batches of a fixed number of operations with the TSC
+ * and reports per-operation cycles, one line per benchmark, on COM1:
+ *
+ *   BENCH name=<bench> ops=<per batch> reps=<n> min=<cyc> med=<cyc> ns=<med ns>
+ *
+ * framed by "BENCH-BEGIN mhz=<tsc MHz>" and "BENCH-END".         */
+#define BENCH_REPS      9
+#define BENCH_EXIT_PORT 0xF4        /* isa-debug-exit iobase */
+
+/* Does not return: exits QEMU (or halts without the exit device) */
+void bench_run(void);
+
+#endif
@@ -0,0 +1,414 @@
+/* ============================================================
+ * SwanOS — Bridge Framing
+ * Length-prefixed, checksummed frames multiplexed over COM1 or an
+ * attached network link. Every message carries a channel and a
+ * request id, so several LLM queries, host storage ops, audit and
+ * telemetry can be in flight at once; replies are routed back to
+ * their request slot in whatever order the bridge finishes them.
+ *
+ * Parsing runs in bridge_poll() (task context) off the serial RX
+ * ring and the link. Bytes outside a frame on serial are GUI
+ * keystrokes and are queued for the serial bottom half (keyboard.c).
+ * ============================================================ */
+
+#include "bridge.h"
+#include "serial.h"
+#include "string.h"
+#include "timer.h"
+#include "cpu.h"
+#include "trace.h"
+#include "softirq.h"
+
+#define HDR_LEN   6       /* chan, op, req(2), len(2) */
+#define FRAME_MAX (2 + HDR_LEN + BRIDGE_MAX_PAYLOAD + 1)
+#define KEY_SIZE  256
+
+/* ── Request slots ────────────────────────────────────────── */
+/* Replies land in a per-slot ring: wr counts bytes received, rd the
+ * bytes a streaming reader has consumed. A reader that never consumes
+ * sees the first BRIDGE_REQ_BUF bytes, one that keeps up sees all. */
+#define REQ_MASK (BRIDGE_REQ_BUF - 1)
+
+typedef struct {
+    uint16_t id;          /* 0 = free */
+    uint8_t  chan;
+    uint8_t  done;
+    uint8_t  error;
+    uint32_t tick;
+    uint32_t wr, rd;
+    uint32_t lost;        /* bytes dropped on a full ring */
+    char     buf[BRIDGE_REQ_BUF];
+} bridge_req_t;
+
+static bridge_req_t reqs[BRIDGE_MAX_REQ];
+static uint16_t next_id = 1;
+
+/* ── Receive parsers ──────────────────────────────────────── */
+/* One per byte stream, so a frame split across reads of one
+ * transport never mixes with bytes from the other */
+enum { RX_IDLE, RX_SYNC1, RX_HDR, RX_BODY, RX_SUM };
+
+typedef struct {
+    int      state;
+    uint8_t  hdr[HDR_LEN];
+    int      pos, len;
+    uint8_t  sum;
+    uint8_t  keys;        /* bytes outside frames are keystrokes */
+    uint32_t byte_tick;
+    uint8_t  body[BRIDGE_MAX_PAYLOAD];
+} rx_parser_t;
+
+static rx_parser_t serial_rx, link_rx;
+static uint32_t last_rx_tick = 0;
+static uint32_t bad_frames = 0;
+
+/* ── Transports ───────────────────────────────────────────── */
+
+/* serial_write_char pumps the FIFO itself when the TX ring is
+ * full, so serial always has room */
+static int serial_space(void) { return 0x7FFFFFFF; }
+
+static int serial_send(const uint8_t *p, int n) {
+    for (int i = 0; i < n; i++) serial_write_char((char)p[i]);
+    return 0;
+}
+
+static int serial_recv(uint8_t *buf, int max) {
+    int n = 0;
+    char c;
+    while (n < max && serial_try_read(&c)) buf[n++] = (uint8_t)c;
+    return n;
+}
+
+static int      serial_up(void)      { return 1; }
+static uint32_t serial_pending(void) { return (uint32_t)serial_tx_pending(); }
+
+static const bridge_transport_t serial_transport = {
+    "serial", serial_up, serial_space, serial_send, serial_recv,
+    serial_pending, serial_rx_queue
+};
+
+static const bridge_transport_t *link = 0;
+
+/* The link while it is up, else serial */
+static const bridge_transport_t *tx_path(void) {
+    return link && link->up() ? link : &serial_transport;
+}
+
+/* ── Keystroke ring ───────────────────────────────────────── */
+static char     keys[KEY_SIZE];
+static uint32_t key_head = 0, key_tail = 0;
+
+void bridge_init(void) {
+    memset(reqs, 0, sizeof(reqs));
+    next_id = 1;
+    memset(&serial_rx, 0, sizeof(serial_rx));
+    memset(&link_rx, 0, sizeof(link_rx));
+    serial_rx.keys = 1;
+    last_rx_tick = 0;
+    bad_frames = 0;
+    key_head = key_tail = 0;
+}
+
+static bridge_req_t *find_req(int id) {
+    if (id <= 0) return 0;
+    for (int i = 0; i < BRIDGE_MAX_REQ; i++)
+        if (reqs[i].id == (uint16_t)id) return &reqs[i];
+    return 0;
+}
+
+/* Whoever ran the parser (an LLM wait, say), the serial bottom half
+ * turns the keystroke into an input event */
+static void push_key(char c) {
+    if (key_head - key_tail < KEY_SIZE) {
+        keys[key_head & (KEY_SIZE - 1)] = c;
+        key_head++;
+        softirq_raise(SOFTIRQ_SERIAL);
+    }
+}
+
+/* ── Transmit ─────────────────────────────────────────────── */
+
+/* One frame around the n payload bytes already at f + 2 + HDR_LEN;
+ * the caller holds IRQs off so frames from different tasks never
+ * interleave, and has checked the transport has room for it. */
+static void send_frame(const bridge_transport_t *t, uint8_t *f,
+                       uint8_t chan, char op, uint16_t req, int n) {
+    f[0] = BRIDGE_SYNC0;
+    f[1] = BRIDGE_SYNC1;
+    f[2] = chan;
+    f[3] = (uint8_t)op;
+    f[4] = (uint8_t)req;
+    f[5] = (uint8_t)(req >> 8);
+    f[6] = (uint8_t)n;
+    f[7] = (uint8_t)(n >> 8);
+    uint8_t sum = 0;
+    for (int i = 2; i < 2 + HDR_LEN + n; i++) sum += f[i];
+    f[2 + HDR_LEN + n] = sum;
+    t->send(f, 2 + HDR_LEN + n + 1);
+}
+
+int bridge_sendv(int chan, char op, uint16_t req,
+                 const void *a, int alen, const void *b, int blen) {
+    if (chan < 0 || chan >= BRIDGE_CH_COUNT || alen < 0 || blen < 0) return -1;
+    const uint8_t *seg[2] = { (const uint8_t *)a, (const uint8_t *)b };
+    int seglen[2] = { alen, blen };
+    uint8_t frame[FRAME_MAX];
+    uint8_t *frag = frame + 2 + HDR_LEN;
+
+    /* Gather both segments into fragments; the whole message goes out
+     * under one IRQ-off section, on one transport, so fragments stay
+     * contiguous. An empty message is a single empty frame. */
+    uint32_t flags = irq_save();
+    const bridge_transport_t *t = tx_path();
+    int left = alen + blen, s = 0, off = 0;
+    int frames = left ? (left + BRIDGE_MAX_PAYLOAD - 1) / BRIDGE_MAX_PAYLOAD : 1;
+    if (t->space() < left + frames * (FRAME_MAX - BRIDGE_MAX_PAYLOAD)) {
+        irq_restore(flags);
+        return -1;              /* all or nothing: the link is backed up */
+    }
+    TRACE(TR_BRIDGE_TX, chan << 8 | (uint8_t)op, alen + blen);
+    do {
+        int n = 0;
+        while (n < BRIDGE_MAX_PAYLOAD && s < 2) {
+            int take = seglen[s] - off;
+            if (take > BRIDGE_MAX_PAYLOAD - n) take = BRIDGE_MAX_PAYLOAD - n;
+            memcpy(frag + n, seg[s] + off, take);
+            n += take; off += take;
+            if (off == seglen[s]) { s++; off = 0; }
+        }
+        left -= n;
+        send_frame(t, frame, (uint8_t)chan | (left ? BRIDGE_MORE : 0), op, req, n);
+    } while (left > 0);
+    irq_restore(flags);
+    return 0;
+}
+
+int bridge_send(int chan, char op, uint16_t req, const void *data, int len) {
+    return bridge_sendv(chan, op, req, data, len, 0, 0);
+}
+
+int bridge_request(int chan, char op, const void *data, int len) {
+    uint32_t flags = irq_save();
+    bridge_req_t *r = 0;
+    for (int i = 0; i < BRIDGE_MAX_REQ; i++)
+        if (!reqs[i].id) { r = &reqs[i]; break; }
+    if (!r) { irq_restore(flags); return -1; }
+
+    /* 16-bit ids, never 0 and never one still in use */
+    while (!next_id || find_req(next_id)) next_id++;
+    r->id = next_id++;
+    r->chan = (uint8_t)chan;
+    r->done = 0;
+    r->error = 0;
+    r->wr = r->rd = r->lost = 0;
+    r->tick = timer_get_ticks();
+    int id = r->id;
+    irq_restore(flags);
+
+    if (bridge_send(chan, op, (uint16_t)id, data, len) < 0) {
+        bridge_release(id);
+        return -1;
+    }
+    return id;
+}
+
+/* ── Receive ──────────────────────────────────────────────── */
+
+static void dispatch_frame(rx_parser_t *p) {
+    uint8_t  chan = p->hdr[0] & ~BRIDGE_MORE;
+    int      more = p->hdr[0] & BRIDGE_MORE;
+    char     op   = (char)p->hdr[1];
+    uint16_t req  = (uint16_t)(p->hdr[2] | (p->hdr[3] << 8));
+    int      len  = p->len;
+
+    last_rx_tick = timer_get_ticks();
+    TRACE(TR_BRIDGE_RX, chan << 8 | (uint8_t)op, len);
+
+    /* Unsolicited frames (pongs, req 0) only refresh liveness */
+    bridge_req_t *r = find_req(req);
+    if (!r || r->chan != chan || r->done) return;
+
+    int room = BRIDGE_REQ_BUF - (int)(r->wr - r->rd);
+    int n = len < room ? len : room;         /* truncate on overflow */
+    for (int i = 0; i < n; i++) r->buf[(r->wr + i) & REQ_MASK] = (char)p->body[i];
+    r->wr += n;
+    r->lost += len - n;
+    if (op == BRIDGE_OP_ERROR) r->error = 1;
+    if (!more) r->done = 1;
+}
+
+static void rx_byte(rx_parser_t *p, uint8_t c) {
+    switch (p->state) {
+    case RX_IDLE:
+        if (c == BRIDGE_SYNC0) p->state = RX_SYNC1;
+        else if (p->keys) push_key((char)c);
+        break;
+    case RX_SYNC1:
+        if (c == BRIDGE_SYNC1) { p->state = RX_HDR; p->pos = 0; p->sum = 0; break; }
+        /* Not a frame after all: both bytes were keystrokes */
+        if (p->keys) push_key((char)BRIDGE_SYNC0);
+        p->state = RX_IDLE;
+        rx_byte(p, c);
+        break;
+    case RX_HDR:
+        p->hdr[p->pos++] = c;
+        p->sum += c;
+        if (p->pos == HDR_LEN) {
+            p->len = p->hdr[4] | (p->hdr[5] << 8);
+            p->pos = 0;
+            if (p->len > BRIDGE_MAX_PAYLOAD) { bad_frames++; p->state = RX_IDLE; }
+            else p->state = p->len ? RX_BODY : RX_SUM;
+        }
+        break;
+    case RX_BODY:
+        p->body[p->pos++] = c;
+        p->sum += c;
+        if (p->pos == p->len) p->state = RX_SUM;
+        break;
+    case RX_SUM:
+        if (c == p->sum) dispatch_frame(p);
+        else bad_frames++;
+        p->state = RX_IDLE;
+        break;
+    }
+}
+
+static void drain(rx_parser_t *p, const bridge_transport_t *t, uint32_t now) {
+    /* A frame that stalls for a second is garbage; resynchronise */
+    if (p->state != RX_IDLE && now - p->byte_tick > timer_get_frequency()) {
+        bad_frames++;
+        p->state = RX_IDLE;
+    }
+
+    uint8_t buf[64];
+    int n;
+    while ((n = t->recv(buf, sizeof(buf))) > 0) {
+        for (int i = 0; i < n; i++) rx_byte(p, buf[i]);
+        p->byte_tick = now;
+    }
+}
+
+void bridge_poll(void) {
+    uint32_t flags = irq_save();
+    uint32_t now = timer_get_ticks();
+    drain(&serial_rx, &serial_transport, now);
+    if (link) drain(&link_rx, link, now);
+    irq_restore(flags);
+}
+
+void bridge_attach(const bridge_transport_t *t) {
+    uint32_t flags = irq_save();
+    link = t;
+    memset(&link_rx, 0, sizeof(link_rx));
+    irq_restore(flags);
+}
+
+const char *bridge_transport_name(void) {
+    return tx_path()->name;
+}
+
+uint32_t bridge_tx_pending(void) {
+    return tx_path()->pending();
+}
+
+/* ── Request queries ──────────────────────────────────────── */
+
+int bridge_request_done(int id) {
+    bridge_req_t *r = find_req(id);
+    return r ? r->done : -1;
+}
+
+/* Copy unconsumed reply bytes out, optionally advancing the cursor */
+static int copy_reply(int id, char *buf, int max_len, int consume) {
+    bridge_req_t *r = find_req(id);
+    if (!r || max_len <= 0) return -1;
+    uint32_t flags = irq_save();
+    int avail = (int)(r->wr - r->rd);
+    int n = avail < max_len - 1 ? avail : max_len - 1;
+    for (int i = 0; i < n; i++) buf[i] = r->buf[(r->rd + i) & REQ_MASK];
+    buf[n] = '\0';
+    if (consume) r->rd += n;
+    irq_restore(flags);
+    return n;
+}
+
+int bridge_request_read(int id, char *buf, int max_len) {
+    return copy_reply(id, buf, max_len, 0);
+}
+
+int bridge_request_consume(int id, char *buf, int max_len) {
+    return copy_reply(id, buf, max_len, 1);
+}
+
+int bridge_request_wait(int id, uint32_t ticks) {
+    uint32_t start = timer_get_ticks();
+    for (;;) {
+        /* Drain and sleep with IRQs off so bytes arriving in between
+         * still wake us, on serial or on the link */
+        uint32_t flags = irq_save();
+        bridge_poll();
+        bridge_req_t *r = find_req(id);
+        int res = !r ? -1 : r->done ? 1 : 2;
+        uint32_t waited = timer_get_ticks() - start;
+        if (res == 2 && ticks && waited >= ticks) res = 0;
+        if (res != 2) {
+            irq_restore(flags);
+            return res;
+        }
+        wait_queue_t *qs[2] = { serial_rx_queue(), 0 };
+        int nq = 1;
+        if (link) qs[nq++] = link->rx_queue();
+        sleep_on_any(qs, nq, ticks ? ticks - waited : 0);
+        irq_restore(flags);
+    }
+}
+
+int bridge_request_drained(int id) {
+    bridge_req_t *r = find_req(id);
+    return r ? (r->done && r->rd == r->wr) : -1;
+}
+
+int bridge_request_error(int id) {
+    bridge_req_t *r = find_req(id);
+    return r ? r->error : 0;
+}
+
+uint32_t bridge_request_tick(int id) {
+    bridge_req_t *r = find_req(id);
+    return r ? r->tick : 0;
+}
+
+void bridge_release(int id) {
+    bridge_req_t *r = find_req(id);
+    if (r) r->id = 0;   /* late frames for this id are dropped */
+}
+
+uint32_t bridge_last_rx(void) {
+    return last_rx_tick;
+}
+
+uint32_t bridge_bad_frames(void) {
+    return bad_frames;
+}
+
+/* ── Keystroke passthrough ────────────────────────────────── */
+
+int bridge_key_ready(void) {
+    bridge_poll();
+    return key_head != key_tail;
+}
+
+int bridge_key_read(char *c) {
+    bridge_poll();
+    uint32_t flags = irq_save();
+    int ok = key_head != key_tail;
+    if (ok) { *c = keys[key_tail & (KEY_SIZE - 1)]; key_tail++; }
+    irq_restore(flags);
+    return ok;
+}
+
+void bridge_key_flush(void) {
+    bridge_poll();
+    key_head = key_tail;
+}
@@ -0,0 +1,99 @@
+#ifndef BRIDGE_H
+#define BRIDGE_H
+
+#include <stdint.h>
+#include "wait.h"
+
+/* ── Frame Format (both directions) ───────────────────────────
+ *   sync0 sync1 | chan | op | req_id (u16 LE) | len (u16 LE) | payload | sum
+ *
+ *   chan   channel in bits 0-6; BRIDGE_MORE set on every fragment but the last
+ *   op     command/response letter (see LLM_BRIDGE.md)
+ *   req_id 0 = fire-and-forget; otherwise echoed on the response
+ *   sum    8-bit sum of chan..payload
+ *
+ * Bytes outside a frame on serial (GUI keystrokes) are passed to
+ * the keyboard through bridge_key_*.                            */
+#define BRIDGE_SYNC0        0x02
+#define BRIDGE_SYNC1        0xA5
+#define BRIDGE_MORE         0x80
+#define BRIDGE_MAX_PAYLOAD  1024
+
+/* ── Channels ─────────────────────────────────────────────── */
+#define BRIDGE_CH_CTRL   0   /* key, system prompt, heartbeat   */
+#define BRIDGE_CH_LLM    1   /* queries / responses             */
+#define BRIDGE_CH_STORE  2   /* host save / load                */
+#define BRIDGE_CH_AUDIT  3   /* audit events                    */
+#define BRIDGE_CH_TELEM  4   /* telemetry                       */
+#define BRIDGE_CH_TRACE  5   /* binary trace events             */
+#define BRIDGE_CH_COUNT  6
+
+/* ── Response ops (bridge → OS) ───────────────────────────── */
+#define BRIDGE_OP_DATA   'R'
+#define BRIDGE_OP_ERROR  'E'
+#define BRIDGE_OP_PONG   'P'
+
+/* Outstanding requests; each owns a response ring (power of two) */
+#define BRIDGE_MAX_REQ   8
+#define BRIDGE_REQ_BUF   4096
+
+void bridge_init(void);
+
+/* Drain serial and the link through the frame parsers (non-blocking) */
+void bridge_poll(void);
+
+/* ── Transports ───────────────────────────────────────────────
+ * Frames go out on COM1 unless a network link is attached and up;
+ * replies are accepted from either. A message is sent whole, on one
+ * transport, or not at all. Functions are called with IRQs off.  */
+typedef struct {
+    const char *name;
+    int      (*up)(void);
+    int      (*space)(void);                    /* bytes send can take now */
+    int      (*send)(const uint8_t *p, int n);
+    int      (*recv)(uint8_t *buf, int max);    /* non-blocking; 0 = none */
+    uint32_t (*pending)(void);                  /* sent, not yet delivered */
+    wait_queue_t *(*rx_queue)(void);            /* woken when recv has bytes */
+} bridge_transport_t;
+
+void bridge_attach(const bridge_transport_t *t);    /* 0 detaches */
+const char *bridge_transport_name(void);            /* the one sending now */
+uint32_t bridge_tx_pending(void);
+
+/* Send one message (fragmented as needed). Returns 0, or -1 on bad
+   args or when the transport has no room for all of it */
+int  bridge_send(int chan, char op, uint16_t req, const void *data, int len);
+/* Same, with the payload gathered from two buffers (e.g. header + body) */
+int  bridge_sendv(int chan, char op, uint16_t req,
+                  const void *a, int alen, const void *b, int blen);
+
+/* Send a message and reserve a slot for its reply.
+   Returns a request id (> 0), or -1 when all slots are busy. */
+int  bridge_request(int chan, char op, const void *data, int len);
+
+/* 0 = waiting, 1 = complete, -1 = unknown id */
+int  bridge_request_done(int id);
+
+/* Unconsumed reply bytes, NUL-terminated; -1 = unknown id.
+   _read peeks (whole reply if nothing was consumed), _consume
+   advances the stream cursor so the next call sees only new bytes. */
+int  bridge_request_read(int id, char *buf, int max_len);
+int  bridge_request_consume(int id, char *buf, int max_len);
+int  bridge_request_drained(int id);      /* 1 = complete and fully consumed */
+/* Sleep until the reply is complete: 1 = done, 0 = `ticks` passed
+   first (0 = no limit), -1 = unknown id */
+int  bridge_request_wait(int id, uint32_t ticks);
+int  bridge_request_error(int id);        /* 1 if the reply was an 'E' frame */
+uint32_t bridge_request_tick(int id);     /* tick the request was sent */
+void bridge_release(int id);
+
+/* Tick of the last valid frame from the host (0 = never) */
+uint32_t bridge_last_rx(void);
+uint32_t bridge_bad_frames(void);
+
+/* ── Keystroke passthrough ────────────────────────────────── */
+int  bridge_key_ready(void);
+int  bridge_key_read(char *c);            /* 1 if a key was read */
+void bridge_key_flush(void);
+
+#endif
@@ -0,0 +1,124 @@
+/* ============================================================
+ * SwanOS — Bridge TCP Link
+ * Keeps a TCP connection to the host's bridge open and attaches
+ * it to the frame layer as a transport.
+ * ============================================================ */
+
+#include "bridge_tcp.h"
+#include "bridge.h"
+#include "tcp.h"
+#include "process.h"
+#include "timer.h"
+#include "cpu.h"
+
+static volatile int conn = -1;
+static int      enabled = 1;
+static ip4_t    host = 0;
+static uint16_t port = BRIDGE_TCP_PORT;
+static volatile int retarget = 0;
+static uint32_t connects = 0, drops = 0;
+static wait_queue_t idle_queue;     /* stands in while not connected */
+
+/* ── Transport ────────────────────────────────────────────── */
+
+static int link_up(void) {
+    return conn >= 0 && tcp_state(conn) == TCP_ESTABLISHED;
+}
+
+static int link_space(void) {
+    return conn >= 0 ? tcp_write_space(conn) : 0;
+}
+
+static int link_send(const uint8_t *p, int n) {
+    return conn >= 0 && tcp_write(conn, p, n) == n ? 0 : -1;
+}
+
+static int link_recv(uint8_t *buf, int max) {
+    int n = conn >= 0 ? tcp_read(conn, buf, max) : 0;
+    return n > 0 ? n : 0;
+}
+
+static uint32_t link_pending(void) {
+    return conn >= 0 ? tcp_unacked(conn) : 0;
+}
+
+static wait_queue_t *link_queue(void) {
+    return conn >= 0 ? tcp_queue(conn) : &idle_queue;
+}
+
+static const bridge_transport_t tcp_transport = {
+    "tcp", link_up, link_space, link_send, link_recv, link_pending, link_queue
+};
+
+/* ── Link task ────────────────────────────────────────────── */
+
+static int wanted(void) {
+    return enabled && !retarget && inet_config()->configured;
+}
+
+/* Sleep on the connection until its state leaves `state` (or a
+ * second passes, to notice enable/retarget changes) */
+static void wait_state(int c, int state) {
+    uint32_t flags = irq_save();
+    if (tcp_state(c) == state && !tcp_readable(c))
+        sleep_on_timeout(tcp_queue(c), timer_get_frequency());
+    irq_restore(flags);
+}
+
+static void link_main(void) {
+    for (;;) {
+        if (!wanted()) {
+            retarget = 0;
+            process_sleep_ms(500);
+            continue;
+        }
+        const inet_config_t *cfg = inet_config();
+        ip4_t dst = host ? host : cfg->gateway;
+        if (!dst) { process_sleep_ms(BRIDGE_TCP_RETRY_MS); continue; }
+
+        int c = tcp_connect(dst, port);
+        if (c < 0) { process_sleep_ms(BRIDGE_TCP_RETRY_MS); continue; }
+        while (wanted() && tcp_state(c) == TCP_SYN_SENT) wait_state(c, TCP_SYN_SENT);
+
+        if (tcp_state(c) == TCP_ESTABLISHED) {
+            conn = c;
+            connects++;
+            /* Parse replies as they come, not only when a task waits */
+            while (wanted() && tcp_state(c) == TCP_ESTABLISHED) {
+                if (tcp_readable(c)) bridge_poll();
+                wait_state(c, TCP_ESTABLISHED);
+            }
+            drops++;
+        }
+        uint32_t flags = irq_save();
+        conn = -1;              /* back to serial before the handle goes */
+        irq_restore(flags);
+        tcp_close(c);
+        process_sleep_ms(BRIDGE_TCP_RETRY_MS);
+    }
+}
+
+void bridge_tcp_init(void) {
+    bridge_attach(&tcp_transport);
+    process_create_named(link_main, 0, "bridge-tcp", PRIORITY_NORMAL);
+}
+
+void bridge_tcp_set_target(ip4_t h, uint16_t p) {
+    host = h;
+    port = p ? p : BRIDGE_TCP_PORT;
+    retarget = 1;
+}
+
+void bridge_tcp_enable(int on) {
+    enabled = on;
+}
+
+void bridge_tcp_get_status(bridge_tcp_status_t *out) {
+    int c = conn;
+    out->enabled = enabled;
+    out->state = c >= 0 ? tcp_state(c) : TCP_CLOSED;
+    out->host = host;
+    out->port = port;
+    out->connects = connects;
+    out->drops = drops;
+}
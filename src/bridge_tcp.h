@@ -0,0 +1,34 @@
+#ifndef BRIDGE_TCP_H
+#define BRIDGE_TCP_H
+
+#include <stdint.h>
+#include "inet.h"
+
+/* ── Bridge over TCP ──────────────────────────────────────────
+ * Carries the bridge frames over a TCP connection to the host
+ * (llm_bridge.py --tcp PORT) instead of COM1. A link task connects
+ * once the stack has an address, to the default gateway unless a
+ * host is set (under QEMU user networking the gateway is the host
+ * itself), and reconnects every BRIDGE_TCP_RETRY_MS after a drop.
+ * While the link is down the bridge falls back to serial.        */
+#define BRIDGE_TCP_PORT     5555
+#define BRIDGE_TCP_RETRY_MS 2000
+
+void bridge_tcp_init(void);     /* after inet_init */
+
+/* Host 0 = the gateway; port 0 = BRIDGE_TCP_PORT. Drops a live
+ * connection to a different target. */
+void bridge_tcp_set_target(ip4_t host, uint16_t port);
+void bridge_tcp_enable(int on);
+
+typedef struct {
+    int      enabled;
+    int      state;             /* TCP_*, TCP_CLOSED when idle */
+    ip4_t    host;              /* as set (0 = gateway) */
+    uint16_t port;
+    uint32_t connects, drops;
+} bridge_tcp_status_t;
+
+void bridge_tcp_get_status(bridge_tcp_status_t *out);
+
+#endif
@@ -0,0 +1,84 @@
+#ifndef CPU_H
+#define CPU_H
+
+#include <stdint.h>
+
+/* ── CPUID leaf 1 EDX feature bits ─────────────────────────── */
+#define CPUID_EDX_PSE   (1u << 3)
+#define CPUID_EDX_TSC   (1u << 4)
+#define CPUID_EDX_MSR   (1u << 5)
+#define CPUID_EDX_APIC  (1u << 9)
+#define CPUID_EDX_MTRR  (1u << 12)
+#define CPUID_EDX_PGE   (1u << 13)
+#define CPUID_EDX_PAT   (1u << 16)
+#define CPUID_EDX_FXSR  (1u << 24)
+#define CPUID_EDX_SSE   (1u << 25)
+#define CPUID_EDX_SSE2  (1u << 26)
+
+/* ── Model-specific registers ──────────────────────────────── */
+#define MSR_MTRR_CAP        0x0FE
+#define MSR_MTRR_PHYSBASE0  0x200   /* PHYSMASKn = PHYSBASEn + 1 */
+#define MSR_PAT             0x277
+
+/* ── IRQs-off sections ────────────────────────────────────────
+ * The kernel's basic mutual exclusion. On one CPU clearing IF is
+ * enough, but processes run on every CPU, so irq_save also takes
+ * the global IRQ lock (smp.c) and irq_restore drops it. The lock
+ * is recursive per CPU and interrupt handlers hold it too, so a
+ * section excludes handlers and other CPUs' sections alike. A
+ * process that sleeps inside one gives the lock up until it runs
+ * again. local_irq_save/restore only touch this CPU's IF.       */
+static inline uint32_t local_irq_save(void) {
+    uint32_t flags;
+    __asm__ volatile ("pushf; pop %0; cli" : "=r"(flags) :: "memory");
+    return flags;
+}
+
+static inline void local_irq_restore(uint32_t flags) {
+    if (flags & 0x200) __asm__ volatile ("sti" ::: "memory");
+}
+
+void     irq_lock(void);            /* IRQs must be off */
+void     irq_unlock(void);
+uint32_t irq_lock_drop(void);       /* let go of every level held; returns them */
+void     irq_lock_take(uint32_t depth);
+void     irq_halt(void);            /* "sti; hlt; cli", lock let go meanwhile */
+
+static inline uint32_t irq_save(void) {
+    uint32_t flags = local_irq_save();
+    irq_lock();
+    return flags;
+}
+
+static inline void irq_restore(uint32_t flags) {
+    irq_unlock();
+    local_irq_restore(flags);
+}
+
+static inline void cpuid(uint32_t leaf, uint32_t *a, uint32_t *b, uint32_t *c, uint32_t *d) {
+    __asm__ volatile ("cpuid" : "=a"(*a), "=b"(*b), "=c"(*c), "=d"(*d) : "a"(leaf), "c"(0));
+}
+
+static inline uint32_t cpuid_edx(uint32_t leaf) {
+    uint32_t a, b, c, d;
+    cpuid(leaf, &a, &b, &c, &d);
+    return d;
+}
+
+static inline uint64_t rdtsc(void) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdtsc" : "=a"(lo), "=d"(hi));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline uint64_t rdmsr(uint32_t msr) {
+    uint32_t lo, hi;
+    __asm__ volatile ("rdmsr" : "=a"(lo), "=d"(hi) : "c"(msr));
+    return ((uint64_t)hi << 32) | lo;
+}
+
+static inline void wrmsr(uint32_t msr, uint64_t val) {
+    __asm__ volatile ("wrmsr" : : "c"(msr), "a"((uint32_t)val), "d"((uint32_t)(val >> 32)));
+}
+
+#endif
@@ -9,6 +9,7 @@
 #include "vga_gfx.h"
 #include "mouse.h"
 #include "keyboard.h"
+#include "input.h"
 #include "timer.h"
 #include "screen.h"
 #include "string.h"
@@ -25,6 +26,8 @@
 #include "audit.h"
 #include "kernel_ai.h"
 #include "process.h"
+#include "telemetry.h"
+#include "frameprof.h"
 
 /* ── Layout ───────────────────────────────────────────────── */
 #define SCRW       GFX_W
@@ -134,9 +137,12 @@ typedef struct {
     int active, x, y, w, h, type;
     char title[20];
     char lines[16][40];
+    vga_text_run_t line_run[16];  /* cached rasterization of lines[] */
     int line_count, scroll;
     char input[80];
     int input_pos;
+    int ai_stream;               /* LLM query streaming into lines[] (0 = none) */
+    int ai_col;                  /* column in the last line; 0 = start a new line, -1 = placeholder */
     char note_text[512];
     int note_len, note_cursor;
     char note_file[20];
@@ -158,6 +164,9 @@ typedef struct {
     int clock_sw_running;        /* stopwatch running? */
     uint32_t clock_sw_start;     /* stopwatch start tick */
     uint32_t clock_sw_elapsed;   /* stopwatch accumulated ticks */
+    /* Retained surface: rendered content, re-rendered only when dirty */
+    uint32_t *surf;
+    int surf_dirty;
 } window_t;
 
 static window_t windows[MAX_WINDOWS];
@@ -186,9 +195,7 @@ static int ko_ids[KO_ITEMS] = {WIN_AI,WIN_TERM,WIN_FILES,WIN_NOTES,WIN_CALC,WIN_
 #define MAX_WORKSPACES 3
 static int current_workspace = 0;
 
-/* ── Wallpaper cache ──────────────────────────────────────── */
-static int wp_cached = 0;
-static uint32_t wp_buf[1920 * 1080];
+/* ── Wallpaper animation (tiles cached by ui_wallpaper_*) ──── */
 static uint32_t wp_phase = 0;
 static uint32_t wp_last_tick = 0;
 
@@ -221,29 +228,22 @@ static void open_window(int type);
 static void draw_desktop(void);
 static int  handle_click(int mx, int my);
 static void term_add_line(window_t *w, const char *text);
+static void term_stream_start(window_t *w, const char *question);
 static void term_process_cmd(window_t *w);
 static int  sine_approx(int deg);
 static void draw_narrator_bar(void);
 static void draw_command_palette(void);
 static void draw_health_widget(void);
+static void draw_profiler(void);
 
 /* ── Wallpaper ────────────────────────────────────────────── */
-static void render_wallpaper(void) {
-    /* Render full screen height so wallpaper shows through dock transparency */
-    ui_render_aurora_wallpaper_animated(wp_buf, GFX_W, GFX_H, wp_phase);
-    wp_cached = 1;
-}
-
 static void draw_wallpaper(void) {
-    if (!wp_cached) render_wallpaper();
-    uint32_t *bb = vga_backbuffer();
-    /* Full screen blit — wallpaper visible through transparent dock */
-    for (int y = 0; y < GFX_H; y++) {
-        uint32_t *dst = &bb[y * GFX_W];
-        const uint32_t *src = &wp_buf[y * GFX_W];
-        for (int x = 0; x < GFX_W; x++)
-            dst[x] = src[x];
-    }
+    /* Blit the clipped (damaged) part — wallpaper visible through transparent dock.
+     * Full screen height so it shows through the dock; only the tiles under
+     * the clip are (re)composited. */
+    vga_rect_t clip; vga_bb_get_clip(&clip);
+    ui_wallpaper_set_phase(wp_phase);
+    ui_wallpaper_blit(vga_backbuffer(), vga_bb_stride(), clip.x, clip.y, clip.w, clip.h);
 }
 
 /* ── Desktop Icons (Neon Aurora Grid) ─────────────────────── */
@@ -895,7 +895,7 @@ static void draw_panel(void) {
         ui_pill_segment(clk_seg_x, dock_y+4, clk_seg_w, PANEL_H-8, 12,
                         0x14FFFFFF, 0x18FFFFFF, 0);
 
-        rtc_time_t rtc; rtc_read(&rtc);
+        rtc_time_t rtc; time_now(&rtc);
         char clk[10]; rtc_format_time(&rtc, clk);
         clk[5] = '\0';
         int clk_x = clk_seg_x + (clk_seg_w - 5*CW) / 2;
@@ -1128,7 +1128,7 @@ static void draw_kickoff(void) {
 }
 
 /* ── Breeze Window Decorations ────────────────────────────── */
-static void draw_window(int wi) {
+static void draw_window_content(int wi) {
     window_t *w = &windows[wi];
     if (!w->active) return;
     int focused = (wi == win_focus);
@@ -1164,31 +1164,15 @@ static void draw_window(int wi) {
         return; /* Don't draw content during animation */
     }
 
-    /* Multi-layer soft shadow */
-    ui_window_shadow(w->x, w->y, w->w, w->h);
-
     /* Window body */
     vga_bb_fill_rounded_rect(w->x, w->y, w->w, w->h, 10, B_WIN_BG);
 
     /* Border — neon glow on focus with breathing pulse */
+    /* (rings outside the window rect are drawn by draw_window) */
     if (focused) {
-        /* Breathing neon border — alpha pulses */
-        int breath = sine_approx((now_t * 4) % 360);
-        int glow_a = 0x20 + (breath * 0x18) / 100;
-        if (glow_a < 0x10) glow_a = 0x10;
-        uint32_t glow_c = ((uint32_t)glow_a << 24) | (S_NEON_CYAN & 0x00FFFFFF);
-        vga_bb_draw_rect_outline(w->x-1, w->y-1, w->w+2, w->h+2, glow_c);
         ui_neon_border(w->x, w->y, w->w, w->h, 10, S_NEON_CYAN);
-        /* High-contrast: extra thick bright border */
-        if (high_contrast_mode) {
-            vga_bb_draw_rect_outline(w->x-2, w->y-2, w->w+4, w->h+4, 0xFFFFFFFF);
-            vga_bb_draw_rect_outline(w->x-3, w->y-3, w->w+6, w->h+6, 0xFFFBBF24);
-        }
     } else {
         vga_bb_draw_rect_outline(w->x, w->y, w->w, w->h, B_BORDER);
-        if (high_contrast_mode) {
-            vga_bb_draw_rect_outline(w->x-1, w->y-1, w->w+2, w->h+2, 0xFFA0A0A0);
-        }
     }
     /* Inner top highlight for depth */
     vga_bb_draw_hline(w->x+10, w->y+1, w->w-20, S_GLASS_BORDER);
@@ -1258,8 +1242,8 @@ static void draw_window(int wi) {
         for (int i = sl; i < w->line_count && i < sl + max_l; i++) {
             uint32_t lc = (is_ai && w->lines[i][0] == '>') ? B_GREEN :
                           (is_ai ? B_ACCENT : B_GREEN);
-            for (int j = 0; j < mc && w->lines[i][j]; j++)
-                vga_bb_draw_char_2x(cx+6+j*CW, ly, w->lines[i][j], lc, 0x00000000);
+            vga_text_run_set(&w->line_run[i], w->lines[i], mc, 2, lc, 0x00000000);
+            vga_text_run_draw(&w->line_run[i], cx+6, ly);
             ly += CH;
         }
         /* Input */
@@ -1272,8 +1256,7 @@ static void draw_window(int wi) {
         int mi = (cw - CW*3) / CW;
         int s = 0;
         if (w->input_pos > mi) s = w->input_pos - mi;
-        for (int i = s; i < w->input_pos; i++)
-            vga_bb_draw_char_2x(cx+CW+6+(i-s)*CW, iy, w->input[i], B_TEXT, 0x00000000);
+        vga_bb_draw_text(cx+CW+6, iy, w->input + s, w->input_pos - s, 2, B_TEXT, 0x00000000);
         int cur_x = cx + CW + 6 + (w->input_pos - s) * CW;
         if (cur_x < cx+cw-4) {
             uint32_t cc = (timer_get_ticks()/30)%2 ? pc : B_BG_ALT;
@@ -1455,6 +1438,11 @@ static void draw_window(int wi) {
         char qbuf[20]; strcpy(qbuf, "Queries: "); itoa(ais->queries_total, tmp, 10); strcat(qbuf, tmp);
         vga_bb_draw_string_2x(ax, ay, qbuf, B_TEXT_DIM, 0x00000000);
         ay += CH + 2;
+        /* Response cache */
+        char cbuf[24]; strcpy(cbuf, "Cache: "); itoa(ais->cache_hits, tmp, 10); strcat(cbuf, tmp);
+        strcat(cbuf, "/"); itoa(ais->cache_hits + ais->cache_misses, tmp, 10); strcat(cbuf, tmp);
+        vga_bb_draw_string_2x(ax, ay, cbuf, B_TEXT_DIM, 0x00000000);
+        ay += CH + 2;
         /* Telemetry */
         char tbuf2[20]; strcpy(tbuf2, "Telemetry: "); itoa(ais->telemetry_sent, tmp, 10); strcat(tbuf2, tmp);
         vga_bb_draw_string_2x(ax, ay, tbuf2, B_TEXT_DIM, 0x00000000);
@@ -1481,8 +1469,9 @@ static void draw_window(int wi) {
         vga_bb_draw_string_2x(cx+410, py2+2, "CPU%", B_TEXT_DIM, 0x00000000);
         vga_bb_draw_hline(cx+4, py2+CH+4, cw-8, B_SEPARATOR);
         py2 += CH + 8;
-        /* Process rows */
-        int max_rows = (cy + ch - py2 - 8) / (CH + 4);
+        /* Process rows, above the IRQ strip and the status bar */
+        int irq_y = cy + ch - 28 - CH - 10;
+        int max_rows = (irq_y - py2 - 4) / (CH + 4);
         for (int pi = 0; pi < pov.count && pi < max_rows; pi++) {
             process_stats_t *ps = &pov.procs[pi];
             if ((pi % 2) == 0) vga_bb_fill_rect(cx+4, py2-2, cw-8, CH+4, 0x08FFFFFF);
@@ -1527,6 +1516,22 @@ static void draw_window(int wi) {
             }
             py2 += CH + 4;
         }
+        /* ── IRQ strip: total rate and busy time, then the line that
+         * spent longest in its handler over the last second ── */
+        irq_overview_t iov; idt_get_irq_overview(&iov);
+        vga_bb_draw_hline(cx+8, irq_y, cw-16, B_SEPARATOR);
+        char ibuf[40]; strcpy(ibuf, "IRQ "); itoa(iov.total_rate, tmp, 10); strcat(ibuf, tmp);
+        strcat(ibuf, "/s  "); itoa(iov.busy_permille / 10, tmp, 10); strcat(ibuf, tmp);
+        strcat(ibuf, "."); itoa(iov.busy_permille % 10, tmp, 10); strcat(ibuf, tmp); strcat(ibuf, "%");
+        vga_bb_draw_string_2x(cx+10, irq_y+6, ibuf, iov.busy_permille > 100 ? S_YELLOW : B_TEXT_DIM, 0x00000000);
+        int hot = 0;
+        for (int li = 1; li < 16; li++) if (iov.line[li].window_us > iov.line[hot].window_us) hot = li;
+        const irq_line_stats_t *hl = &iov.line[hot];
+        strcpy(ibuf, idt_irq_name(hot)); strcat(ibuf, " "); itoa(hl->rate, tmp, 10); strcat(ibuf, tmp);
+        strcat(ibuf, "/s max "); itoa(hl->max_us, tmp, 10); strcat(ibuf, tmp); strcat(ibuf, "us");
+        int iw = (int)strlen(ibuf) * CW;
+        if (cx + 10 + (int)strlen("IRQ 0000/s  00.0%") * CW + iw < cx + cw - 10)
+            vga_bb_draw_string_2x(cx+cw-iw-10, irq_y+6, ibuf, hl->max_us > 1000 ? S_RED : S_NEON_CYAN, 0x00000000);
         /* Bottom status bar */
         vga_bb_fill_rect(cx, cy+ch-28, cw, 28, B_BG_ALT);
         vga_bb_draw_hline(cx, cy+ch-28, cw, B_SEPARATOR);
@@ -1930,7 +1935,7 @@ static void draw_window(int wi) {
             vga_bb_fill_circle(mx2, my2, 3, S_TEXT);
         }
         /* Current time hands */
-        rtc_time_t ct; rtc_read(&ct);
+        rtc_time_t ct; time_now(&ct);
         /* Hour hand */
         int h_deg = ((ct.hour % 12) * 30 + ct.minute / 2);
         int hx = clock_cx + (sine_approx((h_deg+90)%360) * 50) / 100;
@@ -1994,6 +1999,75 @@ static void draw_window(int wi) {
     }
 }
 
+/* Unpainted surface pixels (the rounded-corner cut-outs); never produced
+ * by the primitives, which always write opaque or caller-given colours,
+ * and left alone by alpha fills so the cut-outs stay keyed */
+#define SURF_KEY 0x00FF00FF
+
+/* Composite one window: live shadow and outer rings around its cached
+ * surface. The surface is re-rendered only after invalidate_window(). */
+static void draw_window(int wi) {
+    window_t *w = &windows[wi];
+    if (!w->active) return;
+    int focused = (wi == win_focus);
+    uint32_t now_t = timer_get_ticks();
+
+    if ((int)(now_t - w->open_anim_tick) < 20) {
+        draw_window_content(wi);   /* open animation draws live */
+        return;
+    }
+
+    /* Multi-layer soft shadow */
+    ui_window_shadow(w->x, w->y, w->w, w->h);
+
+    if (!w->surf) {
+        w->surf = (uint32_t *)kmalloc((size_t)w->w * w->h * 4);
+        w->surf_dirty = 1;
+    }
+    if (w->surf) {
+        if (w->surf_dirty) {
+            for (int i = 0; i < w->w * w->h; i++) w->surf[i] = SURF_KEY;
+            vga_bb_set_target(w->surf, w->x, w->y, w->w, w->h);
+            vga_bb_set_target_key(SURF_KEY);
+            draw_window_content(wi);
+            vga_bb_reset_target();
+            w->surf_dirty = 0;
+        }
+        vga_bb_blit_surface(w->surf, w->x, w->y, w->w, w->h, 12, SURF_KEY);
+    } else {
+        draw_window_content(wi);   /* heap exhausted: draw directly */
+    }
+
+    if (focused) {
+        /* Breathing neon border — alpha pulses */
+        int breath = sine_approx((now_t * 4) % 360);
+        int glow_a = 0x20 + (breath * 0x18) / 100;
+        if (glow_a < 0x10) glow_a = 0x10;
+        uint32_t glow_c = ((uint32_t)glow_a << 24) | (S_NEON_CYAN & 0x00FFFFFF);
+        vga_bb_draw_rect_outline(w->x-1, w->y-1, w->w+2, w->h+2, glow_c);
+        /* High-contrast: extra thick bright border */
+        if (high_contrast_mode) {
+            vga_bb_draw_rect_outline(w->x-2, w->y-2, w->w+4, w->h+4, 0xFFFFFFFF);
+            vga_bb_draw_rect_outline(w->x-3, w->y-3, w->w+6, w->h+6, 0xFFFBBF24);
+        }
+    } else if (high_contrast_mode) {
+        vga_bb_draw_rect_outline(w->x-1, w->y-1, w->w+2, w->h+2, 0xFFA0A0A0);
+    }
+}
+
+static void invalidate_window(int wi) {
+    if (wi >= 0) windows[wi].surf_dirty = 1;
+}
+
+static void invalidate_all_windows(void) {
+    for (int i = 0; i < MAX_WINDOWS; i++) windows[i].surf_dirty = 1;
+}
+
+static void free_window_surface(int wi) {
+    if (windows[wi].surf) { kfree(windows[wi].surf); windows[wi].surf = 0; }
+    for (int i = 0; i < 16; i++) vga_text_run_free(&windows[wi].line_run[i]);
+}
+
 /* ── Cursor (Breeze-like arrow) ───────────────────────────── */
 static const uint8_t cur[14][10] = {
     {1,0,0,0,0,0,0,0,0,0},
@@ -2012,14 +2086,84 @@ static const uint8_t cur[14][10] = {
     {1,0,0,0,0,0,1,1,0,0},
 };
 
-static void draw_cursor(int mx, int my) {
+/* The cursor lives on the vga_gfx overlay, moved directly by the mouse IRQ */
+static void install_cursor(void) {
+    uint32_t img[14 * 10];
     for (int dy = 0; dy < 14; dy++)
-        for (int dx = 0; dx < 10; dx++) {
-            if (!cur[dy][dx]) continue;
-            int px = mx+dx, py = my+dy;
-            if (px >= SCRW || py >= SCRH) continue;
-            vga_bb_putpixel(px, py, cur[dy][dx]==1 ? 0xFF101010 : B_TEXT);
+        for (int dx = 0; dx < 10; dx++)
+            img[dy * 10 + dx] = !cur[dy][dx] ? 0 : cur[dy][dx]==1 ? 0xFF101010 : B_TEXT;
+    vga_cursor_set_image(img, 10, 14);
+    mouse_state_t ms; mouse_get_state(&ms);
+    vga_cursor_move(ms.x, ms.y);
+    vga_cursor_show(1);
+}
+
+/* ── Damage tracking ──────────────────────────────────────── */
+/* The dock bobs and its border animates, so any damage touching the dock
+ * band repaints the whole band to avoid seams between frames. */
+#define DAMAGE_MARGIN 32                  /* window shadow / glow reach */
+#define DOCK_BAND_Y   (SCRH - PANEL_H - 120)
+static int hover_x = -1, hover_y = -1;   /* pointer position last composited */
+
+static void damage_rect(int x, int y, int w, int h) {
+    vga_damage_add(x, y, w, h);
+    if (y + h > DOCK_BAND_Y) vga_damage_add(0, DOCK_BAND_Y, SCRW, SCRH - DOCK_BAND_Y);
+}
+
+static void damage_window(int wi) {
+    if (wi < 0 || !windows[wi].active) return;
+    window_t *w = &windows[wi];
+    damage_rect(w->x - DAMAGE_MARGIN, w->y - DAMAGE_MARGIN,
+                w->w + 2 * DAMAGE_MARGIN, w->h + 2 * DAMAGE_MARGIN);
+}
+
+/* Content changed: re-render the surface and repaint its area */
+static void refresh_window(int wi) {
+    invalidate_window(wi);
+    damage_window(wi);
+}
+
+/* Whatever shows hover feedback under (x, y) */
+/* Topmost window on this workspace under (x, y), or -1 */
+static int window_at(int x, int y) {
+    for (int i = win_order_count - 1; i >= 0; i--) {
+        window_t *w = &windows[win_order[i]];
+        if (w->active && w->workspace == current_workspace &&
+            x >= w->x && x < w->x + w->w && y >= w->y && y < w->y + w->h)
+            return win_order[i];
+    }
+    return -1;
+}
+
+static void damage_hover(int x, int y) {
+    if (kickoff_open || ctx_menu_open || cmdpal_open || quick_settings_open ||
+        narrator_active || rearrange_mode) {
+        vga_damage_all();
+        return;
+    }
+    if (y >= DOCK_BAND_Y) { damage_rect(0, DOCK_BAND_Y, SCRW, 1); return; }
+    int wi = window_at(x, y);
+    if (wi >= 0) { refresh_window(wi); return; }
+    for (int i = 0; i < num_icons; i++) {
+        int gx = icons[i].x, gy = icons[i].y;
+        if (x >= gx - 8 && x < gx + 88 && y >= gy - 8 && y < gy + 88) {
+            damage_rect(gx - 8, gy - 8, 100, 100);
+            return;
         }
+    }
+}
+
+static void damage_toasts(void) {
+    static int was_active = 0;
+    int active = 0, maxw = 0;
+    for (int i = 0; i < MAX_TOASTS; i++) {
+        int tw2 = (int)strlen(toasts[i].text) * CW + 40;
+        if (tw2 > maxw) maxw = tw2;
+        if (toasts[i].active) active = 1;
+    }
+    if (active || was_active)
+        damage_rect(SCRW - maxw - 20, 20, maxw, MAX_TOASTS * 44);
+    was_active = active;
 }
 
 /* ── Window management ────────────────────────────────────── */
@@ -2033,15 +2177,21 @@ static void bring_to_front(int wi) {
     win_order[win_order_count>0?win_order_count-1:0]=wi;
     if (pos<0 && win_order_count<MAX_WINDOWS) win_order_count++;
     win_focus=wi;
+    invalidate_all_windows();
+    vga_damage_all();
 }
 
 static void close_window(int wi) {
     audit_log(AUDIT_APP_CLOSE, windows[wi].title);
+    if (windows[wi].ai_stream) { llm_query_cancel(windows[wi].ai_stream); windows[wi].ai_stream = 0; }
+    free_window_surface(wi);
     windows[wi].active=0;
     int pos=-1;
     for (int i=0;i<win_order_count;i++) if (win_order[i]==wi) {pos=i;break;}
     if (pos>=0) { for (int i=pos;i<win_order_count-1;i++) win_order[i]=win_order[i+1]; win_order_count--; }
     win_focus=(win_order_count>0)?win_order[win_order_count-1]:-1;
+    invalidate_all_windows();
+    vga_damage_all();
 }
 
 static void open_window(int type) {
@@ -2074,6 +2224,8 @@ static void open_window(int type) {
     /* Audit log the app open */
     audit_log(AUDIT_APP_OPEN, w->title);
     toast_show(w->title, icon_accent(type));
+    invalidate_all_windows();
+    vga_damage_all();
 }
 
 /* ── Terminal helpers ─────────────────────────────────────── */
@@ -2082,6 +2234,43 @@ static void term_add_line(window_t *w, const char *text) {
     strncpy(w->lines[w->line_count],text,39); w->lines[w->line_count][39]='\0'; w->line_count++;
 }
 
+/* ── Streamed AI replies: tokens are appended as they arrive ── */
+static void term_stream_start(window_t *w, const char *question) {
+    if (!llm_ready()) { term_add_line(w,"No API key set. Use 'setkey <KEY>'."); return; }
+    if (w->ai_stream) llm_query_cancel(w->ai_stream);
+    w->ai_stream = llm_query_begin(question);
+    if (w->ai_stream < 0) { w->ai_stream = 0; term_add_line(w,"AI bridge busy. Try again."); return; }
+    term_add_line(w,"[AI] ..."); w->ai_col = -1;
+}
+
+static void term_stream_put(window_t *w, const char *p, int n) {
+    if (w->ai_col < 0) { if (w->line_count > 0) w->line_count--; w->ai_col = 0; }  /* drop placeholder */
+    for (int i = 0; i < n; i++) {
+        char c = p[i];
+        if (c == '\n') { w->ai_col = 0; continue; }
+        if (c == '\r' || (c == ' ' && w->ai_col == 0)) continue;
+        if (w->ai_col == 0) term_add_line(w, "");
+        char *ln = w->lines[w->line_count-1];
+        ln[w->ai_col++] = c; ln[w->ai_col] = '\0';
+        if (w->ai_col >= 38) w->ai_col = 0;   /* wrap */
+    }
+}
+
+/* Drain whatever each streaming window has received; called once per loop */
+static void term_stream_poll(void) {
+    for (int wi = 0; wi < MAX_WINDOWS; wi++) {
+        window_t *w = &windows[wi];
+        if (!w->active || !w->ai_stream) continue;
+        char chunk[128]; int n, got = 0;
+        while ((n = llm_query_stream(w->ai_stream, chunk, sizeof(chunk))) > 0) { term_stream_put(w, chunk, n); got = 1; }
+        if (n < 0) {
+            if (w->ai_col < 0) { if (w->line_count > 0) w->line_count--; term_add_line(w,"No response from AI bridge."); }
+            w->ai_stream = 0; got = 1;
+        }
+        if (got) refresh_window(wi);
+    }
+}
+
 static void term_process_cmd(window_t *w) {
     char *cmd=w->input; while (*cmd==' ') cmd++; if (!cmd[0]) return;
     char echo[44]; strcpy(echo,"> "); strcat(echo,cmd); term_add_line(w,echo);
@@ -2098,7 +2287,7 @@ static void term_process_cmd(window_t *w) {
     else if (!strcmp(cc,"write")) { char *ct=arg; while(*ct&&*ct!=' ')ct++; if(*ct){*ct='\0';ct++;} if(!arg[0]||!ct[0]) term_add_line(w,"Usage: write <f> <text>"); else{fs_write(arg,ct);term_add_line(w,"Written.");} }
     else if (!strcmp(cc,"mkdir")) { if(!arg[0]) term_add_line(w,"Usage: mkdir <name>"); else{fs_mkdir(arg);term_add_line(w,"Created.");} }
     else if (!strcmp(cc,"rm")) { if(!arg[0]) term_add_line(w,"Usage: rm <file>"); else{fs_delete(arg);term_add_line(w,"Deleted.");} }
-    else if (!strcmp(cc,"date")) { rtc_time_t t;rtc_read(&t);char d[12],tb[10];rtc_format_date(&t,d);rtc_format_time(&t,tb); char m[30];strcpy(m,d);strcat(m," ");strcat(m,tb);term_add_line(w,m); }
+    else if (!strcmp(cc,"date")) { rtc_time_t t;time_now(&t);char d[12],tb[10];rtc_format_date(&t,d);rtc_format_time(&t,tb); char m[30];strcpy(m,d);strcat(m," ");strcat(m,tb);term_add_line(w,m); }
     else if (!strcmp(cc,"mem")) { char m[40];char t[8];strcpy(m,"Used: ");itoa(mem_used()/1024,t,10);strcat(m,t);strcat(m,"K / ");itoa(mem_total()/1024,t,10);strcat(m,t);strcat(m,"K");term_add_line(w,m); }
     else if (!strcmp(cc,"whoami")) { char m[30];strcpy(m,"User: ");strcat(m,user_current());term_add_line(w,m); }
     else if (!strcmp(cc,"calc")) {
@@ -2108,8 +2297,8 @@ static void term_process_cmd(window_t *w) {
             if(has){if(op=='+')res+=num;else if(op=='-')res-=num;else if(op=='*')res*=num;else if(op=='/'&&num)res/=num;}
             char m[20];char nb[12];strcpy(m,"= ");itoa(res,nb,10);strcat(m,nb);term_add_line(w,m);}
     }
-    else if (!strcmp(cc,"ask")) { if(!arg[0]) term_add_line(w,"Usage: ask <q>"); else { term_add_line(w,"Thinking..."); char rsp[512]; llm_query(arg,rsp,sizeof(rsp)); char *rp=rsp; while(*rp){char ln[40];int li=0;while(*rp&&*rp!='\n'&&li<38)ln[li++]=*rp++;ln[li]='\0';if(li>0)term_add_line(w,ln);if(*rp=='\n')rp++;} } }
-    else { term_add_line(w,"[AI] ..."); char rsp[512]; llm_query(w->input_pos>0?cmd:cc,rsp,sizeof(rsp)); if(w->line_count>0)w->line_count--; char *rp=rsp; while(*rp){char ln[40];int li=0;while(*rp&&*rp!='\n'&&li<38)ln[li++]=*rp++;ln[li]='\0';if(li>0)term_add_line(w,ln);if(*rp=='\n')rp++;} }
+    else if (!strcmp(cc,"ask")) { if(!arg[0]) term_add_line(w,"Usage: ask <q>"); else term_stream_start(w,arg); }
+    else term_stream_start(w, w->input_pos>0?cmd:cc);
     w->input_pos=0; w->input[0]='\0';
 }
 
@@ -2121,7 +2310,7 @@ static int handle_click(int mx, int my) {
             if (idx == 0) open_window(WIN_NOTES);
             else if (idx == 1) open_window(WIN_SYSMON);
             else if (idx == 2) open_window(WIN_DRAW);
-            else if (idx == 3) wp_cached = 0;
+            else if (idx == 3) ui_wallpaper_invalidate();
         }
         ctx_menu_open = 0; return 0;
     }
@@ -2636,7 +2825,7 @@ static void draw_health_widget(void) {
 
 /* ── Widgets ──────────────────────────────────────────── */
 static void draw_widgets(void) {
-    rtc_time_t t; rtc_read(&t);
+    rtc_time_t t; time_now(&t);
 
     /* Greeting Widget — dynamic based on time of day */
     {
@@ -2787,40 +2976,191 @@ static void draw_workspace_indicator(void) {
     }
 }
 
-/* ── Full desktop draw ────────────────────────────────── */
-static void draw_desktop(void) {
-    draw_wallpaper();
-    draw_icons();
-    draw_workspace_indicator();
-    draw_widgets();
+/* ── Desktop compositing ──────────────────────────────── */
+static void draw_scene(void) {
+    { FP_SCOPE(FP_WALLPAPER); draw_wallpaper(); }
+    { FP_SCOPE(FP_ICONS);     draw_icons(); }
+    {
+        FP_SCOPE(FP_WIDGETS);
+        draw_workspace_indicator();
+        draw_widgets();
+    }
     /* Only draw active windows to save cycles */
     for (int i = 0; i < win_order_count; i++) {
         int wi = win_order[i];
-        if (windows[wi].active && windows[wi].workspace == current_workspace) draw_window(wi);
-    }
-    draw_panel();
-    draw_kickoff();
-    draw_context_menu();
-    draw_toasts();
-    draw_narrator_bar();
-    draw_health_widget();
-    draw_command_palette();
+        if (windows[wi].active && windows[wi].workspace == current_workspace) {
+            FP_SCOPE(FP_WIN(wi));
+            draw_window(wi);
+        }
+    }
+    { FP_SCOPE(FP_PANEL); draw_panel(); }
+    {
+        FP_SCOPE(FP_OVERLAYS);
+        draw_kickoff();
+        draw_context_menu();
+        draw_toasts();
+        draw_narrator_bar();
+        draw_health_widget();
+        draw_command_palette();
+    }
+    draw_profiler();
+}
+
+/* Recomposite only the damaged regions, then flip just those. The
+ * scene itself is drawn in order on this CPU (widgets update caches
+ * as they draw); the bandwidth-bound passes inside it — wallpaper,
+ * window surface blits and the flip — split their rows across all
+ * CPUs and join before returning. */
+static void draw_desktop(void) {
+    uint32_t t0 = timer_get_ms();
     mouse_state_t ms; mouse_get_state(&ms);
-    draw_cursor(ms.x, ms.y);
-    vga_flip();
+    vga_rect_t dmg[VGA_MAX_DAMAGE];
+    int n = vga_damage_get(dmg, VGA_MAX_DAMAGE);
+    fp_frame_begin();
+    for (int i = 0; i < n; i++) {
+        vga_bb_set_clip(dmg[i].x, dmg[i].y, dmg[i].w, dmg[i].h);
+        draw_scene();
+    }
+    vga_bb_reset_clip();
+    { FP_SCOPE(FP_FLIP); vga_flip_rects(dmg, n); }
+    fp_frame_end();
+    vga_damage_clear();
+    hover_x = ms.x; hover_y = ms.y;
+    telemetry_note_frame(timer_get_ms() - t0);
+}
+
+/* ── Frame pacing ─────────────────────────────────────────── */
+/* At most one composite per refresh interval: damage raised between
+ * frames accumulates in the damage list and goes out together, so a
+ * burst of mouse packets costs one frame. VESA linear framebuffers
+ * give no usable retrace bit, so the interval is timed off the TSC
+ * clock. A frame that overran the interval marks the next ones as
+ * over budget, and decorative animation holds still until one fits. */
+#define FRAME_HZ 60
+#define FRAME_US (1000000 / FRAME_HZ)
+
+static uint32_t frame_last_us = 0;      /* start of the last composite */
+static int      frame_over_budget = 0;
+
+static int frame_due(void) {
+    return timer_get_us() - frame_last_us >= FRAME_US;
+}
+
+static void frame_present(void) {
+    uint32_t t0 = timer_get_us();
+    draw_desktop();
+    frame_last_us = t0;
+    frame_over_budget = timer_get_us() - t0 > FRAME_US;
+}
+
+/* ── Profiler overlay (F3) ────────────────────────────────── */
+/* Shows the previous frames' numbers, so it is drawn last and is
+ * itself counted in the frame total. While it is open its area is
+ * damaged every frame to keep the figures live. */
+#define PROF_X 40
+#define PROF_Y 100
+#define PROF_W 420
+#define PROF_ROW 18
+
+static int prof_overlay = 0;
+
+static int prof_height(void) {
+    int rows = 3 + FP_PASSES + 1;
+    for (int i = 0; i < MAX_WINDOWS; i++)
+        if (windows[i].active && windows[i].workspace == current_workspace) rows++;
+    return 16 + rows * PROF_ROW + 60;
+}
+
+/* "12.34ms" */
+static void fmt_ms(char *out, uint32_t us) {
+    char t[12];
+    itoa((int)(us / 1000), out, 10);
+    strcat(out, ".");
+    uint32_t frac = (us % 1000) / 10;
+    if (frac < 10) strcat(out, "0");
+    itoa((int)frac, t, 10);
+    strcat(out, t);
+    strcat(out, "ms");
+}
+
+static void prof_line(int y, const char *label, uint32_t last_us, uint32_t avg_us, uint32_t color) {
+    char b[16];
+    vga_bb_draw_string(PROF_X + 12, y, label, color, 0);
+    b[0] = '\0'; fmt_ms(b, last_us);
+    vga_bb_draw_string(PROF_X + 140, y, b, S_TEXT, 0);
+    b[0] = '\0'; fmt_ms(b, avg_us);
+    vga_bb_draw_string(PROF_X + 230, y, b, S_TEXT_DIM, 0);
+    /* Bar: average against the frame budget */
+    int bw = (int)(avg_us * 90 / FRAME_US);
+    if (bw > 90) bw = 90;
+    vga_bb_fill_rect(PROF_X + 318, y, 90, 8, 0x30FFFFFF);
+    vga_bb_fill_rect(PROF_X + 318, y, bw, 8, avg_us > FRAME_US ? S_PINK : color);
+}
+
+static void draw_profiler(void) {
+    if (!prof_overlay) return;
+    fp_stats_t st; fp_get_stats(&st);
+    int h = prof_height();
+    vga_bb_fill_rounded_rect(PROF_X, PROF_Y, PROF_W, h, 10, 0xE0101018);
+    vga_bb_draw_rect_outline(PROF_X, PROF_Y, PROF_W, h, S_NEON_CYAN);
+
+    int y = PROF_Y + 10;
+    char line[64], b[16];
+    vga_bb_draw_string(PROF_X + 12, y, "FRAME PROFILER (F3)", S_NEON_CYAN, 0);
+    vga_bb_draw_string(PROF_X + 230, y, "avg", S_TEXT_DIM, 0);
+    y += PROF_ROW;
+
+    strcpy(line, "frame "); b[0] = '\0'; fmt_ms(b, st.frame_us); strcat(line, b);
+    strcat(line, "  p50 "); b[0] = '\0'; fmt_ms(b, st.p50_us); strcat(line, b);
+    vga_bb_draw_string(PROF_X + 12, y, line, S_TEXT, 0);
+    y += PROF_ROW;
+    strcpy(line, "p95 "); b[0] = '\0'; fmt_ms(b, st.p95_us); strcat(line, b);
+    strcat(line, "  p99 "); b[0] = '\0'; fmt_ms(b, st.p99_us); strcat(line, b);
+    strcat(line, "  max "); b[0] = '\0'; fmt_ms(b, st.worst_us); strcat(line, b);
+    vga_bb_draw_string(PROF_X + 12, y, line, st.p95_us > FRAME_US ? S_PINK : S_TEXT, 0);
+    y += PROF_ROW + 4;
+
+    for (int p = 0; p < FP_PASSES; p++) {
+        prof_line(y, fp_pass_name(p), st.last_us[p], st.avg_us[p], S_NEON_CYAN);
+        y += PROF_ROW;
+        if (p != FP_WINDOWS) continue;
+        /* Each window under the windows total */
+        for (int i = 0; i < MAX_WINDOWS; i++) {
+            if (!windows[i].active || windows[i].workspace != current_workspace) continue;
+            strcpy(line, "  ");
+            strncpy(line + 2, windows[i].title, 14);
+            line[16] = '\0';
+            prof_line(y, line, st.window_us[i], st.window_us[i], S_NEON_PURPLE);
+            y += PROF_ROW;
+        }
+    }
+
+    /* Frame-time histogram over the history, FP_HIST_US per bucket */
+    y += 6;
+    int max = 1;
+    for (int i = 0; i < FP_HIST_BUCKETS; i++) if (st.hist[i] > max) max = st.hist[i];
+    int bw = (PROF_W - 24) / FP_HIST_BUCKETS;
+    for (int i = 0; i < FP_HIST_BUCKETS; i++) {
+        int bh = st.hist[i] * 40 / max;
+        uint32_t c = (uint32_t)i * FP_HIST_US >= FRAME_US ? S_PINK : S_NEON_CYAN;
+        vga_bb_fill_rect(PROF_X + 12 + i * bw, y + 40 - bh, bw - 2, bh, c);
+    }
 }
 
 /* ── Main loop ────────────────────────────────────────────── */
 void desktop_run(void) {
     serial_write("desktop_run: start\n"); screen_set_serial_mirror(0xFF000000);
-    memset(windows,0,sizeof(windows)); win_count=0; win_focus=-1; win_order_count=0; kickoff_open=0; dragging=0; wp_cached=0;
+    for (int i=0;i<MAX_WINDOWS;i++) { free_window_surface(i); if (windows[i].ai_stream) llm_query_cancel(windows[i].ai_stream); }
+    memset(windows,0,sizeof(windows)); win_count=0; win_focus=-1; win_order_count=0; kickoff_open=0; dragging=0; ui_wallpaper_invalidate();
     memset(toasts, 0, sizeof(toasts));
     audit_log(AUDIT_SYSTEM, "Desktop started");
     /* Welcome splash */
     toast_show("Welcome to SwanOS!", S_NEON_CYAN);
     toast_show("Where Love Meets Technology", S_PINK);
     open_window(WIN_ABOUT); open_window(WIN_TERM);
-    draw_desktop();
+    install_cursor();
+    vga_damage_all();
+    frame_present();
     uint32_t last_draw=0; int needs_redraw=1;
     serial_write("desktop_run: enter loop\n");
 
@@ -2829,11 +3169,33 @@ void desktop_run(void) {
     uint32_t sysmon_tick = 0;
 
     while (1) {
+        /* One discrete event per pass: keys, button transitions and
+         * wheel steps keep their order. Plain motion is skipped; hover
+         * and drag follow the latest pointer state, repainted once per
+         * frame however many packets arrived. */
+        input_event_t ev;
+        int have_ev;
+        while ((have_ev = input_poll(&ev)) &&
+               ev.type == INPUT_MOUSE && !ev.pressed && !ev.released && !ev.wheel)
+            ;
         mouse_state_t ms; mouse_get_state(&ms);
-        int l_click = (ms.clicked && (ms.buttons & 1));
-        int r_click = (ms.clicked && (ms.buttons & 2));
-        if (ms.clicked) mouse_clear_events();
-        
+        int mouse_ev = have_ev && ev.type == INPUT_MOUSE;
+        uint8_t pressed = mouse_ev ? ev.pressed : 0;
+        if (pressed) { ms.x = ev.x; ms.y = ev.y; }   /* where the press happened */
+        int l_click = pressed & 1;
+        int r_click = pressed & 2;
+
+        /* Wheel: scroll the file list under the pointer */
+        if (mouse_ev && ev.wheel) {
+            int wi = window_at(ev.x, ev.y);
+            if (wi >= 0 && windows[wi].type == WIN_FILES) {
+                window_t *fw = &windows[wi];
+                fw->file_sel += ev.wheel;
+                if (fw->file_sel < 0) fw->file_sel = 0;
+                refresh_window(wi);
+            }
+        }
+
         if (r_click) {
             /* Right click on taskbar → toggle rearrange mode */
             if (ms.y >= dock_y && ms.y < dock_y + PANEL_H &&
@@ -2852,16 +3214,18 @@ void desktop_run(void) {
         else if (l_click && ctx_menu_open) {
              /* Left click might click context menu items or dismiss it */
             handle_click(ms.x, ms.y);
+            invalidate_all_windows();
             needs_redraw = 1;
         }
         else if (l_click) {
             if (!dragging) {
                 int lr=handle_click(ms.x,ms.y);
-                if (lr==-1) { screen_init(); screen_set_serial_mirror(1); screen_clear();
+                if (lr==-1) { vga_cursor_show(0); screen_init(); screen_set_serial_mirror(1); screen_clear();
                     screen_set_color(VGA_DARK_GREY,VGA_BLACK); screen_print("\n\n   Shutting down...\n");
-                    screen_delay(500); __asm__ volatile("cli; hlt"); while(1); }
-                if (lr==-4) { game_snake(); wp_cached=0; }
+                    screen_delay(500); audit_drain(); __asm__ volatile("cli; hlt"); while(1); }
+                if (lr==-4) { vga_cursor_show(0); game_snake(); vga_cursor_show(1); }
             }
+            invalidate_all_windows();
             needs_redraw=1;
         }
         if (dragging) {
@@ -2870,12 +3234,28 @@ void desktop_run(void) {
                 if(nx<0)nx=0; if(ny<0)ny=0;
                 if(nx+windows[drag_win].w>SCRW) nx=SCRW-windows[drag_win].w;
                 if(ny+windows[drag_win].h>SCRH-80) ny=SCRH-80-windows[drag_win].h;
-                windows[drag_win].x=nx; windows[drag_win].y=ny; needs_redraw=1;
+                if (nx != windows[drag_win].x || ny != windows[drag_win].y) {
+                    damage_window(drag_win);
+                    windows[drag_win].x=nx; windows[drag_win].y=ny;
+                    damage_window(drag_win);
+                }
             } else dragging=0;
         }
-        if (ms.moved) needs_redraw = 1;
-        if (keyboard_has_key()) {
-            char c=keyboard_getchar(); needs_redraw=1;
+        /* Pointer motion: the overlay moves the cursor; repaint hover targets */
+        if (ms.x != hover_x || ms.y != hover_y) {
+            damage_hover(hover_x, hover_y);
+            damage_hover(ms.x, ms.y);
+        }
+        if (have_ev && ev.type == INPUT_KEY) {
+            char c=(char)ev.key;
+            if (cmdpal_open || win_focus < 0 || (uint8_t)c == KEY_F1 ||
+                (uint8_t)c == KEY_F2 || (uint8_t)c == KEY_F3 ||
+                (uint8_t)c == KEY_CTRL_SPACE) {
+                invalidate_all_windows();
+                needs_redraw = 1;
+            }
+            else
+                refresh_window(win_focus);
             /* ── System-wide hotkeys (before window dispatch) ── */
             if ((uint8_t)c == KEY_F1) {
                 narrator_active = !narrator_active;
@@ -2893,6 +3273,10 @@ void desktop_run(void) {
                 } else {
                     toast_show("High Contrast OFF", S_TEXT_DIM);
                 }
+            } else if ((uint8_t)c == KEY_F3) {
+                prof_overlay = !prof_overlay;
+                toast_show(prof_overlay ? "Profiler ON" : "Profiler OFF",
+                           prof_overlay ? S_NEON_CYAN : S_TEXT_DIM);
             } else if ((uint8_t)c == KEY_CTRL_SPACE) {
                 cmdpal_open = !cmdpal_open;
                 if (cmdpal_open) {
@@ -2905,23 +3289,26 @@ void desktop_run(void) {
                 if (c == 27) { /* Escape */
                     cmdpal_open = 0;
                 } else if (c == '\n' && cmdpal_input_pos > 0 && !cmdpal_thinking) {
-                    /* Submit query to LLM */
                     cmdpal_thinking = 1;
                     cmdpal_has_result = 0;
-                    /* Build intent-aware system prompt */
-                    char sys_prompt[256];
-                    strcpy(sys_prompt, "You are SwanOS AI. Parse user intent. "
-                        "If they want to open an app, respond with [OPEN:appname]. "
-                        "Apps: terminal,files,notes,about,ai,calc,sysmon,browser,network,audit,draw,clock. "
-                        "If they ask the time, respond [TIME]. "
-                        "If they ask about memory, respond [MEM]. "
-                        "Otherwise give a brief answer under 30 words.");
-                    llm_set_system_prompt(sys_prompt);
-                    char rsp[512];
-                    llm_query(cmdpal_input, rsp, sizeof(rsp));
-                    llm_set_system_prompt("You are SwanOS AI, an intelligent assistant. Keep answers concise.");
-                    /* Parse intent */
-                    ai_intent_t intent = kernel_ai_parse_intent(rsp);
+                    /* Common actions resolve locally; the rest go to the LLM */
+                    ai_intent_t intent = kernel_ai_classify_local(cmdpal_input);
+                    if (intent.action == AI_ACTION_NONE) {
+                        /* Build intent-aware system prompt */
+                        char sys_prompt[256];
+                        strcpy(sys_prompt, "You are SwanOS AI. Parse user intent. "
+                            "If they want to open an app, respond with [OPEN:appname]. "
+                            "Apps: terminal,files,notes,about,ai,calc,sysmon,browser,network,audit,draw,clock. "
+                            "If they ask the time, respond [TIME]. "
+                            "If they ask about memory, respond [MEM]. "
+                            "Otherwise give a brief answer under 30 words.");
+                        llm_set_system_prompt(sys_prompt);
+                        char rsp[512];
+                        llm_query(cmdpal_input, rsp, sizeof(rsp));
+                        llm_set_system_prompt("You are SwanOS AI, an intelligent assistant. Keep answers concise.");
+                        /* Parse intent */
+                        intent = kernel_ai_parse_intent(rsp);
+                    }
                     cmdpal_action = intent.action;
                     cmdpal_action_app = intent.app_id;
                     strncpy(cmdpal_result, intent.answer, 127);
@@ -2935,7 +3322,7 @@ void desktop_run(void) {
                         strcpy(cmdpal_result, "Opened ");
                         strcat(cmdpal_result, kernel_ai_get_app_description(intent.app_id));
                     } else if (intent.action == AI_ACTION_TIME) {
-                        rtc_time_t rtc; rtc_read(&rtc);
+                        rtc_time_t rtc; time_now(&rtc);
                         char tb[32]; char tn[6];
                         strcpy(tb, "");
                         itoa(rtc.hour, tn, 10); strcat(tb, tn); strcat(tb, ":");
@@ -2986,9 +3373,8 @@ void desktop_run(void) {
                     if((uint8_t)c==KEY_DOWN) fw->file_sel++;
                 } else if (fw->type==WIN_AI) {
                     if(c=='\n'){if(fw->input_pos>0){
-                        char echo[44];strcpy(echo,"> ");strcat(echo,fw->input);term_add_line(fw,echo);term_add_line(fw,"[AI] ...");
-                        char rsp[512];llm_query(fw->input,rsp,sizeof(rsp));if(fw->line_count>0)fw->line_count--;
-                        char *rp=rsp;while(*rp){char ln[40];int li=0;while(*rp&&*rp!='\n'&&li<38)ln[li++]=*rp++;ln[li]='\0';if(li>0)term_add_line(fw,ln);if(*rp=='\n')rp++;}
+                        char echo[44];strcpy(echo,"> ");strcat(echo,fw->input);term_add_line(fw,echo);
+                        term_stream_start(fw,fw->input);
                         fw->input_pos=0;fw->input[0]='\0'; suggestion_active=0; suggestion_text[0]='\0';}}
                     else if(c=='\b'){if(fw->input_pos>0){fw->input_pos--;fw->input[fw->input_pos]='\0';} suggestion_active=0;}
                     else if(c>=' '&&fw->input_pos<78){fw->input[fw->input_pos++]=c;fw->input[fw->input_pos]='\0'; suggestion_tick=timer_get_ticks(); suggestion_active=0;}
@@ -2996,10 +3382,9 @@ void desktop_run(void) {
             }
         }
         uint32_t ticks=timer_get_ticks();
-        /* Animated wallpaper periodic refresh */
-        if (ticks - wp_last_tick > 150) {
+        /* Animated wallpaper periodic refresh (decorative) */
+        if (!frame_over_budget && ticks - wp_last_tick > 150) {
             wp_phase += 16;
-            wp_cached = 0;
             wp_last_tick = ticks;
             needs_redraw = 1;
         }
@@ -3007,8 +3392,12 @@ void desktop_run(void) {
         /* SwanClock: force redraw while stopwatch is running */
         for (int i=0; i<MAX_WINDOWS; i++) {
             if (windows[i].active && windows[i].type == WIN_CLOCK && windows[i].clock_sw_running)
-                needs_redraw = 1;
+                refresh_window(i);
+            /* Open animation runs for 20 ticks (decorative) */
+            if (!frame_over_budget && windows[i].active && ticks - windows[i].open_anim_tick <= 21)
+                refresh_window(i);
         }
+        damage_toasts();
 
         /* SwanDraw: continuous painting while mouse held down */
         if ((ms.buttons & 1) && !dragging && win_focus >= 0 && windows[win_focus].active && windows[win_focus].type == WIN_DRAW) {
@@ -3024,7 +3413,7 @@ void desktop_run(void) {
                 int ppy = (ms.y - cvy3) / ceh3;
                 if (ppx >= 0 && ppx < 64 && ppy >= 0 && ppy < 48) {
                     int pidx = ppy * 64 + ppx;
-                    if (pidx < 512) { dw->note_text[pidx] = (char)(dw->draw_color + 1); needs_redraw = 1; }
+                    if (pidx < 512) { dw->note_text[pidx] = (char)(dw->draw_color + 1); refresh_window(win_focus); }
                 }
             }
         }
@@ -3035,7 +3424,7 @@ void desktop_run(void) {
                 if (windows[i].active && windows[i].type == WIN_SYSMON) {
                     windows[i].sysmon_history[windows[i].sysmon_head] = mem_used() / 1024;
                     windows[i].sysmon_head = (windows[i].sysmon_head + 1) % 60;
-                    needs_redraw = 1;
+                    refresh_window(i);
                 }
             }
             /* Update tray memory sparkline (every ~2 sec use same tick) */
@@ -3046,16 +3435,16 @@ void desktop_run(void) {
                 tray_mem_history[tray_mem_head] = pct;
                 tray_mem_head = (tray_mem_head + 1) % 20;
                 tray_mem_tick = ticks;
-                needs_redraw = 1;
+                damage_rect(0, DOCK_BAND_Y, SCRW, 1);
             }
             sysmon_tick = ticks;
             /* Periodic user profile save */
             user_periodic_save();
-            /* Stopwatch tick for SwanClock */
+            /* Stopwatch tick for SwanClock; the face shows seconds */
             for (int i=0; i<MAX_WINDOWS; i++) {
-                if (windows[i].active && windows[i].type == WIN_CLOCK && windows[i].calc_op) {
-                    windows[i].calc_v1++;
-                    needs_redraw = 1;
+                if (windows[i].active && windows[i].type == WIN_CLOCK) {
+                    if (windows[i].calc_op) windows[i].calc_v1++;
+                    refresh_window(i);
                 }
             }
 
@@ -3110,7 +3499,7 @@ void desktop_run(void) {
             if (win_focus >= 0 && windows[win_focus].active) {
                 int ft = windows[win_focus].type;
                 if (ft == WIN_TERM || ft == WIN_AI || ft == WIN_NOTES)
-                    needs_redraw = 1;
+                    refresh_window(win_focus);
             }
             /* Command palette cursor blink + thinking animation */
             if (cmdpal_open) needs_redraw = 1;
@@ -3118,11 +3507,18 @@ void desktop_run(void) {
 
         /* Clock update — check every second instead of every tick */
         if (ticks - last_draw > 50) {
-            rtc_time_t rtc; rtc_read(&rtc);
-            if (rtc.minute != last_minute) { last_minute = rtc.minute; needs_redraw = 1; }
+            rtc_time_t rtc; time_now(&rtc);
+            if (rtc.minute != last_minute) { last_minute = rtc.minute; invalidate_all_windows(); needs_redraw = 1; }
         }
 
-        if (needs_redraw || dragging) { draw_desktop(); needs_redraw = 0; last_draw = ticks; }
-        __asm__ volatile("hlt");
+        term_stream_poll();
+
+        if (prof_overlay && frame_due()) damage_rect(PROF_X, PROF_Y, PROF_W, prof_height());
+        if (needs_redraw) { vga_damage_all(); needs_redraw = 0; }
+        if (vga_damage_pending() && frame_due()) { frame_present(); last_draw = ticks; }
+        /* Checked with IRQs off; "sti; hlt" cannot miss a raise */
+        __asm__ volatile("cli");
+        if (!input_pending()) __asm__ volatile("sti; hlt");
+        else __asm__ volatile("sti");
     }
 }
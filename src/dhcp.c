@@ -0,0 +1,168 @@
+/* ============================================================
+ * SwanOS — DHCP Client
+ * Gets the address, netmask, gateway and DNS server for the
+ * inet stack and keeps the lease renewed.
+ * ============================================================ */
+
+#include "dhcp.h"
+#include "inet.h"
+#include "netdev.h"
+#include "timer.h"
+#include "string.h"
+#include "cpu.h"
+
+#define DHCP_SERVER_PORT 67
+#define DHCP_CLIENT_PORT 68
+#define DHCP_MAGIC       0x63825363
+#define DHCP_FIXED       236    /* op .. file, before the magic cookie */
+
+#define DHCPDISCOVER 1
+#define DHCPOFFER    2
+#define DHCPREQUEST  3
+#define DHCPACK      5
+#define DHCPNAK      6
+
+enum { D_IDLE, D_SELECTING, D_REQUESTING, D_BOUND, D_RENEWING };
+
+static int      state = D_IDLE;
+static int      bound_port = 0;
+static uint32_t xid;
+static uint32_t wait_ticks;     /* until the next retry, or the renewal */
+static ip4_t    offered, server;
+static uint32_t lease = 0;
+
+static void put32(uint8_t *p, uint32_t v) {
+    p[0] = (uint8_t)(v >> 24); p[1] = (uint8_t)(v >> 16);
+    p[2] = (uint8_t)(v >> 8);  p[3] = (uint8_t)v;
+}
+
+static uint32_t be32(const uint8_t *p) {
+    return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3];
+}
+
+static uint8_t *opt_ip(uint8_t *o, uint8_t code, ip4_t a) {
+    o[0] = code; o[1] = 4;
+    memcpy(o + 2, &a, 4);
+    return o + 6;
+}
+
+static void send_msg(uint8_t type) {
+    static uint8_t m[DHCP_FIXED + 64];
+    netdev_t *dev = netdev_get();
+    memset(m, 0, sizeof(m));
+    m[0] = 1;                           /* BOOTREQUEST */
+    m[1] = 1;                           /* Ethernet */
+    m[2] = 6;
+    put32(m + 4, xid);
+    if (state == D_RENEWING) {
+        ip4_t ci = inet_config()->addr;
+        memcpy(m + 12, &ci, 4);
+    } else {
+        m[10] = 0x80;                   /* broadcast the reply: no address yet */
+    }
+    memcpy(m + 28, dev->mac, 6);
+    put32(m + DHCP_FIXED, DHCP_MAGIC);
+
+    uint8_t *o = m + DHCP_FIXED + 4;
+    *o++ = 53; *o++ = 1; *o++ = type;
+    if (type == DHCPREQUEST && state == D_REQUESTING) {
+        o = opt_ip(o, 50, offered);
+        o = opt_ip(o, 54, server);
+    }
+    *o++ = 55; *o++ = 3; *o++ = 1; *o++ = 3; *o++ = 6;   /* mask, router, DNS */
+    *o++ = 255;
+
+    ip4_t dst = state == D_RENEWING ? server : IP4_BROADCAST;
+    udp_send(dst, DHCP_CLIENT_PORT, DHCP_SERVER_PORT, m, (int)(o - m));
+}
+
+static void discover(void) {
+    state = D_SELECTING;
+    xid = (uint32_t)rdtsc();
+    wait_ticks = DHCP_RETRY_TICKS;
+    send_msg(DHCPDISCOVER);
+}
+
+static void dhcp_input(ip4_t src, uint16_t sport, const uint8_t *m, int len) {
+    (void)src;
+    if (sport != DHCP_SERVER_PORT || len < DHCP_FIXED + 4 || m[0] != 2) return;
+    if (be32(m + 4) != xid || be32(m + DHCP_FIXED) != DHCP_MAGIC) return;
+
+    uint8_t type = 0;
+    ip4_t mask = 0, router = 0, dns = 0, sid = 0;
+    uint32_t secs = 0;
+    const uint8_t *o = m + DHCP_FIXED + 4, *end = m + len;
+    while (o < end && *o != 255) {
+        if (*o == 0) { o++; continue; }
+        if (o + 2 > end || o + 2 + o[1] > end) break;
+        const uint8_t *v = o + 2;
+        switch (o[0]) {
+            case 53: if (o[1] >= 1) type = v[0]; break;
+            case 1:  if (o[1] >= 4) memcpy(&mask, v, 4); break;
+            case 3:  if (o[1] >= 4) memcpy(&router, v, 4); break;
+            case 6:  if (o[1] >= 4) memcpy(&dns, v, 4); break;
+            case 54: if (o[1] >= 4) memcpy(&sid, v, 4); break;
+            case 51: if (o[1] >= 4) secs = be32(v); break;
+        }
+        o += 2 + o[1];
+    }
+
+    ip4_t yi;
+    memcpy(&yi, m + 16, 4);
+    if (state == D_SELECTING && type == DHCPOFFER && yi) {
+        offered = yi;
+        server = sid;
+        state = D_REQUESTING;
+        wait_ticks = DHCP_RETRY_TICKS;
+        send_msg(DHCPREQUEST);
+    } else if ((state == D_REQUESTING || state == D_RENEWING) && type == DHCPACK && yi) {
+        if (!mask) mask = IP4(255, 255, 255, 0);
+        inet_configure(yi, mask, router, dns);
+        if (sid) server = sid;
+        lease = secs ? secs : 3600;
+        if (lease > 0x00FFFFFF) lease = 0x00FFFFFF;     /* keeps the tick count in range */
+        state = D_BOUND;
+        wait_ticks = lease * (1000 / INET_TICK_MS) / 2;
+    } else if (type == DHCPNAK && (state == D_REQUESTING || state == D_RENEWING)) {
+        inet_configure(0, 0, 0, 0);
+        discover();
+    }
+}
+
+void dhcp_tick(void) {
+    if (state == D_IDLE) return;
+    if (wait_ticks && --wait_ticks) return;
+    switch (state) {
+        case D_SELECTING:
+        case D_REQUESTING:
+            discover();
+            break;
+        case D_BOUND:
+            state = D_RENEWING;
+            wait_ticks = DHCP_RETRY_TICKS;
+            send_msg(DHCPREQUEST);
+            break;
+        case D_RENEWING:
+            discover();                 /* server gone: keep the address, look again */
+            break;
+    }
+}
+
+void dhcp_start(void) {
+    if (!bound_port && udp_bind(DHCP_CLIENT_PORT, dhcp_input) == 0) bound_port = 1;
+    lease = 0;
+    state = D_SELECTING;
+    wait_ticks = 1;                     /* first DISCOVER on the next tick */
+}
+
+void dhcp_stop(void) {
+    state = D_IDLE;
+}
+
+int dhcp_bound(void) {
+    return state == D_BOUND || state == D_RENEWING;
+}
+
+uint32_t dhcp_lease(void) {
+    return lease;
+}
@@ -0,0 +1,19 @@
+#ifndef DHCP_H
+#define DHCP_H
+
+#include <stdint.h>
+
+/* ── DHCP client ──────────────────────────────────────────────
+ * DISCOVER / OFFER / REQUEST / ACK on UDP 68, retried every
+ * DHCP_RETRY_TICKS until an offer is taken, then renewed with the
+ * same server at half the lease. Stop the client before setting
+ * an address by hand; dhcp_start begins again from DISCOVER.     */
+#define DHCP_RETRY_TICKS 20     /* inet ticks */
+
+void dhcp_start(void);
+void dhcp_stop(void);
+void dhcp_tick(void);           /* inet bottom half */
+int  dhcp_bound(void);
+uint32_t dhcp_lease(void);      /* seconds granted, 0 before an ACK */
+
+#endif
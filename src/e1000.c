@@ -0,0 +1,285 @@
+/* ============================================================
+ * SwanOS — Intel e1000 NIC Driver
+ * Legacy descriptor rings over pool buffers (netbuf.h): the device
+ * DMAs received frames straight into the buffers handed up the
+ * stack and reads sent frames from the caller's buffer. Interrupts
+ * are rate-limited by the ITR and masked while the bottom half
+ * drains the rings.
+ * ============================================================ */
+
+#include "e1000.h"
+#include "netdev.h"
+#include "pci.h"
+#include "memory.h"
+#include "paging.h"
+#include "spinlock.h"
+#include "idt.h"
+#include "timer.h"
+#include "string.h"
+#include "serial.h"
+
+/* ── Registers ────────────────────────────────────────────── */
+#define REG_CTRL    0x0000
+#define REG_STATUS  0x0008
+#define REG_ICR     0x00C0      /* read clears */
+#define REG_ITR     0x00C4
+#define REG_IMS     0x00D0
+#define REG_IMC     0x00D8
+#define REG_RCTL    0x0100
+#define REG_TCTL    0x0400
+#define REG_TIPG    0x0410
+#define REG_RDBAL   0x2800
+#define REG_RDBAH   0x2804
+#define REG_RDLEN   0x2808
+#define REG_RDH     0x2810
+#define REG_RDT     0x2818
+#define REG_RDTR    0x2820
+#define REG_RADV    0x282C
+#define REG_TDBAL   0x3800
+#define REG_TDBAH   0x3804
+#define REG_TDLEN   0x3808
+#define REG_TDH     0x3810
+#define REG_TDT     0x3818
+#define REG_MTA     0x5200
+#define REG_RAL0    0x5400
+#define REG_RAH0    0x5404
+
+#define CTRL_ASDE   (1u << 5)
+#define CTRL_SLU    (1u << 6)
+#define CTRL_RST    (1u << 26)
+#define STATUS_LU   (1u << 1)
+
+#define RCTL_EN     (1u << 1)
+#define RCTL_BAM    (1u << 15)  /* accept broadcast */
+#define RCTL_SECRC  (1u << 26)  /* strip the FCS */
+#define TCTL_EN     (1u << 1)
+#define TCTL_PSP    (1u << 3)   /* pad short packets */
+
+#define INT_TXDW    (1u << 0)
+#define INT_LSC     (1u << 2)
+#define INT_RXDMT0  (1u << 4)
+#define INT_RXO     (1u << 6)
+#define INT_RXT0    (1u << 7)
+#define INT_MASK    (INT_TXDW | INT_LSC | INT_RXDMT0 | INT_RXO | INT_RXT0)
+
+#define TX_CMD_EOP  0x01
+#define TX_CMD_IFCS 0x02        /* append the FCS */
+#define TX_CMD_RS   0x08        /* report status */
+#define DESC_DD     0x01        /* descriptor done, RX and TX */
+
+/* Moderation: at most ~8000 interrupts/s (ITR counts 256 ns), and
+ * a received frame waits up to ~32 us for company (1.024 us units) */
+#define ITR_INTERVAL 488
+#define RX_DELAY     32
+
+/* ── Descriptor rings ─────────────────────────────────────── */
+#define RX_RING 128             /* 16-byte descriptors: one page each */
+#define TX_RING 128
+
+typedef struct {
+    uint64_t addr;
+    uint16_t length;
+    uint16_t csum;
+    uint8_t  status;
+    uint8_t  errors;
+    uint16_t special;
+} __attribute__((packed)) rx_desc_t;
+
+typedef struct {
+    uint64_t addr;
+    uint16_t length;
+    uint8_t  cso;
+    uint8_t  cmd;
+    uint8_t  status;
+    uint8_t  css;
+    uint16_t special;
+} __attribute__((packed)) tx_desc_t;
+
+static volatile uint8_t *mmio;
+static volatile rx_desc_t *rx_ring;
+static volatile tx_desc_t *tx_ring;
+static netbuf_t *rx_bufs[RX_RING];
+static netbuf_t *tx_bufs[TX_RING];
+static uint32_t rx_next = 0;            /* next descriptor the device completes */
+static uint32_t tx_tail = 0, tx_clean = 0;
+static spinlock_t tx_lock = SPINLOCK_INIT;
+static netdev_t e1000_dev;
+
+static inline uint32_t rd(uint32_t reg) {
+    return *(volatile uint32_t *)(mmio + reg);
+}
+
+static inline void wr(uint32_t reg, uint32_t val) {
+    *(volatile uint32_t *)(mmio + reg) = val;
+}
+
+static void update_link(void) {
+    uint32_t st = rd(REG_STATUS);
+    static const int speeds[4] = { 10, 100, 1000, 1000 };
+    e1000_dev.link_up = (st & STATUS_LU) != 0;
+    e1000_dev.speed = speeds[(st >> 6) & 3];
+}
+
+/* ── Transmit ─────────────────────────────────────────────── */
+
+/* Give back buffers the device has finished reading; tx_lock held */
+static void tx_reclaim(void) {
+    while (tx_clean != tx_tail && (tx_ring[tx_clean].status & DESC_DD)) {
+        netbuf_free(tx_bufs[tx_clean]);
+        tx_bufs[tx_clean] = 0;
+        tx_clean = (tx_clean + 1) % TX_RING;
+    }
+}
+
+static int e1000_xmit(netdev_t *dev, netbuf_t *b) {
+    (void)dev;
+    uint32_t flags = spin_lock_irqsave(&tx_lock);
+    uint32_t next = (tx_tail + 1) % TX_RING;
+    if (next == tx_clean) tx_reclaim();
+    if (next == tx_clean) {
+        spin_unlock_irqrestore(&tx_lock, flags);
+        return -1;
+    }
+    volatile tx_desc_t *d = &tx_ring[tx_tail];
+    d->addr = (uint32_t)b->data;
+    d->length = b->len;
+    d->cmd = TX_CMD_EOP | TX_CMD_IFCS | TX_CMD_RS;
+    d->status = 0;
+    tx_bufs[tx_tail] = b;
+    tx_tail = next;
+    wr(REG_TDT, tx_tail);       /* uncached store, after the descriptor */
+    spin_unlock_irqrestore(&tx_lock, flags);
+    return 0;
+}
+
+/* ── Receive ──────────────────────────────────────────────── */
+
+/* Completed descriptors: pass the filled buffer up and put a fresh
+ * one in its place. Without a fresh one the frame is dropped and the
+ * buffer goes straight back, so the ring never runs dry. */
+static int rx_harvest(int budget) {
+    int n = 0;
+    uint32_t last = RX_RING;
+    while (n < budget && (rx_ring[rx_next].status & DESC_DD)) {
+        volatile rx_desc_t *d = &rx_ring[rx_next];
+        netbuf_t *b = rx_bufs[rx_next];
+        netbuf_t *fresh = d->errors ? 0 : netbuf_alloc();
+        if (fresh) {
+            b->data = b->head;
+            b->len = d->length;
+            netdev_rx(&e1000_dev, b);
+            rx_bufs[rx_next] = fresh;
+        } else {
+            netdev_rx_drop(&e1000_dev);
+        }
+        d->addr = (uint32_t)rx_bufs[rx_next]->head;
+        d->status = 0;
+        last = rx_next;
+        rx_next = (rx_next + 1) % RX_RING;
+        n++;
+    }
+    if (last != RX_RING) wr(REG_RDT, last);
+    return n;
+}
+
+static int e1000_poll(netdev_t *dev) {
+    (void)dev;
+    uint32_t flags = spin_lock_irqsave(&tx_lock);
+    tx_reclaim();
+    spin_unlock_irqrestore(&tx_lock, flags);
+    update_link();
+    if (rx_harvest(NET_POLL_BUDGET) == NET_POLL_BUDGET) return 1;
+
+    /* Unmask; a frame that landed after the harvest raises a fresh
+     * interrupt, so nothing is left waiting */
+    wr(REG_IMS, INT_MASK);
+    return 0;
+}
+
+/* ── IRQ top half ─────────────────────────────────────────── */
+
+static void e1000_callback(registers_t *regs) {
+    (void)regs;
+    uint32_t cause = rd(REG_ICR);          /* acknowledges */
+    if (!(cause & INT_MASK)) return;        /* shared line, not ours */
+    wr(REG_IMC, INT_MASK);                  /* quiet until the bottom half ran */
+    netdev_schedule(&e1000_dev);
+}
+
+/* ── Bring-up ─────────────────────────────────────────────── */
+
+static int rings_init(void) {
+    rx_ring = (volatile rx_desc_t *)pmm_alloc_page_flags(PMM_ZERO);
+    tx_ring = (volatile tx_desc_t *)pmm_alloc_page_flags(PMM_ZERO);
+    if (!rx_ring || !tx_ring) return -1;
+    for (int i = 0; i < RX_RING; i++) {
+        rx_bufs[i] = netbuf_alloc();
+        if (!rx_bufs[i]) return -1;
+        rx_ring[i].addr = (uint32_t)rx_bufs[i]->head;
+    }
+    return 0;
+}
+
+int e1000_probe(const pci_device_t *pci) {
+    if ((pci->bar_io & 1) || !pci->bar_size[0]) return -1;  /* want the memory BAR */
+    uint32_t base = pci->bar[0];
+    if (netbuf_init() < 0) return -1;
+
+    pci_enable(pci, PCI_CMD_MEMORY | PCI_CMD_MASTER);
+    paging_map_mmio(base, pci->bar_size[0]);
+    mmio = (volatile uint8_t *)base;
+
+    /* Reset, then force the link up with speed auto-detect */
+    wr(REG_IMC, 0xFFFFFFFF);
+    wr(REG_CTRL, rd(REG_CTRL) | CTRL_RST);
+    uint32_t t0 = timer_get_ticks();
+    while ((rd(REG_CTRL) & CTRL_RST) && timer_get_ticks() - t0 < 10) { }
+    wr(REG_IMC, 0xFFFFFFFF);
+    rd(REG_ICR);
+    wr(REG_CTRL, rd(REG_CTRL) | CTRL_SLU | CTRL_ASDE);
+
+    /* Station address, as the EEPROM loaded it */
+    uint32_t ral = rd(REG_RAL0), rah = rd(REG_RAH0);
+    for (int i = 0; i < 4; i++) e1000_dev.mac[i] = (uint8_t)(ral >> (8 * i));
+    e1000_dev.mac[4] = (uint8_t)rah;
+    e1000_dev.mac[5] = (uint8_t)(rah >> 8);
+    for (int i = 0; i < 128; i++) wr(REG_MTA + 4 * i, 0);
+
+    if (rings_init() < 0) {
+        serial_write("e1000: out of memory for rings\n");
+        return -1;
+    }
+    wr(REG_RDBAL, (uint32_t)rx_ring);
+    wr(REG_RDBAH, 0);
+    wr(REG_RDLEN, RX_RING * sizeof(rx_desc_t));
+    wr(REG_RDH, 0);
+    wr(REG_RDT, RX_RING - 1);
+    rx_next = 0;
+    wr(REG_RDTR, RX_DELAY);
+    wr(REG_RADV, RX_DELAY * 2);
+    wr(REG_RCTL, RCTL_EN | RCTL_BAM | RCTL_SECRC);      /* 2048-byte buffers */
+
+    wr(REG_TDBAL, (uint32_t)tx_ring);
+    wr(REG_TDBAH, 0);
+    wr(REG_TDLEN, TX_RING * sizeof(tx_desc_t));
+    wr(REG_TDH, 0);
+    wr(REG_TDT, 0);
+    tx_tail = tx_clean = 0;
+    wr(REG_TIPG, 0x0060200A);
+    wr(REG_TCTL, TCTL_EN | TCTL_PSP | (0x0F << 4) | (0x40 << 12));
+
+    e1000_dev.name = "e1000";
+    e1000_dev.irq = pci->irq;
+    e1000_dev.xmit = e1000_xmit;
+    e1000_dev.poll = e1000_poll;
+    update_link();
+    if (netdev_register(&e1000_dev) < 0) return -1;
+
+    wr(REG_ITR, ITR_INTERVAL);
+    if (e1000_dev.irq < 16) {
+        register_interrupt_handler(32 + e1000_dev.irq, e1000_callback);
+        netdev_irq_enable(e1000_dev.irq);
+    }
+    wr(REG_IMS, INT_MASK);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef E1000_H
+#define E1000_H
+
+#include <stdint.h>
+#include "pci.h"
+
+/* Intel 8254x (e1000) driver. Takes the PCI device: maps its
+ * registers, sets up the descriptor rings and registers it as the
+ * netdev. Returns 0, or -1 if it cannot be brought up. */
+int e1000_probe(const pci_device_t *pci);
+
+#endif
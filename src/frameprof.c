@@ -0,0 +1,100 @@
+/* ============================================================
+ * SwanOS — Frame Profiler
+ * Per-pass render timings for the desktop compositor: passes add
+ * TSC cycles during a frame, fp_frame_end converts them to
+ * microseconds and pushes the frame into a rolling history, and
+ * fp_get_stats derives averages, percentiles and a histogram.
+ * ============================================================ */
+
+#include "frameprof.h"
+#include "timer.h"
+#include "string.h"
+
+#define FP_SLOTS (FP_PASSES + FP_MAX_WINDOWS)
+
+static const char *pass_names[FP_PASSES] = {
+    "wallpaper", "icons", "widgets", "windows", "panel", "overlays", "flip"
+};
+
+/* Current frame, in cycles */
+static uint64_t acc[FP_SLOTS];
+static uint64_t frame_t0;
+static int      in_frame = 0;
+
+/* History, in microseconds */
+static uint32_t hist_pass[FP_HISTORY][FP_PASSES];
+static uint32_t hist_frame[FP_HISTORY];
+static uint32_t last_window[FP_MAX_WINDOWS];
+static uint32_t frames = 0;
+
+/* 64-bit division needs libgcc; a frame never comes near 2^32 cycles */
+static uint32_t to_us(uint64_t cycles) {
+    uint32_t per_us = timer_cycles_per_us();
+    if (!per_us) per_us = 1;            /* TSC not calibrated: raw cycles */
+    if (cycles > 0xFFFFFFFFu) cycles = 0xFFFFFFFFu;
+    return (uint32_t)cycles / per_us;
+}
+
+void fp_frame_begin(void) {
+    memset(acc, 0, sizeof(acc));
+    frame_t0 = rdtsc();
+    in_frame = 1;
+}
+
+void fp_add(int pass, uint64_t cycles) {
+    if (!in_frame || pass < 0 || pass >= FP_SLOTS) return;
+    acc[pass] += cycles;
+    if (pass >= FP_PASSES) acc[FP_WINDOWS] += cycles;
+}
+
+void fp_frame_end(void) {
+    if (!in_frame) return;
+    in_frame = 0;
+    uint32_t slot = frames % FP_HISTORY;
+    for (int p = 0; p < FP_PASSES; p++) hist_pass[slot][p] = to_us(acc[p]);
+    for (int w = 0; w < FP_MAX_WINDOWS; w++) last_window[w] = to_us(acc[FP_PASSES + w]);
+    hist_frame[slot] = to_us(rdtsc() - frame_t0);
+    frames++;
+}
+
+void fp_get_stats(fp_stats_t *out) {
+    memset(out, 0, sizeof(*out));
+    out->frames = frames;
+    uint32_t n = frames < FP_HISTORY ? frames : FP_HISTORY;
+    out->samples = n;
+    if (!n) return;
+
+    uint32_t last = (frames - 1) % FP_HISTORY;
+    for (int p = 0; p < FP_PASSES; p++) {
+        uint32_t sum = 0, max = 0;
+        for (uint32_t i = 0; i < n; i++) {
+            uint32_t v = hist_pass[i][p];
+            sum += v;
+            if (v > max) max = v;
+        }
+        out->last_us[p] = hist_pass[last][p];
+        out->avg_us[p] = sum / n;
+        out->max_us[p] = max;
+    }
+    memcpy(out->window_us, last_window, sizeof(out->window_us));
+    out->frame_us = hist_frame[last];
+
+    /* Percentiles: insertion sort of at most FP_HISTORY values */
+    uint32_t sorted[FP_HISTORY];
+    for (uint32_t i = 0; i < n; i++) {
+        uint32_t v = hist_frame[i], j = i;
+        for (; j > 0 && sorted[j - 1] > v; j--) sorted[j] = sorted[j - 1];
+        sorted[j] = v;
+
+        uint32_t b = v / FP_HIST_US;
+        out->hist[b < FP_HIST_BUCKETS ? b : FP_HIST_BUCKETS - 1]++;
+    }
+    out->p50_us = sorted[(n - 1) * 50 / 100];
+    out->p95_us = sorted[(n - 1) * 95 / 100];
+    out->p99_us = sorted[(n - 1) * 99 / 100];
+    out->worst_us = sorted[n - 1];
+}
+
+const char *fp_pass_name(int pass) {
+    return pass >= 0 && pass < FP_PASSES ? pass_names[pass] : "?";
+}
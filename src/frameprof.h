@@ -0,0 +1,71 @@
+#ifndef FRAMEPROF_H
+#define FRAMEPROF_H
+
+#include <stdint.h>
+#include "cpu.h"
+
+/* ── Frame profiler ───────────────────────────────────────────
+ * TSC-timed render passes, summed over a frame (a pass may run
+ * once per damage rect) and kept for the last FP_HISTORY frames:
+ *
+ *     fp_frame_begin();
+ *     { FP_SCOPE(FP_WALLPAPER); draw_wallpaper(); }
+ *     { FP_SCOPE(FP_WIN(wi));   draw_window(wi);  }
+ *     fp_frame_end();
+ *
+ * A scope stops its timer when it goes out of scope, whichever way
+ * it is left. Window passes also count towards FP_WINDOWS.       */
+#define FP_HISTORY      128     /* frames kept */
+#define FP_MAX_WINDOWS  16
+#define FP_HIST_BUCKETS 16
+#define FP_HIST_US      2000    /* frame-time histogram bucket width */
+
+enum {
+    FP_WALLPAPER,
+    FP_ICONS,
+    FP_WIDGETS,
+    FP_WINDOWS,
+    FP_PANEL,
+    FP_OVERLAYS,                /* menus, toasts, palette, narrator */
+    FP_FLIP,
+    FP_PASSES
+};
+
+#define FP_WIN(wi) (FP_PASSES + (wi))
+
+void fp_frame_begin(void);
+void fp_frame_end(void);
+void fp_add(int pass, uint64_t cycles);
+
+typedef struct {
+    uint32_t frames;                    /* profiled so far */
+    uint32_t samples;                   /* frames in the history, <= FP_HISTORY */
+    uint32_t last_us[FP_PASSES];        /* latest frame */
+    uint32_t avg_us[FP_PASSES];         /* over the history */
+    uint32_t max_us[FP_PASSES];
+    uint32_t window_us[FP_MAX_WINDOWS]; /* latest frame, per window slot */
+    uint32_t frame_us;                  /* latest frame, begin to end */
+    uint32_t p50_us, p95_us, p99_us, worst_us;
+    uint16_t hist[FP_HIST_BUCKETS];     /* last bucket: everything slower */
+} fp_stats_t;
+
+void fp_get_stats(fp_stats_t *out);
+const char *fp_pass_name(int pass);
+
+/* ── Scoped timers ────────────────────────────────────────── */
+typedef struct {
+    int      pass;
+    uint64_t t0;
+} fp_scope_t;
+
+static inline void fp_scope_close(fp_scope_t *s) {
+    fp_add(s->pass, rdtsc() - s->t0);
+}
+
+#define FP_CAT_(a, b) a##b
+#define FP_CAT(a, b)  FP_CAT_(a, b)
+#define FP_SCOPE(pass) \
+    fp_scope_t FP_CAT(fp_scope_, __LINE__) \
+        __attribute__((cleanup(fp_scope_close))) = { (pass), rdtsc() }
+
+#endif
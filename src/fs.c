@@ -1,16 +1,136 @@
 /* ============================================================
- * SwanOS — In-Memory Filesystem
- * Simple flat filesystem with directory support.
- * All data lives in RAM (lost on reboot).
+ * SwanOS — Filesystem
+ * Hierarchical filesystem cached in RAM, persisted to SwanFS when an
+ * ATA disk is present (RAM only, and lost on reboot, without one).
+ *
+ * Lookups are O(depth): each directory links its children, and a
+ * hash on (parent, name) resolves one path component without a
+ * table scan. Whole resolved paths are memoised in a small cache
+ * that is invalidated by a generation bump on delete/rename.
+ *
+ * File data lives in page-granular extents from the PMM, sized in
+ * bytes, so directories and empty files own no data pages and a
+ * file grows until it runs out of extents (several MB). Pages can be
+ * shared with views and COW user mappings; a writer copies a shared
+ * extent first, so sharers keep their snapshot.
+ *
+ * With an ATA disk the tree is mounted from SwanFS at boot and the
+ * RAM extents become a write-back page cache: mutations only record
+ * dirty ranges, and the fs-sync worker writes them out every couple
+ * of seconds (or on fs_sync).
+ *
+ * fs_lock guards the node table, the hash and the path cache. The
+ * public entry points take it; the static helpers assume it held.
  * ============================================================ */
 
 #include "fs.h"
+#include "ata.h"
+#include "memory.h"
+#include "process.h"
+#include "timer.h"
 #include "string.h"
+#include "cpu.h"
+#include "spinlock.h"
 
+static spinlock_t fs_lock = SPINLOCK_INIT;
 static fs_node_t nodes[FS_MAX_FILES];
+static int name_hash[FS_HASH_BUCKETS];
+
+/* ── Path cache ───────────────────────────────────────────── */
+typedef struct {
+    uint32_t hash;
+    uint32_t gen;
+    int      idx;               /* -1 = empty */
+    char     path[FS_MAX_PATH];
+} path_cache_t;
+
+static path_cache_t path_cache[FS_PATH_CACHE];
+static uint32_t fs_gen = 1;     /* bumped when a name stops resolving */
+
+/* ── Write-back state ─────────────────────────────────────── */
+static int      disk_ready = 0;
+static uint8_t *pending_free;   /* disk blocks of deleted files, freed by the worker */
+static uint32_t pending_count = 0;
+
+/* Record that bytes [lo, hi) and the inode of n need writing back.
+ * Called with fs_lock held, so the sync worker sees the data and
+ * the dirty range change together. */
+static void mark_dirty(fs_node_t *n, uint32_t lo, uint32_t hi) {
+    if (!disk_ready) return;
+    if (lo < hi) {
+        if (n->dirty_lo >= n->dirty_hi) { n->dirty_lo = lo; n->dirty_hi = hi; }
+        else {
+            if (lo < n->dirty_lo) n->dirty_lo = lo;
+            if (hi > n->dirty_hi) n->dirty_hi = hi;
+        }
+    }
+    n->meta_dirty = 1;
+}
+
+static uint32_t str_hash(uint32_t h, const char *s) {
+    while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+static int bucket_of(int parent, const char *name) {
+    return (int)(str_hash(2166136261u ^ (uint32_t)parent, name) & (FS_HASH_BUCKETS - 1));
+}
+
+static void reset_links(int i) {
+    nodes[i].first_child = nodes[i].last_child = -1;
+    nodes[i].next_sibling = nodes[i].prev_sibling = -1;
+    nodes[i].hash_next = -1;
+}
+
+/* ── Directory index ──────────────────────────────────────── */
+static void hash_insert(int i) {
+    int b = bucket_of(nodes[i].parent, nodes[i].name);
+    nodes[i].hash_next = name_hash[b];
+    name_hash[b] = i;
+}
+
+static void hash_remove(int i) {
+    int *pp = &name_hash[bucket_of(nodes[i].parent, nodes[i].name)];
+    while (*pp >= 0 && *pp != i) pp = &nodes[*pp].hash_next;
+    if (*pp == i) *pp = nodes[i].hash_next;
+    nodes[i].hash_next = -1;
+}
+
+/* Append node i to parent's child list (keeps creation order for ls) */
+static void link_node(int i, int parent) {
+    fs_node_t *d = &nodes[parent];
+    nodes[i].parent = parent;
+    nodes[i].next_sibling = -1;
+    nodes[i].prev_sibling = d->last_child;
+    if (d->last_child >= 0) nodes[d->last_child].next_sibling = i;
+    else d->first_child = i;
+    d->last_child = i;
+    hash_insert(i);
+}
+
+static void unlink_node(int i) {
+    fs_node_t *d = &nodes[nodes[i].parent];
+    hash_remove(i);
+    if (nodes[i].prev_sibling >= 0) nodes[nodes[i].prev_sibling].next_sibling = nodes[i].next_sibling;
+    else d->first_child = nodes[i].next_sibling;
+    if (nodes[i].next_sibling >= 0) nodes[nodes[i].next_sibling].prev_sibling = nodes[i].prev_sibling;
+    else d->last_child = nodes[i].prev_sibling;
+    fs_gen++;   /* cached paths through i are stale */
+}
+
+static int lookup_child(int parent, const char *name) {
+    for (int i = name_hash[bucket_of(parent, name)]; i >= 0; i = nodes[i].hash_next)
+        if (nodes[i].parent == parent && strcmp(nodes[i].name, name) == 0) return i;
+    return -1;
+}
 
 void fs_init(void) {
     memset(nodes, 0, sizeof(nodes));
+    for (int i = 0; i < FS_MAX_FILES; i++) reset_links(i);
+    for (int b = 0; b < FS_HASH_BUCKETS; b++) name_hash[b] = -1;
+    for (int c = 0; c < FS_PATH_CACHE; c++) path_cache[c].idx = -1;
+    fs_gen = 1;
+
     /* Root directory */
     strcpy(nodes[0].name, "/");
     nodes[0].is_dir = 1;
@@ -18,11 +138,8 @@ void fs_init(void) {
     nodes[0].parent = -1;
 }
 
-/* Find a node by path. Returns index or -1. */
-static int find_node(const char *path) {
-    if (strcmp(path, "/") == 0 || strcmp(path, ".") == 0 || path[0] == '\0')
-        return 0; /* root */
-
+/* Walk path components through the child hash. Returns index or -1. */
+static int resolve_path(const char *path) {
     /* Skip leading / */
     const char *p = path;
     if (*p == '/') p++;
@@ -38,20 +155,34 @@ static int find_node(const char *path) {
         if (*p == '/') p++;
         if (part[0] == '\0') continue;
 
-        /* Search children of parent */
-        int found = -1;
-        for (int j = 0; j < FS_MAX_FILES; j++) {
-            if (nodes[j].used && nodes[j].parent == parent && strcmp(nodes[j].name, part) == 0) {
-                found = j;
-                break;
-            }
-        }
+        int found = lookup_child(parent, part);
         if (found < 0) return -1;
         parent = found;
     }
     return parent;
 }
 
+/* Find a node by path, through the path cache. Returns index or -1. */
+static int find_node(const char *path) {
+    if (strcmp(path, "/") == 0 || strcmp(path, ".") == 0 || path[0] == '\0')
+        return 0; /* root */
+    if (strlen(path) >= FS_MAX_PATH) return resolve_path(path);
+
+    uint32_t h = str_hash(2166136261u, path);
+    path_cache_t *c = &path_cache[h & (FS_PATH_CACHE - 1)];
+    if (c->idx >= 0 && c->hash == h && c->gen == fs_gen && strcmp(c->path, path) == 0)
+        return c->idx;
+
+    int idx = resolve_path(path);
+    if (idx >= 0) {   /* misses aren't cached: a create would not invalidate them */
+        c->hash = h;
+        c->gen = fs_gen;
+        c->idx = idx;
+        strcpy(c->path, path);
+    }
+    return idx;
+}
+
 /* Find a free slot */
 static int find_free(void) {
     for (int i = 1; i < FS_MAX_FILES; i++) {
@@ -99,145 +230,701 @@ static int parse_path(const char *path, int *parent_idx, char *basename) {
 }
 
 int fs_list(const char *path, char *out, int out_len) {
+    spin_lock(&fs_lock);
     int dir = find_node(path);
     if (dir < 0 || !nodes[dir].is_dir) {
+        spin_unlock(&fs_lock);
         strcpy(out, "Not a directory.");
         return -1;
     }
 
-    out[0] = '\0';
+    sbuf_t sb;
+    sbuf_init(&sb, out, out_len);
     int count = 0;
-    for (int i = 0; i < FS_MAX_FILES; i++) {
-        if (nodes[i].used && nodes[i].parent == dir) {
-            if (strlen(out) + strlen(nodes[i].name) + 10 >= (unsigned int)out_len) break;
-            if (nodes[i].is_dir) {
-                strcat(out, "  [DIR]  ");
-            } else {
-                strcat(out, "  [FILE] ");
-            }
-            strcat(out, nodes[i].name);
-            if (nodes[i].is_dir) strcat(out, "/");
-            strcat(out, "\n");
-            count++;
-        }
+    for (int i = nodes[dir].first_child; i >= 0; i = nodes[i].next_sibling) {
+        if (strlen(nodes[i].name) + 10 > sbuf_room(&sb)) break;
+        sbuf_printf(&sb, nodes[i].is_dir ? "  [DIR]  %s/\n" : "  [FILE] %s\n", nodes[i].name);
+        count++;
     }
+    spin_unlock(&fs_lock);
     if (count == 0) strcpy(out, "  (empty)\n");
     return count;
 }
 
-int fs_read(const char *path, char *out, int out_len) {
-    int idx = find_node(path);
-    if (idx < 0) { strcpy(out, "File not found."); return -1; }
-    if (nodes[idx].is_dir) { strcpy(out, "Cannot read a directory."); return -1; }
-    strncpy(out, nodes[idx].content, out_len - 1);
-    out[out_len - 1] = '\0';
-    return nodes[idx].size;
+/* ── File data ────────────────────────────────────────────── */
+
+/* Copy len bytes at offset off between a file and buf */
+static void xfer(fs_node_t *n, uint32_t off, void *buf, uint32_t len, int to_file) {
+    uint8_t *p = (uint8_t *)buf;
+    for (int e = 0; e < n->n_ext && len; e++) {
+        uint32_t ext_len = n->ext[e].pages * PAGE_SIZE;
+        if (off >= ext_len) { off -= ext_len; continue; }
+        uint32_t chunk = ext_len - off;
+        if (chunk > len) chunk = len;
+        if (to_file) memcpy(n->ext[e].base + off, p, chunk);
+        else         memcpy(p, n->ext[e].base + off, chunk);
+        p += chunk;
+        len -= chunk;
+        off = 0;
+    }
 }
 
-int fs_write(const char *path, const char *content) {
-    int idx = find_node(path);
+/* Grow capacity to at least size bytes. Extents double the file so
+ * appends amortise, falling back to the exact need when the PMM
+ * has no run that long. */
+static int reserve(fs_node_t *n, uint32_t size) {
+    while (n->cap < size) {
+        if (n->n_ext == FS_MAX_EXTENTS) return -1;
+        uint32_t need = (size - n->cap + PAGE_SIZE - 1) / PAGE_SIZE;
+        uint32_t want = n->cap / PAGE_SIZE;
+        if (want < need) want = need;
+
+        void *base = pmm_alloc_pages(want, PMM_UNINIT);
+        if (!base && want > need) base = pmm_alloc_pages(want = need, PMM_UNINIT);
+        if (!base) return -1;
+        n->ext[n->n_ext].base = (uint8_t *)base;
+        n->ext[n->n_ext].pages = want;
+        n->n_ext++;
+        n->cap += want * PAGE_SIZE;
+    }
+    return 0;
+}
 
-    if (idx >= 0) {
-        /* Overwrite existing file */
-        if (nodes[idx].is_dir) return -1;
-        strncpy(nodes[idx].content, content, FS_MAX_CONTENT - 1);
-        nodes[idx].content[FS_MAX_CONTENT - 1] = '\0';
-        nodes[idx].size = strlen(nodes[idx].content);
-        return 0;
+/* Release trailing extents that hold no data */
+static void trim_extents(fs_node_t *n) {
+    while (n->n_ext > 0) {
+        fs_extent_t *x = &n->ext[n->n_ext - 1];
+        uint32_t start = n->cap - x->pages * PAGE_SIZE;
+        if (start < n->size) break;
+        pmm_free_pages(x->base, x->pages);
+        n->cap = start;
+        n->n_ext--;
     }
+}
 
-    /* Create new file */
+/* Before writing [off, off+len): give every extent in range whose
+ * pages are pinned elsewhere a private copy */
+static int unshare(fs_node_t *n, uint32_t off, uint32_t len) {
+    uint32_t pos = 0;
+    for (int e = 0; e < n->n_ext && pos < off + len; e++) {
+        fs_extent_t *x = &n->ext[e];
+        uint32_t ext_len = x->pages * PAGE_SIZE;
+        if (pos + ext_len > off) {
+            int shared = 0;
+            for (uint32_t p = 0; p < x->pages && !shared; p++)
+                shared = pmm_page_refs(x->base + p * PAGE_SIZE) != 0;
+            if (shared) {
+                uint8_t *copy = (uint8_t *)pmm_alloc_pages(x->pages, PMM_UNINIT);
+                if (!copy) return -1;
+                memcpy(copy, x->base, ext_len);
+                pmm_free_pages(x->base, x->pages);   /* drops our share */
+                x->base = copy;
+            }
+        }
+        pos += ext_len;
+    }
+    return 0;
+}
+
+static int create_node(const char *path, int is_dir) {
     char basename[FS_MAX_NAME];
     int parent;
     if (parse_path(path, &parent, basename) < 0) return -1;
     if (parent < 0 || !nodes[parent].is_dir) return -1;
+    if (basename[0] == '\0') return -1;
 
     int slot = find_free();
     if (slot < 0) return -1;
 
     nodes[slot].used = 1;
-    nodes[slot].is_dir = 0;
-    nodes[slot].parent = parent;
+    nodes[slot].is_dir = is_dir;
+    nodes[slot].size = nodes[slot].cap = 0;
+    nodes[slot].n_ext = 0;
     strcpy(nodes[slot].name, basename);
-    strncpy(nodes[slot].content, content, FS_MAX_CONTENT - 1);
-    nodes[slot].content[FS_MAX_CONTENT - 1] = '\0';
-    nodes[slot].size = strlen(nodes[slot].content);
-    return 0;
+    link_node(slot, parent);
+    mark_dirty(&nodes[slot], 0, 0);
+    return slot;
 }
 
-int fs_delete(const char *path) {
+static int file_node(const char *path) {
+    int idx = find_node(path);
+    return (idx >= 0 && !nodes[idx].is_dir) ? idx : -1;
+}
+
+int fs_size(const char *path) {
+    spin_lock(&fs_lock);
+    int idx = file_node(path);
+    int size = idx < 0 ? -1 : (int)nodes[idx].size;
+    spin_unlock(&fs_lock);
+    return size;
+}
+
+int fs_read_at(const char *path, uint32_t off, void *buf, uint32_t len) {
+    spin_lock(&fs_lock);
+    int idx = file_node(path);
+    if (idx < 0) { spin_unlock(&fs_lock); return -1; }
+    fs_node_t *n = &nodes[idx];
+    if (off >= n->size) len = 0;
+    else if (len > n->size - off) len = n->size - off;
+    xfer(n, off, buf, len, 0);
+    spin_unlock(&fs_lock);
+    return (int)len;
+}
+
+/* Text read: up to out_len-1 bytes, NUL-terminated. Returns the file size. */
+int fs_read(const char *path, char *out, int out_len) {
+    spin_lock(&fs_lock);
     int idx = find_node(path);
-    if (idx <= 0) return -1; /* Can't delete root or not found */
+    const char *err = idx < 0 ? "File not found."
+                    : nodes[idx].is_dir ? "Cannot read a directory." : 0;
+    if (err) { spin_unlock(&fs_lock); strcpy(out, err); return -1; }
+    fs_node_t *n = &nodes[idx];
+    uint32_t len = n->size < (uint32_t)(out_len - 1) ? n->size : (uint32_t)(out_len - 1);
+    xfer(n, 0, out, len, 0);
+    out[len] = '\0';
+    int size = (int)n->size;
+    spin_unlock(&fs_lock);
+    return size;
+}
 
-    if (nodes[idx].is_dir) {
-        /* Check if empty */
-        for (int i = 0; i < FS_MAX_FILES; i++) {
-            if (nodes[i].used && nodes[i].parent == idx) return -2; /* Not empty */
+/* Free node idx and queue its disk blocks; the worker clears the
+ * on-disk inode on its next pass */
+static void delete_node(int idx) {
+    fs_node_t *n = &nodes[idx];
+    for (int e = 0; e < n->n_ext; e++)
+        pmm_free_pages(n->ext[e].base, n->ext[e].pages);
+    for (int e = 0; e < n->n_dext; e++)
+        for (uint32_t b = 0; b < n->dext[e].blocks; b++) {
+            uint32_t blk = n->dext[e].start + b;
+            pending_free[blk >> 3] |= (uint8_t)(1 << (blk & 7));
+            pending_count++;
         }
+    unlink_node(idx);
+    memset(n, 0, sizeof(fs_node_t));
+    reset_links(idx);
+    n->meta_dirty = disk_ready;   /* the on-disk inode must be cleared */
+}
+
+static int write_bytes(const char *path, const void *data, uint32_t len) {
+    int idx = find_node(path);
+    int created = 0;
+    if (idx >= 0 && nodes[idx].is_dir) return -1;
+    if (idx < 0) {
+        if ((idx = create_node(path, 0)) < 0) return -1;
+        created = 1;
     }
 
-    memset(&nodes[idx], 0, sizeof(fs_node_t));
+    fs_node_t *n = &nodes[idx];
+    /* Shrinking well below capacity: old extents can't be split, so
+     * free them (the contents are being replaced) and start over */
+    if (n->cap / 2 >= len + PAGE_SIZE) {
+        n->size = 0;
+        trim_extents(n);
+    }
+    if (reserve(n, len) < 0 || unshare(n, 0, len) < 0) {
+        if (created) delete_node(idx);
+        else trim_extents(n);
+        return -1;
+    }
+    xfer(n, 0, (void *)data, len, 1);
+    n->size = len;
+    trim_extents(n);
+    mark_dirty(n, 0, len);
     return 0;
 }
 
-int fs_mkdir(const char *path) {
-    if (find_node(path) >= 0) return -1; /* Already exists */
+int fs_write_bytes(const char *path, const void *data, uint32_t len) {
+    spin_lock(&fs_lock);
+    int r = write_bytes(path, data, len);
+    spin_unlock(&fs_lock);
+    return r;
+}
 
-    char basename[FS_MAX_NAME];
-    int parent;
-    if (parse_path(path, &parent, basename) < 0) return -1;
-    if (parent < 0 || !nodes[parent].is_dir) return -1;
+int fs_write(const char *path, const char *content) {
+    return fs_write_bytes(path, content, strlen(content));
+}
 
-    int slot = find_free();
-    if (slot < 0) return -1;
+static int append_bytes(const char *path, const void *data, uint32_t len) {
+    int idx = find_node(path);
+    if (idx < 0) return write_bytes(path, data, len);
+    if (nodes[idx].is_dir) return -1;
 
-    nodes[slot].used = 1;
-    nodes[slot].is_dir = 1;
-    nodes[slot].parent = parent;
-    strcpy(nodes[slot].name, basename);
+    fs_node_t *n = &nodes[idx];
+    if (n->size + len < n->size) return -1;
+    if (reserve(n, n->size + len) < 0 || unshare(n, n->size, len) < 0) {
+        trim_extents(n);
+        return -1;
+    }
+    xfer(n, n->size, (void *)data, len, 1);
+    n->size += len;
+    mark_dirty(n, n->size - len, n->size);
     return 0;
 }
 
+int fs_append_bytes(const char *path, const void *data, uint32_t len) {
+    spin_lock(&fs_lock);
+    int r = append_bytes(path, data, len);
+    spin_unlock(&fs_lock);
+    return r;
+}
+
+int fs_append(const char *path, const char *content) {
+    return fs_append_bytes(path, content, strlen(content));
+}
+
+int fs_delete(const char *path) {
+    spin_lock(&fs_lock);
+    int idx = find_node(path), r = 0;
+    if (idx <= 0) r = -1; /* Can't delete root or not found */
+    else if (nodes[idx].is_dir && nodes[idx].first_child >= 0) r = -2; /* Not empty */
+    else delete_node(idx);
+    spin_unlock(&fs_lock);
+    return r;
+}
+
+int fs_mkdir(const char *path) {
+    spin_lock(&fs_lock);
+    int r = -1;
+    if (find_node(path) < 0) /* else: already exists */
+        r = create_node(path, 1) < 0 ? -1 : 0;
+    spin_unlock(&fs_lock);
+    return r;
+}
+
 int fs_exists(const char *path) {
-    return find_node(path) >= 0;
+    spin_lock(&fs_lock);
+    int found = find_node(path) >= 0;
+    spin_unlock(&fs_lock);
+    return found;
+}
+
+static int copy_file(const char *src, const char *dst) {
+    int si = file_node(src);
+    if (si < 0) return -1;
+    int di = find_node(dst);
+    if (di == si) return 0;
+    if (di >= 0 && nodes[di].is_dir) return -1;
+    if (di < 0 && (di = create_node(dst, 0)) < 0) return -1;
+
+    fs_node_t *s = &nodes[si], *d = &nodes[di];
+    if (reserve(d, s->size) < 0 || unshare(d, 0, s->size) < 0) return -1;
+    uint32_t off = 0;
+    for (int e = 0; e < s->n_ext && off < s->size; e++) {
+        uint32_t chunk = s->ext[e].pages * PAGE_SIZE;
+        if (chunk > s->size - off) chunk = s->size - off;
+        xfer(d, off, s->ext[e].base, chunk, 1);
+        off += chunk;
+    }
+    d->size = s->size;
+    trim_extents(d);
+    mark_dirty(d, 0, d->size);
+    return 0;
 }
 
+/* Copies extent by extent; nothing is staged on the stack */
 int fs_copy(const char *src, const char *dst) {
-    int si = find_node(src);
-    if (si < 0 || nodes[si].is_dir) return -1;
+    spin_lock(&fs_lock);
+    int r = copy_file(src, dst);
+    spin_unlock(&fs_lock);
+    return r;
+}
 
-    char content[FS_MAX_CONTENT];
-    strncpy(content, nodes[si].content, FS_MAX_CONTENT - 1);
-    content[FS_MAX_CONTENT - 1] = '\0';
+/* ── Views ────────────────────────────────────────────────── */
+
+int fs_view(const char *path, fs_view_t *v) {
+    v->size = 0;
+    v->n_seg = 0;
+    spin_lock(&fs_lock);
+    int idx = file_node(path);
+    if (idx < 0) { spin_unlock(&fs_lock); return -1; }
+
+    fs_node_t *n = &nodes[idx];
+    uint32_t left = n->size;
+    for (int e = 0; e < n->n_ext && left; e++) {
+        uint32_t len = n->ext[e].pages * PAGE_SIZE;
+        if (len > left) len = left;
+        uint32_t pages = (len + PAGE_SIZE - 1) / PAGE_SIZE;
+        for (uint32_t p = 0; p < pages; p++) {
+            if (pmm_ref_page(n->ext[e].base + p * PAGE_SIZE) == 0) continue;
+            while (p--) pmm_free_page(n->ext[e].base + p * PAGE_SIZE);
+            spin_unlock(&fs_lock);
+            fs_view_release(v);
+            return -1;
+        }
+        v->seg[v->n_seg].data = n->ext[e].base;
+        v->seg[v->n_seg].len = len;
+        v->n_seg++;
+        v->size += len;
+        left -= len;
+    }
+    spin_unlock(&fs_lock);
+    return 0;
+}
 
-    return fs_write(dst, content);
+void fs_view_release(fs_view_t *v) {
+    for (int s = 0; s < v->n_seg; s++) {
+        uint32_t pages = (v->seg[s].len + PAGE_SIZE - 1) / PAGE_SIZE;
+        pmm_free_pages((void *)v->seg[s].data, pages);
+    }
+    v->size = 0;
+    v->n_seg = 0;
 }
 
 int fs_rename(const char *path, const char *newname) {
-    int idx = find_node(path);
-    if (idx <= 0) return -1; /* Can't rename root or not found */
     if (strlen(newname) >= FS_MAX_NAME) return -1;
+    spin_lock(&fs_lock);
+    int idx = find_node(path);
+    if (idx <= 0) { spin_unlock(&fs_lock); return -1; } /* Can't rename root or not found */
+    hash_remove(idx);
     strcpy(nodes[idx].name, newname);
+    hash_insert(idx);
+    fs_gen++;
+    mark_dirty(&nodes[idx], 0, 0);
+    spin_unlock(&fs_lock);
     return 0;
 }
 
-int fs_append(const char *path, const char *content) {
-    int idx = find_node(path);
-    if (idx < 0) {
-        /* Create the file */
-        return fs_write(path, content);
+/* ── On-disk format (SwanFS v1) ───────────────────────────────
+ *   block 0              superblock
+ *   inode_start ..       inode table, 256 B per slot (slot = node index)
+ *   bitmap_start ..      block allocation bitmap, 1 bit per block
+ *   data_start ..        file data, up to FS_MAX_EXTENTS runs per file
+ * All blocks are 4 KB (8 sectors).                                  */
+#define SWANFS_MAGIC      0x53465753   /* "SWFS" */
+#define SWANFS_VERSION    1
+#define BLK_SIZE          4096
+#define BLK_SECT          (BLK_SIZE / ATA_SECTOR)
+#define INODE_SIZE        256
+#define INODES_PER_BLK    (BLK_SIZE / INODE_SIZE)
+#define INODE_BLOCKS      ((FS_MAX_FILES + INODES_PER_BLK - 1) / INODES_PER_BLK)
+#define BITS_PER_BLK      (BLK_SIZE * 8)
+#define MAX_BITMAP_BLOCKS 32            /* 4 GB; dirty masks are u32 */
+
+typedef struct {
+    uint32_t magic;
+    uint32_t version;
+    uint32_t blocks;
+    uint32_t max_files;
+    uint32_t inode_start, inode_blocks;
+    uint32_t bitmap_start, bitmap_blocks;
+    uint32_t data_start;
+} swanfs_super_t;
+
+typedef struct {
+    char      name[FS_MAX_NAME];
+    int32_t   parent;
+    uint32_t  size;
+    uint8_t   used, is_dir, n_dext, pad;
+    fs_dext_t dext[FS_MAX_EXTENTS];
+} swanfs_inode_t;                       /* 140 B, padded to INODE_SIZE */
+
+static swanfs_super_t sb;
+static uint8_t  *inode_img;             /* INODE_BLOCKS × BLK_SIZE */
+static uint8_t  *bitmap;                /* sb.bitmap_blocks × BLK_SIZE */
+static uint32_t  inode_dirty = 0, bitmap_dirty = 0;   /* per-block masks */
+static uint8_t   blk_buf[BLK_SIZE];
+static volatile uint32_t sync_req = 0, sync_done = 0;
+static wait_queue_t sync_kick, sync_finished;
+static uint32_t  blocks_written = 0, sync_errors = 0;
+
+#define INODE(i) ((swanfs_inode_t *)(inode_img + (i) * INODE_SIZE))
+
+static int read_block(uint32_t blk, void *buf) {
+    return ata_read(blk * BLK_SECT, BLK_SECT, buf);
+}
+
+static void write_block(uint32_t blk, const void *buf) {
+    if (ata_write(blk * BLK_SECT, BLK_SECT, buf) < 0) sync_errors++;
+    else blocks_written++;
+}
+
+/* ── Block allocation (sync worker only) ──────────────────── */
+
+static int blk_used(uint32_t b) {
+    return bitmap[b >> 3] & (1 << (b & 7));
+}
+
+static void blk_mark(uint32_t b, int used) {
+    if (used) bitmap[b >> 3] |= (uint8_t)(1 << (b & 7));
+    else      bitmap[b >> 3] &= (uint8_t)~(1 << (b & 7));
+    bitmap_dirty |= 1u << (b / BITS_PER_BLK);
+}
+
+/* First run of at least want free blocks, else the longest one */
+static uint32_t alloc_run(uint32_t want, uint32_t *got) {
+    uint32_t best = 0, best_len = 0, run = 0, len = 0;
+    for (uint32_t b = sb.data_start; b < sb.blocks; b++) {
+        if (blk_used(b)) { len = 0; continue; }
+        if (!len) run = b;
+        if (++len > best_len) { best = run; best_len = len; }
+        if (len == want) break;
     }
-    if (nodes[idx].is_dir) return -1;
+    *got = best_len < want ? best_len : want;
+    for (uint32_t b = 0; b < *got; b++) blk_mark(best + b, 1);
+    return best;
+}
+
+/* Size n's disk extents to its current length */
+static int fit_disk(fs_node_t *n) {
+    uint32_t need = (n->size + BLK_SIZE - 1) / BLK_SIZE, have = 0;
+    for (int e = 0; e < n->n_dext; e++) have += n->dext[e].blocks;
+
+    while (have < need) {
+        uint32_t got, start = alloc_run(need - have, &got);
+        if (!got) return -1;
+        fs_dext_t *last = n->n_dext ? &n->dext[n->n_dext - 1] : 0;
+        if (last && last->start + last->blocks == start) last->blocks += got;
+        else if (n->n_dext < FS_MAX_EXTENTS) {
+            n->dext[n->n_dext].start = start;
+            n->dext[n->n_dext].blocks = got;
+            n->n_dext++;
+        } else {
+            for (uint32_t b = 0; b < got; b++) blk_mark(start + b, 0);
+            return -1;
+        }
+        have += got;
+    }
+    while (have > need) {   /* shrink from the tail */
+        fs_dext_t *last = &n->dext[n->n_dext - 1];
+        uint32_t cut = have - need < last->blocks ? have - need : last->blocks;
+        for (uint32_t b = 0; b < cut; b++) blk_mark(last->start + last->blocks - 1 - b, 0);
+        last->blocks -= cut;
+        have -= cut;
+        if (!last->blocks) n->n_dext--;
+    }
+    return 0;
+}
+
+/* Disk block holding file block b, 0 if unallocated */
+static uint32_t map_block(const fs_node_t *n, uint32_t b) {
+    for (int e = 0; e < n->n_dext; e++) {
+        if (b < n->dext[e].blocks) return n->dext[e].start + b;
+        b -= n->dext[e].blocks;
+    }
+    return 0;
+}
+
+/* ── Write-back ───────────────────────────────────────────── */
+
+/* Write n's dirty range block by block. Each block is copied out
+ * under fs_lock, the disk write then runs without it. */
+static void sync_file(fs_node_t *n) {
+    for (;;) {
+        spin_lock(&fs_lock);
+        if (n->dirty_hi > n->size) n->dirty_hi = n->size;
+        if (!n->used || n->dirty_lo >= n->dirty_hi) {
+            n->dirty_lo = n->dirty_hi = 0;
+            spin_unlock(&fs_lock);
+            return;
+        }
+        uint32_t b = n->dirty_lo / BLK_SIZE;
+        uint32_t blk = map_block(n, b);
+        if (!blk && fit_disk(n) == 0) blk = map_block(n, b);
+        if (!blk) {   /* disk full: the data stays RAM-only */
+            n->dirty_lo = n->dirty_hi = 0;
+            sync_errors++;
+            spin_unlock(&fs_lock);
+            return;
+        }
+        uint32_t len = n->size - b * BLK_SIZE;
+        if (len > BLK_SIZE) len = BLK_SIZE;
+        xfer(n, b * BLK_SIZE, blk_buf, len, 0);
+        memset(blk_buf + len, 0, BLK_SIZE - len);
+        n->dirty_lo = (b + 1) * BLK_SIZE;
+        spin_unlock(&fs_lock);
+
+        write_block(blk, blk_buf);
+    }
+}
+
+static void sync_pass(void) {
+    /* Blocks freed since the last pass have no writes in flight */
+    spin_lock(&fs_lock);
+    if (pending_count) {
+        for (uint32_t i = 0; i < sb.bitmap_blocks * BLK_SIZE; i++) {
+            if (!pending_free[i]) continue;
+            bitmap[i] &= (uint8_t)~pending_free[i];
+            bitmap_dirty |= 1u << (i / BLK_SIZE);
+            pending_free[i] = 0;
+        }
+        pending_count = 0;
+    }
+    spin_unlock(&fs_lock);
 
-    int cur_len = strlen(nodes[idx].content);
-    int add_len = strlen(content);
-    if (cur_len + add_len >= FS_MAX_CONTENT - 1) {
-        /* Truncate to fit */
-        add_len = FS_MAX_CONTENT - 1 - cur_len;
-        if (add_len <= 0) return -1;
+    for (int i = 1; i < FS_MAX_FILES; i++) {
+        fs_node_t *n = &nodes[i];
+        if (!n->is_dir) sync_file(n);
+
+        spin_lock(&fs_lock);
+        if (n->meta_dirty) {
+            if (n->used && !n->is_dir && fit_disk(n) < 0) sync_errors++;
+            swanfs_inode_t *d = INODE(i);
+            memset(d, 0, INODE_SIZE);
+            if (n->used) {
+                strcpy(d->name, n->name);
+                d->parent = n->parent;
+                d->size = n->size;   /* load stops at the last mapped block */
+                d->used = 1;
+                d->is_dir = (uint8_t)n->is_dir;
+                d->n_dext = (uint8_t)n->n_dext;
+                memcpy(d->dext, n->dext, sizeof(d->dext));
+            }
+            inode_dirty |= 1u << (i / INODES_PER_BLK);
+            n->meta_dirty = 0;
+        }
+        spin_unlock(&fs_lock);
     }
-    strncpy(nodes[idx].content + cur_len, content, add_len);
-    nodes[idx].content[cur_len + add_len] = '\0';
-    nodes[idx].size = cur_len + add_len;
+
+    /* Metadata after data, so an inode never points at stale blocks */
+    int wrote = 0;
+    for (uint32_t k = 0; k < sb.bitmap_blocks; k++)
+        if (bitmap_dirty & (1u << k)) {
+            bitmap_dirty &= ~(1u << k);
+            write_block(sb.bitmap_start + k, bitmap + k * BLK_SIZE);
+            wrote = 1;
+        }
+    for (uint32_t k = 0; k < INODE_BLOCKS; k++)
+        if (inode_dirty & (1u << k)) {
+            inode_dirty &= ~(1u << k);
+            write_block(sb.inode_start + k, inode_img + k * BLK_SIZE);
+            wrote = 1;
+        }
+    if (wrote && ata_flush() < 0) sync_errors++;
+}
+
+/* fs-sync worker: a pass every FS_SYNC_SECS, or when fs_sync asks */
+#define FS_SYNC_SECS 2
+
+static void sync_main(void) {
+    uint32_t period = FS_SYNC_SECS * timer_get_frequency();
+    uint32_t last = timer_get_ticks();
+    while (1) {
+        uint32_t want = sync_req;
+        uint32_t now = timer_get_ticks();
+        if (want != sync_done || now - last >= period) {
+            sync_pass();
+            sync_done = want;
+            wake_up(&sync_finished);
+            last = now;
+            continue;
+        }
+        /* Asleep until the next periodic pass or an fs_sync kick */
+        uint32_t flags = irq_save();
+        if (sync_req == sync_done) sleep_on_timeout(&sync_kick, period - (now - last));
+        irq_restore(flags);
+    }
+}
+
+int fs_sync(void) {
+    if (!disk_ready) return -1;
+    if (!process_scheduling_enabled) {   /* boot: no worker running yet */
+        sync_pass();
+        return 0;
+    }
+    uint32_t flags = irq_save();
+    uint32_t want = ++sync_req;
+    wake_up(&sync_kick);
+    while ((int32_t)(sync_done - want) < 0) sleep_on(&sync_finished);
+    irq_restore(flags);
     return 0;
 }
+
+/* ── Mount / format ───────────────────────────────────────── */
+
+static int format_disk(void) {
+    memset(&sb, 0, sizeof(sb));
+    uint32_t blocks = ata_sectors() / BLK_SECT;
+    if (blocks > MAX_BITMAP_BLOCKS * BITS_PER_BLK) blocks = MAX_BITMAP_BLOCKS * BITS_PER_BLK;
+    sb.magic = SWANFS_MAGIC;
+    sb.version = SWANFS_VERSION;
+    sb.blocks = blocks;
+    sb.max_files = FS_MAX_FILES;
+    sb.inode_start = 1;
+    sb.inode_blocks = INODE_BLOCKS;
+    sb.bitmap_start = sb.inode_start + INODE_BLOCKS;
+    sb.bitmap_blocks = (blocks + BITS_PER_BLK - 1) / BITS_PER_BLK;
+    sb.data_start = sb.bitmap_start + sb.bitmap_blocks;
+    return sb.data_start + 16 <= blocks ? 0 : -1;   /* too small to bother */
+}
+
+/* Rebuild the node table from the inode image and read file data */
+static void load_tree(void) {
+    for (int i = 1; i < FS_MAX_FILES; i++) {
+        swanfs_inode_t *d = INODE(i);
+        if (!d->used || d->n_dext > FS_MAX_EXTENTS) continue;
+        d->name[FS_MAX_NAME - 1] = '\0';
+        fs_node_t *n = &nodes[i];
+        n->used = 1;
+        n->is_dir = d->is_dir;
+        n->parent = d->parent;
+        strcpy(n->name, d->name);
+        n->n_dext = d->n_dext;
+        memcpy(n->dext, d->dext, sizeof(n->dext));
+        n->size = d->size;
+    }
+
+    for (int i = 1; i < FS_MAX_FILES; i++) {
+        fs_node_t *n = &nodes[i];
+        if (!n->used) continue;
+        int p = n->parent;
+        if (p < 0 || p >= FS_MAX_FILES || p == i || !nodes[p].used || !nodes[p].is_dir) {
+            memset(n, 0, sizeof(fs_node_t));   /* orphan: drop it */
+            reset_links(i);
+            continue;
+        }
+        link_node(i, p);
+        if (n->is_dir) continue;
+
+        uint32_t size = n->size, loaded = 0;
+        if (reserve(n, size) < 0) size = 0;
+        while (loaded < size) {
+            uint32_t blk = map_block(n, loaded / BLK_SIZE);
+            if (!blk || blk >= sb.blocks || read_block(blk, blk_buf) < 0) break;
+            uint32_t len = size - loaded < BLK_SIZE ? size - loaded : BLK_SIZE;
+            xfer(n, loaded, blk_buf, len, 1);
+            loaded += len;
+        }
+        n->size = loaded;
+        trim_extents(n);
+    }
+}
+
+int fs_mount(void) {
+    if (disk_ready || !ata_present()) return -1;
+    if (read_block(0, blk_buf) < 0) return -1;
+    memcpy(&sb, blk_buf, sizeof(sb));
+
+    int fresh = sb.magic != SWANFS_MAGIC || sb.version != SWANFS_VERSION ||
+                sb.max_files != FS_MAX_FILES || sb.bitmap_blocks > MAX_BITMAP_BLOCKS ||
+                sb.blocks > ata_sectors() / BLK_SECT;
+    if (fresh && format_disk() < 0) return -1;
+
+    inode_img = (uint8_t *)kzalloc(INODE_BLOCKS * BLK_SIZE);
+    bitmap = (uint8_t *)kzalloc(sb.bitmap_blocks * BLK_SIZE);
+    pending_free = (uint8_t *)kzalloc(sb.bitmap_blocks * BLK_SIZE);
+    if (!inode_img || !bitmap || !pending_free) return -1;
+
+    if (fresh) {
+        for (uint32_t b = 0; b < sb.data_start; b++) blk_mark(b, 1);
+        for (uint32_t b = sb.blocks; b < sb.bitmap_blocks * BITS_PER_BLK; b++) blk_mark(b, 1);
+        inode_dirty = (1u << INODE_BLOCKS) - 1;
+        memset(blk_buf, 0, BLK_SIZE);
+        memcpy(blk_buf, &sb, sizeof(sb));
+        write_block(0, blk_buf);
+    } else {
+        for (uint32_t k = 0; k < INODE_BLOCKS; k++)
+            if (read_block(sb.inode_start + k, inode_img + k * BLK_SIZE) < 0) return -1;
+        for (uint32_t k = 0; k < sb.bitmap_blocks; k++)
+            if (read_block(sb.bitmap_start + k, bitmap + k * BLK_SIZE) < 0) return -1;
+        load_tree();
+    }
+
+    disk_ready = 1;
+    fs_gen++;
+    process_create_named(sync_main, 0, "fs-sync", PRIORITY_LOW);
+    return 0;
+}
+
+int fs_persistent(void)           { return disk_ready; }
+uint32_t fs_blocks_written(void)  { return blocks_written; }
+uint32_t fs_sync_errors(void)     { return sync_errors; }
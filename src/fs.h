@@ -1,18 +1,48 @@
 #ifndef FS_H
 #define FS_H
 
+#include <stdint.h>
+
 #define FS_MAX_FILES   64
 #define FS_MAX_NAME    32
-#define FS_MAX_CONTENT 4096
+#define FS_MAX_CONTENT 4096  /* default read buffer for text callers */
 #define FS_MAX_PATH    128
+#define FS_MAX_EXTENTS 12    /* per file; each new extent doubles capacity */
+#define FS_HASH_BUCKETS 64   /* (parent, name) index, power of two */
+#define FS_PATH_CACHE   16   /* resolved-path cache entries, power of two */
+
+/* A run of physically contiguous PMM frames holding file data */
+typedef struct {
+    uint8_t *base;
+    uint32_t pages;
+} fs_extent_t;
+
+/* A run of 4 KB blocks on the backing disk */
+typedef struct {
+    uint32_t start;
+    uint32_t blocks;
+} fs_dext_t;
 
 typedef struct {
     char   name[FS_MAX_NAME];
-    char   content[FS_MAX_CONTENT];
-    int    size;
+    uint32_t size;  /* bytes of data (binary-safe) */
+    uint32_t cap;   /* bytes allocated across extents */
+    int    n_ext;
+    fs_extent_t ext[FS_MAX_EXTENTS];
     int    is_dir;
     int    used;
     int    parent;  /* index of parent directory, -1 for root */
+    /* Directory index: children in creation order, plus a hash chain
+     * keyed by (parent, name). -1 terminates every list. */
+    int    first_child, last_child;
+    int    next_sibling, prev_sibling;
+    int    hash_next;
+    /* Write-back state (persistent mounts only): the extents above
+     * are the page cache; dirty bytes reach dext via the sync worker */
+    uint32_t dirty_lo, dirty_hi;
+    int    meta_dirty;
+    int    n_dext;
+    fs_dext_t dext[FS_MAX_EXTENTS];
 } fs_node_t;
 
 void fs_init(void);
@@ -26,5 +56,38 @@ int  fs_copy(const char *src, const char *dst);
 int  fs_rename(const char *path, const char *newname);
 int  fs_append(const char *path, const char *content);
 
+/* Binary-safe access; the string calls above are wrappers around these */
+int  fs_size(const char *path);     /* bytes, -1 if missing or a directory */
+int  fs_read_at(const char *path, uint32_t off, void *buf, uint32_t len);
+int  fs_write_bytes(const char *path, const void *data, uint32_t len);
+int  fs_append_bytes(const char *path, const void *data, uint32_t len);
+
+/* ── Zero-copy views ───────────────────────────────────────── */
+typedef struct {
+    const uint8_t *data;   /* page-aligned, physically contiguous */
+    uint32_t len;
+} fs_seg_t;
+
+typedef struct {
+    uint32_t size;
+    int      n_seg;
+    fs_seg_t seg[FS_MAX_EXTENTS];
+} fs_view_t;
+
+/* Pin a read-only snapshot of a file's pages (no copy). Later writes
+   to the file copy the affected extent instead of changing pinned
+   pages. Every successful fs_view needs an fs_view_release. */
+int  fs_view(const char *path, fs_view_t *v);
+void fs_view_release(fs_view_t *v);
+
+/* ── Persistence ──────────────────────────────────────────── */
+/* Load (or format) SwanFS on the ATA disk and start the fs-sync
+   worker. Returns 0 when mounted; the fs stays RAM-only otherwise. */
+int  fs_mount(void);
+int  fs_persistent(void);
+int  fs_sync(void);                  /* write back everything dirty, waits */
+uint32_t fs_blocks_written(void);
+uint32_t fs_sync_errors(void);
+
 #endif
 
@@ -1,5 +1,8 @@
 #include "gdt.h"
 #include "string.h"
+#include "smp.h"
+
+#define GDT_ENTRIES  (GDT_TSS0 + SMP_MAX_CPUS)
 
 typedef struct {
     uint16_t limit_low;
@@ -15,9 +18,9 @@ typedef struct {
     uint32_t base;
 } __attribute__((packed)) gdt_ptr_t;
 
-static gdt_entry_t gdt[6];
+static gdt_entry_t gdt[GDT_ENTRIES];
 static gdt_ptr_t gp;
-static tss_entry_t tss;
+static tss_entry_t tss[SMP_MAX_CPUS];
 
 extern void gdt_flush(uint32_t);
 extern void tss_flush(void);
@@ -33,29 +36,31 @@ static void gdt_set_gate(int num, uint32_t base, uint32_t limit, uint8_t access,
     gdt[num].access = access;
 }
 
-static void write_tss(int num, uint16_t ss0, uint32_t esp0) {
-    uint32_t base = (uint32_t) &tss;
-    uint32_t limit = sizeof(tss);
+static void write_tss(int cpu, uint16_t ss0, uint32_t esp0) {
+    tss_entry_t *t = &tss[cpu];
+    uint32_t base = (uint32_t) t;
+    uint32_t limit = sizeof(*t);
 
-    gdt_set_gate(num, base, limit, 0xE9, 0x00);
+    gdt_set_gate(GDT_TSS0 + cpu, base, limit, 0xE9, 0x00);
 
-    memset(&tss, 0, sizeof(tss));
+    memset(t, 0, sizeof(*t));
 
-    tss.ss0 = ss0;
-    tss.esp0 = esp0;
+    t->ss0 = ss0;
+    t->esp0 = esp0;
     
     /* Default segment registers for kernel */
-    tss.cs = 0x08 | 0x3;
-    tss.ss = tss.ds = tss.es = tss.fs = tss.gs = 0x10 | 0x3;
-    tss.iomap_base = sizeof(tss);
+    t->cs = 0x08 | 0x3;
+    t->ss = t->ds = t->es = t->fs = t->gs = 0x10 | 0x3;
+    t->iomap_base = sizeof(*t);
 }
 
+/* Ring 0 stack for the next trap out of user mode on this CPU */
 void tss_set_kernel_stack(uint32_t stack) {
-    tss.esp0 = stack;
+    tss[smp_cpu_id()].esp0 = stack;
 }
 
 void gdt_init(void) {
-    gp.limit = (sizeof(gdt_entry_t) * 6) - 1;
+    gp.limit = (sizeof(gdt_entry_t) * GDT_ENTRIES) - 1;
     gp.base = (uint32_t)&gdt;
 
     gdt_set_gate(0, 0, 0, 0, 0);                /* Null */
@@ -63,8 +68,16 @@ void gdt_init(void) {
     gdt_set_gate(2, 0, 0xFFFFFFFF, 0x92, 0xCF); /* Kernel Data */
     gdt_set_gate(3, 0, 0xFFFFFFFF, 0xFA, 0xCF); /* User Code */
     gdt_set_gate(4, 0, 0xFFFFFFFF, 0xF2, 0xCF); /* User Data */
-    write_tss(5, 0x10, 0x0);                    /* TSS */
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++)
+        write_tss(cpu, 0x10, 0x0);              /* TSS per CPU */
+
+    gdt_flush((uint32_t)&gp);
+    tss_flush();                                /* BSP: TSS 0 */
+}
 
+/* Application processor: same table, its own TSS descriptor */
+void gdt_init_cpu(int cpu) {
+    uint16_t sel = (uint16_t)(((GDT_TSS0 + cpu) * 8) | 0x3);
     gdt_flush((uint32_t)&gp);
-    tss_flush();
+    __asm__ volatile("ltr %0" : : "r"(sel));
 }
@@ -3,6 +3,9 @@
 
 #include <stdint.h>
 
+/* Null, kernel code/data, user code/data, then one TSS per CPU */
+#define GDT_TSS0  5
+
 typedef struct {
     uint32_t prev_tss;
     uint32_t esp0;
@@ -15,6 +18,7 @@ typedef struct {
 } __attribute__((packed)) tss_entry_t;
 
 void gdt_init(void);
-void tss_set_kernel_stack(uint32_t stack);
+void gdt_init_cpu(int cpu);              /* load GDT + TSS on an AP */
+void tss_set_kernel_stack(uint32_t stack);  /* for the calling CPU */
 
 #endif
@@ -7,6 +7,9 @@
 #include "ports.h"
 #include "screen.h"
 #include "string.h"
+#include "timer.h"
+#include "trace.h"
+#include "cpu.h"
 
 #define IDT_ENTRIES 256
 
@@ -136,23 +139,104 @@ void idt_init(void) {
 
     idtp.limit = sizeof(idt) - 1;
     idtp.base = (uint32_t)&idt;
-    __asm__ volatile ("lidt (%0)" : : "r"(&idtp));
+    idt_load();
     __asm__ volatile ("sti"); /* enable interrupts */
 }
 
+/* Every CPU shares the one table */
+void idt_load(void) {
+    __asm__ volatile ("lidt (%0)" : : "r"(&idtp));
+}
+
+/* Vector served by a stub outside the ISR/IRQ set (APIC vectors) */
+void idt_set_stub(uint8_t n, void (*stub)(void)) {
+    idt_set_gate(n, (uint32_t)stub, 0x08, 0x8E);
+}
+
 void register_interrupt_handler(uint8_t n, isr_handler_t handler) {
     interrupt_handlers[n] = handler;
 }
 
-/* Called by isr_common_stub in assembly */
+/* Called by isr_common_stub in assembly. Handlers run with IRQs
+ * off, so they hold the IRQ lock (cpu.h) like any such section. */
 void isr_handler(registers_t *regs) {
+    irq_lock();
     if (interrupt_handlers[regs->int_no]) {
         interrupt_handlers[regs->int_no](regs);
     }
+    irq_unlock();
+}
+
+/* ── Per-line IRQ accounting ──────────────────────────────────
+ * Legacy IRQs only reach the BSP, with IRQs off, so the counters are
+ * plain stores; idt_irq_window_reset (from the timer) rolls the
+ * one-second window that rates and busy time are taken over.      */
+static volatile uint32_t irq_counts[16];
+static uint64_t irq_cycles[16];         /* handler time since boot */
+static uint32_t irq_peak[16];           /* worst handler, since boot */
+static uint32_t win_cycles[16], win_max[16], win_start[16];
+static uint32_t last_cycles[16], last_max[16], last_rate[16];
+
+uint32_t idt_irq_count(int irq) {
+    return (irq >= 0 && irq < 16) ? irq_counts[irq] : 0;
+}
+
+void idt_irq_window_reset(void) {
+    for (int i = 0; i < 16; i++) {
+        last_rate[i] = irq_counts[i] - win_start[i];
+        last_cycles[i] = win_cycles[i];
+        last_max[i] = win_max[i];
+        win_start[i] = irq_counts[i];
+        win_cycles[i] = win_max[i] = 0;
+    }
+}
+
+static uint32_t cycles_to_us(uint64_t c) {
+    uint32_t per_us = timer_cycles_per_us();
+    if (!per_us) return 0;
+    if (c > 0xFFFFFFFFu) return 0xFFFFFFFFu / per_us;
+    return (uint32_t)c / per_us;
+}
+
+void idt_get_irq_overview(irq_overview_t *out) {
+    memset(out, 0, sizeof(*out));
+    uint32_t busy = 0;
+    for (int i = 0; i < 16; i++) {
+        irq_line_stats_t *s = &out->line[i];
+        s->count = irq_counts[i];
+        s->rate = last_rate[i];
+        uint64_t c = irq_cycles[i];
+        uint32_t n = s->count;
+        while (c > 0xFFFFFFFFu) { c >>= 1; n >>= 1; }     /* no 64-bit divide */
+        s->avg_us = n ? cycles_to_us((uint32_t)c / n) : 0;
+        s->window_us = cycles_to_us(last_cycles[i]);
+        s->max_us = cycles_to_us(last_max[i]);
+        s->peak_us = cycles_to_us(irq_peak[i]);
+        out->total_rate += s->rate;
+        busy += s->window_us;
+    }
+    out->busy_permille = busy >= 1000000 ? 1000 : busy / 1000;
+}
+
+const char *idt_irq_name(int irq) {
+    static const char *names[16] = {
+        "timer", "keyboard", "cascade", "com2", "com1", "irq5", "floppy", "lpt1",
+        "rtc", "irq9", "irq10", "irq11", "mouse", "fpu", "ata0", "ata1"
+    };
+    return (irq >= 0 && irq < 16) ? names[irq] : "?";
 }
 
 /* Called by irq_common_stub in assembly */
 void irq_handler(registers_t *regs) {
+    irq_lock();
+    uint64_t t0 = rdtsc();
+    int irq = (regs->int_no - 32) & 15;
+    irq_counts[irq]++;
+    TRACE(TR_IRQ_ENTER, irq, 0);
+
+    /* Woken early from a tickless idle stretch: catch the clock up first */
+    if (regs->int_no != 32) timer_idle_exit();
+
     /* Send EOI (End Of Interrupt) to PIC */
     if (regs->int_no >= 40) outb(0xA0, 0x20); /* Slave PIC */
     outb(0x20, 0x20); /* Master PIC */
@@ -160,4 +244,13 @@ void irq_handler(registers_t *regs) {
     if (interrupt_handlers[regs->int_no]) {
         interrupt_handlers[regs->int_no](regs);
     }
+    TRACE(TR_IRQ_EXIT, irq, 0);
+
+    uint64_t d = rdtsc() - t0;
+    uint32_t c = d > 0xFFFFFFFFu ? 0xFFFFFFFFu : (uint32_t)d;
+    irq_cycles[irq] += c;
+    win_cycles[irq] += c;
+    if (c > win_max[irq]) win_max[irq] = c;
+    if (c > irq_peak[irq]) irq_peak[irq] = c;
+    irq_unlock();
 }
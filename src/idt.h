@@ -14,6 +14,29 @@ typedef struct {
 typedef void (*isr_handler_t)(registers_t *);
 
 void idt_init(void);
+void idt_load(void);                              /* lidt on the calling CPU */
+void idt_set_stub(uint8_t n, void (*stub)(void)); /* raw ring-0 gate */
 void register_interrupt_handler(uint8_t n, isr_handler_t handler);
+uint32_t idt_irq_count(int irq);   /* IRQs taken on line 0-15 since boot */
+
+/* ── IRQ statistics (system monitor, shell 'status') ───────── */
+typedef struct {
+    uint32_t count;         /* since boot */
+    uint32_t rate;          /* per second, last window */
+    uint32_t avg_us;        /* handler time, since boot */
+    uint32_t window_us;     /* handler time summed over the last window */
+    uint32_t max_us;        /* slowest handler in the last window */
+    uint32_t peak_us;       /* slowest handler since boot */
+} irq_line_stats_t;
+
+typedef struct {
+    irq_line_stats_t line[16];
+    uint32_t total_rate;    /* IRQs per second, all lines */
+    uint32_t busy_permille; /* share of the last window spent in handlers */
+} irq_overview_t;
+
+void idt_get_irq_overview(irq_overview_t *out);
+void idt_irq_window_reset(void);   /* roll the window; call every ~1s */
+const char *idt_irq_name(int irq);
 
 #endif
@@ -10,6 +10,7 @@ section .text
 extern isr_handler
 extern irq_handler
 extern switch_context
+extern switch_finish
 
 ; ── Common ISR stub ────────────────────────────────────────
 isr_common_stub:
@@ -31,6 +32,7 @@ isr_common_stub:
     call switch_context
     add esp, 4
     mov esp, eax        ; update ESP to new task's stack
+    call switch_finish  ; the old task may now run elsewhere
 
     pop eax             ; restore data segment
     mov ds, ax
@@ -62,6 +64,7 @@ irq_common_stub:
     call switch_context
     add esp, 4
     mov esp, eax        ; update ESP to new task's stack
+    call switch_finish  ; the old task may now run elsewhere
 
     pop eax
     mov ds, ax
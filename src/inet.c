@@ -0,0 +1,391 @@
+/* ============================================================
+ * SwanOS — IPv4 Stack
+ * Ethernet framing, ARP resolution, IPv4 in/out, ICMP echo and
+ * UDP ports, driven by the SOFTIRQ_INET bottom half off the
+ * netdev receive queue.
+ * ============================================================ */
+
+#include "inet.h"
+#include "tcp.h"
+#include "dhcp.h"
+#include "netdev.h"
+#include "softirq.h"
+#include "timer.h"
+#include "string.h"
+
+static netdev_t *dev = 0;
+static inet_config_t cfg;
+static inet_stats_t stats;
+static ktimer_t tick_timer;
+static volatile int tick_due = 0;
+static uint16_t ip_id = 1;
+
+static const uint8_t mac_broadcast[6] = { 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF };
+
+/* ── Checksums ────────────────────────────────────────────── */
+
+uint16_t inet_checksum(const void *data, int len, uint32_t sum) {
+    const uint8_t *p = (const uint8_t *)data;
+    for (; len > 1; p += 2, len -= 2) sum += (uint32_t)(p[0] << 8 | p[1]);
+    if (len) sum += (uint32_t)(p[0] << 8);
+    while (sum >> 16) sum = (sum & 0xFFFF) + (sum >> 16);
+    return htons((uint16_t)~sum);
+}
+
+uint32_t inet_pseudo_sum(ip4_t src, ip4_t dst, uint8_t proto, int len) {
+    uint32_t s = ntohl(src), d = ntohl(dst);
+    return (s >> 16) + (s & 0xFFFF) + (d >> 16) + (d & 0xFFFF) + proto + (uint32_t)len;
+}
+
+/* ── Ethernet ─────────────────────────────────────────────── */
+
+static int eth_output(netbuf_t *b, const uint8_t *dst, uint16_t type) {
+    uint8_t *h = netbuf_push(b, ETH_HLEN);
+    if (!h) { netbuf_free(b); return -1; }
+    memcpy(h, dst, 6);
+    memcpy(h + 6, dev->mac, 6);
+    h[12] = (uint8_t)(type >> 8);
+    h[13] = (uint8_t)type;
+    return net_send(b);
+}
+
+/* ── ARP ──────────────────────────────────────────────────── */
+#define ARP_TABLE     16
+#define ARP_EXPIRE    (60 * 1000 / INET_TICK_MS)    /* ticks: a minute */
+#define ARP_RETRY     10        /* ticks between requests */
+#define ARP_GIVE_UP   30
+
+enum { ARP_FREE, ARP_PENDING, ARP_OK };
+
+typedef struct {
+    ip4_t    ip;
+    uint8_t  mac[6];
+    uint8_t  state;
+    uint16_t age;               /* ticks since learned / first asked */
+    netbuf_t *wait;             /* newest packet held for the reply */
+} arp_entry_t;
+
+static arp_entry_t arp[ARP_TABLE];
+
+static arp_entry_t *arp_find(ip4_t ip) {
+    for (int i = 0; i < ARP_TABLE; i++)
+        if (arp[i].state != ARP_FREE && arp[i].ip == ip) return &arp[i];
+    return 0;
+}
+
+/* Free slot, else the oldest entry */
+static arp_entry_t *arp_slot(void) {
+    arp_entry_t *best = &arp[0];
+    for (int i = 0; i < ARP_TABLE; i++) {
+        if (arp[i].state == ARP_FREE) return &arp[i];
+        if (arp[i].age > best->age) best = &arp[i];
+    }
+    netbuf_free(best->wait);
+    best->wait = 0;
+    return best;
+}
+
+static void arp_send(uint16_t oper, const uint8_t *tha, ip4_t tpa) {
+    netbuf_t *b = netbuf_alloc();
+    if (!b) return;
+    uint8_t *p = b->data;
+    p[0] = 0; p[1] = 1;                 /* Ethernet */
+    p[2] = 0x08; p[3] = 0x00;           /* IPv4 */
+    p[4] = 6; p[5] = 4;
+    p[6] = (uint8_t)(oper >> 8); p[7] = (uint8_t)oper;
+    memcpy(p + 8, dev->mac, 6);
+    memcpy(p + 14, &cfg.addr, 4);
+    memcpy(p + 18, tha, 6);
+    memcpy(p + 24, &tpa, 4);
+    b->len = 28;
+    stats.arp_tx++;
+    eth_output(b, oper == 1 ? mac_broadcast : tha, ETH_P_ARP);
+}
+
+static void arp_learn(ip4_t ip, const uint8_t *mac) {
+    arp_entry_t *e = arp_find(ip);
+    if (!e) { e = arp_slot(); e->ip = ip; }
+    memcpy(e->mac, mac, 6);
+    e->state = ARP_OK;
+    e->age = 0;
+    if (e->wait) {
+        netbuf_t *w = e->wait;
+        e->wait = 0;
+        eth_output(w, e->mac, ETH_P_IP);
+    }
+}
+
+static void arp_input(const uint8_t *p, int len) {
+    if (len < 28 || p[1] != 1 || p[2] != 0x08 || p[3] != 0x00) return;
+    stats.arp_rx++;
+    uint16_t oper = (uint16_t)(p[6] << 8 | p[7]);
+    ip4_t spa, tpa;
+    memcpy(&spa, p + 14, 4);
+    memcpy(&tpa, p + 24, 4);
+    if (!cfg.configured || tpa != cfg.addr) {
+        if (arp_find(spa)) arp_learn(spa, p + 8);   /* refresh only */
+        return;
+    }
+    arp_learn(spa, p + 8);
+    if (oper == 1) arp_send(2, p + 8, spa);
+}
+
+static void arp_tick(void) {
+    for (int i = 0; i < ARP_TABLE; i++) {
+        arp_entry_t *e = &arp[i];
+        if (e->state == ARP_FREE) continue;
+        e->age++;
+        if (e->state == ARP_OK && e->age > ARP_EXPIRE) {
+            e->state = ARP_FREE;
+        } else if (e->state == ARP_PENDING) {
+            if (e->age >= ARP_GIVE_UP) {
+                stats.arp_miss++;
+                netbuf_free(e->wait);
+                e->wait = 0;
+                e->state = ARP_FREE;
+            } else if (e->age % ARP_RETRY == 0) {
+                arp_send(1, (const uint8_t *)"\0\0\0\0\0\0", e->ip);
+            }
+        }
+    }
+}
+
+/* ── IPv4 ─────────────────────────────────────────────────── */
+
+static int on_link(ip4_t dst) {
+    return ((dst ^ cfg.addr) & cfg.mask) == 0;
+}
+
+int ip_output(netbuf_t *b, ip4_t dst, uint8_t proto) {
+    uint8_t *h = netbuf_push(b, IP_HLEN);
+    if (!h) { netbuf_free(b); return -1; }
+    uint16_t total = b->len, id = ip_id++;
+    h[0] = 0x45;
+    h[1] = 0;
+    h[2] = (uint8_t)(total >> 8); h[3] = (uint8_t)total;
+    h[4] = (uint8_t)(id >> 8);    h[5] = (uint8_t)id;
+    h[6] = 0x40; h[7] = 0;              /* don't fragment */
+    h[8] = 64;
+    h[9] = proto;
+    h[10] = h[11] = 0;
+    memcpy(h + 12, &cfg.addr, 4);
+    memcpy(h + 16, &dst, 4);
+    uint16_t sum = inet_checksum(h, IP_HLEN, 0);
+    memcpy(h + 10, &sum, 2);
+    stats.ip_tx++;
+
+    if (dst == IP4_BROADCAST || !cfg.configured)
+        return eth_output(b, mac_broadcast, ETH_P_IP);
+
+    ip4_t hop = on_link(dst) ? dst : cfg.gateway;
+    arp_entry_t *e = arp_find(hop);
+    if (e && e->state == ARP_OK) return eth_output(b, e->mac, ETH_P_IP);
+
+    /* Hold the packet until the reply; a newer one replaces it */
+    if (!e) {
+        e = arp_slot();
+        e->ip = hop;
+        e->state = ARP_PENDING;
+        e->age = 0;
+        arp_send(1, (const uint8_t *)"\0\0\0\0\0\0", hop);
+    }
+    netbuf_free(e->wait);
+    e->wait = b;
+    return 0;
+}
+
+static void icmp_input(ip4_t src, const uint8_t *p, int len) {
+    if (len < 8 || p[0] != 8) return;   /* echo requests only */
+    netbuf_t *b = netbuf_alloc();
+    if (!b) return;
+    if (len > NETBUF_SIZE - NETBUF_HEADROOM) { netbuf_free(b); return; }
+    memcpy(b->data, p, len);
+    b->len = (uint16_t)len;
+    b->data[0] = 0;                     /* echo reply */
+    b->data[2] = b->data[3] = 0;
+    uint16_t sum = inet_checksum(b->data, len, 0);
+    memcpy(b->data + 2, &sum, 2);
+    stats.icmp_echo++;
+    ip_output(b, src, IP_PROTO_ICMP);
+}
+
+/* ── UDP ──────────────────────────────────────────────────── */
+#define UDP_PORTS 4
+
+static struct { uint16_t port; udp_handler_t fn; } udp_ports[UDP_PORTS];
+
+int udp_bind(uint16_t port, udp_handler_t fn) {
+    for (int i = 0; i < UDP_PORTS; i++)
+        if (udp_ports[i].fn && udp_ports[i].port == port) return -1;
+    for (int i = 0; i < UDP_PORTS; i++) {
+        if (udp_ports[i].fn) continue;
+        udp_ports[i].port = port;
+        udp_ports[i].fn = fn;
+        return 0;
+    }
+    return -1;
+}
+
+int udp_send(ip4_t dst, uint16_t sport, uint16_t dport, const void *data, int len) {
+    if (len > NET_MTU - IP_HLEN - UDP_HLEN) return -1;
+    netbuf_t *b = netbuf_alloc();
+    if (!b) return -1;
+    memcpy(b->data, data, len);
+    b->len = (uint16_t)len;
+    uint8_t *h = netbuf_push(b, UDP_HLEN);
+    uint16_t ulen = b->len;
+    h[0] = (uint8_t)(sport >> 8); h[1] = (uint8_t)sport;
+    h[2] = (uint8_t)(dport >> 8); h[3] = (uint8_t)dport;
+    h[4] = (uint8_t)(ulen >> 8);  h[5] = (uint8_t)ulen;
+    h[6] = h[7] = 0;
+    uint16_t sum = inet_checksum(h, ulen, inet_pseudo_sum(cfg.addr, dst, IP_PROTO_UDP, ulen));
+    if (!sum) sum = 0xFFFF;
+    memcpy(h + 6, &sum, 2);
+    return ip_output(b, dst, IP_PROTO_UDP);
+}
+
+static void udp_input(ip4_t src, const uint8_t *p, int len) {
+    if (len < UDP_HLEN) return;
+    uint16_t sport = (uint16_t)(p[0] << 8 | p[1]);
+    uint16_t dport = (uint16_t)(p[2] << 8 | p[3]);
+    int ulen = p[4] << 8 | p[5];
+    if (ulen < UDP_HLEN || ulen > len) { stats.ip_bad++; return; }
+    stats.udp_rx++;
+    for (int i = 0; i < UDP_PORTS; i++) {
+        if (udp_ports[i].fn && udp_ports[i].port == dport) {
+            udp_ports[i].fn(src, sport, p + UDP_HLEN, ulen - UDP_HLEN);
+            return;
+        }
+    }
+    stats.udp_noport++;
+}
+
+static void ip_input(const uint8_t *h, int len) {
+    if (len < IP_HLEN || (h[0] >> 4) != 4) { stats.ip_bad++; return; }
+    int hlen = (h[0] & 15) * 4;
+    int total = h[2] << 8 | h[3];
+    if (hlen < IP_HLEN || total < hlen || total > len ||
+        inet_checksum(h, hlen, 0) != 0 ||
+        ((h[6] & 0x3F) | h[7])) {       /* MF or an offset: no reassembly */
+        stats.ip_bad++;
+        return;
+    }
+    ip4_t src, dst;
+    memcpy(&src, h + 12, 4);
+    memcpy(&dst, h + 16, 4);
+    if (cfg.configured && dst != cfg.addr && dst != IP4_BROADCAST &&
+        dst != (cfg.addr | ~cfg.mask))
+        return;
+    stats.ip_rx++;
+
+    const uint8_t *p = h + hlen;
+    int n = total - hlen;
+    switch (h[9]) {
+        case IP_PROTO_ICMP: if (cfg.configured) icmp_input(src, p, n); break;
+        case IP_PROTO_UDP:  udp_input(src, p, n); break;
+        case IP_PROTO_TCP:  if (cfg.configured) tcp_input(src, dst, p, n); break;
+    }
+}
+
+static void eth_input(netbuf_t *b) {
+    if (b->len >= ETH_HLEN) {
+        uint16_t type = (uint16_t)(b->data[12] << 8 | b->data[13]);
+        const uint8_t *p = b->data + ETH_HLEN;
+        int n = b->len - ETH_HLEN;
+        if (type == ETH_P_ARP) arp_input(p, n);
+        else if (type == ETH_P_IP) ip_input(p, n);
+    }
+    netbuf_free(b);
+}
+
+/* ── Bottom half ──────────────────────────────────────────── */
+
+static void inet_bh(void) {
+    if (!dev) return;
+    int n = 0;
+    netbuf_t *b;
+    while (n < NET_POLL_BUDGET && (b = net_recv())) {
+        eth_input(b);
+        n++;
+    }
+    if (tick_due) {
+        tick_due = 0;
+        arp_tick();
+        dhcp_tick();
+        tcp_tick();
+    }
+    tcp_flush();
+    if (n == NET_POLL_BUDGET) softirq_raise(SOFTIRQ_INET);
+}
+
+static void inet_tick(void *arg) {
+    (void)arg;
+    tick_due = 1;
+    softirq_raise(SOFTIRQ_INET);
+}
+
+void inet_kick(void) {
+    softirq_raise(SOFTIRQ_INET);
+}
+
+int inet_init(void) {
+    dev = netdev_get();
+    if (!dev) return -1;
+    memset(&cfg, 0, sizeof(cfg));
+    memset(&stats, 0, sizeof(stats));
+    memset(arp, 0, sizeof(arp));
+    tcp_init();
+    softirq_register(SOFTIRQ_INET, inet_bh);
+    uint32_t ticks = INET_TICK_MS * timer_get_frequency() / 1000;
+    timer_setup(&tick_timer, inet_tick, 0);
+    timer_arm(&tick_timer, ticks, ticks);
+    dhcp_start();
+    return 0;
+}
+
+int inet_up(void) {
+    return dev != 0;
+}
+
+const inet_config_t *inet_config(void) {
+    return &cfg;
+}
+
+void inet_configure(ip4_t addr, ip4_t mask, ip4_t gateway, ip4_t dns) {
+    cfg.addr = addr;
+    cfg.mask = mask;
+    cfg.gateway = gateway;
+    cfg.dns = dns;
+    cfg.configured = addr != 0;
+}
+
+void inet_get_stats(inet_stats_t *out) {
+    *out = stats;
+}
+
+/* ── Addresses ────────────────────────────────────────────── */
+
+char *ip4_format(ip4_t a, char *buf) {
+    const uint8_t *o = (const uint8_t *)&a;
+    char t[4];
+    buf[0] = '\0';
+    for (int i = 0; i < 4; i++) {
+        itoa(o[i], t, 10);
+        strcat(buf, t);
+        if (i < 3) strcat(buf, ".");
+    }
+    return buf;
+}
+
+int ip4_parse(const char *s, ip4_t *out) {
+    uint8_t o[4];
+    for (int i = 0; i < 4; i++) {
+        int v = 0, digits = 0;
+        while (*s >= '0' && *s <= '9' && digits < 4) { v = v * 10 + (*s++ - '0'); digits++; }
+        if (!digits || v > 255) return -1;
+        o[i] = (uint8_t)v;
+        if (i < 3 && *s++ != '.') return -1;
+    }
+    memcpy(out, o, 4);
+    return 0;
+}
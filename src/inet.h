@@ -0,0 +1,74 @@
+#ifndef INET_H
+#define INET_H
+
+#include <stdint.h>
+#include "netbuf.h"
+
+/* ── IPv4 stack ───────────────────────────────────────────────
+ * Ethernet, ARP, IPv4, ICMP echo and UDP (plus TCP, tcp.h, and the
+ * DHCP client, dhcp.h). All protocol work runs in the SOFTIRQ_INET
+ * bottom half: received frames, the INET_TICK_MS timer and output
+ * queued by tasks are handled there one pass at a time. Functions
+ * marked "bottom half" may only be called from protocol code.
+ *
+ * An output buffer comes from netbuf_alloc with its payload written
+ * at data; each layer pushes its header in front, and the buffer is
+ * passed on (and eventually freed) by the layer below.             */
+typedef uint32_t ip4_t;         /* network byte order */
+
+#define IP4(a, b, c, d) \
+    ((ip4_t)((a) | (b) << 8 | (c) << 16 | (uint32_t)(d) << 24))
+#define IP4_BROADCAST 0xFFFFFFFFu
+
+static inline uint16_t htons(uint16_t v) { return (uint16_t)(v << 8 | v >> 8); }
+static inline uint16_t ntohs(uint16_t v) { return htons(v); }
+static inline uint32_t htonl(uint32_t v) { return __builtin_bswap32(v); }
+static inline uint32_t ntohl(uint32_t v) { return __builtin_bswap32(v); }
+
+#define ETH_HLEN      14
+#define ETH_P_IP      0x0800
+#define ETH_P_ARP     0x0806
+#define IP_HLEN       20
+#define IP_PROTO_ICMP 1
+#define IP_PROTO_TCP  6
+#define IP_PROTO_UDP  17
+#define UDP_HLEN      8
+
+#define INET_TICK_MS  100       /* protocol timers run at this rate */
+
+typedef struct {
+    ip4_t addr, mask, gateway, dns;
+    int   configured;           /* address set (DHCP or static) */
+} inet_config_t;
+
+typedef struct {
+    uint32_t ip_rx, ip_tx, ip_bad;      /* bad: checksum, length, fragments */
+    uint32_t arp_rx, arp_tx, arp_miss;  /* miss: gave up resolving */
+    uint32_t icmp_echo, udp_rx, udp_noport;
+} inet_stats_t;
+
+/* Start the stack on the registered NIC (after net_init); -1 without one */
+int  inet_init(void);
+int  inet_up(void);
+const inet_config_t *inet_config(void);
+void inet_configure(ip4_t addr, ip4_t mask, ip4_t gateway, ip4_t dns);
+void inet_get_stats(inet_stats_t *out);
+
+/* Queue a pass of the bottom half, e.g. after tasks queued output */
+void inet_kick(void);
+
+/* ── IP layer (bottom half) ───────────────────────────────── */
+int      ip_output(netbuf_t *b, ip4_t dst, uint8_t proto);   /* takes b */
+uint16_t inet_checksum(const void *data, int len, uint32_t sum);
+uint32_t inet_pseudo_sum(ip4_t src, ip4_t dst, uint8_t proto, int len);
+
+/* ── UDP (bottom half) ────────────────────────────────────── */
+typedef void (*udp_handler_t)(ip4_t src, uint16_t sport, const uint8_t *data, int len);
+int  udp_bind(uint16_t port, udp_handler_t fn);     /* -1 if taken or full */
+int  udp_send(ip4_t dst, uint16_t sport, uint16_t dport, const void *data, int len);
+
+/* ── Addresses ────────────────────────────────────────────── */
+char *ip4_format(ip4_t a, char *buf);   /* buf: 16 bytes */
+int   ip4_parse(const char *s, ip4_t *out);  /* 0, or -1 if not a.b.c.d */
+
+#endif
@@ -0,0 +1,116 @@
+/* ============================================================
+ * SwanOS — Input Event Queue
+ * Timestamped key and pointer events from the input bottom
+ * halves, read by the desktop loop and the shell.
+ * ============================================================ */
+
+#include "input.h"
+#include "softirq.h"
+#include "spinlock.h"
+#include "timer.h"
+#include "string.h"
+
+static input_event_t queue[INPUT_QUEUE];
+static uint32_t q_head = 0, q_tail = 0;
+static uint32_t dropped = 0;
+static uint32_t coalesced = 0;
+static spinlock_t q_lock = SPINLOCK_INIT;
+static wait_queue_t q_wait;
+
+void input_init(void) {
+    q_head = q_tail = 0;
+    dropped = coalesced = 0;
+}
+
+static int motion_only(const input_event_t *e) {
+    return e->type == INPUT_MOUSE && !e->pressed && !e->released;
+}
+
+static int clamp8(int v) {
+    return v > 127 ? 127 : v < -128 ? -128 : v;
+}
+
+/* Fold motion into the newest queued event if it is motion with
+ * the same buttons held; the reader has not taken it yet */
+static int coalesce(const input_event_t *ev) {
+    if (q_head == q_tail || !motion_only(ev)) return 0;
+    input_event_t *last = &queue[(q_head - 1) & (INPUT_QUEUE - 1)];
+    if (!motion_only(last) || last->buttons != ev->buttons) return 0;
+    last->time_us = ev->time_us;
+    last->x = ev->x;
+    last->y = ev->y;
+    last->dx += ev->dx;
+    last->dy += ev->dy;
+    last->wheel = (int8_t)clamp8(last->wheel + ev->wheel);
+    last->packets += ev->packets;
+    coalesced++;
+    return 1;
+}
+
+void input_push(const input_event_t *ev) {
+    uint32_t flags = spin_lock_irqsave(&q_lock);
+    int room = 1;
+    if (!coalesce(ev)) {
+        room = q_head - q_tail < INPUT_QUEUE;
+        if (room) queue[q_head++ & (INPUT_QUEUE - 1)] = *ev;
+        else dropped++;
+    }
+    spin_unlock_irqrestore(&q_lock, flags);
+    if (room) wake_up(&q_wait);
+}
+
+int input_poll(input_event_t *ev) {
+    softirq_run();
+    uint32_t flags = spin_lock_irqsave(&q_lock);
+    int got = q_head != q_tail;
+    if (got) *ev = queue[q_tail++ & (INPUT_QUEUE - 1)];
+    spin_unlock_irqrestore(&q_lock, flags);
+    return got;
+}
+
+int input_wait(input_event_t *ev, uint32_t ticks) {
+    uint32_t start = timer_get_ticks();
+    for (;;) {
+        if (input_poll(ev)) return 1;
+        uint32_t waited = timer_get_ticks() - start;
+        if (ticks && waited >= ticks) return 0;
+
+        /* Raised bottom halves wake us too: we may run them faster
+         * than softirqd gets scheduled */
+        uint32_t flags = irq_save();
+        if (q_head == q_tail && !softirq_pending()) {
+            wait_queue_t *qs[2] = { &q_wait, softirq_queue() };
+            sleep_on_any(qs, 2, ticks ? ticks - waited : 0);
+        }
+        irq_restore(flags);
+    }
+}
+
+int input_has(int type) {
+    softirq_run();
+    uint32_t flags = spin_lock_irqsave(&q_lock);
+    int found = 0;
+    for (uint32_t i = q_tail; i != q_head && !found; i++)
+        found = queue[i & (INPUT_QUEUE - 1)].type == type;
+    spin_unlock_irqrestore(&q_lock, flags);
+    return found;
+}
+
+int input_pending(void) {
+    return q_head != q_tail || softirq_pending();
+}
+
+void input_flush(void) {
+    softirq_run();
+    uint32_t flags = spin_lock_irqsave(&q_lock);
+    q_tail = q_head;
+    spin_unlock_irqrestore(&q_lock, flags);
+}
+
+uint32_t input_dropped(void) {
+    return dropped;
+}
+
+uint32_t input_coalesced(void) {
+    return coalesced;
+}
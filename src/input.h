@@ -0,0 +1,48 @@
+#ifndef INPUT_H
+#define INPUT_H
+
+#include <stdint.h>
+
+/* ── Input events ─────────────────────────────────────────────
+ * Keyboard, mouse and GUI keystrokes (serial) are decoded by their
+ * bottom halves (softirq.h) into one queue, in arrival order and
+ * stamped with the time the top half took the device's last byte.
+ * A full queue drops new events and counts them.
+ *
+ * Pointer motion is coalesced on the way in: a motion-only event
+ * folds into a newest queued one with the same buttons held, so
+ * a reader that takes the queue once per frame gets one motion per
+ * gap between button transitions, with the deltas summed. Presses
+ * and releases are never merged, whatever the reader's frame rate. */
+#define INPUT_KEY    1
+#define INPUT_MOUSE  2
+#define INPUT_QUEUE  256        /* events, power of two */
+
+typedef struct {
+    uint32_t time_us;           /* timer_get_us() */
+    uint8_t  type;              /* INPUT_* */
+    uint8_t  key;               /* INPUT_KEY: ASCII or KEY_* */
+    uint8_t  buttons;           /* INPUT_MOUSE: held after the event */
+    uint8_t  pressed;           /* buttons that went down with it */
+    uint8_t  released;          /* and those that came up */
+    int8_t   wheel;             /* detents, positive = towards the user */
+    int16_t  x, y;              /* pointer position after the event */
+    int16_t  dx, dy;            /* motion, screen direction */
+    uint16_t packets;           /* device packets folded into this one */
+} input_event_t;
+
+void input_init(void);
+void input_push(const input_event_t *ev);   /* bottom halves */
+
+/* Run pending bottom halves, then take the oldest event: 1 if one
+ * was taken. input_wait sleeps for one, up to `ticks` (0 = forever). */
+int  input_poll(input_event_t *ev);
+int  input_wait(input_event_t *ev, uint32_t ticks);
+
+int  input_has(int type);       /* an event of `type` is queued */
+int  input_pending(void);       /* events queued, or decoding still to do */
+void input_flush(void);
+uint32_t input_dropped(void);
+uint32_t input_coalesced(void);  /* motion events merged away */
+
+#endif
@@ -8,10 +8,15 @@
 #include "string.h"
 #include "idt.h"
 #include "timer.h"
+#include "rtc.h"
+#include "softirq.h"
+#include "input.h"
 #include "keyboard.h"
 #include "serial.h"
+#include "bridge.h"
 #include "memory.h"
 #include "fs.h"
+#include "ata.h"
 #include "user.h"
 #include "shell.h"
 #include "vga_gfx.h"
@@ -23,9 +28,20 @@
 #include "syscall.h"
 #include "multiboot.h"
 #include "llm.h"
+#include "pci.h"
 #include "network.h"
+#include "inet.h"
+#include "bridge_tcp.h"
 #include "audit.h"
 #include "kernel_ai.h"
+#include "simd.h"
+#include "telemetry.h"
+#include "acpi.h"
+#include "smp.h"
+#include "trace.h"
+#ifdef SWAN_BENCH
+#include "bench.h"
+#endif
 
 /* ── Advanced Boot Splash ────────────────────────────────── */
 /* Particle system, neural network nodes, pulsing rings,
@@ -288,7 +304,7 @@ static void gfx_boot_splash(void) {
 /* ── Styled Text-mode Boot Sequence ─────────────────────── */
 
 static int boot_step = 0;
-#define BOOT_TOTAL 17
+#define BOOT_TOTAL 22
 
 /* Draw the boot progress bar at the bottom */
 static void draw_boot_progress(void) {
@@ -469,6 +485,10 @@ void kernel_main(uint32_t magic, uint32_t mboot_info_addr) {
     idt_init();
     boot_status("Interrupt Descriptor Table loaded");
 
+    simd_init();
+    boot_status(simd_level() == SIMD_SSE2 ? "SIMD pixel kernels: SSE2 (FXSAVE context)"
+                                          : "SIMD pixel kernels: scalar fallback");
+
     process_init();
     boot_status("Dynamic process scheduler initialized (priority-based)");
 
@@ -478,29 +498,59 @@ void kernel_main(uint32_t magic, uint32_t mboot_info_addr) {
     timer_init(100);
     boot_status("PIT timer @ 100 Hz (periodic callbacks enabled)");
 
+    rtc_init();
+    boot_status("Wall clock read from CMOS RTC (resync every minute)");
+
     serial_init();
     boot_status("COM1 serial port ready");
 
+    bridge_init();
+    boot_status("Bridge framing: 6 channels, 8 concurrent requests");
+
+    softirq_init();
+    input_init();
+    boot_status("Input bottom halves deferred to softirqd");
+
     keyboard_init();
     boot_status("PS/2 keyboard driver loaded");
 
-    memory_init();
-    boot_status("Memory allocator ready (8 MB heap)");
+    memory_init(mboot);
+    boot_status("Memory allocator ready (32 MB heap)");
+
+    /* MADT is read through physical addresses, before paging */
+    int madt = acpi_init() == 0;
 
     paging_init();
     boot_status("Virtual memory paging enabled");
 
+    smp_init();
+    if (smp_cpu_count() > 1) {
+        char msg[48], num[12];
+        itoa(smp_cpu_count(), num, 10);
+        strcpy(msg, "SMP: ");
+        strcat(msg, num);
+        strcat(msg, " CPUs online (LAPIC, INIT-SIPI)");
+        boot_status(msg);
+    } else {
+        boot_status(madt ? "SMP: single CPU (ACPI MADT)" : "SMP: no ACPI MADT, uniprocessor");
+    }
+
+    trace_init();
+    boot_status("Event tracing: per-CPU rings (shell 'trace')");
+
     mouse_init();
     boot_status("PS/2 mouse driver loaded");
 
     fs_init();
+    int disk = ata_init() && fs_mount() == 0;
     fs_write("readme.txt",
         "Welcome to SwanOS!\n"
         "A bare-metal AI-powered operating system.\n"
         "Type 'help' for commands, 'ask <q>' to talk to AI.");
     fs_mkdir("documents");
     fs_mkdir("programs");
-    boot_status("In-memory filesystem mounted");
+    boot_status(disk ? "SwanFS mounted from ATA disk (write-back cache)"
+                     : "In-memory filesystem mounted (no disk)");
 
     user_init();
 
@@ -518,16 +568,37 @@ void kernel_main(uint32_t magic, uint32_t mboot_info_addr) {
     timer_register_periodic(500, kernel_ai_tick);
     boot_status("AI Kernel Advisor active (realtime telemetry)");
 
-    /* Register process CPU window reset: every 100 ticks (~1s) */
+    telemetry_init();
+    boot_status("Binary telemetry sampler @ 10 Hz (delta batches)");
+
+    /* CPU and IRQ accounting windows: every 100 ticks (~1s) */
     timer_register_periodic(100, process_cpu_window_reset);
+    timer_register_periodic(100, idt_irq_window_reset);
     boot_status("CPU accounting enabled (1s window)");
 
+    /* Preemptive scheduling; also spawns the page-zeroing idle process */
+    process_start_scheduling();
+
+    pci_init();
+    boot_status("PCI devices enumerated (registry for drivers)");
+
     net_init();
-    if (net_get_status()->detected)
+    if (net_get_status()->driven) {
+        boot_status("Network driver up (DMA rings, interrupt moderation)");
+        if (inet_init() == 0) {
+            bridge_tcp_init();
+            boot_status("TCP/IP stack up (DHCP), bridge link on TCP 5555");
+        }
+    }
+    else if (net_get_status()->detected)
         boot_status("Network interface detected");
     else
         boot_status("No network adapter found");
 
+#ifdef SWAN_BENCH
+    bench_run();                /* `make bench`: report and power off */
+#endif
+
     /* Clear progress bar and show completion */
     for (int r = 19; r < 22; r++)
         screen_fill_row(r, 0, 79, ' ', VGA_WHITE, VGA_BLACK);
@@ -1,7 +1,8 @@
 /* ============================================================
  * SwanOS — Realtime AI Kernel Advisor
- * Non-blocking telemetry loop, crash analysis via LLM,
- * scheduler hints, and rolling advice buffer for display.
+ * Non-blocking telemetry loop, a local policy engine for crash
+ * and scheduling decisions (refined by the LLM in the background),
+ * and rolling advice buffer for display.
  * ============================================================ */
 
 #include "kernel_ai.h"
@@ -11,13 +12,47 @@
 #include "memory.h"
 #include "process.h"
 #include "timer.h"
+#include "telemetry.h"
+#include "spinlock.h"
+#include "wait.h"
+#include "cpu.h"
 
 /* ── State ─────────────────────────────────────────────────── */
 static kernel_ai_status_t ai_status;
 static uint32_t init_tick = 0;
 static uint32_t last_telemetry_tick = 0;
 static uint32_t last_heartbeat_tick = 0;
-static uint32_t last_scheduler_tick = 0;
+
+/* ── Policy Engine ─────────────────────────────────────────── */
+/* Decisions come from local tables at once; the LLM only refines
+ * them. The ai-policy worker owns every bridge round-trip: it drains
+ * the crash reports queued by fault handlers, prefetches scheduler
+ * hints and a health summary on a cadence, and folds the replies
+ * back into the tables. */
+#define AI_CRASH_QUEUE   4
+#define AI_HINT_SECS     30
+#define AI_HINT_TTL      120     /* stale hints stop being applied */
+#define AI_SUMMARY_SECS  25      /* ahead of the desktop's 30 s refresh */
+#define AI_SUMMARY_TTL   90
+#define AI_RULE_TTL      300     /* ask again about a kind of crash after this */
+
+typedef struct {
+    uint32_t addr, pid;
+    char     reason[24];
+    char     proc[16];
+} crash_report_t;
+
+static spinlock_t policy_lock = SPINLOCK_INIT;  /* rules, hints, crash queue, summary */
+static ai_rule_t rules[AI_MAX_RULES];
+static int n_rules = 1;           /* slot 0: the local catch-all */
+static ai_hint_t hints[AI_MAX_HINTS];
+static int n_hints = 0;
+static crash_report_t crash_q[AI_CRASH_QUEUE];
+static uint32_t crash_head = 0, crash_tail = 0;
+static char ai_summary[80];
+static uint32_t ai_summary_tick = 0;
+static volatile int hints_wanted = 0;
+static wait_queue_t policy_wait;
 
 /* Hex helper for crash analysis */
 static char hex_chars[] = "0123456789ABCDEF";
@@ -31,12 +66,301 @@ static void to_hex(uint32_t val, char *buf) {
     buf[10] = '\0';
 }
 
+/* ── Rule & Hint Tables ───────────────────────────────────── */
+/* Callers hold policy_lock. */
+
+static int field_match(const char *rule, const char *val) {
+    return !rule[0] || strcmp(rule, val) == 0;
+}
+
+/* Most specific match: process name beats reason beats the
+   catch-all in slot 0, which always matches */
+static ai_rule_t *rule_match(const char *reason, const char *proc) {
+    ai_rule_t *best = &rules[0];
+    int best_score = -1;
+    for (int i = 0; i < n_rules; i++) {
+        ai_rule_t *r = &rules[i];
+        if (!field_match(r->reason, reason) || !field_match(r->proc, proc)) continue;
+        int score = (r->proc[0] ? 2 : 0) + (r->reason[0] ? 1 : 0);
+        if (score > best_score) { best = r; best_score = score; }
+    }
+    return best;
+}
+
+static ai_rule_t *rule_exact(const char *reason, const char *proc) {
+    for (int i = 1; i < n_rules; i++)
+        if (strcmp(rules[i].reason, reason) == 0 && strcmp(rules[i].proc, proc) == 0)
+            return &rules[i];
+    return 0;
+}
+
+/* Learned rules evict the least recently updated one when full;
+   the catch-all is never replaced */
+static void rule_learn(const char *reason, const char *proc, int restart) {
+    ai_rule_t *r = rule_exact(reason, proc);
+    if (!r) {
+        if (n_rules < AI_MAX_RULES) {
+            r = &rules[n_rules++];
+        } else {
+            r = &rules[1];
+            for (int i = 2; i < n_rules; i++)
+                if (rules[i].updated < r->updated) r = &rules[i];
+        }
+        memset(r, 0, sizeof(*r));
+        strncpy(r->reason, reason, sizeof(r->reason) - 1);
+        strncpy(r->proc, proc, sizeof(r->proc) - 1);
+    }
+    r->restart = (uint8_t)restart;
+    r->source = AI_RULE_LLM;
+    r->updated = timer_get_ticks();
+}
+
+static void hint_set(const char *proc, int priority) {
+    ai_hint_t *h = 0;
+    for (int i = 0; i < n_hints; i++)
+        if (strcmp(hints[i].proc, proc) == 0) h = &hints[i];
+    if (!h) {
+        if (n_hints < AI_MAX_HINTS) {
+            h = &hints[n_hints++];
+        } else {
+            h = &hints[0];
+            for (int i = 1; i < n_hints; i++)
+                if (hints[i].updated < h->updated) h = &hints[i];
+        }
+        memset(h, 0, sizeof(*h));
+        strncpy(h->proc, proc, sizeof(h->proc) - 1);
+    }
+    h->priority = (uint8_t)priority;
+    h->updated = timer_get_ticks();
+}
+
+static int ai_summary_fresh(char *buf, int len) {
+    int ok = 0;
+    uint32_t flags = spin_lock_irqsave(&policy_lock);
+    if (ai_summary[0] &&
+        timer_get_ticks() - ai_summary_tick < timer_get_frequency() * AI_SUMMARY_TTL) {
+        strncpy(buf, ai_summary, len - 1);
+        buf[len - 1] = '\0';
+        ok = 1;
+    }
+    spin_unlock_irqrestore(&policy_lock, flags);
+    return ok;
+}
+
+/* ── Background Policy Worker ─────────────────────────────── */
+
+/* One round-trip; only this process ever waits on the bridge.
+   -2 = no free query slot, -1 = error/timeout, else reply length */
+static int policy_ask(const char *prompt, char *reply, int max_len) {
+    int h = llm_query_begin(prompt);
+    if (h < 0) return -2;
+    int n;
+    while ((n = llm_query_poll(h, reply, max_len)) == 0)
+        llm_query_wait(h);
+    return n;
+}
+
+static void review_crash(const crash_report_t *c) {
+    char prompt[256], reply[128], num[16];
+
+    strcpy(prompt, "PROCESS_CRASH PID:");
+    itoa(c->pid, num, 10);
+    strcat(prompt, num);
+    if (c->proc[0]) {
+        strcat(prompt, " PROC:");
+        strcat(prompt, c->proc);
+    }
+    strcat(prompt, " ADDR:");
+    to_hex(c->addr, num);
+    strcat(prompt, num);
+    strcat(prompt, " REASON:");
+    strcat(prompt, c->reason);
+    strcat(prompt, " -> ACTION? (Respond [RESTART] or [TERMINATE])");
+
+    if (policy_ask(prompt, reply, sizeof(reply)) <= 0) return;
+    int restart;
+    if (strstr(reply, "RESTART")) restart = 1;
+    else if (strstr(reply, "TERMINATE")) restart = 0;
+    else return;
+
+    uint32_t flags = spin_lock_irqsave(&policy_lock);
+    rule_learn(c->reason, c->proc, restart);
+    spin_unlock_irqrestore(&policy_lock, flags);
+    ai_status.rules_learned++;
+
+    char advice[AI_ADVICE_LEN];
+    strcpy(advice, "AI rule: ");
+    strncpy(advice + 9, c->proc[0] ? c->proc : c->reason, 16);
+    advice[25] = '\0';
+    strcat(advice, restart ? " -> RESTART" : " -> TERMINATE");
+    kernel_ai_push_advice(advice);
+}
+
+static int parse_priority(const char *s) {
+    if (strncmp(s, "HIGH", 4) == 0)   return PRIORITY_HIGH;
+    if (strncmp(s, "NORMAL", 6) == 0) return PRIORITY_NORMAL;
+    if (strncmp(s, "LOW", 3) == 0)    return PRIORITY_LOW;
+    return -1;
+}
+
+static int name_char(char c) {
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') ||
+           (c >= '0' && c <= '9') || c == '-' || c == '_';
+}
+
+/* Picks every "name=LEVEL" (or "name:LEVEL") out of the reply */
+static int parse_hints(const char *reply) {
+    int found = 0;
+    for (const char *p = reply; *p; p++) {
+        if (*p != '=' && *p != ':') continue;
+        const char *v = p + 1;
+        while (*v == ' ') v++;
+        int prio = parse_priority(v);
+        if (prio < 0) continue;
+        const char *s = p;
+        while (s > reply && name_char(s[-1])) s--;
+        int n = (int)(p - s);
+        if (n <= 0 || n >= 16) continue;
+
+        char name[16];
+        memcpy(name, s, n);
+        name[n] = '\0';
+        uint32_t flags = spin_lock_irqsave(&policy_lock);
+        hint_set(name, prio);
+        spin_unlock_irqrestore(&policy_lock, flags);
+        found++;
+    }
+    return found;
+}
+
+static process_overview_t policy_ov;
+
+static void fetch_hints(void) {
+    process_get_overview(&policy_ov);
+    if (policy_ov.count <= 1) return; /* Only kernel process, nothing to optimize */
+
+    char prompt[256], reply[192], tmp[16];
+    strcpy(prompt, "SCHEDULER_HINT procs=");
+    itoa(policy_ov.count, tmp, 10); strcat(prompt, tmp);
+    strcat(prompt, " ctx_sw=");
+    itoa(policy_ov.context_switches, tmp, 10); strcat(prompt, tmp);
+
+    /* Add top 3 processes by CPU */
+    int shown = 0;
+    for (int i = 0; i < policy_ov.count && shown < 3; i++) {
+        if (policy_ov.procs[i].cpu_percent > 0) {
+            strcat(prompt, " [");
+            strcat(prompt, policy_ov.procs[i].name);
+            strcat(prompt, ":");
+            itoa(policy_ov.procs[i].cpu_percent, tmp, 10);
+            strcat(prompt, tmp);
+            strcat(prompt, "%]");
+            shown++;
+        }
+    }
+    strcat(prompt, " -> Respond with name=HIGH|NORMAL|LOW per process");
+
+    if (policy_ask(prompt, reply, sizeof(reply)) > 0 && parse_hints(reply) > 0)
+        kernel_ai_push_advice("AI sched hints updated");
+}
+
+/* The scheduler's own tasks keep the priority they were given */
+static int hint_pinned(const process_stats_t *p) {
+    return p->pid == 0 || strcmp(p->name, "idle") == 0 ||
+           strcmp(p->name, "softirqd") == 0 || strcmp(p->name, "ai-policy") == 0;
+}
+
+/* Applied from the local table every pass, so a process started
+   after the last reply gets its hint without another round-trip */
+static void apply_hints(void) {
+    if (!n_hints) return;
+    process_get_overview(&policy_ov);
+    uint32_t now = timer_get_ticks(), ttl = timer_get_frequency() * AI_HINT_TTL;
+    for (int i = 0; i < policy_ov.count; i++) {
+        const process_stats_t *p = &policy_ov.procs[i];
+        if (hint_pinned(p)) continue;
+        int prio = -1;
+        uint32_t flags = spin_lock_irqsave(&policy_lock);
+        for (int k = 0; k < n_hints; k++)
+            if (now - hints[k].updated < ttl && strcmp(hints[k].proc, p->name) == 0)
+                prio = hints[k].priority;
+        spin_unlock_irqrestore(&policy_lock, flags);
+        if (prio >= 0 && prio != p->priority) {
+            process_set_priority(p->pid, (uint8_t)prio);
+            ai_status.hints_applied++;
+        }
+    }
+}
+
+static void fetch_summary(void) {
+    char prompt[160], reply[128], tmp[16];
+    uint32_t mt = mem_total();
+    strcpy(prompt, "HEALTH_SUMMARY mem=");
+    itoa(mt ? (mem_used() * 100) / mt : 0, tmp, 10); strcat(prompt, tmp);
+    strcat(prompt, "% procs=");
+    itoa(process_count_active(), tmp, 10); strcat(prompt, tmp);
+    strcat(prompt, " uptime=");
+    itoa(timer_get_seconds(), tmp, 10); strcat(prompt, tmp);
+    strcat(prompt, "s -> One short status line, under 60 characters");
+
+    if (policy_ask(prompt, reply, sizeof(reply)) <= 0) return;
+    char *nl = strchr(reply, '\n');
+    if (nl) *nl = '\0';
+    if (!reply[0]) return;
+
+    uint32_t flags = spin_lock_irqsave(&policy_lock);
+    strncpy(ai_summary, reply, sizeof(ai_summary) - 1);
+    ai_summary[sizeof(ai_summary) - 1] = '\0';
+    ai_summary_tick = timer_get_ticks();
+    spin_unlock_irqrestore(&policy_lock, flags);
+}
+
+static int crash_pop(crash_report_t *out) {
+    int got = 0;
+    uint32_t flags = spin_lock_irqsave(&policy_lock);
+    if (crash_head != crash_tail) {
+        *out = crash_q[crash_tail % AI_CRASH_QUEUE];
+        crash_tail++;
+        got = 1;
+    }
+    spin_unlock_irqrestore(&policy_lock, flags);
+    return got;
+}
+
+static void policy_main(void) {
+    uint32_t freq = timer_get_frequency();
+    uint32_t last_hint = timer_get_ticks(), last_summary = last_hint - freq * AI_SUMMARY_SECS;
+    for (;;) {
+        uint32_t flags = irq_save();
+        if (!llm_ready() || (crash_head == crash_tail && !hints_wanted))
+            sleep_on_timeout(&policy_wait, freq);
+        irq_restore(flags);
+
+        apply_hints();
+        if (!llm_ready()) continue;
+
+        crash_report_t c;
+        if (crash_pop(&c)) {
+            review_crash(&c);
+            continue;           /* crashes first, then the prefetches */
+        }
+        uint32_t now = timer_get_ticks();
+        if (hints_wanted || now - last_hint >= freq * AI_HINT_SECS) {
+            hints_wanted = 0;
+            last_hint = now;
+            fetch_hints();
+        } else if (now - last_summary >= freq * AI_SUMMARY_SECS) {
+            last_summary = now;
+            fetch_summary();
+        }
+    }
+}
+
 void kernel_ai_init(void) {
     memset(&ai_status, 0, sizeof(ai_status));
     init_tick = timer_get_ticks();
     last_telemetry_tick = init_tick;
     last_heartbeat_tick = init_tick;
-    last_scheduler_tick = init_tick;
     
     ai_status.connected = 0;
     ai_status.advice_count = 0;
@@ -48,6 +372,15 @@ void kernel_ai_init(void) {
     
     /* Send initial heartbeat */
     llm_send_heartbeat();
+
+    /* Local fallback: safety first, terminate whatever crashed */
+    memset(rules, 0, sizeof(rules));
+    rules[0].source = AI_RULE_LOCAL;
+    n_rules = 1;
+    n_hints = 0;
+    crash_head = crash_tail = 0;
+    ai_summary[0] = '\0';
+    process_create_named(policy_main, 0, "ai-policy", PRIORITY_LOW);
 }
 
 void kernel_ai_push_advice(const char *msg) {
@@ -67,6 +400,9 @@ void kernel_ai_tick(void) {
     ai_status.query_pending = llm_async_pending();
     ai_status.last_latency_ms = llm_get_last_latency();
     ai_status.queries_total = llm_get_query_count();
+    ai_status.cache_hits = llm_cache_hits();
+    ai_status.cache_misses = llm_cache_misses();
+    ai_status.crashes_queued = crash_head - crash_tail;
     
     /* ── Heartbeat every 8 seconds ── */
     if (now - last_heartbeat_tick > freq * 8) {
@@ -81,15 +417,9 @@ void kernel_ai_tick(void) {
     if (now - last_telemetry_tick > freq * 5) {
         uint32_t mt = mem_total();
         uint32_t mem_pct = (mt > 0) ? (mem_used() * 100) / mt : 0;
-        uint32_t procs = (uint32_t)process_count_active();
-        uint32_t uptime = timer_get_seconds();
-        
-        /* Get context switch count from process overview */
-        process_overview_t ov;
-        process_get_overview(&ov);
-        
-        llm_send_telemetry(mem_pct, procs, uptime, ov.context_switches);
-        ai_status.telemetry_sent++;
+
+        /* Ship the sampled records as delta-encoded batches */
+        ai_status.telemetry_sent += telemetry_flush();
         last_telemetry_tick = now;
         
         /* Generate local advice based on system state */
@@ -99,7 +429,7 @@ void kernel_ai_tick(void) {
             kernel_ai_push_advice("Memory usage moderate");
         }
         
-        if (procs > 10) {
+        if (process_count_active() > 10) {
             kernel_ai_push_advice("Many processes active");
         }
     }
@@ -109,87 +439,81 @@ void kernel_ai_tick(void) {
 }
 
 int kernel_ai_analyze_crash(uint32_t fault_addr, uint32_t pid, const char *reason) {
-    char prompt[256];
-    char response[128];
-    char num[16];
-    char addr_hex[16];
-    
-    strcpy(prompt, "PROCESS_CRASH PID:");
-    itoa(pid, num, 10);
-    strcat(prompt, num);
-    strcat(prompt, " ADDR:");
-    to_hex(fault_addr, addr_hex);
-    strcat(prompt, addr_hex);
-    strcat(prompt, " REASON:");
-    strcat(prompt, reason);
-    strcat(prompt, " -> ACTION? (Respond [RESTART] or [TERMINATE])");
-    
+    /* Runs in the fault handler: decide from the table, never wait */
+    const char *proc = (current_process && current_process->pid == pid) ? current_process->name : "";
+    uint32_t now = timer_get_ticks();
+
+    uint32_t flags = spin_lock_irqsave(&policy_lock);
+    ai_rule_t *r = rule_match(reason, proc);
+    r->hits++;
+    int restart = r->restart;
+    int source = r->source;
+    ai_rule_t *known = rule_exact(reason, proc);
+    int review = !known || now - known->updated >= timer_get_frequency() * AI_RULE_TTL;
+    if (review && crash_head - crash_tail < AI_CRASH_QUEUE) {
+        crash_report_t *c = &crash_q[crash_head % AI_CRASH_QUEUE];
+        c->addr = fault_addr;
+        c->pid = pid;
+        strncpy(c->reason, reason, sizeof(c->reason) - 1);
+        c->reason[sizeof(c->reason) - 1] = '\0';
+        strncpy(c->proc, proc, sizeof(c->proc) - 1);
+        c->proc[sizeof(c->proc) - 1] = '\0';
+        crash_head++;
+    } else {
+        review = 0;
+    }
+    spin_unlock_irqrestore(&policy_lock, flags);
+    ai_status.crash_decisions++;
+
     screen_set_color(14, 0); /* Yellow */
-    screen_print("\n[AI Core] Analyzing telemetry for process crash...\n");
-    
+    screen_print(source == AI_RULE_LLM ? "\n[AI Core] Crash policy: learned rule"
+                                       : "\n[AI Core] Crash policy: local rule");
+    screen_print(review ? ", AI review queued\n" : "\n");
+
     /* Push advice about the crash */
+    char num[16];
     char advice[AI_ADVICE_LEN];
+    itoa(pid, num, 10);
     strcpy(advice, "Crash: PID ");
     strcat(advice, num);
     strcat(advice, " ");
     strncpy(advice + strlen(advice), reason, AI_ADVICE_LEN - strlen(advice) - 1);
     advice[AI_ADVICE_LEN - 1] = '\0';
     kernel_ai_push_advice(advice);
-    
-    if (llm_query(prompt, response, sizeof(response)) > 0) {
-        if (strstr(response, "RESTART")) {
-            kernel_ai_push_advice("AI: RESTART process");
-            return 1;
-        }
-    }
-    
-    kernel_ai_push_advice("AI: TERMINATE process");
-    /* Default fallback: safety first, terminate */
-    return 0;
+    kernel_ai_push_advice(restart ? "AI: RESTART process" : "AI: TERMINATE process");
+
+    if (review) wake_up(&policy_wait);
+    return restart;
 }
 
 void kernel_ai_scheduler_hints(void) {
-    if (!llm_ready() || llm_async_pending()) return;
-    
-    uint32_t now = timer_get_ticks();
-    uint32_t freq = timer_get_frequency();
-    
-    /* Only request hints every 30 seconds */
-    if (now - last_scheduler_tick < freq * 30) return;
-    last_scheduler_tick = now;
-    
-    /* Build compact process summary */
-    process_overview_t ov;
-    process_get_overview(&ov);
-    
-    if (ov.count <= 1) return; /* Only kernel process, nothing to optimize */
-    
-    char prompt[256];
-    char tmp[16];
-    strcpy(prompt, "SCHEDULER_HINT procs=");
-    itoa(ov.count, tmp, 10); strcat(prompt, tmp);
-    strcat(prompt, " ctx_sw=");
-    itoa(ov.context_switches, tmp, 10); strcat(prompt, tmp);
-    
-    /* Add top 3 processes by CPU */
-    int shown = 0;
-    for (int i = 0; i < ov.count && shown < 3; i++) {
-        if (ov.procs[i].cpu_percent > 0) {
-            strcat(prompt, " [");
-            strcat(prompt, ov.procs[i].name);
-            strcat(prompt, ":");
-            itoa(ov.procs[i].cpu_percent, tmp, 10);
-            strcat(prompt, tmp);
-            strcat(prompt, "%]");
-            shown++;
-        }
-    }
-    
-    strcat(prompt, " -> Respond with PRIORITY suggestions");
-    
-    /* Use async query so we don't block the kernel */
-    llm_query_async(prompt);
-    kernel_ai_push_advice("Requesting sched hints");
+    hints_wanted = 1;
+    wake_up(&policy_wait);
+}
+
+/* ── Policy Tables ────────────────────────────────────────── */
+int kernel_ai_rule_count(void) {
+    return n_rules;
+}
+
+int kernel_ai_get_rule(int index, ai_rule_t *out) {
+    uint32_t flags = spin_lock_irqsave(&policy_lock);
+    int ok = index >= 0 && index < n_rules;
+    if (ok) *out = rules[index];
+    spin_unlock_irqrestore(&policy_lock, flags);
+    return ok ? 0 : -1;
+}
+
+int kernel_ai_hint_count(void) {
+    return n_hints;
+}
+
+int kernel_ai_get_hint(int index, ai_hint_t *out) {
+    uint32_t flags = spin_lock_irqsave(&policy_lock);
+    int ok = index >= 0 && index < n_hints;
+    if (ok) *out = hints[index];
+    spin_unlock_irqrestore(&policy_lock, flags);
+    return ok ? 0 : -1;
 }
 
 const kernel_ai_status_t *kernel_ai_get_status(void) {
@@ -211,24 +535,38 @@ const char *kernel_ai_get_advice(int index) {
    WIN_CALC=5, WIN_SYSMON=6, WIN_STORE=7, WIN_BROWSER=8,
    WIN_NETWORK=9, WIN_AUDIT=10, WIN_DRAW=11, WIN_CLOCK=12 */
 
-static int match_app_name(const char *name) {
-    /* Case-insensitive prefix matching */
-    if (strstr(name, "term") || strstr(name, "shell") || strstr(name, "swan_shell") || strstr(name, "swanshell")) return 0;
-    if (strstr(name, "file") || strstr(name, "feather")) return 1;
-    if (strstr(name, "note") || strstr(name, "love") || strstr(name, "loveletter")) return 2;
-    if (strstr(name, "about") || strstr(name, "song") || strstr(name, "swansong")) return 3;
-    if (strstr(name, "ai") || strstr(name, "soul") || strstr(name, "chat") || strstr(name, "swansoul")) return 4;
-    if (strstr(name, "calc") || strstr(name, "count") || strstr(name, "swancount")) return 5;
-    if (strstr(name, "monitor") || strstr(name, "sysmon") || strstr(name, "heartbeat")) return 6;
-    if (strstr(name, "store") || strstr(name, "nest") || strstr(name, "swannest")) return 7;
-    if (strstr(name, "browser") || strstr(name, "lake") || strstr(name, "web") || strstr(name, "swanlake")) return 8;
-    if (strstr(name, "network") || strstr(name, "wing") || strstr(name, "winglink")) return 9;
-    if (strstr(name, "audit") || strstr(name, "watch") || strstr(name, "swanwatch")) return 10;
-    if (strstr(name, "draw") || strstr(name, "paint") || strstr(name, "swandraw")) return 11;
-    if (strstr(name, "clock") || strstr(name, "time") || strstr(name, "swanclock")) return 12;
+static const struct { const char *alias; int app_id; } app_aliases[] = {
+    { "term", 0 },    { "shell", 0 },  { "swan_shell", 0 }, { "swanshell", 0 },
+    { "file", 1 },    { "feather", 1 },
+    { "note", 2 },    { "love", 2 },   { "loveletter", 2 },
+    { "about", 3 },   { "song", 3 },   { "swansong", 3 },
+    { "ai", 4 },      { "soul", 4 },   { "chat", 4 },       { "swansoul", 4 },
+    { "calc", 5 },    { "count", 5 },  { "swancount", 5 },
+    { "monitor", 6 }, { "sysmon", 6 }, { "heartbeat", 6 },
+    { "store", 7 },   { "nest", 7 },   { "swannest", 7 },
+    { "browser", 8 }, { "lake", 8 },   { "web", 8 },        { "swanlake", 8 },
+    { "network", 9 }, { "wing", 9 },   { "winglink", 9 },
+    { "audit", 10 },  { "watch", 10 }, { "swanwatch", 10 },
+    { "draw", 11 },   { "paint", 11 }, { "swandraw", 11 },
+    { "clock", 12 },  { "time", 12 },  { "swanclock", 12 },
+};
+#define APP_ALIASES ((int)(sizeof(app_aliases) / sizeof(app_aliases[0])))
+
+/* Anywhere in name for LLM tags ("[OPEN:swan_terminal]"); only at
+   the start of a typed word, so "explain" is not the AI app */
+static int app_lookup(const char *name, int prefix) {
+    for (int i = 0; i < APP_ALIASES; i++) {
+        const char *a = app_aliases[i].alias;
+        if (prefix ? strncmp(name, a, strlen(a)) == 0 : strstr(name, a) != 0)
+            return app_aliases[i].app_id;
+    }
     return -1;
 }
 
+static int match_app_name(const char *name) {
+    return app_lookup(name, 0);
+}
+
 ai_intent_t kernel_ai_parse_intent(const char *response) {
     ai_intent_t intent;
     memset(&intent, 0, sizeof(intent));
@@ -286,6 +624,124 @@ ai_intent_t kernel_ai_parse_intent(const char *response) {
     return intent;
 }
 
+/* ── Local Intent Classifier ──────────────────────────────── */
+/* Every word of the request is scored against a small vocabulary;
+   an open verb followed by an app name, or enough weight on one
+   action with nothing unrecognised around it, resolves locally.
+   Anything else is an open-ended question for the LLM. */
+#define INTENT_WORDS     12
+#define INTENT_WORD_LEN  16
+#define INTENT_THRESHOLD 3
+#define INTENT_UNKNOWN   2      /* penalty per word outside the vocabulary */
+
+static const struct { const char *word; int action; int weight; } intent_vocab[] = {
+    { "time",     AI_ACTION_TIME, 3 }, { "hour",    AI_ACTION_TIME, 2 },
+    { "memory",   AI_ACTION_MEM,  3 }, { "mem",     AI_ACTION_MEM,  3 },
+    { "ram",      AI_ACTION_MEM,  3 },
+    { "help",     AI_ACTION_HELP, 3 }, { "commands", AI_ACTION_HELP, 2 },
+};
+#define INTENT_VOCAB ((int)(sizeof(intent_vocab) / sizeof(intent_vocab[0])))
+
+static const char *open_verbs[] = { "open", "launch", "start", "run", "show" };
+
+/* Carry no intent of their own but don't make a request open-ended */
+static const char *filler_words[] = {
+    "what", "whats", "is", "it", "the", "a", "an", "my", "me", "please",
+    "show", "tell", "current", "now", "how", "much", "used", "usage",
+    "free", "left", "can", "you", "i", "do", "get", "check", "of", "up",
+    "app", "window", "manager", "for", "need", "want", "to", "some",
+};
+
+static int word_in(const char *w, const char **list, int n) {
+    for (int i = 0; i < n; i++)
+        if (strcmp(w, list[i]) == 0) return 1;
+    return 0;
+}
+
+#define IS_OPEN_VERB(w) word_in((w), open_verbs, sizeof(open_verbs) / sizeof(open_verbs[0]))
+#define IS_FILLER(w)    word_in((w), filler_words, sizeof(filler_words) / sizeof(filler_words[0]))
+
+/* Lower-cased words, punctuation dropped ("What's" -> "whats") */
+static int split_words(const char *text, char words[][INTENT_WORD_LEN]) {
+    int n = 0, len = 0;
+    for (const char *p = text; ; p++) {
+        char c = *p;
+        if (c >= 'A' && c <= 'Z') c = (char)(c - 'A' + 'a');
+        int word = (c >= 'a' && c <= 'z') || (c >= '0' && c <= '9') || c == '_';
+        if (word) {
+            if (len < INTENT_WORD_LEN - 1 && n < INTENT_WORDS) words[n][len++] = c;
+        } else if (c == '\'') {
+            continue;
+        } else if (len) {
+            words[n++][len] = '\0';
+            len = 0;
+        }
+        if (!c) break;
+    }
+    return n;
+}
+
+ai_intent_t kernel_ai_classify_local(const char *text) {
+    ai_intent_t intent;
+    memset(&intent, 0, sizeof(intent));
+    intent.action = AI_ACTION_NONE;
+    intent.app_id = -1;
+
+    char words[INTENT_WORDS][INTENT_WORD_LEN];
+    int n = split_words(text, words);
+    if (!n || n >= INTENT_WORDS) return intent;     /* long means open-ended */
+
+    /* "open the file manager": verb, then the first app word */
+    for (int i = 0; i < n; i++) {
+        if (!IS_OPEN_VERB(words[i])) continue;
+        for (int k = i + 1; k < n; k++) {
+            int app = app_lookup(words[k], 1);
+            if (app >= 0) {
+                intent.action = AI_ACTION_OPEN;
+                intent.app_id = app;
+                return intent;
+            }
+            if (!IS_FILLER(words[k])) break;
+        }
+    }
+
+    int score[AI_ACTION_ANSWER + 1] = { 0 };
+    int penalty = 0, app = -1;
+    for (int i = 0; i < n; i++) {
+        int known = 0;
+        for (int v = 0; v < INTENT_VOCAB; v++) {
+            if (strcmp(words[i], intent_vocab[v].word) == 0) {
+                score[intent_vocab[v].action] += intent_vocab[v].weight;
+                known = 1;
+            }
+        }
+        if (known || IS_FILLER(words[i]) || IS_OPEN_VERB(words[i])) continue;
+        int a = app_lookup(words[i], 1);
+        if (a >= 0 && app < 0) {
+            app = a;            /* a bare app name: "calculator" */
+            score[AI_ACTION_OPEN] += INTENT_THRESHOLD;
+        } else {
+            penalty += INTENT_UNKNOWN;
+        }
+    }
+
+    /* Vocabulary words are never app names, so "time" is TIME, not
+       the clock; a tie between actions stays ambiguous */
+    int best = AI_ACTION_NONE, tie = 0;
+    for (int a = AI_ACTION_OPEN; a <= AI_ACTION_HELP; a++) {
+        if (score[a] - penalty < INTENT_THRESHOLD) continue;
+        if (best == AI_ACTION_NONE || score[a] > score[best]) { best = a; tie = 0; }
+        else if (score[a] == score[best]) tie = 1;
+    }
+    if (tie) return intent;
+
+    intent.action = best;
+    if (best == AI_ACTION_OPEN) intent.app_id = app;
+    if (best == AI_ACTION_HELP)
+        strcpy(intent.answer, "Try: open <app>, time, memory - or ask anything");
+    return intent;
+}
+
 /* ── Health Summary Generator ─────────────────────────────── */
 void kernel_ai_get_health_summary(char *buf, int len) {
     uint32_t mt = mem_total();
@@ -297,6 +753,9 @@ void kernel_ai_get_health_summary(char *buf, int len) {
     
     char tmp[12];
     
+    /* A fresh prefetched LLM line, unless something needs attention */
+    if (mem_pct <= 70 && ai_summary_fresh(buf, len)) return;
+
     if (mem_pct > 90) {
         strcpy(buf, "CRITICAL: Memory at ");
         itoa(mem_pct, tmp, 10); strcat(buf, tmp);
@@ -17,13 +17,46 @@ void kernel_ai_init(void);
 void kernel_ai_tick(void);
 
 /* ── Crash Analysis ──────────────────────────────────────── */
-/* Returns 1 if process should be restarted, 0 if termination needed */
+/* Returns 1 if process should be restarted, 0 if termination needed.
+   Safe in fault handlers: the answer comes from the local rule table
+   at once. The crash is queued for the ai-policy worker, which asks
+   the LLM in the background and learns a rule for the next crash of
+   that process and reason. */
 int kernel_ai_analyze_crash(uint32_t fault_addr, uint32_t pid, const char *reason);
 
 /* ── Scheduler Hints ─────────────────────────────────────── */
-/* Request AI to analyze current process load and suggest priorities */
+/* Ask the worker for fresh priority hints now (it prefetches them
+   every 30 s anyway). Replies of the form name=HIGH|NORMAL|LOW fill
+   the hint table, which the worker applies to matching processes. */
 void kernel_ai_scheduler_hints(void);
 
+/* ── Policy Tables ───────────────────────────────────────── */
+#define AI_MAX_RULES  12
+#define AI_MAX_HINTS  8
+#define AI_RULE_LOCAL 0           /* built-in default */
+#define AI_RULE_LLM   1           /* learned from an LLM reply */
+
+typedef struct {
+    char     reason[24];          /* "" matches any reason */
+    char     proc[16];            /* "" matches any process */
+    uint8_t  restart;             /* 1 = restart, 0 = terminate */
+    uint8_t  source;              /* AI_RULE_* */
+    uint32_t hits;                /* crashes decided by this rule */
+    uint32_t updated;             /* tick of the last LLM update */
+} ai_rule_t;
+
+typedef struct {
+    char     proc[16];
+    uint8_t  priority;            /* PRIORITY_LOW..PRIORITY_HIGH */
+    uint32_t updated;             /* tick the hint arrived */
+} ai_hint_t;
+
+/* Snapshots; 0 on success, -1 if index is out of range */
+int kernel_ai_rule_count(void);
+int kernel_ai_get_rule(int index, ai_rule_t *out);
+int kernel_ai_hint_count(void);
+int kernel_ai_get_hint(int index, ai_hint_t *out);
+
 /* ── Status & Advice ─────────────────────────────────────── */
 #define AI_MAX_ADVICE 4
 #define AI_ADVICE_LEN 48
@@ -34,7 +67,13 @@ typedef struct {
     uint32_t last_latency_ms;     /* Last response RTT */
     uint32_t queries_total;       /* Total queries this session */
     uint32_t telemetry_sent;      /* Total telemetry packets sent */
+    uint32_t cache_hits;          /* Queries answered from the LLM cache */
+    uint32_t cache_misses;        /* Queries that went to the bridge */
     uint32_t uptime_ticks;        /* AI subsystem uptime */
+    uint32_t crash_decisions;     /* Crashes answered from the rule table */
+    uint32_t crashes_queued;      /* Awaiting LLM review */
+    uint32_t rules_learned;       /* Rule updates from LLM replies */
+    uint32_t hints_applied;       /* Priority changes made from hints */
     char     advice[AI_MAX_ADVICE][AI_ADVICE_LEN]; /* Rolling advice buffer */
     int      advice_count;        /* Number of advice entries */
     int      advice_head;         /* Circular buffer head */
@@ -68,9 +107,17 @@ typedef struct {
    Returns parsed intent. Scans for [OPEN:name], [TIME], [MEM], [HELP] */
 ai_intent_t kernel_ai_parse_intent(const char *response);
 
+/* Resolve a request without the LLM when it is a common action:
+   "open terminal", "launch the calculator", "what time is it",
+   "memory usage", "help". Returns AI_ACTION_NONE for anything
+   open-ended, which should go to the LLM (then kernel_ai_parse_intent). */
+ai_intent_t kernel_ai_classify_local(const char *text);
+
 /* ── Health Summary ─────────────────────────────────────────── */
 /* Generate a natural-language one-line health summary from current telemetry.
-   Writes into buf (max len chars). No LLM needed — locally generated. */
+   Writes into buf (max len chars). Never waits on the LLM: the worker
+   prefetches an AI line every 25 s, used while fresh unless memory is
+   running short; otherwise the line is generated locally. */
 void kernel_ai_get_health_summary(char *buf, int len);
 
 /* ── Narrator Descriptions ──────────────────────────────────── */
@@ -1,7 +1,8 @@
 /* ============================================================
  * SwanOS — PS/2 Keyboard Driver
- * IRQ1 handler, scancode→ASCII translation, line buffer.
- * Also accepts input from serial port (for GUI frontend).
+ * IRQ1 top half queues raw scancodes; the bottom half does the
+ * scancode→ASCII translation into input events (input.h), and
+ * so does the serial one for keystrokes from the GUI frontend.
  * Arrow keys emit special codes: 0x80=UP 0x81=DOWN 0x82=LEFT 0x83=RIGHT
  * ============================================================ */
 
@@ -9,13 +10,22 @@
 #include "idt.h"
 #include "ports.h"
 #include "screen.h"
+#include "bridge.h"
 #include "serial.h"
-
-#define KB_BUFFER_SIZE 256
-
-static volatile char kb_buffer[KB_BUFFER_SIZE];
-static volatile int  kb_head = 0;
-static volatile int  kb_tail = 0;
+#include "cpu.h"
+#include "spinlock.h"
+#include "softirq.h"
+#include "input.h"
+#include "timer.h"
+#include "string.h"
+
+#define KB_RAW_SIZE 64          /* scancodes, power of two */
+
+/* Top half → bottom half: IRQ1 is the only writer, the bottom half
+ * the only reader, so the indices need no lock */
+static uint8_t  kb_raw[KB_RAW_SIZE];
+static uint32_t kb_raw_us[KB_RAW_SIZE];
+static volatile uint32_t kb_raw_head = 0, kb_raw_tail = 0;
 static int shift_pressed = 0;
 static int ctrl_pressed = 0;
 
@@ -37,18 +47,33 @@ static const char scancode_to_ascii_shift[128] = {
     '*', 0, ' ',
 };
 
-static void kb_push(char c) {
-    int next = (kb_head + 1) % KB_BUFFER_SIZE;
-    if (next != kb_tail) {
-        kb_buffer[kb_head] = c;
-        kb_head = next;
-    }
+static void push_key(char c, uint32_t us) {
+    input_event_t ev;
+    memset(&ev, 0, sizeof(ev));
+    ev.time_us = us;
+    ev.type = INPUT_KEY;
+    ev.key = (uint8_t)c;
+    input_push(&ev);
 }
 
+/* ── IRQ1 top half ────────────────────────────────────────── */
+
 static void keyboard_callback(registers_t *regs) {
     (void)regs;
     uint8_t scancode = inb(0x60);
+    uint32_t h = kb_raw_head;
+    if (h - kb_raw_tail < KB_RAW_SIZE) {
+        kb_raw[h & (KB_RAW_SIZE - 1)] = scancode;
+        kb_raw_us[h & (KB_RAW_SIZE - 1)] = timer_get_us();
+        seq_barrier();          /* slot before head */
+        kb_raw_head = h + 1;
+    }
+    softirq_raise(SOFTIRQ_KEYBOARD);
+}
+
+/* ── Bottom halves ────────────────────────────────────────── */
 
+static void decode_scancode(uint8_t scancode, uint32_t us) {
     /* Track shift key */
     if (scancode == 0x2A || scancode == 0x36) { shift_pressed = 1; return; }
     if (scancode == 0xAA || scancode == 0xB6) { shift_pressed = 0; return; }
@@ -61,33 +86,51 @@ static void keyboard_callback(registers_t *regs) {
     if (scancode & 0x80) return;
 
     /* Arrow keys → special codes */
-    if (scancode == 0x48) { kb_push((char)0x80); return; } /* Up    */
-    if (scancode == 0x50) { kb_push((char)0x81); return; } /* Down  */
-    if (scancode == 0x4B) { kb_push((char)0x82); return; } /* Left  */
-    if (scancode == 0x4D) { kb_push((char)0x83); return; } /* Right */
+    if (scancode == 0x48) { push_key((char)KEY_UP, us); return; }
+    if (scancode == 0x50) { push_key((char)KEY_DOWN, us); return; }
+    if (scancode == 0x4B) { push_key((char)KEY_LEFT, us); return; }
+    if (scancode == 0x4D) { push_key((char)KEY_RIGHT, us); return; }
 
     /* Function keys → special codes */
-    if (scancode == 0x3B) { kb_push((char)KEY_F1); return; } /* F1 */
-    if (scancode == 0x3C) { kb_push((char)KEY_F2); return; } /* F2 */
-    if (scancode == 0x3D) { kb_push((char)KEY_F3); return; } /* F3 */
+    if (scancode == 0x3B) { push_key((char)KEY_F1, us); return; } /* F1 */
+    if (scancode == 0x3C) { push_key((char)KEY_F2, us); return; } /* F2 */
+    if (scancode == 0x3D) { push_key((char)KEY_F3, us); return; } /* F3 */
 
     /* Ctrl+Space combo */
-    if (ctrl_pressed && scancode == 0x39) { kb_push((char)KEY_CTRL_SPACE); return; }
+    if (ctrl_pressed && scancode == 0x39) { push_key((char)KEY_CTRL_SPACE, us); return; }
 
-    char c;
-    if (scancode < 128) {
-        c = shift_pressed ? scancode_to_ascii_shift[scancode] : scancode_to_ascii[scancode];
-    } else {
-        return;
+    char c = shift_pressed ? scancode_to_ascii_shift[scancode] : scancode_to_ascii[scancode];
+    if (c == 0) return;
+    push_key(c, us);
+}
+
+static void keyboard_bh(void) {
+    while (kb_raw_tail != kb_raw_head) {
+        seq_barrier();
+        uint32_t t = kb_raw_tail;
+        uint8_t sc = kb_raw[t & (KB_RAW_SIZE - 1)];
+        uint32_t us = kb_raw_us[t & (KB_RAW_SIZE - 1)];
+        kb_raw_tail = t + 1;
+        decode_scancode(sc, us);
     }
+}
 
-    if (c == 0) return;
-    kb_push(c);
+/* GUI keystrokes: serial bytes outside bridge frames. Parsing the
+ * RX ring here also routes bridge frames without a reader asking. */
+static void serial_bh(void) {
+    char c;
+    bridge_poll();
+    while (bridge_key_read(&c)) {
+        if (c == '\x04') continue;      /* EOT — ignore in keyboard context */
+        if (c == '\r') c = '\n';        /* normalize CR to LF */
+        push_key(c, timer_get_us());
+    }
 }
 
 void keyboard_init(void) {
-    kb_head = 0;
-    kb_tail = 0;
+    kb_raw_head = kb_raw_tail = 0;
+    softirq_register(SOFTIRQ_KEYBOARD, keyboard_bh);
+    softirq_register(SOFTIRQ_SERIAL, serial_bh);
 
     /* Flush the PS/2 output buffer */
     while (inb(0x64) & 1) {
@@ -118,53 +161,29 @@ void keyboard_init(void) {
 }
 
 void keyboard_flush(void) {
-    /* Clear the software key buffer */
-    kb_head = 0;
-    kb_tail = 0;
-
     /* Drain any pending bytes from the PS/2 controller */
     while (inb(0x64) & 1) {
         inb(0x60);
     }
 
-    /* Drain any pending serial port data */
-    while (serial_data_ready()) {
-        serial_read_char();
-    }
+    /* Drop queued GUI keystrokes (bridge frames are still routed) */
+    bridge_key_flush();
+
+    /* Decoded keys and whatever the bottom halves still held */
+    input_flush();
 }
 
 int keyboard_has_key(void) {
-    return (kb_head != kb_tail) || serial_data_ready();
+    return input_has(INPUT_KEY);
 }
 
 char keyboard_getchar(void) {
-    /* Check both PS/2 buffer AND serial port for input */
-    while (1) {
-        /* Check PS/2 keyboard buffer */
-        if (kb_head != kb_tail) {
-            char c = kb_buffer[kb_tail];
-            kb_tail = (kb_tail + 1) % KB_BUFFER_SIZE;
-            return c;
-        }
-
-        /* Check serial port for GUI input */
-        if (serial_data_ready()) {
-            char c = serial_read_char();
-            /* Ignore control chars used by protocol, except common ones */
-            if (c == '\x01') {
-                /* Protocol marker — skip (shouldn't come from GUI input) */
-                continue;
-            }
-            if (c == '\x04') {
-                /* EOT — ignore in keyboard context */
-                continue;
-            }
-            if (c == '\r') c = '\n'; /* normalize CR to LF */
-            return c;
-        }
-
-        __asm__ volatile ("hlt"); /* halt until next interrupt */
-    }
+    /* Keys from PS/2 and the GUI arrive in one queue; pointer events
+     * are of no use to a text reader */
+    input_event_t ev;
+    do input_wait(&ev, 0);
+    while (ev.type != INPUT_KEY);
+    return (char)ev.key;
 }
 
 int keyboard_read_line(char *buf, int max_len) {
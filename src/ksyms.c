@@ -0,0 +1,37 @@
+/* ============================================================
+ * SwanOS — Kernel Symbols
+ * Address-to-function lookup over the text symbol table that the
+ * build embeds in the kernel image (see Makefile, ksyms_gen.c).
+ * ============================================================ */
+
+#include "ksyms.h"
+
+/* Weak so the first link pass, which has no table yet, resolves
+ * them to 0 */
+extern const ksym_t   ksym_table[] __attribute__((weak));
+extern const uint32_t ksym_table_len __attribute__((weak));
+
+int ksym_count(void) {
+    return &ksym_table_len ? (int)ksym_table_len : 0;
+}
+
+const ksym_t *ksym_get(int index) {
+    return (index >= 0 && index < ksym_count()) ? &ksym_table[index] : 0;
+}
+
+int ksym_lookup(uint32_t addr, uint32_t *offset) {
+    int n = ksym_count();
+    if (!n || addr < ksym_table[0].addr) return -1;
+
+    /* Last symbol at or below addr; the table is sorted by address
+     * and ends with a sentinel at the end of .text */
+    int lo = 0, hi = n - 1;
+    while (lo < hi) {
+        int mid = (lo + hi + 1) / 2;
+        if (ksym_table[mid].addr <= addr) lo = mid;
+        else hi = mid - 1;
+    }
+    if (lo == n - 1) return -1;
+    if (offset) *offset = addr - ksym_table[lo].addr;
+    return lo;
+}
@@ -0,0 +1,23 @@
+#ifndef KSYMS_H
+#define KSYMS_H
+
+#include <stdint.h>
+
+/* ── Kernel symbol table ──────────────────────────────────────
+ * `make` links the kernel once, lists its text symbols with nm and
+ * links again with the table (ksyms_gen.c) appended to .rodata, so
+ * no code moves. A kernel linked without it has ksym_count() == 0
+ * and every lookup fails.                                        */
+typedef struct {
+    uint32_t    addr;
+    const char *name;
+} ksym_t;
+
+int ksym_count(void);
+const ksym_t *ksym_get(int index);
+
+/* Index of the function containing addr, or -1 outside kernel text.
+ * Sets *offset to addr's distance from the symbol, if given. */
+int ksym_lookup(uint32_t addr, uint32_t *offset);
+
+#endif
@@ -3,17 +3,18 @@
  * Async queries, streaming responses, telemetry,
  * heartbeat, and latency tracking for realtime AI OS.
  *
- * Protocol:
- *   OS → Bridge:  \x01K + api_key + \x04        (set API key)
- *   OS → Bridge:  \x01Q + query text + \x04      (LLM query)
- *   OS → Bridge:  \x01T + telemetry + \x04       (telemetry data)
- *   OS → Bridge:  \x01H\x04                      (heartbeat ping)
- *   Bridge → OS:  response text + \x04            (LLM response)
- *   Bridge → OS:  \x01P + status + \x04           (heartbeat pong)
+ * Protocol: framed messages (see bridge.h), one channel each:
+ *   CTRL   K api_key | S system prompt | H heartbeat → P pong
+ *   LLM    Q query text → R response (may arrive in fragments)
+ *   STORE  V name|content | L name → R content
+ *   AUDIT  A event
+ *   TELEM  T telemetry
+ * Each query/load gets its own request id, so any number up to
+ * BRIDGE_MAX_REQ can be outstanding and complete out of order.
  * ============================================================ */
 
 #include "llm.h"
-#include "serial.h"
+#include "bridge.h"
 #include "screen.h"
 #include "string.h"
 #include "fs.h"
@@ -25,12 +26,59 @@
 static char api_key[MAX_KEY_LEN];
 static int  key_loaded = 0;
 
-/* ── Async Query State ────────────────────────────────────── */
-static int      async_pending = 0;         /* Query in flight? */
-static uint32_t async_query_tick = 0;      /* Tick when query was sent */
-static char     async_stream_buf[1024];    /* Accumulating response */
-static int      async_stream_len = 0;      /* Bytes accumulated so far */
-static int      async_stream_complete = 0; /* Got EOT (\x04) */
+#define QUERY_TIMEOUT_S 30
+#define LOAD_TIMEOUT_S  5
+
+/* ── Response Cache ───────────────────────────────────────── */
+/* LRU keyed by FNV-1a of (system prompt, query). Answers carrying an
+ * action tag ([TIME], [OPEN:..]) are resolved locally by the caller,
+ * so they stay valid far longer than free-text answers. */
+#define CACHE_ENTRIES    16
+#define CACHE_QUERY_LEN  128
+#define CACHE_RESP_LEN   512
+#define CACHE_TTL_S      300
+#define CACHE_TAG_TTL_S  3600
+
+typedef struct {
+    uint32_t key;              /* 0 = empty */
+    uint32_t stored_tick;
+    uint32_t used_stamp;       /* LRU clock */
+    uint32_t ttl_ticks;
+    char     query[CACHE_QUERY_LEN];
+    char     response[CACHE_RESP_LEN];
+} cache_entry_t;
+
+static cache_entry_t cache[CACHE_ENTRIES];
+static uint32_t cache_clock = 0;
+static uint32_t cache_hits = 0, cache_misses = 0;
+static uint32_t sys_prompt_hash = 0;
+
+/* ── Query Streams ────────────────────────────────────────── */
+/* A handle names a query slot, backed either by a bridge request or
+ * by a replay of a cached answer. Bytes handed out by the stream are
+ * also kept in text[] so a clean reply can be cached and the whole-
+ * reply API (llm_query_poll) can return it. */
+#define MAX_QUERIES     BRIDGE_MAX_REQ
+#define QUERY_TEXT_LEN  1024
+
+typedef struct {
+    int      used;
+    int      req;                 /* bridge request id; 0 = cache replay */
+    uint32_t key;                 /* cache key */
+    uint32_t last_tick;           /* sent / last byte received */
+    int      cursor;              /* replay position (cache) */
+    int      len;                 /* bytes kept in text[] */
+    int      overflow;            /* reply longer than text[] */
+    char     query[CACHE_QUERY_LEN];
+    char     text[QUERY_TEXT_LEN];
+} llm_stream_t;
+
+static llm_stream_t queries[MAX_QUERIES];
+
+/* The legacy single-slot async API rides on one handle */
+static int      async_handle = -1;
+static char     async_stream_buf[QUERY_TEXT_LEN];   /* Final response */
+static int      async_stream_len = 0;
 
 /* ── Latency & Stats ─────────────────────────────────────── */
 static uint32_t last_latency_ms = 0;       /* Last query RTT in ms */
@@ -38,15 +86,17 @@ static uint32_t query_count = 0;           /* Total queries this session */
 
 /* ── Heartbeat ────────────────────────────────────────────── */
 static uint32_t last_heartbeat_sent = 0;
-static uint32_t last_heartbeat_recv = 0;
 static int      bridge_alive = 0;
 
 void llm_init(void) {
     api_key[0] = '\0';
     key_loaded = 0;
-    async_pending = 0;
+    async_handle = -1;
     async_stream_len = 0;
-    async_stream_complete = 0;
+    memset(queries, 0, sizeof(queries));
+    memset(cache, 0, sizeof(cache));
+    cache_hits = cache_misses = 0;
+    sys_prompt_hash = 0;
     last_latency_ms = 0;
     query_count = 0;
     bridge_alive = 0;
@@ -86,21 +136,223 @@ int llm_ready(void) {
     return key_loaded && api_key[0] != '\0';
 }
 
+#define FNV_BASIS 2166136261u
+
+static uint32_t fnv1a(uint32_t h, const char *s) {
+    while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+static void send_str(int chan, char op, const char *s) {
+    bridge_send(chan, op, 0, s, strlen(s));
+}
+
 void llm_send_key(void) {
     if (!key_loaded) return;
-    serial_write_char('\x01');
-    serial_write_char('K');
-    const char *p = api_key;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
+    send_str(BRIDGE_CH_CTRL, 'K', api_key);
 }
 
 void llm_set_system_prompt(const char *prompt) {
-    serial_write_char('\x01');
-    serial_write_char('S');
-    const char *p = prompt;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
+    sys_prompt_hash = fnv1a(FNV_BASIS, prompt);
+    send_str(BRIDGE_CH_CTRL, 'S', prompt);
+}
+
+/* ── Response Cache ───────────────────────────────────────── */
+static uint32_t cache_key(const char *query) {
+    uint32_t h = fnv1a(FNV_BASIS ^ sys_prompt_hash, query);
+    return h ? h : 1;
+}
+
+static cache_entry_t *cache_find(uint32_t key, const char *query) {
+    uint32_t now = timer_get_ticks();
+    for (int i = 0; i < CACHE_ENTRIES; i++) {
+        cache_entry_t *e = &cache[i];
+        if (e->key != key || strncmp(e->query, query, CACHE_QUERY_LEN - 1) != 0) continue;
+        if (now - e->stored_tick > e->ttl_ticks) { e->key = 0; return 0; }
+        e->used_stamp = ++cache_clock;
+        return e;
+    }
+    return 0;
+}
+
+static int cache_lookup(const char *query, char *response, int max_len) {
+    cache_entry_t *e = cache_find(cache_key(query), query);
+    if (!e) { cache_misses++; return -1; }
+    cache_hits++;
+    strncpy(response, e->response, max_len - 1);
+    response[max_len - 1] = '\0';
+    return strlen(response);
+}
+
+static void cache_store(uint32_t key, const char *query, const char *response) {
+    cache_entry_t *e = cache_find(key, query);
+    if (!e) {
+        /* Empty slot, else least recently used */
+        e = &cache[0];
+        for (int i = 0; i < CACHE_ENTRIES && e->key; i++)
+            if (!cache[i].key || cache[i].used_stamp < e->used_stamp) e = &cache[i];
+    }
+    e->key = key;
+    e->stored_tick = timer_get_ticks();
+    e->used_stamp = ++cache_clock;
+    e->ttl_ticks = timer_get_frequency() *
+                   (strchr(response, '[') && strchr(response, ']') ? CACHE_TAG_TTL_S : CACHE_TTL_S);
+    strncpy(e->query, query, CACHE_QUERY_LEN - 1);
+    e->query[CACHE_QUERY_LEN - 1] = '\0';
+    strncpy(e->response, response, CACHE_RESP_LEN - 1);
+    e->response[CACHE_RESP_LEN - 1] = '\0';
+}
+
+void llm_cache_clear(void) {
+    memset(cache, 0, sizeof(cache));
+}
+
+uint32_t llm_cache_hits(void)   { return cache_hits; }
+uint32_t llm_cache_misses(void) { return cache_misses; }
+
+/* Wait for a request, asleep until bridge bytes arrive. Other
+ * channels keep being routed by bridge_poll() in the meantime. */
+static int wait_request(int id, int timeout_s) {
+    uint32_t limit = timer_get_frequency() * timeout_s;
+    uint32_t waited = timer_get_ticks() - bridge_request_tick(id);
+    if (waited > limit) return bridge_request_done(id);
+    return bridge_request_wait(id, limit - waited + 1);
+}
+
+static void note_latency(int id) {
+    uint32_t now = timer_get_ticks();
+    last_latency_ms = ((now - bridge_request_tick(id)) * 1000) / timer_get_frequency();
+    bridge_alive = 1;
+}
+
+/* ── Query Streams ────────────────────────────────────────── */
+static llm_stream_t *query_get(int handle) {
+    if (handle < 1 || handle > MAX_QUERIES) return 0;
+    llm_stream_t *q = &queries[handle - 1];
+    return q->used ? q : 0;
+}
+
+static void query_keep(llm_stream_t *q, const char *p, int n) {
+    int room = QUERY_TEXT_LEN - 1 - q->len;
+    if (n > room) { q->overflow = 1; n = room; }
+    memcpy(q->text + q->len, p, n);
+    q->len += n;
+    q->text[q->len] = '\0';
+    q->last_tick = timer_get_ticks();
+}
+
+static void query_free(llm_stream_t *q) {
+    if (q->req > 0) bridge_release(q->req);
+    q->used = 0;
+}
+
+/* Reply complete: cache it if it arrived whole and clean */
+static void query_finish(llm_stream_t *q) {
+    if (q->req > 0) {
+        note_latency(q->req);
+        if (q->len > 0 && !q->overflow && !bridge_request_error(q->req))
+            cache_store(q->key, q->query, q->text);
+    }
+    query_free(q);
+}
+
+static int query_timed_out(llm_stream_t *q) {
+    return timer_get_ticks() - q->last_tick > timer_get_frequency() * QUERY_TIMEOUT_S;
+}
+
+int llm_query_begin(const char *question) {
+    if (!llm_ready()) return -1;
+    llm_stream_t *q = 0;
+    for (int i = 0; i < MAX_QUERIES; i++)
+        if (!queries[i].used) { q = &queries[i]; break; }
+    if (!q) return -1;
+
+    q->key = cache_key(question);
+    q->cursor = q->len = q->overflow = 0;
+    q->last_tick = timer_get_ticks();
+    strncpy(q->query, question, CACHE_QUERY_LEN - 1);
+    q->query[CACHE_QUERY_LEN - 1] = '\0';
+
+    int n = cache_lookup(question, q->text, QUERY_TEXT_LEN);
+    if (n >= 0) {
+        q->req = 0;
+        q->len = n;
+        last_latency_ms = 0;
+    } else {
+        q->text[0] = '\0';
+        q->req = bridge_request(BRIDGE_CH_LLM, 'Q', question, strlen(question));
+        if (q->req < 0) return -1;
+        query_count++;
+    }
+    q->used = 1;
+    return (int)(q - queries) + 1;
+}
+
+int llm_query_stream(int handle, char *buf, int max_len) {
+    llm_stream_t *q = query_get(handle);
+    if (!q || max_len <= 1) return -1;
+
+    if (!q->req) {
+        /* Cached answer: replay it through the same cursor */
+        int n = q->len - q->cursor;
+        if (n > max_len - 1) n = max_len - 1;
+        if (n <= 0) { query_free(q); return -1; }
+        memcpy(buf, q->text + q->cursor, n);
+        buf[n] = '\0';
+        q->cursor += n;
+        return n;
+    }
+
+    bridge_poll();
+    int n = bridge_request_consume(q->req, buf, max_len);
+    if (n > 0) { query_keep(q, buf, n); return n; }
+    if (bridge_request_drained(q->req) == 1) { query_finish(q); return -1; }
+    if (query_timed_out(q)) { bridge_alive = 0; query_free(q); return -1; }
+    return 0;
+}
+
+int llm_query_poll(int handle, char *response, int max_len) {
+    llm_stream_t *q = query_get(handle);
+    if (!q) return -1;
+
+    int done = 1;
+    if (q->req) {
+        char chunk[256];
+        bridge_poll();
+        while (bridge_request_consume(q->req, chunk, sizeof(chunk)) > 0)
+            query_keep(q, chunk, strlen(chunk));
+        done = bridge_request_drained(q->req) == 1;
+    }
+
+    if (!done) {
+        if (!query_timed_out(q)) return 0;
+        /* Timed out: hand back whatever streamed in, or an error */
+        int n = q->len;
+        if (n > 0) strncpy(response, q->text, max_len - 1);
+        else strncpy(response, "AI bridge timeout.", max_len - 1);
+        response[max_len - 1] = '\0';
+        bridge_alive = 0;
+        query_free(q);
+        return n > 0 ? (int)strlen(response) : -1;
+    }
+
+    strncpy(response, q->text, max_len - 1);
+    response[max_len - 1] = '\0';
+    query_finish(q);
+    return strlen(response);
+}
+
+void llm_query_wait(int handle) {
+    llm_stream_t *q = query_get(handle);
+    if (!q || !q->req) return;
+    uint32_t limit = timer_get_frequency() * QUERY_TIMEOUT_S;
+    uint32_t idle = timer_get_ticks() - q->last_tick;
+    if (idle < limit) bridge_request_wait(q->req, limit - idle + 1);
+}
+
+void llm_query_cancel(int handle) {
+    llm_stream_t *q = query_get(handle);
+    if (q) query_free(q);
 }
 
 /* ── Synchronous Query (blocking) ─────────────────────────── */
@@ -110,24 +362,17 @@ int llm_query(const char *question, char *response, int max_len) {
         return -1;
     }
 
-    uint32_t start_tick = timer_get_ticks();
-    query_count++;
-
-    serial_write_char('\x01');
-    serial_write_char('Q');
-    const char *p = question;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
-
-    int len = serial_read_line(response, max_len, 30);
+    int h = llm_query_begin(question);
+    if (h < 0) {
+        strcpy(response, "AI bridge busy. Try again shortly.");
+        return -1;
+    }
 
-    /* Compute latency */
-    uint32_t end_tick = timer_get_ticks();
-    last_latency_ms = ((end_tick - start_tick) * 1000) / timer_get_frequency();
-    bridge_alive = 1;
-    last_heartbeat_recv = end_tick;
+    int len;
+    while ((len = llm_query_poll(h, response, max_len)) == 0)
+        llm_query_wait(h);
 
-    if (len == 0) {
+    if (len <= 0) {
         strcpy(response, "No response from AI bridge. Is llm_bridge.py running?");
         bridge_alive = 0;
         return -1;
@@ -138,73 +383,40 @@ int llm_query(const char *question, char *response, int max_len) {
 
 /* ── Async Query (non-blocking) ───────────────────────────── */
 void llm_query_async(const char *question) {
-    if (!llm_ready() || async_pending) return;
+    if (!llm_ready() || async_handle > 0) return;
 
     async_stream_len = 0;
-    async_stream_complete = 0;
     async_stream_buf[0] = '\0';
-    async_query_tick = timer_get_ticks();
-    query_count++;
-
-    serial_write_char('\x01');
-    serial_write_char('Q');
-    const char *p = question;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
-
-    async_pending = 1;
+    async_handle = llm_query_begin(question);
 }
 
 int llm_poll_response(char *response, int max_len) {
-    if (!async_pending) return -1;
-
-    /* Non-blocking: check if serial has data */
-    while (serial_data_ready() && async_stream_len < 1023) {
-        char c = serial_read_char();
-        if (c == '\x04') {
-            /* End of transmission */
-            async_stream_complete = 1;
-            async_pending = 0;
-
-            /* Compute latency */
-            uint32_t end_tick = timer_get_ticks();
-            last_latency_ms = ((end_tick - async_query_tick) * 1000) / timer_get_frequency();
-            bridge_alive = 1;
-            last_heartbeat_recv = end_tick;
-            break;
-        }
-        /* Skip protocol headers */
-        if (c == '\x01') continue;
-        if (async_stream_len == 0 && (c == 'R' || c == 'S')) continue; /* Skip response type prefix */
-        
-        async_stream_buf[async_stream_len++] = c;
-        async_stream_buf[async_stream_len] = '\0';
+    if (async_handle <= 0) return -1;
+
+    int r = llm_query_poll(async_handle, async_stream_buf, sizeof(async_stream_buf));
+    if (r == 0) {
+        /* Still streaming: expose what has arrived so far */
+        llm_stream_t *q = query_get(async_handle);
+        async_stream_len = q ? q->len : 0;
+        return 0;
     }
 
-    /* Check timeout (30 seconds) */
-    if (async_pending && (timer_get_ticks() - async_query_tick) > timer_get_frequency() * 30) {
-        async_pending = 0;
-        async_stream_complete = 1;
-        bridge_alive = 0;
-        if (async_stream_len == 0) {
-            strcpy(async_stream_buf, "AI bridge timeout.");
-            async_stream_len = strlen(async_stream_buf);
-        }
-    }
+    /* Reply or timeout text is now in async_stream_buf */
+    async_handle = -1;
+    async_stream_len = strlen(async_stream_buf);
 
-    if (async_stream_complete && response) {
+    if (response) {
         int copy = async_stream_len;
         if (copy >= max_len) copy = max_len - 1;
         memcpy(response, async_stream_buf, copy);
         response[copy] = '\0';
         return copy;
     }
-
-    return async_stream_complete ? async_stream_len : 0;
+    return async_stream_len;
 }
 
 int llm_async_pending(void) {
-    return async_pending;
+    return async_handle > 0;
 }
 
 int llm_stream_available(void) {
@@ -212,10 +424,13 @@ int llm_stream_available(void) {
 }
 
 int llm_stream_read(char *buf, int max_len) {
-    int copy = async_stream_len;
+    /* Snapshot of the whole partial reply; prefer llm_query_stream */
+    llm_stream_t *q = query_get(async_handle);
+    const char *src = q ? q->text : async_stream_buf;
+    int copy = q ? q->len : async_stream_len;
     if (copy >= max_len) copy = max_len - 1;
     if (copy > 0) {
-        memcpy(buf, async_stream_buf, copy);
+        memcpy(buf, src, copy);
         buf[copy] = '\0';
     }
     return copy;
@@ -224,57 +439,23 @@ int llm_stream_read(char *buf, int max_len) {
 /* ── Telemetry ────────────────────────────────────────────── */
 void llm_send_telemetry(uint32_t mem_pct, uint32_t proc_count, uint32_t uptime_s, uint32_t ctx_switches) {
     char buf[128];
-    char tmp[16];
-    
-    serial_write_char('\x01');
-    serial_write_char('T');
-    
-    strcpy(buf, "mem=");
-    itoa(mem_pct, tmp, 10); strcat(buf, tmp);
-    strcat(buf, ",procs=");
-    itoa(proc_count, tmp, 10); strcat(buf, tmp);
-    strcat(buf, ",up=");
-    itoa(uptime_s, tmp, 10); strcat(buf, tmp);
-    strcat(buf, ",ctx=");
-    itoa(ctx_switches, tmp, 10); strcat(buf, tmp);
-    
-    const char *p = buf;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
+    ksnprintf(buf, sizeof(buf), "mem=%u,procs=%u,up=%u,ctx=%u",
+              mem_pct, proc_count, uptime_s, ctx_switches);
+
+    send_str(BRIDGE_CH_TELEM, 'T', buf);
 }
 
 /* ── Heartbeat ────────────────────────────────────────────── */
 void llm_send_heartbeat(void) {
-    serial_write_char('\x01');
-    serial_write_char('H');
-    serial_write_char('\x04');
+    bridge_send(BRIDGE_CH_CTRL, 'H', 0, 0, 0);
     last_heartbeat_sent = timer_get_ticks();
 }
 
 int llm_bridge_connected(void) {
-    /* Consider bridge alive if heartbeat response within last 10 seconds */
-    uint32_t now = timer_get_ticks();
-    if (bridge_alive && (now - last_heartbeat_recv) < timer_get_frequency() * 10) {
-        return 1;
-    }
-    
-    /* Check for heartbeat response in serial buffer */
-    if (serial_data_ready() && !async_pending) {
-        char c = serial_read_char();
-        if (c == '\x01') {
-            char cmd = serial_read_char();
-            if (cmd == 'P') {
-                /* Heartbeat pong — skip to EOT */
-                while (serial_data_ready()) {
-                    char x = serial_read_char();
-                    if (x == '\x04') break;
-                }
-                bridge_alive = 1;
-                last_heartbeat_recv = now;
-                return 1;
-            }
-        }
-    }
+    /* Alive if any valid frame (pong or reply) arrived in the last 10 seconds */
+    bridge_poll();
+    uint32_t rx = bridge_last_rx();
+    bridge_alive = rx && (timer_get_ticks() - rx) < timer_get_frequency() * 10;
     return bridge_alive;
 }
 
@@ -289,25 +470,24 @@ uint32_t llm_get_query_count(void) {
 
 /* ── Host Persistent Storage via Bridge ──────────────────── */
 void llm_host_save(const char *name, const char *content) {
-    serial_write_char('\x01');
-    serial_write_char('V');
-    const char *p = name;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('|');
-    p = content;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
+    /* The bridge runs STORE ops in order, so a later load sees this */
+    char hdr[64];
+    int n = strlen(name);
+    if (n > (int)sizeof(hdr) - 1) n = sizeof(hdr) - 1;
+    memcpy(hdr, name, n);
+    hdr[n++] = '|';
+    bridge_sendv(BRIDGE_CH_STORE, 'V', 0, hdr, n, content, strlen(content));
 }
 
 int llm_host_load(const char *name, char *buf, int max_len) {
-    serial_write_char('\x01');
-    serial_write_char('L');
-    const char *p = name;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
-
-    int len = serial_read_line(buf, max_len, 5);
-    if (len == 0) {
+    int id = bridge_request(BRIDGE_CH_STORE, 'L', name, strlen(name));
+    int len = -1;
+    if (id > 0) {
+        if (wait_request(id, LOAD_TIMEOUT_S) > 0 && !bridge_request_error(id))
+            len = bridge_request_read(id, buf, max_len);
+        bridge_release(id);
+    }
+    if (len <= 0) {
         buf[0] = '\0';
         return -1;
     }
@@ -315,9 +495,9 @@ int llm_host_load(const char *name, char *buf, int max_len) {
 }
 
 void llm_host_audit(const char *event) {
-    serial_write_char('\x01');
-    serial_write_char('A');
-    const char *p = event;
-    while (*p) serial_write_char(*p++);
-    serial_write_char('\x04');
+    send_str(BRIDGE_CH_AUDIT, 'A', event);
+}
+
+void llm_host_audit_batch(const char *lines, int len) {
+    bridge_send(BRIDGE_CH_AUDIT, 'B', 0, lines, len);
 }
@@ -25,6 +25,27 @@ int llm_query(const char *question, char *response, int max_len);
 /* Set the system prompt used by the LLM bridge */
 void llm_set_system_prompt(const char *prompt);
 
+/* ── Concurrent Queries ───────────────────────────────────── */
+/* Start a query; returns a handle (> 0) or -1 if not ready / all
+   bridge request slots are busy. Several may be in flight at once. */
+int  llm_query_begin(const char *question);
+
+/* Poll a handle: 0 = waiting, >0 = response length (handle is freed),
+   -1 = error/timeout (handle is freed, response holds the reason) */
+int  llm_query_poll(int handle, char *response, int max_len);
+
+/* Streaming read (cursor-based): copies only the bytes that arrived
+   since the last call. >0 = bytes copied (NUL-terminated), 0 = nothing
+   new yet, -1 = reply finished or timed out (handle is freed). */
+int  llm_query_stream(int handle, char *buf, int max_len);
+
+/* Sleep until the reply is complete or the query would time out;
+   follow with llm_query_poll to collect it */
+void llm_query_wait(int handle);
+
+/* Abandon a query; a late reply is dropped */
+void llm_query_cancel(int handle);
+
 /* ── Asynchronous / Non-Blocking Query ────────────────────── */
 /* Send a query without blocking — returns immediately */
 void llm_query_async(const char *question);
@@ -39,7 +60,8 @@ int llm_async_pending(void);
 /* Check bytes available in response stream (for streaming display) */
 int llm_stream_available(void);
 
-/* Read partial stream data (for streaming token display) */
+/* Snapshot of the partial reply so far (recopies from the start;
+   use llm_query_stream for incremental display) */
 int llm_stream_read(char *buf, int max_len);
 
 /* ── Telemetry & Heartbeat ────────────────────────────────── */
@@ -52,6 +74,13 @@ void llm_send_heartbeat(void);
 /* Check if bridge is connected (heartbeat response received recently) */
 int llm_bridge_connected(void);
 
+/* ── Response Cache ───────────────────────────────────────── */
+/* llm_query / llm_query_async answer repeats of (system prompt, query)
+   locally for a TTL instead of making a bridge round-trip. */
+void     llm_cache_clear(void);
+uint32_t llm_cache_hits(void);
+uint32_t llm_cache_misses(void);
+
 /* ── Latency Tracking ─────────────────────────────────────── */
 /* Get last query round-trip time in milliseconds */
 uint32_t llm_get_last_latency(void);
@@ -63,5 +92,7 @@ uint32_t llm_get_query_count(void);
 void llm_host_save(const char *name, const char *content);
 int  llm_host_load(const char *name, char *buf, int max_len);
 void llm_host_audit(const char *event);
+/* Newline-separated events in one message */
+void llm_host_audit_batch(const char *lines, int len);
 
 #endif
@@ -1,95 +1,530 @@
 /* ============================================================
  * SwanOS — Memory Manager (Physical & Heap)
- * Includes Bitmap Page Frame Allocator + Kernel Bump Allocator
+ * Includes Bitmap Page Frame Allocator + Slab / Page-Run Kernel Heap
  * ============================================================ */
 
 #include "memory.h"
 #include "string.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "trace.h"
 
-#define PMM_MAX_BLOCKS 32768 /* 128 MB RAM max */
-static uint32_t pmm_bitmap[PMM_MAX_BLOCKS / 32];
+/* Frames at/above PMM_PHYS_LIMIT are never handed out: the kernel
+ * reaches frames through their identity address, which a user CR3
+ * maps to the process's own pages from USER_CODE_BASE up. */
+#define PMM_MAX_BLOCKS (PMM_PHYS_LIMIT / PAGE_SIZE)
+#define PMM_WORDS      (PMM_MAX_BLOCKS / 32)
+
+/* pmm_bitmap: one bit per frame (1 = used).
+ * pmm_summary: one bit per bitmap word (1 = all 32 frames used), so a free
+ * frame is found with two ctz operations instead of a word-by-word walk.
+ * pmm_hint is the next-fit cursor (a bitmap word index). */
+static uint32_t pmm_bitmap[PMM_WORDS];
+static uint32_t pmm_summary[PMM_WORDS / 32];
+static uint32_t pmm_hint = 0;
 static uint32_t pmm_used_blocks = 0;
-static uint32_t pmm_max_blocks = PMM_MAX_BLOCKS;
+static uint32_t pmm_max_blocks = 0;    /* frame index limit (top of RAM) */
+static uint32_t pmm_total_blocks = 0;  /* usable frames per memory map  */
+static uint8_t  pmm_refs[PMM_MAX_BLOCKS];   /* extra owners of shared frames */
+
+/* Guards the bitmap, summary, refcounts and zero pool; taken with
+ * IRQs off since frames are freed from the switch path. */
+static spinlock_t pmm_lock = SPINLOCK_INIT;
+
+/* Kernel image extent, from linker.ld */
+extern uint8_t kernel_start[];
+extern uint8_t kernel_end[];
+
+/* Kernel heap placed right after the kernel image + BSS, with 32 MB heap space.
+ * The heap is managed in 4 KB pages: small requests come from per-size-class
+ * slab pages, larger ones get a run of whole pages from a coalescing
+ * free-run list. All bookkeeping lives in heap_pages[], outside the heap. */
+#define HEAP_SIZE  0x2000000  /* 32 MB heap */
+#define HEAP_PAGES (HEAP_SIZE / PAGE_SIZE)
+
+#define HP_FREE  0   /* part of a free run (head/tail are authoritative) */
+#define HP_LARGE 1   /* head page of a large allocation run              */
+#define HP_SLAB  2   /* slab page for one size class                     */
+#define HP_TAIL  3   /* any later page of a large allocation run         */
+
+#define SLAB_CLASSES   8
+#define SLAB_MAX_SIZE  2048
+static const uint16_t slab_sizes[SLAB_CLASSES] = { 16, 32, 64, 128, 256, 512, 1024, 2048 };
+
+typedef struct {
+    uint8_t  kind;
+    uint8_t  cls;      /* slab: size class index                      */
+    uint16_t inuse;    /* slab: live objects                          */
+    uint16_t run;      /* free/large: run length (valid at head+tail) */
+    int16_t  next;     /* free-run list or slab partial list          */
+    int16_t  prev;
+    void    *free;     /* slab: free object list                      */
+} heap_page_t;
+
+static heap_page_t heap_pages[HEAP_PAGES];
+static int16_t heap_free_runs = -1;
+static int16_t slab_partial[SLAB_CLASSES];
+static uint32_t heap_used_bytes = 0;
+static spinlock_t heap_lock = SPINLOCK_INIT;   /* slabs and free runs */
+static uint32_t heap_start = 0;
+
+static inline void *heap_page_addr(int idx) {
+    return (void *)(heap_start + (uint32_t)idx * PAGE_SIZE);
+}
+
+/* ── Page runs ── */
+
+static void run_mark(int head, int n, uint8_t kind) {
+    heap_pages[head].kind = kind;
+    heap_pages[head].run = (uint16_t)n;
+    heap_pages[head + n - 1].kind = kind;
+    heap_pages[head + n - 1].run = (uint16_t)n;
+}
+
+static void run_link(int head) {
+    heap_pages[head].prev = -1;
+    heap_pages[head].next = heap_free_runs;
+    if (heap_free_runs >= 0) heap_pages[heap_free_runs].prev = (int16_t)head;
+    heap_free_runs = (int16_t)head;
+}
+
+static void run_unlink(int head) {
+    heap_page_t *hp = &heap_pages[head];
+    if (hp->prev >= 0) heap_pages[hp->prev].next = hp->next;
+    else heap_free_runs = hp->next;
+    if (hp->next >= 0) heap_pages[hp->next].prev = hp->prev;
+}
+
+/* First-fit; the allocation is cut from the tail of the free run so the
+ * run head (and its list position) stays put. */
+static int run_alloc(int n) {
+    for (int r = heap_free_runs; r >= 0; r = heap_pages[r].next) {
+        int len = heap_pages[r].run;
+        if (len < n) continue;
+        if (len == n) {
+            run_unlink(r);
+        } else {
+            run_mark(r, len - n, HP_FREE);
+            r += len - n;
+        }
+        run_mark(r, n, HP_LARGE);
+        for (int i = 1; i < n; i++) heap_pages[r + i].kind = HP_TAIL;
+        return r;
+    }
+    return -1;
+}
 
-/* Kernel bump allocator starting at 24 MB (past BSS backbuffer), with 8 MB heap space */
-#define HEAP_START 0x1800000  /* 24 MB — after kernel + large BSS (8MB backbuf) */
-#define HEAP_SIZE  0x800000   /* 8 MB heap */
+/* Every page of a free run is HP_FREE, so a stale pointer into one
+ * is never taken for a slab or a run head */
+static void run_free(int head, int n) {
+    for (int i = 0; i < n; i++) heap_pages[head + i].kind = HP_FREE;
+
+    /* Merge with the following run */
+    int after = head + n;
+    if (after < HEAP_PAGES && heap_pages[after].kind == HP_FREE) {
+        n += heap_pages[after].run;
+        run_unlink(after);
+    }
+    /* Merge into the preceding run, which keeps its list slot */
+    if (head > 0 && heap_pages[head - 1].kind == HP_FREE) {
+        int before = head - heap_pages[head - 1].run;
+        run_mark(before, heap_pages[before].run + n, HP_FREE);
+        return;
+    }
+    run_mark(head, n, HP_FREE);
+    run_link(head);
+}
+
+/* ── Slabs ── */
+
+static void slab_unlink(int idx) {
+    heap_page_t *hp = &heap_pages[idx];
+    if (hp->prev >= 0) heap_pages[hp->prev].next = hp->next;
+    else slab_partial[hp->cls] = hp->next;
+    if (hp->next >= 0) heap_pages[hp->next].prev = hp->prev;
+}
 
-static uint32_t heap_ptr = HEAP_START;
+static void slab_link(int idx) {
+    heap_page_t *hp = &heap_pages[idx];
+    hp->prev = -1;
+    hp->next = slab_partial[hp->cls];
+    if (hp->next >= 0) heap_pages[hp->next].prev = (int16_t)idx;
+    slab_partial[hp->cls] = (int16_t)idx;
+}
+
+static int slab_new(int cls) {
+    int idx = run_alloc(1);
+    if (idx < 0) return -1;
+
+    heap_page_t *hp = &heap_pages[idx];
+    hp->kind = HP_SLAB;
+    hp->cls = (uint8_t)cls;
+    hp->inuse = 0;
+
+    /* Thread every object onto the free list */
+    uint32_t size = slab_sizes[cls];
+    uint8_t *base = (uint8_t *)heap_page_addr(idx);
+    void *head = 0;
+    for (uint32_t off = PAGE_SIZE; off >= size; ) {
+        off -= size;
+        *(void **)(base + off) = head;
+        head = base + off;
+    }
+    hp->free = head;
+    slab_link(idx);
+    return idx;
+}
+
+static void *slab_alloc(int cls) {
+    int idx = slab_partial[cls];
+    if (idx < 0 && (idx = slab_new(cls)) < 0) return 0;
+
+    heap_page_t *hp = &heap_pages[idx];
+    void *obj = hp->free;
+    hp->free = *(void **)obj;
+    hp->inuse++;
+    if (!hp->free) slab_unlink(idx);   /* now full */
+    heap_used_bytes += slab_sizes[cls];
+    return obj;
+}
+
+static void slab_free(int idx, void *ptr) {
+    heap_page_t *hp = &heap_pages[idx];
+    int was_full = (hp->free == 0);
+
+    *(void **)ptr = hp->free;
+    hp->free = ptr;
+    hp->inuse--;
+    heap_used_bytes -= slab_sizes[hp->cls];
+
+    if (hp->inuse == 0) {
+        if (!was_full) slab_unlink(idx);
+        run_free(idx, 1);
+    } else if (was_full) {
+        slab_link(idx);
+    }
+}
+
+static void heap_init(void) {
+    memset(heap_pages, 0, sizeof(heap_pages));
+    for (int c = 0; c < SLAB_CLASSES; c++) slab_partial[c] = -1;
+    heap_free_runs = -1;
+    heap_used_bytes = 0;
+    run_mark(0, HEAP_PAGES, HP_FREE);
+    run_link(0);
+}
+
+/* ── Physical frame bitmap ── */
+
+static inline void pmm_set(uint32_t frame) {
+    uint32_t w = frame / 32;
+    pmm_bitmap[w] |= (1u << (frame % 32));
+    if (pmm_bitmap[w] == 0xFFFFFFFF) pmm_summary[w / 32] |= (1u << (w % 32));
+}
+
+static inline void pmm_clear(uint32_t frame) {
+    uint32_t w = frame / 32;
+    pmm_bitmap[w] &= ~(1u << (frame % 32));
+    pmm_summary[w / 32] &= ~(1u << (w % 32));
+}
+
+static inline int pmm_test(uint32_t frame) {
+    return (pmm_bitmap[frame / 32] >> (frame % 32)) & 1;
+}
+
+/* Mark [start, end) used; only frames currently free are counted. */
+static void pmm_reserve_range(uint32_t start, uint32_t end) {
+    uint32_t first = start / PAGE_SIZE;
+    uint32_t last = (end + PAGE_SIZE - 1) / PAGE_SIZE;
+    if (last > pmm_max_blocks) last = pmm_max_blocks;
+    for (uint32_t f = first; f < last; f++) {
+        if (!pmm_test(f)) {
+            pmm_set(f);
+            pmm_used_blocks++;
+        }
+    }
+}
 
-void memory_init(void) {
-    /* Initialize Bump allocator */
-    heap_ptr = HEAP_START;
+/* Free every whole frame inside [base, base + len) of usable RAM. */
+static void pmm_add_region(uint64_t base, uint64_t len) {
+    uint64_t end = base + len;
+    uint64_t limit = (uint64_t)PMM_MAX_BLOCKS * PAGE_SIZE;
+    if (base >= limit) return;
+    if (end > limit) end = limit;
 
-    /* Initialize PMM Bitmap */
-    memset(pmm_bitmap, 0, sizeof(pmm_bitmap));
+    uint32_t first = (uint32_t)((base + PAGE_SIZE - 1) / PAGE_SIZE);
+    uint32_t last = (uint32_t)(end / PAGE_SIZE);
+    for (uint32_t f = first; f < last; f++) {
+        if (pmm_test(f)) {
+            pmm_clear(f);
+            pmm_total_blocks++;
+        }
+    }
+    if (last > pmm_max_blocks) pmm_max_blocks = last;
+}
+
+void memory_init(multiboot_info_t *mboot) {
+    /* Everything starts reserved; only RAM the loader reports is freed */
+    memset(pmm_bitmap, 0xFF, sizeof(pmm_bitmap));
+    memset(pmm_summary, 0xFF, sizeof(pmm_summary));
+    pmm_max_blocks = 0;
+    pmm_total_blocks = 0;
     pmm_used_blocks = 0;
 
-    /* Reserve first 32 MB for kernel + BSS (8MB backbuf) + heap */
-    /* 32 MB = 8192 pages */
-    uint32_t reserved_pages = 8192;
-    for (uint32_t i = 0; i < reserved_pages; i++) {
-        pmm_bitmap[i / 32] |= (1 << (i % 32));
+    if (mboot && (mboot->flags & MULTIBOOT_INFO_MEM_MAP)) {
+        uint32_t p = mboot->mmap_addr;
+        uint32_t end = mboot->mmap_addr + mboot->mmap_length;
+        while (p < end) {
+            multiboot_mmap_entry_t *e = (multiboot_mmap_entry_t *)p;
+            if (e->type == MULTIBOOT_MEMORY_AVAILABLE) {
+                pmm_add_region(e->addr, e->len);
+            }
+            p += e->size + sizeof(e->size);
+        }
+    } else if (mboot && (mboot->flags & MULTIBOOT_INFO_MEMORY)) {
+        pmm_add_region(0x100000, (uint64_t)mboot->mem_upper * 1024);
+    } else {
+        pmm_add_region(0x100000, 127 * 1024 * 1024); /* assume 128 MB */
+    }
+    pmm_max_blocks = (pmm_max_blocks + 31) & ~31u;   /* whole bitmap words */
+
+    /* Low 1 MB (BIOS, VGA, loader data), kernel image + BSS, then heap */
+    pmm_reserve_range(0, 0x100000);
+    pmm_reserve_range((uint32_t)kernel_start, (uint32_t)kernel_end);
+    heap_start = ((uint32_t)kernel_end + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1);
+    pmm_reserve_range(heap_start, heap_start + HEAP_SIZE);
+    if (mboot) {
+        pmm_reserve_range((uint32_t)mboot, (uint32_t)mboot + sizeof(*mboot));
     }
-    pmm_used_blocks = reserved_pages;
+
+    pmm_hint = (heap_start + HEAP_SIZE) / PAGE_SIZE / 32;
+    heap_init();
+}
+
+/* Find a bitmap word with a free frame, starting at the next-fit hint.
+ * Returns PMM_WORDS when every frame is in use. */
+static uint32_t pmm_find_word(void) {
+    uint32_t nsum = (pmm_max_blocks / 32 + 31) / 32;
+    uint32_t s = pmm_hint / 32;
+    for (uint32_t k = 0; k <= nsum; k++, s = (s + 1 == nsum) ? 0 : s + 1) {
+        uint32_t avail = ~pmm_summary[s];
+        if (k == 0) avail &= ~0u << (pmm_hint % 32);   /* from the hint on */
+        if (!avail) continue;
+        uint32_t w = s * 32 + (uint32_t)__builtin_ctz(avail);
+        if (w < pmm_max_blocks / 32) return w;
+    }
+    return PMM_WORDS;
+}
+
+/* Claim one frame without touching its contents. */
+static uint32_t pmm_take_frame(void) {
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    uint32_t w = pmm_find_word();
+    if (w == PMM_WORDS) {
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        return 0; /* out of memory */
+    }
+
+    uint32_t frame = w * 32 + (uint32_t)__builtin_ctz(~pmm_bitmap[w]);
+    pmm_set(frame);
+    pmm_used_blocks++;
+    pmm_hint = w;
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return frame * PAGE_SIZE;
+}
+
+/* ── Pre-zeroed page pool (refilled by the idle process) ──
+ * Pooled frames are taken in the bitmap but still count as free in
+ * mem_used/mem_free, and any allocation may fall back on them. */
+#define ZERO_POOL_SIZE 64
+static uint32_t zero_pool[ZERO_POOL_SIZE];
+static int zero_pool_count = 0;
+
+void *pmm_alloc_page_flags(uint32_t alloc_flags) {
+    uint32_t addr = 0;
+    if (alloc_flags & PMM_ZERO) {
+        uint32_t flags = spin_lock_irqsave(&pmm_lock);
+        if (zero_pool_count > 0) addr = zero_pool[--zero_pool_count];
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        if (addr) {
+            TRACE(TR_PMM_ALLOC, addr, alloc_flags);
+            return (void *)addr;
+        }
+    }
+
+    addr = pmm_take_frame();
+    if (!addr && !(alloc_flags & PMM_ZERO)) {
+        uint32_t flags = spin_lock_irqsave(&pmm_lock);
+        if (zero_pool_count > 0) addr = zero_pool[--zero_pool_count];
+        spin_unlock_irqrestore(&pmm_lock, flags);
+    }
+    if (addr && (alloc_flags & PMM_ZERO)) {
+        memset((void *)addr, 0, PAGE_SIZE);
+    }
+    TRACE(TR_PMM_ALLOC, addr, alloc_flags);
+    return (void *)addr;
 }
 
 void *pmm_alloc_page(void) {
-    for (uint32_t i = 0; i < pmm_max_blocks / 32; i++) {
-        if (pmm_bitmap[i] != 0xFFFFFFFF) {
-            for (int j = 0; j < 32; j++) {
-                if (!(pmm_bitmap[i] & (1 << j))) {
-                    pmm_bitmap[i] |= (1 << j);
-                    pmm_used_blocks++;
-                    uint32_t addr = (i * 32 + j) * PAGE_SIZE;
-                    /* Zero out the physical page before returning */
-                    memset((void*)addr, 0, PAGE_SIZE);
-                    return (void *)addr;
-                }
-            }
+    return pmm_alloc_page_flags(PMM_ZERO);
+}
+
+int pmm_zero_pool_refill(int max_pages) {
+    int added = 0;
+    while (added < max_pages && zero_pool_count < ZERO_POOL_SIZE) {
+        uint32_t addr = pmm_take_frame();
+        if (!addr) break;
+        memset((void *)addr, 0, PAGE_SIZE);   /* interrupts stay enabled */
+
+        uint32_t flags = spin_lock_irqsave(&pmm_lock);
+        if (zero_pool_count < ZERO_POOL_SIZE) {
+            zero_pool[zero_pool_count++] = addr;
+            addr = 0;
         }
+        spin_unlock_irqrestore(&pmm_lock, flags);
+        if (addr) {                           /* pool filled meanwhile */
+            pmm_free_page((void *)addr);
+            break;
+        }
+        added++;
     }
-    return 0; /* out of memory */
+    return added;
 }
 
 void pmm_free_page(void *ptr) {
     uint32_t addr = (uint32_t)ptr;
     uint32_t frame = addr / PAGE_SIZE;
-    if (frame < pmm_max_blocks) {
-        if (pmm_bitmap[frame / 32] & (1 << (frame % 32))) {
-            pmm_bitmap[frame / 32] &= ~(1 << (frame % 32));
-            pmm_used_blocks--;
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    if (frame < pmm_max_blocks && pmm_refs[frame]) {
+        pmm_refs[frame]--;       /* still owned by someone else */
+    } else if (frame < pmm_max_blocks && pmm_test(frame)) {
+        pmm_clear(frame);
+        pmm_used_blocks--;
+        pmm_hint = frame / 32;   /* reuse the hottest frame next */
+    }
+    spin_unlock_irqrestore(&pmm_lock, flags);
+}
+
+int pmm_ref_page(void *ptr) {
+    uint32_t frame = (uint32_t)ptr / PAGE_SIZE;
+    if (frame >= pmm_max_blocks) return -1;
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    int ok = pmm_test(frame) && pmm_refs[frame] < 0xFF;
+    if (ok) pmm_refs[frame]++;
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return ok ? 0 : -1;
+}
+
+uint32_t pmm_page_refs(void *ptr) {
+    uint32_t frame = (uint32_t)ptr / PAGE_SIZE;
+    return frame < pmm_max_blocks ? pmm_refs[frame] : 0;
+}
+
+/* Contiguous run of n frames (first fit, skipping full words). Used for
+ * large physically-contiguous buffers, so it is not on the hot path. */
+void *pmm_alloc_pages(uint32_t n, uint32_t alloc_flags) {
+    if (n == 0) return 0;
+    if (n == 1) return pmm_alloc_page_flags(alloc_flags);
+
+    uint32_t flags = spin_lock_irqsave(&pmm_lock);
+    uint32_t run = 0, start = 0;
+    for (uint32_t f = 0; f < pmm_max_blocks; ) {
+        uint32_t w = f / 32;
+        if ((f % 32) == 0 && pmm_bitmap[w] == 0xFFFFFFFF) {
+            run = 0;
+            f += 32;
+            continue;
+        }
+        if (pmm_test(f)) {
+            run = 0;
+        } else {
+            if (run == 0) start = f;
+            if (++run == n) {
+                for (uint32_t i = start; i < start + n; i++) pmm_set(i);
+                pmm_used_blocks += n;
+                spin_unlock_irqrestore(&pmm_lock, flags);
+                if (alloc_flags & PMM_ZERO) {
+                    memset((void *)(start * PAGE_SIZE), 0, n * PAGE_SIZE);
+                }
+                return (void *)(start * PAGE_SIZE);
+            }
         }
+        f++;
+    }
+    spin_unlock_irqrestore(&pmm_lock, flags);
+    return 0;
+}
+
+void pmm_free_pages(void *ptr, uint32_t n) {
+    uint32_t addr = (uint32_t)ptr;
+    for (uint32_t i = 0; i < n; i++) {
+        pmm_free_page((void *)(addr + i * PAGE_SIZE));
     }
 }
 
 void *kmalloc(size_t size) {
-    /* Align to 4 bytes */
-    size = (size + 3) & ~3;
+    if (size == 0 || size > HEAP_SIZE) return 0;
 
-    if (heap_ptr + size > HEAP_START + HEAP_SIZE) {
-        return 0; /* out of kernel heap memory */
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    void *ptr = 0;
+    if (size <= SLAB_MAX_SIZE) {
+        int cls = 0;
+        while (slab_sizes[cls] < size) cls++;
+        ptr = slab_alloc(cls);
+    } else {
+        int n = (int)((size + PAGE_SIZE - 1) / PAGE_SIZE);
+        int idx = run_alloc(n);
+        if (idx >= 0) {
+            ptr = heap_page_addr(idx);
+            heap_used_bytes += (uint32_t)n * PAGE_SIZE;
+        }
     }
+    spin_unlock_irqrestore(&heap_lock, flags);
+    return ptr; /* 0 when the kernel heap is exhausted */
+}
 
-    void *ptr = (void *)heap_ptr;
-    heap_ptr += size;
-    memset(ptr, 0, size);
+void *kzalloc(size_t size) {
+    void *ptr = kmalloc(size);
+    if (ptr) memset(ptr, 0, size);
     return ptr;
 }
 
 void kfree(void *ptr) {
-    /* Bump allocator — no free support */
-    (void)ptr;
+    uint32_t addr = (uint32_t)ptr;
+    if (addr < heap_start || addr >= heap_start + HEAP_SIZE) return;
+
+    int idx = (int)((addr - heap_start) / PAGE_SIZE);
+    uint32_t flags = spin_lock_irqsave(&heap_lock);
+    heap_page_t *hp = &heap_pages[idx];
+    uint32_t off = addr & (PAGE_SIZE - 1);
+    /* Only object and run heads are freed; anything else (a pointer
+     * into a run, a free page, a misaligned slab address) is ignored
+     * rather than corrupting the heap */
+    if (hp->kind == HP_SLAB) {
+        if (off % slab_sizes[hp->cls] == 0) slab_free(idx, ptr);
+    } else if (hp->kind == HP_LARGE && off == 0) {
+        heap_used_bytes -= (uint32_t)hp->run * PAGE_SIZE;
+        run_free(idx, hp->run);
+    }
+    spin_unlock_irqrestore(&heap_lock, flags);
+}
+
+uint32_t kheap_used(void) {
+    return heap_used_bytes;
 }
 
 uint32_t mem_used(void) {
-    return pmm_used_blocks * PAGE_SIZE;
+    return (pmm_used_blocks - (uint32_t)zero_pool_count) * PAGE_SIZE;
 }
 
 uint32_t mem_free(void) {
-    return (pmm_max_blocks - pmm_used_blocks) * PAGE_SIZE;
+    return (pmm_total_blocks - pmm_used_blocks + (uint32_t)zero_pool_count) * PAGE_SIZE;
 }
 
 uint32_t mem_total(void) {
+    return pmm_total_blocks * PAGE_SIZE;
+}
+
+uint32_t mem_phys_top(void) {
     return pmm_max_blocks * PAGE_SIZE;
 }
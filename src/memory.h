@@ -3,21 +3,41 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include "multiboot.h"
 
 #define PAGE_SIZE 4096
 
-void  memory_init(void);
+void  memory_init(multiboot_info_t *mboot);
 
 // Physical Memory Manager (Pages)
-void *pmm_alloc_page(void);
+#define PMM_UNINIT 0x0   // caller overwrites the whole frame itself
+#define PMM_ZERO   0x1   // frame must read as zeros
+
+void *pmm_alloc_page(void);                   // zeroed (PMM_ZERO)
+void *pmm_alloc_page_flags(uint32_t flags);
 void  pmm_free_page(void *ptr);
+void *pmm_alloc_pages(uint32_t n, uint32_t flags); // n physically contiguous frames
+void  pmm_free_pages(void *ptr, uint32_t n);
+int   pmm_zero_pool_refill(int max_pages);    // idle-time zeroing; returns pages added
+
+// Frame sharing: a frame has one owner plus pmm_page_refs() extra ones,
+// and pmm_free_page drops one owner. Used by fs views and COW mappings.
+int      pmm_ref_page(void *ptr);             // 0, or -1 if the count is saturated
+uint32_t pmm_page_refs(void *ptr);            // 0 = sole owner
 
-// Kernel Heap Allocator (Bump)
-void *kmalloc(size_t size);
+// Kernel Heap Allocator (slabs for <= 2 KB, page runs above)
+void *kmalloc(size_t size);   // contents are uninitialized
+void *kzalloc(size_t size);   // zero-filled
 void  kfree(void *ptr);
+uint32_t kheap_used(void);
 
 uint32_t mem_used(void);
 uint32_t mem_free(void);
 uint32_t mem_total(void);
+/* Usable RAM ends here: above it the user window (USER_CODE_BASE)
+ * shadows the kernel's identity map under a process CR3. */
+#define PMM_PHYS_LIMIT 0x40000000
+
+uint32_t mem_phys_top(void);   // end of the highest usable frame
 
 #endif
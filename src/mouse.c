@@ -1,13 +1,18 @@
 /* ============================================================
  * SwanOS — PS/2 Mouse Driver
- * Initializes the PS/2 auxiliary device (mouse) and handles
- * IRQ12 interrupts to track position and button state.
+ * Initializes the PS/2 auxiliary device (mouse). The IRQ12 top
+ * half queues raw bytes; the bottom half assembles packets,
+ * tracks position and buttons and emits input events.
  * ============================================================ */
 
 #include "mouse.h"
 #include "idt.h"
 #include "ports.h"
 #include "vga_gfx.h"
+#include "softirq.h"
+#include "input.h"
+#include "timer.h"
+#include "spinlock.h"
 
 /* ── Mouse state ──────────────────────────────────────────── */
 static volatile int      mouse_x = 0;
@@ -16,9 +21,20 @@ static volatile uint8_t  mouse_buttons = 0;
 static volatile int      mouse_moved_flag = 0;
 static volatile int      mouse_clicked_flag = 0;
 
-/* PS/2 mouse sends 3-byte packets */
-static volatile uint8_t  mouse_cycle = 0;
-static volatile int8_t   mouse_bytes[3];
+/* PS/2 mouse sends 3-byte packets, 4 in IntelliMouse mode (wheel) */
+static uint8_t  mouse_cycle = 0;
+static int8_t   mouse_bytes[4];
+static int      packet_len = 3;
+static int      rate = MOUSE_DEFAULT_RATE;
+static int      resolution = MOUSE_DEFAULT_RES;
+static uint32_t packets = 0;
+static volatile int resync = 0;     /* device reconfigured; restart assembly */
+
+/* Top half → bottom half, single writer and single reader */
+#define MOUSE_RAW_SIZE 128      /* bytes, power of two */
+static uint8_t  raw[MOUSE_RAW_SIZE];
+static uint32_t raw_us[MOUSE_RAW_SIZE];
+static volatile uint32_t raw_head = 0, raw_tail = 0;
 
 /* ── PS/2 controller helpers ──────────────────────────────── */
 
@@ -51,7 +67,64 @@ static uint8_t mouse_read(void) {
     return inb(0x60);
 }
 
-/* ── IRQ12 handler ────────────────────────────────────────── */
+/* Skip motion bytes still in flight until the device's ACK */
+static int mouse_ack(void) {
+    for (int i = 0; i < 8; i++)
+        if (mouse_read() == 0xFA) return 0;
+    return -1;
+}
+
+static int mouse_cmd(uint8_t cmd) {
+    mouse_write(cmd);
+    return mouse_ack();
+}
+
+static int mouse_cmd_arg(uint8_t cmd, uint8_t arg) {
+    if (mouse_cmd(cmd) < 0) return -1;
+    return mouse_cmd(arg);
+}
+
+/* IntelliMouse knock: sample rates 200, 100, 80 switch a wheel mouse
+ * to 4-byte packets and device ID 3 */
+static int detect_wheel(void) {
+    mouse_cmd_arg(0xF3, 200);
+    mouse_cmd_arg(0xF3, 100);
+    mouse_cmd_arg(0xF3, 80);
+    if (mouse_cmd(0xF2) < 0) return 0;
+    return mouse_read() == 3;
+}
+
+/* Resolution command argument: 0..3 = 1, 2, 4, 8 counts/mm */
+static int res_code(int cpmm) {
+    switch (cpmm) {
+        case 1: return 0;
+        case 2: return 1;
+        case 4: return 2;
+        case 8: return 3;
+        default: return -1;
+    }
+}
+
+static int valid_rate(int hz) {
+    return hz == 10 || hz == 20 || hz == 40 || hz == 60 ||
+           hz == 80 || hz == 100 || hz == 200;
+}
+
+/* Reconfigure while streaming: reporting off, and with IRQs held
+ * off the replies are polled here rather than reaching the IRQ12
+ * ring. The bottom half drops what was queued meanwhile and waits
+ * for the start of a packet again. */
+static int reconfigure(uint8_t cmd, uint8_t arg) {
+    uint32_t flags = irq_save();
+    mouse_cmd(0xF5);
+    int ok = mouse_cmd_arg(cmd, arg);
+    mouse_cmd(0xF4);
+    resync = 1;
+    irq_restore(flags);
+    return ok;
+}
+
+/* ── IRQ12 top half ───────────────────────────────────────── */
 
 static void mouse_callback(registers_t *regs) {
     (void)regs;
@@ -61,56 +134,108 @@ static void mouse_callback(registers_t *regs) {
     if (!(status & 0x20)) return;
 
     uint8_t data = inb(0x60);
+    uint32_t h = raw_head;
+    if (h - raw_tail < MOUSE_RAW_SIZE) {
+        raw[h & (MOUSE_RAW_SIZE - 1)] = data;
+        raw_us[h & (MOUSE_RAW_SIZE - 1)] = timer_get_us();
+        seq_barrier();          /* slot before head */
+        raw_head = h + 1;
+    }
+    softirq_raise(SOFTIRQ_MOUSE);
+}
+
+/* ── Bottom half ──────────────────────────────────────────── */
+
+static void packet(uint32_t us) {
+    uint8_t flags = (uint8_t)mouse_bytes[0];
+    int dx = mouse_bytes[1];
+    int dy = mouse_bytes[2];
+
+    /* Handle sign extension from flags byte */
+    if (flags & 0x10) dx |= 0xFFFFFF00;
+    if (flags & 0x20) dy |= 0xFFFFFF00;
+
+    /* Check overflow — discard packet */
+    if (flags & 0xC0) return;
 
-    switch (mouse_cycle) {
-        case 0:
-            mouse_bytes[0] = (int8_t)data;
-            /* Verify bit 3 is always set in the first byte */
-            if (data & 0x08) {
-                mouse_cycle = 1;
-            }
-            break;
-        case 1:
-            mouse_bytes[1] = (int8_t)data;
-            mouse_cycle = 2;
-            break;
-        case 2:
-            mouse_bytes[2] = (int8_t)data;
-            mouse_cycle = 0;
-
-            /* Process the complete packet */
-            uint8_t flags = (uint8_t)mouse_bytes[0];
-            int dx = mouse_bytes[1];
-            int dy = mouse_bytes[2];
-
-            /* Handle sign extension from flags byte */
-            if (flags & 0x10) dx |= 0xFFFFFF00;
-            if (flags & 0x20) dy |= 0xFFFFFF00;
-
-            /* Check overflow — discard packet */
-            if (flags & 0xC0) break;
-
-            /* Update position (PS/2 Y is inverted) */
-            mouse_x += dx;
-            mouse_y -= dy;
-
-            /* Clamp to screen */
-            if (mouse_x < 0) mouse_x = 0;
-            if (mouse_x >= GFX_W) mouse_x = GFX_W - 1;
-            if (mouse_y < 0) mouse_y = 0;
-            if (mouse_y >= GFX_H) mouse_y = GFX_H - 1;
-
-            /* Update buttons */
-            uint8_t new_buttons = flags & 0x07;
-            if (new_buttons && !mouse_buttons) {
-                mouse_clicked_flag = 1;
-            }
-            mouse_buttons = new_buttons;
-
-            if (dx != 0 || dy != 0)
-                mouse_moved_flag = 1;
-
-            break;
+    /* Update position (PS/2 Y is inverted) */
+    int x = mouse_x + dx, y = mouse_y - dy;
+
+    /* Clamp to screen */
+    if (x < 0) x = 0;
+    if (x >= GFX_W) x = GFX_W - 1;
+    if (y < 0) y = 0;
+    if (y >= GFX_H) y = GFX_H - 1;
+
+    /* Update buttons */
+    uint8_t new_buttons = flags & 0x07;
+    uint8_t pressed = new_buttons & ~mouse_buttons;
+    uint8_t released = mouse_buttons & ~new_buttons;
+    int wheel = packet_len == 4 ? mouse_bytes[3] : 0;
+    if (new_buttons && !mouse_buttons) {
+        mouse_clicked_flag = 1;
+    }
+    int moved = x != mouse_x || y != mouse_y;
+    packets++;
+    if (!moved && !wheel && new_buttons == mouse_buttons) return;
+
+    input_event_t ev;
+    ev.time_us = us;
+    ev.type = INPUT_MOUSE;
+    ev.key = 0;
+    ev.buttons = new_buttons;
+    ev.pressed = pressed;
+    ev.released = released;
+    ev.wheel = (int8_t)wheel;
+    ev.x = (int16_t)x;
+    ev.y = (int16_t)y;
+    ev.dx = (int16_t)(x - mouse_x);
+    ev.dy = (int16_t)(y - mouse_y);
+    ev.packets = 1;
+
+    mouse_x = x;
+    mouse_y = y;
+    mouse_buttons = new_buttons;
+    if (moved) {
+        mouse_moved_flag = 1;
+        vga_cursor_move(mouse_x, mouse_y);
+    }
+    input_push(&ev);
+}
+
+static void mouse_bh(void) {
+    if (resync) {
+        resync = 0;
+        raw_tail = raw_head;
+        mouse_cycle = 0;
+    }
+    while (raw_tail != raw_head) {
+        seq_barrier();
+        uint32_t t = raw_tail;
+        uint8_t data = raw[t & (MOUSE_RAW_SIZE - 1)];
+        uint32_t us = raw_us[t & (MOUSE_RAW_SIZE - 1)];
+        raw_tail = t + 1;
+
+        switch (mouse_cycle) {
+            case 0:
+                mouse_bytes[0] = (int8_t)data;
+                /* Verify bit 3 is always set in the first byte */
+                if (data & 0x08) {
+                    mouse_cycle = 1;
+                }
+                break;
+            case 1:
+                mouse_bytes[1] = (int8_t)data;
+                mouse_cycle = 2;
+                break;
+            case 2:
+            case 3:
+                mouse_bytes[mouse_cycle] = (int8_t)data;
+                if (++mouse_cycle < packet_len) break;
+                mouse_cycle = 0;
+                packet(us);     /* stamped with the packet's last byte */
+                break;
+        }
     }
 }
 
@@ -121,6 +246,8 @@ void mouse_init(void) {
 
     mouse_x = GFX_W / 2;
     mouse_y = GFX_H / 2;
+    raw_head = raw_tail = 0;
+    softirq_register(SOFTIRQ_MOUSE, mouse_bh);
 
     /* Enable the auxiliary mouse device */
     mouse_wait_input();
@@ -139,12 +266,15 @@ void mouse_init(void) {
     outb(0x60, status_byte);
 
     /* Tell mouse to use default settings */
-    mouse_write(0xF6);
-    mouse_read(); /* ACK */
+    mouse_cmd(0xF6);
+
+    /* Wheel if it has one, then our rate and resolution */
+    packet_len = detect_wheel() ? 4 : 3;
+    mouse_cmd_arg(0xF3, (uint8_t)rate);
+    mouse_cmd_arg(0xE8, (uint8_t)res_code(resolution));
 
     /* Enable data reporting */
-    mouse_write(0xF4);
-    mouse_read(); /* ACK */
+    mouse_cmd(0xF4);
 
     /* Register IRQ12 handler (IRQ12 → INT 44) */
     register_interrupt_handler(44, mouse_callback);
@@ -161,6 +291,7 @@ void mouse_init(void) {
 }
 
 void mouse_get_state(mouse_state_t *state) {
+    softirq_run();              /* fold in packets not yet decoded */
     state->x = mouse_x;
     state->y = mouse_y;
     state->buttons = mouse_buttons;
@@ -180,3 +311,34 @@ void mouse_clear_events(void) {
     mouse_moved_flag = 0;
     mouse_clicked_flag = 0;
 }
+
+/* ── Device settings ──────────────────────────────────────── */
+
+int mouse_set_rate(int hz) {
+    if (!valid_rate(hz) || reconfigure(0xF3, (uint8_t)hz) < 0) return -1;
+    rate = hz;
+    return 0;
+}
+
+int mouse_set_resolution(int cpmm) {
+    int code = res_code(cpmm);
+    if (code < 0 || reconfigure(0xE8, (uint8_t)code) < 0) return -1;
+    resolution = cpmm;
+    return 0;
+}
+
+int mouse_rate(void) {
+    return rate;
+}
+
+int mouse_resolution(void) {
+    return resolution;
+}
+
+int mouse_has_wheel(void) {
+    return packet_len == 4;
+}
+
+uint32_t mouse_packets(void) {
+    return packets;
+}
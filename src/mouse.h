@@ -15,10 +15,22 @@ typedef struct {
     int clicked;           /* set to 1 on new button press */
 } mouse_state_t;
 
+/* Sampling: the device reports up to `rate` packets a second;
+ * motion between frames is coalesced in the input queue (input.h) */
+#define MOUSE_DEFAULT_RATE 200  /* Hz */
+#define MOUSE_DEFAULT_RES  4    /* counts/mm */
+
 void mouse_init(void);
 void mouse_get_state(mouse_state_t *state);
 int  mouse_left_pressed(void);
 int  mouse_right_pressed(void);
 void mouse_clear_events(void);
 
+int  mouse_set_rate(int hz);          /* 10, 20, 40, 60, 80, 100, 200; -1 otherwise */
+int  mouse_set_resolution(int cpmm);  /* 1, 2, 4, 8 counts/mm; -1 otherwise */
+int  mouse_rate(void);
+int  mouse_resolution(void);
+int  mouse_has_wheel(void);           /* IntelliMouse: 4-byte packets */
+uint32_t mouse_packets(void);         /* complete packets decoded */
+
 #endif
@@ -53,4 +53,14 @@ typedef struct multiboot_info {
     uint8_t color_info[6];
 } __attribute__((packed)) multiboot_info_t;
 
+#define MULTIBOOT_MEMORY_AVAILABLE 1
+
+/* mmap entries are variable-sized: the next one starts size + 4 bytes on */
+typedef struct multiboot_mmap_entry {
+    uint32_t size;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t type;
+} __attribute__((packed)) multiboot_mmap_entry_t;
+
 #endif
@@ -0,0 +1,65 @@
+/* ============================================================
+ * SwanOS — Packet Buffer Pool
+ * Page-backed DMA buffers for the NIC drivers, two per frame.
+ * ============================================================ */
+
+#include "netbuf.h"
+#include "memory.h"
+#include "spinlock.h"
+
+#define PER_PAGE (PAGE_SIZE / NETBUF_SIZE)
+
+static netbuf_t  bufs[NETBUF_COUNT];
+static netbuf_t *free_list = 0;
+static int       free_count = 0;
+static spinlock_t pool_lock = SPINLOCK_INIT;   /* tasks and the net bottom half */
+
+int netbuf_init(void) {
+    if (free_count) return 0;
+    for (int i = 0; i < NETBUF_COUNT; i += PER_PAGE) {
+        uint8_t *page = (uint8_t *)pmm_alloc_page_flags(PMM_UNINIT);
+        if (!page) return -1;
+        for (int j = 0; j < PER_PAGE && i + j < NETBUF_COUNT; j++) {
+            netbuf_t *b = &bufs[i + j];
+            b->head = page + j * NETBUF_SIZE;
+            netbuf_free(b);
+        }
+    }
+    return 0;
+}
+
+netbuf_t *netbuf_alloc(void) {
+    uint32_t flags = spin_lock_irqsave(&pool_lock);
+    netbuf_t *b = free_list;
+    if (b) {
+        free_list = b->next;
+        free_count--;
+    }
+    spin_unlock_irqrestore(&pool_lock, flags);
+    if (b) {
+        b->next = 0;
+        b->data = b->head + NETBUF_HEADROOM;
+        b->len = 0;
+    }
+    return b;
+}
+
+void netbuf_free(netbuf_t *b) {
+    if (!b) return;
+    uint32_t flags = spin_lock_irqsave(&pool_lock);
+    b->next = free_list;
+    free_list = b;
+    free_count++;
+    spin_unlock_irqrestore(&pool_lock, flags);
+}
+
+int netbuf_available(void) {
+    return free_count;
+}
+
+uint8_t *netbuf_push(netbuf_t *b, int n) {
+    if (b->data - b->head < n) return 0;
+    b->data -= n;
+    b->len += (uint16_t)n;
+    return b->data;
+}
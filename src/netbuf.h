@@ -0,0 +1,34 @@
+#ifndef NETBUF_H
+#define NETBUF_H
+
+#include <stdint.h>
+
+/* ── Packet buffers ───────────────────────────────────────────
+ * A fixed pool of frame-sized buffers that NICs DMA into and out
+ * of directly: a received frame is handed up in the buffer the
+ * device wrote, and a buffer passed to net_send is the one the
+ * device reads. Buffers never cross a page, and kernel memory is
+ * identity mapped, so a buffer's address is also its bus address.
+ *
+ * Allocated buffers start NETBUF_HEADROOM in, so protocol layers
+ * can prepend headers with netbuf_push without copying.           */
+#define NETBUF_SIZE     2048    /* whole buffer; RX descriptors take all of it */
+#define NETBUF_COUNT    256
+#define NETBUF_HEADROOM 128
+
+typedef struct netbuf {
+    struct netbuf *next;        /* free list and queue link */
+    uint8_t  *head;             /* buffer start */
+    uint8_t  *data;             /* frame start, between head and head + NETBUF_SIZE */
+    uint16_t  len;              /* frame bytes from data */
+} netbuf_t;
+
+int       netbuf_init(void);    /* -1 if the pool cannot be allocated */
+netbuf_t *netbuf_alloc(void);   /* 0 when the pool is empty */
+void      netbuf_free(netbuf_t *b);
+int       netbuf_available(void);
+
+/* Grow the frame at the front, n bytes of headroom; 0 if none left */
+uint8_t  *netbuf_push(netbuf_t *b, int n);
+
+#endif
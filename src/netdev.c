@@ -0,0 +1,141 @@
+/* ============================================================
+ * SwanOS — Network Device Layer
+ * The registered NIC, its bottom half and the send/receive
+ * queues the protocol stack uses.
+ * ============================================================ */
+
+#include "netdev.h"
+#include "softirq.h"
+#include "spinlock.h"
+#include "ports.h"
+#include "timer.h"
+#include "cpu.h"
+#include "string.h"
+
+static netdev_t *dev = 0;
+static net_stats_t stats;
+
+/* Received frames, oldest first */
+static netbuf_t *rxq_head = 0, *rxq_tail = 0;
+static int rxq_len = 0;
+static spinlock_t rxq_lock = SPINLOCK_INIT;
+static wait_queue_t rxq_wait;
+
+static void net_bh(void) {
+    if (!dev) return;
+    stats.polls++;
+    if (dev->poll(dev)) softirq_raise(SOFTIRQ_NET);     /* let input run between passes */
+}
+
+int netdev_register(netdev_t *d) {
+    if (dev) return -1;
+    memset(&stats, 0, sizeof(stats));
+    dev = d;
+    softirq_register(SOFTIRQ_NET, net_bh);
+    return 0;
+}
+
+void netdev_schedule(netdev_t *d) {
+    (void)d;
+    stats.irqs++;
+    softirq_raise(SOFTIRQ_NET);
+}
+
+void netdev_irq_enable(uint8_t irq) {
+    if (irq >= 8) {
+        outb(0xA1, inb(0xA1) & ~(1 << (irq - 8)));
+        outb(0x21, inb(0x21) & ~(1 << 2));     /* cascade */
+    } else {
+        outb(0x21, inb(0x21) & ~(1 << irq));
+    }
+}
+
+void netdev_rx(netdev_t *d, netbuf_t *b) {
+    (void)d;
+    uint32_t flags = spin_lock_irqsave(&rxq_lock);
+    int keep = rxq_len < NET_RXQ_MAX;
+    if (keep) {
+        b->next = 0;
+        if (rxq_tail) rxq_tail->next = b;
+        else rxq_head = b;
+        rxq_tail = b;
+        rxq_len++;
+        stats.rx_packets++;
+        stats.rx_bytes += b->len;
+    } else {
+        stats.rx_dropped++;
+    }
+    spin_unlock_irqrestore(&rxq_lock, flags);
+    if (keep) {
+        wake_up(&rxq_wait);
+        softirq_raise(SOFTIRQ_INET);
+    } else {
+        netbuf_free(b);
+    }
+}
+
+void netdev_rx_drop(netdev_t *d) {
+    (void)d;
+    stats.rx_dropped++;
+}
+
+/* ── Stack side ───────────────────────────────────────────── */
+
+netdev_t *netdev_get(void) {
+    return dev;
+}
+
+int net_send(netbuf_t *b) {
+    if (!dev || !dev->link_up || b->len > NET_FRAME_MAX) {
+        netbuf_free(b);
+        return -1;
+    }
+    uint16_t len = b->len;
+    if (dev->xmit(dev, b) < 0) {
+        stats.tx_full++;
+        netbuf_free(b);
+        return -1;
+    }
+    stats.tx_packets++;
+    stats.tx_bytes += len;
+    return 0;
+}
+
+netbuf_t *net_recv(void) {
+    uint32_t flags = spin_lock_irqsave(&rxq_lock);
+    netbuf_t *b = rxq_head;
+    if (b) {
+        rxq_head = b->next;
+        if (!rxq_head) rxq_tail = 0;
+        rxq_len--;
+        b->next = 0;
+    }
+    spin_unlock_irqrestore(&rxq_lock, flags);
+    return b;
+}
+
+netbuf_t *net_recv_wait(uint32_t ticks) {
+    uint32_t start = timer_get_ticks();
+    for (;;) {
+        softirq_run();
+        netbuf_t *b = net_recv();
+        if (b) return b;
+        uint32_t waited = timer_get_ticks() - start;
+        if (ticks && waited >= ticks) return 0;
+
+        uint32_t flags = irq_save();
+        if (!rxq_head) {
+            if (ticks) sleep_on_timeout(&rxq_wait, ticks - waited);
+            else sleep_on(&rxq_wait);
+        }
+        irq_restore(flags);
+    }
+}
+
+wait_queue_t *net_rx_queue(void) {
+    return &rxq_wait;
+}
+
+void net_get_stats(net_stats_t *out) {
+    *out = stats;
+}
@@ -0,0 +1,63 @@
+#ifndef NETDEV_H
+#define NETDEV_H
+
+#include <stdint.h>
+#include "netbuf.h"
+#include "wait.h"
+
+/* ── Network devices ──────────────────────────────────────────
+ * A NIC driver fills a netdev_t and registers it. Its IRQ handler
+ * only acknowledges the device, masks further interrupts and calls
+ * netdev_schedule; the net bottom half then calls the driver's
+ * poll, which harvests received frames into the receive queue
+ * (netdev_rx), reclaims sent buffers and unmasks the device once
+ * its rings are drained. Under load the device stays masked and is
+ * serviced once per bottom-half pass instead of once per frame.
+ *
+ * Frames move by reference throughout: a sent buffer belongs to
+ * the stack until net_send, then to the driver until the device
+ * has read it; a received one belongs to the reader of net_recv,
+ * who frees it.                                                    */
+#define NET_RXQ_MAX   64        /* frames waiting for a reader */
+#define NET_MTU       1500
+#define NET_FRAME_MAX 1518      /* Ethernet header + MTU + FCS room */
+#define NET_POLL_BUDGET 64      /* frames per bottom-half pass */
+
+typedef struct netdev {
+    const char *name;
+    uint8_t  mac[6];
+    int      link_up;
+    int      speed;             /* Mbps, 0 = unknown */
+    uint8_t  irq;
+
+    /* Queue one frame; 0, or -1 with the buffer still the caller's
+     * when the TX ring is full */
+    int  (*xmit)(struct netdev *dev, netbuf_t *b);
+    /* Bottom half: at most NET_POLL_BUDGET frames; nonzero if more
+     * are waiting, and the device stays masked for another pass */
+    int  (*poll)(struct netdev *dev);
+    void *priv;
+} netdev_t;
+
+typedef struct {
+    uint32_t rx_packets, rx_bytes, rx_dropped;  /* dropped: queue full or no buffer */
+    uint32_t tx_packets, tx_bytes, tx_full;
+    uint32_t irqs, polls;
+} net_stats_t;
+
+/* ── Driver side ──────────────────────────────────────────── */
+int  netdev_register(netdev_t *dev);    /* one device; -1 if taken */
+void netdev_schedule(netdev_t *dev);    /* from the IRQ handler */
+void netdev_rx(netdev_t *dev, netbuf_t *b);
+void netdev_rx_drop(netdev_t *dev);     /* frame lost: no buffer to swap in */
+void netdev_irq_enable(uint8_t irq);    /* unmask the PIC line */
+
+/* ── Stack side ───────────────────────────────────────────── */
+netdev_t *netdev_get(void);             /* 0 = no NIC driven */
+int       net_send(netbuf_t *b);        /* takes the buffer; -1 and frees it on failure */
+netbuf_t *net_recv(void);               /* next frame, or 0 */
+netbuf_t *net_recv_wait(uint32_t ticks);/* sleeps up to ticks (0 = forever) */
+wait_queue_t *net_rx_queue(void);
+void      net_get_stats(net_stats_t *out);
+
+#endif
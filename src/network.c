@@ -1,61 +1,57 @@
 /* ============================================================
  * SwanOS — Network Module
- * PCI bus scanning for NIC detection + simulated connection state.
+ * NIC detection from the PCI registry; e1000 and virtio-net get a
+ * real driver (netdev.h), the address settings are still simulated.
  * Provides status info for the Network Settings UI.
  * ============================================================ */
 
 #include "network.h"
-#include "ports.h"
+#include "pci.h"
 #include "string.h"
 #include "serial.h"
-
-/* ── PCI Configuration Space I/O ──────────────────────────── */
-#define PCI_CONFIG_ADDR  0xCF8
-#define PCI_CONFIG_DATA  0xCFC
-
-static inline void outl(uint16_t port, uint32_t val) {
-    __asm__ volatile ("outl %0, %1" : : "a"(val), "Nd"(port));
-}
-
-static inline uint32_t inl(uint16_t port) {
-    uint32_t ret;
-    __asm__ volatile ("inl %1, %0" : "=a"(ret) : "Nd"(port));
-    return ret;
-}
-
-uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
-    uint32_t address = (uint32_t)((bus << 16) | (slot << 11) |
-                       (func << 8) | (offset & 0xFC) | 0x80000000);
-    outl(PCI_CONFIG_ADDR, address);
-    return inl(PCI_CONFIG_DATA);
-}
+#include "netdev.h"
+#include "e1000.h"
+#include "virtio_net.h"
 
 /* ── Known NIC identifiers ────────────────────────────────── */
+typedef int (*nic_probe_t)(const pci_device_t *dev);
+
 typedef struct {
     uint16_t vendor;
     uint16_t device;
     const char *name;
     int speed;
+    nic_probe_t probe;          /* 0 = detected only */
 } known_nic_t;
 
 static const known_nic_t known_nics[] = {
-    { 0x8086, 0x100E, "Intel e1000",         1000 },  /* QEMU default */
-    { 0x8086, 0x100F, "Intel e1000",         1000 },
-    { 0x8086, 0x10D3, "Intel 82574L",        1000 },
-    { 0x8086, 0x153A, "Intel I217-LM",       1000 },
-    { 0x8086, 0x15A3, "Intel I219-LM",       1000 },
-    { 0x1AF4, 0x1000, "VirtIO Net",          1000 },  /* VirtIO legacy */
-    { 0x1AF4, 0x1041, "VirtIO Net 1.0",      1000 },  /* VirtIO modern */
-    { 0x10EC, 0x8139, "Realtek RTL8139",      100 },  /* Common in VMs */
-    { 0x10EC, 0x8168, "Realtek RTL8168",     1000 },
-    { 0x1022, 0x2000, "AMD PCnet-PCI",        100 },  /* VirtualBox */
-    { 0x14E4, 0x1677, "Broadcom NetXtreme",  1000 },
-    { 0, 0, NULL, 0 }
+    { 0x8086, 0x100E, "Intel e1000",         1000, e1000_probe },  /* QEMU default */
+    { 0x8086, 0x100F, "Intel e1000",         1000, e1000_probe },
+    { 0x8086, 0x10D3, "Intel 82574L",        1000, 0 },
+    { 0x8086, 0x153A, "Intel I217-LM",       1000, 0 },
+    { 0x8086, 0x15A3, "Intel I219-LM",       1000, 0 },
+    { 0x1AF4, 0x1000, "VirtIO Net",          1000, virtio_net_probe },  /* VirtIO legacy */
+    { 0x1AF4, 0x1041, "VirtIO Net 1.0",      1000, 0 },  /* VirtIO modern */
+    { 0x10EC, 0x8139, "Realtek RTL8139",      100, 0 },  /* Common in VMs */
+    { 0x10EC, 0x8168, "Realtek RTL8168",     1000, 0 },
+    { 0x1022, 0x2000, "AMD PCnet-PCI",        100, 0 },  /* VirtualBox */
+    { 0x14E4, 0x1677, "Broadcom NetXtreme",  1000, 0 },
+    { 0, 0, NULL, 0, 0 }
 };
 
 /* ── Module state ─────────────────────────────────────────── */
 static net_status_t net_state;
 
+static void format_mac(char *out, const uint8_t *mac) {
+    static const char hex[] = "0123456789abcdef";
+    for (int i = 0; i < 6; i++) {
+        *out++ = hex[mac[i] >> 4];
+        *out++ = hex[mac[i] & 15];
+        if (i < 5) *out++ = ':';
+    }
+    *out = '\0';
+}
+
 void net_init(void) {
     memset(&net_state, 0, sizeof(net_state));
     strcpy(net_state.net_type, "Ethernet");
@@ -68,40 +64,41 @@ void net_init(void) {
     net_state.connected = 0;
     net_state.link_speed = 0;
 
-    /* Scan PCI bus 0 for known NICs */
-    serial_write("net_init: scanning PCI bus...\n");
-    for (int bus = 0; bus < 2; bus++) {
-        for (int slot = 0; slot < 32; slot++) {
-            for (int func = 0; func < 8; func++) {
-                uint32_t reg0 = pci_config_read(bus, slot, func, 0);
-                uint16_t vendor = reg0 & 0xFFFF;
-                uint16_t device = (reg0 >> 16) & 0xFFFF;
-
-                if (vendor == 0xFFFF) continue; /* No device */
-
-                /* Check against known NICs */
-                for (int k = 0; known_nics[k].name != NULL; k++) {
-                    if (vendor == known_nics[k].vendor && device == known_nics[k].device) {
-                        net_state.detected = 1;
-                        net_state.vendor_id = vendor;
-                        net_state.device_id = device;
-                        net_state.link_speed = known_nics[k].speed;
-                        strcpy(net_state.nic_name, known_nics[k].name);
-
-                        /* Set simulated network parameters */
-                        net_state.connected = 1;
-                        strcpy(net_state.ip_addr, "10.0.2.15");
-                        strcpy(net_state.mac_addr, "52:54:00:12:34:56");
-                        strcpy(net_state.gateway, "10.0.2.2");
-                        strcpy(net_state.dns, "10.0.2.3");
-
-                        serial_write("net_init: found NIC: ");
-                        serial_write(known_nics[k].name);
-                        serial_write("\n");
-                        return; /* Found a NIC, done scanning */
-                    }
-                }
+    /* First known NIC in the PCI registry */
+    for (const pci_device_t *p = pci_find_class(PCI_CLASS_NETWORK, PCI_ANY, 0); p;
+         p = pci_find_class(PCI_CLASS_NETWORK, PCI_ANY, p)) {
+        for (int k = 0; known_nics[k].name != NULL; k++) {
+            if (p->vendor != known_nics[k].vendor || p->device != known_nics[k].device) continue;
+
+            net_state.detected = 1;
+            net_state.vendor_id = p->vendor;
+            net_state.device_id = p->device;
+            net_state.link_speed = known_nics[k].speed;
+            strcpy(net_state.nic_name, known_nics[k].name);
+
+            /* Set simulated network parameters */
+            net_state.connected = 1;
+            strcpy(net_state.ip_addr, "10.0.2.15");
+            strcpy(net_state.mac_addr, "52:54:00:12:34:56");
+            strcpy(net_state.gateway, "10.0.2.2");
+            strcpy(net_state.dns, "10.0.2.3");
+
+            serial_write("net_init: found NIC: ");
+            serial_write(known_nics[k].name);
+            serial_write("\n");
+
+            /* A driven NIC reports its own address and link */
+            nic_probe_t probe = known_nics[k].probe;
+            if (probe && probe(p) == 0) {
+                netdev_t *dev = netdev_get();
+                format_mac(net_state.mac_addr, dev->mac);
+                net_state.driven = 1;
+                if (dev->speed) net_state.link_speed = dev->speed;
+                serial_write("net_init: driver up, MAC ");
+                serial_write(net_state.mac_addr);
+                serial_write("\n");
             }
+            return;
         }
     }
     serial_write("net_init: no NIC found\n");
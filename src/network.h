@@ -15,14 +15,12 @@ typedef struct {
     char     net_type[16];     /* "Ethernet" */
     uint16_t vendor_id;
     uint16_t device_id;
-    int      link_speed;       /* Mbps (simulated) */
+    int      link_speed;       /* Mbps (the driver's, or simulated) */
+    int      driven;           /* 1 if a driver runs the NIC (netdev.h) */
 } net_status_t;
 
-/* ── PCI helpers ──────────────────────────────────────────── */
-uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset);
-
 /* ── Network API ──────────────────────────────────────────── */
-void           net_init(void);
+void           net_init(void);         /* after pci_init */
 net_status_t  *net_get_status(void);
 void           net_toggle_connection(void);
 const char    *net_status_str(void);
@@ -5,25 +5,166 @@
 #include "idt.h"
 #include "kernel_ai.h"
 #include "process.h"
+#include "cpu.h"
+#include "vga_gfx.h"
+#include "trace.h"
 
 page_directory_t *kernel_dir = 0;
-page_directory_t *current_dir = 0;
+DEFINE_PER_CPU(page_directory_t *, cpu_dir);
 
 extern void load_page_directory(uint32_t*);
 extern void enable_paging(void);
 
-void paging_map_page(page_directory_t *dir, uint32_t phys, uint32_t virt, uint32_t flags) {
+static int pse_enabled = 0;
+static int pat_enabled = 0;
+static int pge_enabled = 0;
+
+static inline void invlpg(uint32_t virt) {
+    __asm__ volatile("invlpg (%0)" : : "r"(virt) : "memory");
+}
+
+/* PAGE_WC is a software bit; with PAT it selects PAT entry 1 (PWT=1),
+ * which pat_init reprograms from write-through to write-combining. */
+static inline uint32_t cache_flags(uint32_t flags) {
+    if (flags & PAGE_WC) {
+        flags &= ~PAGE_WC;
+        if (pat_enabled) flags |= PAGE_PWT;
+    }
+    return flags;
+}
+
+/* Variable MTRR written by mtrr_set_wc, replayed on every AP */
+static int      wc_mtrr = -1;
+static uint64_t wc_mtrr_base, wc_mtrr_mask;
+
+static void pat_program(void) {
+    uint64_t pat = rdmsr(MSR_PAT);
+    pat &= ~((uint64_t)0xFF << 8);
+    pat |= (uint64_t)0x01 << 8;          /* PA1 = WC */
+    wrmsr(MSR_PAT, pat);
+    __asm__ volatile("wbinvd" ::: "memory");
+}
+
+static void pat_init(void) {
+    if (!(cpuid_edx(1) & CPUID_EDX_PAT)) return;
+    pat_program();
+    pat_enabled = 1;
+}
+
+static void mtrr_write(int i, uint64_t base, uint64_t mask) {
+    __asm__ volatile("wbinvd" ::: "memory");
+    wrmsr(MSR_MTRR_PHYSBASE0 + 2 * i, base);
+    wrmsr(MSR_MTRR_PHYSBASE0 + 2 * i + 1, mask);
+    __asm__ volatile("wbinvd" ::: "memory");
+}
+
+/* Without PAT, cover the framebuffer with a write-combining variable MTRR. */
+static void mtrr_set_wc(uint32_t base, uint32_t size) {
+    if (!(cpuid_edx(1) & CPUID_EDX_MTRR) || size == 0) return;
+
+    uint32_t pow2 = 4096;
+    while (pow2 < size) pow2 <<= 1;
+    base &= ~(pow2 - 1);
+
+    uint32_t vcnt = (uint32_t)rdmsr(MSR_MTRR_CAP) & 0xFF;
+    for (uint32_t i = 0; i < vcnt; i++) {
+        uint32_t mask_msr = MSR_MTRR_PHYSBASE0 + 2 * i + 1;
+        if (rdmsr(mask_msr) & (1 << 11)) continue;  /* in use */
+        uint64_t mask = (~(uint64_t)(pow2 - 1)) & 0xFFFFFF000ULL;  /* 36-bit */
+        wc_mtrr = (int)i;
+        wc_mtrr_base = base | 0x01;                 /* type WC */
+        wc_mtrr_mask = mask | (1 << 11);
+        mtrr_write(wc_mtrr, wc_mtrr_base, wc_mtrr_mask);
+        return;
+    }
+}
+
+/* PAT and MTRRs are per CPU: an AP must agree with the BSP on the
+ * framebuffer's memory type before it draws into it. The trampoline
+ * loaded kernel_dir. */
+void paging_ap_init(void) {
+    this_cpu(cpu_dir) = kernel_dir;
+    if (pat_enabled) pat_program();
+    else if (wc_mtrr >= 0) mtrr_write(wc_mtrr, wc_mtrr_base, wc_mtrr_mask);
+}
+
+int paging_map_page(page_directory_t *dir, uint32_t phys, uint32_t virt, uint32_t flags) {
     uint32_t pd_idx = virt >> 22;
     uint32_t pt_idx = (virt >> 12) & 0x03FF;
+    uint32_t pde = dir->entries[pd_idx];
 
-    if (!(dir->entries[pd_idx] & PAGE_PRESENT)) {
+    if (!(pde & PAGE_PRESENT)) {
         uint32_t pt_phys = (uint32_t)pmm_alloc_page();
-        if (!pt_phys) return; /* Out of memory */
+        if (!pt_phys) return -1; /* Out of memory */
         dir->entries[pd_idx] = pt_phys | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+    } else if (pde & PAGE_LARGE) {
+        /* Split the 4 MB page into a private table of 4 KB pages */
+        page_table_t *pt = (page_table_t *)pmm_alloc_page_flags(PMM_UNINIT);
+        if (!pt) return -1;
+        uint32_t base = pde & 0xFFC00000;
+        uint32_t pte_flags = pde & (PAGE_RW | PAGE_USER | PAGE_PWT | PAGE_PCD);
+        for (int i = 0; i < 1024; i++) {
+            pt->entries[i] = (base + i * 4096) | pte_flags | PAGE_PRESENT;
+        }
+        dir->entries[pd_idx] = (uint32_t)pt | PAGE_PRESENT | PAGE_RW | PAGE_USER;
+    } else if (dir != kernel_dir && kernel_dir && pde == kernel_dir->entries[pd_idx]) {
+        /* Table shared with the kernel: edit a private copy instead */
+        page_table_t *pt = (page_table_t *)pmm_alloc_page_flags(PMM_UNINIT);
+        if (!pt) return -1;
+        memcpy(pt, (void *)(pde & ~0xFFF), PAGE_SIZE);
+        dir->entries[pd_idx] = (uint32_t)pt | (pde & 0xFFF);
     }
 
     page_table_t *pt = (page_table_t *)(dir->entries[pd_idx] & ~0xFFF);
-    pt->entries[pt_idx] = phys | flags | PAGE_PRESENT;
+    pt->entries[pt_idx] = phys | cache_flags(flags) | PAGE_PRESENT;
+    /* Other directories are flushed by their next CR3 load. invlpg also
+     * drops a 4 MB entry, so a split above needs nothing more. */
+    if (dir == current_dir) invlpg(virt);
+    return 0;
+}
+
+uint32_t paging_get_pte(page_directory_t *dir, uint32_t virt) {
+    uint32_t pde = dir->entries[virt >> 22];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) return 0;
+    return ((page_table_t *)(pde & ~0xFFF))->entries[(virt >> 12) & 0x3FF];
+}
+
+uint32_t paging_unmap_page(page_directory_t *dir, uint32_t virt) {
+    uint32_t pde = dir->entries[virt >> 22];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) return 0;
+    if (dir != kernel_dir && kernel_dir && pde == kernel_dir->entries[virt >> 22])
+        return 0;   /* shared kernel table: not ours to edit */
+
+    uint32_t *pte = &((page_table_t *)(pde & ~0xFFF))->entries[(virt >> 12) & 0x3FF];
+    if (!(*pte & PAGE_PRESENT)) return 0;
+    uint32_t frame = *pte & ~0xFFF;
+    *pte = 0;
+    if (dir == current_dir) invlpg(virt);
+    return frame;
+}
+
+/* Map one 4 MB page; falls back to 4 KB pages when PSE is unavailable.
+ * phys and virt must be 4 MB aligned. */
+void paging_map_large(page_directory_t *dir, uint32_t phys, uint32_t virt, uint32_t flags) {
+    if (!pse_enabled) {
+        for (uint32_t off = 0; off < LARGE_PAGE_SIZE; off += 4096) {
+            paging_map_page(dir, phys + off, virt + off, flags);
+        }
+        return;
+    }
+    dir->entries[virt >> 22] = (phys & 0xFFC00000) | cache_flags(flags) | PAGE_LARGE | PAGE_PRESENT;
+}
+
+/* Device registers sit in the identity-mapped high window with the
+ * RAM cache type; PCD|PWT selects PAT entry 3 (UC) either way */
+void paging_map_mmio(uint32_t phys, uint32_t size) {
+    uint32_t first = phys & 0xFFC00000;
+    uint32_t last = (phys + size - 1) & 0xFFC00000;
+    for (uint32_t addr = first; ; addr += LARGE_PAGE_SIZE) {
+        paging_map_large(kernel_dir, addr, addr, PAGE_RW | PAGE_PCD | PAGE_PWT);
+        for (uint32_t off = 0; off < LARGE_PAGE_SIZE; off += 4096) invlpg(addr + off);
+        if (addr == last) break;
+    }
 }
 
 page_directory_t *paging_create_dir(void) {
@@ -33,16 +174,45 @@ page_directory_t *paging_create_dir(void) {
 }
 
 void paging_switch_dir(page_directory_t *dir) {
-    current_dir = dir;
+    uint32_t flags = local_irq_save();
+    this_cpu(cpu_dir) = dir;
     load_page_directory(dir->entries);
+    local_irq_restore(flags);
 }
 
-extern process_t *current_process;
-extern int yield_requested;
+/* Write to a PAGE_COW page: take a private copy, or just reclaim
+ * write access once nobody else holds the frame. Returns 1 if the
+ * fault was resolved. */
+static int cow_fault(uint32_t addr) {
+    uint32_t pde = current_dir->entries[addr >> 22];
+    if (!(pde & PAGE_PRESENT) || (pde & PAGE_LARGE)) return 0;
+    page_table_t *pt = (page_table_t *)(pde & ~0xFFF);
+    uint32_t *pte = &pt->entries[(addr >> 12) & 0x3FF];
+    if ((*pte & (PAGE_PRESENT | PAGE_COW)) != (PAGE_PRESENT | PAGE_COW)) return 0;
+
+    uint32_t frame = *pte & ~0xFFF;
+    uint32_t flags = (*pte & 0xFFF & ~PAGE_COW) | PAGE_RW;
+    if (pmm_page_refs((void *)frame)) {
+        void *copy = pmm_alloc_page_flags(PMM_UNINIT);
+        if (!copy) return 0;
+        memcpy(copy, (void *)frame, PAGE_SIZE);
+        pmm_free_page((void *)frame);      /* drop our share */
+        frame = (uint32_t)copy;
+    }
+    *pte = frame | flags;
+    invlpg(addr);
+    return 1;
+}
 
 void page_fault_handler(registers_t *regs) {
     uint32_t faulting_address;
     __asm__ volatile("mov %%cr2, %0" : "=r" (faulting_address));
+    TRACE(TR_PAGE_FAULT, faulting_address, regs->err_code);
+
+    /* Present + write: maybe a copy-on-write page */
+    if ((regs->err_code & 0x3) == 0x3 && cow_fault(faulting_address)) return;
+    /* Not present: maybe an untouched demand-zero page (BSS, stack) */
+    if (!(regs->err_code & 0x1) && process_demand_fault(faulting_address)) return;
 
     screen_set_color(4, 0); /* Red on black */
     screen_print("\nEXCEPTION: Page Fault in Process [PID ");
@@ -69,34 +239,132 @@ void page_fault_handler(registers_t *regs) {
     }
 }
 
+/* A PDE this directory owns (not one inherited from kernel_dir) */
+static int private_table(page_directory_t *dir, int i) {
+    uint32_t pde = dir->entries[i];
+    return (pde & PAGE_PRESENT) && !(pde & PAGE_LARGE) && pde != kernel_dir->entries[i];
+}
+
 page_directory_t *paging_clone_dir(page_directory_t *src) {
     page_directory_t *dir = paging_create_dir();
     if (!dir) return 0;
+
     for (int i = 0; i < 1024; i++) {
-        dir->entries[i] = src->entries[i];
+        if (!private_table(src, i)) {
+            dir->entries[i] = src->entries[i];
+            continue;
+        }
+        page_table_t *spt = (page_table_t *)(src->entries[i] & ~0xFFF);
+        page_table_t *pt = (page_table_t *)pmm_alloc_page_flags(PMM_UNINIT);
+        if (!pt) { paging_free_dir(dir); return 0; }
+
+        for (int j = 0; j < 1024; j++) {
+            uint32_t pte = spt->entries[j];
+            if ((pte & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) {
+                pt->entries[j] = pte;          /* kernel page or empty */
+                continue;
+            }
+            uint32_t frame = pte & ~0xFFF;
+            if (pmm_ref_page((void *)frame) < 0) {
+                /* Share count saturated: fall back to an eager copy */
+                void *copy = pmm_alloc_page_flags(PMM_UNINIT);
+                if (!copy) { pt->entries[j] = 0; continue; }
+                memcpy(copy, (void *)frame, PAGE_SIZE);
+                pt->entries[j] = (uint32_t)copy | (pte & 0xFFF);
+                continue;
+            }
+            if (pte & (PAGE_RW | PAGE_COW)) {
+                pte = (pte & ~PAGE_RW) | PAGE_COW;
+                spt->entries[j] = pte;
+            }
+            pt->entries[j] = pte;
+        }
+        dir->entries[i] = (uint32_t)pt | (src->entries[i] & 0xFFF);
     }
+
+    /* The parent just lost write access to its user pages */
+    if (src == current_dir) paging_switch_dir(src);
     return dir;
 }
 
+void paging_free_dir(page_directory_t *dir) {
+    if (!dir || dir == kernel_dir) return;
+    for (int i = 0; i < 1024; i++) {
+        if (!private_table(dir, i)) continue;
+        page_table_t *pt = (page_table_t *)(dir->entries[i] & ~0xFFF);
+        for (int j = 0; j < 1024; j++) {
+            uint32_t pte = pt->entries[j];
+            if ((pte & (PAGE_PRESENT | PAGE_USER)) == (PAGE_PRESENT | PAGE_USER))
+                pmm_free_page((void *)(pte & ~0xFFF));   /* drops one share */
+        }
+        pmm_free_page(pt);
+    }
+    pmm_free_page(dir);
+}
+
+/* The PMM stops below the user window, so identity-mapped RAM never
+ * aliases a user page */
+_Static_assert(PMM_PHYS_LIMIT <= USER_CODE_BASE, "RAM identity map overlaps the user window");
+
+/* PAGE_GLOBAL for a kernel 4 MB page, unless a user directory may
+ * remap it: a global TLB entry there would outlive the switch into
+ * that process. */
+static uint32_t kernel_global(uint32_t addr) {
+    if (!pge_enabled) return 0;
+    if (addr + LARGE_PAGE_SIZE > USER_CODE_BASE && addr < USER_STACK_TOP) return 0;
+    return PAGE_GLOBAL;
+}
+
 void paging_init(void) {
     kernel_dir = paging_create_dir();
     
-    /* Identity map the first 128 MB */
-    for (uint32_t i = 0; i < 32768; i++) {
-        uint32_t addr = i * 4096;
-        uint32_t flags = PAGE_RW; /* Only kernel access */
-        paging_map_page(kernel_dir, addr, addr, flags);
+    if (cpuid_edx(1) & CPUID_EDX_PSE) {
+        uint32_t cr4;
+        __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+        __asm__ volatile("mov %0, %%cr4" : : "r"(cr4 | 0x10)); /* CR4.PSE */
+        pse_enabled = 1;
     }
-    
+    pat_init();
+    pge_enabled = (cpuid_edx(1) & CPUID_EDX_PGE) != 0;
+
+    /* Identity map all usable RAM (at least the first 128 MB) in 4 MB pages */
+    uint32_t ram_top = mem_phys_top();
+    if (ram_top < 0x8000000) ram_top = 0x8000000;
+    for (uint32_t addr = 0; addr < ram_top; addr += LARGE_PAGE_SIZE) {
+        paging_map_large(kernel_dir, addr, addr, PAGE_RW | kernel_global(addr)); /* Only kernel access */
+    }
+
     /* Identity Map VESA Framebuffer (Assuming it could be up to FD000000, Map top memory)
        We will map from 0xC0000000 to 0xFFFFFFFF just to be safe and cover any high VRAM */
-    for (uint32_t i = 0xC0000; i < 0x100000; i++) {
-        uint32_t addr = i * 4096;
-        paging_map_page(kernel_dir, addr, addr, PAGE_RW);
+    for (uint32_t addr = 0xC0000000; addr != 0; addr += LARGE_PAGE_SIZE) {
+        paging_map_large(kernel_dir, addr, addr, PAGE_RW | kernel_global(addr));
     }
-    
+
+    /* Remap the linear framebuffer itself write-combining */
+    uint32_t fb = vga_framebuffer_phys();
+    uint32_t fb_size = vga_framebuffer_size();
+    uint32_t fb_end = fb + fb_size;
+    for (uint32_t addr = fb & 0xFFC00000; addr < fb_end && addr >= (fb & 0xFFC00000); addr += LARGE_PAGE_SIZE) {
+        paging_map_large(kernel_dir, addr, addr, PAGE_RW | PAGE_WC | kernel_global(addr));
+    }
+    if (!pat_enabled) mtrr_set_wc(fb, fb_size);
+
     register_interrupt_handler(14, page_fault_handler);
 
     paging_switch_dir(kernel_dir);
     enable_paging();
+
+    /* CR0.WP: ring 0 honours read-only PTEs too, so kernel copies into
+     * user buffers fault on COW pages instead of writing through */
+    uint32_t cr0;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    __asm__ volatile("mov %0, %%cr0" : : "r"(cr0 | 0x10000));
+
+    /* CR4.PGE: global kernel translations survive the CR3 reload in
+     * every context switch (set after CR0.PG, as the SDM asks) */
+    if (pge_enabled) {
+        uint32_t cr4;
+        __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+        __asm__ volatile("mov %0, %%cr4" : : "r"(cr4 | 0x80));
+    }
 }
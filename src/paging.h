@@ -3,10 +3,20 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include "cpu.h"
+#include "percpu.h"
 
 #define PAGE_PRESENT  0x01
 #define PAGE_RW       0x02
 #define PAGE_USER     0x04
+#define PAGE_PWT      0x08
+#define PAGE_PCD      0x10
+#define PAGE_LARGE    0x80   /* PDE maps a 4 MB page (needs CR4.PSE) */
+#define PAGE_GLOBAL   0x100  /* kept in the TLB across CR3 loads (needs CR4.PGE) */
+#define PAGE_WC       0x200  /* software bit: map write-combining (PAT) */
+#define PAGE_COW      0x400  /* software bit (PTE): shared read-only, copy on write */
+
+#define LARGE_PAGE_SIZE 0x400000
 
 typedef struct {
     uint32_t entries[1024];
@@ -16,10 +26,37 @@ typedef struct {
     uint32_t entries[1024];
 } page_directory_t;
 
+/* Directory loaded in this CPU's CR3. Read with IRQs off: a process
+   preempted between reading the CPU id and the slot could resume on
+   another CPU. */
+DECLARE_PER_CPU(page_directory_t *, cpu_dir);
+
+static inline page_directory_t *paging_current_dir(void) {
+    uint32_t flags = local_irq_save();
+    page_directory_t *dir = this_cpu(cpu_dir);
+    local_irq_restore(flags);
+    return dir;
+}
+#define current_dir paging_current_dir()
+
 void paging_init(void);
 page_directory_t *paging_create_dir(void);
 void paging_switch_dir(page_directory_t *dir);
-void paging_map_page(page_directory_t *dir, uint32_t phys, uint32_t virt, uint32_t flags);
+int  paging_map_page(page_directory_t *dir, uint32_t phys, uint32_t virt, uint32_t flags); /* -1 = no page table */
+/* Clear one 4 KB mapping; returns its frame (0 = nothing mapped).
+   Both invalidate just that page when dir is the live directory. */
+uint32_t paging_unmap_page(page_directory_t *dir, uint32_t virt);
+uint32_t paging_get_pte(page_directory_t *dir, uint32_t virt);   /* 0 = unmapped */
+void paging_map_large(page_directory_t *dir, uint32_t phys, uint32_t virt, uint32_t flags);
+/* Address space copy: kernel page tables are shared, user pages are
+   shared copy-on-write (both sides become read-only + PAGE_COW). */
 page_directory_t *paging_clone_dir(page_directory_t *src);
+/* Make [phys, phys+size) uncached in the kernel directory (device
+   registers); remaps the whole 4 MB pages that cover it */
+void paging_map_mmio(uint32_t phys, uint32_t size);
+/* Application processors: per-CPU cache-type setup matching the BSP */
+void paging_ap_init(void);
+/* Drop a cloned directory, its private page tables and user pages */
+void paging_free_dir(page_directory_t *dir);
 
 #endif
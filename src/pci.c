@@ -0,0 +1,193 @@
+/* ============================================================
+ * SwanOS — PCI Bus
+ * Boot-time enumeration through configuration mechanism #1 and
+ * the device registry that drivers probe from.
+ * ============================================================ */
+
+#include "pci.h"
+#include "ports.h"
+#include "string.h"
+
+#define PCI_CONFIG_ADDR  0xCF8
+#define PCI_CONFIG_DATA  0xCFC
+
+#define PCI_HEADER_MULTI 0x80
+#define PCI_SUBCLASS_P2P 0x04
+
+static pci_device_t devices[PCI_MAX_DEVICES];
+static int device_count = 0;
+static int bus_count = 0;
+static uint8_t bus_seen[256 / 8];
+
+/* ── Config space I/O ─────────────────────────────────────── */
+
+uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset) {
+    uint32_t address = (uint32_t)((bus << 16) | (slot << 11) |
+                       (func << 8) | (offset & 0xFC) | 0x80000000);
+    outl(PCI_CONFIG_ADDR, address);
+    return inl(PCI_CONFIG_DATA);
+}
+
+void pci_config_write(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint32_t val) {
+    uint32_t address = (uint32_t)((bus << 16) | (slot << 11) |
+                       (func << 8) | (offset & 0xFC) | 0x80000000);
+    outl(PCI_CONFIG_ADDR, address);
+    outl(PCI_CONFIG_DATA, val);
+}
+
+/* ── Enumeration ──────────────────────────────────────────── */
+
+/* Size each BAR by writing all ones and reading the mask back, with
+ * decoding off meanwhile so the probe value never claims addresses */
+static void read_bars(pci_device_t *d, int nbars) {
+    uint32_t cmd = pci_config_read(d->bus, d->slot, d->func, PCI_COMMAND) & 0xFFFF;
+    pci_config_write(d->bus, d->slot, d->func, PCI_COMMAND, cmd & ~(uint32_t)(PCI_CMD_IO | PCI_CMD_MEMORY));
+
+    for (int i = 0; i < nbars; i++) {
+        uint8_t off = (uint8_t)(PCI_BAR0 + i * 4);
+        uint32_t orig = pci_config_read(d->bus, d->slot, d->func, off);
+        pci_config_write(d->bus, d->slot, d->func, off, 0xFFFFFFFF);
+        uint32_t mask = pci_config_read(d->bus, d->slot, d->func, off);
+        pci_config_write(d->bus, d->slot, d->func, off, orig);
+        if (!mask) continue;
+
+        if (orig & 1) {
+            d->bar_io |= (uint8_t)(1 << i);
+            d->bar[i] = orig & ~3u;
+            d->bar_size[i] = (~(mask & ~3u) + 1) & 0xFFFF;
+        } else {
+            d->bar[i] = orig & ~0xFu;
+            d->bar_size[i] = ~(mask & ~0xFu) + 1;
+            if (((orig >> 1) & 3) == 2 && i + 1 < nbars) {
+                d->bar_64 |= (uint8_t)(1 << i);
+                i++;            /* the high half; above 4 GB is out of reach anyway */
+            }
+        }
+    }
+    pci_config_write(d->bus, d->slot, d->func, PCI_COMMAND, cmd);
+}
+
+static void scan_bus(uint8_t bus);
+
+static void add_function(uint8_t bus, uint8_t slot, uint8_t func, uint32_t id) {
+    uint32_t class_reg = pci_config_read(bus, slot, func, 0x08);
+    uint32_t hdr_reg = pci_config_read(bus, slot, func, 0x0C);
+    uint8_t header = (uint8_t)((hdr_reg >> 16) & 0x7F);
+    uint8_t class_code = (uint8_t)(class_reg >> 24);
+    uint8_t subclass = (uint8_t)(class_reg >> 16);
+
+    if (device_count < PCI_MAX_DEVICES) {
+        pci_device_t *d = &devices[device_count++];
+        memset(d, 0, sizeof(*d));
+        d->bus = bus;
+        d->slot = slot;
+        d->func = func;
+        d->header = header;
+        d->vendor = (uint16_t)id;
+        d->device = (uint16_t)(id >> 16);
+        d->class_code = class_code;
+        d->subclass = subclass;
+        d->prog_if = (uint8_t)(class_reg >> 8);
+        d->revision = (uint8_t)class_reg;
+        uint32_t intr = pci_config_read(bus, slot, func, PCI_INTERRUPT);
+        d->irq = (uint8_t)intr;
+        d->irq_pin = (uint8_t)(intr >> 8);
+        if (header == 0) read_bars(d, 6);
+        else if (header == 1) read_bars(d, 2);
+    }
+
+    /* Follow PCI-to-PCI bridges to the bus behind them */
+    if (class_code == PCI_CLASS_BRIDGE && subclass == PCI_SUBCLASS_P2P && header == 1) {
+        uint8_t secondary = (uint8_t)(pci_config_read(bus, slot, func, 0x18) >> 8);
+        if (secondary) scan_bus(secondary);
+    }
+}
+
+static void scan_slot(uint8_t bus, uint8_t slot) {
+    uint32_t id = pci_config_read(bus, slot, 0, 0);
+    if ((id & 0xFFFF) == 0xFFFF) return;
+    add_function(bus, slot, 0, id);
+
+    uint32_t hdr = pci_config_read(bus, slot, 0, 0x0C);
+    if (!((hdr >> 16) & PCI_HEADER_MULTI)) return;
+    for (uint8_t func = 1; func < 8; func++) {
+        id = pci_config_read(bus, slot, func, 0);
+        if ((id & 0xFFFF) != 0xFFFF) add_function(bus, slot, func, id);
+    }
+}
+
+static void scan_bus(uint8_t bus) {
+    if (bus_seen[bus >> 3] & (1 << (bus & 7))) return;     /* misrouted bridges */
+    bus_seen[bus >> 3] |= (uint8_t)(1 << (bus & 7));
+    bus_count++;
+    for (uint8_t slot = 0; slot < 32; slot++) scan_slot(bus, slot);
+}
+
+void pci_init(void) {
+    device_count = 0;
+    bus_count = 0;
+    memset(bus_seen, 0, sizeof(bus_seen));
+
+    /* A multi-function host bridge means one host controller, and
+     * one root bus, per function */
+    uint32_t hdr = pci_config_read(0, 0, 0, 0x0C);
+    if ((hdr >> 16) & PCI_HEADER_MULTI) {
+        for (uint8_t func = 0; func < 8; func++)
+            if ((pci_config_read(0, 0, func, 0) & 0xFFFF) != 0xFFFF) scan_bus(func);
+    } else {
+        scan_bus(0);
+    }
+}
+
+/* ── Registry ─────────────────────────────────────────────── */
+
+int pci_count(void) {
+    return device_count;
+}
+
+int pci_bus_count(void) {
+    return bus_count;
+}
+
+const pci_device_t *pci_get(int index) {
+    return index >= 0 && index < device_count ? &devices[index] : 0;
+}
+
+static int first_after(const pci_device_t *from) {
+    return from ? (int)(from - devices) + 1 : 0;
+}
+
+const pci_device_t *pci_find(uint16_t vendor, uint16_t device, const pci_device_t *from) {
+    for (int i = first_after(from); i < device_count; i++) {
+        const pci_device_t *d = &devices[i];
+        if ((vendor == PCI_ANY || d->vendor == vendor) && (device == PCI_ANY || d->device == device))
+            return d;
+    }
+    return 0;
+}
+
+const pci_device_t *pci_find_class(uint16_t class_code, uint16_t subclass, const pci_device_t *from) {
+    for (int i = first_after(from); i < device_count; i++) {
+        const pci_device_t *d = &devices[i];
+        if ((class_code == PCI_ANY || d->class_code == class_code) &&
+            (subclass == PCI_ANY || d->subclass == subclass))
+            return d;
+    }
+    return 0;
+}
+
+/* The upper half is the status register, whose bits clear when
+ * written as ones: write it back as zero */
+void pci_enable(const pci_device_t *d, uint16_t bits) {
+    uint32_t cmd = pci_config_read(d->bus, d->slot, d->func, PCI_COMMAND);
+    pci_config_write(d->bus, d->slot, d->func, PCI_COMMAND, (cmd & 0xFFFF) | bits);
+}
+
+const char *pci_class_name(uint8_t class_code) {
+    static const char *names[] = {
+        "Unclassified", "Storage", "Network", "Display", "Multimedia",
+        "Memory", "Bridge", "Communication", "System", "Input",
+        "Docking", "Processor", "Serial bus", "Wireless"
+    };
+    return class_code < sizeof(names) / sizeof(names[0]) ? names[class_code] : "Other";
+}
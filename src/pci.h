@@ -0,0 +1,58 @@
+#ifndef PCI_H
+#define PCI_H
+
+#include <stdint.h>
+
+/* ── PCI device registry ──────────────────────────────────────
+ * pci_init walks the bus tree once at boot: bus 0, then the
+ * secondary bus behind every PCI-to-PCI bridge, probing functions
+ * 1-7 only on multi-function devices. Each function found is
+ * cached with its class, IRQ and decoded BARs, and drivers look
+ * devices up here instead of scanning config space themselves.  */
+#define PCI_MAX_DEVICES 64
+#define PCI_BARS        6
+
+/* Config space offsets and command bits */
+#define PCI_COMMAND       0x04
+#define PCI_CMD_IO        0x0001
+#define PCI_CMD_MEMORY    0x0002
+#define PCI_CMD_MASTER    0x0004  /* device may DMA */
+#define PCI_BAR0          0x10
+#define PCI_INTERRUPT     0x3C    /* low byte: legacy IRQ line */
+
+#define PCI_CLASS_NETWORK 0x02
+#define PCI_CLASS_BRIDGE  0x06
+#define PCI_ANY           0xFFFF  /* wildcard for pci_find */
+
+typedef struct {
+    uint8_t  bus, slot, func;
+    uint8_t  header;            /* type, multi-function bit cleared */
+    uint16_t vendor, device;
+    uint8_t  class_code, subclass, prog_if, revision;
+    uint8_t  irq;               /* legacy line, 0xFF = none */
+    uint8_t  irq_pin;           /* 1-4 = INTA-INTD, 0 = none */
+    uint8_t  bar_io;            /* bit n: BAR n is an I/O port range */
+    uint8_t  bar_64;            /* bit n: BAR n is the low half of a 64-bit BAR */
+    uint32_t bar[PCI_BARS];     /* base address, flag bits stripped */
+    uint32_t bar_size[PCI_BARS];/* 0 = unimplemented */
+} pci_device_t;
+
+void pci_init(void);
+int  pci_count(void);
+int  pci_bus_count(void);       /* buses that were walked */
+const pci_device_t *pci_get(int index);
+
+/* Next device after `from` (0 = from the start) matching the IDs or
+ * class; PCI_ANY matches everything. 0 when there are no more. */
+const pci_device_t *pci_find(uint16_t vendor, uint16_t device, const pci_device_t *from);
+const pci_device_t *pci_find_class(uint16_t class_code, uint16_t subclass, const pci_device_t *from);
+
+/* Set command register bits (PCI_CMD_*) */
+void pci_enable(const pci_device_t *d, uint16_t bits);
+const char *pci_class_name(uint8_t class_code);
+
+/* ── Raw config space ─────────────────────────────────────── */
+uint32_t pci_config_read(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset);
+void     pci_config_write(uint8_t bus, uint8_t slot, uint8_t func, uint8_t offset, uint32_t val);
+
+#endif
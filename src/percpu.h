@@ -0,0 +1,30 @@
+#ifndef PERCPU_H
+#define PERCPU_H
+
+#include "smp.h"
+
+/* ── Per-CPU variables ────────────────────────────────────────
+ * One copy per CPU, each on its own cache line so neighbouring
+ * CPUs never false-share:
+ *
+ *     PER_CPU_STATIC(uint32_t, hits);         (file scope)
+ *     this_cpu(hits)++;
+ *     total += per_cpu(hits, cpu);
+ *
+ * For a variable shared between files, DECLARE_PER_CPU in the
+ * header and DEFINE_PER_CPU in one .c file. this_cpu is only
+ * stable while the caller cannot migrate (IRQs off, or holding a
+ * spinlock).                                                    */
+#define CACHE_LINE 64
+
+#define PER_CPU_SLOT(type, name) \
+    struct percpu_##name { type val; } __attribute__((aligned(CACHE_LINE)))
+
+#define PER_CPU_STATIC(type, name)  static PER_CPU_SLOT(type, name) name[SMP_MAX_CPUS]
+#define DECLARE_PER_CPU(type, name) extern PER_CPU_SLOT(type, name) name[SMP_MAX_CPUS]
+#define DEFINE_PER_CPU(type, name)  struct percpu_##name name[SMP_MAX_CPUS]
+
+#define per_cpu(name, cpu)  ((name)[cpu].val)
+#define this_cpu(name)      per_cpu(name, smp_cpu_id())
+
+#endif
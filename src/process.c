@@ -1,7 +1,9 @@
 /* ============================================================
  * SwanOS — Dynamic Process Manager with Priority Scheduling
- * Priority-based round-robin, per-process CPU accounting,
- * and AI-assisted scheduling hint support.
+ * Multi-level feedback queue (O(1) pick-next over per-level run
+ * queues, one set per CPU with work stealing), per-process CPU
+ * accounting, and AI-assisted
+ * scheduling hint support.
  * ============================================================ */
 
 #include "process.h"
@@ -13,15 +15,62 @@
 #include "screen.h"
 #include "fs.h"
 #include "timer.h"
+#include "cpu.h"
+#include "smp.h"
+#include "percpu.h"
+#include "spinlock.h"
+#include "trace.h"
 
-extern page_directory_t *current_dir;
-int yield_requested = 0;
+extern page_directory_t *kernel_dir;
 
 static process_t processes[MAX_PROCESSES];
-process_t *current_process = 0;
 static uint32_t next_pid = 1;
 int process_scheduling_enabled = 0;
 static uint32_t total_context_switches = 0;
+static uint32_t total_steals = 0;
+
+DEFINE_PER_CPU(process_t *, cpu_current);
+DEFINE_PER_CPU(int, cpu_yield);
+
+/* An AP's boot thread, as its idle context: never queued, and what
+ * the AP runs when there is nothing else. The BSP has idle_main. */
+static process_t ap_idle[SMP_MAX_CPUS];
+PER_CPU_STATIC(process_t *, cpu_idle);
+
+/* Process this CPU switched away from, until it is off its stack */
+PER_CPU_STATIC(process_t *, cpu_prev);
+
+/* ── Run queues ──────────────────────────────────────────────
+ * One set per CPU: a FIFO per level and a bitmap of the non-empty
+ * ones, so picking the next process is a bit scan rather than a walk
+ * over every slot. The running process is never queued: it goes back
+ * on the tail of its level when it leaves the CPU still runnable. A
+ * process stays on the queue of the CPU it last ran on (p->cpu) until
+ * an idle CPU steals it; woken up, it moves to an idle CPU if its own
+ * is busy. Idle-level processes stay where they are (idle_main is the
+ * BSP's). */
+typedef struct {
+    process_t *head[PRIORITY_LEVELS], *tail[PRIORITY_LEVELS];
+    uint32_t   bitmap;
+    uint32_t   nr;              /* processes queued */
+} runq_t;
+
+PER_CPU_STATIC(runq_t, runqs);
+
+/* Scheduler lock: serialises the run queues, run levels, slot
+ * allocation and CPU accounting. As a seqlock it also lets
+ * process_get_overview take a consistent snapshot without ever
+ * holding up the switch path. */
+static seqlock_t sched_lock = SEQLOCK_INIT;
+
+/* spin_lock() depth per CPU; switch_context defers while nonzero */
+PER_CPU_STATIC(uint32_t, preempt_count);
+
+/* pid & (PID_TABLE_SIZE-1) -> slot index + 1 (0 = empty) */
+static uint8_t pid_slot[PID_TABLE_SIZE];
+
+static void sleep_expired(void *arg);
+static void ipc_drain(process_t *p);
 
 /* Priority → time slice mapping */
 static uint8_t priority_to_slice(uint8_t priority) {
@@ -64,16 +113,185 @@ void general_protection_fault_handler(registers_t *regs) {
     }
 }
 
+static void runq_push(process_t *p) {
+    if (p->queued) return;
+    runq_t *rq = &per_cpu(runqs, p->cpu);
+    int l = p->level;
+    p->rq_next = 0;
+    p->rq_prev = rq->tail[l];
+    if (rq->tail[l]) rq->tail[l]->rq_next = p;
+    else rq->head[l] = p;
+    rq->tail[l] = p;
+    p->queued = 1;
+    rq->bitmap |= 1u << l;
+    rq->nr++;
+}
+
+static void runq_remove(process_t *p) {
+    if (!p->queued) return;
+    runq_t *rq = &per_cpu(runqs, p->cpu);
+    int l = p->level;
+    if (p->rq_prev) p->rq_prev->rq_next = p->rq_next;
+    else rq->head[l] = p->rq_next;
+    if (p->rq_next) p->rq_next->rq_prev = p->rq_prev;
+    else rq->tail[l] = p->rq_prev;
+    p->rq_next = p->rq_prev = 0;
+    p->queued = 0;
+    if (!rq->head[l]) rq->bitmap &= ~(1u << l);
+    rq->nr--;
+}
+
+/* Head of the highest non-empty level from min_level up; anything
+ * that died while queued is dropped on the way. */
+static process_t *runq_pop(int cpu, int min_level) {
+    runq_t *rq = &per_cpu(runqs, cpu);
+    uint32_t mask = ~0u << min_level;
+    while (rq->bitmap & mask) {
+        process_t *p = rq->head[31 - __builtin_clz(rq->bitmap & mask)];
+        runq_remove(p);
+        if (p->state == PROC_STATE_READY || p->state == PROC_STATE_RUNNING) return p;
+    }
+    return 0;
+}
+
+/* Own queue first; when it has nothing above idle level, take the
+ * most urgent process from the busiest other CPU. Idle-level work
+ * is never stolen: it is what a CPU runs when it has nothing else. */
+static process_t *pick_next(int cpu) {
+    process_t *p = runq_pop(cpu, PRIORITY_LOW);
+    while (!p) {
+        int victim = -1;
+        uint32_t most = 0;
+        for (int i = 0; i < smp_cpu_count(); i++) {
+            runq_t *rq = &per_cpu(runqs, i);
+            if (i != cpu && (rq->bitmap >> PRIORITY_LOW) && rq->nr > most) {
+                most = rq->nr;
+                victim = i;
+            }
+        }
+        if (victim < 0) break;
+        p = runq_pop(victim, PRIORITY_LOW);
+        if (p) { p->cpu = (uint8_t)cpu; total_steals++; }
+    }
+    return p ? p : runq_pop(cpu, PRIORITY_IDLE);
+}
+
+/* Running nothing but idle work */
+static int cpu_idle_now(int cpu) {
+    process_t *run = per_cpu(cpu_current, cpu);
+    return !run || run == per_cpu(cpu_idle, cpu) || run->priority == PRIORITY_IDLE;
+}
+
+/* Home for a process about to be queued: an idle CPU, else the
+ * shortest queue */
+static uint8_t pick_cpu(void) {
+    int best = 0;
+    uint32_t best_load = ~0u;
+    for (int i = 0; i < smp_cpu_count(); i++) {
+        uint32_t load = per_cpu(runqs, i).nr + !cpu_idle_now(i);
+        if (load < best_load) { best_load = load; best = i; }
+    }
+    return (uint8_t)best;
+}
+
+/* Change run level, moving p between queues if it is waiting */
+static void set_level(process_t *p, uint8_t level) {
+    if (p->level == level) return;
+    int was_queued = p->queued;
+    runq_remove(p);
+    p->level = level;
+    if (was_queued) runq_push(p);
+}
+
+static void make_ready(process_t *p) {
+    uint32_t flags = write_seqlock_irqsave(&sched_lock);
+    p->state = PROC_STATE_READY;
+    if (p->cpu >= smp_cpu_count() ||
+        (!p->queued && p->priority != PRIORITY_IDLE && !cpu_idle_now(p->cpu)))
+        p->cpu = pick_cpu();
+    runq_push(p);
+
+    /* Outranks what its CPU is running: switch at the end of this
+     * interrupt, or have that CPU do so */
+    process_t *run = per_cpu(cpu_current, p->cpu);
+    if (run && (run == per_cpu(cpu_idle, p->cpu) || p->level > run->level)) {
+        if (p->cpu == smp_cpu_id()) yield_requested = 1;
+        else smp_resched(p->cpu);
+    }
+    write_sequnlock_irqrestore(&sched_lock, flags);
+}
+
+/* ── Preemption control (see spinlock.h) ─────────────────── */
+
+/* IRQs off for the increment so the count lands on the CPU it runs on */
+void preempt_disable(void) {
+    uint32_t flags = local_irq_save();
+    this_cpu(preempt_count)++;
+    local_irq_restore(flags);
+}
+
+/* Leaving the outermost section is a preemption point: take a switch
+ * that came due meanwhile, unless the caller has IRQs off */
+void preempt_enable(void) {
+    if (--this_cpu(preempt_count) || !yield_requested || !process_scheduling_enabled) return;
+    uint32_t eflags;
+    __asm__ volatile ("pushf; pop %0" : "=r"(eflags));
+    if (eflags & 0x200) __asm__ volatile ("int $0x80" : : "a"(0) : "memory");
+}
+
+/* ── PID lookup ──────────────────────────────────────────── */
+
+static process_t *bucket_owner(uint32_t b) {
+    uint8_t s = pid_slot[b];
+    if (!s) return 0;
+    process_t *p = &processes[s - 1];
+    if (p->state == PROC_STATE_UNUSED || (p->pid & (PID_TABLE_SIZE - 1)) != b) return 0;
+    return p;
+}
+
+static process_t *find_pid(uint32_t pid) {
+    process_t *p = bucket_owner(pid & (PID_TABLE_SIZE - 1));
+    return (p && p->pid == pid) ? p : 0;
+}
+
+/* Claim a free slot and give it the next pid whose table bucket is
+ * free, so find_pid never probes. The caller marks it non-UNUSED.
+ * Returns 0 when every slot is taken. */
+static process_t *alloc_slot(void) {
+    uint32_t flags = write_seqlock_irqsave(&sched_lock);
+    int i;
+    for (i = 1; i < MAX_PROCESSES; i++) {
+        if (processes[i].state == PROC_STATE_UNUSED && !processes[i].owns_dir) break;
+    }
+    if (i == MAX_PROCESSES) { write_sequnlock_irqrestore(&sched_lock, flags); return 0; }
+
+    process_t *p = &processes[i];
+    runq_remove(p);   /* may still be queued if it died waiting */
+    while (bucket_owner(next_pid & (PID_TABLE_SIZE - 1))) next_pid++;
+    p->pid = next_pid++;
+    pid_slot[p->pid & (PID_TABLE_SIZE - 1)] = (uint8_t)(i + 1);
+    ipc_drain(p);
+    p->mbox_wait.head = 0;
+    p->ipc_next = 0;
+    timer_setup(&p->sleep_timer, sleep_expired, p);
+    write_sequnlock_irqrestore(&sched_lock, flags);
+    return p;
+}
+
 void process_init(void) {
     memset(processes, 0, sizeof(processes));
+    memset(runqs, 0, sizeof(runqs));
+    memset(pid_slot, 0, sizeof(pid_slot));
+    memset(preempt_count, 0, sizeof(preempt_count));
+    total_steals = 0;
     total_context_switches = 0;
     
     process_t *init = &processes[0];
     init->pid = 0;
     init->state = PROC_STATE_RUNNING;
     init->page_directory = current_dir;
-    init->next = init;
     init->priority = PRIORITY_NORMAL;
+    init->level = PRIORITY_NORMAL;
     init->base_slice = priority_to_slice(PRIORITY_NORMAL);
     init->time_slice = init->base_slice;
     init->cpu_ticks = 0;
@@ -81,8 +299,9 @@ void process_init(void) {
     init->last_window_ticks = 0;
     init->create_tick = 0;
     strcpy(init->name, "kernel");
+    pid_slot[0] = 1;
     
-    current_process = init;
+    per_cpu(cpu_current, 0) = init;
     
     register_interrupt_handler(13, general_protection_fault_handler);
 }
@@ -92,24 +311,21 @@ int process_create(void (*entry_point)(void), uint8_t ring) {
 }
 
 int process_create_named(void (*entry_point)(void), uint8_t ring, const char *name, uint8_t priority) {
-    int i;
-    for (i = 1; i < MAX_PROCESSES; i++) {
-        if (processes[i].state == PROC_STATE_UNUSED) break;
-    }
-    if (i == MAX_PROCESSES) return -1;
-    
-    process_t *p = &processes[i];
-    p->pid = next_pid++;
-    p->state = PROC_STATE_READY;
+    if (priority > PRIORITY_HIGH) priority = PRIORITY_HIGH;
+    process_t *p = alloc_slot();
+    if (!p) return -1;
+    p->state = PROC_STATE_READY;     /* claimed; runs once queued */
     
     /* Priority and scheduling */
     p->priority = priority;
+    p->level = priority;
     p->base_slice = priority_to_slice(priority);
     p->time_slice = p->base_slice;
     p->cpu_ticks = 0;
     p->cpu_ticks_window = 0;
     p->last_window_ticks = 0;
     p->create_tick = timer_get_ticks();
+    simd_state_init(p->fpu_state);
     
     /* Name */
     if (name) {
@@ -119,8 +335,8 @@ int process_create_named(void (*entry_point)(void), uint8_t ring, const char *na
         strcpy(p->name, "unnamed");
     }
     
-    uint32_t stack = (uint32_t)pmm_alloc_page();
-    if (!stack) return -1;
+    uint32_t stack = (uint32_t)pmm_alloc_page_flags(PMM_UNINIT);
+    if (!stack) { p->state = PROC_STATE_UNUSED; return -1; }
     p->kernel_stack = stack + 4096;
     
     uint32_t *stk = (uint32_t *)p->kernel_stack;
@@ -150,77 +366,194 @@ int process_create_named(void (*entry_point)(void), uint8_t ring, const char *na
     
     p->esp = (uint32_t)stk;
     p->page_directory = current_dir;
+    p->owns_dir = 0;
+    p->n_regions = 0;
+    p->demand_pages = 0;
     
-    /* Insert into list */
-    p->next = current_process->next;
-    current_process->next = p;
+    make_ready(p);
     
     return p->pid;
 }
 
+/* Nothing queued on any CPU; with aps too, no AP running a process */
+static int sched_quiet(int aps) {
+    for (int i = 0; i < smp_cpu_count(); i++) {
+        if (per_cpu(runqs, i).nr) return 0;
+        if (aps && i && per_cpu(cpu_current, i) != per_cpu(cpu_idle, i)) return 0;
+    }
+    return 1;
+}
+
+/* Idle process (BSP): pre-zeroes pages for pmm_alloc_page, then gives the
+ * CPU straight back so it only soaks up otherwise idle time. With the pool
+ * full and nothing queued it halts until the next interrupt, tickless if
+ * the APs are idle too (their processes need the BSP's timer wheel). */
+static void idle_main(void) {
+    while (1) {
+        if (!pmm_zero_pool_refill(4)) {
+            uint32_t flags = irq_save();
+            if (sched_quiet(0)) {
+                if (sched_quiet(1)) timer_idle_enter();
+                irq_halt();
+            }
+            irq_restore(flags);
+        }
+        __asm__ volatile ("int $0x80" : : "a"(0)); /* yield */
+    }
+}
+
 void process_start_scheduling(void) {
+    /* kernel_main's context was set up before paging existed */
+    if (!processes[0].page_directory) processes[0].page_directory = current_dir;
+    process_create_named(idle_main, 0, "idle", PRIORITY_IDLE);
     process_scheduling_enabled = 1;
 }
 
+/* AP boot thread: from here on switch_context may run processes on it */
+void process_ap_init(uint32_t stack_top) {
+    int cpu = smp_cpu_id();
+    process_t *idle = &ap_idle[cpu];
+    memset(idle, 0, sizeof(*idle));
+    idle->state = PROC_STATE_RUNNING;
+    idle->priority = PRIORITY_IDLE;
+    idle->level = PRIORITY_IDLE;
+    idle->cpu = (uint8_t)cpu;
+    idle->kernel_stack = stack_top;
+    idle->page_directory = kernel_dir;
+    strcpy(idle->name, "idle");
+    simd_state_init(idle->fpu_state);
+    per_cpu(cpu_idle, cpu) = idle;
+    per_cpu(cpu_current, cpu) = idle;
+}
+
 uint32_t switch_context(uint32_t current_esp) {
-    if (!current_process || !process_scheduling_enabled) return current_esp;
+    int cpu = smp_cpu_id();
+    process_t *cur = per_cpu(cpu_current, cpu);
+    if (!cur || !process_scheduling_enabled) return current_esp;
     
     registers_t *regs = (registers_t *)current_esp;
     
-    /* Only switch on timer tick (IRQ0 = INT 32) or explicit yield */
-    if (regs->int_no != 32 && !yield_requested) return current_esp;
-    
-    /* Track CPU usage for current process */
-    current_process->cpu_ticks++;
-    current_process->cpu_ticks_window++;
+    /* Only switch on a timer tick (IRQ0 = INT 32, or an AP's local APIC
+     * timer) or explicit yield */
+    int tick = regs->int_no == 32 || regs->int_no == SMP_TIMER_VECTOR;
+    if (!tick && !per_cpu(cpu_yield, cpu)) return current_esp;
+
+    /* Inside a spin_lock section: switch once it is left */
+    if (per_cpu(preempt_count, cpu)) {
+        per_cpu(cpu_yield, cpu) = 1;
+        return current_esp;
+    }
+
+    /* An AP serves a posted smp_call before it takes on any process */
+    process_t *idle = per_cpu(cpu_idle, cpu);
+    if (cur == idle && !smp_leave_idle()) return current_esp;
+
+    uint32_t flags = write_seqlock_irqsave(&sched_lock);
+    runq_t *rq = &per_cpu(runqs, cpu);
     
-    /* Priority-based scheduling: check if time slice is exhausted */
-    if (!yield_requested) {
-        if (current_process->time_slice > 0) {
-            current_process->time_slice--;
-            if (current_process->time_slice > 0) {
-                /* Still has time — don't switch */
-                return current_esp;
+    if (cur != idle) {
+        /* Track CPU usage for current process */
+        cur->cpu_ticks++;
+        cur->cpu_ticks_window++;
+
+        /* MLFQ demotion: this window's allotment is used up */
+        if (cur->level > PRIORITY_LOW &&
+            cur->cpu_ticks_window > (uint32_t)cur->base_slice * MLFQ_ALLOT_SLICES)
+            cur->level--;
+        
+        /* Priority-based scheduling: check if time slice is exhausted,
+         * unless a higher level has become runnable */
+        if (!per_cpu(cpu_yield, cpu) && !(rq->bitmap >> (cur->level + 1))) {
+            if (cur->time_slice > 0) {
+                cur->time_slice--;
+                if (cur->time_slice > 0) {
+                    /* Still has time — don't switch */
+                    write_sequnlock_irqrestore(&sched_lock, flags);
+                    return current_esp;
+                }
             }
         }
     }
     
-    yield_requested = 0;
+    per_cpu(cpu_yield, cpu) = 0;
     
-    current_process->esp = current_esp;
+    cur->esp = current_esp;
+    simd_state_save(cur->fpu_state);
     
     /* Reset time slice for outgoing process */
-    current_process->time_slice = current_process->base_slice;
+    cur->time_slice = cur->base_slice;
     
-    /* Priority-aware round-robin: find next runnable process */
-    process_t *start = current_process;
-    do {
-        current_process = current_process->next;
-    } while (current_process->state != PROC_STATE_RUNNING && 
-             current_process->state != PROC_STATE_READY &&
-             current_process != start);
+    /* Requeue the outgoing process and take the best waiting one */
+    if (cur != idle && (cur->state == PROC_STATE_RUNNING || cur->state == PROC_STATE_READY)) {
+        cur->state = PROC_STATE_READY;
+        runq_push(cur);
+    }
+    process_t *next = pick_next(cpu);
+    if (!next) next = idle ? idle : cur;   /* nothing else to run */
+    if (next != cur) {
+        TRACE(TR_SWITCH, cur->pid, next->pid);
+        cur->leaving = 1;
+        per_cpu(cpu_prev, cpu) = cur;
+    }
     
-    current_process->state = PROC_STATE_RUNNING;
+    next->state = PROC_STATE_RUNNING;
+    next->cpu = (uint8_t)cpu;
+    per_cpu(cpu_current, cpu) = next;
     total_context_switches++;
+    write_sequnlock_irqrestore(&sched_lock, flags);
+
+    /* Hand over the IRQ lock levels: the outgoing side keeps its own
+     * (it may have slept inside an irq_save section) for when it runs
+     * again, and the incoming side takes back its own. Wait first for
+     * a CPU that switched away from next to be off its stack. */
+    if (next != cur) {
+        cur->irq_depth = irq_lock_drop();
+        while (next->leaving) __asm__ volatile ("pause");
+        irq_lock_take(next->irq_depth);
+        next->irq_depth = 0;
+    }
     
-    tss_set_kernel_stack(current_process->kernel_stack);
+    tss_set_kernel_stack(next->kernel_stack);
     
-    if (current_dir != current_process->page_directory) {
-        paging_switch_dir(current_process->page_directory);
+    /* A private dir may have been edited on another CPU (invlpg is
+     * local), so reload it even when this CPU still has it in CR3 */
+    if (current_dir != next->page_directory || (next != cur && next->owns_dir)) {
+        paging_switch_dir(next->page_directory);
     }
+    simd_state_restore(next->fpu_state);
+
+    /* A process that died is off CR3 now: release its address space
+     * (its kernel stack is the one we are still running on) */
+    if (cur->state == PROC_STATE_UNUSED && cur->owns_dir && cur != next) {
+        paging_free_dir(cur->page_directory);
+        cur->page_directory = 0;
+        cur->owns_dir = 0;
+    }
+
+    /* Back on the idle loop: smp_call may claim this CPU from here */
+    if (next == idle) smp_enter_idle();
     
-    return current_process->esp;
+    return next->esp;
+}
+
+void switch_finish(void) {
+    int cpu = smp_cpu_id();
+    process_t *prev = per_cpu(cpu_prev, cpu);
+    if (!prev) return;
+    per_cpu(cpu_prev, cpu) = 0;
+    __atomic_store_n(&prev->leaving, 0, __ATOMIC_RELEASE);
 }
 
 void process_set_priority(uint32_t pid, uint8_t priority) {
     if (priority > PRIORITY_HIGH) priority = PRIORITY_HIGH;
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (processes[i].state != PROC_STATE_UNUSED && processes[i].pid == pid) {
-            processes[i].priority = priority;
-            processes[i].base_slice = priority_to_slice(priority);
-            return;
-        }
+    uint32_t flags = write_seqlock_irqsave(&sched_lock);
+    process_t *p = find_pid(pid);
+    if (p) {
+        p->priority = priority;
+        p->base_slice = priority_to_slice(priority);
+        set_level(p, priority);
     }
+    write_sequnlock_irqrestore(&sched_lock, flags);
 }
 
 int process_count_active(void) {
@@ -231,113 +564,344 @@ int process_count_active(void) {
     return count;
 }
 
+/* Also the MLFQ priority boost: demoted processes get their level back */
 void process_cpu_window_reset(void) {
+    uint32_t flags = write_seqlock_irqsave(&sched_lock);
     for (int i = 0; i < MAX_PROCESSES; i++) {
         if (processes[i].state != PROC_STATE_UNUSED) {
             processes[i].last_window_ticks = processes[i].cpu_ticks_window;
             processes[i].cpu_ticks_window = 0;
+            set_level(&processes[i], processes[i].priority);
         }
     }
+    write_sequnlock_irqrestore(&sched_lock, flags);
 }
 
+/* Lock-free snapshot: retried if the scheduler changed anything
+ * while it was being taken */
 void process_get_overview(process_overview_t *out) {
     if (!out) return;
-    memset(out, 0, sizeof(process_overview_t));
-    
-    uint32_t total_window = 0;
-    int count = 0;
-    
-    /* First pass: count total window ticks */
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (processes[i].state != PROC_STATE_UNUSED) {
-            total_window += processes[i].last_window_ticks;
+    uint32_t now = timer_get_ticks(), freq = timer_get_frequency();
+    uint32_t seq;
+    do {
+        seq = read_seqbegin(&sched_lock);
+        memset(out, 0, sizeof(process_overview_t));
+        
+        uint32_t total_window = 0;
+        int count = 0;
+        
+        /* First pass: count total window ticks */
+        for (int i = 0; i < MAX_PROCESSES; i++) {
+            if (processes[i].state != PROC_STATE_UNUSED) {
+                total_window += processes[i].last_window_ticks;
+            }
         }
-    }
-    if (total_window == 0) total_window = 1; /* Avoid div by zero */
-    
-    /* Second pass: fill stats */
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (processes[i].state != PROC_STATE_UNUSED) {
-            process_stats_t *s = &out->procs[count];
-            s->pid = processes[i].pid;
-            strncpy(s->name, processes[i].name, 15);
-            s->name[15] = '\0';
-            s->state = processes[i].state;
-            s->priority = processes[i].priority;
-            s->cpu_ticks = processes[i].cpu_ticks;
-            s->cpu_percent = (processes[i].last_window_ticks * 100) / total_window;
-            
-            uint32_t alive_ticks = timer_get_ticks() - processes[i].create_tick;
-            s->uptime_secs = alive_ticks / timer_get_frequency();
-            
-            out->total_cpu_ticks += processes[i].cpu_ticks;
-            count++;
+        if (total_window == 0) total_window = 1; /* Avoid div by zero */
+        
+        /* Second pass: fill stats */
+        for (int i = 0; i < MAX_PROCESSES; i++) {
+            if (processes[i].state != PROC_STATE_UNUSED) {
+                process_stats_t *s = &out->procs[count];
+                s->pid = processes[i].pid;
+                strncpy(s->name, processes[i].name, 15);
+                s->name[15] = '\0';
+                s->state = processes[i].state;
+                s->priority = processes[i].priority;
+                s->cpu_ticks = processes[i].cpu_ticks;
+                s->cpu_percent = (processes[i].last_window_ticks * 100) / total_window;
+                
+                uint32_t alive_ticks = now - processes[i].create_tick;
+                s->uptime_secs = alive_ticks / freq;
+                
+                out->total_cpu_ticks += processes[i].cpu_ticks;
+                count++;
+            }
         }
+        out->count = count;
+        out->total_count = count;
+        out->context_switches = total_context_switches;
+        out->steals = total_steals;
+    } while (read_seqretry(&sched_lock, seq));
+}
+
+/* ── IPC ─────────────────────────────────────────────────── */
+
+#define IPC_MASK (IPC_QUEUE_LEN - 1)
+
+static inline void ipc_barrier(void) {
+    __asm__ volatile ("" ::: "memory");
+}
+
+/* Queue one message; caller has IRQs off and has checked for room */
+static void ipc_post(process_t *p, const void *msg, uint32_t len,
+                     const uint32_t *frames, uint32_t npages) {
+    ipc_msg_t *m = &p->mbox[p->mbox_head & IPC_MASK];
+    m->sender_pid = current_process->pid;
+    m->len = len;
+    if (len) memcpy(m->data, msg, len);
+    m->npages = npages;
+    if (npages) memcpy(m->frames, frames, npages * sizeof(uint32_t));
+    ipc_barrier();            /* the slot is complete before it is published */
+    p->mbox_head++;
+    wake_up(&p->mbox_wait);
+}
+
+/* Drop undelivered messages (slot reuse), freeing any pages they carry */
+static void ipc_drain(process_t *p) {
+    for (; p->mbox_tail != p->mbox_head; p->mbox_tail++) {
+        ipc_msg_t *m = &p->mbox[p->mbox_tail & IPC_MASK];
+        for (uint32_t i = 0; i < m->npages; i++) pmm_free_page((void *)(m->frames[i] & ~0xFFF));
     }
-    out->count = count;
-    out->total_count = count;
-    out->context_switches = total_context_switches;
+    p->mbox_head = p->mbox_tail = 0;
 }
 
 int process_ipc_send(uint32_t dest_pid, void *msg, uint32_t len) {
     if (len > IPC_MAX_MSG_LEN) return -1;
     
-    for (int i = 0; i < MAX_PROCESSES; i++) {
-        if (processes[i].state != PROC_STATE_UNUSED && processes[i].pid == dest_pid) {
-            if (processes[i].has_msg) return -2; /* Mailbox full */
-            
-            processes[i].msg.sender_pid = current_process->pid;
-            processes[i].msg.len = len;
-            memcpy(processes[i].msg.data, msg, len);
-            processes[i].has_msg = 1;
-            
-            if (processes[i].state == PROC_STATE_BLOCKED) {
-                processes[i].state = PROC_STATE_READY;
+    uint32_t flags = irq_save();
+    process_t *p = find_pid(dest_pid);
+    int rc = -1;
+    if (p) {
+        rc = -2; /* Mailbox full */
+        if (p->mbox_head - p->mbox_tail < IPC_QUEUE_LEN) {
+            ipc_post(p, msg, len, 0, 0);
+            rc = 0;
+        }
+    }
+    irq_restore(flags);
+    return rc;
+}
+
+int process_ipc_send_pages(uint32_t dest_pid, void *addr, uint32_t npages, const void *msg, uint32_t len) {
+    uint32_t base = (uint32_t)addr;
+    if (!npages || npages > IPC_MAX_PAGES || (base & 0xFFF) || len > IPC_MAX_MSG_LEN) return -1;
+
+    uint32_t flags = irq_save();
+    process_t *self = current_process;
+    process_t *p = find_pid(dest_pid);
+    if (!p) { irq_restore(flags); return -1; }
+    if (p->mbox_head - p->mbox_tail >= IPC_QUEUE_LEN) { irq_restore(flags); return -2; }
+
+    uint32_t frames[IPC_MAX_PAGES];
+    if (self->owns_dir) {
+        /* Every page must be a present user page before any is taken */
+        for (uint32_t i = 0; i < npages; i++) {
+            uint32_t pte = paging_get_pte(self->page_directory, base + i * 4096);
+            if ((pte & (PAGE_PRESENT | PAGE_USER)) != (PAGE_PRESENT | PAGE_USER)) {
+                irq_restore(flags);
+                return -1;
             }
-            return 0;
+            frames[i] = pte & (PAGE_RW | PAGE_COW);
         }
+        for (uint32_t i = 0; i < npages; i++)
+            frames[i] |= paging_unmap_page(self->page_directory, base + i * 4096);
+    } else {
+        /* Kernel thread: identity-mapped frames it owns */
+        for (uint32_t i = 0; i < npages; i++) frames[i] = (base + i * 4096) | PAGE_RW;
     }
-    return -1;
+    ipc_post(p, msg, len, frames, npages);
+    irq_restore(flags);
+    return 0;
 }
 
-int process_ipc_recv(uint32_t *src_pid, void *msg, uint32_t max_len) {
-    if (!current_process->has_msg) {
+/* Give the receiver the pages of a message. User processes get them
+ * mapped back to back in their IPC window, with the sender's access
+ * (a shared COW frame stays COW). Kernel threads see frames at their
+ * identity address, so only an unshared contiguous run is zero-copy;
+ * anything else is gathered into a fresh run. Returns 0 on failure,
+ * having released the frames. */
+static void *ipc_adopt(process_t *self, const uint32_t *frames, uint32_t n) {
+    if (self->owns_dir) {
+        uint32_t virt = USER_IPC_BASE + self->ipc_next * 4096;
+        uint32_t i = 0;
+        if (self->ipc_next + n <= USER_IPC_SIZE / 4096) {
+            for (; i < n; i++) {
+                uint32_t f = frames[i];
+                if (paging_map_page(self->page_directory, f & ~0xFFF, virt + i * 4096,
+                                    PAGE_USER | (f & (PAGE_RW | PAGE_COW))) < 0) break;
+            }
+        }
+        if (i == n) { self->ipc_next += n; return (void *)virt; }
+        while (i > 0) paging_unmap_page(self->page_directory, virt + --i * 4096);
+        for (i = 0; i < n; i++) pmm_free_page((void *)(frames[i] & ~0xFFF));
+        return 0;
+    }
+
+    uint32_t first = frames[0] & ~0xFFF;
+    int direct = 1;
+    for (uint32_t i = 0; i < n && direct; i++) {
+        uint32_t f = frames[i] & ~0xFFF;
+        if (f != first + i * 4096 || pmm_page_refs((void *)f)) direct = 0;
+    }
+    if (direct) return (void *)first;
+
+    uint8_t *run = (uint8_t *)pmm_alloc_pages(n, PMM_UNINIT);
+    for (uint32_t i = 0; i < n; i++) {
+        void *f = (void *)(frames[i] & ~0xFFF);
+        if (run) memcpy(run + i * 4096, f, 4096);
+        pmm_free_page(f);
+    }
+    return run;
+}
+
+int process_ipc_recv_pages(uint32_t *src_pid, void *msg, uint32_t max_len, void **pages, uint32_t *npages) {
+    process_t *self = current_process;
+    if (self->mbox_tail == self->mbox_head) {
         return -1; /* No message */
     }
+    ipc_barrier();
+    ipc_msg_t *m = &self->mbox[self->mbox_tail & IPC_MASK];
     
-    uint32_t copy_len = current_process->msg.len;
+    uint32_t copy_len = m->len;
     if (copy_len > max_len) copy_len = max_len;
     
-    memcpy(msg, current_process->msg.data, copy_len);
-    if (src_pid) *src_pid = current_process->msg.sender_pid;
+    memcpy(msg, m->data, copy_len);
+    if (src_pid) *src_pid = m->sender_pid;
+
+    /* A caller that doesn't take the pages gets them freed, not
+     * mapped into a window slot it could never find again */
+    void *where = 0;
+    if (m->npages && pages)
+        where = ipc_adopt(self, m->frames, m->npages);
+    else
+        for (uint32_t i = 0; i < m->npages; i++) pmm_free_page((void *)(m->frames[i] & ~0xFFF));
+    if (pages) *pages = where;
+    if (npages) *npages = where ? m->npages : 0;
     
-    current_process->has_msg = 0;
+    ipc_barrier();            /* done with the slot before senders may reuse it */
+    self->mbox_tail++;
     return copy_len;
 }
 
+int process_ipc_recv(uint32_t *src_pid, void *msg, uint32_t max_len) {
+    return process_ipc_recv_pages(src_pid, msg, max_len, 0, 0);
+}
+
+int process_ipc_recv_wait(uint32_t *src_pid, void *msg, uint32_t max_len, uint32_t timeout_ticks) {
+    uint32_t flags = irq_save();
+    uint32_t deadline = timer_get_ticks() + timeout_ticks;
+    while (current_process->mbox_tail == current_process->mbox_head) {
+        uint32_t left = 0;
+        if (timeout_ticks) {
+            left = deadline - timer_get_ticks();
+            if ((int32_t)left <= 0 || !sleep_on_timeout(&current_process->mbox_wait, left)) break;
+        } else {
+            sleep_on(&current_process->mbox_wait);
+        }
+    }
+    int n = process_ipc_recv(src_pid, msg, max_len);
+    irq_restore(flags);
+    return n;
+}
+
+/* ── Wait queues and sleeping ────────────────────────────── */
+/* All of these run with IRQs off. */
+
+static void wake_proc(process_t *p) {
+    if (p->state != PROC_STATE_BLOCKED) return;
+    timer_cancel(&p->sleep_timer);
+    make_ready(p);
+}
+
+/* Sleep timeout (timer wheel callback) */
+static void sleep_expired(void *arg) {
+    process_t *p = (process_t *)arg;
+    p->timed_out = 1;
+    wake_proc(p);
+}
+
+static void wait_unlink(wait_queue_t *q, wait_entry_t *e) {
+    for (wait_entry_t **pp = &q->head; *pp; pp = &(*pp)->next) {
+        if (*pp == e) { *pp = e->next; return; }
+    }
+}
+
+int sleep_on_any(wait_queue_t **qs, int n, uint32_t ticks) {
+    uint32_t flags = irq_save();
+    if (!process_scheduling_enabled || !current_process) {
+        irq_halt();                                 /* boot: wait for any IRQ */
+        irq_restore(flags);
+        return 1;
+    }
+
+    process_t *p = current_process;
+    wait_entry_t ent[WAIT_MAX_QUEUES];
+    if (n > WAIT_MAX_QUEUES) n = WAIT_MAX_QUEUES;
+    for (int i = 0; i < n; i++) {
+        ent[i].proc = p;
+        ent[i].next = qs[i]->head;
+        qs[i]->head = &ent[i];
+    }
+    p->timed_out = 0;
+    if (ticks) timer_arm(&p->sleep_timer, ticks, 0);
+    p->state = PROC_STATE_BLOCKED;
+
+    __asm__ volatile ("int $0x80" : : "a"(0) : "memory");  /* back here once woken */
+
+    timer_cancel(&p->sleep_timer);
+    for (int i = 0; i < n; i++) wait_unlink(qs[i], &ent[i]);
+    irq_restore(flags);
+    return !p->timed_out;
+}
+
+int sleep_on_timeout(wait_queue_t *q, uint32_t ticks) {
+    return sleep_on_any(&q, 1, ticks);
+}
+
+void sleep_on(wait_queue_t *q) {
+    sleep_on_any(&q, 1, 0);
+}
+
+void wake_up(wait_queue_t *q) {
+    uint32_t flags = irq_save();
+    wait_entry_t *e = q->head;
+    q->head = 0;
+    while (e) {
+        wait_entry_t *next = e->next;
+        wake_proc(e->proc);      /* sleeper unlinks its other entries */
+        e = next;
+    }
+    irq_restore(flags);
+}
+
+void process_sleep_ms(uint32_t ms) {
+    uint32_t freq = timer_get_frequency();
+    uint32_t ticks = (ms * freq + 999) / 1000;
+    if (!ticks) ticks = 1;
+    if (!process_scheduling_enabled) {
+        uint32_t end = timer_get_ticks() + ticks;
+        while ((int32_t)(timer_get_ticks() - end) < 0) sleep_on_any(0, 0, 0);
+        return;
+    }
+    sleep_on_any(0, 0, ticks);
+}
+
 extern page_directory_t *kernel_dir;
 
+/* Undo a half-built exec: the slot never ran, so nothing else holds its dir */
+static int exec_fail(process_t *p) {
+    paging_free_dir(p->page_directory);
+    p->page_directory = 0;
+    p->owns_dir = 0;
+    p->state = PROC_STATE_UNUSED;
+    return -1;
+}
+
 int process_exec(const char *filename) {
-    char data[8192]; /* Load up to 8KB for this basic OS */
-    int size = fs_read(filename, data, sizeof(data));
-    if (size <= 0) return -1;
-    
-    int i;
-    for (i = 1; i < MAX_PROCESSES; i++) {
-        if (processes[i].state == PROC_STATE_UNUSED) break;
-    }
-    if (i == MAX_PROCESSES) return -1;
+    if (fs_size(filename) <= 0) return -1;
     
-    process_t *p = &processes[i];
-    p->pid = next_pid++;
-    p->state = PROC_STATE_READY;
+    process_t *p = alloc_slot();
+    if (!p) return -1;
+    p->state = PROC_STATE_READY;     /* claimed; runs once queued */
     p->priority = PRIORITY_NORMAL;
+    p->level = PRIORITY_NORMAL;
     p->base_slice = priority_to_slice(PRIORITY_NORMAL);
     p->time_slice = p->base_slice;
     p->cpu_ticks = 0;
     p->cpu_ticks_window = 0;
     p->last_window_ticks = 0;
     p->create_tick = timer_get_ticks();
+    simd_state_init(p->fpu_state);
     strncpy(p->name, filename, 15);
     p->name[15] = '\0';
     
@@ -346,33 +910,50 @@ int process_exec(const char *filename) {
         p->state = PROC_STATE_UNUSED;
         return -1;
     }
+    p->owns_dir = 1;
     
-    uint32_t virt_start = 0x40000000; /* Map user app at 1 GB */
+    uint32_t virt_start = USER_CODE_BASE; /* Map user app at 1 GB */
     
-    for (int offset = 0; offset < size; offset += 4096) {
-        uint32_t phys = (uint32_t)pmm_alloc_page();
-        if (!phys) { p->state = PROC_STATE_UNUSED; return -1; }
-        int chunk = size - offset;
-        if (chunk > 4096) chunk = 4096;
-        memcpy((void*)phys, data + offset, chunk);
-        paging_map_page(p->page_directory, phys, virt_start + offset, PAGE_USER | PAGE_RW);
+    /* Map the image straight from the file's pages, read-only + COW:
+     * the first write to a page gives the process its own copy. Only
+     * a partial last page is copied, so bytes past EOF read as zero. */
+    fs_view_t view;
+    if (fs_view(filename, &view) < 0) return exec_fail(p);
+    uint32_t virt = virt_start;
+    for (int s = 0; s < view.n_seg; s++) {
+        for (uint32_t off = 0; off < view.seg[s].len; off += 4096, virt += 4096) {
+            uint32_t frame = (uint32_t)view.seg[s].data + off;
+            uint32_t chunk = view.seg[s].len - off;
+            if (chunk >= 4096 && pmm_ref_page((void*)frame) == 0) {
+                paging_map_page(p->page_directory, frame, virt, PAGE_USER | PAGE_COW);
+                continue;
+            }
+            uint32_t phys = (uint32_t)pmm_alloc_page_flags(PMM_UNINIT);
+            if (!phys) { fs_view_release(&view); return exec_fail(p); }
+            if (chunk > 4096) chunk = 4096;
+            memcpy((void*)phys, (void*)frame, chunk);
+            if (chunk < 4096) memset((void*)(phys + chunk), 0, 4096 - chunk);
+            paging_map_page(p->page_directory, phys, virt, PAGE_USER | PAGE_RW);
+        }
     }
+    fs_view_release(&view);
     
-    /* Dedicated user stack at 0xB0000000 */
-    uint32_t virt_stack = 0xB0000000;
-    uint32_t phys_stk = (uint32_t)pmm_alloc_page();
-    if (!phys_stk) { p->state = PROC_STATE_UNUSED; return -1; }
-    paging_map_page(p->page_directory, phys_stk, virt_stack, PAGE_USER | PAGE_RW);
+    /* BSS/heap after the image and the stack below USER_STACK_TOP are
+     * demand-zero: nothing is allocated until the app touches it */
+    p->regions[0] = (vm_region_t){ virt, virt + USER_HEAP_SIZE, PAGE_USER | PAGE_RW };
+    p->regions[1] = (vm_region_t){ USER_STACK_TOP - USER_STACK_MAX, USER_STACK_TOP, PAGE_USER | PAGE_RW };
+    p->n_regions = 2;
+    p->demand_pages = 0;
     
-    uint32_t kernel_stack = (uint32_t)pmm_alloc_page();
-    if (!kernel_stack) { p->state = PROC_STATE_UNUSED; return -1; }
+    uint32_t kernel_stack = (uint32_t)pmm_alloc_page_flags(PMM_UNINIT);
+    if (!kernel_stack) return exec_fail(p);
     p->kernel_stack = kernel_stack + 4096;
     
     uint32_t *stk = (uint32_t *)p->kernel_stack;
     
     /* Hardware pushes for iret to Ring 3 */
     *--stk = 0x23;                   /* User SS */
-    *--stk = virt_stack + 4096 - 4;  /* User ESP */
+    *--stk = USER_STACK_TOP - 4;     /* User ESP */
     *--stk = 0x202;                  /* EFLAGS (IF set) */
     *--stk = 0x1B;                   /* User CS */
     *--stk = virt_start;             /* EIP (Entry point of loaded code) */
@@ -385,8 +966,67 @@ int process_exec(const char *filename) {
     *--stk = 0x23; /* Initial data segment */
     p->esp = (uint32_t)stk;
     
-    p->next = current_process->next;
-    current_process->next = p;
+    make_ready(p);
     
     return p->pid;
 }
+
+int process_demand_fault(uint32_t addr) {
+    process_t *p = current_process;
+    if (!p || !p->owns_dir) return 0;
+    for (int r = 0; r < p->n_regions; r++) {
+        vm_region_t *v = &p->regions[r];
+        if (addr < v->start || addr >= v->end) continue;
+        void *page = pmm_alloc_page();    /* usually from the pre-zeroed pool */
+        if (!page) return 0;
+        if (paging_map_page(p->page_directory, (uint32_t)page, addr & ~0xFFF, v->flags) < 0) {
+            pmm_free_page(page);
+            return 0;
+        }
+        p->demand_pages++;
+        return 1;
+    }
+    return 0;
+}
+
+/* Duplicate the calling user process. The address space is cloned
+ * copy-on-write and the child resumes from a copy of the caller's
+ * trap frame, returning 0 from the syscall. */
+int process_fork(registers_t *regs) {
+    if ((regs->cs & 3) != 3) return -1;   /* kernel threads share one address space */
+
+    process_t *parent = current_process;
+    process_t *p = alloc_slot();
+    if (!p) return -1;
+    p->state = PROC_STATE_READY;     /* claimed; runs once queued */
+    page_directory_t *dir = paging_clone_dir(parent->page_directory);
+    if (!dir) { p->state = PROC_STATE_UNUSED; return -1; }
+    uint32_t stack = (uint32_t)pmm_alloc_page_flags(PMM_UNINIT);
+    if (!stack) { paging_free_dir(dir); p->state = PROC_STATE_UNUSED; return -1; }
+
+    p->priority = parent->priority;
+    p->level = parent->priority;
+    p->base_slice = parent->base_slice;
+    p->time_slice = p->base_slice;
+    p->cpu_ticks = 0;
+    p->cpu_ticks_window = 0;
+    p->last_window_ticks = 0;
+    p->create_tick = timer_get_ticks();
+    p->ipc_next = parent->ipc_next;   /* the window is cloned with the rest */
+    simd_state_save(p->fpu_state);        /* live registers are the parent's */
+    strcpy(p->name, parent->name);
+    p->page_directory = dir;
+    p->owns_dir = 1;
+    memcpy(p->regions, parent->regions, sizeof(p->regions));
+    p->n_regions = parent->n_regions;
+    p->demand_pages = 0;
+
+    p->kernel_stack = stack + 4096;
+    registers_t *frame = (registers_t *)(p->kernel_stack - sizeof(registers_t));
+    memcpy(frame, regs, sizeof(registers_t));
+    frame->eax = 0;
+    p->esp = (uint32_t)frame;
+
+    make_ready(p);
+    return p->pid;
+}
@@ -3,16 +3,32 @@
 
 #include <stdint.h>
 #include "paging.h"
+#include "simd.h"
+#include "idt.h"
+#include "wait.h"
+#include "timer.h"
+#include "percpu.h"
 
 #define MAX_PROCESSES 64
 
 #define IPC_MAX_MSG_LEN 256
+#define IPC_QUEUE_LEN   8      /* messages per mailbox (power of two) */
+#define IPC_MAX_PAGES   16     /* pages moved by one transfer */
 
 /* ── Process Priority Levels ─────────────────────────────── */
 #define PRIORITY_IDLE   0   /* Background — runs when nothing else needs CPU */
 #define PRIORITY_LOW    1   /* Below normal — 1 tick per turn */
 #define PRIORITY_NORMAL 2   /* Default — 2 ticks per turn */
 #define PRIORITY_HIGH   3   /* Realtime — 4 ticks per turn */
+#define PRIORITY_LEVELS 4
+
+/* MLFQ: a process that burns more than MLFQ_ALLOT_SLICES quanta in one
+ * CPU window drops a run level (not below LOW); every window reset
+ * boosts everyone back to their assigned priority. */
+#define MLFQ_ALLOT_SLICES 8
+
+/* PID -> slot lookup (power of two, > MAX_PROCESSES) */
+#define PID_TABLE_SIZE  256
 
 /* ── Process States ──────────────────────────────────────── */
 #define PROC_STATE_UNUSED  0
@@ -20,9 +36,26 @@
 #define PROC_STATE_READY   2
 #define PROC_STATE_BLOCKED 3
 
+/* ── User address space layout ───────────────────────────── */
+#define USER_CODE_BASE   0x40000000
+#define USER_HEAP_SIZE   0x00100000   /* demand-zero, right after the image */
+#define USER_STACK_TOP   0xB0001000
+#define USER_STACK_MAX   0x00100000   /* grows down on demand */
+#define PROC_MAX_REGIONS 4
+#define USER_IPC_BASE    0x80000000   /* pages received over IPC land here */
+#define USER_IPC_SIZE    0x10000000
+
+/* Demand-zero range [start, end): pages appear on first touch */
+typedef struct {
+    uint32_t start, end;
+    uint32_t flags;             /* PAGE_* for the pages mapped in */
+} vm_region_t;
+
 typedef struct {
     uint32_t sender_pid;
     uint32_t len;
+    uint32_t npages;                  /* frames handed over with this message */
+    uint32_t frames[IPC_MAX_PAGES];   /* frame | PAGE_RW / PAGE_COW */
     uint8_t data[IPC_MAX_MSG_LEN];
 } ipc_msg_t;
 
@@ -31,10 +64,16 @@ typedef struct process {
     uint32_t esp;
     uint32_t kernel_stack;
     page_directory_t *page_directory;
+    uint8_t  owns_dir;          /* page_directory is private (exec/fork) */
     uint32_t state; /* 0=unused, 1=running, 2=ready, 3=blocked */
     
     /* ── Dynamic Scheduling Fields ───────────────────────── */
     uint8_t  priority;          /* PRIORITY_IDLE..PRIORITY_HIGH */
+    uint8_t  level;             /* current MLFQ run level (<= priority) */
+    uint8_t  queued;            /* linked on runq[level] */
+    uint8_t  cpu;               /* whose run queue it is on (last ran there) */
+    volatile uint8_t leaving;   /* switched out, its old CPU still on its stack */
+    uint32_t irq_depth;         /* IRQ lock levels held while switched out */
     uint8_t  time_slice;        /* Remaining ticks in current quantum */
     uint8_t  base_slice;        /* Ticks per quantum based on priority */
     char     name[16];          /* Human-readable process name */
@@ -43,11 +82,27 @@ typedef struct process {
     uint32_t last_window_ticks; /* Snapshot for CPU% calculation */
     uint32_t create_tick;       /* Tick when process was created */
     
-    /* IPC Mailbox */
-    int has_msg;
-    ipc_msg_t msg;
+    /* IPC Mailbox: a ring filled by any number of senders (serialised
+       with IRQs off) and drained by the owner without locking */
+    ipc_msg_t mbox[IPC_QUEUE_LEN];
+    volatile uint32_t mbox_head;   /* advanced by senders */
+    volatile uint32_t mbox_tail;   /* advanced by the owner */
+    wait_queue_t mbox_wait;     /* receivers blocked on an empty mailbox */
+    uint32_t ipc_next;          /* pages used in the USER_IPC_BASE window */
+
+    /* Sleep timeout */
+    ktimer_t sleep_timer;
+    uint8_t  timed_out;         /* last sleep ended by the timeout */
+
+    /* Lazily backed user memory */
+    vm_region_t regions[PROC_MAX_REGIONS];
+    int      n_regions;
+    uint32_t demand_pages;      /* pages faulted in so far */
+
+    /* FPU/SSE registers, FXSAVE image (saved on every switch) */
+    uint8_t fpu_state[SIMD_STATE_SIZE] __attribute__((aligned(16)));
     
-    struct process *next;
+    struct process *rq_next, *rq_prev;
 } process_t;
 
 /* ── Process Statistics (for System Monitor) ─────────────── */
@@ -66,6 +121,7 @@ typedef struct {
     int      total_count;                  /* Total slots used */
     uint32_t total_cpu_ticks;             /* Sum of all cpu_ticks */
     uint32_t context_switches;            /* Total context switches */
+    uint32_t steals;                      /* Processes taken from another CPU's queue */
     process_stats_t procs[MAX_PROCESSES]; /* Per-process stats */
 } process_overview_t;
 
@@ -73,7 +129,9 @@ void process_init(void);
 int process_create(void (*entry_point)(void), uint8_t ring);
 int process_create_named(void (*entry_point)(void), uint8_t ring, const char *name, uint8_t priority);
 uint32_t switch_context(uint32_t current_esp);
+void switch_finish(void);             /* interrupt stubs, once on the new stack */
 void process_start_scheduling(void);
+void process_ap_init(uint32_t stack_top);   /* AP boot thread becomes its idle context */
 
 /* ── Dynamic Scheduling API ──────────────────────────────── */
 void process_set_priority(uint32_t pid, uint8_t priority);
@@ -83,10 +141,34 @@ void process_cpu_window_reset(void);  /* Reset CPU measurement window — call e
 
 int process_ipc_send(uint32_t dest_pid, void *msg, uint32_t len);
 int process_ipc_recv(uint32_t *src_pid, void *msg, uint32_t max_len);
+/* Move npages page-aligned pages at addr to dest without copying: they
+   leave the caller's address space. msg/len ride along inline. */
+int process_ipc_send_pages(uint32_t dest_pid, void *addr, uint32_t npages, const void *msg, uint32_t len);
+/* Receive that also reports where carried pages were mapped (user
+   processes: the USER_IPC_BASE window; kernel threads: identity) */
+int process_ipc_recv_pages(uint32_t *src_pid, void *msg, uint32_t max_len, void **pages, uint32_t *npages);
+/* Blocking receive; -1 once timeout_ticks pass (0 = wait forever) */
+int process_ipc_recv_wait(uint32_t *src_pid, void *msg, uint32_t max_len, uint32_t timeout_ticks);
 int process_exec(const char *filename);
+int process_fork(registers_t *regs);  /* child pid; the child sees eax = 0 */
+int process_demand_fault(uint32_t addr);  /* 1 if addr was a demand-zero page */
+
+/* ── Per-CPU scheduler state ─────────────────────────────── */
+DECLARE_PER_CPU(process_t *, cpu_current);
+DECLARE_PER_CPU(int, cpu_yield);
+
+/* The process on this CPU. Read with IRQs off, since a process
+ * preempted between reading the CPU id and the slot could resume on
+ * another CPU. */
+static inline process_t *process_current(void) {
+    uint32_t flags = local_irq_save();
+    process_t *p = this_cpu(cpu_current);
+    local_irq_restore(flags);
+    return p;
+}
 
-/* Extern for crash handlers */
-extern process_t *current_process;
-extern int yield_requested;
+#define current_process process_current()
+#define yield_requested this_cpu(cpu_yield)   /* switch at the end of this interrupt */
+extern int process_scheduling_enabled;
 
 #endif
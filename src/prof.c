@@ -0,0 +1,127 @@
+/* ============================================================
+ * SwanOS — Sampling Profiler
+ * Timer-driven EIP sampling into a per-function histogram,
+ * symbolized against the kernel's embedded symbol table.
+ * ============================================================ */
+
+#include "prof.h"
+#include "ksyms.h"
+#include "timer.h"
+#include "memory.h"
+#include "string.h"
+
+#define PROF_MAX_TOP 32
+
+volatile int prof_running = 0;
+
+static uint32_t *hits = 0;      /* per symbol, ksym_count() entries */
+static uint32_t  hits_user, hits_other;
+static uint32_t  total;
+static uint32_t  interval = 1, countdown = 1;
+static int       rate_hz = 0;
+
+void prof_sample(const registers_t *regs) {
+    if (--countdown) return;
+    countdown = interval;
+    total++;
+    if ((regs->cs & 3) == 3) { hits_user++; return; }
+    int sym = ksym_lookup(regs->eip, 0);
+    if (sym < 0) hits_other++;
+    else hits[sym]++;
+}
+
+int prof_start(int hz) {
+    int n = ksym_count();
+    if (!n) return -1;
+    if (!hits && !(hits = kmalloc(n * sizeof(uint32_t)))) return -1;
+
+    uint32_t freq = timer_get_frequency();
+    if (hz < 1) hz = 1;
+    if ((uint32_t)hz > freq) hz = (int)freq;
+
+    prof_running = 0;
+    memset(hits, 0, n * sizeof(uint32_t));
+    hits_user = hits_other = total = 0;
+    interval = countdown = freq / (uint32_t)hz;
+    rate_hz = (int)(freq / interval);
+    prof_running = 1;
+    return rate_hz;
+}
+
+void prof_stop(void) {
+    prof_running = 0;
+}
+
+int prof_rate(void) {
+    return prof_running ? rate_hz : 0;
+}
+
+uint32_t prof_samples(void) {
+    return total;
+}
+
+/* ── Report ───────────────────────────────────────────────── */
+
+static void format_line(char *line, uint32_t count, const char *name) {
+    char t[12], sym[49];
+    uint32_t part = count, all = total;
+    while (part > 0xFFFFFFFFu / 1000) { part >>= 1; all >>= 1; }   /* no 64-bit divide */
+    uint32_t tenths = all ? part * 1000 / all : 0;
+    strcpy(line, "  ");
+    itoa((int)(tenths / 10), t, 10);
+    for (int pad = strlen(t); pad < 3; pad++) strcat(line, " ");
+    strcat(line, t);
+    strcat(line, ".");
+    itoa((int)(tenths % 10), t, 10);
+    strcat(line, t);
+    strcat(line, "%  ");
+    itoa((int)count, t, 10);
+    for (int pad = strlen(t); pad < 6; pad++) strcat(line, " ");
+    strcat(line, t);
+    strcat(line, "  ");
+    strncpy(sym, name, 48);
+    sym[48] = '\0';
+    strcat(line, sym);
+    strcat(line, "\n");
+}
+
+int prof_format_top(char *buf, int buf_len, int count) {
+    buf[0] = '\0';
+    if (!total || !hits) {
+        strcpy(buf, ksym_count() ? "  No samples recorded.\n"
+                                 : "  No kernel symbol table in this build.\n");
+        return 0;
+    }
+    if (count > PROF_MAX_TOP) count = PROF_MAX_TOP;
+    if (count < 1) count = 1;
+
+    /* Top `count` by insertion into a short sorted list; the user and
+     * outside-text buckets compete as pseudo-symbols -1 and -2 */
+    int top[PROF_MAX_TOP + 1];
+    uint32_t top_hits[PROF_MAX_TOP + 1];
+    int ntop = 0, n = ksym_count();
+    for (int i = -2; i < n; i++) {
+        uint32_t h = i == -2 ? hits_other : i == -1 ? hits_user : hits[i];
+        if (!h || (ntop == count && h <= top_hits[ntop - 1])) continue;
+        int j = ntop < count ? ntop++ : ntop - 1;
+        for (; j > 0 && top_hits[j - 1] < h; j--) {
+            top[j] = top[j - 1];
+            top_hits[j] = top_hits[j - 1];
+        }
+        top[j] = i;
+        top_hits[j] = h;
+    }
+
+    int lines = 0;
+    for (int k = 0; k < ntop; k++) {
+        const char *name = top[k] == -2 ? "[outside kernel text]"
+                         : top[k] == -1 ? "[user mode]"
+                         : ksym_get(top[k])->name;
+        char line[80];
+        format_line(line, top_hits[k], name);
+        if ((int)(strlen(buf) + strlen(line)) >= buf_len - 1) break;
+        strcat(buf, line);
+        lines++;
+    }
+    return lines;
+}
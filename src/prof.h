@@ -0,0 +1,30 @@
+#ifndef PROF_H
+#define PROF_H
+
+#include <stdint.h>
+#include "idt.h"
+
+/* ── Sampling profiler ────────────────────────────────────────
+ * While running, every Nth timer tick records the EIP it
+ * interrupted, counted per kernel function (see ksyms.h). Samples
+ * come from IRQ0, so they cover the BSP only, at up to the timer
+ * rate; ring-3 code and addresses outside kernel text get a bucket
+ * each, and a halted idle CPU is not sampled at all.              */
+extern volatile int prof_running;
+
+void prof_sample(const registers_t *regs);
+
+#define PROF_SAMPLE(regs) \
+    do { if (prof_running) prof_sample(regs); } while (0)
+
+/* Clears the counts; hz is rounded to a whole number of ticks.
+ * Returns the rate actually used, or -1 without a symbol table. */
+int  prof_start(int hz);
+void prof_stop(void);
+int  prof_rate(void);
+uint32_t prof_samples(void);
+
+/* Hottest `count` functions, one per line with share and samples */
+int  prof_format_top(char *buf, int buf_len, int count);
+
+#endif
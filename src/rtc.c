@@ -1,11 +1,14 @@
 /* ============================================================
  * SwanOS — CMOS Real-Time Clock Driver
- * Reads date/time from the hardware RTC chip (ports 0x70/0x71).
+ * Reads date/time from the hardware RTC chip (ports 0x70/0x71),
+ * and keeps a cached wall clock so readers skip the port I/O.
  * ============================================================ */
 
 #include "rtc.h"
 #include "ports.h"
 #include "string.h"
+#include "timer.h"
+#include "spinlock.h"
 
 #define CMOS_ADDR 0x70
 #define CMOS_DATA 0x71
@@ -31,10 +34,8 @@ static uint8_t bcd_to_bin(uint8_t bcd) {
     return (bcd & 0x0F) + ((bcd >> 4) * 10);
 }
 
-void rtc_read(rtc_time_t *t) {
-    /* Wait for update-in-progress flag to clear */
-    while (cmos_read(RTC_STATUS_A) & 0x80);
-
+/* Registers, once the update-in-progress flag is clear */
+static void read_regs(rtc_time_t *t) {
     uint8_t sec  = cmos_read(RTC_SECONDS);
     uint8_t min  = cmos_read(RTC_MINUTES);
     uint8_t hr   = cmos_read(RTC_HOURS);
@@ -70,6 +71,98 @@ void rtc_read(rtc_time_t *t) {
     t->weekday = wday;
 }
 
+void rtc_read(rtc_time_t *t) {
+    /* Wait for update-in-progress flag to clear */
+    while (cmos_read(RTC_STATUS_A) & 0x80);
+    read_regs(t);
+}
+
+/* ── Cached wall clock ────────────────────────────────────── */
+
+static seqlock_t base_lock = SEQLOCK_INIT;
+static uint32_t base_epoch;     /* wall clock at base_ms */
+static uint32_t base_ms;
+static ktimer_t resync_timer;
+
+/* Days since 1970-01-01 for a civil date, and back (Hinnant's
+ * algorithms, eras of 400 years) */
+static uint32_t days_from_civil(int y, int m, int d) {
+    y -= m <= 2;
+    int era = y / 400;
+    int yoe = y - era * 400;
+    int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return (uint32_t)(era * 146097 + doe - 719468);
+}
+
+static void civil_from_days(uint32_t z, rtc_time_t *t) {
+    uint32_t n = z + 719468;
+    uint32_t era = n / 146097;
+    uint32_t doe = n - era * 146097;
+    uint32_t yoe = (doe - doe / 1460 + doe / 36524 - doe / 146096) / 365;
+    uint32_t doy = doe - (365 * yoe + yoe / 4 - yoe / 100);
+    uint32_t mp = (5 * doy + 2) / 153;
+    uint32_t m = mp < 10 ? mp + 3 : mp - 9;
+    t->day = (uint8_t)(doy - (153 * mp + 2) / 5 + 1);
+    t->month = (uint8_t)m;
+    t->year = (uint16_t)(yoe + era * 400 + (m <= 2));
+    t->weekday = (uint8_t)((z + 4) % 7 + 1);   /* 1970-01-01 was a Thursday */
+}
+
+static uint32_t to_epoch(const rtc_time_t *t) {
+    return days_from_civil(t->year, t->month, t->day) * 86400u
+         + t->hour * 3600u + t->minute * 60u + t->second;
+}
+
+uint32_t time_epoch(void) {
+    uint32_t seq, e, ms;
+    do {
+        seq = read_seqbegin(&base_lock);
+        e = base_epoch;
+        ms = base_ms;
+    } while (read_seqretry(&base_lock, seq));
+    return e + (timer_get_ms() - ms) / 1000;
+}
+
+void time_now(rtc_time_t *t) {
+    uint32_t e = time_epoch();
+    uint32_t secs = e % 86400;
+    t->hour   = (uint8_t)(secs / 3600);
+    t->minute = (uint8_t)(secs / 60 % 60);
+    t->second = (uint8_t)(secs % 60);
+    civil_from_days(e / 86400, t);
+}
+
+/* From the timer IRQ: never spin on the update flag, just retry on
+ * the next tick. The clock only steps when it has drifted by more
+ * than a second, so the phase of the boot read doesn't make it
+ * bounce back and forth. */
+static void resync(void *arg) {
+    (void)arg;
+    if (cmos_read(RTC_STATUS_A) & 0x80) {
+        timer_arm(&resync_timer, 1, RTC_RESYNC_TICKS);
+        return;
+    }
+    rtc_time_t t;
+    read_regs(&t);
+    uint32_t rtc = to_epoch(&t), now = time_epoch();
+    if (rtc > now + 1 || now > rtc + 1) {
+        uint32_t flags = write_seqlock_irqsave(&base_lock);
+        base_epoch = rtc;
+        base_ms = timer_get_ms();
+        write_sequnlock_irqrestore(&base_lock, flags);
+    }
+}
+
+void rtc_init(void) {
+    rtc_time_t t;
+    rtc_read(&t);
+    base_epoch = to_epoch(&t);
+    base_ms = timer_get_ms();
+    timer_setup(&resync_timer, resync, 0);
+    timer_arm(&resync_timer, RTC_RESYNC_TICKS, RTC_RESYNC_TICKS);
+}
+
 static void two_digit(uint8_t val, char *buf) {
     buf[0] = '0' + (val / 10);
     buf[1] = '0' + (val % 10);
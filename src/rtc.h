@@ -13,9 +13,20 @@ typedef struct {
     uint8_t weekday;  /* 1=Sun, 2=Mon, ... 7=Sat */
 } rtc_time_t;
 
-/* Read current date/time from CMOS RTC */
+/* Read current date/time from CMOS RTC (slow port I/O; most code
+ * wants time_now) */
 void rtc_read(rtc_time_t *t);
 
+/* ── Cached wall clock ────────────────────────────────────────
+ * rtc_init reads the CMOS once; after that the time is the boot
+ * reading advanced by the monotonic clock, re-read from CMOS every
+ * RTC_RESYNC_TICKS by a timer. Call after timer_init.            */
+#define RTC_RESYNC_TICKS 6000   /* one minute at 100 Hz */
+
+void rtc_init(void);
+void time_now(rtc_time_t *t);   /* no port I/O */
+uint32_t time_epoch(void);      /* seconds since 1970-01-01, RTC local time */
+
 /* Format time into "HH:MM:SS" buffer (needs 9 chars) */
 void rtc_format_time(const rtc_time_t *t, char *buf);
 
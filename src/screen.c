@@ -7,6 +7,7 @@
 #include "vga_gfx.h"
 #include "string.h"
 #include "serial.h"
+#include "timer.h"
 
 #define CHAR_W 16
 #define CHAR_H 16
@@ -19,9 +20,12 @@ typedef struct {
     uint32_t bg;
 } tchar_t;
 
+/* Circular row buffer: screen row r lives in ring row (top + r) % rows,
+ * so scrolling only advances top */
 static tchar_t tbuf[MAX_COLS * MAX_ROWS];
 static int cols = 80;
 static int rows = 25;
+static int top = 0;
 
 static int cursor_row = 0;
 static int cursor_col = 0;
@@ -29,6 +33,16 @@ static int cursor_col = 0;
 static uint32_t current_fg = 0xFFFFFFFF;
 static uint32_t current_bg = 0xFF000000;
 static int serial_mirror = 1;
+static screen_sink_t sink = 0;      /* capture instead of drawing */
+static void *sink_ctx = 0;
+
+/* Batch mode: writes only touch tbuf and mark their row; the rows
+ * are drawn together at the end of the batch, or once a frame */
+#define BATCH_FRAME_TICKS 2     /* 20 ms at 100 Hz */
+static int batch = 0;           /* nesting depth */
+static int batch_all = 0;       /* scrolled or cleared: every row */
+static uint8_t batch_dirty[MAX_ROWS];
+static uint32_t batch_tick = 0;
 
 static uint32_t ansi_colors[16] = {
     0xFF000000, 0xFF0000AA, 0xFF00AA00, 0xFF00AAAA,
@@ -37,24 +51,48 @@ static uint32_t ansi_colors[16] = {
     0xFFFF5555, 0xFFFF55FF, 0xFFFFFF55, 0xFFFFFFFF
 };
 
+static inline tchar_t *cell(int r, int c) {
+    int rr = top + r;
+    if (rr >= rows) rr -= rows;
+    return &tbuf[rr * cols + c];
+}
+
+/* Cells are drawn into the backbuffer, which doubles as a cached copy
+ * of the console; push() then writes the changed area to the screen */
+static void push(int x, int y, int w, int h) {
+    vga_rect_t r = { x, y, w, h };
+    vga_flip_rects(&r, 1);
+}
+
+static void draw_cell(int r, int c) {
+    tchar_t t = *cell(r, c);
+    vga_bb_fill_rect(c * CHAR_W, r * CHAR_H, CHAR_W, CHAR_H, t.bg);
+    if (t.c) {
+        vga_bb_draw_char_2x(c * CHAR_W, r * CHAR_H, t.c, t.fg, 0);
+    }
+}
+
 static void redraw_char(int r, int c) {
     if (r < 0 || r >= rows || c < 0 || c >= cols) return;
-    tchar_t t = tbuf[r * cols + c];
-    vga_fill_rect(c * CHAR_W, r * CHAR_H, CHAR_W, CHAR_H, t.bg);
-    if (t.c) {
-        vga_draw_char_2x(c * CHAR_W, r * CHAR_H, t.c, t.fg);
+    if (batch) {
+        batch_dirty[r] = 1;
+        if (timer_get_ticks() - batch_tick >= BATCH_FRAME_TICKS) screen_batch_flush();
+        return;
     }
+    draw_cell(r, c);
+    push(c * CHAR_W, r * CHAR_H, CHAR_W, CHAR_H);
 }
 
 static void update_cursor(void) {
     /* Draw a simple block cursor since we don't have hardware cursor */
     /* Draw over the current char */
-    if (cursor_row >= rows || cursor_col >= cols) return;
-    tchar_t t = tbuf[cursor_row * cols + cursor_col];
-    vga_fill_rect(cursor_col * CHAR_W, cursor_row * CHAR_H, CHAR_W, CHAR_H, 0xAAAAAAAA);
+    if (batch || cursor_row >= rows || cursor_col >= cols) return;
+    tchar_t t = *cell(cursor_row, cursor_col);
+    vga_bb_fill_rect(cursor_col * CHAR_W, cursor_row * CHAR_H, CHAR_W, CHAR_H, 0xFFAAAAAA);
     if (t.c) {
-        vga_draw_char_2x(cursor_col * CHAR_W, cursor_row * CHAR_H, t.c, 0xFF000000);
+        vga_bb_draw_char_2x(cursor_col * CHAR_W, cursor_row * CHAR_H, t.c, 0xFF000000, 0);
     }
+    push(cursor_col * CHAR_W, cursor_row * CHAR_H, CHAR_W, CHAR_H);
 }
 
 static void clear_cursor(void) {
@@ -65,27 +103,23 @@ static void scroll(void) {
     if (cursor_row < rows) return;
     clear_cursor();
     
-    // Move buffer up
-    for (int r = 0; r < rows - 1; r++) {
-        for (int c = 0; c < cols; c++) {
-            tbuf[r * cols + c] = tbuf[(r + 1) * cols + c];
-        }
-    }
-    // Clear last line
+    // Rotate the ring: the old top row becomes the new, blank bottom row
+    top = (top + 1) % rows;
     for (int c = 0; c < cols; c++) {
-        tbuf[(rows - 1) * cols + c].c = ' ';
-        tbuf[(rows - 1) * cols + c].fg = current_fg;
-        tbuf[(rows - 1) * cols + c].bg = current_bg;
-    }
-    
-    // Redraw entire screen
-    for (int r = 0; r < rows; r++) {
-        for (int c = 0; c < cols; c++) {
-            redraw_char(r, c);
-        }
+        tchar_t *t = cell(rows - 1, c);
+        t->c = ' ';
+        t->fg = current_fg;
+        t->bg = current_bg;
     }
     
     cursor_row = rows - 1;
+    if (batch) { batch_all = 1; return; }
+
+    // Move the text area up one row in the backbuffer, draw only the
+    // exposed line, then write the text area out (no framebuffer reads)
+    vga_bb_copy_rows(0, CHAR_H, (rows - 1) * CHAR_H, cols * CHAR_W);
+    vga_bb_fill_rect(0, (rows - 1) * CHAR_H, cols * CHAR_W, CHAR_H, current_bg);
+    push(0, 0, cols * CHAR_W, rows * CHAR_H);
 }
 
 void screen_init(void) {
@@ -104,12 +138,18 @@ void screen_clear(void) {
         tbuf[i].fg = current_fg;
         tbuf[i].bg = current_bg;
     }
+    top = 0;
     cursor_row = 0; cursor_col = 0;
-    vga_clear(current_bg);
+    if (batch) { batch_all = 1; return; }
+    vga_bb_reset_target();      /* the desktop may have left its own */
+    vga_bb_reset_clip();
+    vga_clear_bb(current_bg);
+    push(0, 0, GFX_W, GFX_H);
     update_cursor();
 }
 
 void screen_set_color(uint8_t fg, uint8_t bg) {
+    if (sink) return;
     current_fg = ansi_colors[fg & 0x0F];
     current_bg = ansi_colors[bg & 0x0F];
 
@@ -133,15 +173,16 @@ void screen_set_color(uint8_t fg, uint8_t bg) {
 }
 
 void screen_putchar(char c) {
+    if (sink) { sink(c, sink_ctx); return; }
     clear_cursor();
     if (c == '\n') { cursor_col = 0; cursor_row++; }
     else if (c == '\r') { cursor_col = 0; }
     else if (c == '\t') { cursor_col = (cursor_col + 4) & ~3; }
     else {
-        int idx = cursor_row * cols + cursor_col;
-        tbuf[idx].c = c;
-        tbuf[idx].fg = current_fg;
-        tbuf[idx].bg = current_bg;
+        tchar_t *t = cell(cursor_row, cursor_col);
+        t->c = c;
+        t->fg = current_fg;
+        t->bg = current_bg;
         redraw_char(cursor_row, cursor_col);
         cursor_col++;
     }
@@ -172,10 +213,10 @@ void screen_print_at(const char *str, int row, int col) {
     int old_row = cursor_row, old_col = cursor_col;
     cursor_row = row; cursor_col = col;
     while (*str && cursor_col < cols) {
-        int idx = cursor_row * cols + cursor_col;
-        tbuf[idx].c = *str;
-        tbuf[idx].fg = current_fg;
-        tbuf[idx].bg = current_bg;
+        tchar_t *t = cell(cursor_row, cursor_col);
+        t->c = *str;
+        t->fg = current_fg;
+        t->bg = current_bg;
         redraw_char(cursor_row, cursor_col);
         cursor_col++; str++;
     }
@@ -184,6 +225,7 @@ void screen_print_at(const char *str, int row, int col) {
 }
 
 void screen_newline(void) {
+    if (sink) { sink('\n', sink_ctx); return; }
     clear_cursor();
     cursor_col = 0; cursor_row++;
     scroll(); update_cursor();
@@ -194,10 +236,10 @@ void screen_backspace(void) {
     clear_cursor();
     if (cursor_col > 0) cursor_col--;
     else if (cursor_row > 0) { cursor_row--; cursor_col = cols - 1; }
-    int idx = cursor_row * cols + cursor_col;
-    tbuf[idx].c = ' ';
-    tbuf[idx].fg = current_fg;
-    tbuf[idx].bg = current_bg;
+    tchar_t *t = cell(cursor_row, cursor_col);
+    t->c = ' ';
+    t->fg = current_fg;
+    t->bg = current_bg;
     redraw_char(cursor_row, cursor_col);
     update_cursor();
     if (serial_mirror) serial_putchar('\b');
@@ -208,20 +250,20 @@ int screen_get_col(void) { return cursor_col; }
 
 void screen_put_char_at(int row, int col, char c, uint8_t fg, uint8_t bg) {
     if (row < 0 || row >= rows || col < 0 || col >= cols) return;
-    int idx = row * cols + col;
-    tbuf[idx].c = c;
-    tbuf[idx].fg = ansi_colors[fg & 0x0F];
-    tbuf[idx].bg = ansi_colors[bg & 0x0F];
+    tchar_t *t = cell(row, col);
+    t->c = c;
+    t->fg = ansi_colors[fg & 0x0F];
+    t->bg = ansi_colors[bg & 0x0F];
     redraw_char(row, col);
 }
 
 void screen_put_str_at(int row, int col, const char *str, uint8_t fg, uint8_t bg) {
     while (*str && col < cols) {
         if (row >= 0 && row < rows) {
-            int idx = row * cols + col;
-            tbuf[idx].c = *str;
-            tbuf[idx].fg = ansi_colors[fg & 0x0F];
-            tbuf[idx].bg = ansi_colors[bg & 0x0F];
+            tchar_t *t = cell(row, col);
+            t->c = *str;
+            t->fg = ansi_colors[fg & 0x0F];
+            t->bg = ansi_colors[bg & 0x0F];
             redraw_char(row, col);
         }
         str++; col++;
@@ -291,3 +333,48 @@ void screen_delay(int ms) {
 void screen_set_serial_mirror(int enable) {
     serial_mirror = enable;
 }
+
+/* ── Batched output ───────────────────────────────────────── */
+
+void screen_batch_begin(void) {
+    if (!batch++) {
+        clear_cursor();
+        batch_tick = timer_get_ticks();
+    }
+}
+
+/* Draw every row written since the last flush, in one pass */
+void screen_batch_flush(void) {
+    if (!batch) return;
+    vga_rect_t dirty[MAX_ROWS];
+    int n = 0;
+    for (int r = 0; r < rows; r++) {
+        if (!batch_all && !batch_dirty[r]) continue;
+        for (int c = 0; c < cols; c++) draw_cell(r, c);
+        batch_dirty[r] = 0;
+        /* Adjacent dirty rows go out as one band */
+        if (n && dirty[n - 1].y + dirty[n - 1].h == r * CHAR_H)
+            dirty[n - 1].h += CHAR_H;
+        else
+            dirty[n++] = (vga_rect_t){ 0, r * CHAR_H, cols * CHAR_W, CHAR_H };
+    }
+    if (n) vga_flip_rects(dirty, n);
+    batch_all = 0;
+    batch_tick = timer_get_ticks();
+}
+
+void screen_batch_end(void) {
+    if (!batch) return;
+    screen_batch_flush();
+    if (!--batch) update_cursor();
+}
+
+void screen_set_sink(screen_sink_t fn, void *ctx) {
+    sink_ctx = ctx;
+    sink = fn;
+}
+
+screen_sink_t screen_get_sink(void **ctx) {
+    if (ctx) *ctx = sink_ctx;
+    return sink;
+}
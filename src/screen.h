@@ -79,4 +79,22 @@ void screen_show_cursor(void);
 void screen_delay(int ms);
 void screen_set_serial_mirror(int enable);
 
+/* While a sink is set, screen_putchar/screen_print hand every
+   character to it instead of the console (and the serial mirror),
+   and colour changes are ignored. The shell uses this to capture a
+   command's output for pipes and redirects; 0 restores the console.
+   screen_get_sink returns the current one, so a nested capture can
+   put it back. */
+typedef void (*screen_sink_t)(char c, void *ctx);
+void screen_set_sink(screen_sink_t fn, void *ctx);
+screen_sink_t screen_get_sink(void **ctx);
+
+/* Batch mode: between begin and end, output only updates the text
+   buffer; the touched rows are drawn at screen_batch_end (and at most
+   once a frame meanwhile), with scrolls folded into a single redraw.
+   Batches nest. */
+void screen_batch_begin(void);
+void screen_batch_flush(void);
+void screen_batch_end(void);
+
 #endif
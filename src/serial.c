@@ -2,19 +2,83 @@
  * SwanOS — Serial Port Driver (COM1)
  * Used to communicate with the host-side Python GUI + LLM bridge.
  *
- * Protocol (GUI integration):
+ * Traffic (GUI integration):
  *   Kernel → GUI:  Regular text output (screen mirroring)
- *   Kernel → GUI:  \x01Q + query text + \x04   (LLM query)
- *   GUI → Kernel:  Keystroke characters
- *   GUI → Kernel:  LLM response text + \x04
+ *   Both ways:     Bridge frames (see bridge.h)
+ *   GUI → Kernel:  Keystroke characters between frames
  * ============================================================ */
 
 #include "serial.h"
 #include "ports.h"
 #include "timer.h"
+#include "idt.h"
+#include "cpu.h"
+#include "softirq.h"
 
 #define COM1 0x3F8
 
+#define UART_IER_RX   0x01   /* received data available */
+#define UART_IER_THRE 0x02   /* transmit holding register empty */
+#define UART_LSR_DR   0x01
+#define UART_LSR_THRE 0x20
+#define UART_LSR_TEMT 0x40   /* shifter idle too */
+#define UART_FIFO_LEN 16
+
+/* ── Ring buffers ─────────────────────────────────────────── */
+/* Single producer/consumer each side; the IRQ handler owns the UART
+ * end (TX tail, RX head). Sizes are powers of two. */
+#define TX_SIZE 8192
+#define RX_SIZE 2048
+
+static uint8_t tx_buf[TX_SIZE];
+static volatile uint32_t tx_head = 0, tx_tail = 0;
+static uint8_t rx_buf[RX_SIZE];
+static volatile uint32_t rx_head = 0, rx_tail = 0;
+static volatile uint32_t rx_dropped = 0;
+static int thre_armed = 0;
+static int irq_mode = 0;
+static wait_queue_t rx_wait;     /* readers sleeping on an empty RX ring */
+
+static int serial_transmit_ready(void) {
+    return inb(COM1 + 5) & UART_LSR_THRE;
+}
+
+static void set_ier(void) {
+    outb(COM1 + 1, UART_IER_RX | (thre_armed ? UART_IER_THRE : 0));
+}
+
+/* Move queued bytes into the UART FIFO; caller has IRQs off */
+static void tx_pump(void) {
+    if (serial_transmit_ready()) {
+        for (int n = 0; n < UART_FIFO_LEN && tx_tail != tx_head; n++) {
+            outb(COM1, tx_buf[tx_tail & (TX_SIZE - 1)]);
+            tx_tail++;
+        }
+    }
+    int want = irq_mode && tx_tail != tx_head;
+    if (want != thre_armed) { thre_armed = want; set_ier(); }
+}
+
+static void rx_pump(void) {
+    while (inb(COM1 + 5) & UART_LSR_DR) {
+        uint8_t c = inb(COM1);
+        if (rx_head - rx_tail < RX_SIZE) { rx_buf[rx_head & (RX_SIZE - 1)] = c; rx_head++; }
+        else rx_dropped++;
+    }
+}
+
+static void serial_callback(registers_t *regs) {
+    (void)regs;
+    inb(COM1 + 2);   /* IIR: acknowledge */
+    uint32_t before = rx_head;
+    rx_pump();
+    tx_pump();
+    if (rx_head != before) {
+        wake_up(&rx_wait);
+        softirq_raise(SOFTIRQ_SERIAL);     /* parse frames and keystrokes */
+    }
+}
+
 void serial_init(void) {
     outb(COM1 + 1, 0x00); /* Disable interrupts */
     outb(COM1 + 3, 0x80); /* Enable DLAB (set baud rate) */
@@ -23,21 +87,58 @@ void serial_init(void) {
     outb(COM1 + 3, 0x03); /* 8 bits, no parity, 1 stop bit */
     outb(COM1 + 2, 0xC7); /* Enable FIFO, clear, 14-byte threshold */
     outb(COM1 + 4, 0x0B); /* IRQs enabled, RTS/DSR set */
+
+    /* IRQ4 → INT 36 (already unmasked on the master PIC) */
+    register_interrupt_handler(36, serial_callback);
+    irq_mode = 1;
+    set_ier();
 }
 
-static int serial_transmit_ready(void) {
-    return inb(COM1 + 5) & 0x20;
+/* ── Non-blocking output ─────────────────────────────────── */
+
+int serial_enqueue(const char *data, int len) {
+    uint32_t flags = irq_save();
+    int n = 0;
+    while (n < len && tx_head - tx_tail < TX_SIZE) {
+        tx_buf[tx_head & (TX_SIZE - 1)] = (uint8_t)data[n++];
+        tx_head++;
+    }
+    if (!thre_armed) tx_pump();   /* idle transmitter: kick it */
+    irq_restore(flags);
+    return n;
+}
+
+int serial_tx_pending(void) {
+    return (int)(tx_head - tx_tail);
+}
+
+/* Block until every queued byte has left the shifter. Works with
+ * interrupts off (panic paths) by pumping the FIFO directly. */
+void serial_flush(void) {
+    while (tx_head != tx_tail) {
+        uint32_t flags = irq_save();
+        tx_pump();
+        irq_restore(flags);
+        __asm__ volatile ("pause");
+    }
+    while (!(inb(COM1 + 5) & UART_LSR_TEMT)) __asm__ volatile ("pause");
 }
 
-static int serial_data_available(void) {
-    return inb(COM1 + 5) & 0x01;
+/* One byte, queued. Only waits when the ring is full (backpressure);
+ * then it feeds the FIFO itself, so this also works with IRQs off. */
+static void tx_byte(char c) {
+    while (!serial_enqueue(&c, 1)) {
+        uint32_t flags = irq_save();
+        tx_pump();
+        irq_restore(flags);
+        __asm__ volatile ("pause");
+    }
 }
 
 /* ── Raw output (for screen mirroring) ───────────────────── */
 
 void serial_putchar(char c) {
-    while (!serial_transmit_ready());
-    outb(COM1, c);
+    tx_byte(c);
 }
 
 void serial_puts(const char *str) {
@@ -49,8 +150,7 @@ void serial_puts(const char *str) {
 /* ── Protocol output (for LLM queries) ───────────────────── */
 
 void serial_write_char(char c) {
-    while (!serial_transmit_ready());
-    outb(COM1, c);
+    tx_byte(c);
 }
 
 void serial_write(const char *str) {
@@ -68,12 +168,37 @@ void serial_write(const char *str) {
 /* ── Input ───────────────────────────────────────────────── */
 
 int serial_data_ready(void) {
-    return serial_data_available();
+    if (!irq_mode) return inb(COM1 + 5) & UART_LSR_DR;
+    return rx_head != rx_tail;
+}
+
+int serial_try_read(char *c) {
+    uint32_t flags = irq_save();
+    if (rx_head == rx_tail) rx_pump();   /* IRQ masked or not yet taken */
+    int ok = rx_head != rx_tail;
+    if (ok) { *c = (char)rx_buf[rx_tail & (RX_SIZE - 1)]; rx_tail++; }
+    irq_restore(flags);
+    return ok;
+}
+
+int serial_wait_rx(uint32_t ticks) {
+    uint32_t flags = irq_save();
+    if (rx_head == rx_tail) rx_pump();
+    /* Polled mode has no IRQ to wake us: recheck every tick */
+    if (!irq_mode && (!ticks || ticks > 1)) ticks = 1;
+    int ok = rx_head != rx_tail || sleep_on_timeout(&rx_wait, ticks);
+    irq_restore(flags);
+    return ok;
+}
+
+wait_queue_t *serial_rx_queue(void) {
+    return &rx_wait;
 }
 
 char serial_read_char(void) {
-    while (!serial_data_available());
-    return inb(COM1);
+    char c;
+    while (!serial_try_read(&c)) serial_wait_rx(0);
+    return c;
 }
 
 int serial_read_line(char *buf, int max_len, int timeout_secs) {
@@ -86,16 +211,15 @@ int serial_read_line(char *buf, int max_len, int timeout_secs) {
             break;
         }
 
-        if (serial_data_available()) {
-            char c = inb(COM1);
-
+        char c;
+        if (serial_try_read(&c)) {
             /* EOT = end of transmission */
             if (c == '\x04') break;
 
             buf[pos++] = c;
             start = timer_get_seconds(); /* reset timeout on data */
         } else {
-            __asm__ volatile ("hlt");
+            serial_wait_rx(timer_get_frequency());   /* woken by IRQ4 */
         }
     }
 
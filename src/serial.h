@@ -1,6 +1,9 @@
 #ifndef SERIAL_H
 #define SERIAL_H
 
+#include <stdint.h>
+#include "wait.h"
+
 void serial_init(void);
 void serial_write_char(char c);
 void serial_write(const char *str);   /* Sends str + \x04 (for LLM queries) */
@@ -10,4 +13,13 @@ char serial_read_char(void);
 int  serial_read_line(char *buf, int max_len, int timeout_secs);
 int  serial_data_ready(void);         /* Non-blocking check for data */
 
+/* ── Buffered, IRQ4-driven I/O ───────────────────────────── */
+int  serial_enqueue(const char *data, int len);  /* Non-blocking; returns bytes queued */
+int  serial_tx_pending(void);         /* Bytes still waiting in the TX ring */
+void serial_flush(void);              /* Drain TX ring and UART shifter */
+int  serial_try_read(char *c);        /* Non-blocking; 1 if a byte was read */
+/* Sleep until RX bytes are queued; 0 if `ticks` passed (0 = forever) */
+int  serial_wait_rx(uint32_t ticks);
+wait_queue_t *serial_rx_queue(void);  /* woken whenever RX bytes arrive */
+
 #endif
@@ -8,6 +8,7 @@
 
 #include "shell.h"
 #include "screen.h"
+#include "serial.h"
 #include "keyboard.h"
 #include "string.h"
 #include "timer.h"
@@ -20,9 +21,24 @@
 #include "ports.h"
 #include "process.h"
 #include "audit.h"
+#include "telemetry.h"
+#include "trace.h"
+#include "prof.h"
+#include "mouse.h"
+#include "input.h"
+#include "pci.h"
+#include "network.h"
+#include "netdev.h"
+#include "inet.h"
+#include "tcp.h"
+#include "dhcp.h"
+#include "bridge.h"
+#include "bridge_tcp.h"
+#include "kernel_ai.h"
 
 #define CMD_BUF 256
 #define OUT_BUF 4096
+#define AUTORUN_SCRIPT "/autorun.sh"
 
 static char cmd_buf[CMD_BUF];
 static char out_buf[OUT_BUF];
@@ -107,23 +123,16 @@ static int calc_eval(const char *expr) {
 }
 
 /* ── Hexdump ───────────────────────────────────────────────── */
-static void cmd_hexdump(const char *filename) {
-    char abs_path[128];
-    resolve_path(filename, abs_path);
-
-    int r = fs_read(abs_path, out_buf, OUT_BUF);
-    if (r < 0) {
-        screen_set_color(VGA_RED, VGA_BLACK);
-        screen_print("  ");
-        screen_putchar((char)254);
-        screen_print(" File not found: ");
-        screen_print(filename);
-        screen_print("\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return;
+static uint8_t view_byte(const fs_view_t *v, uint32_t off) {
+    for (int s = 0; s < v->n_seg; s++) {
+        if (off < v->seg[s].len) return v->seg[s].data[off];
+        off -= v->seg[s].len;
     }
+    return 0;
+}
 
-    int len = strlen(out_buf);
+static void hexdump_view(const fs_view_t *v) {
+    int len = (int)v->size;
     char hex[4];
     screen_set_color(VGA_CYAN, VGA_BLACK);
     screen_print("  Offset   Hex                                       ASCII\n");
@@ -144,7 +153,7 @@ static void cmd_hexdump(const char *filename) {
         screen_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
         for (int i = 0; i < 16; i++) {
             if (off + i < len) {
-                uint8_t b = (uint8_t)out_buf[off + i];
+                uint8_t b = view_byte(v, off + i);
                 char h[3];
                 h[0] = "0123456789abcdef"[b >> 4];
                 h[1] = "0123456789abcdef"[b & 0xF];
@@ -159,7 +168,7 @@ static void cmd_hexdump(const char *filename) {
         screen_set_color(VGA_GREEN, VGA_BLACK);
         screen_putchar(' ');
         for (int i = 0; i < 16 && off + i < len; i++) {
-            char c = out_buf[off + i];
+            char c = (char)view_byte(v, off + i);
             if (c >= ' ' && c <= '~')
                 screen_putchar(c);
             else
@@ -175,6 +184,26 @@ static void cmd_hexdump(const char *filename) {
     screen_set_color(VGA_WHITE, VGA_BLACK);
 }
 
+/* Reads the file through a view: no copy, no size cap */
+static void hexdump_file(const char *filename) {
+    char abs_path[128];
+    resolve_path(filename, abs_path);
+
+    fs_view_t v;
+    if (fs_view(abs_path, &v) < 0) {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("  ");
+        screen_putchar((char)254);
+        screen_print(" File not found: ");
+        screen_print(filename);
+        screen_print("\n");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        return;
+    }
+    hexdump_view(&v);
+    fs_view_release(&v);
+}
+
 /* ── Styled prompt ─────────────────────────────────────────── */
 static void print_prompt(void) {
     screen_set_color(VGA_DARK_GREY, VGA_BLACK);
@@ -283,7 +312,7 @@ static void print_help_section(const char *title, uint8_t color) {
     screen_print("\n");
 }
 
-static void cmd_help(void) {
+static void print_help(void) {
     /* Header */
     screen_set_color(VGA_DARK_GREY, VGA_BLACK);
     screen_print("\n   ");
@@ -326,8 +355,11 @@ static void cmd_help(void) {
     print_help_entry("mkdir <name>", "Create directory");
     print_help_entry("rm <file>", "Delete file/dir");
     print_help_entry("hexdump <file>", "Hex viewer");
+    print_help_entry("grep/head/wc", "Filter piped output");
+    print_help_entry("sync", "Flush files to disk");
     print_help_entry("exec <file>", "Run dynamic app");
     print_help_entry("mkapp <file>", "Create test app");
+    print_help_entry("source <file>", "Run a script (batched output)");
 
     print_help_section("UTILITIES", VGA_GREEN);
     print_help_entry("calc <expr>", "Calculator");
@@ -344,6 +376,13 @@ static void cmd_help(void) {
     print_help_entry("date", "Date & time");
     print_help_entry("mem", "Memory usage");
     print_help_entry("time", "Uptime");
+    print_help_entry("telemetry", "Telemetry stats / set rate");
+    print_help_entry("trace", "Event trace dump / export");
+    print_help_entry("prof", "Sampling profiler: start/stop/top");
+    print_help_entry("mouse", "Mouse rate/resolution, event stats");
+    print_help_entry("net", "NIC, IP config, counters; net bridge <ip> [port]");
+    print_help_entry("lspci", "PCI devices: class, IRQ, BARs");
+    print_help_entry("policy", "AI crash rules and scheduler hints");
     print_help_entry("history", "Command history");
     print_help_entry("gui", "Switch to GUI mode");
     print_help_entry("login", "Switch user");
@@ -355,10 +394,55 @@ static void cmd_help(void) {
     screen_print("   Tip: ");
     screen_putchar((char)24);  /* ↑ */
     screen_putchar((char)25);  /* ↓ */
-    screen_print(" arrows for command history\n\n");
+    screen_print(" arrows for command history\n");
+    screen_print("   Pipes: ls | grep txt > list.txt  (>> appends)\n");
+    screen_print("   | and > need spaces around them; \"quote\" text to keep them literal\n\n");
     screen_set_color(VGA_WHITE, VGA_BLACK);
 }
 
+/* Active IRQ lines: rate, handler cost and worst case */
+static void pad_num(uint32_t v, int width) {
+    char buf[12];
+    itoa((int)v, buf, 10);
+    for (int i = strlen(buf); i < width; i++) screen_putchar(' ');
+    screen_print(buf);
+}
+
+static void print_irq_stats(void) {
+    irq_overview_t io;
+    idt_get_irq_overview(&io);
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("\n   IRQ  Line          Count   /s  avg us  max us  peak us\n");
+    for (int i = 0; i < 16; i++) {
+        const irq_line_stats_t *l = &io.line[i];
+        if (!l->count) continue;
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        screen_print("   ");
+        pad_num(i, 3);
+        screen_print("  ");
+        screen_set_color(VGA_CYAN, VGA_BLACK);
+        screen_print(idt_irq_name(i));
+        for (int k = strlen(idt_irq_name(i)); k < 9; k++) screen_putchar(' ');
+        screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        pad_num(l->count, 10);
+        pad_num(l->rate, 5);
+        pad_num(l->avg_us, 8);
+        screen_set_color(l->max_us > 1000 ? VGA_YELLOW : VGA_LIGHT_GREY, VGA_BLACK);
+        pad_num(l->max_us, 8);
+        screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+        pad_num(l->peak_us, 9);
+        screen_print("\n");
+    }
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   Total ");
+    pad_num(io.total_rate, 0);
+    screen_print(" IRQs/s, ");
+    pad_num(io.busy_permille / 10, 0);
+    screen_print(".");
+    pad_num(io.busy_permille % 10, 0);
+    screen_print("% of the last second in handlers\n");
+}
+
 static void ring3_crash_dummy(void) {
     /* This process is spawned in Ring 3 User Space. 
        Executing CLI without IOPL=3 will cause a General Protection Fault. */
@@ -366,1134 +450,1795 @@ static void ring3_crash_dummy(void) {
     while(1);
 }
 
-/* ── Execute command ───────────────────────────────────────── */
-static int execute_command(char *input) {
-    char *cmd = trim(input);
-    if (cmd[0] == '\0') return 0;
+/* ── Pipe streams ──────────────────────────────────────────── */
+/* While a stage of `a | b > file` runs, its console output goes
+ * into a stream instead of the screen (colours are dropped). The
+ * stream is the next stage's input, or goes to the redirect
+ * target after the last stage. Commands read their input through
+ * pipe_in; it is 0 for the first stage. */
+#define STREAM_CHUNK 4096
+#define STREAM_MAX   (64 * 1024)
+#define PIPE_STAGES  4
+
+typedef struct {
+    char    *data;              /* NUL-terminated */
+    uint32_t len, cap;
+    int      truncated;         /* hit STREAM_MAX or out of heap */
+} sh_stream_t;
+
+static const char *pipe_in = 0;
+static uint32_t pipe_in_len = 0;
+static int out_captured = 0;    /* plain output: no console indent */
+
+static void stream_putc(char c, void *ctx) {
+    sh_stream_t *s = ctx;
+    if (s->len + 1 >= s->cap) {
+        uint32_t cap = s->cap ? s->cap * 2 : STREAM_CHUNK;
+        if (cap > STREAM_MAX) cap = STREAM_MAX;
+        char *d = cap > s->cap ? kmalloc(cap) : 0;
+        if (!d) { s->truncated = 1; return; }
+        if (s->len) memcpy(d, s->data, s->len);
+        kfree(s->data);
+        s->data = d;
+        s->cap = cap;
+    }
+    s->data[s->len++] = c;
+    s->data[s->len] = '\0';
+}
 
-    char *arg = cmd;
-    while (*arg && !isspace(*arg)) arg++;
-    if (*arg) { *arg = '\0'; arg++; }
-    arg = trim(arg);
+static void stream_free(sh_stream_t *s) {
+    kfree(s->data);
+    memset(s, 0, sizeof(*s));
+}
 
-    /* ── Power ── */
-    if (strcmp(cmd, "shutdown") == 0 || strcmp(cmd, "exit") == 0) {
-        screen_print("\n");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("   ");
-        for (int i = 0; i < 40; i++) screen_putchar((char)196);
-        screen_print("\n");
-        screen_set_color(VGA_YELLOW, VGA_BLACK);
+/* Piped input as a one-segment view, for the view-based commands */
+static void pipe_view(fs_view_t *v) {
+    v->size = pipe_in_len;
+    v->n_seg = 1;
+    v->seg[0].data = (const uint8_t *)pipe_in;
+    v->seg[0].len = pipe_in_len;
+}
+
+/* ── Commands ──────────────────────────────────────────────── */
+static int execute_command(char *input);
+
+/* ── Power ── */
+static int cmd_shutdown(char *arg) {
+    (void)arg;
+    screen_print("\n");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    for (int i = 0; i < 40; i++) screen_putchar((char)196);
+    screen_print("\n");
+    screen_set_color(VGA_YELLOW, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)254);
+    screen_print(" Shutting down SwanOS...\n");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   Goodbye.\n\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return -1;
+}
+
+static int cmd_reboot(char *arg) {
+    (void)arg;
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)254);
+    screen_print(" Rebooting...\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return -2;
+}
+
+/* ── Help ── */
+static int cmd_help(char *arg) {
+    (void)arg;
+    print_help();
+    return 0;
+}
+
+/* ── Clear ── */
+static int cmd_clear(char *arg) {
+    (void)arg;
+    screen_clear();
+    /* Show subtle brand watermark after clear */
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)6);
+    screen_print(" SwanOS v3.0\n\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+/* ── GUI ── */
+static int cmd_gui(char *arg) {
+    (void)arg;
+    return -4; /* switch to GUI */
+}
+
+/* ── Ask AI ── */
+static int cmd_ask(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
         screen_print("   ");
         screen_putchar((char)254);
-        screen_print(" Shutting down SwanOS...\n");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("   Goodbye.\n\n");
+        screen_print(" Usage: ask <question>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
-        return -1;
+        return 0;
     }
+    /* Show thinking indicator */
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" Thinking...\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
 
-    if (strcmp(cmd, "reboot") == 0) {
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print("\n   ");
-        screen_putchar((char)254);
-        screen_print(" Rebooting...\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return -2;
-    }
+    char response[2048];
+    llm_query(arg, response, sizeof(response));
 
-    /* ── Help ── */
-    if (strcmp(cmd, "help") == 0) { cmd_help(); return 0; }
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)6);
+    screen_print(" AI ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)16);
+    screen_print(" ");
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    screen_print(response);
+    screen_print("\n\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    /* ── Clear ── */
-    if (strcmp(cmd, "clear") == 0) {
-        screen_clear();
-        /* Show subtle brand watermark after clear */
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+/* ── Set API Key ── */
+static int cmd_setkey(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
         screen_print("   ");
-        screen_putchar((char)6);
-        screen_print(" SwanOS v3.0\n\n");
+        screen_putchar((char)254);
+        screen_print(" Usage: setkey <GROQ_API_KEY>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
+    llm_set_api_key(arg);
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)254);
+    screen_print(" API key saved.\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    /* ── GUI ── */
-    if (strcmp(cmd, "gui") == 0) {
-        return -4; /* switch to GUI */
+/* ── Check API Key ── */
+static int cmd_aikey(char *arg) {
+    (void)arg;
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    if (llm_ready()) {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
+        screen_putchar((char)254);
+        screen_print(" API key is configured.\n");
+    } else {
+        screen_set_color(VGA_YELLOW, VGA_BLACK);
+        screen_putchar((char)254);
+        screen_print(" No API key set. Use 'setkey <KEY>'.\n");
     }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    /* ── Ask AI ── */
-    if (strcmp(cmd, "ask") == 0) {
-        if (arg[0] == '\0') {
+/* ── Files ── */
+static int cmd_cd(char *arg) {
+    if (arg[0] == '\0') {
+        /* cd home if no arg */
+        strcpy(cwd, "/home/");
+        strcat(cwd, user_current());
+        return 0;
+    }
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+    if (fs_exists(abs_path)) {
+        /* Simple check: if fs_list succeeds, it's a dir */
+        int r = fs_list(abs_path, out_buf, 10);
+        if (r >= 0) {
+            strcpy(cwd, abs_path);
+        } else {
             screen_set_color(VGA_RED, VGA_BLACK);
             screen_print("   ");
             screen_putchar((char)254);
-            screen_print(" Usage: ask <question>\n");
+            screen_print(" Not a directory.\n");
             screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
         }
-        /* Show thinking indicator */
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
         screen_print("   ");
-        screen_putchar((char)250);
-        screen_print(" Thinking...\n");
+        screen_putchar((char)254);
+        screen_print(" Directory not found.\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
+    }
+    return 0;
+}
 
-        char response[2048];
-        llm_query(arg, response, sizeof(response));
+static int cmd_ls(char *arg) {
+    char abs_path[128];
+    resolve_path(arg[0] ? arg : ".", abs_path);
+    fs_list(abs_path, out_buf, OUT_BUF);
+    screen_print(out_buf);
+    return 0;
+}
 
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print("\n   ");
-        screen_putchar((char)6);
-        screen_print(" AI ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)16);
-        screen_print(" ");
-        screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
-        screen_print(response);
-        screen_print("\n\n");
+static int cmd_cat(char *arg) {
+    int piped = arg[0] == '\0';
+    if (piped && !pipe_in) {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: cat <filename>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
-
-    /* ── Set API Key ── */
-    if (strcmp(cmd, "setkey") == 0) {
-        if (arg[0] == '\0') {
+    fs_view_t v;
+    if (piped) {
+        pipe_view(&v);
+    } else {
+        char abs_path[128];
+        resolve_path(arg, abs_path);
+        if (fs_view(abs_path, &v) < 0) {
+            fs_read(abs_path, out_buf, OUT_BUF);   /* error text */
             screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: setkey <GROQ_API_KEY>\n");
+            screen_print("  ");
+            screen_print(out_buf);
+            screen_print("\n");
             screen_set_color(VGA_WHITE, VGA_BLACK);
             return 0;
         }
-        llm_set_api_key(arg);
-        screen_set_color(VGA_GREEN, VGA_BLACK);
+    }
+    /* Captured output stays byte-exact */
+    if (!out_captured) screen_print("  ");
+    for (int s = 0; s < v.n_seg; s++)
+        for (uint32_t i = 0; i < v.seg[s].len; i++) screen_putchar((char)v.seg[s].data[i]);
+    if (!piped) fs_view_release(&v);
+    if (!out_captured) screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+static int cmd_write(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
         screen_print("   ");
         screen_putchar((char)254);
-        screen_print(" API key saved.\n");
+        screen_print(" Usage: write <filename> <content>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
+    char *content = arg;
+    while (*content && !isspace(*content)) content++;
+    if (*content) { *content = '\0'; content++; }
+    content = trim(content);
 
-    /* ── Check API Key ── */
-    if (strcmp(cmd, "aikey") == 0) {
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    if (content[0] == '\0' && !pipe_in) {    /* or the piped input */
+        screen_set_color(VGA_RED, VGA_BLACK);
         screen_print("   ");
-        screen_putchar((char)250);
-        screen_print(" ");
-        if (llm_ready()) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_putchar((char)254);
-            screen_print(" API key is configured.\n");
-        } else {
-            screen_set_color(VGA_YELLOW, VGA_BLACK);
-            screen_putchar((char)254);
-            screen_print(" No API key set. Use 'setkey <KEY>'.\n");
-        }
+        screen_putchar((char)254);
+        screen_print(" Usage: write <filename> <content>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
 
-    /* ── Files ── */
-    if (strcmp(cmd, "cd") == 0) {
-        if (arg[0] == '\0') {
-            /* cd home if no arg */
-            strcpy(cwd, "/home/");
-            strcat(cwd, user_current());
-            return 0;
-        }
-        char abs_path[128];
-        resolve_path(arg, abs_path);
-        if (fs_exists(abs_path)) {
-            /* Simple check: if fs_list succeeds, it's a dir */
-            int r = fs_list(abs_path, out_buf, 10);
-            if (r >= 0) {
-                strcpy(cwd, abs_path);
-            } else {
-                screen_set_color(VGA_RED, VGA_BLACK);
-                screen_print("   ");
-                screen_putchar((char)254);
-                screen_print(" Not a directory.\n");
-                screen_set_color(VGA_WHITE, VGA_BLACK);
-            }
-        } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Directory not found.\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-        }
-        return 0;
-    }
+    char abs_path[128];
+    resolve_path(arg, abs_path);
 
-    if (strcmp(cmd, "ls") == 0) {
-        char abs_path[128];
-        resolve_path(arg[0] ? arg : ".", abs_path);
-        fs_list(abs_path, out_buf, OUT_BUF);
-        screen_print(out_buf);
-        return 0;
+    if ((content[0] ? fs_write(abs_path, content)
+                    : fs_write_bytes(abs_path, pipe_in, pipe_in_len)) == 0) {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Written: ");
+        screen_print(arg);
+        screen_print("\n");
+        audit_log(AUDIT_FILE_WRITE, arg);
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Write failed.\n");
     }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    if (strcmp(cmd, "cat") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: cat <filename>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char abs_path[128];
-        resolve_path(arg, abs_path);
-        int r = fs_read(abs_path, out_buf, OUT_BUF);
-        if (r < 0) screen_set_color(VGA_RED, VGA_BLACK);
-        screen_print("  ");
-        screen_print(out_buf);
-        screen_print("\n");
+static int cmd_append(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: append <filename> <text>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
-
-    if (strcmp(cmd, "write") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: write <filename> <content>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char *content = arg;
-        while (*content && !isspace(*content)) content++;
-        if (*content) { *content = '\0'; content++; }
-        content = trim(content);
-
-        if (content[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: write <filename> <content>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-
-        char abs_path[128];
-        resolve_path(arg, abs_path);
-
-        if (fs_write(abs_path, content) == 0) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Written: ");
-            screen_print(arg);
-            screen_print("\n");
-            audit_log(AUDIT_FILE_WRITE, arg);
-        } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Write failed.\n");
-        }
+    char *content = arg;
+    while (*content && !isspace(*content)) content++;
+    if (*content) { *content = '\0'; content++; }
+    content = trim(content);
+    if (content[0] == '\0' && !pipe_in) {    /* or the piped input */
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: append <filename> <text>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
-
-    if (strcmp(cmd, "append") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: append <filename> <text>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char *content = arg;
-        while (*content && !isspace(*content)) content++;
-        if (*content) { *content = '\0'; content++; }
-        content = trim(content);
-        if (content[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: append <filename> <text>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char abs_path[128];
-        resolve_path(arg, abs_path);
-        
-        if (fs_append(abs_path, content) == 0) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Appended to ");
-            screen_print(arg);
-            screen_print("\n");
-        } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Append failed.\n");
-        }
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+    
+    if ((content[0] ? fs_append(abs_path, content)
+                    : fs_append_bytes(abs_path, pipe_in, pipe_in_len)) == 0) {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Appended to ");
+        screen_print(arg);
+        screen_print("\n");
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Append failed.\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+static int cmd_cp(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: cp <source> <destination>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
+    char *dst = arg;
+    while (*dst && !isspace(*dst)) dst++;
+    if (*dst) { *dst = '\0'; dst++; }
+    dst = trim(dst);
+    if (dst[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: cp <source> <destination>\n");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        return 0;
+    }
+    char abs_src[128], abs_dst[128];
+    resolve_path(arg, abs_src);
+    resolve_path(dst, abs_dst);
 
-    if (strcmp(cmd, "cp") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: cp <source> <destination>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char *dst = arg;
-        while (*dst && !isspace(*dst)) dst++;
-        if (*dst) { *dst = '\0'; dst++; }
-        dst = trim(dst);
-        if (dst[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: cp <source> <destination>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char abs_src[128], abs_dst[128];
-        resolve_path(arg, abs_src);
-        resolve_path(dst, abs_dst);
+    if (fs_copy(abs_src, abs_dst) == 0) {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Copied ");
+        screen_print(arg);
+        screen_print(" -> ");
+        screen_print(dst);
+        screen_print("\n");
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Copy failed.\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-        if (fs_copy(abs_src, abs_dst) == 0) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Copied ");
-            screen_print(arg);
-            screen_print(" -> ");
-            screen_print(dst);
-            screen_print("\n");
-        } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Copy failed.\n");
-        }
+static int cmd_mv(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: mv <file> <newname>\n");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        return 0;
+    }
+    char *newname = arg;
+    while (*newname && !isspace(*newname)) newname++;
+    if (*newname) { *newname = '\0'; newname++; }
+    newname = trim(newname);
+    if (newname[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: mv <file> <newname>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
-
-    if (strcmp(cmd, "mv") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: mv <file> <newname>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char *newname = arg;
-        while (*newname && !isspace(*newname)) newname++;
-        if (*newname) { *newname = '\0'; newname++; }
-        newname = trim(newname);
-        if (newname[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: mv <file> <newname>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
+    
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+    
+    /* Note: mv only renames inside current directory for now, 
+       because fs.c rename doesn't support changing parents yet.
+       We pass abs_path as source, and base newname as destination. */
+    if (fs_rename(abs_path, newname) == 0) {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Renamed to ");
+        screen_print(newname);
+        screen_print("\n");
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Rename failed.\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+static int cmd_mkdir(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: mkdir <dirname>\n");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        return 0;
+    }
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+
+    if (fs_mkdir(abs_path) == 0) {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Created: ");
+        screen_print(arg);
+        screen_print("\n");
+        audit_log(AUDIT_FILE_CREATE, arg);
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Failed (exists?).\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+static int cmd_rm(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: rm <filename>\n");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        return 0;
+    }
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+
+    int r = fs_delete(abs_path);
+    if (r == 0) {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Deleted: ");
+        screen_print(arg);
+        screen_print("\n");
+        audit_log(AUDIT_FILE_DELETE, arg);
+    } else if (r == -2) {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Directory not empty.\n");
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Not found.\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+static int cmd_hexdump(char *arg) {
+    if (arg[0] == '\0' && pipe_in) {
+        fs_view_t v;
+        pipe_view(&v);
+        hexdump_view(&v);
+        return 0;
+    }
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: hexdump <filename>\n");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        return 0;
+    }
+    hexdump_file(arg);
+    return 0;
+}
+
+/* ── Calc ── */
+static int cmd_calc(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Usage: calc <expression>\n");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        return 0;
+    }
+    int result = calc_eval(arg);
+    char num_buf[32];
+    itoa(result, num_buf, 10);
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_print("   = ");
+    screen_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+    screen_print(num_buf);
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+/* ── Echo ── */
+static int cmd_echo(char *arg) {
+    if (!out_captured) screen_print("  ");
+    screen_print(arg);
+    screen_print("\n");
+    return 0;
+}
+
+/* ── Stream filters ── */
+/* Calls fn(line, len) for each line of the piped input */
+static void for_each_line(void (*fn)(const char *line, int len, void *ctx), void *ctx) {
+    const char *p = pipe_in, *end = pipe_in + pipe_in_len;
+    while (p < end) {
+        const char *nl = p;
+        while (nl < end && *nl != '\n') nl++;
+        fn(p, (int)(nl - p), ctx);
+        p = nl < end ? nl + 1 : end;
+    }
+}
+
+static void print_line(const char *line, int len) {
+    for (int i = 0; i < len; i++) screen_putchar(line[i]);
+    screen_putchar('\n');
+}
+
+static void print_usage(const char *usage) {
+    screen_set_color(VGA_RED, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)254);
+    screen_print(" Usage: ");
+    screen_print(usage);
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+}
+
+/* Filters only make sense at the end of a pipe */
+static int need_input(const char *usage) {
+    if (pipe_in) return 1;
+    print_usage(usage);
+    return 0;
+}
+
+static void grep_line(const char *line, int len, void *ctx) {
+    const char *pat = ctx;
+    int plen = strlen(pat);
+    for (int i = 0; i + plen <= len; i++) {
+        if (strncmp(line + i, pat, plen) == 0) { print_line(line, len); return; }
+    }
+}
+
+static int cmd_grep(char *arg) {
+    if (arg[0] == '\0') { print_usage("<cmd> | grep <text>"); return 0; }
+    if (!need_input("<cmd> | grep <text>")) return 0;
+    for_each_line(grep_line, arg);
+    return 0;
+}
+
+static void head_line(const char *line, int len, void *ctx) {
+    int *left = ctx;
+    if (*left > 0) { print_line(line, len); (*left)--; }
+}
+
+static int cmd_head(char *arg) {
+    if (!need_input("<cmd> | head [lines]")) return 0;
+    int left = arg[0] ? atoi(arg) : 10;
+    for_each_line(head_line, &left);
+    return 0;
+}
+
+static void count_line(const char *line, int len, void *ctx) {
+    uint32_t *n = ctx;
+    n[0]++;
+    for (int i = 0, in_word = 0; i < len; i++) {
+        int sp = isspace(line[i]);
+        if (!sp && !in_word) n[1]++;
+        in_word = !sp;
+    }
+}
+
+static int cmd_wc(char *arg) {
+    (void)arg;
+    if (!need_input("<cmd> | wc")) return 0;
+    uint32_t n[2] = { 0, 0 };
+    for_each_line(count_line, n);
+    char buf[12];
+    if (!out_captured) screen_print("   ");
+    itoa(n[0], buf, 10); screen_print(buf); screen_print(" lines, ");
+    itoa(n[1], buf, 10); screen_print(buf); screen_print(" words, ");
+    itoa(pipe_in_len, buf, 10); screen_print(buf); screen_print(" bytes\n");
+    return 0;
+}
+
+/* ── Snake ── */
+static int cmd_snake(char *arg) {
+    (void)arg;
+    game_snake();
+    return 0;
+}
+
+/* ── Whoami ── */
+static int cmd_whoami(char *arg) {
+    (void)arg;
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)218);
+    for (int i = 0; i < 36; i++) screen_putchar((char)196);
+    screen_putchar((char)191);
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print(" User  : ");
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_print(user_current());
+    int ulen = strlen(user_current());
+    for (int i = ulen; i < 25; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)179);
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print(" OS    : ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("SwanOS v3.0 (bare-metal)");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)179);
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print(" Arch  : ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("x86 (i686)              ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)179);
+    screen_print("\n   ");
+    screen_putchar((char)192);
+    for (int i = 0; i < 36; i++) screen_putchar((char)196);
+    screen_putchar((char)217);
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+/* ── Date ── */
+static int cmd_date(char *arg) {
+    (void)arg;
+    rtc_time_t t;
+    time_now(&t);
+    char date_buf[12], time_buf[10], day_buf[4];
+    rtc_format_date(&t, date_buf);
+    rtc_format_time(&t, time_buf);
+    rtc_format_weekday(&t, day_buf);
+
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print(day_buf);
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("  ");
+    screen_putchar((char)250);
+    screen_print("  ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print(date_buf);
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("  ");
+    screen_putchar((char)250);
+    screen_print("  ");
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_print(time_buf);
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+/* ── Mem ── */
+static int cmd_mem(char *arg) {
+    (void)arg;
+    char buf[32];
+    /* Header */
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)218);
+    for (int i = 0; i < 40; i++) screen_putchar((char)196);
+    screen_putchar((char)191);
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print("  ");
+    screen_putchar((char)254);
+    screen_print(" Memory Usage");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("                         ");
+    screen_putchar((char)179);
+    screen_print("\n   ");
+    screen_putchar((char)195);
+    for (int i = 0; i < 40; i++) screen_putchar((char)196);
+    screen_putchar((char)180);
+
+    /* Total */
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Total : ");
+    itoa(mem_total() / 1024, buf, 10);
+    screen_print(buf);
+    screen_print(" KB");
+    int pad = 28 - strlen(buf) - 3;
+    for (int i = 0; i < pad; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)179);
+
+    /* Used */
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Used  : ");
+    itoa(mem_used() / 1024, buf, 10);
+    screen_print(buf);
+    screen_print(" KB");
+    pad = 28 - strlen(buf) - 3;
+    for (int i = 0; i < pad; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)179);
+
+    /* Free */
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_print("  Free  : ");
+    itoa(mem_free() / 1024, buf, 10);
+    screen_print(buf);
+    screen_print(" KB");
+    pad = 28 - strlen(buf) - 3;
+    for (int i = 0; i < pad; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)179);
+
+    /* Bar graph */
+    int pct = (int)((mem_used() * 100) / mem_total());
+    screen_print("\n   ");
+    screen_putchar((char)179);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  [");
+    int bars = pct / 5;
+    screen_set_color(pct > 80 ? VGA_RED : pct > 50 ? VGA_YELLOW : VGA_GREEN, VGA_BLACK);
+    for (int i = 0; i < 20; i++) {
+        screen_putchar(i < bars ? (char)219 : (char)176);
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("] ");
+    itoa(pct, buf, 10);
+    screen_print(buf);
+    screen_print("%");
+    pad = 13 - strlen(buf);
+    for (int i = 0; i < pad; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)179);
+
+    /* Bottom border */
+    screen_print("\n   ");
+    screen_putchar((char)192);
+    for (int i = 0; i < 40; i++) screen_putchar((char)196);
+    screen_putchar((char)217);
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+/* ── Status ── */
+static int cmd_status(char *arg) {
+    (void)arg;
+    uint32_t secs = timer_get_seconds();
+    uint32_t mins = secs / 60;
+    uint32_t hrs = mins / 60;
+    secs %= 60; mins %= 60;
+
+    rtc_time_t t;
+    time_now(&t);
+    char date_buf[12], time_buf[10];
+    rtc_format_date(&t, date_buf);
+    rtc_format_time(&t, time_buf);
+    char buf[16];
+
+    /* Boxed status display */
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)201);
+    for (int i = 0; i < 44; i++) screen_putchar((char)205);
+    screen_putchar((char)187);
+
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print("  ");
+    screen_putchar((char)6);
+    screen_print(" SwanOS v3.0 ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)250);
+    screen_print("  ");
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    screen_print("System Status           ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    screen_print("\n   ");
+    screen_putchar((char)204);
+    for (int i = 0; i < 44; i++) screen_putchar((char)205);
+    screen_putchar((char)185);
+
+    /* User */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  User   : ");
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_print(user_current());
+    int ulen = strlen(user_current());
+    for (int i = ulen; i < 31; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    /* Arch */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Arch   : x86 (i686)                  ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    /* Uptime */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Uptime : ");
+    itoa(hrs, buf, 10); screen_print(buf); screen_print("h ");
+    itoa(mins, buf, 10); screen_print(buf); screen_print("m ");
+    itoa(secs, buf, 10); screen_print(buf); screen_print("s");
+    /* rough padding */
+    screen_print("                       ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    /* Date */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Date   : ");
+    screen_print(date_buf); screen_print("  "); screen_print(time_buf);
+    screen_print("              ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    /* Memory */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Memory : ");
+    itoa(mem_used() / 1024, buf, 10); screen_print(buf); screen_print(" / ");
+    itoa(mem_total() / 1024, buf, 10); screen_print(buf); screen_print(" KB");
+    screen_print("                  ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    /* LLM */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  LLM    : Groq (via serial bridge)    ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    /* Status */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Status : ");
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_putchar((char)254);
+    screen_print(" ONLINE                       ");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
+
+    /* Bottom */
+    screen_print("\n   ");
+    screen_putchar((char)200);
+    for (int i = 0; i < 44; i++) screen_putchar((char)205);
+    screen_putchar((char)188);
+    screen_print("\n");
+    print_irq_stats();
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+/* ── Time ── */
+static int cmd_time(char *arg) {
+    (void)arg;
+    uint32_t secs = timer_get_seconds();
+    uint32_t mins = secs / 60;
+    uint32_t hrs = mins / 60;
+    secs %= 60; mins %= 60;
+    char buf[16];
+
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("Uptime: ");
+    itoa(hrs, buf, 10); screen_print(buf); screen_print("h ");
+    itoa(mins, buf, 10); screen_print(buf); screen_print("m ");
+    itoa(secs, buf, 10); screen_print(buf); screen_print("s\n");
+    return 0;
+}
+
+/* ── Telemetry ── */
+static int cmd_telemetry(char *arg) {
+    char buf[16];
+    if (arg[0] != '\0') telemetry_set_rate(atoi(arg));
+
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("Rate: ");
+    itoa(telemetry_get_rate(), buf, 10); screen_print(buf); screen_print(" Hz  Samples: ");
+    itoa(telemetry_samples(), buf, 10); screen_print(buf); screen_print("  Dropped: ");
+    itoa(telemetry_dropped(), buf, 10); screen_print(buf); screen_print("  Sent: ");
+    itoa(telemetry_bytes_sent(), buf, 10); screen_print(buf); screen_print(" B\n");
+    return 0;
+}
+
+/* ── Trace: trace [on|off|clear|send|stream on|stream off|N] ── */
+static int cmd_trace(char *arg) {
+    char buf[16];
+    int show = 20;
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+
+    if (strcmp(arg, "on") == 0 || strcmp(arg, "off") == 0) {
+        trace_set_enabled(arg[1] == 'n');
+        screen_print(arg[1] == 'n' ? "Tracing on\n" : "Tracing off\n");
+        return 0;
+    }
+    if (strcmp(arg, "clear") == 0) {
+        trace_clear();
+        screen_print("Trace cleared\n");
+        return 0;
+    }
+    if (strcmp(arg, "send") == 0) {
+        if (!llm_bridge_connected()) {
+            screen_print("Bridge not connected\n");
             return 0;
         }
-        
-        char abs_path[128];
-        resolve_path(arg, abs_path);
-        
-        /* Note: mv only renames inside current directory for now, 
-           because fs.c rename doesn't support changing parents yet.
-           We pass abs_path as source, and base newname as destination. */
-        if (fs_rename(abs_path, newname) == 0) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Renamed to ");
-            screen_print(newname);
-            screen_print("\n");
-        } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Rename failed.\n");
-        }
-        screen_set_color(VGA_WHITE, VGA_BLACK);
+        itoa(trace_send(), buf, 10); screen_print(buf);
+        screen_print(" events sent to host\n");
+        return 0;
+    }
+    if (strcmp(arg, "stream on") == 0 || strcmp(arg, "stream off") == 0) {
+        trace_set_stream(arg[8] == 'n');
+        screen_print(arg[8] == 'n' ? "Streaming to host\n" : "Streaming stopped\n");
         return 0;
     }
+    if (arg[0] != '\0') show = atoi(arg);
+    if (show < 1) show = 1;
+
+    screen_print("Events: ");
+    itoa((int)trace_count(), buf, 10); screen_print(buf); screen_print("  Lost: ");
+    itoa((int)trace_lost(), buf, 10); screen_print(buf);
+    screen_print(trace_enabled ? "  [on]" : "  [off]");
+    screen_print(trace_streaming() ? "  [streaming]\n" : "\n");
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    trace_format_recent(out_buf, OUT_BUF, show);
+    screen_print(out_buf);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    if (strcmp(cmd, "mkdir") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: mkdir <dirname>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char abs_path[128];
-        resolve_path(arg, abs_path);
+/* ── Profiler: prof [start [hz]|stop|top [N]] ── */
+static int cmd_prof(char *arg) {
+    char buf[16];
+    int show = 15;
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
 
-        if (fs_mkdir(abs_path) == 0) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Created: ");
-            screen_print(arg);
-            screen_print("\n");
-            audit_log(AUDIT_FILE_CREATE, arg);
-        } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Failed (exists?).\n");
+    if (strncmp(arg, "start", 5) == 0) {
+        int hz = arg[5] ? atoi(arg + 5) : (int)timer_get_frequency();
+        int got = prof_start(hz);
+        if (got < 0) {
+            screen_print("No kernel symbol table in this build\n");
+            return 0;
         }
-        screen_set_color(VGA_WHITE, VGA_BLACK);
+        screen_print("Sampling at ");
+        itoa(got, buf, 10); screen_print(buf); screen_print(" Hz\n");
         return 0;
     }
+    if (strcmp(arg, "stop") == 0) prof_stop();
+    else if (strncmp(arg, "top", 3) == 0 && arg[3]) show = atoi(arg + 3);
+
+    screen_print("Samples: ");
+    itoa((int)prof_samples(), buf, 10); screen_print(buf);
+    if (prof_running) {
+        screen_print("  [running @ ");
+        itoa(prof_rate(), buf, 10); screen_print(buf); screen_print(" Hz]");
+    }
+    screen_print("\n");
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    prof_format_top(out_buf, OUT_BUF, show);
+    screen_print(out_buf);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    if (strcmp(cmd, "rm") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: rm <filename>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char abs_path[128];
-        resolve_path(arg, abs_path);
+/* ── NIC: net [bridge <ip> [port]|gw|on|off] ── */
+static int cmd_net(char *arg) {
+    char buf[16];
+    net_status_t *ns = net_get_status();
+    netdev_t *dev = netdev_get();
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
 
-        int r = fs_delete(abs_path);
-        if (r == 0) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Deleted: ");
-            screen_print(arg);
-            screen_print("\n");
-            audit_log(AUDIT_FILE_DELETE, arg);
-        } else if (r == -2) {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Directory not empty.\n");
+    if (strncmp(arg, "bridge", 6) == 0) {
+        const char *a = arg + 6;
+        while (*a == ' ') a++;
+        ip4_t ip;
+        if (!inet_up()) {
+            screen_print("No TCP/IP stack (no network driver)\n");
+        } else if (strcmp(a, "off") == 0 || strcmp(a, "on") == 0) {
+            bridge_tcp_enable(a[1] == 'n');
+            screen_print(a[1] == 'n' ? "Bridge link enabled\n" : "Bridge link off, using serial\n");
+        } else if (strcmp(a, "gw") == 0) {
+            bridge_tcp_set_target(0, 0);
+            screen_print("Bridge link to the gateway\n");
+        } else if (ip4_parse(a, &ip) == 0) {
+            const char *p = a;
+            while (*p && *p != ' ') p++;
+            bridge_tcp_set_target(ip, (uint16_t)atoi(p));
+            screen_print("Bridge link retargeted\n");
         } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Not found.\n");
+            screen_print("Usage: net bridge <a.b.c.d> [port] | gw | on | off\n");
         }
-        screen_set_color(VGA_WHITE, VGA_BLACK);
         return 0;
     }
-
-    if (strcmp(cmd, "hexdump") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: hexdump <filename>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        cmd_hexdump(arg);
+    screen_print(ns->nic_name);
+    if (!dev) {
+        screen_print(ns->detected ? "  (no driver)\n" : "\n");
         return 0;
     }
+    screen_print("  ");
+    screen_print(ns->mac_addr);
+    screen_print(dev->link_up ? "  link up\n" : "  link down\n");
 
-    /* ── Calc ── */
-    if (strcmp(cmd, "calc") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: calc <expression>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
+    net_stats_t st;
+    net_get_stats(&st);
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    screen_print("     RX: ");
+    itoa((int)st.rx_packets, buf, 10); screen_print(buf); screen_print(" pkts ");
+    itoa((int)st.rx_bytes, buf, 10); screen_print(buf); screen_print(" B, ");
+    itoa((int)st.rx_dropped, buf, 10); screen_print(buf); screen_print(" dropped\n");
+    screen_print("     TX: ");
+    itoa((int)st.tx_packets, buf, 10); screen_print(buf); screen_print(" pkts ");
+    itoa((int)st.tx_bytes, buf, 10); screen_print(buf); screen_print(" B, ");
+    itoa((int)st.tx_full, buf, 10); screen_print(buf); screen_print(" ring full\n");
+    screen_print("     IRQs: ");
+    itoa((int)st.irqs, buf, 10); screen_print(buf);
+    screen_print("  polls: ");
+    itoa((int)st.polls, buf, 10); screen_print(buf);
+    screen_print("  free buffers: ");
+    itoa(netbuf_available(), buf, 10); screen_print(buf);
+    screen_print("\n");
+
+    if (inet_up()) {
+        const inet_config_t *cfg = inet_config();
+        screen_print("     IP: ");
+        if (cfg->configured) {
+            screen_print(ip4_format(cfg->addr, buf)); screen_print(" mask ");
+            screen_print(ip4_format(cfg->mask, buf)); screen_print(" gw ");
+            screen_print(ip4_format(cfg->gateway, buf));
+            screen_print(dhcp_bound() ? " (DHCP)\n" : "\n");
+        } else {
+            screen_print("waiting for DHCP\n");
         }
-        int result = calc_eval(arg);
-        char num_buf[32];
-        itoa(result, num_buf, 10);
-        screen_set_color(VGA_GREEN, VGA_BLACK);
-        screen_print("   = ");
-        screen_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
-        screen_print(num_buf);
+        inet_stats_t is;
+        inet_get_stats(&is);
+        screen_print("     IP in/out/bad: ");
+        itoa((int)is.ip_rx, buf, 10); screen_print(buf); screen_print("/");
+        itoa((int)is.ip_tx, buf, 10); screen_print(buf); screen_print("/");
+        itoa((int)is.ip_bad, buf, 10); screen_print(buf);
+        screen_print("  ARP misses: ");
+        itoa((int)is.arp_miss, buf, 10); screen_print(buf);
+        screen_print("  pings: ");
+        itoa((int)is.icmp_echo, buf, 10); screen_print(buf);
         screen_print("\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return 0;
-    }
 
-    /* ── Echo ── */
-    if (strcmp(cmd, "echo") == 0) {
-        screen_print("  ");
-        screen_print(arg);
+        bridge_tcp_status_t bs;
+        bridge_tcp_get_status(&bs);
+        screen_print("     Bridge: via ");
+        screen_print(bridge_transport_name());
+        screen_print("  link ");
+        screen_print(bs.enabled ? tcp_state_name(bs.state) : "off");
+        screen_print(" -> ");
+        screen_print(bs.host ? ip4_format(bs.host, buf) : "gateway");
+        screen_print(":");
+        itoa(bs.port, buf, 10); screen_print(buf);
+        screen_print("  connects: ");
+        itoa((int)bs.connects, buf, 10); screen_print(buf);
         screen_print("\n");
-        return 0;
     }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    /* ── Snake ── */
-    if (strcmp(cmd, "snake") == 0) {
-        game_snake();
-        return 0;
-    }
+/* ── PCI registry: lspci ── */
+static int cmd_lspci(char *arg) {
+    (void)arg;
+    char buf[16];
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    itoa(pci_count(), buf, 10); screen_print(buf);
+    screen_print(" devices on ");
+    itoa(pci_bus_count(), buf, 10); screen_print(buf);
+    screen_print(pci_bus_count() == 1 ? " bus\n" : " buses\n");
 
-    /* ── Whoami ── */
-    if (strcmp(cmd, "whoami") == 0) {
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("   ");
-        screen_putchar((char)218);
-        for (int i = 0; i < 36; i++) screen_putchar((char)196);
-        screen_putchar((char)191);
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print(" User  : ");
-        screen_set_color(VGA_GREEN, VGA_BLACK);
-        screen_print(user_current());
-        int ulen = strlen(user_current());
-        for (int i = ulen; i < 25; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)179);
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print(" OS    : ");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("SwanOS v3.0 (bare-metal)");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)179);
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print(" Arch  : ");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("x86 (i686)              ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)179);
-        screen_print("\n   ");
-        screen_putchar((char)192);
-        for (int i = 0; i < 36; i++) screen_putchar((char)196);
-        screen_putchar((char)217);
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    for (int i = 0; i < pci_count(); i++) {
+        const pci_device_t *d = pci_get(i);
+        screen_print("     ");
+        itoa(d->bus, buf, 16); screen_print(buf); screen_print(":");
+        itoa(d->slot, buf, 16); screen_print(buf); screen_print(".");
+        itoa(d->func, buf, 10); screen_print(buf); screen_print("  ");
+        itoa(d->vendor, buf, 16); screen_print(buf); screen_print(":");
+        itoa(d->device, buf, 16); screen_print(buf); screen_print("  ");
+        screen_print(pci_class_name(d->class_code));
+        if (d->irq_pin && d->irq < 16) {
+            screen_print("  irq ");
+            itoa(d->irq, buf, 10); screen_print(buf);
+        }
+        for (int b = 0; b < PCI_BARS; b++) {
+            if (!d->bar_size[b]) continue;
+            screen_print((d->bar_io >> b) & 1 ? "  io 0x" : "  mem 0x");
+            itoa((int)d->bar[b], buf, 16); screen_print(buf);
+        }
         screen_print("\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return 0;
     }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    /* ── Date ── */
-    if (strcmp(cmd, "date") == 0) {
-        rtc_time_t t;
-        rtc_read(&t);
-        char date_buf[12], time_buf[10], day_buf[4];
-        rtc_format_date(&t, date_buf);
-        rtc_format_time(&t, time_buf);
-        rtc_format_weekday(&t, day_buf);
+/* ── AI policy: crash rules and scheduler hints ── */
+static int cmd_policy(char *arg) {
+    (void)arg;
+    char buf[16];
+    const kernel_ai_status_t *st = kernel_ai_get_status();
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    itoa(st->crash_decisions, buf, 10); screen_print(buf);
+    screen_print(" crash decisions, ");
+    itoa(st->crashes_queued, buf, 10); screen_print(buf);
+    screen_print(" awaiting review, ");
+    itoa(st->rules_learned, buf, 10); screen_print(buf);
+    screen_print(" rule updates, ");
+    itoa(st->hints_applied, buf, 10); screen_print(buf);
+    screen_print(" hints applied\n");
 
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("   ");
-        screen_putchar((char)250);
-        screen_print(" ");
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print(day_buf);
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("  ");
-        screen_putchar((char)250);
-        screen_print("  ");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print(date_buf);
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("  ");
-        screen_putchar((char)250);
-        screen_print("  ");
-        screen_set_color(VGA_GREEN, VGA_BLACK);
-        screen_print(time_buf);
-        screen_print("\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return 0;
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    ai_rule_t r;
+    for (int i = 0; kernel_ai_get_rule(i, &r) == 0; i++) {
+        screen_print("     ");
+        screen_print(r.proc[0] ? r.proc : "*");
+        screen_print(" / ");
+        screen_print(r.reason[0] ? r.reason : "*");
+        screen_print(r.restart ? "  -> RESTART" : "  -> TERMINATE");
+        screen_print(r.source == AI_RULE_LLM ? "  (llm, " : "  (local, ");
+        itoa(r.hits, buf, 10); screen_print(buf);
+        screen_print(" hits)\n");
     }
-
-    /* ── Mem ── */
-    if (strcmp(cmd, "mem") == 0) {
-        char buf[32];
-        /* Header */
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("\n   ");
-        screen_putchar((char)218);
-        for (int i = 0; i < 40; i++) screen_putchar((char)196);
-        screen_putchar((char)191);
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print("  ");
-        screen_putchar((char)254);
-        screen_print(" Memory Usage");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("                         ");
-        screen_putchar((char)179);
-        screen_print("\n   ");
-        screen_putchar((char)195);
-        for (int i = 0; i < 40; i++) screen_putchar((char)196);
-        screen_putchar((char)180);
-
-        /* Total */
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Total : ");
-        itoa(mem_total() / 1024, buf, 10);
+    ai_hint_t h;
+    for (int i = 0; kernel_ai_get_hint(i, &h) == 0; i++) {
+        screen_print("     hint ");
+        screen_print(h.proc);
+        screen_print(h.priority == PRIORITY_HIGH ? " = HIGH" :
+                     h.priority == PRIORITY_NORMAL ? " = NORMAL" : " = LOW");
+        screen_print(", ");
+        itoa((timer_get_ticks() - h.updated) / timer_get_frequency(), buf, 10);
         screen_print(buf);
-        screen_print(" KB");
-        int pad = 28 - strlen(buf) - 3;
-        for (int i = 0; i < pad; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)179);
+        screen_print(" s ago\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-        /* Used */
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Used  : ");
-        itoa(mem_used() / 1024, buf, 10);
-        screen_print(buf);
-        screen_print(" KB");
-        pad = 28 - strlen(buf) - 3;
-        for (int i = 0; i < pad; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)179);
+/* ── Mouse: mouse [rate N|res N] ── */
+static int cmd_mouse(char *arg) {
+    char buf[16];
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
 
-        /* Free */
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_GREEN, VGA_BLACK);
-        screen_print("  Free  : ");
-        itoa(mem_free() / 1024, buf, 10);
-        screen_print(buf);
-        screen_print(" KB");
-        pad = 28 - strlen(buf) - 3;
-        for (int i = 0; i < pad; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)179);
+    int bad = 0;
+    if (strncmp(arg, "rate", 4) == 0) bad = mouse_set_rate(atoi(arg + 4)) < 0;
+    else if (strncmp(arg, "res", 3) == 0) bad = mouse_set_resolution(atoi(arg + 3)) < 0;
+    if (bad) {
+        screen_print("Rate: 10/20/40/60/80/100/200 Hz, res: 1/2/4/8 counts/mm\n");
+        return 0;
+    }
 
-        /* Bar graph */
-        int pct = (int)((mem_used() * 100) / mem_total());
-        screen_print("\n   ");
-        screen_putchar((char)179);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  [");
-        int bars = pct / 5;
-        screen_set_color(pct > 80 ? VGA_RED : pct > 50 ? VGA_YELLOW : VGA_GREEN, VGA_BLACK);
-        for (int i = 0; i < 20; i++) {
-            screen_putchar(i < bars ? (char)219 : (char)176);
-        }
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("] ");
-        itoa(pct, buf, 10);
-        screen_print(buf);
-        screen_print("%");
-        pad = 13 - strlen(buf);
-        for (int i = 0; i < pad; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)179);
+    itoa(mouse_rate(), buf, 10); screen_print(buf); screen_print(" Hz, ");
+    itoa(mouse_resolution(), buf, 10); screen_print(buf); screen_print(" counts/mm, ");
+    screen_print(mouse_has_wheel() ? "wheel\n" : "no wheel\n");
+    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+    screen_print("     Packets: ");
+    itoa((int)mouse_packets(), buf, 10); screen_print(buf);
+    screen_print("  coalesced: ");
+    itoa((int)input_coalesced(), buf, 10); screen_print(buf);
+    screen_print("  dropped: ");
+    itoa((int)input_dropped(), buf, 10); screen_print(buf);
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-        /* Bottom border */
-        screen_print("\n   ");
-        screen_putchar((char)192);
-        for (int i = 0; i < 40; i++) screen_putchar((char)196);
-        screen_putchar((char)217);
-        screen_print("\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
+/* ── Sync ── */
+static int cmd_sync(char *arg) {
+    (void)arg;
+    char buf[16];
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)250);
+    screen_print(" ");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    if (fs_sync() < 0) {
+        screen_print("No disk: filesystem is RAM-only\n");
         return 0;
     }
+    screen_print("Synced. Blocks written: ");
+    itoa(fs_blocks_written(), buf, 10); screen_print(buf); screen_print("  Errors: ");
+    itoa(fs_sync_errors(), buf, 10); screen_print(buf); screen_print("\n");
+    return 0;
+}
 
-    /* ── Status ── */
-    if (strcmp(cmd, "status") == 0) {
-        uint32_t secs = timer_get_seconds();
-        uint32_t mins = secs / 60;
-        uint32_t hrs = mins / 60;
-        secs %= 60; mins %= 60;
-
-        rtc_time_t t;
-        rtc_read(&t);
-        char date_buf[12], time_buf[10];
-        rtc_format_date(&t, date_buf);
-        rtc_format_time(&t, time_buf);
-        char buf[16];
+/* ── History ── */
+static int cmd_history(char *arg) {
+    (void)arg;
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)254);
+    screen_print(" Command History\n");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("   ");
+    for (int i = 0; i < 40; i++) screen_putchar((char)196);
+    screen_print("\n");
 
-        /* Boxed status display */
+    int start = hist_count > HIST_SIZE ? hist_count - HIST_SIZE : 0;
+    for (int i = start; i < hist_count; i++) {
+        char nb[8];
+        itoa(i + 1, nb, 10);
         screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("\n   ");
-        screen_putchar((char)201);
-        for (int i = 0; i < 44; i++) screen_putchar((char)205);
-        screen_putchar((char)187);
-
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_CYAN, VGA_BLACK);
+        screen_print("   ");
+        if (i + 1 < 10) screen_putchar(' ');
+        screen_print(nb);
         screen_print("  ");
-        screen_putchar((char)6);
-        screen_print(" SwanOS v3.0 ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
         screen_putchar((char)250);
-        screen_print("  ");
-        screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
-        screen_print("System Status           ");
+        screen_print(" ");
+        screen_set_color(VGA_WHITE, VGA_BLACK);
+        screen_print(history[i % HIST_SIZE]);
+        screen_print("\n");
+    }
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
+
+/* ── Audit ── */
+static int cmd_audit(char *arg) {
+    (void)arg;
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)201);
+    for (int i = 0; i < 54; i++) screen_putchar((char)205);
+    screen_putchar((char)187);
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print("  ");
+    screen_putchar((char)254);
+    screen_print(" Audit Log");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("                                         ");
+    screen_putchar((char)186);
+    screen_print("\n   ");
+    screen_putchar((char)200);
+    for (int i = 0; i < 54; i++) screen_putchar((char)205);
+    screen_putchar((char)188);
+    screen_print("\n");
+
+    int cnt = audit_get_count();
+    if (cnt == 0) {
+        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+        screen_print("   No audit events recorded.\n");
+    } else {
+        int show = cnt > 10 ? 10 : cnt;
+        int total_avail = cnt > AUDIT_MAX_ENTRIES ? AUDIT_MAX_ENTRIES : cnt;
+        int start_idx = total_avail - show;
+        for (int i = start_idx; i < total_avail; i++) {
+            const audit_entry_t *e = audit_get_entry(i);
+            if (!e || !e->used) continue;
+            screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+            screen_print("   ");
+            char tmp[8];
+            screen_print("[");
+            if (e->hour < 10) screen_putchar('0');
+            itoa(e->hour, tmp, 10); screen_print(tmp);
+            screen_putchar(':');
+            if (e->minute < 10) screen_putchar('0');
+            itoa(e->minute, tmp, 10); screen_print(tmp);
+            screen_putchar(':');
+            if (e->second < 10) screen_putchar('0');
+            itoa(e->second, tmp, 10); screen_print(tmp);
+            screen_print("] ");
+
+            /* Color by event type */
+            uint8_t ec = VGA_WHITE;
+            switch (e->type) {
+                case AUDIT_LOGIN:       ec = VGA_GREEN; break;
+                case AUDIT_LOGOUT:      ec = VGA_YELLOW; break;
+                case AUDIT_FILE_CREATE: ec = VGA_LIGHT_CYAN; break;
+                case AUDIT_FILE_DELETE: ec = VGA_RED; break;
+                case AUDIT_APP_OPEN:    ec = VGA_CYAN; break;
+                case AUDIT_APP_CLOSE:   ec = VGA_DARK_GREY; break;
+                case AUDIT_COMMAND:     ec = VGA_WHITE; break;
+                case AUDIT_FILE_WRITE:  ec = VGA_LIGHT_GREEN; break;
+                case AUDIT_SYSTEM:      ec = VGA_LIGHT_MAGENTA; break;
+            }
+            screen_set_color(ec, VGA_BLACK);
+            screen_print(audit_type_name(e->type));
+            screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+            screen_print(" ");
+            screen_set_color(VGA_GREEN, VGA_BLACK);
+            screen_print(e->user);
+            if (e->detail[0]) {
+                screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+                screen_print(": ");
+                screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
+                screen_print(e->detail);
+            }
+            screen_print("\n");
+        }
         screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
-
-        screen_print("\n   ");
-        screen_putchar((char)204);
-        for (int i = 0; i < 44; i++) screen_putchar((char)205);
-        screen_putchar((char)185);
+        screen_print("\n   Total events: ");
+        char tcnt[8]; itoa(cnt, tcnt, 10);
+        screen_print(tcnt);
+        screen_print("\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("\n");
+    return 0;
+}
 
-        /* User */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  User   : ");
-        screen_set_color(VGA_GREEN, VGA_BLACK);
-        screen_print(user_current());
-        int ulen = strlen(user_current());
-        for (int i = ulen; i < 31; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+/* ── Profile ── */
+static int cmd_profile(char *arg) {
+    (void)arg;
+    user_profile_t *p = user_get_profile();
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)201);
+    for (int i = 0; i < 44; i++) screen_putchar((char)205);
+    screen_putchar((char)187);
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_CYAN, VGA_BLACK);
+    screen_print("  ");
+    screen_putchar((char)4);
+    screen_print(" User Profile");
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_print("                             ");
+    screen_putchar((char)186);
+    screen_print("\n   ");
+    screen_putchar((char)204);
+    for (int i = 0; i < 44; i++) screen_putchar((char)205);
+    screen_putchar((char)185);
 
-        /* Arch */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Arch   : x86 (i686)                  ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+    /* Username */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Name     : ");
+    screen_set_color(VGA_GREEN, VGA_BLACK);
+    screen_print(user_current());
+    int upad = 29 - (int)strlen(user_current());
+    for (int i = 0; i < upad; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
 
-        /* Uptime */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Uptime : ");
-        itoa(hrs, buf, 10); screen_print(buf); screen_print("h ");
-        itoa(mins, buf, 10); screen_print(buf); screen_print("m ");
-        itoa(secs, buf, 10); screen_print(buf); screen_print("s");
-        /* rough padding */
-        screen_print("                       ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+    /* Login count */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Logins   : ");
+    screen_set_color(VGA_YELLOW, VGA_BLACK);
+    char lc[8]; itoa(p->login_count, lc, 10);
+    screen_print(lc);
+    int lpad = 29 - (int)strlen(lc);
+    for (int i = 0; i < lpad; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
 
-        /* Date */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Date   : ");
-        screen_print(date_buf); screen_print("  "); screen_print(time_buf);
-        screen_print("              ");
+    /* Last login */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Last     : ");
+    if (p->last_day > 0) {
+        char lt[24]; char tmp[8];
+        lt[0] = '\0';
+        itoa(p->last_day, tmp, 10); strcat(lt, tmp); strcat(lt, "/");
+        itoa(p->last_month, tmp, 10); strcat(lt, tmp); strcat(lt, " ");
+        if (p->last_hour < 10) strcat(lt, "0");
+        itoa(p->last_hour, tmp, 10); strcat(lt, tmp); strcat(lt, ":");
+        if (p->last_minute < 10) strcat(lt, "0");
+        itoa(p->last_minute, tmp, 10); strcat(lt, tmp);
+        screen_print(lt);
+        int lpad2 = 29 - (int)strlen(lt);
+        for (int i = 0; i < lpad2; i++) screen_putchar(' ');
+    } else {
         screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+        screen_print("First login                  ");
+    }
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
 
-        /* Memory */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Memory : ");
-        itoa(mem_used() / 1024, buf, 10); screen_print(buf); screen_print(" / ");
-        itoa(mem_total() / 1024, buf, 10); screen_print(buf); screen_print(" KB");
-        screen_print("                  ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+    /* Session duration */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Session  : ");
+    {
+        uint32_t ss = user_session_seconds();
+        uint32_t sm = ss / 60; uint32_t sh = sm / 60;
+        ss %= 60; sm %= 60;
+        char sb[24]; char tmp[8];
+        sb[0] = '\0';
+        itoa(sh, tmp, 10); strcat(sb, tmp); strcat(sb, "h ");
+        itoa(sm, tmp, 10); strcat(sb, tmp); strcat(sb, "m ");
+        itoa(ss, tmp, 10); strcat(sb, tmp); strcat(sb, "s");
+        screen_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+        screen_print(sb);
+        int spad = 29 - (int)strlen(sb);
+        for (int i = 0; i < spad; i++) screen_putchar(' ');
+    }
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
 
-        /* LLM */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  LLM    : Groq (via serial bridge)    ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+    /* Home directory */
+    screen_print("\n   ");
+    screen_putchar((char)186);
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    screen_print("  Home     : ");
+    screen_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
+    char hdir[32]; strcpy(hdir, "/home/"); strcat(hdir, user_current());
+    screen_print(hdir);
+    int hpad = 29 - (int)strlen(hdir);
+    for (int i = 0; i < hpad; i++) screen_putchar(' ');
+    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+    screen_putchar((char)186);
 
-        /* Status */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Status : ");
-        screen_set_color(VGA_GREEN, VGA_BLACK);
-        screen_putchar((char)254);
-        screen_print(" ONLINE                       ");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+    /* Bottom */
+    screen_print("\n   ");
+    screen_putchar((char)200);
+    for (int i = 0; i < 44; i++) screen_putchar((char)205);
+    screen_putchar((char)188);
+    screen_print("\n\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-        /* Bottom */
-        screen_print("\n   ");
-        screen_putchar((char)200);
-        for (int i = 0; i < 44; i++) screen_putchar((char)205);
-        screen_putchar((char)188);
-        screen_print("\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return 0;
-    }
+/* ── Login ── */
+static int cmd_login(char *arg) {
+    (void)arg;
+    audit_log(AUDIT_LOGOUT, user_current());
+    return -3;
+}
 
-    /* ── Time ── */
-    if (strcmp(cmd, "time") == 0) {
-        uint32_t secs = timer_get_seconds();
-        uint32_t mins = secs / 60;
-        uint32_t hrs = mins / 60;
-        secs %= 60; mins %= 60;
-        char buf[16];
+/* ── Crash Test ── */
+static int cmd_crash_test(char *arg) {
+    (void)arg;
+    screen_set_color(VGA_YELLOW, VGA_BLACK);
+    screen_print("\n   ");
+    screen_putchar((char)254);
+    screen_print(" Spawning volatile Ring 3 User process...\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    
+    process_create(ring3_crash_dummy, 3);
+    return 0;
+}
 
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+/* ── Exec ── */
+static int cmd_exec(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
         screen_print("   ");
-        screen_putchar((char)250);
-        screen_print(" ");
+        screen_putchar((char)254);
+        screen_print(" Usage: exec <filename>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("Uptime: ");
-        itoa(hrs, buf, 10); screen_print(buf); screen_print("h ");
-        itoa(mins, buf, 10); screen_print(buf); screen_print("m ");
-        itoa(secs, buf, 10); screen_print(buf); screen_print("s\n");
         return 0;
     }
-
-    /* ── History ── */
-    if (strcmp(cmd, "history") == 0) {
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print("\n   ");
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+    
+    int pid = process_exec(abs_path);
+    if (pid < 0) {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
         screen_putchar((char)254);
-        screen_print(" Command History\n");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
+        screen_print(" Failed to execute. Check file exists and memory.\n");
+    } else {
+        screen_set_color(VGA_GREEN, VGA_BLACK);
         screen_print("   ");
-        for (int i = 0; i < 40; i++) screen_putchar((char)196);
-        screen_print("\n");
-
-        int start = hist_count > HIST_SIZE ? hist_count - HIST_SIZE : 0;
-        for (int i = start; i < hist_count; i++) {
-            char nb[8];
-            itoa(i + 1, nb, 10);
-            screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-            screen_print("   ");
-            if (i + 1 < 10) screen_putchar(' ');
-            screen_print(nb);
-            screen_print("  ");
-            screen_putchar((char)250);
-            screen_print(" ");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            screen_print(history[i % HIST_SIZE]);
-            screen_print("\n");
-        }
+        screen_putchar((char)254);
+        screen_print(" Executed process PID: ");
+        char nbuf[16]; itoa(pid, nbuf, 10);
+        screen_print(nbuf);
         screen_print("\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return 0;
+        audit_log(AUDIT_APP_OPEN, abs_path);
     }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-    /* ── Audit ── */
-    if (strcmp(cmd, "audit") == 0) {
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("\n   ");
-        screen_putchar((char)201);
-        for (int i = 0; i < 54; i++) screen_putchar((char)205);
-        screen_putchar((char)187);
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print("  ");
+/* ── MkApp ── */
+static int cmd_mkapp(char *arg) {
+    if (arg[0] == '\0') {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
         screen_putchar((char)254);
-        screen_print(" Audit Log");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("                                         ");
-        screen_putchar((char)186);
-        screen_print("\n   ");
-        screen_putchar((char)200);
-        for (int i = 0; i < 54; i++) screen_putchar((char)205);
-        screen_putchar((char)188);
-        screen_print("\n");
-
-        int cnt = audit_get_count();
-        if (cnt == 0) {
-            screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-            screen_print("   No audit events recorded.\n");
-        } else {
-            int show = cnt > 10 ? 10 : cnt;
-            int total_avail = cnt > AUDIT_MAX_ENTRIES ? AUDIT_MAX_ENTRIES : cnt;
-            int start_idx = total_avail - show;
-            for (int i = start_idx; i < total_avail; i++) {
-                const audit_entry_t *e = audit_get_entry(i);
-                if (!e || !e->used) continue;
-                screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-                screen_print("   ");
-                char tmp[8];
-                screen_print("[");
-                if (e->hour < 10) screen_putchar('0');
-                itoa(e->hour, tmp, 10); screen_print(tmp);
-                screen_putchar(':');
-                if (e->minute < 10) screen_putchar('0');
-                itoa(e->minute, tmp, 10); screen_print(tmp);
-                screen_putchar(':');
-                if (e->second < 10) screen_putchar('0');
-                itoa(e->second, tmp, 10); screen_print(tmp);
-                screen_print("] ");
-
-                /* Color by event type */
-                uint8_t ec = VGA_WHITE;
-                switch (e->type) {
-                    case AUDIT_LOGIN:       ec = VGA_GREEN; break;
-                    case AUDIT_LOGOUT:      ec = VGA_YELLOW; break;
-                    case AUDIT_FILE_CREATE: ec = VGA_LIGHT_CYAN; break;
-                    case AUDIT_FILE_DELETE: ec = VGA_RED; break;
-                    case AUDIT_APP_OPEN:    ec = VGA_CYAN; break;
-                    case AUDIT_APP_CLOSE:   ec = VGA_DARK_GREY; break;
-                    case AUDIT_COMMAND:     ec = VGA_WHITE; break;
-                    case AUDIT_FILE_WRITE:  ec = VGA_LIGHT_GREEN; break;
-                    case AUDIT_SYSTEM:      ec = VGA_LIGHT_MAGENTA; break;
-                }
-                screen_set_color(ec, VGA_BLACK);
-                screen_print(audit_type_name(e->type));
-                screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-                screen_print(" ");
-                screen_set_color(VGA_GREEN, VGA_BLACK);
-                screen_print(e->user);
-                if (e->detail[0]) {
-                    screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-                    screen_print(": ");
-                    screen_set_color(VGA_LIGHT_GREY, VGA_BLACK);
-                    screen_print(e->detail);
-                }
-                screen_print("\n");
-            }
-            screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-            screen_print("\n   Total events: ");
-            char tcnt[8]; itoa(cnt, tcnt, 10);
-            screen_print(tcnt);
-            screen_print("\n");
-        }
+        screen_print(" Usage: mkapp <filename>\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("\n");
         return 0;
     }
-
-    /* ── Profile ── */
-    if (strcmp(cmd, "profile") == 0) {
-        user_profile_t *p = user_get_profile();
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("\n   ");
-        screen_putchar((char)201);
-        for (int i = 0; i < 44; i++) screen_putchar((char)205);
-        screen_putchar((char)187);
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_CYAN, VGA_BLACK);
-        screen_print("  ");
-        screen_putchar((char)4);
-        screen_print(" User Profile");
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_print("                             ");
-        screen_putchar((char)186);
-        screen_print("\n   ");
-        screen_putchar((char)204);
-        for (int i = 0; i < 44; i++) screen_putchar((char)205);
-        screen_putchar((char)185);
-
-        /* Username */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Name     : ");
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+    
+    /* Machine code for:
+       while(1) { __asm__ volatile("yield (int 0x80)"); }
+       Actually int 0x80 with eax=0 is yield.
+       Code:
+       b8 00 00 00 00  mov eax, 0
+       cd 80           int 0x80
+       eb f7           jmp -9
+    */
+    char app_code[] = {
+        '\xB8', '\x00', '\x00', '\x00', '\x00', /* mov eax, 0 */
+        '\xCD', '\x80',                         /* int 0x80 */
+        '\xEB', '\xF7'                          /* jmp to mov (starts at IP-9, but size is 2, so offset is -9) */
+    };
+    app_code[8] = (char)0xF7; /* -9 in 2's complement */
+
+    if (fs_write_bytes(abs_path, app_code, sizeof(app_code)) == 0) {
         screen_set_color(VGA_GREEN, VGA_BLACK);
-        screen_print(user_current());
-        int upad = 29 - (int)strlen(user_current());
-        for (int i = 0; i < upad; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
-
-        /* Login count */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Logins   : ");
-        screen_set_color(VGA_YELLOW, VGA_BLACK);
-        char lc[8]; itoa(p->login_count, lc, 10);
-        screen_print(lc);
-        int lpad = 29 - (int)strlen(lc);
-        for (int i = 0; i < lpad; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Successfully written test app code.\n");
+    } else {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
+        screen_putchar((char)254);
+        screen_print(" Failed to write test app.\n");
+    }
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+    return 0;
+}
 
-        /* Last login */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Last     : ");
-        if (p->last_day > 0) {
-            char lt[24]; char tmp[8];
-            lt[0] = '\0';
-            itoa(p->last_day, tmp, 10); strcat(lt, tmp); strcat(lt, "/");
-            itoa(p->last_month, tmp, 10); strcat(lt, tmp); strcat(lt, " ");
-            if (p->last_hour < 10) strcat(lt, "0");
-            itoa(p->last_hour, tmp, 10); strcat(lt, tmp); strcat(lt, ":");
-            if (p->last_minute < 10) strcat(lt, "0");
-            itoa(p->last_minute, tmp, 10); strcat(lt, tmp);
-            screen_print(lt);
-            int lpad2 = 29 - (int)strlen(lt);
-            for (int i = 0; i < lpad2; i++) screen_putchar(' ');
-        } else {
-            screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-            screen_print("First login                  ");
-        }
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+/* ── Source: run a script, one command per line ── */
+#define SCRIPT_DEPTH 4
+static int script_depth = 0;
 
-        /* Session duration */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Session  : ");
-        {
-            uint32_t ss = user_session_seconds();
-            uint32_t sm = ss / 60; uint32_t sh = sm / 60;
-            ss %= 60; sm %= 60;
-            char sb[24]; char tmp[8];
-            sb[0] = '\0';
-            itoa(sh, tmp, 10); strcat(sb, tmp); strcat(sb, "h ");
-            itoa(sm, tmp, 10); strcat(sb, tmp); strcat(sb, "m ");
-            itoa(ss, tmp, 10); strcat(sb, tmp); strcat(sb, "s");
-            screen_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
-            screen_print(sb);
-            int spad = 29 - (int)strlen(sb);
-            for (int i = 0; i < spad; i++) screen_putchar(' ');
-        }
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
+static int script_line(char *line) {
+    char *t = trim(line);
+    if (t[0] == '\0' || t[0] == '#') return 0;
+    return execute_command(t);
+}
 
-        /* Home directory */
-        screen_print("\n   ");
-        screen_putchar((char)186);
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        screen_print("  Home     : ");
-        screen_set_color(VGA_LIGHT_CYAN, VGA_BLACK);
-        char hdir[32]; strcpy(hdir, "/home/"); strcat(hdir, user_current());
-        screen_print(hdir);
-        int hpad = 29 - (int)strlen(hdir);
-        for (int i = 0; i < hpad; i++) screen_putchar(' ');
-        screen_set_color(VGA_DARK_GREY, VGA_BLACK);
-        screen_putchar((char)186);
-
-        /* Bottom */
-        screen_print("\n   ");
-        screen_putchar((char)200);
-        for (int i = 0; i < 44; i++) screen_putchar((char)205);
-        screen_putchar((char)188);
-        screen_print("\n\n");
-        screen_set_color(VGA_WHITE, VGA_BLACK);
+/* Output is batched: drawn once at the end (and once a frame while
+ * it runs) instead of glyph by glyph. A negative result (shutdown,
+ * reboot, login, gui) stops the script and is passed on. */
+static int cmd_source(char *arg) {
+    if (arg[0] == '\0') {
+        print_usage("source <script>");
         return 0;
     }
-
-    /* ── Login ── */
-    if (strcmp(cmd, "login") == 0) {
-        audit_log(AUDIT_LOGOUT, user_current());
-        return -3;
-    }
-
-    /* ── Crash Test ── */
-    if (strcmp(cmd, "crash_test") == 0) {
-        screen_set_color(VGA_YELLOW, VGA_BLACK);
-        screen_print("\n   ");
+    char abs_path[128];
+    resolve_path(arg, abs_path);
+    fs_view_t v;
+    if (script_depth >= SCRIPT_DEPTH || fs_view(abs_path, &v) < 0) {
+        screen_set_color(VGA_RED, VGA_BLACK);
+        screen_print("   ");
         screen_putchar((char)254);
-        screen_print(" Spawning volatile Ring 3 User process...\n");
+        screen_print(script_depth >= SCRIPT_DEPTH ? " Scripts nested too deep: " : " File not found: ");
+        screen_print(arg);
+        screen_print("\n");
         screen_set_color(VGA_WHITE, VGA_BLACK);
-        
-        process_create(ring3_crash_dummy, 3);
         return 0;
     }
 
-    /* ── Exec ── */
-    if (strcmp(cmd, "exec") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: exec <filename>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char abs_path[128];
-        resolve_path(arg, abs_path);
-        
-        int pid = process_exec(abs_path);
-        if (pid < 0) {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Failed to execute. Check file exists and memory.\n");
-        } else {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Executed process PID: ");
-            char nbuf[16]; itoa(pid, nbuf, 10);
-            screen_print(nbuf);
-            screen_print("\n");
-            audit_log(AUDIT_APP_OPEN, abs_path);
+    /* Piped input (`ls | source s.sh`) is not the scripts' to read */
+    const char *saved_in = pipe_in;
+    uint32_t saved_in_len = pipe_in_len;
+    pipe_in = 0;
+    pipe_in_len = 0;
+
+    script_depth++;
+    screen_batch_begin();
+    char line[CMD_BUF];
+    int len = 0, ret = 0;
+    for (int s = 0; s < v.n_seg && ret >= 0; s++) {
+        for (uint32_t i = 0; i < v.seg[s].len && ret >= 0; i++) {
+            char c = (char)v.seg[s].data[i];
+            if (c == '\n') {
+                line[len] = '\0';
+                len = 0;
+                ret = script_line(line);
+            } else if (len < CMD_BUF - 1) {
+                line[len++] = c;
+            }
         }
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return 0;
     }
+    if (len && ret >= 0) {      /* last line without a newline */
+        line[len] = '\0';
+        ret = script_line(line);
+    }
+    screen_batch_end();
+    script_depth--;
+    pipe_in = saved_in;
+    pipe_in_len = saved_in_len;
+    fs_view_release(&v);
+    return ret;
+}
 
-    /* ── MkApp ── */
-    if (strcmp(cmd, "mkapp") == 0) {
-        if (arg[0] == '\0') {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Usage: mkapp <filename>\n");
-            screen_set_color(VGA_WHITE, VGA_BLACK);
-            return 0;
-        }
-        char abs_path[128];
-        resolve_path(arg, abs_path);
-        
-        /* Machine code for:
-           while(1) { __asm__ volatile("yield (int 0x80)"); }
-           Actually int 0x80 with eax=0 is yield.
-           Code:
-           b8 00 00 00 00  mov eax, 0
-           cd 80           int 0x80
-           eb f9           jmp -7
-        */
-        char app_code[] = {
-            '\xB8', '\x00', '\x00', '\x00', '\x00', /* mov eax, 0 */
-            '\xCD', '\x80',                         /* int 0x80 */
-            '\xEB', '\xF7'                          /* jmp to mov (starts at IP-9, but size is 2, so offset is -9) */
-        };
-        app_code[8] = (char)0xF7; /* -9 in 2's complement */
-        
-        /* Using internal fs_write trick since it null terminates, we'll write via fs internals if needed. 
-           Wait, fs_write accepts a null-terminated string and stops at 0. Since our code has 0x00, it will stop!
-           Let's rewrite mkapp to directly poke the fs_append or handle binary write.
-           Wait, there is a better infinite loop without 0x00:
-           31 c0     xor eax, eax
-           cd 80     int 0x80
-           eb fa     jmp -6
-        */
-        char safe_app_code[] = {
-            '\x31', '\xC0',         /* xor eax, eax */
-            '\xCD', '\x80',         /* int 0x80 */
-            '\xEB', '\xFA', '\0'    /* jmp -6 */
-        };
-        
-        if (fs_write(abs_path, safe_app_code) == 0) {
-            screen_set_color(VGA_GREEN, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Successfully written test app code.\n");
-        } else {
-            screen_set_color(VGA_RED, VGA_BLACK);
-            screen_print("   ");
-            screen_putchar((char)254);
-            screen_print(" Failed to write test app.\n");
+/* ── Command table ─────────────────────────────────────────── */
+typedef struct {
+    const char *name;
+    int (*fn)(char *arg);
+} shell_cmd_t;
+
+static const shell_cmd_t commands[] = {
+    { "shutdown",   cmd_shutdown },
+    { "exit",       cmd_shutdown },
+    { "reboot",     cmd_reboot },
+    { "help",       cmd_help },
+    { "clear",      cmd_clear },
+    { "gui",        cmd_gui },
+    { "ask",        cmd_ask },
+    { "setkey",     cmd_setkey },
+    { "aikey",      cmd_aikey },
+    { "cd",         cmd_cd },
+    { "ls",         cmd_ls },
+    { "cat",        cmd_cat },
+    { "write",      cmd_write },
+    { "append",     cmd_append },
+    { "cp",         cmd_cp },
+    { "mv",         cmd_mv },
+    { "mkdir",      cmd_mkdir },
+    { "rm",         cmd_rm },
+    { "hexdump",    cmd_hexdump },
+    { "grep",       cmd_grep },
+    { "head",       cmd_head },
+    { "wc",         cmd_wc },
+    { "calc",       cmd_calc },
+    { "echo",       cmd_echo },
+    { "snake",      cmd_snake },
+    { "whoami",     cmd_whoami },
+    { "date",       cmd_date },
+    { "mem",        cmd_mem },
+    { "status",     cmd_status },
+    { "time",       cmd_time },
+    { "telemetry",  cmd_telemetry },
+    { "trace",      cmd_trace },
+    { "prof",       cmd_prof },
+    { "net",        cmd_net },
+    { "lspci",      cmd_lspci },
+    { "policy",     cmd_policy },
+    { "mouse",      cmd_mouse },
+    { "sync",       cmd_sync },
+    { "history",    cmd_history },
+    { "audit",      cmd_audit },
+    { "profile",    cmd_profile },
+    { "login",      cmd_login },
+    { "crash_test", cmd_crash_test },
+    { "exec",       cmd_exec },
+    { "mkapp",      cmd_mkapp },
+    { "source",     cmd_source },
+};
+#define NCOMMANDS ((int)(sizeof(commands) / sizeof(commands[0])))
+
+/* Open-addressed index into commands[], built on first lookup */
+#define CMD_HASH_SIZE 128       /* power of two, well above NCOMMANDS */
+static uint8_t cmd_index[CMD_HASH_SIZE];   /* commands[] slot + 1, 0 = empty */
+static int cmd_index_built = 0;
+
+static uint32_t cmd_hash(const char *s) {
+    uint32_t h = 2166136261u;   /* FNV-1a */
+    while (*s) { h ^= (uint8_t)*s++; h *= 16777619u; }
+    return h;
+}
+
+static const shell_cmd_t *find_command(const char *name) {
+    if (!cmd_index_built) {
+        for (int i = 0; i < NCOMMANDS; i++) {
+            uint32_t h = cmd_hash(commands[i].name) & (CMD_HASH_SIZE - 1);
+            while (cmd_index[h]) h = (h + 1) & (CMD_HASH_SIZE - 1);
+            cmd_index[h] = (uint8_t)(i + 1);
         }
-        screen_set_color(VGA_WHITE, VGA_BLACK);
-        return 0;
+        cmd_index_built = 1;
     }
+    for (uint32_t h = cmd_hash(name) & (CMD_HASH_SIZE - 1); cmd_index[h];
+         h = (h + 1) & (CMD_HASH_SIZE - 1))
+        if (strcmp(commands[cmd_index[h] - 1].name, name) == 0)
+            return &commands[cmd_index[h] - 1];
+    return 0;
+}
+
+/* ── Execute command ───────────────────────────────────────── */
+static int run_command(char *input) {
+    char *cmd = trim(input);
+    if (cmd[0] == '\0') return 0;
+
+    char *arg = cmd;
+    while (*arg && !isspace(*arg)) arg++;
+    if (*arg) { *arg = '\0'; arg++; }
+    arg = trim(arg);
+
+    const shell_cmd_t *c = find_command(cmd);
+    if (c) return c->fn(arg);
 
-    /* ── Unknown ── */
     screen_set_color(VGA_RED, VGA_BLACK);
     screen_print("   ");
     screen_putchar((char)254);
@@ -1506,6 +2251,106 @@ static int execute_command(char *input) {
     return 0;
 }
 
+static void pipe_error(const char *msg) {
+    screen_set_color(VGA_RED, VGA_BLACK);
+    screen_print("   ");
+    screen_putchar((char)254);
+    screen_print(" ");
+    screen_print(msg);
+    screen_print("\n");
+    screen_set_color(VGA_WHITE, VGA_BLACK);
+}
+
+/* Drop the double quotes from s, in place */
+static void unquote(char *s) {
+    char *d = s;
+    for (; *s; s++) if (*s != '"') *d++ = *s;
+    *d = '\0';
+}
+
+/* Length of the operator (|, > or >>) at p, if it stands alone:
+ * whitespace (or the line edge) on both sides */
+static int pipe_op(const char *line, const char *p) {
+    if (p > line && !isspace(p[-1])) return 0;
+    int len = (p[0] == '>' && p[1] == '>') ? 2 : (p[0] == '|' || p[0] == '>') ? 1 : 0;
+    return len && (!p[len] || isspace(p[len])) ? len : 0;
+}
+
+/* `a | b | c [> file | >> file]`: each stage but the last (or every
+ * stage, with a redirect) runs with its output captured, and the
+ * next one reads that as pipe_in. Operators count only as separate
+ * words outside double quotes, so `ask "is 5 > 3?"` and `write f
+ * a|b` keep their text; the quotes themselves are dropped. */
+static int execute_command(char *input) {
+    char *stage[PIPE_STAGES];
+    int n = 0;
+    char *target = 0;
+    int append = 0, quoted = 0;
+    stage[n++] = input;
+    for (char *p = input; *p; p++) {
+        if (*p == '"') quoted = !quoted;
+        int op = quoted ? 0 : pipe_op(input, p);
+        if (!op) continue;
+        if (target) { pipe_error("A redirect must come last."); return 0; }
+        if (*p == '>') {
+            append = op == 2;
+            *p = '\0';
+            target = trim(p + op);
+            if (!target[0]) { pipe_error("Missing redirect target."); return 0; }
+            p += op - 1;
+            continue;
+        }
+        if (n == PIPE_STAGES) { pipe_error("Too many pipeline stages."); return 0; }
+        *p = '\0';
+        stage[n++] = p + 1;
+    }
+    for (int i = 0; i < n; i++) unquote(stage[i]);
+    if (target) unquote(target);
+    if (n == 1 && !target) return run_command(input);
+
+    /* A pipeline inside a sourced script may itself be captured: the
+     * stage that isn't redirected writes wherever the caller's output
+     * was going, and the caller's state is back on return */
+    void *outer_ctx;
+    screen_sink_t outer_sink = screen_get_sink(&outer_ctx);
+    int outer_captured = out_captured;
+    const char *outer_in = pipe_in;
+    uint32_t outer_in_len = pipe_in_len;
+
+    sh_stream_t in = { 0 }, out = { 0 };
+    int ret = 0;
+    for (int i = 0; i < n && ret >= 0; i++) {
+        int capture = i < n - 1 || target;
+        pipe_in = i ? (in.data ? in.data : "") : outer_in;
+        pipe_in_len = i ? in.len : outer_in_len;
+        if (capture) {
+            out_captured = 1;
+            screen_set_sink(stream_putc, &out);
+        }
+        ret = run_command(stage[i]);
+        screen_set_sink(outer_sink, outer_ctx);
+        out_captured = outer_captured;
+        stream_free(&in);
+        in = out;
+        memset(&out, 0, sizeof(out));
+    }
+    pipe_in = outer_in;
+    pipe_in_len = outer_in_len;
+
+    if (in.truncated) pipe_error("Pipe output truncated.");
+    if (target && ret >= 0) {
+        char abs_path[128];
+        resolve_path(target, abs_path);
+        const char *data = in.data ? in.data : "";
+        int r = append ? fs_append_bytes(abs_path, data, in.len)
+                       : fs_write_bytes(abs_path, data, in.len);
+        if (r < 0) pipe_error("Redirect failed.");
+        else audit_log(AUDIT_FILE_WRITE, target);
+    }
+    stream_free(&in);
+    return ret;
+}
+
 /* ── Main shell loop ───────────────────────────────────────── */
 int shell_run(void) {
     /* Welcome banner */
@@ -1546,24 +2391,34 @@ int shell_run(void) {
     screen_print(" to talk to AI\n\n");
     screen_set_color(VGA_WHITE, VGA_BLACK);
 
+    /* Provisioning hook: /autorun.sh runs once per boot, before the first prompt */
+    static int autorun_done = 0;
+
     while (1) {
-        print_prompt();
-        read_line_with_history(cmd_buf, CMD_BUF);
+        if (!autorun_done && fs_size(AUTORUN_SCRIPT) >= 0) {
+            strcpy(cmd_buf, "source " AUTORUN_SCRIPT);
+        } else {
+            print_prompt();
+            read_line_with_history(cmd_buf, CMD_BUF);
 
-        char *trimmed = trim(cmd_buf);
-        if (trimmed[0] != '\0') {
-            hist_add(trimmed);
+            char *trimmed = trim(cmd_buf);
+            if (trimmed[0] != '\0') {
+                hist_add(trimmed);
+            }
         }
+        autorun_done = 1;
 
         int result = execute_command(cmd_buf);
 
         if (result == -1) {
             /* Shutdown */
+            audit_drain();
             __asm__ volatile ("cli; hlt");
             while (1);
         }
         if (result == -2) {
             /* Reboot via triple fault */
+            audit_drain();
             uint8_t good = 0x02;
             while (good & 0x02) good = inb(0x64);
             outb(0x64, 0xFE);
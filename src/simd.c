@@ -0,0 +1,135 @@
+/* ============================================================
+ * SwanOS — SIMD Kernel Dispatch
+ * Scalar reference kernels, CPUID-based selection of the SSE2
+ * versions, and FXSAVE context handling for the scheduler.
+ * ============================================================ */
+
+#include "simd.h"
+#include "cpu.h"
+
+static int simd_lvl = SIMD_NONE;
+static int fxsr_enabled = 0;
+static uint8_t clean_state[SIMD_STATE_SIZE] __attribute__((aligned(16)));
+
+/* ── Scalar kernels ───────────────────────────────────────── */
+
+static void scalar_fill32(uint32_t *dst, uint32_t val, int n) {
+    while (n >= 8) {
+        dst[0] = val; dst[1] = val; dst[2] = val; dst[3] = val;
+        dst[4] = val; dst[5] = val; dst[6] = val; dst[7] = val;
+        dst += 8; n -= 8;
+    }
+    while (n-- > 0) *dst++ = val;
+}
+
+static void scalar_copy32(uint32_t *dst, const uint32_t *src, int n) {
+    while (n >= 8) {
+        dst[0] = src[0]; dst[1] = src[1]; dst[2] = src[2]; dst[3] = src[3];
+        dst[4] = src[4]; dst[5] = src[5]; dst[6] = src[6]; dst[7] = src[7];
+        dst += 8; src += 8; n -= 8;
+    }
+    while (n-- > 0) *dst++ = *src++;
+}
+
+static void scalar_blend32(uint32_t *dst, uint32_t color, int n) {
+    uint32_t a = (color >> 24) & 0xFF, inv = 255 - a;
+    uint32_t fr = ((color >> 16) & 0xFF) * a;
+    uint32_t fg = ((color >> 8) & 0xFF) * a;
+    uint32_t fb = (color & 0xFF) * a;
+    for (int i = 0; i < n; i++) {
+        uint32_t bg = dst[i];
+        uint32_t r = (fr + ((bg >> 16) & 0xFF) * inv) / 255;
+        uint32_t g = (fg + ((bg >> 8) & 0xFF) * inv) / 255;
+        uint32_t b = (fb + (bg & 0xFF) * inv) / 255;
+        dst[i] = 0xFF000000 | (r << 16) | (g << 8) | b;
+    }
+}
+
+static inline uint32_t sat_add(uint32_t c, int add) {
+    int v = (int)c + add;
+    return v > 255 ? 255 : (uint32_t)v;
+}
+
+static void scalar_adds32(uint32_t *dst, const uint32_t *add, int n) {
+    for (int i = 0; i < n; i++) {
+        uint32_t c = dst[i], d = add[i], out = 0;
+        for (int sh = 0; sh < 32; sh += 8)
+            out |= sat_add((c >> sh) & 0xFF, (int)((d >> sh) & 0xFF)) << sh;
+        dst[i] = out;
+    }
+}
+
+static void scalar_glow32(uint32_t *dst, int x0, int n, int dy2, const simd_glow_t *g) {
+    for (int i = 0; i < n; i++) {
+        int dx = x0 + i - g->cx;
+        int dist2 = (dx * dx) / g->xdiv + dy2;
+        if (dist2 >= g->max_r2) continue;
+        int in = g->peak - (dist2 * g->peak) / g->max_r2;
+        if (in <= 0) continue;
+        uint32_t c = dst[i];
+        uint32_t r = sat_add((c >> 16) & 0xFF, ((in * g->mul_r) >> 8) + g->bias_r);
+        uint32_t gg = sat_add((c >> 8) & 0xFF, ((in * g->mul_g) >> 8) + g->bias_g);
+        uint32_t b = sat_add(c & 0xFF, ((in * g->mul_b) >> 8) + g->bias_b);
+        dst[i] = (c & 0xFF000000) | (r << 16) | (gg << 8) | b;
+    }
+}
+
+void (*simd_fill32)(uint32_t *, uint32_t, int) = scalar_fill32;
+void (*simd_copy32)(uint32_t *, const uint32_t *, int) = scalar_copy32;
+void (*simd_blend32)(uint32_t *, uint32_t, int) = scalar_blend32;
+void (*simd_adds32)(uint32_t *, const uint32_t *, int) = scalar_adds32;
+void (*simd_glow32)(uint32_t *, int, int, int, const simd_glow_t *) = scalar_glow32;
+
+/* ── Detection ────────────────────────────────────────────── */
+
+void simd_init(void) {
+    uint32_t edx = cpuid_edx(1);
+    if (!(edx & CPUID_EDX_FXSR)) return;
+
+    /* CR0: MP=1, EM=0, TS=0.  CR4: OSFXSR | OSXMMEXCPT */
+    uint32_t cr0, cr4;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(cr0));
+    cr0 = (cr0 | 0x2) & ~(0x4u | 0x8u);
+    __asm__ volatile("mov %0, %%cr0" : : "r"(cr0));
+    __asm__ volatile("mov %%cr4, %0" : "=r"(cr4));
+    cr4 |= 0x200 | ((edx & CPUID_EDX_SSE) ? 0x400 : 0);
+    __asm__ volatile("mov %0, %%cr4" : : "r"(cr4));
+
+    /* Capture the reset-state image new processes start from */
+    uint32_t mxcsr = 0x1F80;   /* all SIMD exceptions masked */
+    __asm__ volatile("fninit");
+    if (edx & CPUID_EDX_SSE) __asm__ volatile("ldmxcsr %0" : : "m"(mxcsr));
+    __asm__ volatile("fxsave %0" : "=m"(clean_state));
+    fxsr_enabled = 1;
+
+    if (edx & CPUID_EDX_SSE2) {
+        simd_fill32  = sse2_fill32;
+        simd_copy32  = sse2_copy32;
+        simd_blend32 = sse2_blend32;
+        simd_adds32  = sse2_adds32;
+        simd_glow32  = sse2_glow32;
+        simd_lvl = SIMD_SSE2;
+    }
+}
+
+int simd_level(void) {
+    return simd_lvl;
+}
+
+const char *simd_name(void) {
+    return simd_lvl == SIMD_SSE2 ? "SSE2" : "scalar";
+}
+
+/* ── FPU/SSE context ──────────────────────────────────────── */
+
+void simd_state_init(uint8_t *area) {
+    for (int i = 0; i < SIMD_STATE_SIZE; i++) area[i] = clean_state[i];
+}
+
+void simd_state_save(uint8_t *area) {
+    if (fxsr_enabled) __asm__ volatile("fxsave (%0)" : : "r"(area) : "memory");
+}
+
+void simd_state_restore(const uint8_t *area) {
+    if (fxsr_enabled) __asm__ volatile("fxrstor (%0)" : : "r"(area) : "memory");
+}
@@ -0,0 +1,52 @@
+#ifndef SIMD_H
+#define SIMD_H
+
+#include <stdint.h>
+
+/* ── SIMD pixel kernels ───────────────────────────────────────
+ * Span kernels for the compositor, selected once at boot by CPUID.
+ * The SSE2 versions live in simd_sse2.c, the only translation unit
+ * built with SSE enabled; everything else stays -mno-sse, so XMM state
+ * is only ever live inside these calls.
+ *
+ * Not for interrupt context: an IRQ that uses them would clobber the
+ * interrupted task's XMM registers (the scheduler saves them, IRQ entry
+ * does not). */
+
+#define SIMD_NONE 0
+#define SIMD_SSE2 1
+
+/* Radial glow: dst += intensity * mul/256 + bias per channel (saturating),
+ * intensity = peak - dist2 * peak / max_r2 where dist2 = dx*dx/xdiv + dy2.
+ * Pixels with intensity <= 0 are untouched. peak * mul must fit 16 bits. */
+typedef struct {
+    int cx, xdiv, max_r2, peak;
+    int mul_r, mul_g, mul_b;    /* 8.8 fixed point */
+    int bias_r, bias_g, bias_b;
+} simd_glow_t;
+
+extern void (*simd_fill32)(uint32_t *dst, uint32_t val, int n);
+extern void (*simd_copy32)(uint32_t *dst, const uint32_t *src, int n);
+extern void (*simd_blend32)(uint32_t *dst, uint32_t color, int n);  /* ARGB over */
+extern void (*simd_adds32)(uint32_t *dst, const uint32_t *add, int n); /* per-byte saturating */
+extern void (*simd_glow32)(uint32_t *dst, int x0, int n, int dy2, const simd_glow_t *g);
+
+void simd_init(void);
+int  simd_level(void);
+const char *simd_name(void);
+
+/* ── FPU/SSE context (FXSAVE image) ───────────────────────── */
+#define SIMD_STATE_SIZE 512   /* must be 16-byte aligned */
+
+void simd_state_init(uint8_t *area);        /* clean FNINIT/MXCSR image */
+void simd_state_save(uint8_t *area);
+void simd_state_restore(const uint8_t *area);
+
+/* Entry points implemented in simd_sse2.c */
+void sse2_fill32(uint32_t *dst, uint32_t val, int n);
+void sse2_copy32(uint32_t *dst, const uint32_t *src, int n);
+void sse2_blend32(uint32_t *dst, uint32_t color, int n);
+void sse2_adds32(uint32_t *dst, const uint32_t *add, int n);
+void sse2_glow32(uint32_t *dst, int x0, int n, int dy2, const simd_glow_t *g);
+
+#endif
@@ -0,0 +1,139 @@
+/* ============================================================
+ * SwanOS — SSE2 Pixel Kernels
+ * Built with -msse2 (see Makefile); only reached through the
+ * simd_* dispatch pointers once simd_init() has enabled SSE.
+ * ============================================================ */
+
+#include "simd.h"
+
+/* xmmintrin.h pulls in mm_malloc.h (and with it the hosted stdlib.h);
+ * claim its guard, we never use _mm_malloc */
+#define _MM_MALLOC_H_INCLUDED
+#include <emmintrin.h>
+
+void sse2_fill32(uint32_t *dst, uint32_t val, int n) {
+    while (n > 0 && ((uint32_t)dst & 15)) { *dst++ = val; n--; }
+    __m128i v = _mm_set1_epi32((int)val);
+    while (n >= 16) {
+        _mm_store_si128((__m128i *)dst + 0, v);
+        _mm_store_si128((__m128i *)dst + 1, v);
+        _mm_store_si128((__m128i *)dst + 2, v);
+        _mm_store_si128((__m128i *)dst + 3, v);
+        dst += 16; n -= 16;
+    }
+    while (n >= 4) { _mm_store_si128((__m128i *)dst, v); dst += 4; n -= 4; }
+    while (n-- > 0) *dst++ = val;
+}
+
+void sse2_copy32(uint32_t *dst, const uint32_t *src, int n) {
+    while (n > 0 && ((uint32_t)dst & 15)) { *dst++ = *src++; n--; }
+    while (n >= 16) {
+        __m128i a = _mm_loadu_si128((const __m128i *)src + 0);
+        __m128i b = _mm_loadu_si128((const __m128i *)src + 1);
+        __m128i c = _mm_loadu_si128((const __m128i *)src + 2);
+        __m128i d = _mm_loadu_si128((const __m128i *)src + 3);
+        _mm_store_si128((__m128i *)dst + 0, a);
+        _mm_store_si128((__m128i *)dst + 1, b);
+        _mm_store_si128((__m128i *)dst + 2, c);
+        _mm_store_si128((__m128i *)dst + 3, d);
+        dst += 16; src += 16; n -= 16;
+    }
+    while (n >= 4) {
+        _mm_store_si128((__m128i *)dst, _mm_loadu_si128((const __m128i *)src));
+        dst += 4; src += 4; n -= 4;
+    }
+    while (n-- > 0) *dst++ = *src++;
+}
+
+/* ── Alpha blend ──────────────────────────────────────────── */
+
+/* x / 255 for x in [0, 65534], per 16-bit lane: (x + 1 + (x >> 8)) >> 8 */
+static inline __m128i div255_epu16(__m128i x) {
+    x = _mm_add_epi16(x, _mm_add_epi16(_mm_set1_epi16(1), _mm_srli_epi16(x, 8)));
+    return _mm_srli_epi16(x, 8);
+}
+
+void sse2_blend32(uint32_t *dst, uint32_t color, int n) {
+    uint32_t a = (color >> 24) & 0xFF, inv = 255 - a;
+    __m128i zero = _mm_setzero_si128();
+    __m128i vinv = _mm_set1_epi16((short)inv);
+    /* Foreground premultiplied by alpha, two pixels' worth of lanes */
+    __m128i fg = _mm_unpacklo_epi8(_mm_set1_epi32((int)color), zero);
+    fg = _mm_mullo_epi16(fg, _mm_set1_epi16((short)a));
+    __m128i opaque = _mm_set1_epi32((int)0xFF000000);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i lo = _mm_unpacklo_epi8(px, zero);
+        __m128i hi = _mm_unpackhi_epi8(px, zero);
+        lo = div255_epu16(_mm_add_epi16(fg, _mm_mullo_epi16(lo, vinv)));
+        hi = div255_epu16(_mm_add_epi16(fg, _mm_mullo_epi16(hi, vinv)));
+        px = _mm_or_si128(_mm_packus_epi16(lo, hi), opaque);
+        _mm_storeu_si128((__m128i *)(dst + i), px);
+    }
+    for (; i < n; i++) {
+        __m128i px = _mm_unpacklo_epi8(_mm_cvtsi32_si128((int)dst[i]), zero);
+        px = div255_epu16(_mm_add_epi16(fg, _mm_mullo_epi16(px, vinv)));
+        dst[i] = (uint32_t)_mm_cvtsi128_si32(_mm_packus_epi16(px, px)) | 0xFF000000;
+    }
+}
+
+void sse2_adds32(uint32_t *dst, const uint32_t *add, int n) {
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(dst + i));
+        __m128i b = _mm_loadu_si128((const __m128i *)(add + i));
+        _mm_storeu_si128((__m128i *)(dst + i), _mm_adds_epu8(a, b));
+    }
+    for (; i < n; i++) {
+        __m128i a = _mm_cvtsi32_si128((int)dst[i]);
+        dst[i] = (uint32_t)_mm_cvtsi128_si32(_mm_adds_epu8(a, _mm_cvtsi32_si128((int)add[i])));
+    }
+}
+
+/* ── Radial glow ──────────────────────────────────────────── */
+
+static inline __m128i glow_channel(__m128i in, __m128i mask, int mul, int bias) {
+    /* in < 2^16 in every 32-bit lane, so a 16-bit multiply is exact */
+    __m128i c = _mm_srli_epi32(_mm_mullo_epi16(in, _mm_set1_epi32(mul)), 8);
+    c = _mm_add_epi32(c, _mm_and_si128(_mm_set1_epi32(bias), mask));
+    return _mm_min_epi16(c, _mm_set1_epi32(255));
+}
+
+static inline __m128i glow4(__m128i px, __m128i dx, __m128 dy2, const simd_glow_t *g,
+                            __m128 xdiv, __m128 ratio) {
+    __m128 dxf = _mm_cvtepi32_ps(dx);
+    __m128 d2 = _mm_add_ps(_mm_cvtepi32_ps(_mm_cvttps_epi32(
+                    _mm_div_ps(_mm_mul_ps(dxf, dxf), xdiv))), dy2);
+    __m128i in = _mm_sub_epi32(_mm_set1_epi32(g->peak),
+                               _mm_cvttps_epi32(_mm_mul_ps(d2, ratio)));
+    __m128i mask = _mm_cmpgt_epi32(in, _mm_setzero_si128());
+    in = _mm_and_si128(in, mask);
+    __m128i add = _mm_slli_epi32(glow_channel(in, mask, g->mul_r, g->bias_r), 16);
+    add = _mm_or_si128(add, _mm_slli_epi32(glow_channel(in, mask, g->mul_g, g->bias_g), 8));
+    add = _mm_or_si128(add, glow_channel(in, mask, g->mul_b, g->bias_b));
+    return _mm_adds_epu8(px, add);
+}
+
+void sse2_glow32(uint32_t *dst, int x0, int n, int dy2, const simd_glow_t *g) {
+    __m128 vdy2 = _mm_set1_ps((float)dy2);
+    __m128 xdiv = _mm_set1_ps((float)g->xdiv);
+    __m128 ratio = _mm_set1_ps((float)g->peak / (float)g->max_r2);
+    __m128i dx = _mm_add_epi32(_mm_set1_epi32(x0 - g->cx), _mm_set_epi32(3, 2, 1, 0));
+    __m128i four = _mm_set1_epi32(4);
+
+    int i = 0;
+    for (; i + 4 <= n; i += 4) {
+        __m128i px = _mm_loadu_si128((const __m128i *)(dst + i));
+        _mm_storeu_si128((__m128i *)(dst + i), glow4(px, dx, vdy2, g, xdiv, ratio));
+        dx = _mm_add_epi32(dx, four);
+    }
+    if (i < n) {
+        uint32_t tmp[4] __attribute__((aligned(16))) = {0, 0, 0, 0};
+        for (int k = 0; k < n - i; k++) tmp[k] = dst[i + k];
+        __m128i px = glow4(_mm_load_si128((const __m128i *)tmp), dx, vdy2, g, xdiv, ratio);
+        _mm_store_si128((__m128i *)tmp, px);
+        for (int k = 0; k < n - i; k++) dst[i + k] = tmp[k];
+    }
+}
@@ -0,0 +1,324 @@
+/* ============================================================
+ * SwanOS — Multiprocessor Bring-up
+ * Boots the application processors listed in the ACPI MADT:
+ * a real-mode trampoline at TRAMP_BASE switches to protected
+ * mode and loads the kernel's CR0/CR3/CR4, then each AP loads its
+ * own TSS, enables its local APIC and timer, and runs processes or
+ * smp_call() work. Also home to the global IRQ lock (cpu.h).
+ * ============================================================ */
+
+#include "smp.h"
+#include "acpi.h"
+#include "apic.h"
+#include "gdt.h"
+#include "idt.h"
+#include "paging.h"
+#include "memory.h"
+#include "string.h"
+#include "timer.h"
+#include "cpu.h"
+#include "spinlock.h"
+#include "process.h"
+
+#define TRAMP_BASE      0x8000     /* SIPI vector 0x08; below 1 MB, reserved */
+#define AP_STACK_PAGES  4
+
+/* smp_asm.asm */
+extern uint8_t ap_trampoline_start[], ap_trampoline_end[];
+extern void smp_ipi_stub(void);
+extern void smp_timer_stub(void);
+extern void smp_spurious_stub(void);
+
+/* Read by ap_pm32 (offsets hard-coded in smp_asm.asm); stack is
+ * filled in before each SIPI */
+typedef struct {
+    uint32_t cr0, cr3, cr4;
+    uint32_t stack;
+    uint32_t entry;
+} __attribute__((packed)) tramp_params_t;
+
+tramp_params_t ap_boot_params;
+
+/* What an AP is doing; smp_call may only claim an IDLE one */
+enum { CPU_IDLE, CPU_POST, CPU_CALL, CPU_RUN };
+
+typedef struct {
+    uint8_t  apic_id;
+    volatile uint8_t online;
+    void    *stack;
+    /* smp_call mailbox: fn/arg are valid once state is CPU_CALL */
+    volatile smp_fn_t fn;
+    void * volatile   arg;
+    uint8_t  state;              /* CPU_*, changed atomically */
+} smp_cpu_t;
+
+extern page_directory_t *kernel_dir;
+
+static smp_cpu_t cpus[SMP_MAX_CPUS];
+static int ncpus = 1;
+static volatile int booting_cpu = 0;
+
+/* ── Helpers ──────────────────────────────────────────────── */
+
+static void delay_us(uint32_t us) {
+    uint32_t cpu_us = timer_cycles_per_us();
+    if (cpu_us) {
+        uint64_t end = rdtsc() + (uint64_t)us * cpu_us;
+        while (rdtsc() < end) __asm__ volatile("pause");
+        return;
+    }
+    /* TSC not calibrated yet: whole ticks, rounded up */
+    uint32_t ticks = us / (1000000 / timer_get_frequency()) + 1;
+    uint32_t start = timer_get_ticks();
+    while (timer_get_ticks() - start <= ticks) __asm__ volatile("pause");
+}
+
+int smp_cpu_count(void) {
+    return ncpus;
+}
+
+/* ── Global IRQ lock ──────────────────────────────────────────
+ * Taken by irq_save and interrupt handlers (see cpu.h). Only the
+ * owning CPU touches the depth, always with IRQs off.           */
+
+static spinlock_t irq_giant = SPINLOCK_INIT;
+static volatile int irq_owner = -1;
+static uint32_t irq_depth = 0;
+
+void irq_lock(void) {
+    int cpu = smp_cpu_id();
+    if (irq_owner == cpu) { irq_depth++; return; }
+    spin_lock_raw(&irq_giant);
+    irq_owner = cpu;
+    irq_depth = 1;
+}
+
+void irq_unlock(void) {
+    if (--irq_depth) return;
+    irq_owner = -1;
+    spin_unlock_raw(&irq_giant);
+}
+
+uint32_t irq_lock_drop(void) {
+    if (irq_owner != smp_cpu_id()) return 0;
+    uint32_t depth = irq_depth;
+    irq_depth = 1;
+    irq_unlock();
+    return depth;
+}
+
+void irq_lock_take(uint32_t depth) {
+    if (!depth) return;
+    irq_lock();
+    irq_depth = depth;
+}
+
+/* Nothing to do until an interrupt: don't keep other CPUs out meanwhile */
+void irq_halt(void) {
+    uint32_t depth = irq_lock_drop();
+    __asm__ volatile ("sti; hlt; cli" ::: "memory");
+    irq_lock_take(depth);
+}
+
+/* ── AP side ──────────────────────────────────────────────── */
+
+/* The AP's idle context (process.c). switch_context takes it off to
+ * run processes on a tick or a resched IPI; calls are served here.
+ * Checked with IRQs off; "sti; hlt" cannot miss the wake-up IPI. */
+static void ap_loop(smp_cpu_t *c) {
+    for (;;) {
+        __asm__ volatile("cli");
+        if (__atomic_load_n(&c->state, __ATOMIC_ACQUIRE) != CPU_CALL) {
+            __asm__ volatile("sti; hlt");
+            continue;
+        }
+        smp_fn_t fn = c->fn;
+        void *arg = c->arg;
+        __asm__ volatile("sti");
+        fn(arg);
+        __atomic_store_n(&c->state, CPU_IDLE, __ATOMIC_RELEASE);
+    }
+}
+
+/* Entered from the trampoline on the AP's own stack, paging on */
+static void ap_main(void) {
+    int cpu = booting_cpu;
+    gdt_init_cpu(cpu);
+    idt_load();
+    paging_ap_init();
+    __asm__ volatile("fninit");
+    lapic_init();
+    process_ap_init((uint32_t)cpus[cpu].stack + AP_STACK_PAGES * 4096);
+    cpus[cpu].state = CPU_IDLE;
+    cpus[cpu].online = 1;
+    lapic_timer_start(SMP_TIMER_VECTOR);
+    ap_loop(&cpus[cpu]);
+}
+
+/* smp_asm.asm: an AP's tick or a resched IPI, before switch_context.
+ * The tick needs no IRQ lock: it only drives the scheduler. */
+void smp_interrupt(registers_t *regs) {
+    lapic_eoi();
+    if (regs->int_no != SMP_IPI_VECTOR) return;
+    yield_requested = 1;
+    if (smp_cpu_id() == 0) {
+        /* Woken early from a tickless idle stretch, as in irq_handler */
+        irq_lock();
+        timer_idle_exit();
+        irq_unlock();
+    }
+}
+
+int smp_leave_idle(void) {
+    uint8_t idle = CPU_IDLE;
+    smp_cpu_t *c = &cpus[smp_cpu_id()];
+    return __atomic_compare_exchange_n(&c->state, &idle, CPU_RUN, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+void smp_enter_idle(void) {
+    __atomic_store_n(&cpus[smp_cpu_id()].state, CPU_IDLE, __ATOMIC_RELEASE);
+}
+
+void smp_resched(int cpu) {
+    if (cpu >= 0 && cpu < ncpus && cpu != smp_cpu_id())
+        lapic_send_ipi(cpus[cpu].apic_id, ICR_FIXED | SMP_IPI_VECTOR);
+}
+
+/* ── BSP side ─────────────────────────────────────────────── */
+
+static int start_ap(int cpu) {
+    uint8_t id = cpus[cpu].apic_id;
+    lapic_send_ipi(id, ICR_INIT | ICR_ASSERT | ICR_LEVEL);
+    delay_us(10000);
+    for (int i = 0; i < 2 && !cpus[cpu].online; i++) {
+        lapic_send_ipi(id, ICR_STARTUP | ICR_ASSERT | (TRAMP_BASE >> 12));
+        delay_us(200);
+    }
+    for (int ms = 0; ms < 100 && !cpus[cpu].online; ms++) delay_us(1000);
+    return cpus[cpu].online;
+}
+
+void smp_init(void) {
+    memset(cpus, 0, sizeof(cpus));
+    ncpus = 1;
+    cpus[0].online = 1;
+
+    if (apic_init() < 0) return;        /* uniprocessor, 8259 only */
+    const acpi_madt_t *m = acpi_madt();
+    uint8_t bsp = lapic_id();
+    cpus[0].apic_id = bsp;
+
+    idt_set_stub(SMP_IPI_VECTOR, smp_ipi_stub);
+    idt_set_stub(SMP_TIMER_VECTOR, smp_timer_stub);
+    idt_set_stub(LAPIC_SPURIOUS_VECTOR, smp_spurious_stub);
+    lapic_timer_calibrate();
+
+    uint32_t size = (uint32_t)(ap_trampoline_end - ap_trampoline_start);
+    memcpy((void *)TRAMP_BASE, ap_trampoline_start, size);
+    tramp_params_t *params = &ap_boot_params;
+    __asm__ volatile("mov %%cr0, %0" : "=r"(params->cr0));
+    __asm__ volatile("mov %%cr4, %0" : "=r"(params->cr4));
+    params->cr3 = (uint32_t)kernel_dir;
+    params->entry = (uint32_t)ap_main;
+
+    for (int i = 0; i < m->ncpus && ncpus < SMP_MAX_CPUS; i++) {
+        uint8_t id = m->cpu_apic_id[i];
+        if (id == bsp) continue;
+        int cpu = ncpus;
+        void *stack = pmm_alloc_pages(AP_STACK_PAGES, PMM_UNINIT);
+        if (!stack) break;
+
+        cpus[cpu].apic_id = id;
+        cpus[cpu].stack = stack;
+        params->stack = (uint32_t)stack + AP_STACK_PAGES * 4096;
+        booting_cpu = cpu;
+
+        if (start_ap(cpu)) {
+            ncpus++;
+        } else {
+            pmm_free_pages(stack, AP_STACK_PAGES);
+            memset(&cpus[cpu], 0, sizeof(cpus[cpu]));
+        }
+    }
+}
+
+/* ── Cross-CPU calls ──────────────────────────────────────── */
+
+/* Reserve an idle AP's mailbox; it stays on its idle loop until the
+ * call is posted and done */
+static int call_claim(int cpu) {
+    if (cpu <= 0 || cpu >= ncpus) return 0;
+    uint8_t idle = CPU_IDLE;
+    return __atomic_compare_exchange_n(&cpus[cpu].state, &idle, CPU_POST, 0,
+                                       __ATOMIC_ACQUIRE, __ATOMIC_RELAXED);
+}
+
+static void call_post(int cpu, smp_fn_t fn, void *arg) {
+    smp_cpu_t *c = &cpus[cpu];
+    c->fn = fn;
+    c->arg = arg;
+    __atomic_store_n(&c->state, CPU_CALL, __ATOMIC_RELEASE);
+    lapic_send_ipi(c->apic_id, ICR_FIXED | SMP_IPI_VECTOR);
+}
+
+int smp_call(int cpu, smp_fn_t fn, void *arg) {
+    if (!fn || !call_claim(cpu)) return -1;
+    call_post(cpu, fn, arg);
+    return 0;
+}
+
+int smp_call_busy(int cpu) {
+    if (cpu <= 0 || cpu >= ncpus) return 0;
+    uint8_t st = __atomic_load_n(&cpus[cpu].state, __ATOMIC_ACQUIRE);
+    return st == CPU_POST || st == CPU_CALL;
+}
+
+void smp_wait(int cpu) {
+    while (smp_call_busy(cpu)) __asm__ volatile("pause");
+}
+
+/* ── Fork/join ────────────────────────────────────────────── */
+
+typedef struct {
+    smp_part_fn_t fn;
+    void *arg;
+    int   part, nparts;
+} part_job_t;
+
+static part_job_t part_jobs[SMP_MAX_CPUS];
+static spinlock_t part_lock = SPINLOCK_INIT;
+
+static void part_entry(void *p) {
+    part_job_t *j = (part_job_t *)p;
+    j->fn(j->arg, j->part, j->nparts);
+}
+
+/* part_lock is taken raw, outside the IRQ lock: a big flip must not
+ * hold off the BSP's interrupts, and the helpers never take it. */
+int smp_parallel(smp_part_fn_t fn, void *arg) {
+    if (ncpus == 1) {
+        fn(arg, 0, 1);
+        return 1;
+    }
+
+    preempt_disable();
+    spin_lock_raw(&part_lock);
+    int self = smp_cpu_id();
+    int helpers[SMP_MAX_CPUS], nh = 0;
+    for (int cpu = 1; cpu < ncpus; cpu++)
+        if (cpu != self && call_claim(cpu)) helpers[nh++] = cpu;
+    int nparts = nh + 1;
+
+    for (int i = 0; i < nh; i++) {
+        part_job_t *j = &part_jobs[helpers[i]];
+        j->fn = fn; j->arg = arg;
+        j->part = i + 1; j->nparts = nparts;
+        call_post(helpers[i], part_entry, j);
+    }
+    fn(arg, 0, nparts);
+    for (int i = 0; i < nh; i++) smp_wait(helpers[i]);
+    spin_unlock_raw(&part_lock);
+    preempt_enable();
+    return nparts;
+}
@@ -0,0 +1,62 @@
+#ifndef SMP_H
+#define SMP_H
+
+#include <stdint.h>
+#include "gdt.h"
+
+#define SMP_MAX_CPUS   8
+#define SMP_IPI_VECTOR   0xF0   /* smp_call() wake-up and reschedule */
+#define SMP_TIMER_VECTOR 0xEF   /* an AP's local APIC timer: its scheduler tick */
+
+typedef void (*smp_fn_t)(void *arg);
+
+/* Start every processor the MADT lists (INIT-SIPI-SIPI). Run on the
+ * BSP after paging_init and with the timer running. */
+void smp_init(void);
+
+int  smp_cpu_count(void);       /* CPUs online, BSP included */
+
+/* 0 = BSP, 1.. = APs in start order. Each CPU runs on its own TSS,
+ * so the task register names the CPU without touching the APIC. */
+static inline int smp_cpu_id(void) {
+    uint16_t tr;
+    __asm__ volatile ("str %0" : "=r"(tr));
+    return tr ? (tr >> 3) - GDT_TSS0 : 0;
+}
+
+/* ── Cross-CPU calls ──────────────────────────────────────────
+ * An AP's boot thread is its idle loop: it runs processes while
+ * any are runnable (process.c) and otherwise halts until a call
+ * is posted. smp_call hands fn(arg) to AP `cpu` and returns at
+ * once: -1 if that CPU is not online, is still busy with the last
+ * call or is running processes. fn runs in ring 0 with IRQs
+ * enabled, on the AP's own stack, and must not take the IRQ lock
+ * (cpu.h): the caller may be holding it while it waits.          */
+int  smp_call(int cpu, smp_fn_t fn, void *arg);
+int  smp_call_busy(int cpu);    /* 1 while a posted call has not returned */
+void smp_wait(int cpu);         /* spin until it has */
+
+/* ── Scheduling hooks (process.c) ─────────────────────────────
+ * An AP leaves its idle loop for a process only when no call is
+ * posted to it, so smp_call never waits on process work.        */
+int  smp_leave_idle(void);      /* AP: 1 = may switch to a process */
+void smp_enter_idle(void);      /* AP: back on the idle loop */
+void smp_resched(int cpu);      /* IPI: run switch_context there */
+
+/* ── Fork/join ────────────────────────────────────────────────
+ * smp_parallel runs fn(arg, part, nparts) once per part: part 0 on
+ * the caller, the rest on idle APs, and returns when every part has
+ * finished. nparts is 1 on a uniprocessor or when no AP is idle, so
+ * fn must cope with doing all the work itself.                    */
+typedef void (*smp_part_fn_t)(void *arg, int part, int nparts);
+
+int  smp_parallel(smp_part_fn_t fn, void *arg);    /* returns nparts */
+
+/* Part `part` of [lo, hi) split into nparts near-equal runs */
+static inline void smp_split(int lo, int hi, int part, int nparts, int *a, int *b) {
+    int n = hi - lo;
+    *a = lo + n * part / nparts;
+    *b = lo + n * (part + 1) / nparts;
+}
+
+#endif
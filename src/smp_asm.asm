@@ -0,0 +1,123 @@
+; ============================================================
+; SwanOS — AP Trampoline and APIC Interrupt Stubs
+; ap_trampoline_start..end is copied to TRAMP_BASE (0x8000) and
+; entered in real mode by the startup IPI; it switches to
+; protected mode and jumps into the kernel at ap_pm32, which
+; loads the BSP's control registers from ap_boot_params.
+; ============================================================
+
+TRAMP_BASE equ 0x8000
+
+; Offset of a trampoline label once copied to TRAMP_BASE
+%define TRAMP(x) (TRAMP_BASE + (x) - ap_trampoline_start)
+
+extern ap_boot_params       ; tramp_params_t: cr0, cr3, cr4, stack, entry
+extern smp_interrupt
+extern switch_context
+extern switch_finish
+
+global ap_trampoline_start
+global ap_trampoline_end
+global smp_ipi_stub
+global smp_timer_stub
+global smp_spurious_stub
+
+section .text
+
+; ── Real mode (position independent via TRAMP) ─────────────
+[bits 16]
+ap_trampoline_start:
+    cli
+    cld
+    xor ax, ax
+    mov ds, ax
+    o32 lgdt [TRAMP(tramp_gdt_ptr)]
+    mov eax, cr0
+    or eax, 1               ; PE
+    mov cr0, eax
+    jmp dword 0x08:ap_pm32  ; kernel is loaded at its link address
+
+align 8
+tramp_gdt:
+    dq 0
+    dq 0x00CF9A000000FFFF   ; 0x08: flat code, same as the kernel GDT
+    dq 0x00CF92000000FFFF   ; 0x10: flat data
+tramp_gdt_ptr:
+    dw 3 * 8 - 1
+    dd TRAMP(tramp_gdt)
+ap_trampoline_end:
+
+; ── Protected mode ─────────────────────────────────────────
+[bits 32]
+ap_pm32:
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    mov ss, ax
+
+    mov eax, [ap_boot_params + 8]   ; CR4 first: PSE/PGE/OSFXSR as on the BSP
+    mov cr4, eax
+    mov eax, [ap_boot_params + 4]
+    mov cr3, eax
+    mov eax, [ap_boot_params + 0]   ; PG, WP, FPU bits
+    mov cr0, eax
+
+    mov esp, [ap_boot_params + 12]
+    xor ebp, ebp
+    call [ap_boot_params + 16]      ; ap_main, never returns
+.halt:
+    cli
+    hlt
+    jmp .halt
+
+; ── SMP_IPI_VECTOR / SMP_TIMER_VECTOR ──────────────────────
+; Same frame as irq_common_stub (idt_asm.asm), so a tick or a
+; resched IPI can hand the CPU to another process
+smp_ipi_stub:
+    cli
+    push dword 0            ; dummy error code
+    push dword 0xF0         ; SMP_IPI_VECTOR
+    jmp smp_common_stub
+
+smp_timer_stub:
+    cli
+    push dword 0
+    push dword 0xEF         ; SMP_TIMER_VECTOR
+    jmp smp_common_stub
+
+smp_common_stub:
+    pusha
+    mov ax, ds
+    push eax
+
+    mov ax, 0x10
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    cld
+
+    push esp                ; registers_t *
+    call smp_interrupt
+    add esp, 4
+
+    push esp
+    call switch_context
+    add esp, 4
+    mov esp, eax
+    call switch_finish      ; now off the old process's stack
+
+    pop eax
+    mov ds, ax
+    mov es, ax
+    mov fs, ax
+    mov gs, ax
+    popa
+    add esp, 8
+    iret
+
+; ── Spurious vector: no EOI ────────────────────────────────
+smp_spurious_stub:
+    iret
@@ -0,0 +1,69 @@
+/* ============================================================
+ * SwanOS — Deferred Interrupt Work
+ * Softirq bits raised by IRQ top halves, drained by the softirqd
+ * worker or inline by consumers that are about to read input.
+ * ============================================================ */
+
+#include "softirq.h"
+#include "process.h"
+#include "cpu.h"
+
+static softirq_fn_t handlers[SOFTIRQ_COUNT];
+static volatile uint32_t pending = 0;
+static volatile int running = 0;
+static uint32_t runs[SOFTIRQ_COUNT];
+static wait_queue_t raised;
+
+void softirq_register(int nr, softirq_fn_t fn) {
+    if (nr >= 0 && nr < SOFTIRQ_COUNT) handlers[nr] = fn;
+}
+
+void softirq_raise(int nr) {
+    __atomic_or_fetch(&pending, 1u << nr, __ATOMIC_RELEASE);
+    wake_up(&raised);
+}
+
+/* Work softirq_run would do now: while another context is inside
+ * the handlers, it picks up new bits itself */
+int softirq_pending(void) {
+    return pending && !running;
+}
+
+wait_queue_t *softirq_queue(void) {
+    return &raised;
+}
+
+uint32_t softirq_count(int nr) {
+    return (nr >= 0 && nr < SOFTIRQ_COUNT) ? runs[nr] : 0;
+}
+
+void softirq_run(void) {
+    /* A raise that lands while a handler runs sets its bit again and
+     * goes round once more. One that lands after the last exchange but
+     * before running is cleared was skipped by everyone else (they saw
+     * running), so look again once it is clear. */
+    while (pending && !__atomic_exchange_n(&running, 1, __ATOMIC_ACQUIRE)) {
+        uint32_t work;
+        while ((work = __atomic_exchange_n(&pending, 0, __ATOMIC_ACQUIRE))) {
+            for (int nr = 0; nr < SOFTIRQ_COUNT; nr++) {
+                if (!(work & (1u << nr)) || !handlers[nr]) continue;
+                handlers[nr]();
+                runs[nr]++;
+            }
+        }
+        __atomic_store_n(&running, 0, __ATOMIC_SEQ_CST);
+    }
+}
+
+static void softirqd_main(void) {
+    while (1) {
+        softirq_run();
+        uint32_t flags = irq_save();
+        if (!softirq_pending()) sleep_on(&raised);
+        irq_restore(flags);
+    }
+}
+
+void softirq_init(void) {
+    process_create_named(softirqd_main, 0, "softirqd", PRIORITY_HIGH);
+}
@@ -0,0 +1,37 @@
+#ifndef SOFTIRQ_H
+#define SOFTIRQ_H
+
+#include <stdint.h>
+#include "wait.h"
+
+/* ── Deferred interrupt work ──────────────────────────────────
+ * A top half (IRQ handler) only moves bytes off the device into a
+ * ring and raises its softirq; the bottom half registered for that
+ * number does the decoding later, in task context with IRQs on.
+ *
+ * Pending work is run by the softirqd worker, and by any consumer
+ * calling softirq_run before it reads, so a busy desktop loop sees
+ * its input without waiting for the worker to be scheduled. Only
+ * one context runs bottom halves at a time; each runs until its
+ * ring is empty.                                                  */
+#define SOFTIRQ_KEYBOARD 0
+#define SOFTIRQ_MOUSE    1
+#define SOFTIRQ_SERIAL   2
+#define SOFTIRQ_NET      3
+#define SOFTIRQ_INET     4        /* protocol stack, after SOFTIRQ_NET */
+#define SOFTIRQ_COUNT    5
+
+typedef void (*softirq_fn_t)(void);
+
+void softirq_init(void);        /* spawns softirqd; after process_init */
+void softirq_register(int nr, softirq_fn_t fn);
+void softirq_raise(int nr);     /* from IRQ handlers */
+int  softirq_pending(void);     /* work that softirq_run would do now */
+void softirq_run(void);         /* task context; no-op if already running */
+
+/* Woken on every raise, for consumers that sleep until input */
+wait_queue_t *softirq_queue(void);
+
+uint32_t softirq_count(int nr); /* bottom-half runs since boot */
+
+#endif
@@ -0,0 +1,128 @@
+#ifndef SPINLOCK_H
+#define SPINLOCK_H
+
+#include <stdint.h>
+#include "cpu.h"
+
+/* ── Ticket spinlocks ─────────────────────────────────────────
+ * Lockers take a ticket and spin until it is served, so waiters
+ * get the lock in arrival order. Two flavours:
+ *
+ *   spin_lock / spin_unlock           data no IRQ handler touches;
+ *                                     preemption is held off, IRQs
+ *                                     stay on
+ *   spin_lock_irqsave / _irqrestore   data shared with IRQ handlers
+ *
+ * Not recursive, and never sleep (sleep_on, yield) while holding
+ * either: on one CPU the holder could then never be resumed.     */
+typedef struct {
+    volatile uint16_t owner;    /* ticket now being served */
+    volatile uint16_t next;     /* next ticket to hand out */
+} spinlock_t;
+
+#define SPINLOCK_INIT { 0, 0 }
+
+/* process.c: nests; a tick that lands inside only marks a switch due */
+void preempt_disable(void);
+void preempt_enable(void);
+
+static inline void spin_lock_init(spinlock_t *l) {
+    l->owner = l->next = 0;
+}
+
+/* Lock without touching IRQs or preemption (caller has IRQs off) */
+static inline void spin_lock_raw(spinlock_t *l) {
+    uint16_t ticket = __atomic_fetch_add(&l->next, 1, __ATOMIC_ACQUIRE);
+    while (__atomic_load_n(&l->owner, __ATOMIC_ACQUIRE) != ticket)
+        __asm__ volatile ("pause");
+}
+
+static inline void spin_unlock_raw(spinlock_t *l) {
+    __atomic_store_n(&l->owner, (uint16_t)(l->owner + 1), __ATOMIC_RELEASE);
+}
+
+static inline int spin_is_locked(const spinlock_t *l) {
+    return l->owner != l->next;
+}
+
+/* Takes the IRQ lock too (cpu.h), with IF off just while doing so
+ * (an IRQ landing mid-wait would queue behind its own CPU): every
+ * lock then nests inside it and no two can be taken in opposite
+ * orders. IRQs stay on for the rest of the section. */
+static inline void spin_lock(spinlock_t *l) {
+    preempt_disable();
+    uint32_t flags = local_irq_save();
+    irq_lock();
+    local_irq_restore(flags);
+    spin_lock_raw(l);
+}
+
+static inline void spin_unlock(spinlock_t *l) {
+    spin_unlock_raw(l);
+    uint32_t flags = local_irq_save();
+    irq_unlock();
+    local_irq_restore(flags);
+    preempt_enable();
+}
+
+static inline uint32_t spin_lock_irqsave(spinlock_t *l) {
+    uint32_t flags = irq_save();
+    spin_lock_raw(l);
+    return flags;
+}
+
+static inline void spin_unlock_irqrestore(spinlock_t *l, uint32_t flags) {
+    spin_unlock_raw(l);
+    irq_restore(flags);
+}
+
+/* ── Sequence locks ───────────────────────────────────────────
+ * For read-mostly data: writers serialise on the lock and make
+ * the count odd while they work; readers take no lock and retry
+ * if the count moved under them.
+ *
+ *     uint32_t seq;
+ *     do {
+ *         seq = read_seqbegin(&sl);
+ *         ...copy the fields out...
+ *     } while (read_seqretry(&sl, seq));
+ *
+ * Loads and stores are each kept in order on x86, so a compiler
+ * barrier is all the ordering needed.                           */
+typedef struct {
+    volatile uint32_t seq;
+    spinlock_t        lock;
+} seqlock_t;
+
+#define SEQLOCK_INIT { 0, SPINLOCK_INIT }
+
+static inline void seq_barrier(void) {
+    __asm__ volatile ("" ::: "memory");
+}
+
+static inline uint32_t write_seqlock_irqsave(seqlock_t *s) {
+    uint32_t flags = spin_lock_irqsave(&s->lock);
+    s->seq++;
+    seq_barrier();
+    return flags;
+}
+
+static inline void write_sequnlock_irqrestore(seqlock_t *s, uint32_t flags) {
+    seq_barrier();
+    s->seq++;
+    spin_unlock_irqrestore(&s->lock, flags);
+}
+
+static inline uint32_t read_seqbegin(const seqlock_t *s) {
+    uint32_t seq;
+    while ((seq = s->seq) & 1) __asm__ volatile ("pause");
+    seq_barrier();
+    return seq;
+}
+
+static inline int read_seqretry(const seqlock_t *s, uint32_t seq) {
+    seq_barrier();
+    return s->seq != seq;
+}
+
+#endif
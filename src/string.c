@@ -5,10 +5,26 @@
 
 #include "string.h"
 
+/* ── Word-at-a-time scanning ──────────────────────────────────
+ * An aligned 32-bit load never crosses a page, so the scans may
+ * read a few bytes past the terminator within the last word.
+ * HAS_ZERO(v) is nonzero iff some byte of v is zero; it may flag
+ * a 0x80 byte above a real zero, so the exact byte is found with
+ * a byte loop afterwards.                                       */
+typedef uint32_t __attribute__((may_alias)) word_t;
+
+#define ONES      0x01010101u
+#define HIGHS     0x80808080u
+#define HAS_ZERO(v) (((v) - ONES) & ~(v) & HIGHS)
+
 int strlen(const char *s) {
-    int len = 0;
-    while (s[len]) len++;
-    return len;
+    const char *p = s;
+    for (; (uintptr_t)p & 3; p++)
+        if (!*p) return (int)(p - s);
+    const word_t *w = (const word_t *)p;
+    while (!HAS_ZERO(*w)) w++;
+    for (p = (const char *)w; *p; p++);
+    return (int)(p - s);
 }
 
 int strcmp(const char *a, const char *b) {
@@ -44,11 +60,21 @@ char *strcat(char *dst, const char *src) {
 }
 
 char *strchr(const char *s, int c) {
-    while (*s) {
-        if (*s == (char)c) return (char *)s;
-        s++;
+    char ch = (char)c;
+    for (; (uintptr_t)s & 3; s++) {
+        if (*s == ch) return (char *)s;
+        if (!*s) return 0;
+    }
+    uint32_t pat = (uint8_t)ch * ONES;
+    const word_t *w = (const word_t *)s;
+    for (;; w++) {
+        uint32_t v = *w;
+        if (HAS_ZERO(v) || HAS_ZERO(v ^ pat)) break;
+    }
+    for (s = (const char *)w; ; s++) {
+        if (*s == ch) return (char *)s;
+        if (!*s) return 0;
     }
-    return (c == '\0') ? (char *)s : 0;
 }
 
 char *strstr(const char *haystack, const char *needle) {
@@ -65,20 +91,63 @@ char *strstr(const char *haystack, const char *needle) {
     return 0;
 }
 
+void *memchr(const void *s, int c, size_t n) {
+    const uint8_t *p = (const uint8_t *)s;
+    uint8_t ch = (uint8_t)c;
+    for (; n && ((uintptr_t)p & 3); p++, n--)
+        if (*p == ch) return (void *)p;
+    uint32_t pat = ch * ONES;
+    for (; n >= 4; p += 4, n -= 4)
+        if (HAS_ZERO(*(const word_t *)p ^ pat)) break;
+    for (; n; p++, n--)
+        if (*p == ch) return (void *)p;
+    return 0;
+}
+
+/* ── Bulk copy and fill ───────────────────────────────────────
+ * Short runs stay on the byte string ops. Longer ones align the
+ * destination (unaligned loads are cheap on x86, split stores are
+ * not), move dwords, then finish the tail bytes.                */
+#define BULK_MIN 16
+
 void *memset(void *ptr, int val, size_t n) {
-    /* Use x86 rep stosb for fast fill */
+    void *d = ptr;
+    uint32_t fill = (uint8_t)val * ONES;
+    if (n >= BULK_MIN) {
+        size_t head = -(uintptr_t)d & 3, words = (n - head) >> 2;
+        n = (n - head) & 3;
+        __asm__ volatile (
+            "rep stosb\n\t"
+            "mov %3, %1\n\t"
+            "rep stosl"
+            : "+D"(d), "+c"(head)
+            : "a"(fill), "r"(words)
+            : "memory"
+        );
+    }
     __asm__ volatile (
         "rep stosb"
-        : "+D"(ptr), "+c"(n)
-        : "a"((uint8_t)val)
+        : "+D"(d), "+c"(n)
+        : "a"(fill)
         : "memory"
     );
     return ptr;
 }
 
 void *memcpy(void *dst, const void *src, size_t n) {
-    /* Use x86 rep movsb for fast copy */
     void *d = dst;
+    if (n >= BULK_MIN) {
+        size_t head = -(uintptr_t)d & 3, words = (n - head) >> 2;
+        n = (n - head) & 3;
+        __asm__ volatile (
+            "rep movsb\n\t"
+            "mov %3, %2\n\t"
+            "rep movsl"
+            : "+D"(d), "+S"(src), "+c"(head)
+            : "r"(words)
+            : "memory"
+        );
+    }
     __asm__ volatile (
         "rep movsb"
         : "+D"(d), "+S"(src), "+c"(n)
@@ -88,6 +157,31 @@ void *memcpy(void *dst, const void *src, size_t n) {
     return dst;
 }
 
+/* Overlapping with dst above src: copy downwards with DF set, the
+ * tail bytes first and then dwords. DF is back clear on return,
+ * as the ABI expects. */
+void *memmove(void *dst, const void *src, size_t n) {
+    uintptr_t d = (uintptr_t)dst, s = (uintptr_t)src;
+    if (d <= s || d - s >= n) return memcpy(dst, src, n);
+
+    size_t tail = n & 3, words = n >> 2;
+    void *dp = (void *)(d + n - 1);
+    const void *sp = (const void *)(s + n - 1);
+    __asm__ volatile (
+        "std\n\t"
+        "rep movsb\n\t"
+        "sub $3, %0\n\t"
+        "sub $3, %1\n\t"
+        "mov %3, %2\n\t"
+        "rep movsl\n\t"
+        "cld"
+        : "+D"(dp), "+S"(sp), "+c"(tail)
+        : "r"(words)
+        : "memory", "cc"
+    );
+    return dst;
+}
+
 void itoa(int num, char *buf, int base) {
     char tmp[32];
     int i = 0, neg = 0;
@@ -133,3 +227,147 @@ char *trim(char *s) {
     *(end + 1) = '\0';
     return s;
 }
+
+/* ── Formatting ───────────────────────────────────────────── */
+
+typedef struct {
+    char *buf;
+    int   size, pos;            /* pos counts past size, for the return value */
+} fmt_out_t;
+
+static inline void fmt_put(fmt_out_t *o, char c) {
+    if (o->pos < o->size - 1) o->buf[o->pos] = c;
+    o->pos++;
+}
+
+static void fmt_pad(fmt_out_t *o, char c, int n) {
+    while (n-- > 0) fmt_put(o, c);
+}
+
+/* digits of v in base, most significant first; returns the count */
+static int fmt_digits(char *tmp, uint32_t v, unsigned base, int upper) {
+    const char *set = upper ? "0123456789ABCDEF" : "0123456789abcdef";
+    int n = 0;
+    do { tmp[n++] = set[v % base]; v /= base; } while (v);
+    for (int i = 0; i < n / 2; i++) {
+        char t = tmp[i]; tmp[i] = tmp[n - 1 - i]; tmp[n - 1 - i] = t;
+    }
+    return n;
+}
+
+int kvsnprintf(char *buf, int size, const char *fmt, va_list ap) {
+    fmt_out_t o = { buf, size, 0 };
+
+    for (; *fmt; fmt++) {
+        if (*fmt != '%') { fmt_put(&o, *fmt); continue; }
+        fmt++;
+
+        int left = 0, zero = 0, width = 0, prec = -1;
+        for (;; fmt++) {
+            if (*fmt == '-') left = 1;
+            else if (*fmt == '0') zero = 1;
+            else break;
+        }
+        if (*fmt == '*') { width = va_arg(ap, int); fmt++; }
+        else while (isdigit(*fmt)) width = width * 10 + (*fmt++ - '0');
+        if (width < 0) { left = 1; width = -width; }
+        if (*fmt == '.') {
+            fmt++;
+            prec = 0;
+            if (*fmt == '*') { prec = va_arg(ap, int); fmt++; }
+            else while (isdigit(*fmt)) prec = prec * 10 + (*fmt++ - '0');
+        }
+        while (*fmt == 'l') fmt++;
+
+        char tmp[12];
+        const char *str = tmp;
+        int len = 0, neg = 0;
+        switch (*fmt) {
+            case 'd': case 'i': {
+                int v = va_arg(ap, int);
+                neg = v < 0;
+                len = fmt_digits(tmp, neg ? 0u - (uint32_t)v : (uint32_t)v, 10, 0);
+                break;
+            }
+            case 'u': len = fmt_digits(tmp, va_arg(ap, uint32_t), 10, 0); break;
+            case 'x': len = fmt_digits(tmp, va_arg(ap, uint32_t), 16, 0); break;
+            case 'X': len = fmt_digits(tmp, va_arg(ap, uint32_t), 16, 1); break;
+            case 'p':
+                fmt_put(&o, '0'); fmt_put(&o, 'x');
+                len = fmt_digits(tmp, (uint32_t)(uintptr_t)va_arg(ap, void *), 16, 0);
+                break;
+            case 'c': tmp[0] = (char)va_arg(ap, int); len = 1; break;
+            case 's':
+                str = va_arg(ap, const char *);
+                if (!str) str = "(null)";
+                while ((prec < 0 || len < prec) && str[len]) len++;
+                prec = -1;
+                break;
+            case '%': tmp[0] = '%'; len = 1; break;
+            case '\0': fmt--; continue;        /* lone '%' at the end */
+            default:  tmp[0] = '%'; tmp[1] = *fmt; len = 2; break;
+        }
+
+        /* numbers: precision is a minimum digit count */
+        int zeros = prec > len ? prec - len : 0;
+        int body = neg + zeros + len;
+        if (zero && !left && prec < 0 && width > body) { zeros += width - body; body = width; }
+        if (!left) fmt_pad(&o, ' ', width - body);
+        if (neg) fmt_put(&o, '-');
+        fmt_pad(&o, '0', zeros);
+        for (int i = 0; i < len; i++) fmt_put(&o, str[i]);
+        if (left) fmt_pad(&o, ' ', width - body);
+    }
+    if (size > 0) buf[o.pos < size ? o.pos : size - 1] = '\0';
+    return o.pos;
+}
+
+int ksnprintf(char *buf, int size, const char *fmt, ...) {
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(buf, size, fmt, ap);
+    va_end(ap);
+    return n;
+}
+
+/* ── String builder ───────────────────────────────────────── */
+
+void sbuf_init(sbuf_t *sb, char *buf, int cap) {
+    sb->buf = buf;
+    sb->cap = cap;
+    sb->len = 0;
+    sb->overflow = 0;
+    if (cap > 0) buf[0] = '\0';
+}
+
+int sbuf_append_n(sbuf_t *sb, const char *s, int n) {
+    int room = sbuf_room(sb);
+    if (room < 0) room = 0;
+    if (n > room) { n = room; sb->overflow = 1; }
+    if (n > 0) {
+        memcpy(sb->buf + sb->len, s, n);
+        sb->len += n;
+        sb->buf[sb->len] = '\0';
+    }
+    return n;
+}
+
+int sbuf_append(sbuf_t *sb, const char *s) {
+    return sbuf_append_n(sb, s, strlen(s));
+}
+
+int sbuf_putc(sbuf_t *sb, char c) {
+    return sbuf_append_n(sb, &c, 1);
+}
+
+int sbuf_printf(sbuf_t *sb, const char *fmt, ...) {
+    int room = sbuf_room(sb);
+    if (room < 0) return 0;
+    va_list ap;
+    va_start(ap, fmt);
+    int n = kvsnprintf(sb->buf + sb->len, room + 1, fmt, ap);
+    va_end(ap);
+    if (n > room) { n = room; sb->overflow = 1; }
+    sb->len += n;
+    return n;
+}
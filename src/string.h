@@ -3,6 +3,7 @@
 
 #include <stdint.h>
 #include <stddef.h>
+#include <stdarg.h>
 
 int    strlen(const char *s);
 int    strcmp(const char *a, const char *b);
@@ -14,10 +15,48 @@ char  *strchr(const char *s, int c);
 char  *strstr(const char *haystack, const char *needle);
 void  *memset(void *ptr, int val, size_t n);
 void  *memcpy(void *dst, const void *src, size_t n);
+void  *memmove(void *dst, const void *src, size_t n);  /* overlap-safe */
+void  *memchr(const void *s, int c, size_t n);
 void   itoa(int num, char *buf, int base);
 int    atoi(const char *s);
 int    isdigit(int c);
 int    isspace(int c);
 char  *trim(char *s);
 
+/* ── Formatting ───────────────────────────────────────────────
+ * A freestanding subset of snprintf: %d %i %u %x %X %c %s %p %%,
+ * with '-' and '0' flags, a width and a precision (%.Ns, %.*s,
+ * %.Nd), and an ignored 'l'. Always NUL-terminates when size > 0
+ * and returns the length the full output would have had.        */
+int    ksnprintf(char *buf, int size, const char *fmt, ...)
+           __attribute__((format(printf, 3, 4)));
+int    kvsnprintf(char *buf, int size, const char *fmt, va_list ap);
+
+/* ── String builder ───────────────────────────────────────────
+ * Appends into a caller's fixed buffer, tracking the length so a
+ * chain of appends is linear rather than one strlen per strcat:
+ *
+ *     char out[256];
+ *     sbuf_t sb;
+ *     sbuf_init(&sb, out, sizeof(out));
+ *     sbuf_append(&sb, "pid ");
+ *     sbuf_printf(&sb, "%u -> %u\n", a, b);
+ *
+ * Output past the capacity is dropped and sets `overflow`; the
+ * buffer stays NUL-terminated throughout.                       */
+typedef struct {
+    char *buf;
+    int   cap;                  /* bytes, NUL included */
+    int   len;
+    int   overflow;
+} sbuf_t;
+
+void   sbuf_init(sbuf_t *sb, char *buf, int cap);
+int    sbuf_append(sbuf_t *sb, const char *s);          /* bytes added */
+int    sbuf_append_n(sbuf_t *sb, const char *s, int n);
+int    sbuf_putc(sbuf_t *sb, char c);
+int    sbuf_printf(sbuf_t *sb, const char *fmt, ...)
+           __attribute__((format(printf, 2, 3)));
+static inline int sbuf_room(const sbuf_t *sb) { return sb->cap - 1 - sb->len; }
+
 #endif
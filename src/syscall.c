@@ -4,16 +4,16 @@
 #include "memory.h"
 #include "string.h"
 #include "screen.h"
-
-extern int yield_requested;
+#include "trace.h"
 
 void syscall_handler(registers_t *regs) {
+    TRACE(TR_SYSCALL, regs->eax, current_process ? current_process->pid : 0);
     switch (regs->eax) {
         case 0: /* YIELD */
             yield_requested = 1;
             break;
         case 1: /* MALLOC */
-            regs->eax = (uint32_t)kmalloc(regs->ebx);
+            regs->eax = (uint32_t)kzalloc(regs->ebx);
             break;
         case 2: /* IPC SEND */
             regs->eax = (uint32_t)process_ipc_send(regs->ebx, (void*)regs->ecx, regs->edx);
@@ -21,6 +21,24 @@ void syscall_handler(registers_t *regs) {
         case 3: /* IPC RECV */
             regs->eax = (uint32_t)process_ipc_recv((uint32_t*)regs->ebx, (void*)regs->ecx, regs->edx);
             break;
+        case 4: /* FORK */
+            regs->eax = (uint32_t)process_fork(regs);
+            break;
+        case 5: /* SLEEP (ms) */
+            process_sleep_ms(regs->ebx);
+            regs->eax = 0;
+            break;
+        case 6: /* IPC RECV, blocking */
+            regs->eax = (uint32_t)process_ipc_recv_wait((uint32_t*)regs->ebx, (void*)regs->ecx, regs->edx, 0);
+            break;
+        case 7: /* IPC SEND PAGES (ownership transfer) */
+            regs->eax = (uint32_t)process_ipc_send_pages(regs->ebx, (void*)regs->ecx, regs->edx,
+                                                         (const void*)regs->esi, regs->edi);
+            break;
+        case 8: /* IPC RECV PAGES */
+            regs->eax = (uint32_t)process_ipc_recv_pages((uint32_t*)regs->ebx, (void*)regs->ecx, regs->edx,
+                                                         (void**)regs->esi, (uint32_t*)regs->edi);
+            break;
         default:
             screen_print("Unknown syscall!\n");
             break;
@@ -49,6 +67,14 @@ static inline uint32_t syscall3(uint32_t num, uint32_t p1, uint32_t p2, uint32_t
     return a;
 }
 
+static inline uint32_t syscall5(uint32_t num, uint32_t p1, uint32_t p2, uint32_t p3,
+                                uint32_t p4, uint32_t p5) {
+    uint32_t a;
+    __asm__ volatile("int $0x80" : "=a" (a)
+                     : "0" (num), "b" (p1), "c" (p2), "d" (p3), "S" (p4), "D" (p5) : "memory");
+    return a;
+}
+
 void sys_yield(void) {
     syscall0(0);
 }
@@ -64,3 +90,23 @@ int sys_ipc_send(uint32_t dest_pid, void *msg, uint32_t len) {
 int sys_ipc_recv(uint32_t *src_pid, void *msg, uint32_t max_len) {
     return (int)syscall3(3, (uint32_t)src_pid, (uint32_t)msg, max_len);
 }
+
+int sys_fork(void) {
+    return (int)syscall0(4);
+}
+
+void sys_sleep(uint32_t ms) {
+    syscall1(5, ms);
+}
+
+int sys_ipc_recv_wait(uint32_t *src_pid, void *msg, uint32_t max_len) {
+    return (int)syscall3(6, (uint32_t)src_pid, (uint32_t)msg, max_len);
+}
+
+int sys_ipc_send_pages(uint32_t dest_pid, void *addr, uint32_t npages, const void *msg, uint32_t len) {
+    return (int)syscall5(7, dest_pid, (uint32_t)addr, npages, (uint32_t)msg, len);
+}
+
+int sys_ipc_recv_pages(uint32_t *src_pid, void *msg, uint32_t max_len, void **pages, uint32_t *npages) {
+    return (int)syscall5(8, (uint32_t)src_pid, (uint32_t)msg, max_len, (uint32_t)pages, (uint32_t)npages);
+}
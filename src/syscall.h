@@ -10,5 +10,11 @@ void sys_yield(void);
 void *sys_malloc(uint32_t size);
 int sys_ipc_send(uint32_t dest_pid, void *msg, uint32_t len);
 int sys_ipc_recv(uint32_t *src_pid, void *msg, uint32_t max_len);
+int sys_fork(void);           /* child pid in the parent, 0 in the child */
+void sys_sleep(uint32_t ms);
+int sys_ipc_recv_wait(uint32_t *src_pid, void *msg, uint32_t max_len);  /* blocks until a message */
+/* Zero-copy: the pages leave the sender and are mapped into the receiver */
+int sys_ipc_send_pages(uint32_t dest_pid, void *addr, uint32_t npages, const void *msg, uint32_t len);
+int sys_ipc_recv_pages(uint32_t *src_pid, void *msg, uint32_t max_len, void **pages, uint32_t *npages);
 
 #endif
@@ -0,0 +1,491 @@
+/* ============================================================
+ * SwanOS — TCP
+ * Client connections over the IPv4 layer: handshake, in-order
+ * receive, go-back-N retransmit and an orderly close. Tasks
+ * queue bytes into per-connection rings; the inet bottom half
+ * turns them into segments.
+ * ============================================================ */
+
+#include "tcp.h"
+#include "netdev.h"
+#include "spinlock.h"
+#include "timer.h"
+#include "string.h"
+#include "cpu.h"
+#include <stddef.h>
+
+#define TCP_HLEN       20
+#define TCP_MSS        (NET_MTU - IP_HLEN - TCP_HLEN)
+#define TCP_TIME_WAIT_TICKS 20  /* 2 s; the peer is on the LAN */
+#define TCP_MASK       (TCP_BUF - 1)
+
+#define F_FIN 0x01
+#define F_SYN 0x02
+#define F_RST 0x04
+#define F_PSH 0x08
+#define F_ACK 0x10
+
+typedef struct {
+    uint8_t  state;
+    uint8_t  error;
+    uint8_t  used;              /* handle handed out, not yet closed */
+    uint8_t  fin_queued;        /* close asked for */
+    uint8_t  fin_sent;          /* FIN is at snd_nxt - 1 */
+    uint8_t  fin_out;           /* FIN sent at least once */
+    uint8_t  ack_now;
+    uint8_t  retries;
+    ip4_t    raddr;
+    uint16_t lport, rport;
+    uint16_t mss;
+
+    uint32_t iss, snd_una, snd_nxt, snd_max, snd_wnd;   /* snd_max: highest sent */
+    uint32_t rcv_nxt;
+    uint32_t adv_wnd;           /* window in the last segment sent */
+    uint16_t rto, rto_left;     /* inet ticks; rto_left 0 = timer off */
+    uint16_t linger;            /* TIME_WAIT countdown */
+
+    /* Free-running indices; tx_una holds the byte at snd_una */
+    uint32_t tx_una, tx_wr;
+    uint32_t rx_rd, rx_wr;
+    uint8_t  tx[TCP_BUF];
+    uint8_t  rx[TCP_BUF];
+    wait_queue_t wait;
+} tcp_conn_t;
+
+static tcp_conn_t conns[TCP_MAX_CONN];
+static spinlock_t tcp_lock = SPINLOCK_INIT;
+static uint16_t next_port = 49152;
+
+static const char *state_names[TCP_STATES] = {
+    "CLOSED", "SYN_SENT", "ESTABLISHED", "FIN_WAIT_1", "FIN_WAIT_2",
+    "CLOSING", "TIME_WAIT", "CLOSE_WAIT", "LAST_ACK"
+};
+
+static inline int seq_lt(uint32_t a, uint32_t b)  { return (int32_t)(a - b) < 0; }
+static inline int seq_leq(uint32_t a, uint32_t b) { return (int32_t)(a - b) <= 0; }
+
+static tcp_conn_t *conn(int c) {
+    return c >= 0 && c < TCP_MAX_CONN && conns[c].used ? &conns[c] : 0;
+}
+
+static uint32_t rx_space(const tcp_conn_t *t) {
+    return TCP_BUF - (t->rx_wr - t->rx_rd);
+}
+
+static uint32_t tx_queued(const tcp_conn_t *t) {
+    return t->tx_wr - t->tx_una;
+}
+
+/* States in which our side may still send data */
+static int can_send(const tcp_conn_t *t) {
+    return t->state == TCP_ESTABLISHED || t->state == TCP_CLOSE_WAIT;
+}
+
+static void set_closed(tcp_conn_t *t, int err) {
+    t->state = TCP_CLOSED;
+    if (err) t->error = (uint8_t)err;
+    t->rto_left = 0;
+    wake_up(&t->wait);
+}
+
+/* ── Output ───────────────────────────────────────────────── */
+
+static uint16_t be16(const uint8_t *p) { return (uint16_t)(p[0] << 8 | p[1]); }
+static uint32_t be32(const uint8_t *p) { return (uint32_t)p[0] << 24 | p[1] << 16 | p[2] << 8 | p[3]; }
+static void put16(uint8_t *p, uint16_t v) { p[0] = (uint8_t)(v >> 8); p[1] = (uint8_t)v; }
+static void put32(uint8_t *p, uint32_t v) { put16(p, (uint16_t)(v >> 16)); put16(p + 2, (uint16_t)v); }
+
+static void send_raw(ip4_t dst, uint16_t sport, uint16_t dport, uint32_t seq,
+                     uint32_t ack, uint8_t flags, uint16_t wnd, netbuf_t *b) {
+    int opt = (flags & F_SYN) ? 4 : 0;
+    uint8_t *h = netbuf_push(b, TCP_HLEN + opt);
+    if (!h) { netbuf_free(b); return; }
+    put16(h, sport);
+    put16(h + 2, dport);
+    put32(h + 4, seq);
+    put32(h + 8, ack);
+    h[12] = (uint8_t)((TCP_HLEN + opt) / 4) << 4;
+    h[13] = flags;
+    put16(h + 14, wnd);
+    h[16] = h[17] = h[18] = h[19] = 0;
+    if (opt) {                          /* MSS */
+        h[20] = 2; h[21] = 4;
+        put16(h + 22, TCP_MSS);
+    }
+    const inet_config_t *cfg = inet_config();
+    uint16_t sum = inet_checksum(h, b->len, inet_pseudo_sum(cfg->addr, dst, IP_PROTO_TCP, b->len));
+    memcpy(h + 16, &sum, 2);
+    ip_output(b, dst, IP_PROTO_TCP);
+}
+
+/* One segment from seq, len payload bytes out of the send ring */
+static void send_segment(tcp_conn_t *t, uint32_t seq, int len, uint8_t flags) {
+    netbuf_t *b = netbuf_alloc();
+    if (!b) return;                     /* the retransmit timer covers it */
+    uint32_t at = t->tx_una + (seq - t->snd_una);
+    for (int i = 0; i < len; i++) b->data[i] = t->tx[(at + i) & TCP_MASK];
+    b->len = (uint16_t)len;
+    uint32_t wnd = rx_space(t);
+    if (wnd > 0xFFFF) wnd = 0xFFFF;
+    t->adv_wnd = wnd;
+    t->ack_now = 0;
+    if (t->state != TCP_SYN_SENT) flags |= F_ACK;
+    send_raw(t->raddr, t->lport, t->rport, seq, t->rcv_nxt, flags, (uint16_t)wnd, b);
+}
+
+static void sent_to(tcp_conn_t *t, uint32_t nxt) {
+    t->snd_nxt = nxt;
+    if (seq_lt(t->snd_max, nxt)) t->snd_max = nxt;
+    if (!t->rto_left) t->rto_left = t->rto;
+}
+
+/* Send everything the window allows, then a FIN if one is due */
+static void output(tcp_conn_t *t) {
+    if (t->state == TCP_SYN_SENT) {
+        if (t->snd_nxt == t->iss) {
+            send_segment(t, t->iss, 0, F_SYN);
+            sent_to(t, t->iss + 1);
+        }
+        return;
+    }
+    if (t->state == TCP_CLOSED) return;
+
+    if (t->state != TCP_TIME_WAIT && !t->fin_sent) {
+        uint32_t wnd = t->snd_wnd;
+        uint32_t flight = t->snd_nxt - t->snd_una;
+        if (!wnd && !flight) wnd = 1;   /* zero-window probe */
+        for (;;) {
+            uint32_t unsent = tx_queued(t) - (t->snd_nxt - t->snd_una);
+            flight = t->snd_nxt - t->snd_una;
+            if (!unsent || flight >= wnd) break;
+            uint32_t n = unsent;
+            if (n > t->mss) n = t->mss;
+            if (n > wnd - flight) n = wnd - flight;
+            send_segment(t, t->snd_nxt, (int)n, n == unsent ? F_PSH : 0);
+            sent_to(t, t->snd_nxt + n);
+        }
+        if (t->fin_queued && t->snd_nxt - t->snd_una == tx_queued(t)) {
+            send_segment(t, t->snd_nxt, 0, F_FIN);
+            sent_to(t, t->snd_nxt + 1);
+            t->fin_sent = t->fin_out = 1;
+            if (t->state == TCP_ESTABLISHED) t->state = TCP_FIN_WAIT_1;
+            else if (t->state == TCP_CLOSE_WAIT) t->state = TCP_LAST_ACK;
+        }
+    }
+    if (t->ack_now) send_segment(t, t->snd_nxt, 0, 0);
+}
+
+static void send_reset(ip4_t src, const uint8_t *h, int len) {
+    uint8_t flags = h[13];
+    if (flags & F_RST) return;
+    netbuf_t *b = netbuf_alloc();
+    if (!b) return;
+    b->len = 0;
+    uint32_t seq = 0, ack = 0;
+    uint8_t out = F_RST;
+    if (flags & F_ACK) {
+        seq = be32(h + 8);
+    } else {
+        int dlen = len - (h[12] >> 4) * 4;
+        ack = be32(h + 4) + (uint32_t)dlen + ((flags & F_SYN) ? 1 : 0) + ((flags & F_FIN) ? 1 : 0);
+        out |= F_ACK;
+    }
+    send_raw(src, be16(h + 2), be16(h), seq, ack, out, 0, b);
+}
+
+/* ── Input ────────────────────────────────────────────────── */
+
+static void parse_mss(tcp_conn_t *t, const uint8_t *opt, int n) {
+    while (n > 0) {
+        if (opt[0] == 0) break;
+        if (opt[0] == 1) { opt++; n--; continue; }
+        if (n < 2 || opt[1] < 2 || opt[1] > n) break;
+        if (opt[0] == 2 && opt[1] == 4) {
+            uint16_t mss = be16(opt + 2);
+            if (mss && mss < t->mss) t->mss = mss;
+        }
+        n -= opt[1];
+        opt += opt[1];
+    }
+}
+
+/* Our FIN, if sent, is covered by the new snd_una */
+static void fin_acked(tcp_conn_t *t) {
+    switch (t->state) {
+        case TCP_FIN_WAIT_1: t->state = TCP_FIN_WAIT_2; break;
+        case TCP_CLOSING:    t->state = TCP_TIME_WAIT; t->linger = TCP_TIME_WAIT_TICKS; break;
+        case TCP_LAST_ACK:   set_closed(t, 0); break;
+    }
+}
+
+/* After a go-back-N resend the peer may ack past snd_nxt, up to
+ * what was sent before; snd_nxt catches up */
+static void process_ack(tcp_conn_t *t, uint32_t ack, uint16_t wnd) {
+    if (seq_lt(t->snd_max, ack)) { t->ack_now = 1; return; }   /* acks the future */
+    if (seq_lt(ack, t->snd_una)) return;                        /* old duplicate */
+    t->snd_wnd = wnd;
+    if (ack == t->snd_una) return;
+
+    uint32_t acked = ack - t->snd_una;
+    int fin = t->fin_out && acked > tx_queued(t);
+    uint32_t data = fin ? tx_queued(t) : acked;
+    t->tx_una += data;
+    t->snd_una = ack;
+    if (seq_lt(t->snd_nxt, ack)) t->snd_nxt = ack;
+    if (fin) t->fin_sent = 1;
+    t->retries = 0;
+    t->rto = TCP_RTO_TICKS;
+    t->rto_left = t->snd_una == t->snd_nxt ? 0 : t->rto;
+    wake_up(&t->wait);
+    if (fin) fin_acked(t);
+}
+
+static void process_data(tcp_conn_t *t, uint32_t seq, const uint8_t *data, int len, int fin) {
+    if (len || fin) t->ack_now = 1;
+    if (t->state != TCP_ESTABLISHED && t->state != TCP_FIN_WAIT_1 && t->state != TCP_FIN_WAIT_2)
+        return;
+
+    /* Trim what we already have; anything beyond rcv_nxt is dropped */
+    if (seq_lt(seq, t->rcv_nxt)) {
+        uint32_t dup = t->rcv_nxt - seq;
+        if (dup > (uint32_t)len) return;
+        data += dup;
+        len -= (int)dup;
+        seq = t->rcv_nxt;
+    }
+    if (seq != t->rcv_nxt) return;
+
+    int n = len;
+    if ((uint32_t)n > rx_space(t)) { n = (int)rx_space(t); fin = 0; }
+    for (int i = 0; i < n; i++) t->rx[(t->rx_wr + i) & TCP_MASK] = data[i];
+    t->rx_wr += n;
+    t->rcv_nxt += n;
+    if (n) wake_up(&t->wait);
+
+    if (fin && n == len) {
+        t->rcv_nxt++;
+        switch (t->state) {
+            case TCP_ESTABLISHED: t->state = TCP_CLOSE_WAIT; break;
+            case TCP_FIN_WAIT_1:  t->state = TCP_CLOSING; break;
+            case TCP_FIN_WAIT_2:  t->state = TCP_TIME_WAIT; t->linger = TCP_TIME_WAIT_TICKS; break;
+        }
+        wake_up(&t->wait);
+    }
+}
+
+void tcp_input(ip4_t src, ip4_t dst, const uint8_t *h, int len) {
+    if (len < TCP_HLEN) return;
+    int hlen = (h[12] >> 4) * 4;
+    if (hlen < TCP_HLEN || hlen > len) return;
+    if (inet_checksum(h, len, inet_pseudo_sum(src, dst, IP_PROTO_TCP, len)) != 0) return;
+
+    uint16_t sport = be16(h), dport = be16(h + 2);
+    uint32_t seq = be32(h + 4), ack = be32(h + 8);
+    uint8_t flags = h[13];
+    uint16_t wnd = be16(h + 14);
+
+    uint32_t lflags = spin_lock_irqsave(&tcp_lock);
+    tcp_conn_t *t = 0;
+    for (int i = 0; i < TCP_MAX_CONN; i++) {
+        tcp_conn_t *c = &conns[i];
+        if (c->state != TCP_CLOSED && c->raddr == src && c->rport == sport && c->lport == dport) {
+            t = c;
+            break;
+        }
+    }
+    if (!t) {
+        spin_unlock_irqrestore(&tcp_lock, lflags);
+        send_reset(src, h, len);
+        return;
+    }
+
+    if (t->state == TCP_SYN_SENT) {
+        if ((flags & F_ACK) && ack != t->iss + 1) {
+            if (!(flags & F_RST)) send_reset(src, h, len);
+        } else if (flags & F_RST) {
+            if (flags & F_ACK) set_closed(t, TCP_ERR_REFUSED);
+        } else if ((flags & F_SYN) && (flags & F_ACK)) {
+            t->rcv_nxt = seq + 1;
+            t->snd_una = ack;
+            t->snd_wnd = wnd;
+            t->rto_left = 0;
+            t->retries = 0;
+            parse_mss(t, h + TCP_HLEN, hlen - TCP_HLEN);
+            t->state = TCP_ESTABLISHED;
+            t->ack_now = 1;
+            wake_up(&t->wait);
+            output(t);
+        }
+        spin_unlock_irqrestore(&tcp_lock, lflags);
+        return;
+    }
+
+    t->retries = 0;                     /* the peer is alive */
+    if (flags & F_RST) {
+        if (seq == t->rcv_nxt) {
+            set_closed(t, t->state == TCP_TIME_WAIT ? 0 : TCP_ERR_RESET);
+        }
+    } else if (flags & F_SYN) {
+        t->ack_now = 1;                 /* our handshake ACK was lost */
+        output(t);
+    } else if (flags & F_ACK) {
+        process_ack(t, ack, wnd);
+        if (t->state != TCP_CLOSED)
+            process_data(t, seq, h + hlen, len - hlen, flags & F_FIN);
+        if (t->state != TCP_CLOSED) output(t);
+    }
+    spin_unlock_irqrestore(&tcp_lock, lflags);
+}
+
+/* ── Timers ───────────────────────────────────────────────── */
+
+void tcp_tick(void) {
+    uint32_t flags = spin_lock_irqsave(&tcp_lock);
+    for (int i = 0; i < TCP_MAX_CONN; i++) {
+        tcp_conn_t *t = &conns[i];
+        if (t->state == TCP_TIME_WAIT) {
+            if (!t->linger || !--t->linger) set_closed(t, 0);
+            continue;
+        }
+        if (!t->rto_left || --t->rto_left) continue;
+
+        if (++t->retries > TCP_RETRIES) {
+            netbuf_t *b = netbuf_alloc();
+            if (b) {
+                b->len = 0;
+                send_raw(t->raddr, t->lport, t->rport, t->snd_nxt, t->rcv_nxt, F_RST | F_ACK, 0, b);
+            }
+            set_closed(t, TCP_ERR_TIMEOUT);
+            continue;
+        }
+        /* Go back to the oldest unacknowledged byte and resend */
+        t->rto = t->rto * 2 > TCP_RTO_MAX ? TCP_RTO_MAX : t->rto * 2;
+        t->snd_nxt = t->snd_una;
+        t->fin_sent = 0;
+        output(t);
+    }
+    spin_unlock_irqrestore(&tcp_lock, flags);
+}
+
+void tcp_flush(void) {
+    uint32_t flags = spin_lock_irqsave(&tcp_lock);
+    for (int i = 0; i < TCP_MAX_CONN; i++)
+        if (conns[i].state != TCP_CLOSED) output(&conns[i]);
+    spin_unlock_irqrestore(&tcp_lock, flags);
+}
+
+void tcp_init(void) {
+    memset(conns, 0, sizeof(conns));
+}
+
+/* ── Task side ────────────────────────────────────────────── */
+
+int tcp_connect(ip4_t dst, uint16_t port) {
+    uint32_t flags = spin_lock_irqsave(&tcp_lock);
+    int c = -1;
+    for (int i = 0; i < TCP_MAX_CONN; i++)
+        if (!conns[i].used && conns[i].state == TCP_CLOSED) { c = i; break; }
+    if (c < 0) {
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        return -1;
+    }
+    tcp_conn_t *t = &conns[c];
+    memset(t, 0, offsetof(tcp_conn_t, tx));     /* keep the rings and sleepers */
+    t->used = 1;
+    t->raddr = dst;
+    t->rport = port;
+    t->lport = next_port++;
+    if (next_port < 49152) next_port = 49152;
+    t->mss = TCP_MSS;
+    t->iss = (uint32_t)rdtsc() ^ timer_get_us();
+    t->snd_una = t->snd_nxt = t->snd_max = t->iss;
+    t->rto = TCP_RTO_TICKS;
+    t->state = TCP_SYN_SENT;
+    spin_unlock_irqrestore(&tcp_lock, flags);
+    inet_kick();
+    return c;
+}
+
+int tcp_write(int c, const void *data, int len) {
+    uint32_t flags = spin_lock_irqsave(&tcp_lock);
+    tcp_conn_t *t = conn(c);
+    if (!t || !can_send(t) || t->fin_queued || len < 0 || (uint32_t)len > TCP_BUF - tx_queued(t)) {
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        return -1;
+    }
+    const uint8_t *p = (const uint8_t *)data;
+    for (int i = 0; i < len; i++) t->tx[(t->tx_wr + i) & TCP_MASK] = p[i];
+    t->tx_wr += len;
+    spin_unlock_irqrestore(&tcp_lock, flags);
+    inet_kick();
+    return len;
+}
+
+int tcp_write_space(int c) {
+    tcp_conn_t *t = conn(c);
+    return t && can_send(t) && !t->fin_queued ? (int)(TCP_BUF - tx_queued(t)) : 0;
+}
+
+uint32_t tcp_unacked(int c) {
+    tcp_conn_t *t = conn(c);
+    return t ? tx_queued(t) : 0;
+}
+
+int tcp_read(int c, void *buf, int max) {
+    uint32_t flags = spin_lock_irqsave(&tcp_lock);
+    tcp_conn_t *t = conn(c);
+    if (!t) {
+        spin_unlock_irqrestore(&tcp_lock, flags);
+        return -1;
+    }
+    uint32_t avail = t->rx_wr - t->rx_rd;
+    int n = (uint32_t)max < avail ? max : (int)avail;
+    uint8_t *p = (uint8_t *)buf;
+    for (int i = 0; i < n; i++) p[i] = t->rx[(t->rx_rd + i) & TCP_MASK];
+    t->rx_rd += n;
+
+    /* Tell the peer once the window has opened up again */
+    int update = n && rx_space(t) >= t->adv_wnd + TCP_BUF / 2 &&
+                 (t->state == TCP_ESTABLISHED || t->state == TCP_FIN_WAIT_1 || t->state == TCP_FIN_WAIT_2);
+    if (update) t->ack_now = 1;
+    int done = !n && t->state != TCP_SYN_SENT && t->state != TCP_ESTABLISHED &&
+               t->state != TCP_FIN_WAIT_1 && t->state != TCP_FIN_WAIT_2;
+    spin_unlock_irqrestore(&tcp_lock, flags);
+    if (update) inet_kick();
+    return done ? -1 : n;
+}
+
+int tcp_readable(int c) {
+    tcp_conn_t *t = conn(c);
+    return t ? (int)(t->rx_wr - t->rx_rd) : 0;
+}
+
+void tcp_close(int c) {
+    uint32_t flags = spin_lock_irqsave(&tcp_lock);
+    tcp_conn_t *t = conn(c);
+    if (t) {
+        t->used = 0;
+        if (t->state == TCP_SYN_SENT) set_closed(t, 0);
+        else if (can_send(t)) t->fin_queued = 1;
+    }
+    spin_unlock_irqrestore(&tcp_lock, flags);
+    inet_kick();
+}
+
+int tcp_state(int c) {
+    tcp_conn_t *t = conn(c);
+    return t ? t->state : TCP_CLOSED;
+}
+
+int tcp_error(int c) {
+    tcp_conn_t *t = conn(c);
+    return t ? t->error : TCP_ERR_NONE;
+}
+
+const char *tcp_state_name(int state) {
+    return state >= 0 && state < TCP_STATES ? state_names[state] : "?";
+}
+
+wait_queue_t *tcp_queue(int c) {
+    return c >= 0 && c < TCP_MAX_CONN ? &conns[c].wait : 0;
+}
@@ -0,0 +1,71 @@
+#ifndef TCP_H
+#define TCP_H
+
+#include <stdint.h>
+#include "inet.h"
+#include "wait.h"
+
+/* ── TCP ──────────────────────────────────────────────────────
+ * A small client-side TCP: active open only, in-order receive (an
+ * out-of-order segment is dropped and re-acked), go-back-N
+ * retransmission with a doubling timeout, and zero-window probes.
+ * Enough to hold one long-lived connection to a host on the LAN.
+ *
+ * Connections are handles 0..TCP_MAX_CONN-1. The task calls only
+ * queue data into and out of the connection's rings and kick the
+ * stack; segments are built and parsed in the inet bottom half.
+ * A connection's wait queue is woken on data, freed send space and
+ * every state change.                                             */
+#define TCP_MAX_CONN   4
+#define TCP_BUF        16384    /* per direction, power of two */
+#define TCP_RTO_TICKS  10       /* initial retransmit timeout, inet ticks */
+#define TCP_RTO_MAX    64
+#define TCP_RETRIES    8        /* timeouts in a row before giving up */
+
+enum {
+    TCP_CLOSED,
+    TCP_SYN_SENT,
+    TCP_ESTABLISHED,
+    TCP_FIN_WAIT_1,
+    TCP_FIN_WAIT_2,
+    TCP_CLOSING,
+    TCP_TIME_WAIT,
+    TCP_CLOSE_WAIT,
+    TCP_LAST_ACK,
+    TCP_STATES
+};
+
+/* Why a connection ended up closed */
+#define TCP_ERR_NONE     0
+#define TCP_ERR_REFUSED  1      /* RST in answer to the SYN */
+#define TCP_ERR_RESET    2      /* RST later on */
+#define TCP_ERR_TIMEOUT  3      /* TCP_RETRIES timeouts */
+
+/* Start connecting; returns a handle, or -1 if the table is full */
+int  tcp_connect(ip4_t dst, uint16_t port);
+
+/* Queue all of data or none of it: len, or -1 if the connection
+ * cannot send or lacks the room */
+int  tcp_write(int c, const void *data, int len);
+int  tcp_write_space(int c);
+uint32_t tcp_unacked(int c);    /* queued and not yet acknowledged */
+
+/* Up to max received bytes; 0 if none yet, -1 if none will come */
+int  tcp_read(int c, void *buf, int max);
+int  tcp_readable(int c);
+
+/* Send what is queued, then FIN; the handle is invalid afterwards */
+void tcp_close(int c);
+
+int  tcp_state(int c);
+int  tcp_error(int c);
+const char *tcp_state_name(int state);
+wait_queue_t *tcp_queue(int c);
+
+/* ── Stack side (inet bottom half) ────────────────────────── */
+void tcp_init(void);
+void tcp_input(ip4_t src, ip4_t dst, const uint8_t *seg, int len);
+void tcp_tick(void);            /* every INET_TICK_MS */
+void tcp_flush(void);           /* send whatever tasks queued */
+
+#endif
@@ -0,0 +1,158 @@
+/* ============================================================
+ * SwanOS — Binary Telemetry
+ * Timer-driven sampler feeding a ring of fixed-width records,
+ * shipped to the bridge as delta + zigzag-varint batches. A
+ * quiet system costs ~10 bytes per sample on the serial link.
+ * ============================================================ */
+
+#include "telemetry.h"
+#include "bridge.h"
+#include "memory.h"
+#include "process.h"
+#include "timer.h"
+#include "idt.h"
+#include "string.h"
+#include "cpu.h"
+
+#define MASK_BYTES   ((TELEM_NFIELDS + 7) / 8)
+#define MAX_RECORD   (MASK_BYTES + TELEM_NFIELDS * 5)
+
+static uint32_t ring[TELEM_RING][TELEM_NFIELDS];
+static uint32_t ring_head = 0, ring_tail = 0;
+
+static int      rate_hz = 0;
+static int      timer_slot = -1;
+static volatile uint32_t frame_ms = 0;
+static volatile uint32_t frame_count = 0;
+
+static uint32_t samples = 0, dropped = 0, bytes_sent = 0;
+
+static process_overview_t ov;      /* too big for the IRQ stack */
+static uint8_t batch[BRIDGE_MAX_PAYLOAD];
+
+/* ── Sampling (timer IRQ) ─────────────────────────────────── */
+
+static void telemetry_sample(void) {
+    if (ring_head - ring_tail == TELEM_RING) { ring_tail++; dropped++; }
+    uint32_t *f = ring[ring_head & (TELEM_RING - 1)];
+
+    process_get_overview(&ov);
+    f[TF_TICK]      = timer_get_ticks();
+    f[TF_HEAP_KB]   = kheap_used() / 1024;
+    f[TF_PMM_PAGES] = mem_used() / 4096;
+    f[TF_PROCS]     = (uint32_t)ov.count;
+    f[TF_CTX]       = ov.context_switches;
+    f[TF_FRAME_MS]  = frame_ms;
+    f[TF_FRAMES]    = frame_count;
+    for (int i = 0; i < 16; i++) f[TF_IRQ0 + i] = idt_irq_count(i);
+
+    int n = 0;
+    for (int i = 0; i < ov.count && n < TELEM_MAX_PROCS; i++, n++) {
+        f[TF_PROC0 + 2 * n]     = ov.procs[i].pid;
+        f[TF_PROC0 + 2 * n + 1] = ov.procs[i].cpu_percent;
+    }
+    for (; n < TELEM_MAX_PROCS; n++)
+        f[TF_PROC0 + 2 * n] = f[TF_PROC0 + 2 * n + 1] = 0;
+
+    ring_head++;
+    samples++;
+
+    /* High rates outrun kernel_ai_tick's 5 s cadence: ship early */
+    if (ring_head - ring_tail >= TELEM_RING / 2) telemetry_flush();
+}
+
+void telemetry_init(void) {
+    ring_head = ring_tail = 0;
+    samples = dropped = bytes_sent = 0;
+    telemetry_set_rate(TELEM_DEFAULT_HZ);
+}
+
+int telemetry_set_rate(int hz) {
+    if (hz < 1) hz = 1;
+    if (hz > TELEM_MAX_HZ) hz = TELEM_MAX_HZ;
+    uint32_t interval = timer_get_frequency() / (uint32_t)hz;
+    if (interval == 0) interval = 1;
+
+    if (timer_slot >= 0) timer_unregister_periodic(timer_slot);
+    timer_slot = timer_register_periodic(interval, telemetry_sample);
+    rate_hz = timer_slot >= 0 ? hz : 0;
+    return rate_hz;
+}
+
+int telemetry_get_rate(void) {
+    return rate_hz;
+}
+
+void telemetry_note_frame(uint32_t ms) {
+    frame_ms = ms;
+    frame_count++;
+}
+
+/* ── Encoding ─────────────────────────────────────────────── */
+
+static int put_varint(uint8_t *p, uint32_t v) {
+    int n = 0;
+    while (v >= 0x80) { p[n++] = (uint8_t)(v | 0x80); v >>= 7; }
+    p[n++] = (uint8_t)v;
+    return n;
+}
+
+/* Append one record as deltas against prev; returns bytes written */
+static int encode_record(uint8_t *p, const uint32_t *cur, const uint32_t *prev) {
+    uint8_t *mask = p;
+    int n = MASK_BYTES;
+    memset(mask, 0, MASK_BYTES);
+    for (int i = 0; i < TELEM_NFIELDS; i++) {
+        int32_t d = (int32_t)(cur[i] - prev[i]);
+        if (!d) continue;
+        mask[i >> 3] |= (uint8_t)(1 << (i & 7));
+        n += put_varint(p + n, ((uint32_t)d << 1) ^ (uint32_t)(d >> 31));
+    }
+    return n;
+}
+
+static void send_batch(int len) {
+    bridge_send(BRIDGE_CH_TELEM, 'B', 0, batch, len);
+    bytes_sent += (uint32_t)len;
+}
+
+int telemetry_flush(void) {
+    static const uint32_t zero[TELEM_NFIELDS];
+    uint32_t rec[TELEM_NFIELDS], prev[TELEM_NFIELDS];
+    int batches = 0, pos = 0, count = 0;
+
+    for (;;) {
+        /* Copy out under IRQs off so the sampler can't overwrite it */
+        uint32_t flags = irq_save();
+        int have = ring_head != ring_tail;
+        if (have) { memcpy(rec, ring[ring_tail & (TELEM_RING - 1)], sizeof(rec)); ring_tail++; }
+        irq_restore(flags);
+        if (!have) break;
+
+        if (count && (pos + MAX_RECORD > BRIDGE_MAX_PAYLOAD || count == 255)) {
+            batch[2] = (uint8_t)count;
+            send_batch(pos);
+            batches++;
+            count = 0;
+        }
+        if (!count) {
+            batch[0] = TELEM_VERSION;
+            batch[1] = TELEM_NFIELDS;
+            pos = 3;
+        }
+        pos += encode_record(batch + pos, rec, count ? prev : zero);
+        memcpy(prev, rec, sizeof(prev));
+        count++;
+    }
+
+    if (count) {
+        batch[2] = (uint8_t)count;
+        send_batch(pos);
+        batches++;
+    }
+    return batches;
+}
+
+uint32_t telemetry_samples(void)    { return samples; }
+uint32_t telemetry_dropped(void)    { return dropped; }
+uint32_t telemetry_bytes_sent(void) { return bytes_sent; }
@@ -0,0 +1,55 @@
+#ifndef TELEMETRY_H
+#define TELEMETRY_H
+
+#include <stdint.h>
+
+/* ── Binary Telemetry ─────────────────────────────────────────
+ * A sample is a fixed vector of u32 fields, taken from the timer
+ * at a configurable rate into a ring buffer. telemetry_flush()
+ * ships the ring as batches on BRIDGE_CH_TELEM (op 'B'):
+ *
+ *   batch  := version u8 | nfields u8 | count u8 | record*
+ *   record := change mask (ceil(nfields/8) bytes, LSB first)
+ *             | zigzag varint delta per set bit
+ *
+ * Each record is delta-encoded against the one before it (the
+ * first in a batch against all-zero), so counters that did not
+ * move cost one mask bit.                                       */
+#define TELEM_VERSION      1
+#define TELEM_RING         128
+#define TELEM_MAX_PROCS    8
+#define TELEM_DEFAULT_HZ   10
+#define TELEM_MAX_HZ       100
+
+/* Field indices (keep in sync with TELEM_FIELDS in llm_bridge.py) */
+#define TF_TICK       0
+#define TF_HEAP_KB    1    /* kernel heap in use */
+#define TF_PMM_PAGES  2    /* physical frames in use */
+#define TF_PROCS      3
+#define TF_CTX        4    /* context switches (cumulative) */
+#define TF_FRAME_MS   5    /* last desktop frame time */
+#define TF_FRAMES     6    /* desktop frames (cumulative) */
+#define TF_IRQ0       7    /* 16 IRQ line counters (cumulative) */
+#define TF_PROC0      23   /* TELEM_MAX_PROCS × (pid, cpu%) */
+#define TELEM_NFIELDS (TF_PROC0 + 2 * TELEM_MAX_PROCS)
+
+void telemetry_init(void);
+
+/* Sampling rate in Hz (1..TELEM_MAX_HZ); returns the rate applied */
+int  telemetry_set_rate(int hz);
+int  telemetry_get_rate(void);
+
+/* Record a completed desktop frame (called by the compositor) */
+void telemetry_note_frame(uint32_t ms);
+
+/* Encode and send everything sampled since the last flush; runs in
+   timer context (kernel_ai_tick, or the sampler once the ring is
+   half full). Returns the number of batches sent. */
+int  telemetry_flush(void);
+
+/* Counters for status displays */
+uint32_t telemetry_samples(void);     /* samples taken */
+uint32_t telemetry_dropped(void);     /* overwritten before shipping */
+uint32_t telemetry_bytes_sent(void);  /* encoded payload bytes */
+
+#endif
@@ -1,58 +1,179 @@
 /* ============================================================
- * SwanOS — PIT Timer Driver (IRQ0) + Periodic Callback System
- * Provides system tick counter, uptime tracking, and scheduled
- * periodic callbacks for realtime subsystem polling.
+ * SwanOS — PIT Timer Driver (IRQ0) + Timer Wheel
+ * Provides the system tick counter, a hierarchical timer wheel
+ * for one-shot and periodic timers, a TSC-interpolated clock,
+ * and tickless idle: while the idle task halts, the PIT is put
+ * in one-shot mode up to the next armed timer.
  * ============================================================ */
 
 #include "timer.h"
 #include "idt.h"
 #include "ports.h"
+#include "cpu.h"
+#include "prof.h"
+
+#define PIT_HZ        1193180
+
+/* ── Timer Wheel ─────────────────────────────────────────────
+ * WHEEL_LEVELS × 64 buckets. Level 0 holds timers due within 64
+ * ticks, level n those due within 64^(n+1); whenever a level's
+ * index wraps, the next level's current bucket cascades down. */
+#define WHEEL_BITS    6
+#define WHEEL_SIZE    (1u << WHEEL_BITS)
+#define WHEEL_MASK    (WHEEL_SIZE - 1)
+#define WHEEL_LEVELS  4
+#define WHEEL_SPAN    (1u << (WHEEL_BITS * WHEEL_LEVELS))
+
+/* TSC calibration window, in ticks (the first tick is partial) */
+#define CAL_START     2
+#define CAL_TICKS     10
 
 static volatile uint32_t tick_count = 0;
 static uint32_t tick_freq = 100; /* Hz */
+static uint32_t pit_divisor = PIT_HZ / 100;
 
-/* ── Periodic Callback Table ─────────────────────────────── */
-typedef struct {
-    timer_callback_fn fn;
-    uint32_t interval;    /* fire every N ticks */
-    uint32_t countdown;   /* ticks until next fire */
-    int      active;
-} periodic_entry_t;
+static ktimer_t *wheel[WHEEL_LEVELS][WHEEL_SIZE];
 
-static periodic_entry_t periodic_table[TIMER_MAX_CALLBACKS];
+/* TSC clock: cycles counted from the last credited tick */
+static int      tsc_ok = 0;
+static uint64_t tick_tsc = 0, cal_tsc = 0;
+static uint32_t cycles_per_tick = 0, cycles_per_us = 0, cycles_per_count = 0;
+
+/* Tickless idle: ticks the pending PIT one-shot completes (0 = periodic) */
+static uint32_t oneshot = 0;
+static uint32_t ticks_skipped = 0;
+
+/* ── PIT ─────────────────────────────────────────────────── */
+
+static void pit_periodic(void) {
+    outb(0x43, 0x36); /* Channel 0, lobyte/hibyte, square wave */
+    outb(0x40, (uint8_t)(pit_divisor & 0xFF));
+    outb(0x40, (uint8_t)((pit_divisor >> 8) & 0xFF));
+}
+
+static void pit_oneshot(uint32_t counts) {
+    if (counts < 1) counts = 1;
+    if (counts > 0xFFFF) counts = 0xFFFF;
+    outb(0x43, 0x30); /* Channel 0, lobyte/hibyte, interrupt on terminal count */
+    outb(0x40, (uint8_t)(counts & 0xFF));
+    outb(0x40, (uint8_t)((counts >> 8) & 0xFF));
+}
+
+/* ── Wheel internals (IRQs off) ──────────────────────────── */
+
+static void wheel_insert(ktimer_t *t) {
+    uint32_t delta = t->expires - tick_count;
+    if (delta >= WHEEL_SPAN) {   /* overdue or out of range */
+        delta = (int32_t)delta < 0 ? 1 : WHEEL_SPAN - 1;
+        t->expires = tick_count + delta;
+    }
+    int lvl = 0;
+    while (lvl < WHEEL_LEVELS - 1 && delta >= (1u << (WHEEL_BITS * (lvl + 1)))) lvl++;
+
+    ktimer_t **b = &wheel[lvl][(t->expires >> (WHEEL_BITS * lvl)) & WHEEL_MASK];
+    t->prev = 0;
+    t->next = *b;
+    if (*b) (*b)->prev = t;
+    *b = t;
+    t->bucket = b;
+}
+
+static void wheel_remove(ktimer_t *t) {
+    if (t->prev) t->prev->next = t->next;
+    else *t->bucket = t->next;
+    if (t->next) t->next->prev = t->prev;
+    t->next = t->prev = 0;
+    t->bucket = 0;
+}
+
+static void cascade(int lvl, uint32_t slot) {
+    ktimer_t *t = wheel[lvl][slot];
+    wheel[lvl][slot] = 0;
+    while (t) {
+        ktimer_t *next = t->next;
+        wheel_insert(t);
+        t = next;
+    }
+}
+
+static void run_tick(void) {
+    uint32_t now = ++tick_count;
+
+    if (!(now & WHEEL_MASK)) {
+        for (int lvl = 1; lvl < WHEEL_LEVELS; lvl++) {
+            uint32_t slot = (now >> (WHEEL_BITS * lvl)) & WHEEL_MASK;
+            cascade(lvl, slot);
+            if (slot) break;
+        }
+    }
+
+    /* Pop one at a time so callbacks may arm or cancel any timer */
+    ktimer_t **b = &wheel[0][now & WHEEL_MASK];
+    ktimer_t *t;
+    while ((t = *b)) {
+        wheel_remove(t);
+        if (t->period) {
+            t->expires += t->period;
+            wheel_insert(t);
+        }
+        t->fn(t->arg);
+    }
+}
 
 static void timer_callback(registers_t *regs) {
-    (void)regs;
-    tick_count++;
+    PROF_SAMPLE(regs);
+    uint32_t n = 1;
+    if (oneshot) {               /* end of a tickless stretch */
+        n = oneshot;
+        oneshot = 0;
+        ticks_skipped += n - 1;
+        pit_periodic();
+    }
+    if (tsc_ok) tick_tsc = rdtsc();
+    while (n--) run_tick();
 
-    /* Fire periodic callbacks */
-    for (int i = 0; i < TIMER_MAX_CALLBACKS; i++) {
-        if (!periodic_table[i].active) continue;
-        if (periodic_table[i].countdown > 0) {
-            periodic_table[i].countdown--;
-        } else {
-            periodic_table[i].fn();
-            periodic_table[i].countdown = periodic_table[i].interval;
+    if (tsc_ok && !cycles_per_tick) {
+        if (tick_count == CAL_START) {
+            cal_tsc = tick_tsc;
+        } else if (tick_count == CAL_START + CAL_TICKS) {
+            cycles_per_tick = (uint32_t)(tick_tsc - cal_tsc) / CAL_TICKS;
+            cycles_per_us = cycles_per_tick / (1000000 / tick_freq);
+            cycles_per_count = cycles_per_tick / pit_divisor;
+            if (!cycles_per_us || !cycles_per_count) cycles_per_tick = 0;
         }
     }
 }
 
 void timer_init(uint32_t frequency) {
     tick_freq = frequency;
+    pit_divisor = PIT_HZ / frequency;
+    tsc_ok = (cpuid_edx(1) & CPUID_EDX_TSC) != 0;
 
-    /* Clear periodic callback table */
-    for (int i = 0; i < TIMER_MAX_CALLBACKS; i++) {
-        periodic_table[i].active = 0;
-        periodic_table[i].fn = 0;
-    }
+    for (int l = 0; l < WHEEL_LEVELS; l++)
+        for (uint32_t i = 0; i < WHEEL_SIZE; i++) wheel[l][i] = 0;
 
     register_interrupt_handler(32, timer_callback); /* IRQ0 → INT 32 */
 
     /* Configure PIT channel 0 */
-    uint32_t divisor = 1193180 / frequency;
-    outb(0x43, 0x36); /* Channel 0, lobyte/hibyte, rate generator */
-    outb(0x40, (uint8_t)(divisor & 0xFF));
-    outb(0x40, (uint8_t)((divisor >> 8) & 0xFF));
+    pit_periodic();
+}
+
+/* ── Clock ───────────────────────────────────────────────── */
+
+/* Tick count plus microseconds since that tick (TSC), clamped to the
+ * stretch the pending PIT interrupt covers so readings never run
+ * ahead of the next credited tick */
+static uint32_t clock_read(uint32_t *ticks) {
+    uint32_t flags = irq_save();
+    uint32_t t = tick_count, window = oneshot ? oneshot : 1;
+    uint64_t base = tick_tsc;
+    irq_restore(flags);
+    *ticks = t;
+    if (!cycles_per_tick) return 0;
+    uint32_t us_per_tick = 1000000 / tick_freq;
+    uint32_t sub = (uint32_t)(rdtsc() - base) / cycles_per_us;
+    if (sub >= window * us_per_tick) sub = window * us_per_tick - 1;
+    return sub;
 }
 
 uint32_t timer_get_ticks(void) {
@@ -64,31 +185,125 @@ uint32_t timer_get_seconds(void) {
 }
 
 uint32_t timer_get_ms(void) {
-    /* Convert ticks to milliseconds: ticks * 1000 / freq */
-    return (tick_count * 1000) / tick_freq;
+    uint32_t t;
+    uint32_t sub = clock_read(&t);
+    return (t / tick_freq) * 1000 + (t % tick_freq) * 1000 / tick_freq + sub / 1000;
+}
+
+uint32_t timer_get_us(void) {
+    uint32_t t;
+    uint32_t sub = clock_read(&t);
+    return t * (1000000 / tick_freq) + sub;
 }
 
 uint32_t timer_get_frequency(void) {
     return tick_freq;
 }
 
+uint32_t timer_cycles_per_us(void) {
+    return cycles_per_us;
+}
+
+/* ── Timers ──────────────────────────────────────────────── */
+
+void timer_setup(ktimer_t *t, void (*fn)(void *arg), void *arg) {
+    t->fn = fn;
+    t->arg = arg;
+    t->period = 0;
+    t->next = t->prev = 0;
+    t->bucket = 0;
+}
+
+void timer_arm(ktimer_t *t, uint32_t delay, uint32_t period) {
+    uint32_t flags = irq_save();
+    if (t->bucket) wheel_remove(t);
+    if (delay == 0) delay = 1;
+    t->expires = tick_count + delay;
+    t->period = period;
+    wheel_insert(t);
+    irq_restore(flags);
+}
+
+void timer_cancel(ktimer_t *t) {
+    uint32_t flags = irq_save();
+    if (t->bucket) wheel_remove(t);
+    irq_restore(flags);
+}
+
+/* ── Periodic Callback Table ─────────────────────────────── */
+typedef struct {
+    ktimer_t          timer;
+    timer_callback_fn fn;     /* 0 = free slot */
+} periodic_entry_t;
+
+static periodic_entry_t periodic_table[TIMER_MAX_CALLBACKS];
+
+static void periodic_fire(void *arg) {
+    ((periodic_entry_t *)arg)->fn();
+}
+
 int timer_register_periodic(uint32_t interval_ticks, timer_callback_fn cb) {
     if (!cb || interval_ticks == 0) return -1;
+    uint32_t flags = irq_save();
     for (int i = 0; i < TIMER_MAX_CALLBACKS; i++) {
-        if (!periodic_table[i].active) {
-            periodic_table[i].fn = cb;
-            periodic_table[i].interval = interval_ticks;
-            periodic_table[i].countdown = interval_ticks;
-            periodic_table[i].active = 1;
-            return i;
-        }
+        periodic_entry_t *e = &periodic_table[i];
+        if (e->fn) continue;
+        e->fn = cb;
+        timer_setup(&e->timer, periodic_fire, e);
+        timer_arm(&e->timer, interval_ticks, interval_ticks);
+        irq_restore(flags);
+        return i;
     }
+    irq_restore(flags);
     return -1; /* No free slot */
 }
 
 void timer_unregister_periodic(int slot) {
     if (slot >= 0 && slot < TIMER_MAX_CALLBACKS) {
-        periodic_table[slot].active = 0;
+        timer_cancel(&periodic_table[slot].timer);
         periodic_table[slot].fn = 0;
     }
 }
+
+/* ── Tickless Idle ───────────────────────────────────────── */
+
+void timer_idle_enter(void) {
+    if (!cycles_per_tick || oneshot) return;
+
+    /* Stop at the next cascade: upper-level timers are not in level 0 yet */
+    uint32_t now = tick_count;
+    uint32_t max = 0xFFFF / pit_divisor;
+    uint32_t to_wrap = WHEEL_SIZE - (now & WHEEL_MASK);
+    if (max > to_wrap) max = to_wrap;
+
+    uint32_t n = 1;
+    while (n < max && !wheel[0][(now + n) & WHEEL_MASK]) n++;
+    if (n < 2) return;
+
+    /* Keep the tick phase: the stretch ends on a tick boundary */
+    uint32_t since = (uint32_t)(rdtsc() - tick_tsc) / cycles_per_count;
+    if (since >= pit_divisor) return;    /* a tick is already overdue */
+    pit_oneshot(n * pit_divisor - since);
+    oneshot = n;
+}
+
+void timer_idle_exit(void) {
+    if (!oneshot) return;
+    uint32_t elapsed = (uint32_t)(rdtsc() - tick_tsc);
+    uint32_t whole = elapsed / cycles_per_tick;
+    /* In the last tick of the stretch: let the one-shot land as planned */
+    if (whole + 1 >= oneshot) return;
+
+    /* Credit the ticks that passed, then one short shot to the next
+     * boundary; its IRQ switches the PIT back to periodic */
+    uint32_t left = ((whole + 1) * cycles_per_tick - elapsed) / cycles_per_count;
+    pit_oneshot(left);
+    oneshot = 1;
+    ticks_skipped += whole;
+    tick_tsc += (uint64_t)whole * cycles_per_tick;
+    while (whole--) run_tick();
+}
+
+uint32_t timer_ticks_skipped(void) {
+    return ticks_skipped;
+}
@@ -7,8 +7,29 @@
 void     timer_init(uint32_t frequency);
 uint32_t timer_get_ticks(void);
 uint32_t timer_get_seconds(void);
-uint32_t timer_get_ms(void);       /* Millisecond-resolution timestamp */
+uint32_t timer_get_ms(void);       /* Millisecond timestamp (TSC-interpolated) */
+uint32_t timer_get_us(void);       /* Microseconds; wraps every ~71 min, use deltas */
 uint32_t timer_get_frequency(void); /* Get configured tick frequency */
+uint32_t timer_cycles_per_us(void); /* TSC rate once calibrated, else 0 */
+
+/* ── Timer Wheel ────────────────────────────────────────── */
+/* Caller-owned timer. Callbacks run from the timer interrupt with
+   IRQs off; a periodic timer is re-armed before its callback, which
+   may cancel it. Arm and cancel are O(1). */
+typedef struct ktimer {
+    uint32_t expires;             /* tick */
+    uint32_t period;              /* 0 = one-shot */
+    void   (*fn)(void *arg);
+    void    *arg;
+    struct ktimer  *next, *prev;
+    struct ktimer **bucket;       /* 0 = not armed */
+} ktimer_t;
+
+void timer_setup(ktimer_t *t, void (*fn)(void *arg), void *arg);
+/* Fire after `delay` ticks (min 1), then every `period` ticks if set */
+void timer_arm(ktimer_t *t, uint32_t delay, uint32_t period);
+void timer_cancel(ktimer_t *t);
+static inline int timer_pending(const ktimer_t *t) { return t->bucket != 0; }
 
 /* ── Periodic Callback System ───────────────────────────── */
 /* Register a function to be called every `interval_ticks` timer ticks.
@@ -20,4 +41,12 @@ typedef void (*timer_callback_fn)(void);
 int  timer_register_periodic(uint32_t interval_ticks, timer_callback_fn cb);
 void timer_unregister_periodic(int slot);
 
+/* ── Tickless Idle ──────────────────────────────────────── */
+/* Idle task, IRQs off, just before HLT: stretch the next PIT interrupt
+   to the next armed timer (bounded by the PIT's 16-bit counter). */
+void     timer_idle_enter(void);
+/* Any other IRQ: credit the ticks that passed and go back to periodic */
+void     timer_idle_exit(void);
+uint32_t timer_ticks_skipped(void);  /* timer IRQs avoided so far */
+
 #endif
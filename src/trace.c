@@ -0,0 +1,289 @@
+/* ============================================================
+ * SwanOS — Event Tracing
+ * Per-CPU binary trace rings fed by static tracepoints (scheduler,
+ * IRQs, syscalls, faults, PMM, bridge), dumped by the shell or
+ * shipped to the host for a timeline view.
+ * ============================================================ */
+
+#include "trace.h"
+#include "bridge.h"
+#include "timer.h"
+#include "string.h"
+#include "percpu.h"
+#include "spinlock.h"
+#include "cpu.h"
+
+typedef struct {
+    volatile uint32_t head;     /* events ever written; slot = head % TRACE_RING */
+    uint32_t base;              /* first event since trace_clear */
+    uint32_t sent;              /* stream cursor */
+    uint32_t lost;              /* lapped before the stream caught up */
+    trace_event_t ev[TRACE_RING];
+} trace_ring_t;
+
+PER_CPU_STATIC(trace_ring_t, rings);
+
+volatile int trace_enabled = 0;
+static int streaming = 0;
+static ktimer_t stream_timer;
+
+static const char *type_names[TR_TYPES] = {
+    "?", "SWITCH", "IRQ", "IRQ_END", "SYSCALL", "PFAULT", "PMM", "BR_TX", "BR_RX"
+};
+
+static void stream_tick(void *arg) {
+    (void)arg;
+    trace_flush();
+}
+
+void trace_init(void) {
+    memset(rings, 0, sizeof(rings));
+    streaming = 0;
+    timer_setup(&stream_timer, stream_tick, 0);
+    trace_enabled = 1;
+}
+
+void trace_set_enabled(int on) {
+    trace_enabled = on;
+}
+
+/* Safe from any context: the slot is claimed and filled with IRQs
+ * off, and only this CPU writes its ring */
+void trace_emit(uint16_t type, uint32_t a, uint32_t b) {
+    uint32_t flags = irq_save();
+    int cpu = smp_cpu_id();
+    trace_ring_t *r = &per_cpu(rings, cpu);
+    trace_event_t *e = &r->ev[r->head & (TRACE_RING - 1)];
+    uint64_t t = rdtsc();
+    e->tsc_lo = (uint32_t)t;
+    e->tsc_hi = (uint32_t)(t >> 32);
+    e->type = type;
+    e->cpu = (uint8_t)cpu;
+    e->pad = 0;
+    e->a = a;
+    e->b = b;
+    seq_barrier();              /* event before head, for remote readers */
+    r->head++;
+    irq_restore(flags);
+}
+
+void trace_clear(void) {
+    for (int cpu = 0; cpu < SMP_MAX_CPUS; cpu++) {
+        trace_ring_t *r = &per_cpu(rings, cpu);
+        r->base = r->sent = r->head;
+        r->lost = 0;
+    }
+}
+
+uint32_t trace_count(void) {
+    uint32_t n = 0;
+    for (int cpu = 0; cpu < smp_cpu_count(); cpu++) n += per_cpu(rings, cpu).head;
+    return n;
+}
+
+/* ── Reading ──────────────────────────────────────────────── */
+
+#define TRACE_FMT_MAX 64        /* events per CPU for the shell dump */
+
+/* Copy up to max events of cpu's ring starting at index *from.
+ * The writer keeps going meanwhile: events it lapped during the
+ * copy (and the slot it may be filling) are dropped, and *from is
+ * moved to the first event actually returned. */
+static int ring_copy(int cpu, uint32_t *from, trace_event_t *out, int max) {
+    trace_ring_t *r = &per_cpu(rings, cpu);
+    uint32_t head = r->head;
+    seq_barrier();
+    uint32_t start = *from;
+    if (head - start > head - r->base) start = r->base;
+    if (head - start > TRACE_RING) start = head - TRACE_RING;
+    uint32_t n = head - start;
+    if (n > (uint32_t)max) n = (uint32_t)max;
+    for (uint32_t i = 0; i < n; i++) out[i] = r->ev[(start + i) & (TRACE_RING - 1)];
+    seq_barrier();
+
+    uint32_t reach = r->head + 1 - start;   /* slots the writer has touched */
+    uint32_t skip = reach > TRACE_RING ? reach - TRACE_RING : 0;
+    if (skip > n) skip = n;
+    for (uint32_t i = skip; i < n; i++) out[i - skip] = out[i];
+    *from = start + skip;
+    return (int)(n - skip);
+}
+
+static inline uint64_t ev_tsc(const trace_event_t *e) {
+    return ((uint64_t)e->tsc_hi << 32) | e->tsc_lo;
+}
+
+/* CPU whose next unmerged event is the oldest, -1 when all are done */
+static int oldest_cpu(trace_event_t (*ev)[TRACE_FMT_MAX], const int *have, const int *pos, int ncpu) {
+    int best = -1;
+    for (int cpu = 0; cpu < ncpu; cpu++)
+        if (pos[cpu] < have[cpu] &&
+            (best < 0 || ev_tsc(&ev[cpu][pos[cpu]]) < ev_tsc(&ev[best][pos[best]])))
+            best = cpu;
+    return best;
+}
+
+/* ── Shell dump ───────────────────────────────────────────── */
+
+static trace_event_t fmt_buf[SMP_MAX_CPUS][TRACE_FMT_MAX];
+
+static void format_event(char *line, int len, const trace_event_t *e, uint32_t rel_us) {
+    sbuf_t sb;
+    sbuf_init(&sb, line, len);
+    sbuf_printf(&sb, "  +%6u.%03ums  cpu%u  %-9s", rel_us / 1000, rel_us % 1000,
+                e->cpu, trace_type_name(e->type));
+
+    switch (e->type) {
+        case TR_SWITCH:
+            sbuf_printf(&sb, "pid %u -> %u", e->a, e->b);
+            break;
+        case TR_IRQ_ENTER:
+        case TR_IRQ_EXIT:
+            sbuf_printf(&sb, "irq %u", e->a);
+            break;
+        case TR_SYSCALL:
+            sbuf_printf(&sb, "#%u pid %u", e->a, e->b);
+            break;
+        case TR_PAGE_FAULT:
+            sbuf_printf(&sb, "0x%x err %u", e->a, e->b);
+            break;
+        case TR_PMM_ALLOC:
+            sbuf_printf(&sb, "0x%x", e->a);
+            break;
+        case TR_BRIDGE_TX:
+        case TR_BRIDGE_RX:
+            sbuf_printf(&sb, "ch %u '%c' %u B", e->a >> 8, (char)(e->a & 0xFF), e->b);
+            break;
+        default:
+            sbuf_printf(&sb, "0x%x 0x%x", e->a, e->b);
+            break;
+    }
+    sbuf_putc(&sb, '\n');
+}
+
+int trace_format_recent(char *buf, int buf_len, int count) {
+    sbuf_t sb;
+    sbuf_init(&sb, buf, buf_len);
+    if (count > TRACE_FMT_MAX) count = TRACE_FMT_MAX;
+    int ncpu = smp_cpu_count(), have[SMP_MAX_CPUS], pos[SMP_MAX_CPUS];
+
+    /* Newest `count` per CPU, then merge the CPUs by timestamp */
+    for (int cpu = 0; cpu < ncpu; cpu++) {
+        uint32_t head = per_cpu(rings, cpu).head;
+        uint32_t from = head > (uint32_t)count ? head - (uint32_t)count : 0;
+        have[cpu] = ring_copy(cpu, &from, fmt_buf[cpu], count);
+        pos[cpu] = 0;
+    }
+    int total = 0;
+    for (int cpu = 0; cpu < ncpu; cpu++) total += have[cpu];
+    for (int skip = total - count; skip > 0; skip--)    /* keep the newest overall */
+        pos[oldest_cpu(fmt_buf, have, pos, ncpu)]++;
+
+    uint32_t per_us = timer_cycles_per_us();
+    if (!per_us) per_us = 1;
+    uint64_t t0 = 0;
+    int lines = 0;
+    for (;;) {
+        int best = oldest_cpu(fmt_buf, have, pos, ncpu);
+        if (best < 0) break;
+        const trace_event_t *e = &fmt_buf[best][pos[best]++];
+        if (!lines) t0 = ev_tsc(e);
+        uint64_t d = ev_tsc(e) - t0;
+        if (d > 0xFFFFFFFFu) d = 0xFFFFFFFFu;
+
+        char line[96];
+        format_event(line, sizeof(line), e, (uint32_t)d / per_us);
+        if (strlen(line) > sbuf_room(&sb)) break;
+        sbuf_append(&sb, line);
+        lines++;
+    }
+    if (!lines) strcpy(buf, "  No trace events recorded.\n");
+    return lines;
+}
+
+/* ── Host export ──────────────────────────────────────────── */
+
+#define BATCH_HDR    8
+#define BATCH_EVENTS ((BRIDGE_MAX_PAYLOAD - BATCH_HDR) / (int)sizeof(trace_event_t))
+#define STREAM_TX_MAX 4096      /* stream only while the bridge link has room */
+
+static uint8_t batch[BATCH_HDR + BATCH_EVENTS * sizeof(trace_event_t)];
+static volatile int shipping = 0;   /* batch in use; the IRQ-side flush backs off */
+
+/* Send cpu's events from index *from up to the head, in batches.
+ * `paced` stops early rather than wait on a full serial ring (the
+ * stream runs from the timer IRQ); a link with no room for a batch
+ * stops it either way. Lapped events count as lost. */
+static int ship_ring(int cpu, uint32_t *from, int paced, uint32_t *lost) {
+    int sent = 0;
+    uint32_t per_us = timer_cycles_per_us();
+    for (;;) {
+        if (paced && bridge_tx_pending() > STREAM_TX_MAX) break;
+        uint32_t want = *from;
+        int n = ring_copy(cpu, from, (trace_event_t *)(batch + BATCH_HDR), BATCH_EVENTS);
+        if (lost) *lost += *from - want;
+        if (n <= 0) break;
+        batch[0] = TRACE_VERSION;
+        batch[1] = (uint8_t)cpu;
+        batch[2] = (uint8_t)n;
+        batch[3] = (uint8_t)(n >> 8);
+        memcpy(batch + 4, &per_us, 4);
+        if (bridge_send(BRIDGE_CH_TRACE, 'X', 0, batch, BATCH_HDR + n * (int)sizeof(trace_event_t)) < 0)
+            break;              /* retried from the same cursor next time */
+        *from += (uint32_t)n;
+        sent += n;
+    }
+    return sent;
+}
+
+int trace_send(void) {
+    int sent = 0;
+    shipping = 1;
+    int was = trace_enabled;
+    trace_enabled = 0;          /* don't record our own bridge traffic */
+    for (int cpu = 0; cpu < smp_cpu_count(); cpu++) {
+        uint32_t from = 0;
+        sent += ship_ring(cpu, &from, 0, 0);
+    }
+    trace_enabled = was;
+    shipping = 0;
+    return sent;
+}
+
+void trace_set_stream(int on) {
+    if (on && !streaming) {
+        trace_clear();          /* stream from now on */
+        timer_arm(&stream_timer, TRACE_STREAM_TICKS, TRACE_STREAM_TICKS);
+    } else if (!on) {
+        timer_cancel(&stream_timer);
+    }
+    streaming = on;
+}
+
+int trace_streaming(void) {
+    return streaming;
+}
+
+uint32_t trace_lost(void) {
+    uint32_t n = 0;
+    for (int cpu = 0; cpu < smp_cpu_count(); cpu++) n += per_cpu(rings, cpu).lost;
+    return n;
+}
+
+int trace_flush(void) {
+    if (!streaming || shipping) return 0;
+    shipping = 1;
+    int was = trace_enabled, sent = 0;
+    trace_enabled = 0;
+    for (int cpu = 0; cpu < smp_cpu_count(); cpu++) {
+        trace_ring_t *r = &per_cpu(rings, cpu);
+        sent += ship_ring(cpu, &r->sent, 1, &r->lost);
+    }
+    trace_enabled = was;
+    shipping = 0;
+    return sent;
+}
+
+const char *trace_type_name(int type) {
+    return (type > 0 && type < TR_TYPES) ? type_names[type] : "?";
+}
@@ -0,0 +1,71 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <stdint.h>
+
+/* ── Event tracing ────────────────────────────────────────────
+ * Static tracepoints write fixed-size binary records into a ring
+ * per CPU. Only the owning CPU writes its ring (with IRQs held off
+ * for the few stores), so there is no lock; readers copy without
+ * stopping the writer and drop whatever it lapped meanwhile. The
+ * ring keeps the newest TRACE_RING events per CPU.
+ *
+ * trace_send ships the rings to the host on BRIDGE_CH_TRACE (op
+ * 'X'), for a timeline view:
+ *
+ *   batch := version u8 | cpu u8 | count u16 | tsc_per_us u32 | record*
+ *
+ * where a record is a trace_event_t, little endian.              */
+#define TRACE_VERSION 1
+#define TRACE_RING    2048      /* events per CPU, power of two */
+
+/* Event types; a and b per type */
+#define TR_SWITCH      1        /* prev pid, next pid */
+#define TR_IRQ_ENTER   2        /* irq line */
+#define TR_IRQ_EXIT    3        /* irq line */
+#define TR_SYSCALL     4        /* number, pid */
+#define TR_PAGE_FAULT  5        /* address, error code */
+#define TR_PMM_ALLOC   6        /* frame, PMM_* flags */
+#define TR_BRIDGE_TX   7        /* chan << 8 | op, length */
+#define TR_BRIDGE_RX   8        /* chan << 8 | op, length */
+#define TR_TYPES       9
+
+typedef struct {
+    uint32_t tsc_lo, tsc_hi;
+    uint16_t type;
+    uint8_t  cpu;
+    uint8_t  pad;
+    uint32_t a, b;
+} __attribute__((packed)) trace_event_t;   /* 20 bytes */
+
+extern volatile int trace_enabled;
+
+void trace_emit(uint16_t type, uint32_t a, uint32_t b);
+
+#define TRACE(type, a, b) \
+    do { if (trace_enabled) trace_emit((type), (uint32_t)(a), (uint32_t)(b)); } while (0)
+
+void trace_init(void);
+void trace_set_enabled(int on);
+void trace_clear(void);
+uint32_t trace_count(void);     /* events recorded, all CPUs */
+
+/* The newest `count` events across all CPUs in time order, one per
+ * line, into buf. Returns lines written. */
+int  trace_format_recent(char *buf, int buf_len, int count);
+
+/* Ship every buffered event; returns events sent */
+int  trace_send(void);
+
+/* With streaming on, a timer calls trace_flush every
+ * TRACE_STREAM_TICKS to ship the events recorded since the last
+ * flush; it gives up for that round when the bridge link is busy */
+#define TRACE_STREAM_TICKS 10
+void trace_set_stream(int on);
+int  trace_streaming(void);
+int  trace_flush(void);
+uint32_t trace_lost(void);      /* lapped before the stream sent them */
+
+const char *trace_type_name(int type);
+
+#endif
@@ -10,6 +10,8 @@
 extern "C" {
 #include "vga_gfx.h"
 #include "string.h"
+#include "simd.h"
+#include "smp.h"
 }
 
 /* ── Internal helpers ─────────────────────────────────────── */
@@ -62,6 +64,31 @@ inline uint32_t xorshift(uint32_t seed) {
     return seed;
 }
 
+/* Wallpaper base: 3-stop vertical gradient, one fill per row */
+void aurora_base(uint32_t *buf, int w, int h) {
+    int half = h / 2;
+    if (half <= 0) half = 1;
+    for (int y = 0; y < h; y++) {
+        uint32_t c;
+        if (y < half) {
+            c = lerp(W_TOP, W_MID, y, half);
+        } else {
+            c = lerp(W_MID, W_BOT, y - half, h - half);
+        }
+        simd_fill32(&buf[y * w], c, w);
+    }
+}
+
+/* One aurora glow, additive over the whole buffer (see simd_glow_t) */
+void aurora_glow(uint32_t *buf, int w, int h, int cy, const simd_glow_t &g) {
+    for (int y = 0; y < h; y++) {
+        int dy = y - cy;
+        int dy2 = dy * dy;
+        if (dy2 >= g.max_r2) continue;
+        simd_glow32(&buf[y * w], 0, w, dy2, &g);
+    }
+}
+
 } /* anonymous namespace */
 
 
@@ -75,10 +102,12 @@ void ui_gradient_3stop(int x, int y, int w, int h,
     int half = h / 2;
     if (half <= 0) half = 1;
     uint32_t *bb = vga_backbuffer();
+    vga_rect_t clip;
+    vga_bb_get_clip(&clip);
 
     for (int dy = 0; dy < h; dy++) {
         int py = y + dy;
-        if (py < 0 || py >= GFX_H) continue;
+        if (py < clip.y || py >= clip.y + clip.h) continue;
 
         uint32_t c;
         if (dy < half) {
@@ -88,11 +117,9 @@ void ui_gradient_3stop(int x, int y, int w, int h,
         }
 
         /* Fill row */
-        int x0 = x < 0 ? 0 : x;
-        int x1 = x + w > GFX_W ? GFX_W : x + w;
-        uint32_t *row = &bb[py * GFX_W];
-        for (int px = x0; px < x1; px++)
-            row[px] = c;
+        int x0 = x < clip.x ? clip.x : x;
+        int x1 = x + w > clip.x + clip.w ? clip.x + clip.w : x + w;
+        if (x1 > x0) simd_fill32(&bb[py * vga_bb_stride() + x0], c, x1 - x0);
     }
 }
 
@@ -417,95 +444,22 @@ void ui_progress_bar(int x, int y, int w, int h,
 extern "C"
 void ui_render_aurora_wallpaper(uint32_t *buf, int w, int h) {
     /* 3-stop vertical gradient base: deep space → teal nebula → purple nebula */
-    int half = h / 2;
-    if (half <= 0) half = 1;
-
-    for (int y = 0; y < h; y++) {
-        uint32_t c;
-        if (y < half) {
-            c = lerp(W_TOP, W_MID, y, half);
-        } else {
-            c = lerp(W_MID, W_BOT, y - half, h - half);
-        }
-        uint32_t *row = &buf[y * w];
-        for (int x = 0; x < w; x++)
-            row[x] = c;
-    }
+    aurora_base(buf, w, h);
 
     /* Primary aurora — intense cyan glow at upper-center */
-    int gcx = w / 2;
-    int gcy = h / 3;
-    int max_r2 = (w * w) / 5 + (h * h) / 7;
-    for (int y = 0; y < h; y++) {
-        uint32_t *row = &buf[y * w];
-        int dy = y - gcy;
-        int dy2 = dy * dy;
-        for (int x = 0; x < w; x++) {
-            int dx = x - gcx;
-            int dist2 = (dx * dx) / 3 + dy2;
-            if (dist2 < max_r2) {
-                int intensity = 28 - (dist2 * 28) / max_r2;
-                if (intensity > 0) {
-                    RGBA bg(row[x]);
-                    /* Cyan aurora tint — more vivid */
-                    bg.r = clamp((int)bg.r + intensity / 3, 0, 255);
-                    bg.g = clamp((int)bg.g + intensity * 5 / 2, 0, 255);
-                    bg.b = clamp((int)bg.b + intensity * 2, 0, 255);
-                    row[x] = bg.pack();
-                }
-            }
-        }
-    }
+    simd_glow_t g1 = { w / 2, 3, (w * w) / 5 + (h * h) / 7, 28,
+                       86, 640, 512, 0, 0, 0 };   /* /3, *5/2, *2 */
+    aurora_glow(buf, w, h, h / 3, g1);
 
     /* Secondary aurora — magenta/purple glow at upper-right */
-    int g2x = w * 3 / 4;
-    int g2y = h / 4;
-    int max2_r2 = (w * w) / 9 + (h * h) / 11;
-    for (int y = 0; y < h; y++) {
-        uint32_t *row = &buf[y * w];
-        int dy = y - g2y;
-        int dy2 = dy * dy;
-        for (int x = 0; x < w; x++) {
-            int dx = x - g2x;
-            int dist2 = (dx * dx) / 3 + dy2;
-            if (dist2 < max2_r2) {
-                int intensity = 18 - (dist2 * 18) / max2_r2;
-                if (intensity > 0) {
-                    RGBA bg(row[x]);
-                    /* Magenta/purple aurora */
-                    bg.r = clamp((int)bg.r + intensity * 3, 0, 255);
-                    bg.g = clamp((int)bg.g + intensity / 4, 0, 255);
-                    bg.b = clamp((int)bg.b + intensity * 2, 0, 255);
-                    row[x] = bg.pack();
-                }
-            }
-        }
-    }
+    simd_glow_t g2 = { w * 3 / 4, 3, (w * w) / 9 + (h * h) / 11, 18,
+                       768, 64, 512, 0, 0, 0 };   /* *3, /4, *2 */
+    aurora_glow(buf, w, h, h / 4, g2);
 
     /* Tertiary aurora — subtle green glow at lower-left */
-    int g3x = w / 4;
-    int g3y = h * 2 / 3;
-    int max3_r2 = (w * w) / 12 + (h * h) / 14;
-    for (int y = 0; y < h; y++) {
-        uint32_t *row = &buf[y * w];
-        int dy = y - g3y;
-        int dy2 = dy * dy;
-        for (int x = 0; x < w; x++) {
-            int dx = x - g3x;
-            int dist2 = (dx * dx) / 2 + dy2;
-            if (dist2 < max3_r2) {
-                int intensity = 12 - (dist2 * 12) / max3_r2;
-                if (intensity > 0) {
-                    RGBA bg(row[x]);
-                    /* Green-teal tint */
-                    bg.r = clamp((int)bg.r + intensity / 3, 0, 255);
-                    bg.g = clamp((int)bg.g + intensity * 2, 0, 255);
-                    bg.b = clamp((int)bg.b + intensity, 0, 255);
-                    row[x] = bg.pack();
-                }
-            }
-        }
-    }
+    simd_glow_t g3 = { w / 4, 2, (w * w) / 12 + (h * h) / 14, 12,
+                       86, 512, 256, 0, 0, 0 };   /* /3, *2, *1 */
+    aurora_glow(buf, w, h, h * 2 / 3, g3);
 
     /* Stars — more numerous, color-tinted */
     uint32_t seed = 0xC0FFEE42;
@@ -544,20 +498,7 @@ void ui_render_aurora_wallpaper(uint32_t *buf, int w, int h) {
 extern "C"
 void ui_render_aurora_wallpaper_animated(uint32_t *buf, int w, int h, uint32_t phase) {
     /* 3-stop vertical gradient base */
-    int half = h / 2;
-    if (half <= 0) half = 1;
-
-    for (int y = 0; y < h; y++) {
-        uint32_t c;
-        if (y < half) {
-            c = lerp(W_TOP, W_MID, y, half);
-        } else {
-            c = lerp(W_MID, W_BOT, y - half, h - half);
-        }
-        uint32_t *row = &buf[y * w];
-        for (int x = 0; x < w; x++)
-            row[x] = c;
-    }
+    aurora_base(buf, w, h);
 
     /* Compute animated offsets based on phase (triangle waves) */
     int t1 = (phase >> 1) % 512; if (t1 > 255) t1 = 511 - t1;
@@ -570,76 +511,19 @@ void ui_render_aurora_wallpaper_animated(uint32_t *buf, int w, int h, uint32_t p
     int oy2 = (t1 - 128) * h / 2048;
 
     /* Primary aurora */
-    int gcx = w / 2 + ox1;
-    int gcy = h / 3 + oy1;
-    int max_r2 = (w * w) / 5 + (h * h) / 7;
-    for (int y = 0; y < h; y++) {
-        uint32_t *row = &buf[y * w];
-        int dy = y - gcy;
-        int dy2 = dy * dy;
-        for (int x = 0; x < w; x++) {
-            int dx = x - gcx;
-            int dist2 = (dx * dx) / 3 + dy2;
-            if (dist2 < max_r2) {
-                int intensity = 28 - (dist2 * 28) / max_r2;
-                if (intensity > 0) {
-                    RGBA bg(row[x]);
-                    bg.r = clamp((int)bg.r + intensity / 3 + t1/30, 0, 255);
-                    bg.g = clamp((int)bg.g + intensity * 5 / 2, 0, 255);
-                    bg.b = clamp((int)bg.b + intensity * 2, 0, 255);
-                    row[x] = bg.pack();
-                }
-            }
-        }
-    }
+    simd_glow_t g1 = { w / 2 + ox1, 3, (w * w) / 5 + (h * h) / 7, 28,
+                       86, 640, 512, t1 / 30, 0, 0 };
+    aurora_glow(buf, w, h, h / 3 + oy1, g1);
 
     /* Secondary aurora */
-    int g2x = w * 3 / 4 - ox2;
-    int g2y = h / 4 + oy2;
-    int max2_r2 = (w * w) / 9 + (h * h) / 11;
-    for (int y = 0; y < h; y++) {
-        uint32_t *row = &buf[y * w];
-        int dy = y - g2y;
-        int dy2 = dy * dy;
-        for (int x = 0; x < w; x++) {
-            int dx = x - g2x;
-            int dist2 = (dx * dx) / 3 + dy2;
-            if (dist2 < max2_r2) {
-                int intensity = 18 - (dist2 * 18) / max2_r2;
-                if (intensity > 0) {
-                    RGBA bg(row[x]);
-                    bg.r = clamp((int)bg.r + intensity * 3, 0, 255);
-                    bg.g = clamp((int)bg.g + intensity / 4 + t2/40, 0, 255);
-                    bg.b = clamp((int)bg.b + intensity * 2, 0, 255);
-                    row[x] = bg.pack();
-                }
-            }
-        }
-    }
+    simd_glow_t g2 = { w * 3 / 4 - ox2, 3, (w * w) / 9 + (h * h) / 11, 18,
+                       768, 64, 512, 0, t2 / 40, 0 };
+    aurora_glow(buf, w, h, h / 4 + oy2, g2);
 
     /* Tertiary aurora */
-    int g3x = w / 4 + ox2;
-    int g3y = h * 2 / 3 - oy1;
-    int max3_r2 = (w * w) / 12 + (h * h) / 14;
-    for (int y = 0; y < h; y++) {
-        uint32_t *row = &buf[y * w];
-        int dy = y - g3y;
-        int dy2 = dy * dy;
-        for (int x = 0; x < w; x++) {
-            int dx = x - g3x;
-            int dist2 = (dx * dx) / 2 + dy2;
-            if (dist2 < max3_r2) {
-                int intensity = 12 - (dist2 * 12) / max3_r2;
-                if (intensity > 0) {
-                    RGBA bg(row[x]);
-                    bg.r = clamp((int)bg.r + intensity / 3, 0, 255);
-                    bg.g = clamp((int)bg.g + intensity * 2, 0, 255);
-                    bg.b = clamp((int)bg.b + intensity + t3/40, 0, 255);
-                    row[x] = bg.pack();
-                }
-            }
-        }
-    }
+    simd_glow_t g3 = { w / 4 + ox2, 2, (w * w) / 12 + (h * h) / 14, 12,
+                       86, 512, 256, 0, 0, t3 / 40 };
+    aurora_glow(buf, w, h, h * 2 / 3 - oy1, g3);
 
     /* Stars */
     uint32_t seed = 0xC0FFEE42;
@@ -668,6 +552,195 @@ void ui_render_aurora_wallpaper_animated(uint32_t *buf, int w, int h, uint32_t p
 }
 
 
+/* ═══════════════════════════════════════════════════════════════
+ *  Tiled Wallpaper Engine
+ *  Static layer (gradient) rendered once; the drifting glows are
+ *  rendered at 1/WP_SCALE resolution per phase and bilinearly
+ *  upscaled; the composite is rebuilt per tile, only for tiles a
+ *  blit actually touches. Large blits are split by tile rows across
+ *  CPUs, so each tile is composed by exactly one of them.
+ * ═══════════════════════════════════════════════════════════════ */
+
+#define WP_MAX_W   1920
+#define WP_MAX_H   1080
+#define WP_SCALE   4
+#define WP_TILE    64
+#define WP_LO_W    (WP_MAX_W / WP_SCALE + 2)
+#define WP_LO_H    (WP_MAX_H / WP_SCALE + 2)
+#define WP_TILES_X ((WP_MAX_W + WP_TILE - 1) / WP_TILE)
+#define WP_TILES_Y ((WP_MAX_H + WP_TILE - 1) / WP_TILE)
+#define WP_STARS   120
+
+namespace {
+
+uint32_t wp_base[WP_MAX_W * WP_MAX_H];   /* static gradient layer */
+uint32_t wp_comp[WP_MAX_W * WP_MAX_H];   /* composited wallpaper */
+uint32_t wp_glow[WP_LO_W * WP_LO_H];     /* additive glow, low-res */
+uint8_t  wp_stale[WP_TILES_X * WP_TILES_Y];
+int      wp_w = 0, wp_h = 0, wp_lo_w = 0, wp_lo_h = 0;
+uint32_t wp_cur_phase = 0;
+int      wp_have_phase = 0;
+
+struct Star { int x, y, bright, rjit; };
+Star wp_star[WP_STARS];
+
+/* Interpolate two packed pixels, w in [0, 256] */
+inline uint32_t lerp_px(uint32_t a, uint32_t b, uint32_t w) {
+    uint32_t iw = 256 - w;
+    uint32_t rb = (((a & 0x00FF00FF) * iw + (b & 0x00FF00FF) * w) >> 8) & 0x00FF00FF;
+    uint32_t ag = ((((a >> 8) & 0x00FF00FF) * iw + ((b >> 8) & 0x00FF00FF) * w) >> 8) & 0x00FF00FF;
+    return rb | (ag << 8);
+}
+
+void wp_setup(int w, int h) {
+    if (w > WP_MAX_W) w = WP_MAX_W;
+    if (h > WP_MAX_H) h = WP_MAX_H;
+    wp_w = w; wp_h = h;
+    wp_lo_w = w / WP_SCALE + 2;
+    wp_lo_h = h / WP_SCALE + 2;
+    aurora_base(wp_base, w, h);
+
+    /* Same star field as ui_render_aurora_wallpaper_animated */
+    uint32_t seed = 0xC0FFEE42;
+    for (int i = 0; i < WP_STARS; i++) {
+        seed = seed * 1103515245 + 12345; wp_star[i].x = (seed >> 16) % w;
+        seed = seed * 1103515245 + 12345; wp_star[i].y = (seed >> 16) % h;
+        seed = seed * 1103515245 + 12345; wp_star[i].bright = 170 + (seed >> 16) % 85;
+        wp_star[i].rjit = (int)((seed >> 8) & 0x1F);
+    }
+}
+
+void wp_render_glow(uint32_t phase) {
+    int w = wp_w, h = wp_h, s = WP_SCALE;
+    int t1 = (phase >> 1) % 512; if (t1 > 255) t1 = 511 - t1;
+    int t2 = (phase >> 2) % 512; if (t2 > 255) t2 = 511 - t2;
+    int t3 = (phase + 128) % 512; if (t3 > 255) t3 = 511 - t3;
+    int ox1 = (t1 - 128) * w / 2048;
+    int oy1 = (t2 - 128) * h / 2048;
+    int ox2 = (t3 - 128) * w / 2048;
+    int oy2 = (t1 - 128) * h / 2048;
+
+    /* Glow geometry scaled down by s (radii squared by s*s) */
+    simd_glow_t g1 = { (w / 2 + ox1) / s, 3, ((w * w) / 5 + (h * h) / 7) / (s * s), 28,
+                       86, 640, 512, t1 / 30, 0, 0 };
+    simd_glow_t g2 = { (w * 3 / 4 - ox2) / s, 3, ((w * w) / 9 + (h * h) / 11) / (s * s), 18,
+                       768, 64, 512, 0, t2 / 40, 0 };
+    simd_glow_t g3 = { (w / 4 + ox2) / s, 2, ((w * w) / 12 + (h * h) / 14) / (s * s), 12,
+                       86, 512, 256, 0, 0, t3 / 40 };
+
+    simd_fill32(wp_glow, 0, wp_lo_w * wp_lo_h);
+    aurora_glow(wp_glow, wp_lo_w, wp_lo_h, (h / 3 + oy1) / s, g1);
+    aurora_glow(wp_glow, wp_lo_w, wp_lo_h, (h / 4 + oy2) / s, g2);
+    aurora_glow(wp_glow, wp_lo_w, wp_lo_h, (h * 2 / 3 - oy1) / s, g3);
+}
+
+inline void wp_plot(int x, int y, uint32_t c, int x0, int y0, int x1, int y1) {
+    if (x >= x0 && x < x1 && y >= y0 && y < y1) wp_comp[y * wp_w + x] = c;
+}
+
+void wp_compose_tile(int tx, int ty) {
+    int x0 = tx * WP_TILE, y0 = ty * WP_TILE;
+    int x1 = x0 + WP_TILE > wp_w ? wp_w : x0 + WP_TILE;
+    int y1 = y0 + WP_TILE > wp_h ? wp_h : y0 + WP_TILE;
+    int lx0 = x0 / WP_SCALE, lx1 = (x1 - 1) / WP_SCALE + 1;
+    uint32_t vrow[WP_TILE / WP_SCALE + 2];
+    uint32_t hrow[WP_TILE];
+
+    for (int y = y0; y < y1; y++) {
+        /* Vertical pass over the low-res columns this tile needs */
+        int ly = y / WP_SCALE;
+        uint32_t wy = (uint32_t)(y % WP_SCALE) * 256 / WP_SCALE;
+        const uint32_t *r0 = &wp_glow[ly * wp_lo_w];
+        const uint32_t *r1 = r0 + wp_lo_w;
+        for (int lx = lx0; lx <= lx1; lx++)
+            vrow[lx - lx0] = lerp_px(r0[lx], r1[lx], wy);
+        /* Horizontal pass to full resolution */
+        for (int x = x0; x < x1; x++) {
+            int k = x / WP_SCALE - lx0;
+            uint32_t wx = (uint32_t)(x % WP_SCALE) * 256 / WP_SCALE;
+            hrow[x - x0] = lerp_px(vrow[k], vrow[k + 1], wx);
+        }
+        uint32_t *dst = &wp_comp[y * wp_w + x0];
+        simd_copy32(dst, &wp_base[y * wp_w + x0], x1 - x0);
+        simd_adds32(dst, hrow, x1 - x0);
+    }
+
+    /* Twinkling stars that land in this tile */
+    for (int i = 0; i < WP_STARS; i++) {
+        const Star &st = wp_star[i];
+        if (st.x < x0 - 1 || st.x > x1 || st.y < y0 - 1 || st.y > y1) continue;
+        int twinkle = (st.x * 7 + st.y * 13 + (int)wp_cur_phase) % 256;
+        if (twinkle > 128) twinkle = 256 - twinkle;
+        int brightness = clamp(st.bright - 40 + twinkle / 3, 0, 255);
+        int sr = clamp(brightness - 20 + st.rjit, 0, 255);
+        int sg = clamp(brightness - 10, 0, 255);
+        int sb = clamp(brightness + 10, 0, 255);
+        wp_plot(st.x, st.y, 0xFF000000 | (sr << 16) | (sg << 8) | sb, x0, y0, x1, y1);
+        if (i < 25 && st.x + 1 < wp_w) {
+            uint32_t dim = 0xFF000000 | ((sr / 2) << 16) | ((sg / 2) << 8) | (sb / 2);
+            wp_plot(st.x + 1, st.y, dim, x0, y0, x1, y1);
+            wp_plot(st.x - 1, st.y, dim, x0, y0, x1, y1);
+            wp_plot(st.x, st.y + 1, dim, x0, y0, x1, y1);
+            wp_plot(st.x, st.y - 1, dim, x0, y0, x1, y1);
+        }
+    }
+    wp_stale[ty * WP_TILES_X + tx] = 0;
+}
+
+struct BlitJob {
+    uint32_t *dst;
+    int stride, x, y, x1, y1;
+};
+
+/* One part: a run of whole tile rows of the blit */
+void wp_blit_part(void *arg, int part, int nparts) {
+    const BlitJob &b = *(const BlitJob *)arg;
+    int ty0, ty1;
+    smp_split(b.y / WP_TILE, (b.y1 - 1) / WP_TILE + 1, part, nparts, &ty0, &ty1);
+    for (int ty = ty0; ty < ty1; ty++)
+        for (int tx = b.x / WP_TILE; tx <= (b.x1 - 1) / WP_TILE; tx++)
+            if (wp_stale[ty * WP_TILES_X + tx]) wp_compose_tile(tx, ty);
+
+    int row0 = ty0 * WP_TILE < b.y ? b.y : ty0 * WP_TILE;
+    int row1 = ty1 * WP_TILE > b.y1 ? b.y1 : ty1 * WP_TILE;
+    for (int row = row0; row < row1; row++)
+        simd_copy32(&b.dst[row * b.stride + b.x], &wp_comp[row * wp_w + b.x], b.x1 - b.x);
+}
+
+} /* anonymous namespace */
+
+extern "C"
+void ui_wallpaper_invalidate(void) {
+    memset(wp_stale, 1, sizeof(wp_stale));
+}
+
+extern "C"
+void ui_wallpaper_set_phase(uint32_t phase) {
+    if (wp_have_phase && phase == wp_cur_phase) return;
+    if (!wp_w) wp_setup(GFX_W, GFX_H);
+    wp_cur_phase = phase;
+    wp_have_phase = 1;
+    wp_render_glow(phase);
+    ui_wallpaper_invalidate();
+}
+
+extern "C"
+void ui_wallpaper_blit(uint32_t *dst, int stride, int x, int y, int w, int h) {
+    if (!wp_have_phase) ui_wallpaper_set_phase(0);
+    int x1 = x + w > wp_w ? wp_w : x + w;
+    int y1 = y + h > wp_h ? wp_h : y + h;
+    if (x < 0) x = 0;
+    if (y < 0) y = 0;
+    if (x1 <= x || y1 <= y) return;
+
+    BlitJob job = { dst, stride, x, y, x1, y1 };
+    if ((x1 - x) * (y1 - y) >= VGA_PAR_MIN_PIXELS && y1 - y > WP_TILE)
+        smp_parallel(wp_blit_part, &job);
+    else
+        wp_blit_part(&job, 0, 1);
+}
+
+
 /* ═══════════════════════════════════════════════════════════════
  *  Tray Icon Background with Hover Glow
  * ═══════════════════════════════════════════════════════════════ */
@@ -122,6 +122,13 @@ void ui_render_aurora_wallpaper(uint32_t *buf, int w, int h);
 /* Render the animated aurora wallpaper with a time phase */
 void ui_render_aurora_wallpaper_animated(uint32_t *buf, int w, int h, uint32_t phase);
 
+/* Tiled wallpaper engine: set the animation phase (re-renders the low-res
+ * glow layer), then blit any screen rect — stale tiles are recomposed on
+ * demand. invalidate forces every tile to be recomposed. */
+void ui_wallpaper_set_phase(uint32_t phase);
+void ui_wallpaper_invalidate(void);
+void ui_wallpaper_blit(uint32_t *dst, int stride, int x, int y, int w, int h);
+
 /* Window soft shadow (multiple offset blurred layers) */
 void ui_window_shadow(int x, int y, int w, int h);
 
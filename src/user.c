@@ -55,10 +55,10 @@ static void save_user_list(void) {
         strcat(buf, users[i]);
         strcat(buf, "\n");
     }
-    /* Save to in-memory FS (always available) */
+    /* Save to FS (always available; survives reboot on a disk) */
     fs_write("/etc/users", buf);
-    /* Save to host bridge (may not be running) */
-    llm_host_save("users.txt", buf);
+    /* Host bridge only stands in for a missing disk */
+    if (!fs_persistent()) llm_host_save("users.txt", buf);
 }
 
 void user_init(void) {
@@ -71,14 +71,14 @@ void user_init(void) {
     fs_mkdir("/home");
     fs_mkdir("/etc");
 
-    /* Try host bridge first */
+    /* Try host bridge first when there is no disk */
     char buf[512];
-    int r = llm_host_load("users.txt", buf, sizeof(buf));
+    int r = fs_persistent() ? 0 : llm_host_load("users.txt", buf, sizeof(buf));
     if (r > 0 && buf[0] != '\0') {
         parse_user_list(buf);
     }
 
-    /* Also try in-memory FS (fallback / merge) */
+    /* Also try the FS (fallback / merge) */
     char fsbuf[512];
     int fr = fs_read("/etc/users", fsbuf, sizeof(fsbuf));
     if (fr >= 0 && fsbuf[0] != '\0') {
@@ -133,9 +133,9 @@ static void load_user_profile(const char *username) {
 
     char buf[128];
     buf[0] = '\0';
-    /* Try host bridge first */
-    int r = llm_host_load(fname, buf, sizeof(buf));
-    /* Fallback to in-memory FS */
+    /* Try host bridge first when there is no disk */
+    int r = fs_persistent() ? 0 : llm_host_load(fname, buf, sizeof(buf));
+    /* Fallback to (or, on a disk, go straight to) the FS */
     if (r <= 0 || buf[0] == '\0') {
         char fspath[48];
         strcpy(fspath, "/etc/");
@@ -181,7 +181,7 @@ void user_save_profile(void) {
     if (current_user < 0) return;
 
     rtc_time_t t;
-    rtc_read(&t);
+    time_now(&t);
     current_profile.last_hour = t.hour;
     current_profile.last_minute = t.minute;
     current_profile.last_day = t.day;
@@ -210,10 +210,10 @@ void user_save_profile(void) {
     itoa(current_profile.last_month, tmp, 10);
     strcat(buf, tmp);
 
-    /* Save to both host bridge and in-memory FS */
-    llm_host_save(fname, buf);
+    /* The serial round-trip is only needed without a disk */
+    if (!fs_persistent()) llm_host_save(fname, buf);
 
-    /* Also save to FS as fallback */
+    /* Save to FS (write-back cache when persistent) */
     char fspath[48];
     strcpy(fspath, "/etc/");
     strcat(fspath, fname);
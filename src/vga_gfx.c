@@ -8,6 +8,10 @@
 #include "vga_gfx.h"
 #include "multiboot.h"
 #include "string.h"
+#include "cpu.h"
+#include "simd.h"
+#include "memory.h"
+#include "smp.h"
 
 int GFX_W = 1920;
 int GFX_H = 1080;
@@ -19,24 +23,79 @@ static uint32_t *VESA_FB = (uint32_t *)0xFD000000;
 /* Backbuffer for double buffering high-res UI */
 static uint32_t backbuf[1920 * 1080];
 
+/* Current drawing target for vga_bb_*: the backbuffer, or an offscreen
+ * surface addressed in screen coordinates (bb_pix is pre-offset so that
+ * bb_pix[y * bb_stride + x] lands inside the surface). */
+static uint32_t *bb_pix = backbuf;
+static int bb_stride = 1920;
+
+/* Backbuffer clip rectangle (exclusive right/bottom); all vga_bb_*
+ * primitives honour it so a redraw can be confined to a damaged area. */
+static int clip_x0 = 0, clip_y0 = 0, clip_x1 = 1920, clip_y1 = 1080;
+
+/* Cursor overlay: drawn straight onto the front buffer with a save-under
+ * copy, so pointer motion never touches the backbuffer. While a flip is
+ * in progress (cursor_hold) the IRQ path only records the new position. */
+#define CURSOR_MAX 32
+static uint32_t cursor_img[CURSOR_MAX * CURSOR_MAX];
+static uint32_t cursor_under[CURSOR_MAX * CURSOR_MAX];
+static int cursor_w = 0, cursor_h = 0;
+static volatile int cursor_x = 0, cursor_y = 0;
+static volatile int cursor_visible = 0, cursor_drawn = 0, cursor_hold = 0;
+static int cursor_drawn_x = 0, cursor_drawn_y = 0;
+
+/* Damage list: screen regions that must be recomposited and flipped */
+static vga_rect_t damage[VGA_MAX_DAMAGE];
+static int damage_count = 0;
+
 /* ── Fast 32-bit memory operations ────────────────────────── */
+/* Routed through the CPUID-selected SIMD kernels. The cursor overlay,
+ * which runs from the mouse IRQ, uses plain loops instead. */
 
 static inline void memset32(uint32_t *dest, uint32_t val, int count) {
-    while (count >= 8) {
-        dest[0] = val; dest[1] = val; dest[2] = val; dest[3] = val;
-        dest[4] = val; dest[5] = val; dest[6] = val; dest[7] = val;
-        dest += 8; count -= 8;
-    }
-    while (count-- > 0) *dest++ = val;
+    simd_fill32(dest, val, count);
 }
 
 static inline void memcpy32(uint32_t *dest, const uint32_t *src, int count) {
-    while (count >= 8) {
-        dest[0] = src[0]; dest[1] = src[1]; dest[2] = src[2]; dest[3] = src[3];
-        dest[4] = src[4]; dest[5] = src[5]; dest[6] = src[6]; dest[7] = src[7];
-        dest += 8; src += 8; count -= 8;
+    simd_copy32(dest, src, count);
+}
+
+/* ── Scanline spans ───────────────────────────────────────── */
+/* span_half(r, d): half-width of a radius-r disc on the scanline d rows
+ * from its centre, i.e. the largest dx with dx*dx + d*d <= r*r. Rows for
+ * small radii are built once and cached; they also give the corner
+ * insets of rounded rectangles. */
+
+#define SPAN_CACHE_R 64
+
+static uint8_t span_cache[SPAN_CACHE_R + 1][SPAN_CACHE_R + 1];
+static uint8_t span_cached[SPAN_CACHE_R + 1];
+
+static int isqrt(uint32_t v) {
+    uint32_t res = 0, bit = 1u << 30;
+    while (bit > v) bit >>= 2;
+    while (bit) {
+        if (v >= res + bit) { v -= res + bit; res = (res >> 1) + bit; }
+        else res >>= 1;
+        bit >>= 2;
+    }
+    return (int)res;
+}
+
+static inline int span_half(int r, int d) {
+    if (d < 0) d = -d;
+    if (d > r) return -1;
+    if (r > SPAN_CACHE_R) return isqrt((uint32_t)(r * r - d * d));
+    if (!span_cached[r]) {
+        for (int i = 0; i <= r; i++) span_cache[r][i] = (uint8_t)isqrt((uint32_t)(r * r - i * i));
+        span_cached[r] = 1;
     }
-    while (count-- > 0) *dest++ = *src++;
+    return span_cache[r][d];
+}
+
+/* Inset of row dy (0 = outermost) in a rounded corner of radius r */
+static inline int corner_inset(int r, int dy) {
+    return r - span_half(r, r - 1 - dy);
 }
 
 /* ── Inline color helpers ─────────────────────────────────── */
@@ -60,6 +119,8 @@ void vesa_gfx_init(multiboot_info_t *mboot) {
         GFX_PITCH = mboot->framebuffer_pitch;
         GFX_BPP = mboot->framebuffer_bpp;
     }
+    bb_stride = GFX_W;
+    vga_bb_reset_clip();
     vga_clear(0);
 }
 
@@ -67,6 +128,14 @@ void vga_gfx_exit(void) {
     /* No cleanup needed for linear framebuffer */
 }
 
+uint32_t vga_framebuffer_phys(void) {
+    return (uint32_t)VESA_FB;
+}
+
+uint32_t vga_framebuffer_size(void) {
+    return (uint32_t)GFX_PITCH * (uint32_t)GFX_H;
+}
+
 /* ── Basic Primitives ─────────────────────────────────────── */
 
 void vga_putpixel(int x, int y, uint32_t color) {
@@ -152,73 +221,401 @@ void vga_draw_circle(int cx, int cy, int r, uint32_t color) {
 }
 
 void vga_fill_circle(int cx, int cy, int r, uint32_t color) {
-    for (int y = -r; y <= r; y++)
-        for (int x = -r; x <= r; x++)
-            if (x*x + y*y <= r*r) vga_putpixel(cx+x, cy+y, color);
+    for (int y = -r; y <= r; y++) {
+        int hw = span_half(r, y);
+        vga_draw_hline(cx - hw, cy + y, 2 * hw + 1, color);
+    }
 }
 
 void vga_draw_ring(int cx, int cy, int r, int thickness, uint32_t color) {
-    for (int y = -(r+thickness); y <= (r+thickness); y++) {
-        for (int x = -(r+thickness); x <= (r+thickness); x++) {
-            int dist_sq = x*x + y*y;
-            int outer_sq = (r+thickness) * (r+thickness);
-            int inner_sq = (r > thickness) ? (r-thickness) * (r-thickness) : 0;
-            if (dist_sq <= outer_sq && dist_sq >= inner_sq)
-                vga_putpixel(cx + x, cy + y, color);
+    int ro = r + thickness;
+    int inner_sq = (r > thickness) ? (r-thickness) * (r-thickness) : 0;
+    for (int y = -ro; y <= ro; y++) {
+        int hw = span_half(ro, y);
+        if (hw < 0) continue;
+        /* Hole: |x| with x*x < inner_sq - y*y */
+        int hole = inner_sq - y * y;
+        int hi = hole > 0 ? isqrt((uint32_t)(hole - 1)) : -1;
+        if (hi < 0) {
+            vga_draw_hline(cx - hw, cy + y, 2 * hw + 1, color);
+        } else {
+            vga_draw_hline(cx - hw, cy + y, hw - hi, color);
+            vga_draw_hline(cx + hi + 1, cy + y, hw - hi, color);
+        }
+    }
+}
+
+/* ── Cursor overlay ───────────────────────────────────────── */
+
+/* Both helpers run with interrupts disabled */
+static void cursor_erase(void) {
+    if (!cursor_drawn) return;
+    int pitch4 = GFX_PITCH / 4;
+    for (int dy = 0; dy < cursor_h; dy++) {
+        int py = cursor_drawn_y + dy;
+        if (py >= GFX_H) break;
+        for (int dx = 0; dx < cursor_w; dx++) {
+            int px = cursor_drawn_x + dx;
+            if (px >= GFX_W) break;
+            if (cursor_img[dy * CURSOR_MAX + dx] >> 24)
+                VESA_FB[py * pitch4 + px] = cursor_under[dy * CURSOR_MAX + dx];
         }
     }
+    cursor_drawn = 0;
+}
+
+static void cursor_paint(void) {
+    if (!cursor_visible || cursor_hold) return;
+    int pitch4 = GFX_PITCH / 4;
+    int cx = cursor_x, cy = cursor_y;
+    for (int dy = 0; dy < cursor_h; dy++) {
+        int py = cy + dy;
+        if (py >= GFX_H) break;
+        for (int dx = 0; dx < cursor_w; dx++) {
+            int px = cx + dx;
+            if (px >= GFX_W) break;
+            uint32_t c = cursor_img[dy * CURSOR_MAX + dx];
+            if (!(c >> 24)) continue;
+            cursor_under[dy * CURSOR_MAX + dx] = VESA_FB[py * pitch4 + px];
+            VESA_FB[py * pitch4 + px] = c;
+        }
+    }
+    cursor_drawn_x = cx; cursor_drawn_y = cy;
+    cursor_drawn = 1;
+}
+
+/* ARGB image; pixels with zero alpha are transparent */
+void vga_cursor_set_image(const uint32_t *pixels, int w, int h) {
+    uint32_t flags = irq_save();
+    cursor_erase();
+    int stride = w;             /* source rows stay full width when clipped */
+    if (w > CURSOR_MAX) w = CURSOR_MAX;
+    if (h > CURSOR_MAX) h = CURSOR_MAX;
+    for (int y = 0; y < h; y++)
+        for (int x = 0; x < w; x++)
+            cursor_img[y * CURSOR_MAX + x] = pixels[y * stride + x];
+    cursor_w = w; cursor_h = h;
+    cursor_paint();
+    irq_restore(flags);
+}
+
+void vga_cursor_show(int visible) {
+    uint32_t flags = irq_save();
+    cursor_visible = visible;
+    if (visible) { if (!cursor_drawn) cursor_paint(); }
+    else cursor_erase();
+    irq_restore(flags);
+}
+
+/* Called from the mouse IRQ with the new pointer position */
+void vga_cursor_move(int x, int y) {
+    uint32_t flags = irq_save();
+    cursor_x = x; cursor_y = y;
+    if (cursor_visible && !cursor_hold) {
+        cursor_erase();
+        cursor_paint();
+    }
+    irq_restore(flags);
+}
+
+static int cursor_overlaps(int x, int y, int w, int h) {
+    return cursor_drawn && cursor_drawn_x < x + w && cursor_drawn_x + cursor_w > x &&
+           cursor_drawn_y < y + h && cursor_drawn_y + cursor_h > y;
+}
+
+/* Suspend overlay updates for a flip; the cursor is lifted only if the
+ * flipped area covers it, otherwise its save-under stays valid. */
+static void cursor_begin_flip(const vga_rect_t *rects, int n) {
+    uint32_t flags = irq_save();
+    cursor_hold = 1;
+    for (int i = 0; i < n; i++) {
+        if (cursor_overlaps(rects[i].x, rects[i].y, rects[i].w, rects[i].h)) {
+            cursor_erase();
+            break;
+        }
+    }
+    irq_restore(flags);
+}
+
+static void cursor_end_flip(void) {
+    uint32_t flags = irq_save();
+    cursor_hold = 0;
+    if (cursor_visible && (!cursor_drawn || cursor_drawn_x != cursor_x || cursor_drawn_y != cursor_y)) {
+        cursor_erase();
+        cursor_paint();
+    }
+    irq_restore(flags);
 }
 
 /* ── Fast Double Buffering (Optimized) ────────────────────── */
 
 void vga_flip(void) {
+    vga_rect_t all = { 0, 0, GFX_W, GFX_H };
+    vga_flip_rects(&all, 1);
+}
+
+typedef struct {
+    const vga_rect_t *rects;
+    int n;
+} flip_job_t;
+
+/* Each part copies its share of the rows of every rect */
+static void flip_part(void *arg, int part, int nparts) {
+    const flip_job_t *job = (const flip_job_t *)arg;
     int pitch4 = GFX_PITCH / 4;
-    for (int y = 0; y < GFX_H; y++) {
-        memcpy32(&VESA_FB[y * pitch4], &backbuf[y * GFX_W], GFX_W);
+    for (int i = 0; i < job->n; i++) {
+        const vga_rect_t *rc = &job->rects[i];
+        int y0, y1;
+        smp_split(rc->y, rc->y + rc->h, part, nparts, &y0, &y1);
+        for (int y = y0; y < y1; y++)
+            memcpy32(&VESA_FB[y * pitch4 + rc->x], &backbuf[y * GFX_W + rc->x], rc->w);
+    }
+}
+
+/* Copy only the given backbuffer regions to the screen */
+void vga_flip_rects(const vga_rect_t *rects, int n) {
+    flip_job_t job = { rects, n };
+    int area = 0;
+    for (int i = 0; i < n; i++) area += rects[i].w * rects[i].h;
+    cursor_begin_flip(rects, n);
+    if (area >= VGA_PAR_MIN_PIXELS) smp_parallel(flip_part, &job);
+    else flip_part(&job, 0, 1);
+    cursor_end_flip();
+}
+
+/* ── Damage tracking ──────────────────────────────────────── */
+
+static inline int rect_area(int x0, int y0, int x1, int y1) {
+    return (x1 - x0) * (y1 - y0);
+}
+
+void vga_damage_add(int x, int y, int w, int h) {
+    int x0 = x < 0 ? 0 : x;
+    int y0 = y < 0 ? 0 : y;
+    int x1 = x + w > GFX_W ? GFX_W : x + w;
+    int y1 = y + h > GFX_H ? GFX_H : y + h;
+    if (x0 >= x1 || y0 >= y1) return;
+
+    /* Merge with any overlapping/touching rect, repeating as the union
+     * grows; when the list is full, merge into the cheapest neighbour. */
+    int merged = 1;
+    while (merged) {
+        merged = 0;
+        int best = -1, best_cost = 0;
+        for (int i = 0; i < damage_count; i++) {
+            vga_rect_t *d = &damage[i];
+            int ux0 = d->x < x0 ? d->x : x0;
+            int uy0 = d->y < y0 ? d->y : y0;
+            int ux1 = d->x + d->w > x1 ? d->x + d->w : x1;
+            int uy1 = d->y + d->h > y1 ? d->y + d->h : y1;
+            int touching = !(x1 < d->x || d->x + d->w < x0 || y1 < d->y || d->y + d->h < y0);
+            int cost = rect_area(ux0, uy0, ux1, uy1) - d->w * d->h - rect_area(x0, y0, x1, y1);
+            if (touching || (damage_count == VGA_MAX_DAMAGE && (best < 0 || cost < best_cost))) {
+                best = i;
+                best_cost = touching ? -1 : cost;
+                if (touching) break;
+            }
+        }
+        if (best >= 0) {
+            vga_rect_t *d = &damage[best];
+            if (d->x < x0) x0 = d->x;
+            if (d->y < y0) y0 = d->y;
+            if (d->x + d->w > x1) x1 = d->x + d->w;
+            if (d->y + d->h > y1) y1 = d->y + d->h;
+            damage[best] = damage[--damage_count];
+            merged = 1;
+        }
+    }
+    damage[damage_count].x = x0;
+    damage[damage_count].y = y0;
+    damage[damage_count].w = x1 - x0;
+    damage[damage_count].h = y1 - y0;
+    damage_count++;
+}
+
+void vga_damage_all(void) {
+    damage[0].x = 0; damage[0].y = 0;
+    damage[0].w = GFX_W; damage[0].h = GFX_H;
+    damage_count = 1;
+}
+
+int vga_damage_get(vga_rect_t *out, int max) {
+    int n = damage_count < max ? damage_count : max;
+    for (int i = 0; i < n; i++) out[i] = damage[i];
+    return n;
+}
+
+int vga_damage_pending(void) {
+    return damage_count;
+}
+
+void vga_damage_clear(void) {
+    damage_count = 0;
+}
+
+/* ── Backbuffer clipping ──────────────────────────────────── */
+
+void vga_bb_set_clip(int x, int y, int w, int h) {
+    clip_x0 = x < 0 ? 0 : x;
+    clip_y0 = y < 0 ? 0 : y;
+    clip_x1 = x + w > GFX_W ? GFX_W : x + w;
+    clip_y1 = y + h > GFX_H ? GFX_H : y + h;
+}
+
+void vga_bb_reset_clip(void) {
+    clip_x0 = 0; clip_y0 = 0;
+    clip_x1 = GFX_W; clip_y1 = GFX_H;
+}
+
+void vga_bb_get_clip(vga_rect_t *out) {
+    out->x = clip_x0; out->y = clip_y0;
+    out->w = clip_x1 - clip_x0; out->h = clip_y1 - clip_y0;
+}
+
+/* ── Render targets ───────────────────────────────────────── */
+
+static vga_rect_t saved_clip;
+static int      bb_keyed = 0;   /* target has a colour key (see vga_bb_set_target_key) */
+static uint32_t bb_key;
+
+/* Redirect vga_bb_* into a w*h surface that represents screen area (x, y).
+ * Drawing is clipped to that area; vga_bb_reset_target restores the
+ * backbuffer and the clip that was active before. */
+void vga_bb_set_target(uint32_t *surface, int x, int y, int w, int h) {
+    vga_bb_get_clip(&saved_clip);
+    bb_pix = surface - (y * w + x);
+    bb_stride = w;
+    clip_x0 = x; clip_y0 = y;
+    clip_x1 = x + w; clip_y1 = y + h;
+}
+
+/* Pixels of the current target equal to key are its transparent
+ * cut-outs: alpha fills leave them unblended, so they still match
+ * the key at blit time. Cleared by vga_bb_reset_target. */
+void vga_bb_set_target_key(uint32_t key) {
+    bb_key = key;
+    bb_keyed = 1;
+}
+
+/* simd_blend32 on a row, stepping over key pixels on a keyed target */
+static void blend_row(uint32_t *p, uint32_t color, int n) {
+    if (!bb_keyed) { simd_blend32(p, color, n); return; }
+    for (int i = 0; i < n; ) {
+        while (i < n && p[i] == bb_key) i++;
+        int s = i;
+        while (i < n && p[i] != bb_key) i++;
+        if (i > s) simd_blend32(p + s, color, i - s);
+    }
+}
+
+void vga_bb_reset_target(void) {
+    bb_keyed = 0;
+    bb_pix = backbuf;
+    bb_stride = GFX_W;
+    clip_x0 = saved_clip.x; clip_y0 = saved_clip.y;
+    clip_x1 = saved_clip.x + saved_clip.w; clip_y1 = saved_clip.y + saved_clip.h;
+}
+
+/* A clipped surface blit, with the target captured so the parts
+ * never read the (single-CPU) drawing state */
+typedef struct {
+    const uint32_t *src;
+    uint32_t *dst;
+    int stride;
+    int x, y, w, h;
+    int x0, y0, x1, y1;
+    int key_rows;
+    uint32_t key;
+} blit_job_t;
+
+static void blit_part(void *arg, int part, int nparts) {
+    const blit_job_t *b = (const blit_job_t *)arg;
+    int y0, y1;
+    smp_split(b->y0, b->y1, part, nparts, &y0, &y1);
+    for (int j = y0; j < y1; j++) {
+        const uint32_t *srow = &b->src[(j - b->y) * b->w + (b->x0 - b->x)];
+        uint32_t *drow = &b->dst[j * b->stride + b->x0];
+        int sy = j - b->y;
+        if (sy < b->key_rows || sy >= b->h - b->key_rows) {
+            for (int i = 0; i < b->x1 - b->x0; i++)
+                if (srow[i] != b->key) drow[i] = srow[i];
+        } else {
+            memcpy32(drow, srow, b->x1 - b->x0);
+        }
     }
 }
 
+/* Copy a w*h surface to (x, y), clipped. Within the first and last
+ * key_rows rows, pixels equal to key are treated as transparent. */
+void vga_bb_blit_surface(const uint32_t *src, int x, int y, int w, int h,
+                         int key_rows, uint32_t key) {
+    blit_job_t b = { src, bb_pix, bb_stride, x, y, w, h,
+                     x < clip_x0 ? clip_x0 : x, y < clip_y0 ? clip_y0 : y,
+                     x + w > clip_x1 ? clip_x1 : x + w, y + h > clip_y1 ? clip_y1 : y + h,
+                     key_rows, key };
+    if (b.x0 >= b.x1 || b.y0 >= b.y1) return;
+    if ((b.x1 - b.x0) * (b.y1 - b.y0) >= VGA_PAR_MIN_PIXELS) smp_parallel(blit_part, &b);
+    else blit_part(&b, 0, 1);
+}
+
+/* Base pointer and row stride of the current target (screen coordinates) */
 uint32_t *vga_backbuffer(void) {
-    return backbuf;
+    return bb_pix;
+}
+
+int vga_bb_stride(void) {
+    return bb_stride;
 }
 
 void vga_clear_bb(uint32_t color) {
     memset32(backbuf, color, GFX_W * GFX_H);
 }
 
+/* Block-move n backbuffer rows of width w from src_y to dst_y
+ * (scrolling; dst_y < src_y). The moved rows reach the screen with a
+ * flip, so the write-combined framebuffer is never read back. */
+void vga_bb_copy_rows(int dst_y, int src_y, int n, int w) {
+    if (dst_y < 0 || src_y < 0 || n <= 0 || w <= 0) return;
+    if (src_y + n > GFX_H) n = GFX_H - src_y;
+    if (dst_y + n > GFX_H) n = GFX_H - dst_y;
+    if (w > GFX_W) w = GFX_W;
+    for (int j = 0; j < n; j++)
+        memcpy32(&backbuf[(dst_y + j) * GFX_W], &backbuf[(src_y + j) * GFX_W], w);
+}
+
 /* ── Optimized Backbuffer Drawing ─────────────────────────── */
 
 void vga_bb_putpixel(int x, int y, uint32_t color) {
-    if (x >= 0 && x < GFX_W && y >= 0 && y < GFX_H)
-        backbuf[y * GFX_W + x] = color;
+    if (x >= clip_x0 && x < clip_x1 && y >= clip_y0 && y < clip_y1)
+        bb_pix[y * bb_stride + x] = color;
 }
 
 void vga_bb_fill_rect(int x, int y, int w, int h, uint32_t color) {
     /* Clamp once, then fast-fill rows */
-    int x0 = x < 0 ? 0 : x;
-    int y0 = y < 0 ? 0 : y;
-    int x1 = x + w > GFX_W ? GFX_W : x + w;
-    int y1 = y + h > GFX_H ? GFX_H : y + h;
+    int x0 = x < clip_x0 ? clip_x0 : x;
+    int y0 = y < clip_y0 ? clip_y0 : y;
+    int x1 = x + w > clip_x1 ? clip_x1 : x + w;
+    int y1 = y + h > clip_y1 ? clip_y1 : y + h;
     int cw = x1 - x0;
     if (cw <= 0) return;
     for (int j = y0; j < y1; j++)
-        memset32(&backbuf[j * GFX_W + x0], color, cw);
+        memset32(&bb_pix[j * bb_stride + x0], color, cw);
 }
 
 void vga_bb_draw_hline(int x, int y, int len, uint32_t color) {
-    if (y < 0 || y >= GFX_H || len <= 0) return;
-    int x0 = x < 0 ? 0 : x;
-    int x1 = x + len > GFX_W ? GFX_W : x + len;
+    if (y < clip_y0 || y >= clip_y1 || len <= 0) return;
+    int x0 = x < clip_x0 ? clip_x0 : x;
+    int x1 = x + len > clip_x1 ? clip_x1 : x + len;
     if (x0 >= x1) return;
-    memset32(&backbuf[y * GFX_W + x0], color, x1 - x0);
+    memset32(&bb_pix[y * bb_stride + x0], color, x1 - x0);
 }
 
 void vga_bb_draw_vline(int x, int y, int len, uint32_t color) {
-    if (x < 0 || x >= GFX_W || len <= 0) return;
-    int y0 = y < 0 ? 0 : y;
-    int y1 = y + len > GFX_H ? GFX_H : y + len;
+    if (x < clip_x0 || x >= clip_x1 || len <= 0) return;
+    int y0 = y < clip_y0 ? clip_y0 : y;
+    int y1 = y + len > clip_y1 ? clip_y1 : y + len;
     for (int j = y0; j < y1; j++)
-        backbuf[j * GFX_W + x] = color;
+        bb_pix[j * bb_stride + x] = color;
 }
 
 void vga_bb_draw_rect_outline(int x, int y, int w, int h, uint32_t color) {
@@ -234,47 +631,31 @@ void vga_bb_fill_rect_alpha(int x, int y, int w, int h, uint32_t color) {
     if (a == 255) { vga_bb_fill_rect(x, y, w, h, color); return; }
     if (a == 0) return;
 
-    /* Pre-extract foreground channels */
-    uint32_t fr = (color >> 16) & 0xFF;
-    uint32_t fg = (color >> 8) & 0xFF;
-    uint32_t fb = color & 0xFF;
-    uint32_t inv = 255 - a;
-
     /* Clamp */
-    int x0 = x < 0 ? 0 : x;
-    int y0 = y < 0 ? 0 : y;
-    int x1 = x + w > GFX_W ? GFX_W : x + w;
-    int y1 = y + h > GFX_H ? GFX_H : y + h;
+    int x0 = x < clip_x0 ? clip_x0 : x;
+    int y0 = y < clip_y0 ? clip_y0 : y;
+    int x1 = x + w > clip_x1 ? clip_x1 : x + w;
+    int y1 = y + h > clip_y1 ? clip_y1 : y + h;
 
-    for (int j = y0; j < y1; j++) {
-        uint32_t *row = &backbuf[j * GFX_W];
-        for (int i = x0; i < x1; i++) {
-            uint32_t bg = row[i];
-            uint32_t br = (bg >> 16) & 0xFF;
-            uint32_t bg_g = (bg >> 8) & 0xFF;
-            uint32_t bb = bg & 0xFF;
-            uint32_t or2 = (fr * a + br * inv) / 255;
-            uint32_t og = (fg * a + bg_g * inv) / 255;
-            uint32_t ob = (fb * a + bb * inv) / 255;
-            row[i] = ARGB(255, or2, og, ob);
-        }
-    }
+    if (x1 <= x0) return;
+    for (int j = y0; j < y1; j++)
+        blend_row(&bb_pix[j * bb_stride + x0], color, x1 - x0);
 }
 
 /* ── Gradient Fill (Vertical) ─────────────────────────────── */
 
 void vga_bb_fill_gradient_v(int x, int y, int w, int h,
                             uint32_t color_top, uint32_t color_bot) {
-    int x0 = x < 0 ? 0 : x;
-    int y0 = y < 0 ? 0 : y;
-    int x1 = x + w > GFX_W ? GFX_W : x + w;
-    int y1 = y + h > GFX_H ? GFX_H : y + h;
+    int x0 = x < clip_x0 ? clip_x0 : x;
+    int y0 = y < clip_y0 ? clip_y0 : y;
+    int x1 = x + w > clip_x1 ? clip_x1 : x + w;
+    int y1 = y + h > clip_y1 ? clip_y1 : y + h;
     int cw = x1 - x0;
     if (cw <= 0 || h <= 0) return;
 
     for (int j = y0; j < y1; j++) {
         uint32_t c = lerp_color(color_top, color_bot, j - y, h);
-        memset32(&backbuf[j * GFX_W + x0], c, cw);
+        memset32(&bb_pix[j * bb_stride + x0], c, cw);
     }
 }
 
@@ -290,12 +671,7 @@ void vga_bb_fill_rounded_rect(int x, int y, int w, int h, int r, uint32_t color)
 
     /* Top and bottom bands with rounded corners */
     for (int dy = 0; dy < r; dy++) {
-        /* Quarter-circle offset */
-        int dx = r;
-        /* Bresenham-ish: find x where x^2 + (r-1-dy)^2 <= r^2 */
-        int ry = r - 1 - dy;
-        while (dx > 0 && dx * dx + ry * ry > r * r) dx--;
-        int inset = r - dx;
+        int inset = corner_inset(r, dy);
 
         /* Top band */
         vga_bb_fill_rect(x + inset, y + dy, w - 2 * inset, 1, color);
@@ -313,25 +689,16 @@ void vga_bb_fill_rounded_rect_gradient(int x, int y, int w, int h, int r,
     for (int dy = 0; dy < h; dy++) {
         uint32_t c = lerp_color(color_top, color_bot, dy, h);
         int inset = 0;
-        if (dy < r) {
-            int ry = r - 1 - dy;
-            int dx = r;
-            while (dx > 0 && dx * dx + ry * ry > r * r) dx--;
-            inset = r - dx;
-        } else if (dy >= h - r) {
-            int ry = r - 1 - (h - 1 - dy);
-            int dx = r;
-            while (dx > 0 && dx * dx + ry * ry > r * r) dx--;
-            inset = r - dx;
-        }
+        if (dy < r) inset = corner_inset(r, dy);
+        else if (dy >= h - r) inset = corner_inset(r, h - 1 - dy);
         int rx = x + inset;
         int rw = w - 2 * inset;
         if (rw > 0) {
-            int rx0 = rx < 0 ? 0 : rx;
-            int rx1 = rx + rw > GFX_W ? GFX_W : rx + rw;
+            int rx0 = rx < clip_x0 ? clip_x0 : rx;
+            int rx1 = rx + rw > clip_x1 ? clip_x1 : rx + rw;
             int yy = y + dy;
-            if (yy >= 0 && yy < GFX_H && rx0 < rx1)
-                memset32(&backbuf[yy * GFX_W + rx0], c, rx1 - rx0);
+            if (yy >= clip_y0 && yy < clip_y1 && rx0 < rx1)
+                memset32(&bb_pix[yy * bb_stride + rx0], c, rx1 - rx0);
         }
     }
 }
@@ -340,16 +707,15 @@ void vga_bb_fill_rounded_rect_gradient(int x, int y, int w, int h, int r,
 void vga_bb_fill_circle(int cx, int cy, int r, uint32_t color) {
     for (int dy = -r; dy <= r; dy++) {
         int py = cy + dy;
-        if (py < 0 || py >= GFX_H) continue;
+        if (py < clip_y0 || py >= clip_y1) continue;
         /* Width at this scanline */
-        int dx = r;
-        while (dx > 0 && dx * dx + dy * dy > r * r) dx--;
+        int dx = span_half(r, dy);
         int x0 = cx - dx;
         int x1 = cx + dx;
-        if (x0 < 0) x0 = 0;
-        if (x1 >= GFX_W) x1 = GFX_W - 1;
+        if (x0 < clip_x0) x0 = clip_x0;
+        if (x1 >= clip_x1) x1 = clip_x1 - 1;
         if (x0 <= x1)
-            memset32(&backbuf[py * GFX_W + x0], color, x1 - x0 + 1);
+            memset32(&bb_pix[py * bb_stride + x0], color, x1 - x0 + 1);
     }
 }
 
@@ -370,32 +736,18 @@ void vga_bb_draw_circle(int cx, int cy, int r, uint32_t color) {
 void vga_bb_fill_circle_alpha(int cx, int cy, int r, uint32_t color) {
     uint32_t a = (color >> 24) & 0xFF;
     if (a == 0) return;
-    uint32_t fr = (color >> 16) & 0xFF;
-    uint32_t fg = (color >> 8) & 0xFF;
-    uint32_t fb = color & 0xFF;
-    uint32_t inv = 255 - a;
 
     for (int dy = -r; dy <= r; dy++) {
         int py = cy + dy;
-        if (py < 0 || py >= GFX_H) continue;
-        int dx = r;
-        while (dx > 0 && dx * dx + dy * dy > r * r) dx--;
+        if (py < clip_y0 || py >= clip_y1) continue;
+        int dx = span_half(r, dy);
         int x0 = cx - dx;
         int x1 = cx + dx;
-        if (x0 < 0) x0 = 0;
-        if (x1 >= GFX_W) x1 = GFX_W - 1;
-        uint32_t *row = &backbuf[py * GFX_W];
-        for (int i = x0; i <= x1; i++) {
-            if (a == 255) { row[i] = color; continue; }
-            uint32_t bg = row[i];
-            uint32_t br = (bg >> 16) & 0xFF;
-            uint32_t bg_g = (bg >> 8) & 0xFF;
-            uint32_t bb = bg & 0xFF;
-            uint32_t or2 = (fr * a + br * inv) / 255;
-            uint32_t og = (fg * a + bg_g * inv) / 255;
-            uint32_t ob = (fb * a + bb * inv) / 255;
-            row[i] = ARGB(255, or2, og, ob);
-        }
+        if (x0 < clip_x0) x0 = clip_x0;
+        if (x1 >= clip_x1) x1 = clip_x1 - 1;
+        if (x1 < x0) continue;
+        if (a == 255) memset32(&bb_pix[py * bb_stride + x0], color, x1 - x0 + 1);
+        else blend_row(&bb_pix[py * bb_stride + x0], color, x1 - x0 + 1);
     }
 }
 
@@ -559,61 +911,187 @@ void vga_draw_string_3x(int x, int y, const char *str, uint32_t color) {
     while (*str) { vga_draw_char_3x(x, y, *str, color); x += 26; str++; }
 }
 
-/* ── Backbuffer Text Drawing (1x) ─────────────────────────── */
+/* ── Glyph atlas ──────────────────────────────────────────── */
+/* Coverage masks pre-expanded per scale: one word per pixel, 0 or
+ * 0xFFFFFFFF, so a glyph row composites as (dst & ~m) | (fg & m)
+ * without per-bit tests or per-pixel clipping. */
+
+#define ATLAS_GLYPHS 95
+
+static uint32_t atlas_1x[ATLAS_GLYPHS][8 * 8];
+static uint32_t atlas_2x[ATLAS_GLYPHS][16 * 16];
+static int atlas_ready = 0;
+
+static void atlas_build(void) {
+    for (int g = 0; g < ATLAS_GLYPHS; g++) {
+        for (int r = 0; r < 16; r++) {
+            uint8_t bits = font8x8_full[g][r / 2];
+            for (int c = 0; c < 16; c++) {
+                uint32_t m = (bits & (0x80 >> (c / 2))) ? 0xFFFFFFFF : 0;
+                atlas_2x[g][r * 16 + c] = m;
+                if (!(r & 1) && !(c & 1)) atlas_1x[g][(r / 2) * 8 + c / 2] = m;
+            }
+        }
+    }
+    atlas_ready = 1;
+}
 
-void vga_bb_draw_char(int x, int y, char c, uint32_t fg, uint32_t bg) {
+static inline const uint32_t *atlas_glyph(char c, int scale) {
     int idx = full_char_idx(c);
-    const uint8_t *g = font8x8_full[idx];
-    for (int r = 0; r < 8; r++) {
-        uint8_t bits = g[r];
-        for (int col = 0; col < 8; col++) {
-            if (bits & (0x80 >> col))
-                vga_bb_putpixel(x + col, y + r, fg);
-            else if ((bg >> 24) == 255)
-                vga_bb_putpixel(x + col, y + r, bg);
+    return scale == 2 ? atlas_2x[idx] : atlas_1x[idx];
+}
+
+static int text_len(const char *str, int n) {
+    int len = 0;
+    while ((n < 0 || len < n) && str[len]) len++;
+    return len;
+}
+
+/* Draw len characters one output row at a time across the visible
+ * glyphs. Glyph size 8*scale, advance 9*scale. */
+static void text_draw(int x, int y, const char *str, int len, int scale,
+                      uint32_t fg, uint32_t bg) {
+    int gs = 8 * scale, adv = 9 * scale;
+    if (y >= clip_y1 || y + gs <= clip_y0 || x >= clip_x1) return;
+    if (!atlas_ready) atlas_build();
+
+    /* Visible character range */
+    int i0 = 0;
+    if (x + gs <= clip_x0) i0 = (clip_x0 - x - gs) / adv + 1;
+    int i1 = (clip_x1 - x + adv - 1) / adv;
+    if (i1 > len) i1 = len;
+    if (i0 >= i1) return;
+
+    int r0 = clip_y0 > y ? clip_y0 - y : 0;
+    int r1 = y + gs > clip_y1 ? clip_y1 - y : gs;
+    int opaque = (bg >> 24) == 255;
+
+    for (int r = r0; r < r1; r++) {
+        uint32_t *row = &bb_pix[(y + r) * bb_stride];
+        for (int i = i0; i < i1; i++) {
+            int gx = x + i * adv;
+            int c0 = clip_x0 > gx ? clip_x0 - gx : 0;
+            int c1 = gx + gs > clip_x1 ? clip_x1 - gx : gs;
+            const uint32_t *m = atlas_glyph(str[i], scale) + r * gs;
+            uint32_t *d = row + gx;
+            if (opaque) {
+                for (int c = c0; c < c1; c++) d[c] = (fg & m[c]) | (bg & ~m[c]);
+            } else {
+                for (int c = c0; c < c1; c++) d[c] = (d[c] & ~m[c]) | (fg & m[c]);
+            }
         }
     }
 }
 
+void vga_bb_draw_text(int x, int y, const char *str, int n, int scale,
+                      uint32_t fg, uint32_t bg) {
+    text_draw(x, y, str, text_len(str, n), scale == 2 ? 2 : 1, fg, bg);
+}
+
+/* ── Backbuffer Text Drawing (1x) ─────────────────────────── */
+
+void vga_bb_draw_char(int x, int y, char c, uint32_t fg, uint32_t bg) {
+    text_draw(x, y, &c, 1, 1, fg, bg);
+}
+
 void vga_bb_draw_string(int x, int y, const char *str, uint32_t fg, uint32_t bg) {
-    while (*str) {
-        vga_bb_draw_char(x, y, *str, fg, bg);
-        x += 9;
-        str++;
-    }
+    text_draw(x, y, str, text_len(str, -1), 1, fg, bg);
 }
 
-/* ── Backbuffer Text Drawing (2x — 16x16 effective) ─────── */
+/* ── Backbuffer Text Drawing (2x) ─────────────────────────── */
 
 void vga_bb_draw_char_2x(int x, int y, char c, uint32_t fg, uint32_t bg) {
-    int idx = full_char_idx(c);
-    const uint8_t *g = font8x8_full[idx];
-    for (int r = 0; r < 8; r++) {
-        uint8_t bits = g[r];
-        int py0 = y + r * 2;
-        int py1 = py0 + 1;
-        for (int col = 0; col < 8; col++) {
-            int px0 = x + col * 2;
-            int px1 = px0 + 1;
-            if (bits & (0x80 >> col)) {
-                vga_bb_putpixel(px0, py0, fg);
-                vga_bb_putpixel(px1, py0, fg);
-                vga_bb_putpixel(px0, py1, fg);
-                vga_bb_putpixel(px1, py1, fg);
-            } else if ((bg >> 24) == 255) {
-                vga_bb_putpixel(px0, py0, bg);
-                vga_bb_putpixel(px1, py0, bg);
-                vga_bb_putpixel(px0, py1, bg);
-                vga_bb_putpixel(px1, py1, bg);
+    text_draw(x, y, &c, 1, 2, fg, bg);
+}
+
+void vga_bb_draw_string_2x(int x, int y, const char *str, uint32_t fg, uint32_t bg) {
+    text_draw(x, y, str, text_len(str, -1), 2, fg, bg);
+}
+
+/* ── Cached text runs ─────────────────────────────────────── */
+/* A run keeps its string rasterized as horizontal fg spans (merged
+ * across glyphs), so redrawing unchanged text is a handful of fills. */
+
+static int run_rasterize(vga_text_run_t *run, uint16_t *out) {
+    int gs = 8 * run->scale, adv = 9 * run->scale, count = 0;
+    if (!atlas_ready) atlas_build();
+    for (int r = 0; r < gs; r++) {
+        int start = -1;
+        for (int px = 0; px <= run->w; px++) {
+            int on = 0;
+            if (px < run->w) {
+                int i = px / adv, c = px % adv;
+                on = c < gs && atlas_glyph(run->text[i], run->scale)[r * gs + c];
+            }
+            if (on && start < 0) start = px;
+            if (!on && start >= 0) {
+                if (out) { out[count * 3] = r; out[count * 3 + 1] = start; out[count * 3 + 2] = px - start; }
+                count++;
+                start = -1;
             }
         }
     }
+    return count;
 }
 
-void vga_bb_draw_string_2x(int x, int y, const char *str, uint32_t fg, uint32_t bg) {
-    while (*str) {
-        vga_bb_draw_char_2x(x, y, *str, fg, bg);
-        x += 18;
-        str++;
+int vga_text_run_set(vga_text_run_t *run, const char *str, int n, int scale,
+                     uint32_t fg, uint32_t bg) {
+    char buf[VGA_TEXT_RUN_MAX];
+    int len = 0;
+    while ((n < 0 || len < n) && len < VGA_TEXT_RUN_MAX - 1 && str[len]) {
+        buf[len] = str[len];
+        len++;
     }
+    buf[len] = '\0';
+    scale = scale == 2 ? 2 : 1;
+    if (run->valid && run->scale == scale && run->fg == fg && run->bg == bg &&
+        strcmp(run->text, buf) == 0)
+        return 0;
+
+    vga_text_run_free(run);
+    strcpy(run->text, buf);
+    run->len = len;
+    run->scale = scale;
+    run->fg = fg;
+    run->bg = bg;
+    run->w = len ? len * 9 * scale - scale : 0;   /* no trailing gap */
+    run->nspans = run_rasterize(run, 0);
+    if (run->nspans) {
+        run->spans = (uint16_t *)kmalloc(run->nspans * 3 * sizeof(uint16_t));
+        if (!run->spans) return -1;   /* drawn directly from text */
+        run_rasterize(run, run->spans);
+    }
+    run->valid = 1;
+    return 0;
+}
+
+void vga_text_run_draw(const vga_text_run_t *run, int x, int y) {
+    if (!run->valid || !run->len) return;
+    int gs = 8 * run->scale, adv = 9 * run->scale;
+    if (!run->spans && run->nspans) {
+        text_draw(x, y, run->text, run->len, run->scale, run->fg, run->bg);
+        return;
+    }
+    if (y >= clip_y1 || y + gs <= clip_y0 || x >= clip_x1 || x + run->w <= clip_x0) return;
+
+    if ((run->bg >> 24) == 255) {
+        for (int i = 0; i < run->len; i++)
+            vga_bb_fill_rect(x + i * adv, y, gs, gs, run->bg);
+    }
+    for (int s = 0; s < run->nspans; s++) {
+        const uint16_t *sp = &run->spans[s * 3];
+        int py = y + sp[0];
+        if (py < clip_y0 || py >= clip_y1) continue;
+        int x0 = x + sp[1], x1 = x0 + sp[2];
+        if (x0 < clip_x0) x0 = clip_x0;
+        if (x1 > clip_x1) x1 = clip_x1;
+        if (x1 > x0) memset32(&bb_pix[py * bb_stride + x0], run->fg, x1 - x0);
+    }
+}
+
+void vga_text_run_free(vga_text_run_t *run) {
+    if (run->spans) kfree(run->spans);
+    run->spans = 0;
+    run->nspans = 0;
+    run->valid = 0;
 }
@@ -15,6 +15,8 @@ extern int GFX_PITCH;
 /* ── Initialization ───────────────────────────────────────── */
 void vesa_gfx_init(multiboot_info_t *mboot);
 void vga_gfx_exit(void);
+uint32_t vga_framebuffer_phys(void);
+uint32_t vga_framebuffer_size(void);   /* pitch * height, in bytes */
 
 /* ── Front-buffer primitives ──────────────────────────────── */
 void vga_putpixel(int x, int y, uint32_t color);
@@ -27,10 +29,43 @@ void vga_draw_circle(int cx, int cy, int r, uint32_t color);
 void vga_fill_circle(int cx, int cy, int r, uint32_t color);
 void vga_draw_ring(int cx, int cy, int r, int thickness, uint32_t color);
 
+typedef struct { int x, y, w, h; } vga_rect_t;
+
 /* ── Double buffering ─────────────────────────────────────── */
+/* Copies at least this big are split into row bands across CPUs
+ * (smp_parallel): full-screen passes are memory-bandwidth bound,
+ * smaller ones are not worth the IPI round trip. */
+#define VGA_PAR_MIN_PIXELS (128 * 1024)
+
 void vga_flip(void);
+void vga_flip_rects(const vga_rect_t *rects, int n);
 uint32_t *vga_backbuffer(void);
+int  vga_bb_stride(void);
 void vga_clear_bb(uint32_t color);
+void vga_bb_copy_rows(int dst_y, int src_y, int n, int w);
+
+/* ── Cursor overlay (front buffer, save-under) ────────────── */
+void vga_cursor_set_image(const uint32_t *pixels, int w, int h);
+void vga_cursor_show(int visible);
+void vga_cursor_move(int x, int y);
+
+/* ── Damage tracking & clipping ───────────────────────────── */
+#define VGA_MAX_DAMAGE 16
+void vga_damage_add(int x, int y, int w, int h);
+void vga_damage_all(void);
+int  vga_damage_get(vga_rect_t *out, int max);
+int  vga_damage_pending(void);
+void vga_damage_clear(void);
+void vga_bb_set_clip(int x, int y, int w, int h);
+void vga_bb_reset_clip(void);
+void vga_bb_get_clip(vga_rect_t *out);
+
+/* ── Offscreen surfaces ───────────────────────────────────── */
+void vga_bb_set_target(uint32_t *surface, int x, int y, int w, int h);
+void vga_bb_set_target_key(uint32_t key);  /* alpha fills skip key pixels */
+void vga_bb_reset_target(void);
+void vga_bb_blit_surface(const uint32_t *src, int x, int y, int w, int h,
+                         int key_rows, uint32_t key);
 
 /* ── Front-buffer text ────────────────────────────────────── */
 void vga_draw_char(int x, int y, char c, uint32_t color);
@@ -66,4 +101,28 @@ void vga_bb_draw_string(int x, int y, const char *str, uint32_t fg, uint32_t bg)
 void vga_bb_draw_char_2x(int x, int y, char c, uint32_t fg, uint32_t bg);
 void vga_bb_draw_string_2x(int x, int y, const char *str, uint32_t fg, uint32_t bg);
 
+/* Up to n characters (n < 0: all) at scale 1 or 2, glyph atlas path */
+void vga_bb_draw_text(int x, int y, const char *str, int n, int scale,
+                      uint32_t fg, uint32_t bg);
+
+/* ── Cached text runs ─────────────────────────────────────── */
+/* For text that rarely changes: set() re-rasterizes only when the string,
+ * scale or colours differ from last time; draw() replays the spans. A
+ * zeroed run is empty; free() releases its spans. */
+#define VGA_TEXT_RUN_MAX 64
+
+typedef struct {
+    char      text[VGA_TEXT_RUN_MAX];
+    int       len, scale, w;
+    uint32_t  fg, bg;
+    int       valid;
+    int       nspans;
+    uint16_t *spans;      /* nspans x {row, x, len} */
+} vga_text_run_t;
+
+int  vga_text_run_set(vga_text_run_t *run, const char *str, int n, int scale,
+                      uint32_t fg, uint32_t bg);
+void vga_text_run_draw(const vga_text_run_t *run, int x, int y);
+void vga_text_run_free(vga_text_run_t *run);
+
 #endif
@@ -0,0 +1,292 @@
+/* ============================================================
+ * SwanOS — VirtIO Network Driver (legacy interface)
+ * Two virtqueues over pool buffers (netbuf.h). Every frame is a
+ * two-descriptor chain, the virtio-net header in its own slot and
+ * the frame in a pool buffer, so nothing is copied either way.
+ * The host is asked not to interrupt while the bottom half drains
+ * the rings, and never for finished sends.
+ * ============================================================ */
+
+#include "virtio_net.h"
+#include "netdev.h"
+#include "pci.h"
+#include "memory.h"
+#include "spinlock.h"
+#include "ports.h"
+#include "idt.h"
+#include "string.h"
+#include "serial.h"
+
+/* ── Legacy register block (BAR0, I/O) ────────────────────── */
+#define VIO_DEV_FEATURES   0x00
+#define VIO_GUEST_FEATURES 0x04
+#define VIO_QUEUE_PFN      0x08
+#define VIO_QUEUE_SIZE     0x0C
+#define VIO_QUEUE_SEL      0x0E
+#define VIO_QUEUE_NOTIFY   0x10
+#define VIO_STATUS         0x12
+#define VIO_ISR            0x13     /* read clears */
+#define VIO_NET_MAC        0x14
+#define VIO_NET_STATUS     0x1A
+
+#define STATUS_ACK         0x01
+#define STATUS_DRIVER      0x02
+#define STATUS_DRIVER_OK   0x04
+#define STATUS_FAILED      0x80
+
+#define NET_F_MAC          (1u << 5)
+#define NET_F_STATUS       (1u << 16)
+#define NET_S_LINK_UP      1
+
+#define ISR_QUEUE          0x01
+#define ISR_CONFIG         0x02
+
+/* ── Virtqueues ───────────────────────────────────────────── */
+#define VQ_RX    0
+#define VQ_TX    1
+#define VQ_MAX   256            /* largest queue we take */
+
+#define DESC_F_NEXT         1
+#define DESC_F_WRITE        2
+#define AVAIL_F_NO_INTERRUPT 1
+
+typedef struct {
+    uint64_t addr;
+    uint32_t len;
+    uint16_t flags;
+    uint16_t next;
+} __attribute__((packed)) vring_desc_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    uint16_t ring[];
+} __attribute__((packed)) vring_avail_t;
+
+typedef struct {
+    uint32_t id;
+    uint32_t len;
+} __attribute__((packed)) vring_used_elem_t;
+
+typedef struct {
+    uint16_t flags;
+    uint16_t idx;
+    vring_used_elem_t ring[];
+} __attribute__((packed)) vring_used_t;
+
+typedef struct {
+    uint16_t flags;
+    uint8_t  gso_type;
+    uint16_t hdr_len;
+    uint16_t gso_size;
+    uint16_t csum_start;
+    uint16_t csum_offset;
+} __attribute__((packed)) vnet_hdr_t;
+
+typedef struct {
+    uint16_t size;              /* descriptors; size / 2 frame slots */
+    volatile vring_desc_t  *desc;
+    volatile vring_avail_t *avail;
+    volatile vring_used_t  *used;
+    uint16_t last_used;
+    netbuf_t *bufs[VQ_MAX / 2];
+} vq_t;
+
+static uint16_t io;
+static vq_t rxq, txq;
+static vnet_hdr_t rx_hdrs[VQ_MAX / 2];
+static vnet_hdr_t tx_hdr;               /* no offloads: one zero header for all */
+static uint16_t tx_free[VQ_MAX / 2];    /* free TX slots, a stack */
+static int tx_nfree = 0;
+static uint32_t features = 0;
+static spinlock_t tx_lock = SPINLOCK_INIT;
+static netdev_t vnet_dev;
+
+#define ALIGN_PAGE(x) (((x) + PAGE_SIZE - 1) & ~(PAGE_SIZE - 1))
+
+static int vq_init(vq_t *q, int index) {
+    outw(io + VIO_QUEUE_SEL, (uint16_t)index);
+    uint16_t n = inw(io + VIO_QUEUE_SIZE);
+    if (n == 0 || n > VQ_MAX) return -1;
+
+    /* Legacy layout: descriptors, available ring, then the used ring
+     * on the next page boundary */
+    uint32_t used_off = ALIGN_PAGE(16u * n + 6 + 2u * n);
+    uint32_t bytes = used_off + ALIGN_PAGE(6 + 8u * n);
+    uint8_t *mem = (uint8_t *)pmm_alloc_pages(bytes / PAGE_SIZE, PMM_ZERO);
+    if (!mem) return -1;
+
+    q->size = n;
+    q->desc = (volatile vring_desc_t *)mem;
+    q->avail = (volatile vring_avail_t *)(mem + 16u * n);
+    q->used = (volatile vring_used_t *)(mem + used_off);
+    q->last_used = 0;
+    outl(io + VIO_QUEUE_PFN, (uint32_t)mem / PAGE_SIZE);
+    return 0;
+}
+
+/* Hand chain `head` to the device; the caller notifies */
+static void vq_push(vq_t *q, uint16_t head) {
+    q->avail->ring[q->avail->idx % q->size] = head;
+    __sync_synchronize();       /* entry before index */
+    q->avail->idx++;
+}
+
+static void update_link(void) {
+    vnet_dev.link_up = (features & NET_F_STATUS)
+        ? (inw(io + VIO_NET_STATUS) & NET_S_LINK_UP) != 0 : 1;
+}
+
+/* ── Transmit ─────────────────────────────────────────────── */
+
+static void tx_reclaim(void) {
+    while (txq.last_used != txq.used->idx) {
+        __sync_synchronize();
+        uint32_t head = txq.used->ring[txq.last_used % txq.size].id;
+        uint16_t slot = (uint16_t)(head / 2);
+        netbuf_free(txq.bufs[slot]);
+        txq.bufs[slot] = 0;
+        tx_free[tx_nfree++] = slot;
+        txq.last_used++;
+    }
+}
+
+static int vnet_xmit(netdev_t *dev, netbuf_t *b) {
+    (void)dev;
+    uint32_t flags = spin_lock_irqsave(&tx_lock);
+    if (!tx_nfree) tx_reclaim();
+    if (!tx_nfree) {
+        spin_unlock_irqrestore(&tx_lock, flags);
+        return -1;
+    }
+    uint16_t slot = tx_free[--tx_nfree];
+    volatile vring_desc_t *d = &txq.desc[slot * 2 + 1];
+    d->addr = (uint32_t)b->data;
+    d->len = b->len;
+    txq.bufs[slot] = b;
+    vq_push(&txq, (uint16_t)(slot * 2));
+    outw(io + VIO_QUEUE_NOTIFY, VQ_TX);
+    spin_unlock_irqrestore(&tx_lock, flags);
+    return 0;
+}
+
+/* ── Receive ──────────────────────────────────────────────── */
+
+static int rx_harvest(int budget) {
+    int n = 0;
+    while (n < budget && rxq.last_used != rxq.used->idx) {
+        __sync_synchronize();   /* index before entry */
+        volatile vring_used_elem_t *e = &rxq.used->ring[rxq.last_used % rxq.size];
+        uint16_t slot = (uint16_t)(e->id / 2);
+        netbuf_t *b = rxq.bufs[slot];
+        netbuf_t *fresh = e->len > sizeof(vnet_hdr_t) ? netbuf_alloc() : 0;
+        if (fresh) {
+            b->data = b->head;
+            b->len = (uint16_t)(e->len - sizeof(vnet_hdr_t));
+            netdev_rx(&vnet_dev, b);
+            rxq.bufs[slot] = fresh;
+            rxq.desc[slot * 2 + 1].addr = (uint32_t)fresh->head;
+        } else {
+            netdev_rx_drop(&vnet_dev);
+        }
+        vq_push(&rxq, (uint16_t)(slot * 2));
+        rxq.last_used++;
+        n++;
+    }
+    if (n) outw(io + VIO_QUEUE_NOTIFY, VQ_RX);
+    return n;
+}
+
+static int vnet_poll(netdev_t *dev) {
+    (void)dev;
+    uint32_t flags = spin_lock_irqsave(&tx_lock);
+    tx_reclaim();
+    spin_unlock_irqrestore(&tx_lock, flags);
+    update_link();
+    if (rx_harvest(NET_POLL_BUDGET) == NET_POLL_BUDGET) return 1;
+
+    /* Interrupts back on, then look again: a frame the host used
+     * before it saw the flag change would not interrupt */
+    rxq.avail->flags = 0;
+    __sync_synchronize();
+    if (rxq.last_used != rxq.used->idx) {
+        rxq.avail->flags = AVAIL_F_NO_INTERRUPT;
+        return 1;
+    }
+    return 0;
+}
+
+/* ── IRQ top half ─────────────────────────────────────────── */
+
+static void vnet_callback(registers_t *regs) {
+    (void)regs;
+    uint8_t isr = inb(io + VIO_ISR);        /* acknowledges */
+    if (!(isr & (ISR_QUEUE | ISR_CONFIG))) return;
+    rxq.avail->flags = AVAIL_F_NO_INTERRUPT;
+    netdev_schedule(&vnet_dev);
+}
+
+/* ── Bring-up ─────────────────────────────────────────────── */
+
+static int rings_init(void) {
+    if (vq_init(&rxq, VQ_RX) < 0 || vq_init(&txq, VQ_TX) < 0) return -1;
+
+    for (int i = 0; i < rxq.size / 2; i++) {
+        netbuf_t *b = netbuf_alloc();
+        if (!b) return -1;
+        rxq.bufs[i] = b;
+        rxq.desc[i * 2] = (vring_desc_t){ (uint32_t)&rx_hdrs[i], sizeof(vnet_hdr_t),
+                                          DESC_F_NEXT | DESC_F_WRITE, (uint16_t)(i * 2 + 1) };
+        rxq.desc[i * 2 + 1] = (vring_desc_t){ (uint32_t)b->head, NETBUF_SIZE, DESC_F_WRITE, 0 };
+        vq_push(&rxq, (uint16_t)(i * 2));
+    }
+
+    memset(&tx_hdr, 0, sizeof(tx_hdr));
+    tx_nfree = 0;
+    for (int i = txq.size / 2 - 1; i >= 0; i--) {
+        txq.desc[i * 2] = (vring_desc_t){ (uint32_t)&tx_hdr, sizeof(vnet_hdr_t),
+                                          DESC_F_NEXT, (uint16_t)(i * 2 + 1) };
+        txq.desc[i * 2 + 1] = (vring_desc_t){ 0, 0, 0, 0 };
+        tx_free[tx_nfree++] = (uint16_t)i;
+    }
+    txq.avail->flags = AVAIL_F_NO_INTERRUPT;    /* reclaimed lazily */
+    return 0;
+}
+
+int virtio_net_probe(const pci_device_t *pci) {
+    if (!(pci->bar_io & 1)) return -1;      /* legacy devices have an I/O BAR0 */
+    io = (uint16_t)pci->bar[0];
+    if (netbuf_init() < 0) return -1;
+
+    pci_enable(pci, PCI_CMD_IO | PCI_CMD_MASTER);
+
+    outb(io + VIO_STATUS, 0);               /* reset */
+    outb(io + VIO_STATUS, STATUS_ACK | STATUS_DRIVER);
+    features = inl(io + VIO_DEV_FEATURES) & (NET_F_MAC | NET_F_STATUS);
+    outl(io + VIO_GUEST_FEATURES, features);
+
+    if (rings_init() < 0) {
+        outb(io + VIO_STATUS, STATUS_FAILED);
+        serial_write("virtio-net: cannot set up virtqueues\n");
+        return -1;
+    }
+
+    static const uint8_t local_mac[6] = { 0x02, 'S', 'W', 'A', 'N', 0x01 };
+    for (int i = 0; i < 6; i++)
+        vnet_dev.mac[i] = (features & NET_F_MAC) ? inb(io + VIO_NET_MAC + i) : local_mac[i];
+    vnet_dev.name = "virtio-net";
+    vnet_dev.speed = 0;
+    vnet_dev.irq = pci->irq;
+    vnet_dev.xmit = vnet_xmit;
+    vnet_dev.poll = vnet_poll;
+    if (netdev_register(&vnet_dev) < 0) return -1;
+
+    if (vnet_dev.irq < 16) {
+        register_interrupt_handler(32 + vnet_dev.irq, vnet_callback);
+        netdev_irq_enable(vnet_dev.irq);
+    }
+    outb(io + VIO_STATUS, STATUS_ACK | STATUS_DRIVER | STATUS_DRIVER_OK);
+    update_link();
+    outw(io + VIO_QUEUE_NOTIFY, VQ_RX);
+    return 0;
+}
@@ -0,0 +1,12 @@
+#ifndef VIRTIO_NET_H
+#define VIRTIO_NET_H
+
+#include <stdint.h>
+#include "pci.h"
+
+/* Legacy (0.9.5, I/O port) virtio-net driver. Takes the PCI
+ * device, sets up its receive and transmit virtqueues and
+ * registers it as the netdev. Returns 0, or -1 on failure. */
+int virtio_net_probe(const pci_device_t *pci);
+
+#endif
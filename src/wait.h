@@ -0,0 +1,41 @@
+#ifndef WAIT_H
+#define WAIT_H
+
+#include <stdint.h>
+
+/* ── Wait Queues ──────────────────────────────────────────────
+ * A sleeper links one entry (on its own stack) into each queue it
+ * waits on; wake_up() readies every process queued there. To avoid
+ * a lost wakeup, test the condition with IRQs off and sleep without
+ * re-enabling them:
+ *
+ *     uint32_t flags = irq_save();
+ *     while (!ready) sleep_on(&q);
+ *     irq_restore(flags);
+ *
+ * Before scheduling starts the sleep is a plain HLT. Implemented
+ * in process.c alongside the run queues.                        */
+#define WAIT_MAX_QUEUES 4
+
+struct process;
+
+typedef struct wait_entry {
+    struct process    *proc;
+    struct wait_entry *next;
+} wait_entry_t;
+
+typedef struct {
+    wait_entry_t *head;
+} wait_queue_t;
+
+void sleep_on(wait_queue_t *q);
+/* 1 = woken, 0 = `ticks` elapsed first (0 ticks = no timeout) */
+int  sleep_on_timeout(wait_queue_t *q, uint32_t ticks);
+/* Sleep on up to WAIT_MAX_QUEUES queues at once; same result */
+int  sleep_on_any(wait_queue_t **qs, int n, uint32_t ticks);
+void wake_up(wait_queue_t *q);           /* safe from IRQ handlers */
+
+/* Block the caller for at least `ms` milliseconds (timer wheel) */
+void process_sleep_ms(uint32_t ms);
+
+#endif